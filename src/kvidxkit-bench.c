@@ -12,6 +12,10 @@
  * 5. Range Operations - Range queries and deletes
  * 6. Concurrent Patterns - Simulated concurrent access patterns
  *
+ * When the in-memory adapter is built it serves as the baseline: results
+ * are also reported as a percentage of its throughput, and it is left out
+ * of the winner rankings since it has no durability cost to pay.
+ *
  * Usage:
  *   ./kvidxkit-bench              Run all benchmarks
  *   ./kvidxkit-bench quick        Run quick benchmarks (fewer operations)
@@ -42,6 +46,7 @@
 #define BENCH_DATA_SIZE 64         /* Default data blob size */
 #define BENCH_LARGE_DATA_SIZE 4096 /* Large data blob size */
 #define MAX_ADAPTERS 16            /* Maximum number of adapters */
+#define BENCH_BASELINE "Memory"    /* Reference adapter, if built */
 
 /* ====================================================================
  * Adapter Registry
@@ -972,6 +977,67 @@ static void print_latency_table(void) {
     printf("\n");
 }
 
+static const BenchResult *find_result(const char *adapter,
+                                     const char *bench) {
+    for (size_t r = 0; r < g_resultCount; r++) {
+        if (strcmp(g_results[r].adapterName, adapter) != 0) {
+            continue;
+        }
+        for (size_t i = 0; i < g_results[r].resultCount; i++) {
+            if (strcmp(g_results[r].results[i].name, bench) == 0) {
+                return &g_results[r].results[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+static void print_baseline_table(void) {
+    bool haveBaseline = false;
+    for (size_t r = 0; r < g_resultCount; r++) {
+        if (strcmp(g_results[r].adapterName, BENCH_BASELINE) == 0) {
+            haveBaseline = true;
+            break;
+        }
+    }
+    if (!haveBaseline) {
+        return;
+    }
+
+    print_box_top();
+    print_box_line("RELATIVE TO BASELINE (% of " BENCH_BASELINE " ops/sec)");
+    print_box_bottom();
+
+    print_header();
+
+    const char *benchNames[32];
+    size_t benchCount = 0;
+
+    if (g_resultCount > 0) {
+        for (size_t i = 0; i < g_results[0].resultCount; i++) {
+            benchNames[benchCount++] = g_results[0].results[i].name;
+        }
+    }
+
+    for (size_t b = 0; b < benchCount; b++) {
+        printf("%-20s", benchNames[b]);
+
+        const BenchResult *base = find_result(BENCH_BASELINE, benchNames[b]);
+        for (size_t a = 0; a < ADAPTER_COUNT; a++) {
+            const BenchResult *res =
+                find_result(kvidxGetAdapterByIndex(a)->name, benchNames[b]);
+            if (base && res && base->opsPerSec > 0) {
+                printf(" │ %18.1f%%", 100.0 * res->opsPerSec / base->opsPerSec);
+            } else {
+                printf(" │ %19s", "N/A");
+            }
+        }
+        printf("\n");
+    }
+
+    printf("\n");
+}
+
 /* ====================================================================
  * Winner Report - Summary of best performers
  * ==================================================================== */
@@ -1000,6 +1066,7 @@ static void print_winner_report(void) {
     print_box_line("WINNER REPORT - Best Adapter by Operation");
     print_box_mid();
     print_box_line("(~) = within 10% of leader, considered statistical tie");
+    print_box_line("(" BENCH_BASELINE " baseline is not ranked)");
     print_box_bottom();
 
     /* Find all unique benchmark names */
@@ -1037,6 +1104,9 @@ static void print_winner_report(void) {
 
         /* Gather all adapter results for this benchmark */
         for (size_t r = 0; r < g_resultCount; r++) {
+            if (strcmp(g_results[r].adapterName, BENCH_BASELINE) == 0) {
+                continue;
+            }
             for (size_t i = 0; i < g_results[r].resultCount; i++) {
                 if (strcmp(g_results[r].results[i].name, benchNames[b]) == 0) {
                     rankings[rankCount].adapter = g_results[r].adapterName;
@@ -1318,6 +1388,7 @@ int main(int argc, char *argv[]) {
     print_results_table();
     print_throughput_table();
     print_latency_table();
+    print_baseline_table();
     print_winner_report();
 
     /* Summary */
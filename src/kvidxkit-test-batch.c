@@ -1,6 +1,7 @@
 /**
  * Comprehensive batch operation tests for kvidxkit
- * Tests batch insert functionality and performance
+ * Tests batch insert functionality and performance, and batched state
+ * machine replay
  */
 
 #include "ctest.h"
@@ -478,7 +479,7 @@ static void testBatchPerformance(uint32_t *err) {
         uint64_t end = getTimeMicros();
         uint64_t duration = end - start;
 
-        if (!result || inserted != BATCH_SIZE) {
+        if (!result || inserted != (size_t)BATCH_SIZE) {
             ERR("Batch insert failed: result=%d, inserted=%zu", result,
                 inserted);
         }
@@ -494,6 +495,136 @@ static void testBatchPerformance(uint32_t *err) {
     cleanupTestFile(filename);
 }
 
+/* ====================================================================
+ * TEST SUITE 6: State Machine Replay
+ * ==================================================================== */
+#define REPLAY_KEYS 5000
+
+typedef struct replayState {
+    uint64_t nextKey;
+    uint64_t applied;
+    uint64_t batches;
+    uint64_t refuseAt; /* Refuse the batch containing this key (0 = never) */
+    bool intact;
+} replayState;
+
+static bool replayApplyBatch(kvidxInstance *i, const kvidxEntry *entries,
+                             size_t count) {
+    replayState *st = i->clientdata;
+    for (size_t n = 0; n < count; n++) {
+        if (entries[n].key == st->refuseAt) {
+            return false;
+        }
+    }
+
+    for (size_t n = 0; n < count; n++) {
+        const kvidxEntry *e = &entries[n];
+        if (e->key != st->nextKey || e->term != e->key % 7 ||
+            e->dataLen != e->key % 300 ||
+            (e->dataLen && ((const uint8_t *)e->data)[e->dataLen - 1] !=
+                               (uint8_t)e->key)) {
+            st->intact = false;
+        }
+        st->nextKey++;
+    }
+    st->applied += count;
+    st->batches++;
+    return true;
+}
+
+static bool replayApplyOne(kvidxInstance *i, uint64_t key) {
+    replayState *st = i->clientdata;
+    uint64_t term = 0;
+    if (key != st->nextKey || !kvidxGet(i, key, &term, NULL, NULL, NULL) ||
+        term != key % 7) {
+        st->intact = false;
+    }
+    st->nextKey++;
+    st->applied++;
+    return true;
+}
+
+static void testStateMachineReplay(uint32_t *err, const kvidxInterface *iface,
+                                   const char *name) {
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), name);
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    memset(i, 0, sizeof(*i));
+    i->interface = *iface;
+    if (!kvidxOpen(i, filename, NULL)) {
+        ERRR("Failed to open database for replay tests");
+        return;
+    }
+
+    replayState st = {0};
+    i->clientdata = &st;
+
+    uint8_t data[300];
+    kvidxBegin(i);
+    for (uint64_t key = 1; key <= REPLAY_KEYS; key++) {
+        memset(data, (uint8_t)key, sizeof(data));
+        kvidxInsert(i, key, key % 7, 0, data, key % 300);
+    }
+    kvidxCommit(i);
+
+    TEST("Replay: No apply hook") {
+        if (kvidxReplayStateMachine(i, 0, UINT64_MAX, NULL) !=
+            KVIDX_ERROR_NOT_SUPPORTED) {
+            ERRR("Expected NOT_SUPPORTED without a hook");
+        }
+    }
+
+    i->state.applyBatch = replayApplyBatch;
+
+    TEST("Replay: Every entry applied in order, in batches") {
+        st = (replayState){.nextKey = 1, .intact = true};
+        uint64_t applied = 0;
+        kvidxError result = kvidxReplayStateMachine(i, 0, UINT64_MAX, &applied);
+        if (result != KVIDX_OK || applied != REPLAY_KEYS ||
+            st.applied != REPLAY_KEYS || !st.intact || st.batches < 2) {
+            ERR("Replay failed: result=%d applied=%" PRIu64 " batches=%" PRIu64,
+                result, applied, st.batches);
+        }
+    }
+
+    TEST("Replay: Key range") {
+        st = (replayState){.nextKey = 100, .intact = true};
+        uint64_t applied = 0;
+        kvidxReplayStateMachine(i, 100, 199, &applied);
+        if (applied != 100 || !st.intact || st.nextKey != 200) {
+            ERR("Expected keys 100-199, applied %" PRIu64, applied);
+        }
+    }
+
+    TEST("Replay: Refused batch stops the replay") {
+        st = (replayState){.nextKey = 1, .intact = true, .refuseAt = 3000};
+        uint64_t applied = 0;
+        kvidxError result = kvidxReplayStateMachine(i, 0, UINT64_MAX, &applied);
+        if (result != KVIDX_ERROR_CANCELLED || applied >= 3000 ||
+            applied != st.applied) {
+            ERR("Expected CANCELLED before key 3000: result=%d applied=%" PRIu64,
+                result, applied);
+        }
+    }
+
+    TEST("Replay: Per-key hook without applyBatch") {
+        i->state.applyBatch = NULL;
+        i->state.applyToStateMachine = replayApplyOne;
+        st = (replayState){.nextKey = 1, .intact = true};
+        uint64_t applied = 0;
+        kvidxError result = kvidxReplayStateMachine(i, 0, UINT64_MAX, &applied);
+        if (result != KVIDX_OK || applied != REPLAY_KEYS || !st.intact) {
+            ERR("Per-key replay failed: result=%d applied=%" PRIu64, result,
+                applied);
+        }
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(filename);
+}
+
 /* ====================================================================
  * MAIN TEST RUNNER
  * ==================================================================== */
@@ -531,6 +662,14 @@ int main(int argc, char *argv[]) {
     testBatchPerformance(&err);
     printf("\n");
 
+    printf("Running Suite 6: State Machine Replay\n");
+    printf("-------------------------------------------------------\n");
+    testStateMachineReplay(&err, &kvidxInterfaceSqlite3, "replay");
+#ifdef KVIDXKIT_HAS_MEMORY
+    testStateMachineReplay(&err, &kvidxInterfaceMemory, "replay-memory");
+#endif
+    printf("\n");
+
     printf("=======================================================\n");
     if (err == 0) {
         printf("ALL BATCH OPERATION TESTS PASSED!\n");
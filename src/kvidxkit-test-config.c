@@ -3,6 +3,14 @@
  * Tests configuration API, defaults, and SQLite PRAGMA application
  */
 
+/* Required for usleep under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "../deps/sqlite3/src/sqlite3.h"
 #include "ctest.h"
 #include "kvidxkit.h"
 
@@ -373,6 +381,236 @@ static void testConfigErrors(uint32_t *err) {
 /* ====================================================================
  * MAIN TEST RUNNER
  * ==================================================================== */
+/* ====================================================================
+ * TEST SUITE 8: WAL Checkpointing
+ * ==================================================================== */
+static void insertRows(kvidxInstance *i, uint64_t first, uint64_t count) {
+    static uint8_t row[1024];
+    memset(row, 0x42, sizeof(row));
+    for (uint64_t k = first; k < first + count; k++) {
+        kvidxInsert(i, k, 1, 1, row, sizeof(row));
+    }
+}
+
+/* Poll until the background checkpointer has run and the WAL is below
+ * walBelow bytes. Bounded at 10 s, far above the checkpointer's retry
+ * delay even under sanitizers. */
+static void waitForCheckpoint(kvidxInstance *i, kvidxStats *stats,
+                              uint64_t walBelow) {
+    for (int wait = 0; wait < 1000; wait++) {
+        kvidxGetStats(i, stats);
+        if (stats->checkpointCount && stats->walFileSize < walBelow) {
+            return;
+        }
+        usleep(10 * 1000);
+    }
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testWalCheckpointing(uint32_t *errCount) {
+    uint32_t err = 0;
+    char filename[128];
+
+    TEST("WAL Checkpointing: Disabled auto-checkpoint lets the WAL grow") {
+        makeTestFilename(filename, sizeof(filename), "walgrow");
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceSqlite3;
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.sqliteWalAutoCheckpoint = -1;
+        kvidxOpenWithConfig(i, filename, &config, NULL);
+
+        insertRows(i, 1, 2000);
+
+        kvidxStats stats = {0};
+        kvidxGetStats(i, &stats);
+        if (stats.walFileSize < 2000 * 1024) {
+            ERR("WAL should hold every commit, only %" PRIu64 " bytes",
+                stats.walFileSize);
+        }
+
+        kvidxClose(i);
+        cleanupTestFile(filename);
+    }
+
+    TEST("WAL Checkpointing: Background PASSIVE checkpoint when idle") {
+        makeTestFilename(filename, sizeof(filename), "walidle");
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceSqlite3;
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.sqliteBackgroundCheckpoint = true;
+        config.sqliteCheckpointIdleMs = 20;
+        kvidxOpenWithConfig(i, filename, &config, NULL);
+
+        insertRows(i, 1, 500);
+
+        kvidxStats stats = {0};
+        waitForCheckpoint(i, &stats, UINT64_MAX);
+
+        if (stats.checkpointCount == 0) {
+            ERRR("Background checkpoint never ran!");
+        }
+        if (stats.walFileSize == 0) {
+            ERRR("WAL file size not reported!");
+        }
+        if (stats.totalKeys != 500) {
+            ERR("Expected 500 keys, got %" PRIu64, stats.totalKeys);
+        }
+
+        kvidxClose(i);
+        cleanupTestFile(filename);
+    }
+
+    TEST("WAL Checkpointing: Background TRUNCATE bounds the WAL") {
+        makeTestFilename(filename, sizeof(filename), "walcap");
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceSqlite3;
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.sqliteBackgroundCheckpoint = true;
+        config.sqliteCheckpointIdleMs = 60 * 1000; /* Never idle */
+        config.sqliteWalSizeLimitBytes = 256 * 1024;
+        kvidxOpenWithConfig(i, filename, &config, NULL);
+
+        insertRows(i, 1, 2000);
+
+        /* A TRUNCATE that lost to the writers is retried shortly after,
+         * not after the 60 s idle interval */
+        kvidxStats stats = {0};
+        waitForCheckpoint(i, &stats, 1024 * 1024);
+
+        if (stats.checkpointCount == 0) {
+            ERRR("Size cap never triggered a checkpoint!");
+        }
+        if (stats.walFileSize >= 1024 * 1024) {
+            ERR("WAL not bounded: %" PRIu64 " bytes", stats.walFileSize);
+        }
+        if (stats.maxCheckpointMicros < stats.lastCheckpointMicros) {
+            ERRR("Max checkpoint duration below last duration!");
+        }
+
+        /* Turning it off restores inline checkpointing */
+        config.sqliteBackgroundCheckpoint = false;
+        if (kvidxUpdateConfig(i, &config) != KVIDX_OK) {
+            ERRR("Failed to stop background checkpointer!");
+        }
+        insertRows(i, 5000, 100);
+
+        kvidxClose(i);
+        cleanupTestFile(filename);
+    }
+
+    *errCount += err;
+}
+
+/* ====================================================================
+ * TEST SUITE 9: Value Checksums
+ * ==================================================================== */
+/* cppcheck-suppress constParameterPointer */
+static void testValueChecksums(uint32_t *errCount) {
+    uint32_t err = 0;
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), "checksums");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+
+    /* Keys 1-100 predate the crc column */
+    kvidxOpen(i, filename, NULL);
+    insertRows(i, 1, 100);
+
+    kvidxConfig config = kvidxConfigDefault();
+    config.valueChecksums = true;
+    config.verifyChecksums = true;
+
+    TEST("Value Checksums: Enabling adds a crc column") {
+        if (kvidxUpdateConfig(i, &config) != KVIDX_OK) {
+            ERR("Failed to enable checksums: %s",
+                kvidxGetLastErrorMessage(i));
+        }
+        insertRows(i, 101, 1000);
+        kvidxAppend(i, 50, 1, 1, "tail", 4, NULL);
+
+        const uint8_t *data;
+        size_t len;
+        if (!kvidxGet(i, 500, NULL, NULL, &data, &len) || len != 1024) {
+            ERRR("Checksummed row misread!");
+        }
+    }
+
+    TEST("Value Checksums: Verify counts checked and unchecked rows") {
+        kvidxVerifyResult result;
+        kvidxError e = kvidxVerify(i, 0, UINT64_MAX, 4, &result);
+        if (e != KVIDX_OK) {
+            ERR("Verify failed: %s", kvidxGetLastErrorMessage(i));
+        }
+        /* The append rewrote key 50 with a checksum */
+        if (result.entriesChecked != 1001 || result.entriesUnchecked != 99 ||
+            result.corruptEntries) {
+            ERR("Verify saw %" PRIu64 " checked, %" PRIu64
+                " unchecked, %" PRIu64 " corrupt",
+                result.entriesChecked, result.entriesUnchecked,
+                result.corruptEntries);
+        }
+    }
+    kvidxClose(i);
+
+    /* Change a row's data behind the adapter's back */
+    sqlite3 *db = NULL;
+    sqlite3_open(filename, &db);
+    sqlite3_exec(db, "UPDATE log SET data = zeroblob(1024) WHERE id = 777",
+                 NULL, NULL, NULL);
+    sqlite3_close(db);
+
+    kvidxOpenWithConfig(i, filename, &config, NULL);
+
+    TEST("Value Checksums: Corrupt row fails its read") {
+        if (kvidxGet(i, 777, NULL, NULL, NULL, NULL)) {
+            ERRR("Corrupt row was returned!");
+        }
+        if (kvidxGetLastError(i) != KVIDX_ERROR_CORRUPT) {
+            ERR("Expected KVIDX_ERROR_CORRUPT, got %d", kvidxGetLastError(i));
+        }
+
+        uint64_t next = 0;
+        if (kvidxGetNext(i, 776, &next, NULL, NULL, NULL, NULL)) {
+            ERRR("Iteration returned the corrupt row!");
+        }
+        if (!kvidxGet(i, 778, NULL, NULL, NULL, NULL)) {
+            ERRR("Neighbouring row no longer readable!");
+        }
+    }
+
+    TEST("Value Checksums: Verify finds the corrupt row") {
+        kvidxVerifyResult result;
+        kvidxError e = kvidxVerify(i, 0, UINT64_MAX, 4, &result);
+        if (e != KVIDX_ERROR_CORRUPT) {
+            ERR("Expected KVIDX_ERROR_CORRUPT, got %d", e);
+        }
+        if (result.corruptEntries != 1 || result.firstCorruptKey != 777) {
+            ERR("Expected key 777 corrupt, got %" PRIu64 " at %" PRIu64,
+                result.corruptEntries, result.firstCorruptKey);
+        }
+    }
+
+    TEST("Value Checksums: Reads skip verification when disabled") {
+        config.verifyChecksums = false;
+        kvidxUpdateConfig(i, &config);
+        if (!kvidxGet(i, 777, NULL, NULL, NULL, NULL)) {
+            ERRR("Read failed with verification off!");
+        }
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(filename);
+    *errCount += err;
+}
+
 int main(int argc, char *argv[]) {
     (void)argc;
     (void)argv;
@@ -417,6 +655,16 @@ int main(int argc, char *argv[]) {
     testConfigErrors(&err);
     printf("\n");
 
+    printf("Running Suite 8: WAL Checkpointing\n");
+    printf("-------------------------------------------------------\n");
+    testWalCheckpointing(&err);
+    printf("\n");
+
+    printf("Running Suite 9: Value Checksums\n");
+    printf("-------------------------------------------------------\n");
+    testValueChecksums(&err);
+    printf("\n");
+
     printf("=======================================================\n");
     if (err == 0) {
         printf("ALL CONFIGURATION TESTS PASSED!\n");
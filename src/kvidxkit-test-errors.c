@@ -228,7 +228,9 @@ static void testTransactionState(uint32_t *err) {
             ERRR("Begin should succeed");
         }
 
-        /* In future, verify transactionActive is set */
+        if (!i->transactionActive) {
+            ERRR("Transaction should be active after begin");
+        }
     }
 
     TEST("Transaction State: Commit clears active") {
@@ -236,7 +238,19 @@ static void testTransactionState(uint32_t *err) {
             ERRR("Commit should succeed");
         }
 
-        /* In future, verify transactionActive is cleared */
+        if (i->transactionActive) {
+            ERRR("Transaction should not be active after commit");
+        }
+    }
+
+    TEST("Transaction State: Abort clears active") {
+        if (!kvidxBegin(i) || !kvidxAbort(i)) {
+            ERRR("Begin and abort should succeed");
+        }
+
+        if (i->transactionActive) {
+            ERRR("Transaction should not be active after abort");
+        }
     }
 
     TEST("Transaction State: Multiple begins") {
@@ -1,14 +1,25 @@
 /**
  * Comprehensive export/import tests for kvidxkit
- * Tests binary, JSON, and CSV export formats, plus import with validation
+ * Tests binary, JSON, and CSV export and import, with validation,
+ * and streaming over file descriptors
  */
 
+/* Required for socketpair and clock_gettime under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "ctest.h"
 #include "kvidxkit.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 /* cppcheck-suppress constParameterPointer */
 static void makeTestFilename(char *buf, size_t bufSize, const char *testName,
@@ -579,9 +590,1448 @@ static void testExportImportErrors(uint32_t *err) {
     }
 }
 
+/* ====================================================================
+ * TEST SUITE 7: Streaming Export/Import
+ * ==================================================================== */
+
+/* Growable in-memory sink for kvidxExportToStream() */
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t capacity;
+    size_t writes;
+} memorySink;
+
+static bool memorySinkWrite(const void *buf, size_t len, void *streamData) {
+    memorySink *sink = streamData;
+    if (sink->len + len > sink->capacity) {
+        size_t capacity = (sink->len + len) * 2;
+        uint8_t *grown = realloc(sink->buf, capacity);
+        if (!grown) {
+            return false;
+        }
+        sink->buf = grown;
+        sink->capacity = capacity;
+    }
+    memcpy(sink->buf + sink->len, buf, len);
+    sink->len += len;
+    sink->writes++;
+    return true;
+}
+
+/* Source reading from a memory buffer, stopping after limit bytes */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+} memorySource;
+
+static int64_t memorySourceRead(void *buf, size_t len, void *streamData) {
+    memorySource *src = streamData;
+    size_t n = src->len - src->pos;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, src->buf + src->pos, n);
+    src->pos += n;
+    return (int64_t)n;
+}
+
+static bool fileMatches(const char *filename, const memorySink *sink) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return false;
+    }
+
+    uint8_t *contents = malloc(sink->len + 1);
+    size_t n = contents ? fread(contents, 1, sink->len + 1, fp) : 0;
+    bool same = n == sink->len && memcmp(contents, sink->buf, n) == 0;
+    free(contents);
+    fclose(fp);
+    return same;
+}
+
+static double elapsedSeconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+           (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Fill a database with count entries of valueLen bytes each */
+static bool populateSized(kvidxInstance *i, uint64_t count, size_t valueLen) {
+    uint8_t *value = malloc(valueLen);
+    if (!value || !kvidxBegin(i)) {
+        free(value);
+        return false;
+    }
+
+    for (uint64_t key = 1; key <= count; key++) {
+        memset(value, (int)('a' + key % 26), valueLen);
+        memcpy(value, &key, sizeof(key) < valueLen ? sizeof(key) : valueLen);
+        if (!kvidxInsert(i, key, key, 0, value, valueLen)) {
+            free(value);
+            return false;
+        }
+    }
+
+    free(value);
+    return kvidxCommit(i);
+}
+
+/**
+ * Export dbFile through one end of a socketpair from a child process while
+ * this process imports from the other end into importDb.
+ */
+static kvidxError streamOverSocketpair(const char *dbFile,
+                                       const char *importDb,
+                                       uint64_t *imported) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return KVIDX_ERROR_IO;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return KVIDX_ERROR_IO;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        kvidxInstance source = {0};
+        source.interface = kvidxInterfaceSqlite3;
+        kvidxError e = KVIDX_ERROR_IO;
+        if (kvidxOpen(&source, dbFile, NULL)) {
+            e = kvidxExportToFd(&source, fds[1], NULL, NULL, NULL);
+            kvidxClose(&source);
+        }
+        close(fds[1]);
+        _exit(e == KVIDX_OK ? 0 : 1);
+    }
+
+    close(fds[1]);
+    kvidxInstance target = {0};
+    target.interface = kvidxInterfaceSqlite3;
+    kvidxError e = KVIDX_ERROR_IO;
+    if (kvidxOpen(&target, importDb, NULL)) {
+        e = kvidxImportFromFd(&target, fds[0], NULL, NULL, NULL);
+        kvidxGetKeyCount(&target, imported);
+        kvidxClose(&target);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (e == KVIDX_OK && (!WIFEXITED(status) || WEXITSTATUS(status) != 0)) {
+        e = KVIDX_ERROR_IO;
+    }
+    return e;
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testStreaming(uint32_t *err) {
+    char dbFile[128], exportFile[128], importDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "stream-db", "sqlite3");
+    makeTestFilename(exportFile, sizeof(exportFile), "stream", "out");
+    makeTestFilename(importDb, sizeof(importDb), "stream-import", "sqlite3");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+
+    const char *errMsg = NULL;
+    if (!kvidxOpen(i, dbFile, &errMsg) || !populateTestData(i, 500)) {
+        ERR("Failed to set up: %s", errMsg ? errMsg : "unknown");
+        return;
+    }
+
+    TEST("Streaming: Output matches file export in every format") {
+        const kvidxExportFormat formats[] = {
+            KVIDX_EXPORT_BINARY, KVIDX_EXPORT_JSON, KVIDX_EXPORT_CSV};
+        for (size_t f = 0; f < sizeof(formats) / sizeof(*formats); f++) {
+            kvidxExportOptions options = kvidxExportOptionsDefault();
+            options.format = formats[f];
+            options.startKey = 10;
+            options.endKey = 400;
+            options.prettyPrint = f == 1;
+
+            memorySink sink = {0};
+            kvidxError e = kvidxExportToStream(i, memorySinkWrite, &sink,
+                                               &options, NULL, NULL);
+            kvidxExport(i, exportFile, &options, NULL, NULL);
+            if (e != KVIDX_OK || !fileMatches(exportFile, &sink)) {
+                ERR("Stream output differs from file export (format %d)",
+                    (int)formats[f]);
+            }
+            free(sink.buf);
+        }
+        cleanupTestFile(exportFile);
+    }
+
+    TEST("Streaming: Values larger than the buffer round-trip") {
+        const size_t bigLen = KVIDX_STREAM_BUFFER_BYTES * 5 / 2;
+        uint8_t *big = malloc(bigLen);
+        for (size_t n = 0; n < bigLen; n++) {
+            big[n] = (uint8_t)(n * 31);
+        }
+        kvidxInsert(i, 1000, 7, 7, big, bigLen);
+
+        memorySink sink = {0};
+        kvidxError e =
+            kvidxExportToStream(i, memorySinkWrite, &sink, NULL, NULL, NULL);
+        if (e != KVIDX_OK) {
+            ERR("Export failed: %d", e);
+        }
+
+        kvidxInstance other = {0};
+        other.interface = kvidxInterfaceSqlite3;
+        if (kvidxOpen(&other, importDb, NULL)) {
+            memorySource src = {.buf = sink.buf, .len = sink.len};
+            e = kvidxImportFromStream(&other, memorySourceRead, &src, NULL,
+                                      NULL, NULL);
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (e != KVIDX_OK || !kvidxGet(&other, 1000, NULL, NULL, &data,
+                                           &len) ||
+                len != bigLen || memcmp(data, big, bigLen) != 0) {
+                ERR("Large value did not round-trip (import %d)", e);
+            }
+            kvidxClose(&other);
+        }
+        cleanupTestFile(importDb);
+
+        kvidxRemove(i, 1000);
+        free(sink.buf);
+        free(big);
+    }
+
+    TEST("Streaming: Truncated stream rolls back the import") {
+        memorySink sink = {0};
+        kvidxExportToStream(i, memorySinkWrite, &sink, NULL, NULL, NULL);
+
+        kvidxInstance other = {0};
+        other.interface = kvidxInterfaceSqlite3;
+        if (kvidxOpen(&other, importDb, NULL)) {
+            kvidxInsert(&other, 9999, 1, 1, "keep", 4);
+
+            kvidxImportOptions options = kvidxImportOptionsDefault();
+            options.clearBeforeImport = true;
+            memorySource src = {.buf = sink.buf, .len = sink.len / 2};
+            kvidxError e = kvidxImportFromStream(
+                &other, memorySourceRead, &src, &options, NULL, NULL);
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(&other, &count);
+            if (e != KVIDX_ERROR_IO || count != 1 ||
+                !kvidxExists(&other, 9999)) {
+                ERR("Expected IO error and untouched data, got %d with %" PRIu64
+                    " keys",
+                    e, count);
+            }
+            kvidxClose(&other);
+        }
+        cleanupTestFile(importDb);
+        free(sink.buf);
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(dbFile);
+
+    TEST("Streaming: Snapshot over a socketpair keeps up with files") {
+        /* 100k entries of 200 bytes: ~23 MB of export */
+        const uint64_t entries = 100000;
+        i = &inst;
+        memset(i, 0, sizeof(*i));
+        i->interface = kvidxInterfaceSqlite3;
+        if (!kvidxOpen(i, dbFile, NULL) || !populateSized(i, entries, 200)) {
+            ERRR("Failed to populate source database");
+            kvidxClose(i);
+            cleanupTestFile(dbFile);
+            return;
+        }
+
+        /* Baseline: export to a file, then import it */
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxExport(i, exportFile, NULL, NULL, NULL);
+        kvidxClose(i);
+
+        kvidxInstance other = {0};
+        other.interface = kvidxInterfaceSqlite3;
+        if (kvidxOpen(&other, importDb, NULL)) {
+            kvidxImport(&other, exportFile, NULL, NULL, NULL);
+            kvidxClose(&other);
+        }
+        const double fileSeconds = elapsedSeconds(&start);
+        const double megabytes = (double)getFileSize(exportFile) / 1e6;
+        cleanupTestFile(exportFile);
+        cleanupTestFile(importDb);
+
+        uint64_t imported = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxError e = streamOverSocketpair(dbFile, importDb, &imported);
+        const double streamSeconds = elapsedSeconds(&start);
+
+        printf("\tfile: %.1f MB/s, socketpair: %.1f MB/s\n",
+               megabytes / fileSeconds, megabytes / streamSeconds);
+
+        if (e != KVIDX_OK || imported != entries) {
+            ERR("Socketpair transfer failed: %d, %" PRIu64 " entries", e,
+                imported);
+        }
+
+        /* Export and import overlap, so the stream should not trail the
+         * file round trip; allow generous slack for loaded machines. */
+        if (streamSeconds > fileSeconds * 2 + 0.5) {
+            ERR("Socketpair transfer took %.2fs vs %.2fs through a file",
+                streamSeconds, fileSeconds);
+        }
+
+        cleanupTestFile(importDb);
+        cleanupTestFile(dbFile);
+    }
+}
+
+/* ====================================================================
+ * TEST SUITE 8: Block Layout (Binary v2)
+ * ==================================================================== */
+
+static bool cancelAfterFirst(uint64_t current, uint64_t total,
+                             void *userData) {
+    (void)current;
+    (void)total;
+    (void)userData;
+    return false;
+}
+
+/* Compare every entry of two databases */
+static bool sameEntries(kvidxInstance *a, kvidxInstance *b) {
+    uint64_t countA = 0, countB = 0;
+    kvidxGetKeyCount(a, &countA);
+    kvidxGetKeyCount(b, &countB);
+    if (countA != countB) {
+        return false;
+    }
+
+    uint64_t key = 0, term, cmd;
+    const uint8_t *data;
+    size_t len;
+    while (kvidxGetNext(a, key, &key, &term, &cmd, &data, &len)) {
+        uint64_t termB, cmdB;
+        const uint8_t *dataB;
+        size_t lenB;
+        uint8_t *copy = malloc(len ? len : 1);
+        memcpy(copy, data, len);
+        bool same = kvidxGet(b, key, &termB, &cmdB, &dataB, &lenB) &&
+                    term == termB && cmd == cmdB && len == lenB &&
+                    memcmp(copy, dataB, len) == 0;
+        free(copy);
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testBlockLayout(uint32_t *err) {
+    char dbFile[128], exportFile[128], importDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "blocks-db", "sqlite3");
+    makeTestFilename(exportFile, sizeof(exportFile), "blocks", "bin");
+    makeTestFilename(importDb, sizeof(importDb), "blocks-import", "sqlite3");
+
+    /* ~20 MB, so the export spans several blocks */
+    const uint64_t entries = 20000;
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    if (!kvidxOpen(i, dbFile, NULL) || !populateSized(i, entries, 1000)) {
+        ERRR("Failed to populate source database");
+        return;
+    }
+
+    kvidxInstance other = {0};
+    other.interface = kvidxInterfaceSqlite3;
+    if (!kvidxOpen(&other, importDb, NULL)) {
+        ERRR("Failed to open import database");
+        kvidxClose(i);
+        return;
+    }
+
+    TEST("Block Layout: Round trip with 1 to 4 threads") {
+        for (uint32_t threads = 1; threads <= 4; threads++) {
+            kvidxExportOptions exportOptions = kvidxExportOptionsDefault();
+            exportOptions.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+            exportOptions.threads = threads;
+            kvidxImportOptions importOptions = kvidxImportOptionsDefault();
+            importOptions.clearBeforeImport = true;
+            importOptions.threads = threads;
+
+            kvidxError e =
+                kvidxExport(i, exportFile, &exportOptions, NULL, NULL);
+            if (e == KVIDX_OK) {
+                e = kvidxImport(&other, exportFile, &importOptions, NULL,
+                                NULL);
+            }
+            if (e != KVIDX_OK || !sameEntries(i, &other)) {
+                ERR("Round trip with %u threads failed: %s", threads,
+                    kvidxGetLastErrorMessage(&other));
+            }
+        }
+    }
+
+    TEST("Block Layout: Range export inside a transaction") {
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        options.startKey = 5000;
+        options.endKey = entries + 1;
+        options.threads = 3;
+
+        /* An open transaction makes the workers share this connection, so
+         * its uncommitted insert is exported too */
+        kvidxBegin(i);
+        kvidxInsert(i, entries + 1, 1, 1, "uncommitted", 11);
+        kvidxError e = kvidxExport(i, exportFile, &options, NULL, NULL);
+        kvidxAbort(i);
+
+        kvidxImportOptions importOptions = kvidxImportOptionsDefault();
+        importOptions.clearBeforeImport = true;
+        if (e == KVIDX_OK) {
+            e = kvidxImport(&other, exportFile, &importOptions, NULL, NULL);
+        }
+
+        uint64_t count = 0, minKey = 0;
+        kvidxGetKeyCount(&other, &count);
+        kvidxGetMinKey(&other, &minKey);
+        if (e != KVIDX_OK || count != entries - 5000 + 2 || minKey != 5000 ||
+            !kvidxExists(&other, entries + 1)) {
+            ERR("Range export gave %" PRIu64 " keys from %" PRIu64, count,
+                minKey);
+        }
+    }
+
+    TEST("Block Layout: Corrupt block fails and rolls back") {
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        kvidxExport(i, exportFile, &options, NULL, NULL);
+
+        /* Flip one byte in the middle of the file (inside a block) */
+        FILE *fp = fopen(exportFile, "r+b");
+        long middle = (long)getFileSize(exportFile) / 2;
+        fseek(fp, middle, SEEK_SET);
+        int c = fgetc(fp);
+        fseek(fp, middle, SEEK_SET);
+        fputc(c ^ 0x5A, fp);
+        fclose(fp);
+
+        uint64_t before = 0, after = 0;
+        kvidxGetKeyCount(&other, &before);
+        kvidxImportOptions importOptions = kvidxImportOptionsDefault();
+        importOptions.clearBeforeImport = true;
+        kvidxError e =
+            kvidxImport(&other, exportFile, &importOptions, NULL, NULL);
+        kvidxGetKeyCount(&other, &after);
+        if (e != KVIDX_ERROR_CORRUPT || before != after) {
+            ERR("Expected CORRUPT and no change, got %d (%" PRIu64
+                " -> %" PRIu64 " keys)",
+                e, before, after);
+        }
+
+        /* A file cut short loses its trailer and index */
+        if (truncate(exportFile, middle) != 0 ||
+            kvidxImport(&other, exportFile, &importOptions, NULL, NULL) ==
+                KVIDX_OK) {
+            ERRR("Truncated block export was accepted");
+        }
+    }
+
+    TEST("Block Layout: Progress callback cancels export") {
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        options.threads = 2;
+        kvidxError e =
+            kvidxExport(i, exportFile, &options, cancelAfterFirst, NULL);
+        if (e != KVIDX_ERROR_CANCELLED) {
+            ERR("Expected CANCELLED, got %d", e);
+        }
+    }
+
+    TEST("Block Layout: Empty database") {
+        kvidxRemoveRange(&other, 0, UINT64_MAX, true, true, NULL);
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        kvidxError e = kvidxExport(&other, exportFile, &options, NULL, NULL);
+        if (e == KVIDX_OK) {
+            e = kvidxImport(&other, exportFile, NULL, NULL, NULL);
+        }
+        if (e != KVIDX_OK) {
+            ERR("Empty block export round trip failed: %d", e);
+        }
+    }
+
+    TEST("Block Layout: Empty range") {
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        options.startKey = entries + 100;
+        options.endKey = entries + 200;
+        kvidxImportOptions importOptions = kvidxImportOptionsDefault();
+        importOptions.clearBeforeImport = true;
+
+        kvidxInsert(&other, 1, 1, 1, "stale", 5);
+        kvidxError e = kvidxExport(i, exportFile, &options, NULL, NULL);
+        if (e == KVIDX_OK) {
+            e = kvidxImport(&other, exportFile, &importOptions, NULL, NULL);
+        }
+
+        uint64_t count = 1;
+        kvidxGetKeyCount(&other, &count);
+        if (e != KVIDX_OK || count != 0) {
+            ERR("Empty range round trip gave %d with %" PRIu64 " keys", e,
+                count);
+        }
+    }
+
+    TEST("Block Layout: Throughput against the stream layout") {
+        struct timespec start;
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxExport(i, exportFile, &options, NULL, NULL);
+        const double streamSeconds = elapsedSeconds(&start);
+        const double megabytes = (double)getFileSize(exportFile) / 1e6;
+
+        options.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxError e = kvidxExport(i, exportFile, &options, NULL, NULL);
+        const double blockSeconds = elapsedSeconds(&start);
+
+        printf("\tstream: %.1f MB/s, blocks: %.1f MB/s\n",
+               megabytes / streamSeconds, megabytes / blockSeconds);
+        if (e != KVIDX_OK) {
+            ERR("Block export failed: %d", e);
+        }
+    }
+
+    kvidxClose(&other);
+    kvidxClose(i);
+    cleanupTestFile(exportFile);
+    cleanupTestFile(importDb);
+    cleanupTestFile(dbFile);
+}
+
+/* ====================================================================
+ * TEST SUITE 9: Mapped Import
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_LMDB
+static void removeLmdbDir(const char *dirname) {
+    char path[160];
+    snprintf(path, sizeof(path), "%s/data.mdb", dirname);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/lock.mdb", dirname);
+    unlink(path);
+    rmdir(dirname);
+}
+#endif
+
+/* cppcheck-suppress constParameterPointer */
+static void testMappedImport(uint32_t *err) {
+    char dbFile[128], exportFile[128], importDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "mapped-db", "sqlite3");
+    makeTestFilename(exportFile, sizeof(exportFile), "mapped", "bin");
+    makeTestFilename(importDb, sizeof(importDb), "mapped-import", "sqlite3");
+
+    const uint64_t entries = 20000;
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    if (!kvidxOpen(i, dbFile, NULL) || !populateSized(i, entries, 1000) ||
+        kvidxExport(i, exportFile, NULL, NULL, NULL) != KVIDX_OK) {
+        ERRR("Failed to populate and export source database");
+        kvidxClose(i);
+        return;
+    }
+    const double megabytes = (double)getFileSize(exportFile) / 1e6;
+
+    kvidxInstance other = {0};
+    other.interface = kvidxInterfaceSqlite3;
+    kvidxOpen(&other, importDb, NULL);
+
+    TEST("Mapped Import: SQLite commits in 1 MB transactions") {
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.commitBytes = 1024 * 1024;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxError e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+        printf("\timport: %.1f MB/s\n", megabytes / elapsedSeconds(&start));
+
+        if (e != KVIDX_OK || !sameEntries(i, &other)) {
+            ERR("Chunked import failed: %s",
+                kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    TEST("Mapped Import: Truncated file keeps committed transactions") {
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+        options.commitBytes = 1024 * 1024;
+
+        /* Cut the last entry in half */
+        if (truncate(exportFile, getFileSize(exportFile) - 500) != 0) {
+            ERRR("Failed to truncate export");
+        }
+        kvidxError e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+
+        uint64_t count = 0;
+        kvidxGetKeyCount(&other, &count);
+        if (e != KVIDX_ERROR_IO) {
+            ERR("Expected KVIDX_ERROR_IO, got %d", e);
+        }
+        if (count == 0 || count >= entries) {
+            ERR("Expected committed transactions only, got %" PRIu64
+                " keys",
+                count);
+        }
+    }
+
+    TEST("Mapped Import: Empty file fails cleanly") {
+        FILE *fp = fopen(exportFile, "wb");
+        fclose(fp);
+        if (kvidxImport(&other, exportFile, NULL, NULL, NULL) !=
+            KVIDX_ERROR_IO) {
+            ERRR("Empty file import should fail with KVIDX_ERROR_IO");
+        }
+    }
+
+#ifdef KVIDXKIT_HAS_LMDB
+    TEST("Mapped Import: LMDB replays transactions that fill the map") {
+        char dirname[64];
+        snprintf(dirname, sizeof(dirname), "test-export-mapped-lmdb-%d",
+                 getpid());
+        kvidxExport(i, exportFile, NULL, NULL, NULL);
+
+        kvidxInstance lmdb = {0};
+        lmdb.interface = kvidxInterfaceLmdb;
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbMapSizeBytes = 1024 * 1024;
+        kvidxOpenWithConfig(&lmdb, dirname, &config, NULL);
+
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.commitBytes = 4 * 1024 * 1024;
+        kvidxError e = kvidxImport(&lmdb, exportFile, &options, NULL, NULL);
+        if (e != KVIDX_OK || !sameEntries(i, &lmdb)) {
+            ERR("LMDB import failed: %s", kvidxGetLastErrorMessage(&lmdb));
+        }
+
+        kvidxClose(&lmdb);
+        removeLmdbDir(dirname);
+    }
+#endif
+
+    kvidxClose(&other);
+    kvidxClose(i);
+    cleanupTestFile(exportFile);
+    cleanupTestFile(importDb);
+    cleanupTestFile(dbFile);
+}
+
+/* ====================================================================
+ * TEST SUITE 10: JSON/CSV Import
+ * ==================================================================== */
+static void writeTextFile(const char *filename, const char *text) {
+    FILE *fp = fopen(filename, "wb");
+    fputs(text, fp);
+    fclose(fp);
+}
+
+static bool hasEntry(kvidxInstance *i, uint64_t key, uint64_t term,
+                     uint64_t cmd, const void *expected, size_t expectedLen) {
+    uint64_t gotTerm, gotCmd;
+    const uint8_t *data;
+    size_t len;
+    return kvidxGet(i, key, &gotTerm, &gotCmd, &data, &len) &&
+           gotTerm == term && gotCmd == cmd && len == expectedLen &&
+           memcmp(data, expected, len) == 0;
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testTextImport(uint32_t *err) {
+    char dbFile[128], exportFile[128], importDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "text-db", "sqlite3");
+    makeTestFilename(exportFile, sizeof(exportFile), "text", "txt");
+    makeTestFilename(importDb, sizeof(importDb), "text-import", "sqlite3");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxOpen(i, dbFile, NULL);
+
+    kvidxInstance other = {0};
+    other.interface = kvidxInterfaceSqlite3;
+    kvidxOpen(&other, importDb, NULL);
+
+    /* Every byte value, plus separators at both ends of a long plain run */
+    uint8_t bytes[256];
+    for (int n = 0; n < 256; n++) {
+        bytes[n] = (uint8_t)n;
+    }
+    uint8_t runs[100];
+    memset(runs, 'x', sizeof(runs));
+    runs[0] = '"';
+    runs[40] = ',';
+    runs[41] = '\n';
+    runs[99] = '\\';
+
+    kvidxBegin(i);
+    kvidxInsert(i, 1, 7, 3, bytes, sizeof(bytes));
+    kvidxInsert(i, 2, 8, 4, runs, sizeof(runs));
+    kvidxInsert(i, 3, 9, 5, "", 0);
+    kvidxInsert(i, 4, 10, 6, "a,b \"quoted\"\r\n", 14);
+    kvidxCommit(i);
+
+    TEST("Text Import: JSON and CSV round trips") {
+        static const kvidxExportFormat formats[] = {KVIDX_EXPORT_JSON,
+                                                    KVIDX_EXPORT_CSV};
+        for (size_t f = 0; f < 2; f++) {
+            for (int pretty = 0; pretty < 2; pretty++) {
+                kvidxExportOptions exportOptions = kvidxExportOptionsDefault();
+                exportOptions.format = formats[f];
+                exportOptions.includeMetadata = true;
+                exportOptions.prettyPrint = pretty;
+                kvidxImportOptions options = kvidxImportOptionsDefault();
+                options.clearBeforeImport = true;
+
+                /* Once auto-detected, once with the format given */
+                options.format = pretty ? formats[f] : KVIDX_EXPORT_BINARY;
+                kvidxError e =
+                    kvidxExport(i, exportFile, &exportOptions, NULL, NULL);
+                if (e == KVIDX_OK) {
+                    e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+                }
+                if (e != KVIDX_OK || !sameEntries(i, &other)) {
+                    ERR("Round trip %zu/%d failed: %d %s", f, pretty, e,
+                        kvidxGetLastErrorMessage(&other));
+                }
+            }
+        }
+    }
+
+    TEST("Text Import: Exports without metadata") {
+        kvidxExportOptions exportOptions = kvidxExportOptionsDefault();
+        exportOptions.format = KVIDX_EXPORT_CSV;
+        exportOptions.includeMetadata = false;
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+
+        kvidxError e = kvidxExport(i, exportFile, &exportOptions, NULL, NULL);
+        if (e == KVIDX_OK) {
+            e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+        }
+        if (e != KVIDX_OK || !hasEntry(&other, 1, 0, 0, bytes, 256) ||
+            !hasEntry(&other, 3, 0, 0, "", 0)) {
+            ERR("CSV without metadata failed: %s",
+                kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    TEST("Text Import: Hand-written JSON") {
+        writeTextFile(exportFile,
+                      "\xEF\xBB\xBF [ {\"data\": \"tab\\there \\\"q\\\" "
+                      "\\u00e9\\ud83d\\ude00\\/\", \"key\": \"10\",\n"
+                      "  \"extra\": {\"nested\": [1, -2.5e3, true, null]},"
+                      " \"term\": 2},\n"
+                      "  {\"key\": 11, \"data\": null}, {\"key\": 12} ]\n");
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+
+        kvidxError e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+        const char expected[] = "tab\there \"q\" \xC3\xA9\xF0\x9F\x98\x80/";
+        if (e != KVIDX_OK ||
+            !hasEntry(&other, 10, 2, 0, expected, strlen(expected)) ||
+            !hasEntry(&other, 11, 0, 0, "", 0) ||
+            !hasEntry(&other, 12, 0, 0, "", 0)) {
+            ERR("Hand-written JSON failed: %d %s", e,
+                kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    TEST("Text Import: CSV without a header, CRLF line endings") {
+        writeTextFile(exportFile, "20,plain\r\n21,\"two\r\nlines\"\r\n\r\n"
+                                  "22,\"say \"\"hi\"\"\"\r\n23,\r\n");
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+
+        kvidxError e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+        uint64_t count = 0;
+        kvidxGetKeyCount(&other, &count);
+        if (e != KVIDX_OK || count != 4 ||
+            !hasEntry(&other, 20, 0, 0, "plain", 5) ||
+            !hasEntry(&other, 21, 0, 0, "two\r\nlines", 10) ||
+            !hasEntry(&other, 22, 0, 0, "say \"hi\"", 8) ||
+            !hasEntry(&other, 23, 0, 0, "", 0)) {
+            ERR("Headerless CSV failed: %d %s", e,
+                kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    TEST("Text Import: Malformed input fails and keeps existing data") {
+        static const char *malformed[] = {
+            "{\"entries\":[{\"key\":1,\"data\":\"x\"},{\"key\":2",
+            "[{\"key\":1,\"data\":\"bad \\q escape\"}]",
+            "[{\"key\":-1}]",
+            "[{\"data\":\"no key\"}]",
+            "[{\"key\":99999999999999999999}]",
+            "key,data\n1,\"unterminated\n",
+            "key,data\nabc,x\n",
+            "1,2,3\n"};
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+
+        for (size_t n = 0; n < sizeof(malformed) / sizeof(*malformed); n++) {
+            writeTextFile(exportFile, malformed[n]);
+            kvidxError e =
+                kvidxImport(&other, exportFile, &options, NULL, NULL);
+            if (e != KVIDX_ERROR_CORRUPT ||
+                !hasEntry(&other, 20, 0, 0, "plain", 5)) {
+                ERR("Malformed input %zu: expected CORRUPT, got %d (%s)", n,
+                    e, kvidxGetLastErrorMessage(&other));
+            }
+        }
+    }
+
+    TEST("Text Import: JSON throughput") {
+        kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+        populateSized(i, 20000, 1000);
+
+        kvidxExportOptions exportOptions = kvidxExportOptionsDefault();
+        exportOptions.format = KVIDX_EXPORT_JSON;
+        exportOptions.includeMetadata = true;
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        kvidxError e = kvidxExport(i, exportFile, &exportOptions, NULL, NULL);
+        const double megabytes = (double)getFileSize(exportFile) / 1e6;
+        printf("\texport: %.1f MB/s\n", megabytes / elapsedSeconds(&start));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (e == KVIDX_OK) {
+            e = kvidxImport(&other, exportFile, &options, NULL, NULL);
+        }
+        printf("\timport: %.1f MB/s\n", megabytes / elapsedSeconds(&start));
+
+        if (e != KVIDX_OK || !sameEntries(i, &other)) {
+            ERR("JSON throughput round trip failed: %s",
+                kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    kvidxClose(&other);
+    kvidxClose(i);
+    cleanupTestFile(exportFile);
+    cleanupTestFile(importDb);
+    cleanupTestFile(dbFile);
+}
+
+/* ====================================================================
+ * TEST SUITE 11: Incremental Export
+ * ==================================================================== */
+static void writeKeys(kvidxInstance *i, uint64_t first, uint64_t last,
+                      uint64_t term) {
+    kvidxBegin(i);
+    for (uint64_t key = first; key <= last; key++) {
+        char data[32];
+        snprintf(data, sizeof(data), "value-%" PRIu64 "-%" PRIu64, key, term);
+        kvidxInsertEx(i, key, term, 0, data, strlen(data), KVIDX_SET_ALWAYS);
+    }
+    kvidxCommit(i);
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testIncrementalExport(uint32_t *err) {
+    char dbFile[128], exportFile[128], importDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "incr-db", "sqlite3");
+    makeTestFilename(exportFile, sizeof(exportFile), "incr", "bin");
+    makeTestFilename(importDb, sizeof(importDb), "incr-import", "sqlite3");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxOpen(i, dbFile, NULL);
+    writeKeys(i, 1, 1000, 1);
+
+    kvidxInstance other = {0};
+    other.interface = kvidxInterfaceSqlite3;
+    kvidxOpen(&other, importDb, NULL);
+
+    kvidxExportToken token = {0};
+
+    TEST("Incremental Export: First export is a full export") {
+        kvidxError e = kvidxExportIncremental(i, exportFile, NULL, NULL,
+                                              &token, NULL, NULL);
+        kvidxExportToken stored;
+        if (e != KVIDX_OK || !token.complete || token.entries != 1000 ||
+            token.newKey != 1001 || token.newTerm != 2) {
+            ERR("Full export failed: %d entries=%" PRIu64, e, token.entries);
+        } else if (kvidxReadExportToken(exportFile, &stored) != KVIDX_OK ||
+                   stored.entries != token.entries ||
+                   stored.newKey != token.newKey ||
+                   stored.newTerm != token.newTerm || !stored.complete) {
+            ERRR("Token in the header differs from the returned token");
+        }
+
+        e = kvidxImport(&other, exportFile, NULL, NULL, NULL);
+        if (e != KVIDX_OK || !sameEntries(i, &other)) {
+            ERR("Import failed: %s", kvidxGetLastErrorMessage(&other));
+        }
+    }
+
+    TEST("Incremental Export: Next export holds only new and changed keys") {
+        const size_t fullSize = getFileSize(exportFile);
+        writeKeys(i, 1001, 1100, 2);
+        writeKeys(i, 10, 19, 2);
+
+        kvidxExportToken next;
+        kvidxError e = kvidxExportIncremental(i, exportFile, NULL, &token,
+                                              &next, NULL, NULL);
+        if (e != KVIDX_OK || next.entries != 110 || !next.complete ||
+            next.newKey != 1101 || next.newTerm != 3) {
+            ERR("Incremental export failed: %d entries=%" PRIu64, e,
+                next.entries);
+        }
+        if (getFileSize(exportFile) * 5 > fullSize) {
+            ERR("Incremental export too large: %zu of %zu bytes",
+                getFileSize(exportFile), fullSize);
+        }
+
+        /* Changed keys overwrite the ones imported earlier */
+        e = kvidxImport(&other, exportFile, NULL, NULL, NULL);
+        if (e != KVIDX_OK || !sameEntries(i, &other)) {
+            ERR("Incremental import failed: %s",
+                kvidxGetLastErrorMessage(&other));
+        }
+        token = next;
+    }
+
+    TEST("Incremental Export: Append-only export scans only new keys") {
+        writeKeys(i, 1101, 1150, 2);
+        writeKeys(i, 5, 5, 9); /* Skipped: appendOnly promises no rewrites */
+
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.appendOnly = true;
+        kvidxExportToken next;
+        kvidxError e = kvidxExportIncremental(i, exportFile, &options, &token,
+                                              &next, NULL, NULL);
+        if (e != KVIDX_OK || next.entries != 50 || next.newKey != 1151) {
+            ERR("Append-only export failed: %d entries=%" PRIu64, e,
+                next.entries);
+        }
+        writeKeys(i, 5, 5, 1);
+        kvidxImport(&other, exportFile, NULL, NULL, NULL);
+        if (!sameEntries(i, &other)) {
+            ERRR("Append-only import differs");
+        }
+    }
+
+    TEST("Incremental Export: Cancelled export resumes from its token") {
+        kvidxImportOptions clear = kvidxImportOptionsDefault();
+        clear.clearBeforeImport = true;
+        kvidxError e = kvidxImport(&other, exportFile, &clear, NULL, NULL);
+
+        kvidxExportToken piece = {0};
+        const kvidxExportToken *since = NULL;
+        uint64_t pieces = 0, exported = 0;
+        do {
+            e = kvidxExportIncremental(i, exportFile, NULL, since, &piece,
+                                       cancelAfterFirst, NULL);
+            kvidxExportToken stored;
+            if (kvidxReadExportToken(exportFile, &stored) != KVIDX_OK ||
+                stored.complete != piece.complete ||
+                stored.nextKey != piece.nextKey) {
+                ERRR("Header token differs from the returned token");
+                break;
+            }
+            if (kvidxImport(&other, exportFile, NULL, NULL, NULL) !=
+                KVIDX_OK) {
+                ERR("Importing piece %" PRIu64 " failed: %s", pieces,
+                    kvidxGetLastErrorMessage(&other));
+                break;
+            }
+            exported += piece.entries;
+            pieces++;
+            since = &piece;
+        } while (e == KVIDX_ERROR_CANCELLED && pieces < 100);
+
+        /* Every 100 scanned entries the callback cancels */
+        if (e != KVIDX_OK || pieces != 12 || exported != 1150 ||
+            !sameEntries(i, &other)) {
+            ERR("Resumed export failed: %d after %" PRIu64 " pieces", e,
+                pieces);
+        }
+    }
+
+    TEST("Incremental Export: Text formats are rejected") {
+        kvidxExportOptions options = kvidxExportOptionsDefault();
+        options.format = KVIDX_EXPORT_JSON;
+        if (kvidxExportIncremental(i, exportFile, &options, NULL, NULL, NULL,
+                                   NULL) != KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("JSON incremental export should be rejected");
+        }
+    }
+
+    kvidxClose(&other);
+    kvidxClose(i);
+    cleanupTestFile(exportFile);
+    cleanupTestFile(importDb);
+    cleanupTestFile(dbFile);
+}
+
 /* ====================================================================
  * MAIN TEST RUNNER
  * ==================================================================== */
+/* ====================================================================
+ * TEST SUITE 12: Storage Replication
+ * ==================================================================== */
+
+/* Copy src's storage into a memory buffer and install it into dst */
+static kvidxError replicate(kvidxInstance *src, kvidxInstance *dst,
+                            memorySink *sink) {
+    kvidxError e = kvidxCopyStorageForReplication(src, memorySinkWrite, sink);
+    if (e != KVIDX_OK) {
+        return e;
+    }
+    memorySource source = {.buf = sink->buf, .len = sink->len};
+    return kvidxReceiveStorageForReplication(dst, memorySourceRead, &source);
+}
+
+/* True if sub received exactly one RESET over every key */
+static bool sawReset(kvidxSubscription *sub) {
+    kvidxChange changes[2];
+    const size_t n = kvidxSubscriptionPoll(sub, changes, 2);
+    return n == 1 && changes[0].type == KVIDX_CHANGE_RESET &&
+           changes[0].key == 0 && changes[0].endKey == UINT64_MAX &&
+           changes[0].lastInCommit;
+}
+
+/* Bitwise CRC-32C, matching the checksum replication streams carry */
+static uint32_t testCrc32c(const uint8_t *buf, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t n = 0; n < len; n++) {
+        crc ^= buf[n];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* Well-formed SQLite replication stream whose database file is garbage */
+static void unopenableSnapshot(memorySink *sink) {
+    struct {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        char format[16];
+    } header = {.magic = 0x504552584449564BULL, .version = 1};
+    strcpy(header.format, "sqlite3");
+    memorySinkWrite(&header, sizeof(header), sink);
+
+    const char name[] = "kvidx.sqlite3";
+    uint8_t file[4096];
+    memset(file, 0xA5, sizeof(file));
+    const uint32_t nameLen = sizeof(name) - 1;
+    const uint32_t fileLen = sizeof(file);
+    const uint32_t crc = testCrc32c(file, sizeof(file));
+    const uint32_t end = 0;
+    memorySinkWrite(&nameLen, sizeof(nameLen), sink);
+    memorySinkWrite(name, nameLen, sink);
+    memorySinkWrite(&fileLen, sizeof(fileLen), sink);
+    memorySinkWrite(file, sizeof(file), sink);
+    memorySinkWrite(&end, sizeof(end), sink);
+    memorySinkWrite(&crc, sizeof(crc), sink);
+    memorySinkWrite(&end, sizeof(end), sink);
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testReplication(uint32_t *err) {
+    char dbFile[128], replicaDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "repl-db", "sqlite3");
+    makeTestFilename(replicaDb, sizeof(replicaDb), "repl-replica", "sqlite3");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxOpen(i, dbFile, NULL);
+    populateSized(i, 5000, 500);
+
+    /* The replica starts with entries the snapshot must replace */
+    kvidxInstance replica = {0};
+    replica.interface = kvidxInterfaceSqlite3;
+    kvidxConfig replicaConfig = kvidxConfigDefault();
+    replicaConfig.sqliteBackupPagesPerStep = 16;
+    kvidxOpenWithConfig(&replica, replicaDb, &replicaConfig, NULL);
+    writeKeys(&replica, 4000, 9000, 7);
+
+    TEST("Replication: SQLite snapshot replaces the replica") {
+        memorySink sink = {0};
+        kvidxError e = replicate(i, &replica, &sink);
+        if (e != KVIDX_OK || !sameEntries(i, &replica)) {
+            ERR("SQLite replication failed: %s",
+                kvidxGetLastErrorMessage(&replica));
+        }
+
+        /* Reopened with its own configuration and writable */
+        kvidxConfig config;
+        kvidxGetConfig(&replica, &config);
+        if (config.sqliteBackupPagesPerStep != 16 ||
+            !kvidxInsert(&replica, 10000, 1, 0, "new", 3)) {
+            ERRR("Replica not reopened with its configuration");
+        }
+        kvidxRemove(&replica, 10000);
+        free(sink.buf);
+    }
+
+    TEST("Replication: Subscribers see the install as a reset") {
+        kvidxSubscription *sub = kvidxSubscribe(&replica, 0);
+        memorySink sink = {0};
+        if (replicate(i, &replica, &sink) != KVIDX_OK || !sawReset(sub)) {
+            ERRR("Installed snapshot was not reported as a reset");
+        }
+        kvidxUnsubscribe(&replica, sub);
+        free(sink.buf);
+    }
+
+    TEST("Replication: Corrupt snapshot leaves the replica untouched") {
+        memorySink sink = {0};
+        kvidxCopyStorageForReplication(i, memorySinkWrite, &sink);
+        writeKeys(&replica, 20000, 20010, 9);
+
+        sink.buf[sink.len / 2] ^= 0xFF;
+        memorySource source = {.buf = sink.buf, .len = sink.len};
+        kvidxError e = kvidxReceiveStorageForReplication(
+            &replica, memorySourceRead, &source);
+        if (e != KVIDX_ERROR_CORRUPT || !kvidxExists(&replica, 20005)) {
+            ERR("Corrupt snapshot installed: %d", e);
+        }
+
+        /* Truncated streams fail the same way */
+        source = (memorySource){.buf = sink.buf, .len = sink.len - 100};
+        e = kvidxReceiveStorageForReplication(&replica, memorySourceRead,
+                                              &source);
+        if (e != KVIDX_ERROR_IO || !kvidxExists(&replica, 20005)) {
+            ERR("Truncated snapshot installed: %d", e);
+        }
+        free(sink.buf);
+    }
+
+    TEST("Replication: Snapshot that fails to open restores the replica") {
+        writeKeys(&replica, 30000, 30010, 11);
+        memorySink sink = {0};
+        unopenableSnapshot(&sink);
+        memorySource source = {.buf = sink.buf, .len = sink.len};
+        kvidxError e = kvidxReceiveStorageForReplication(
+            &replica, memorySourceRead, &source);
+        if (e != KVIDX_ERROR_IO || !kvidxExists(&replica, 30005)) {
+            ERR("Replica lost after a failed reopen: %d", e);
+        }
+
+        /* The restored replica still takes writes */
+        writeKeys(&replica, 30011, 30011, 11);
+        if (!kvidxExists(&replica, 30011)) {
+            ERRR("Restored replica refused a write");
+        }
+        free(sink.buf);
+    }
+
+    TEST("Replication: In-memory SQLite copies through $TMPDIR") {
+        kvidxInstance mem = {0};
+        mem.interface = kvidxInterfaceSqlite3;
+        kvidxOpen(&mem, ":memory:", NULL);
+        writeKeys(&mem, 1, 100, 3);
+
+        const char *saved = getenv("TMPDIR");
+        char *savedCopy = saved ? strdup(saved) : NULL;
+        memorySink sink = {0};
+        setenv("TMPDIR", "test-export-no-such-dir", 1);
+        if (kvidxCopyStorageForReplication(&mem, memorySinkWrite, &sink) ==
+            KVIDX_OK) {
+            ERRR("Copy ignored $TMPDIR");
+        }
+
+        setenv("TMPDIR", ".", 1);
+        free(sink.buf);
+        sink = (memorySink){0};
+        if (kvidxCopyStorageForReplication(&mem, memorySinkWrite, &sink) !=
+            KVIDX_OK) {
+            ERR("Copy through $TMPDIR failed: %s",
+                kvidxGetLastErrorMessage(&mem));
+        }
+
+        if (savedCopy) {
+            setenv("TMPDIR", savedCopy, 1);
+        } else {
+            unsetenv("TMPDIR");
+        }
+        free(savedCopy);
+        free(sink.buf);
+        kvidxClose(&mem);
+    }
+
+    TEST("Replication: Copy is refused inside a transaction") {
+        memorySink sink = {0};
+        kvidxBegin(i);
+        if (kvidxCopyStorageForReplication(i, memorySinkWrite, &sink) !=
+            KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("Copy started inside a transaction");
+        }
+        kvidxCommit(i);
+        free(sink.buf);
+    }
+
+#ifdef KVIDXKIT_HAS_LMDB
+    TEST("Replication: LMDB snapshot, plain and compacted") {
+        char sourceDir[64], replicaDir[64];
+        snprintf(sourceDir, sizeof(sourceDir), "test-export-repl-lmdb-%d",
+                 getpid());
+        snprintf(replicaDir, sizeof(replicaDir),
+                 "test-export-repl-lmdb-replica-%d", getpid());
+
+        kvidxInstance source = {0};
+        source.interface = kvidxInterfaceLmdb;
+        kvidxConfig config = kvidxConfigDefault();
+        kvidxOpenWithConfig(&source, sourceDir, &config, NULL);
+        populateSized(&source, 5000, 500);
+        kvidxRemoveRange(&source, 1, 2500, true, true, NULL);
+
+        kvidxInstance lmdbReplica = {0};
+        lmdbReplica.interface = kvidxInterfaceLmdb;
+        kvidxOpen(&lmdbReplica, replicaDir, NULL);
+        writeKeys(&lmdbReplica, 1, 100, 3);
+
+        memorySink plain = {0};
+        kvidxError e = replicate(&source, &lmdbReplica, &plain);
+        if (e != KVIDX_OK || !sameEntries(&source, &lmdbReplica)) {
+            ERR("LMDB replication failed: %s",
+                kvidxGetLastErrorMessage(&lmdbReplica));
+        }
+
+        /* Compaction drops the pages freed by the removal */
+        config.lmdbCompactCopy = true;
+        kvidxUpdateConfig(&source, &config);
+        memorySink compact = {0};
+        e = replicate(&source, &lmdbReplica, &compact);
+        if (e != KVIDX_OK || !sameEntries(&source, &lmdbReplica) ||
+            compact.len >= plain.len) {
+            ERR("Compacted LMDB replication failed: %zu vs %zu bytes",
+                compact.len, plain.len);
+        }
+
+        /* A snapshot only installs into the adapter that made it */
+        memorySource wrong = {.buf = compact.buf, .len = compact.len};
+        if (kvidxReceiveStorageForReplication(i, memorySourceRead, &wrong) !=
+            KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("LMDB snapshot accepted by SQLite");
+        }
+
+        free(plain.buf);
+        free(compact.buf);
+        kvidxClose(&lmdbReplica);
+        kvidxClose(&source);
+        removeLmdbDir(replicaDir);
+        removeLmdbDir(sourceDir);
+    }
+#endif
+
+#ifdef KVIDXKIT_HAS_MEMORY
+    TEST("Replication: Adapters without a native copy send an export") {
+        kvidxInstance memory = {0};
+        memory.interface = kvidxInterfaceMemory;
+        kvidxOpen(&memory, NULL, NULL);
+        writeKeys(&memory, 1, 3000, 5);
+
+        memorySink sink = {0};
+        kvidxError e = replicate(&memory, &replica, &sink);
+        if (e != KVIDX_OK || !sameEntries(&memory, &replica)) {
+            ERR("Export replication failed: %s",
+                kvidxGetLastErrorMessage(&replica));
+        }
+        free(sink.buf);
+        kvidxClose(&memory);
+    }
+#endif
+
+    kvidxClose(&replica);
+    kvidxClose(i);
+    cleanupTestFile(replicaDb);
+    cleanupTestFile(dbFile);
+}
+
+/* ====================================================================
+ * TEST SUITE 13: Snapshot Install (kvidxReplaceAll)
+ * ==================================================================== */
+
+/* Export src as a binary stream into a memory buffer and install it in dst */
+static kvidxError replaceAllFrom(kvidxInstance *src, kvidxInstance *dst,
+                                 memorySink *sink) {
+    kvidxError e =
+        kvidxExportToStream(src, memorySinkWrite, sink, NULL, NULL, NULL);
+    if (e != KVIDX_OK) {
+        return e;
+    }
+    memorySource source = {.buf = sink->buf, .len = sink->len};
+    return kvidxReplaceAll(dst, memorySourceRead, &source);
+}
+
+/* cppcheck-suppress constParameterPointer */
+static void testReplaceAll(uint32_t *err) {
+    char dbFile[128], replicaDb[128];
+    makeTestFilename(dbFile, sizeof(dbFile), "replace-db", "sqlite3");
+    makeTestFilename(replicaDb, sizeof(replicaDb), "replace-replica",
+                     "sqlite3");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxOpen(i, dbFile, NULL);
+    populateSized(i, 5000, 500);
+
+    /* The replica holds keys on both sides of the snapshot's range */
+    kvidxInstance replica = {0};
+    replica.interface = kvidxInterfaceSqlite3;
+    kvidxConfig replicaConfig = kvidxConfigDefault();
+    replicaConfig.sqliteBackupPagesPerStep = 16;
+    kvidxOpenWithConfig(&replica, replicaDb, &replicaConfig, NULL);
+    writeKeys(&replica, 4000, 9000, 7);
+
+    TEST("Snapshot Install: SQLite replaces every entry") {
+        memorySink sink = {0};
+        kvidxError e = replaceAllFrom(i, &replica, &sink);
+        if (e != KVIDX_OK || !sameEntries(i, &replica)) {
+            ERR("SQLite replace failed: %s",
+                kvidxGetLastErrorMessage(&replica));
+        }
+
+        /* Reopened with its own configuration, journaled and writable */
+        kvidxConfig config;
+        kvidxGetConfig(&replica, &config);
+        if (config.sqliteBackupPagesPerStep != 16 ||
+            config.journalMode != KVIDX_JOURNAL_WAL ||
+            !kvidxInsert(&replica, 10000, 1, 0, "new", 3)) {
+            ERRR("Replica not reopened with its configuration");
+        }
+        kvidxRemove(&replica, 10000);
+        free(sink.buf);
+    }
+
+    TEST("Snapshot Install: Subscribers see the install as a reset") {
+        kvidxSubscription *sub = kvidxSubscribe(&replica, 0);
+        memorySink sink = {0};
+        if (replaceAllFrom(i, &replica, &sink) != KVIDX_OK || !sawReset(sub)) {
+            ERRR("Installed snapshot was not reported as a reset");
+        }
+
+        /* Bad streams change nothing and report nothing */
+        memorySource garbage = {.buf = (const uint8_t *)"not an export",
+                                .len = 13};
+        kvidxChange change;
+        if (kvidxReplaceAll(&replica, memorySourceRead, &garbage) ==
+                KVIDX_OK ||
+            kvidxSubscriptionPoll(sub, &change, 1) != 0) {
+            ERRR("Failed install was reported");
+        }
+        kvidxUnsubscribe(&replica, sub);
+        free(sink.buf);
+    }
+
+    TEST("Snapshot Install: Bad stream leaves the entries untouched") {
+        memorySink sink = {0};
+        kvidxExportToStream(i, memorySinkWrite, &sink, NULL, NULL, NULL);
+        writeKeys(&replica, 20000, 20010, 9);
+
+        memorySource source = {.buf = sink.buf, .len = sink.len - 100};
+        kvidxError e = kvidxReplaceAll(&replica, memorySourceRead, &source);
+        if (e == KVIDX_OK || !kvidxExists(&replica, 20005) ||
+            !kvidxExists(&replica, 1)) {
+            ERR("Truncated stream installed: %d", e);
+        }
+
+        memorySource garbage = {.buf = (const uint8_t *)"not an export",
+                                .len = 13};
+        e = kvidxReplaceAll(&replica, memorySourceRead, &garbage);
+        if (e == KVIDX_OK || !kvidxExists(&replica, 20005)) {
+            ERR("Garbage stream installed: %d", e);
+        }
+        free(sink.buf);
+    }
+
+    TEST("Snapshot Install: Refused inside a transaction") {
+        memorySink sink = {0};
+        kvidxExportToStream(i, memorySinkWrite, &sink, NULL, NULL, NULL);
+        memorySource source = {.buf = sink.buf, .len = sink.len};
+
+        kvidxBegin(&replica);
+        if (kvidxReplaceAll(&replica, memorySourceRead, &source) !=
+                KVIDX_ERROR_INVALID_ARGUMENT ||
+            source.pos != 0) {
+            ERRR("Replace started inside a transaction");
+        }
+        kvidxCommit(&replica);
+        free(sink.buf);
+    }
+
+#ifdef KVIDXKIT_HAS_LMDB
+    TEST("Snapshot Install: LMDB replaces every entry") {
+        char lmdbDir[64];
+        snprintf(lmdbDir, sizeof(lmdbDir), "test-export-replace-lmdb-%d",
+                 getpid());
+
+        kvidxInstance lmdb = {0};
+        lmdb.interface = kvidxInterfaceLmdb;
+        kvidxOpen(&lmdb, lmdbDir, NULL);
+        writeKeys(&lmdb, 1, 100, 3);
+        writeKeys(&lmdb, 6000, 6100, 3);
+
+        memorySink sink = {0};
+        kvidxError e = replaceAllFrom(i, &lmdb, &sink);
+        if (e != KVIDX_OK || !sameEntries(i, &lmdb) ||
+            !kvidxInsert(&lmdb, 10000, 1, 0, "new", 3)) {
+            ERR("LMDB replace failed: %s", kvidxGetLastErrorMessage(&lmdb));
+        }
+
+        free(sink.buf);
+        kvidxClose(&lmdb);
+        removeLmdbDir(lmdbDir);
+    }
+#endif
+
+#ifdef KVIDXKIT_HAS_MEMORY
+    TEST("Snapshot Install: Other adapters import in one transaction") {
+        kvidxInstance memory = {0};
+        memory.interface = kvidxInterfaceMemory;
+        kvidxOpen(&memory, NULL, NULL);
+        writeKeys(&memory, 1, 3000, 5);
+        writeKeys(&memory, 7000, 7100, 5);
+
+        memorySink sink = {0};
+        kvidxError e = replaceAllFrom(i, &memory, &sink);
+        if (e != KVIDX_OK || !sameEntries(i, &memory)) {
+            ERR("Memory replace failed: %s",
+                kvidxGetLastErrorMessage(&memory));
+        }
+        free(sink.buf);
+        kvidxClose(&memory);
+    }
+#endif
+
+    kvidxClose(&replica);
+    kvidxClose(i);
+    cleanupTestFile(replicaDb);
+    cleanupTestFile(dbFile);
+}
+
 int main(int argc, char *argv[]) {
     (void)argc;
     (void)argv;
@@ -621,6 +2071,41 @@ int main(int argc, char *argv[]) {
     testExportImportErrors(&err);
     printf("\n");
 
+    printf("Running Suite 7: Streaming Export/Import\n");
+    printf("-------------------------------------------------------\n");
+    testStreaming(&err);
+    printf("\n");
+
+    printf("Running Suite 8: Block Layout (Binary v2)\n");
+    printf("-------------------------------------------------------\n");
+    testBlockLayout(&err);
+    printf("\n");
+
+    printf("Running Suite 9: Mapped Import\n");
+    printf("-------------------------------------------------------\n");
+    testMappedImport(&err);
+    printf("\n");
+
+    printf("Running Suite 10: JSON/CSV Import\n");
+    printf("-------------------------------------------------------\n");
+    testTextImport(&err);
+    printf("\n");
+
+    printf("Running Suite 11: Incremental Export\n");
+    printf("-------------------------------------------------------\n");
+    testIncrementalExport(&err);
+    printf("\n");
+
+    printf("Running Suite 12: Storage Replication\n");
+    printf("-------------------------------------------------------\n");
+    testReplication(&err);
+    printf("\n");
+
+    printf("Running Suite 13: Snapshot Install\n");
+    printf("-------------------------------------------------------\n");
+    testReplaceAll(&err);
+    printf("\n");
+
     printf("=======================================================\n");
     if (err == 0) {
         printf("ALL EXPORT/IMPORT TESTS PASSED!\n");
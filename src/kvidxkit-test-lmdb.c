@@ -53,6 +53,13 @@ static int removeDir(const char *path) {
     return rmdir(path);
 }
 
+/* Records the usage reported by the LMDB map fill warning */
+static void mapWarning(uint64_t usedBytes, uint64_t limitBytes,
+                       void *userData) {
+    (void)limitBytes;
+    *(uint64_t *)userData = usedBytes;
+}
+
 int main(int argc, char *argv[]) {
     (void)argc;
     (void)argv;
@@ -605,6 +612,9 @@ int main(int argc, char *argv[]) {
         char exportFile[64] = {0};
         snprintf(exportFile, sizeof(exportFile), "test-lmdb-export-%d.bin",
                  getpid());
+        char blockFile[64] = {0};
+        snprintf(blockFile, sizeof(blockFile), "test-lmdb-blocks-%d.bin",
+                 getpid());
 
         printf("\nTesting LMDB export/import in: %s\n", dirname);
         kvidxOpen(i, dirname, NULL);
@@ -626,6 +636,33 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        TEST("LMDB block export with parallel readers...") {
+            kvidxExportOptions opts = kvidxExportOptionsDefault();
+            opts.binaryVersion = KVIDX_BINARY_VERSION_BLOCKS;
+            opts.threads = 4;
+            kvidxError err = kvidxExport(i, blockFile, &opts, NULL, NULL);
+            if (err != KVIDX_OK) {
+                ERR("Block export failed: %s", kvidxGetLastErrorMessage(i));
+            }
+        }
+
+        TEST("LMDB reader keeps its snapshot across writes...") {
+            kvidxInstance reader = {0};
+            if (!i->interface.openReader(i, &reader)) {
+                ERRR("Failed to open reader!");
+            } else {
+                kvidxInsert(i, 600, 6, 12, "Value-6", 7);
+
+                uint64_t count = 0;
+                kvidxGetKeyCount(&reader, &count);
+                if (count != 5 || kvidxExists(&reader, 600)) {
+                    ERR("Reader saw a later write (%" PRIu64 " keys)", count);
+                }
+                reader.interface.close(&reader);
+                kvidxRemove(i, 600);
+            }
+        }
+
         kvidxClose(i);
 
         /* Open a new database and import */
@@ -668,10 +705,30 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        TEST("LMDB import block export...") {
+            kvidxImportOptions opts = kvidxImportOptionsDefault();
+            opts.clearBeforeImport = true;
+            opts.threads = 4;
+            kvidxError err = kvidxImport(i2, blockFile, &opts, NULL, NULL);
+            if (err != KVIDX_OK) {
+                ERR("Block import failed: %s", kvidxGetLastErrorMessage(i2));
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i2, &count);
+            const uint8_t *data;
+            size_t len;
+            if (count != 5 || !kvidxGet(i2, 500, NULL, NULL, &data, &len) ||
+                len != 7 || memcmp(data, "Value-5", 7) != 0) {
+                ERR("Block import mismatch (%" PRIu64 " keys)", count);
+            }
+        }
+
         kvidxClose(i2);
         removeDir(dirname);
         removeDir(dirname2);
         unlink(exportFile);
+        unlink(blockFile);
     }
 
     /* ================================================================
@@ -775,6 +832,693 @@ int main(int argc, char *argv[]) {
         removeDir(dirname);
     }
 
+    /* ================================================================
+     * Value Format v2 (Inline TTL) Tests
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-inlinettl-%d",
+                 getpid());
+
+        printf("\nTesting LMDB inline TTL value format in: %s\n", dirname);
+        kvidxOpen(i, dirname, NULL);
+
+        TEST("LMDB v2 TTL keeps term/cmd/data intact...") {
+            kvidxInsert(i, 1, 7, 9, "hello", 5);
+            if (kvidxSetExpire(i, 1, 60000) != KVIDX_OK) {
+                ERRR("SetExpire failed!");
+            }
+
+            uint64_t term, cmd;
+            const uint8_t *data;
+            size_t len;
+            if (!kvidxGet(i, 1, &term, &cmd, &data, &len)) {
+                ERRR("Key 1 not found after SetExpire!");
+            } else if (term != 7 || cmd != 9 || len != 5 ||
+                       memcmp(data, "hello", 5) != 0) {
+                ERR("Record changed by SetExpire: term=%" PRIu64
+                    " cmd=%" PRIu64 " len=%zu",
+                    term, cmd, len);
+            }
+
+            int64_t ttl = kvidxGetTTL(i, 1);
+            if (ttl < 50000 || ttl > 60000) {
+                ERR("TTL should be ~60000ms, got %" PRId64, ttl);
+            }
+
+            uint64_t bytes = 0;
+            kvidxGetDataSize(i, &bytes);
+            if (bytes != 5) {
+                ERR("Data size should exclude TTL header, got %" PRIu64,
+                    bytes);
+            }
+        }
+
+        TEST("LMDB v2 append preserves inline TTL...") {
+            size_t newLen = 0;
+            kvidxAppend(i, 1, 7, 9, " world", 6, &newLen);
+            if (newLen != 11) {
+                ERR("Append length should be 11, got %zu", newLen);
+            }
+
+            int64_t ttl = kvidxGetTTL(i, 1);
+            if (ttl < 50000 || ttl > 60000) {
+                ERR("TTL should survive append, got %" PRId64, ttl);
+            }
+        }
+
+        TEST("LMDB v2 persist clears inline TTL...") {
+            if (kvidxPersist(i, 1) != KVIDX_OK) {
+                ERRR("Persist failed!");
+            }
+            if (kvidxGetTTL(i, 1) != KVIDX_TTL_NONE) {
+                ERRR("TTL should be NONE after persist!");
+            }
+
+            const uint8_t *data;
+            size_t len;
+            kvidxGet(i, 1, NULL, NULL, &data, &len);
+            if (len != 11 || memcmp(data, "hello world", 11) != 0) {
+                ERRR("Data changed by Persist!");
+            }
+        }
+
+        TEST("LMDB v2 overwrite drops TTL and stale index entry...") {
+            kvidxInsert(i, 2, 1, 1, "old", 3);
+            kvidxSetExpire(i, 2, 60000);
+            kvidxInsertEx(i, 2, 2, 2, "new", 3, KVIDX_SET_ALWAYS);
+            if (kvidxGetTTL(i, 2) != KVIDX_TTL_NONE) {
+                ERRR("Overwritten key should have no TTL!");
+            }
+
+            /* Remove leaves the index entry behind; re-insert must win */
+            kvidxSetExpireAt(i, 2, 1000); /* Long expired */
+            kvidxRemove(i, 2);
+            kvidxInsert(i, 2, 3, 3, "fresh", 5);
+
+            uint64_t expired = 99;
+            kvidxExpireScan(i, 0, &expired);
+            if (expired != 0) {
+                ERR("Stale TTL index must not expire key, got %" PRIu64,
+                    expired);
+            }
+            if (!kvidxExists(i, 2)) {
+                ERRR("Overwritten key 2 was wrongly expired!");
+            }
+        }
+
+        TEST("LMDB v2 ExpireScan removes expired keys...") {
+            kvidxInsert(i, 3, 1, 1, "bye", 3);
+            kvidxSetExpireAt(i, 3, 1000);
+
+            if (kvidxGetTTL(i, 3) != 0) {
+                ERRR("Expired key should report TTL 0!");
+            }
+
+            uint64_t expired = 0;
+            kvidxExpireScan(i, 0, &expired);
+            if (expired != 1) {
+                ERR("Expected 1 expired key, got %" PRIu64, expired);
+            }
+            if (kvidxExists(i, 3)) {
+                ERRR("Expired key 3 should be gone!");
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-format-v1-%d", getpid());
+
+        printf("\nTesting LMDB v1 value format compatibility in: %s\n",
+               dirname);
+
+        TEST("LMDB v1 environment keeps its format across reopen...") {
+            kvidxConfig config = kvidxConfigDefault();
+            config.lmdbValueFormat = 1;
+            if (!kvidxOpenWithConfig(i, dirname, &config, NULL)) {
+                ERRR("Failed to open v1 environment!");
+            }
+            kvidxInsert(i, 5, 3, 4, "legacy", 6);
+            kvidxSetExpire(i, 5, 60000);
+            kvidxClose(i);
+
+            /* Default config would pick v2 for a new env; this one is v1 */
+            kvidxInstance pre2 = {0};
+            kvidxInstance *i2 = &pre2;
+            i2->interface = kvidxInterfaceLmdb;
+            kvidxOpen(i2, dirname, NULL);
+
+            uint64_t term, cmd;
+            const uint8_t *data;
+            size_t len;
+            if (!kvidxGet(i2, 5, &term, &cmd, &data, &len)) {
+                ERRR("Key 5 not found after reopen!");
+            } else if (term != 3 || cmd != 4 || len != 6 ||
+                       memcmp(data, "legacy", 6) != 0) {
+                ERRR("v1 record misread after reopen!");
+            }
+
+            int64_t ttl = kvidxGetTTL(i2, 5);
+            if (ttl < 50000 || ttl > 60000) {
+                ERR("v1 TTL should be ~60000ms, got %" PRId64, ttl);
+            }
+
+            kvidxClose(i2);
+        }
+
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Map Growth Tests
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-mapgrow-%d", getpid());
+
+        printf("\nTesting LMDB map growth in: %s\n", dirname);
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbMapSizeBytes = 1 << 20; /* 1 MB */
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        static uint8_t value[4096];
+        memset(value, 0x5A, sizeof(value));
+
+        TEST("LMDB auto-commit writes grow a small map...") {
+            for (uint64_t k = 1; k <= 2048; k++) {
+                if (!kvidxInsert(i, k, 1, 1, value, sizeof(value))) {
+                    ERR("Insert %" PRIu64 " failed: %s", k,
+                        kvidxGetLastErrorMessage(i));
+                    break;
+                }
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 2048) {
+                ERR("Expected 2048 keys, got %" PRIu64, count);
+            }
+        }
+
+        TEST("LMDB explicit txn succeeds on retry after map full...") {
+            /* 32 MB batch: more than the headroom of the grown map */
+            bool committed = false;
+            bool sawDiskFull = false;
+            for (int attempt = 0; attempt < 8 && !committed; attempt++) {
+                kvidxBegin(i);
+                for (uint64_t k = 10000; k < 10000 + 8192; k++) {
+                    if (!kvidxInsert(i, k, 1, 1, value, sizeof(value))) {
+                        break;
+                    }
+                }
+                committed = kvidxCommit(i);
+                if (!committed) {
+                    if (kvidxGetLastError(i) != KVIDX_ERROR_DISK_FULL) {
+                        ERR("Failed commit should report DISK_FULL, got %d",
+                            kvidxGetLastError(i));
+                        break;
+                    }
+                    sawDiskFull = true;
+                }
+            }
+
+            if (!sawDiskFull) {
+                ERRR("Batch should have overflowed the map at least once!");
+            }
+            if (!committed) {
+                ERRR("Batch never committed after map growth!");
+            }
+            if (!kvidxExists(i, 10000 + 8191)) {
+                ERRR("Last key of batch missing!");
+            }
+        }
+
+        TEST("LMDB single value larger than the map is retried...") {
+            size_t bigLen = 64 << 20; /* Far beyond current headroom */
+            uint8_t *big = calloc(1, bigLen);
+            if (!kvidxInsert(i, 5000, 1, 1, big, bigLen)) {
+                ERR("Large insert not retried: %s",
+                    kvidxGetLastErrorMessage(i));
+            }
+            free(big);
+
+            size_t len = 0;
+            kvidxGet(i, 5000, NULL, NULL, NULL, &len);
+            if (len != bigLen) {
+                ERR("Large value length mismatch: %zu", len);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-mapbatch-%d",
+                 getpid());
+
+        printf("\nTesting LMDB batch insert map growth in: %s\n", dirname);
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbMapSizeBytes = 1 << 20; /* 1 MB */
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        static uint8_t value[4096];
+        memset(value, 0x3C, sizeof(value));
+        /* Each value takes two overflow pages: 1.5 MB, more than the map */
+        static kvidxEntry entries[192];
+        for (size_t n = 0; n < sizeof(entries) / sizeof(*entries); n++) {
+            entries[n] = (kvidxEntry){.key = n + 1,
+                                      .term = 1,
+                                      .cmd = 1,
+                                      .data = value,
+                                      .dataLen = sizeof(value)};
+        }
+
+        TEST("LMDB batch insert is retried after filling the map...") {
+            const size_t count = sizeof(entries) / sizeof(*entries);
+            size_t inserted = 0;
+            if (!kvidxInsertBatch(i, entries, count, &inserted)) {
+                ERR("Batch insert failed: %s", kvidxGetLastErrorMessage(i));
+            }
+            if (inserted != count) {
+                ERR("Expected %zu inserted, got %zu", count, inserted);
+            }
+
+            uint64_t keys = 0;
+            kvidxGetKeyCount(i, &keys);
+            if (keys != count) {
+                ERR("Expected %zu keys, got %" PRIu64, count, keys);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-mapcap-%d", getpid());
+
+        printf("\nTesting LMDB map growth ceiling in: %s\n", dirname);
+
+        uint64_t warnedUsed = 0;
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbMapSizeBytes = 1 << 20;    /* 1 MB */
+        config.lmdbMaxMapSizeBytes = 4 << 20; /* 4 MB */
+        config.lmdbMapWarning = mapWarning;
+        config.lmdbMapWarningUserData = &warnedUsed;
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        static uint8_t value[4096];
+
+        TEST("LMDB map stops growing at the configured ceiling...") {
+            bool failed = false;
+            for (uint64_t k = 1; k <= 4096; k++) {
+                if (!kvidxInsert(i, k, 1, 1, value, sizeof(value))) {
+                    failed = true;
+                    break;
+                }
+            }
+
+            if (!failed) {
+                ERRR("Inserts should fail once the ceiling is reached!");
+            }
+            if (kvidxGetLastError(i) != KVIDX_ERROR_DISK_FULL) {
+                ERR("Expected DISK_FULL at ceiling, got %d",
+                    kvidxGetLastError(i));
+            }
+            if (warnedUsed == 0) {
+                ERRR("Map fill warning never fired!");
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Environment Flag Tests
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-flags-%d", getpid());
+
+        printf("\nTesting LMDB environment flags in: %s\n", dirname);
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbMapSizeBytes = 1 << 20; /* Exercise growth with WRITEMAP */
+        config.lmdbWriteMap = true;
+        config.lmdbMapAsync = true;
+        config.lmdbNoMetaSync = true;
+        config.lmdbNoReadAhead = true;
+        config.lmdbNoMemInit = true;
+        config.lmdbMaxReaders = 16;
+
+        TEST("LMDB opens with all performance flags...") {
+            const char *openErr = NULL;
+            if (!kvidxOpenWithConfig(i, dirname, &config, &openErr)) {
+                ERR("Open with flags failed: %s", openErr ? openErr : "?");
+            }
+        }
+
+        static uint8_t value[4096];
+        memset(value, 0xA5, sizeof(value));
+
+        TEST("LMDB WRITEMAP writes grow the map and read back...") {
+            for (uint64_t k = 1; k <= 1024; k++) {
+                if (!kvidxInsert(i, k, k, 1, value, sizeof(value))) {
+                    ERR("Insert %" PRIu64 " failed: %s", k,
+                        kvidxGetLastErrorMessage(i));
+                    break;
+                }
+            }
+
+            uint64_t term = 0;
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(i, 777, &term, NULL, &data, &len) || term != 777 ||
+                len != sizeof(value) || memcmp(data, value, len) != 0) {
+                ERRR("WRITEMAP value mismatch!");
+            }
+        }
+
+        TEST("LMDB sync tiers can be changed on a live environment...") {
+            config.lmdbMapAsync = false;
+            config.lmdbNoMetaSync = false;
+            config.syncMode = KVIDX_SYNC_OFF;
+            if (kvidxUpdateConfig(i, &config) != KVIDX_OK) {
+                ERRR("UpdateConfig failed!");
+            }
+            if (!kvidxInsert(i, 2000, 1, 1, "x", 1)) {
+                ERRR("Insert after flag change failed!");
+            }
+            kvidxFsync(i);
+        }
+
+        kvidxClose(i);
+
+        TEST("LMDB data written with flags survives a default reopen...") {
+            kvidxInstance again = {0};
+            again.interface = kvidxInterfaceLmdb;
+            kvidxOpen(&again, dirname, NULL);
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(&again, &count);
+            if (count != 1025) {
+                ERR("Expected 1025 keys after reopen, got %" PRIu64, count);
+            }
+            kvidxClose(&again);
+        }
+
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Value Checksums
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-checksum-%d", getpid());
+
+        printf("\nTesting LMDB value checksums in: %s\n", dirname);
+
+        /* Keys 1-100 predate checksums */
+        kvidxOpen(i, dirname, NULL);
+        for (uint64_t k = 1; k <= 100; k++) {
+            kvidxInsert(i, k, 1, k, "unchecked", 9);
+        }
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.valueChecksums = true;
+        config.verifyChecksums = true;
+        kvidxUpdateConfig(i, &config);
+
+        char payload[32];
+        for (uint64_t k = 101; k <= 1100; k++) {
+            snprintf(payload, sizeof(payload), "checksummed-%06" PRIu64, k);
+            kvidxInsert(i, k, 2, k, payload, strlen(payload));
+        }
+
+        TEST("LMDB checksummed values read back...") {
+            const uint8_t *data;
+            size_t len;
+            if (!kvidxGet(i, 500, NULL, NULL, &data, &len) ||
+                len != strlen("checksummed-000500") ||
+                memcmp(data, "checksummed-000500", len) != 0) {
+                ERRR("Checksummed value misread!");
+            }
+            if (!kvidxGet(i, 50, NULL, NULL, &data, &len) || len != 9) {
+                ERRR("Value written before checksums misread!");
+            }
+        }
+
+        TEST("LMDB verify counts checked and unchecked values...") {
+            kvidxVerifyResult result;
+            kvidxError e = kvidxVerify(i, 0, UINT64_MAX, 4, &result);
+            if (e != KVIDX_OK) {
+                ERR("Verify failed: %s", kvidxGetLastErrorMessage(i));
+            }
+            if (result.entriesChecked != 1000 ||
+                result.entriesUnchecked != 100 || result.corruptEntries) {
+                ERR("Verify saw %" PRIu64 " checked, %" PRIu64
+                    " unchecked, %" PRIu64 " corrupt",
+                    result.entriesChecked, result.entriesUnchecked,
+                    result.corruptEntries);
+            }
+        }
+        kvidxClose(i);
+
+        /* Flip one byte of key 777's data in the data file */
+        char path[128];
+        snprintf(path, sizeof(path), "%s/data.mdb", dirname);
+        FILE *f = fopen(path, "r+b");
+        bool flipped = false;
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            const long size = ftell(f);
+            char *file = malloc(size);
+            rewind(f);
+            if (file && fread(file, 1, size, f) == (size_t)size) {
+                const char *needle = "checksummed-000777";
+                const size_t needleLen = strlen(needle);
+                for (long off = 0; off + (long)needleLen <= size; off++) {
+                    if (memcmp(file + off, needle, needleLen) == 0) {
+                        fseek(f, off, SEEK_SET);
+                        fputc('C', f);
+                        flipped = true;
+                        break;
+                    }
+                }
+            }
+            free(file);
+            fclose(f);
+        }
+
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        TEST("LMDB corrupt value fails its read...") {
+            if (!flipped) {
+                ERRR("Could not find value to corrupt!");
+            }
+            if (kvidxGet(i, 777, NULL, NULL, NULL, NULL)) {
+                ERRR("Corrupt value was returned!");
+            }
+            if (kvidxGetLastError(i) != KVIDX_ERROR_CORRUPT) {
+                ERR("Expected KVIDX_ERROR_CORRUPT, got %d",
+                    kvidxGetLastError(i));
+            }
+            if (!kvidxGet(i, 778, NULL, NULL, NULL, NULL)) {
+                ERRR("Neighbouring value no longer readable!");
+            }
+        }
+
+        TEST("LMDB verify finds the corrupt value...") {
+            kvidxVerifyResult result;
+            kvidxError e = kvidxVerify(i, 0, UINT64_MAX, 4, &result);
+            if (e != KVIDX_ERROR_CORRUPT) {
+                ERR("Expected KVIDX_ERROR_CORRUPT, got %d", e);
+            }
+            if (result.corruptEntries != 1 || result.firstCorruptKey != 777) {
+                ERR("Expected key 777 corrupt, got %" PRIu64 " at %" PRIu64,
+                    result.corruptEntries, result.firstCorruptKey);
+            }
+            if (result.entriesChecked != 999) {
+                ERR("Expected 999 good values, got %" PRIu64,
+                    result.entriesChecked);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Space Reclamation Tests
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-reclaim-%d", getpid());
+        printf("\nTesting LMDB space reclamation in: %s\n", dirname);
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.lmdbReclaimFreePercent = 100;
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        uint8_t data[1024];
+        memset(data, 'r', sizeof(data));
+        kvidxBegin(i);
+        for (uint64_t k = 1; k <= 4000; k++) {
+            kvidxInsert(i, k, 1, 1, data, sizeof(data));
+        }
+        kvidxCommit(i);
+        kvidxRemoveBeforeNInclusive(i, 3900);
+
+        kvidxStats before = {0};
+        kvidxGetStats(i, &before);
+
+        TEST("LMDB reclaim waits for the free page threshold...") {
+            kvidxReclaimResult r;
+            kvidxError e = kvidxReclaimSpace(i, 0, &r);
+            if (e != KVIDX_OK || r.pagesFreed != 0 ||
+                r.freePagesLeft != before.freePages || !before.freePages) {
+                ERR("Expected no copy with %" PRIu64
+                    " free pages, freed %" PRIu64 " (error %d)",
+                    before.freePages, r.pagesFreed, e);
+            }
+        }
+
+        TEST("LMDB reclaim compacts data.mdb...") {
+            config.lmdbReclaimFreePercent = 0;
+            kvidxUpdateConfig(i, &config);
+
+            kvidxReclaimResult r;
+            kvidxError e = kvidxReclaimSpace(i, 0, &r);
+            kvidxStats after = {0};
+            kvidxGetStats(i, &after);
+            if (e != KVIDX_OK || r.pagesFreed < before.freePages / 2 ||
+                r.bytesReclaimed == 0 || r.freePagesLeft != 0 ||
+                after.pagesReclaimed != r.pagesFreed ||
+                after.bytesReclaimed != r.bytesReclaimed) {
+                ERR("Compaction freed %" PRIu64 " of %" PRIu64
+                    " free pages, %" PRIu64 " bytes (error %d)",
+                    r.pagesFreed, before.freePages, r.bytesReclaimed, e);
+            }
+            if (after.totalKeys != 100 || !kvidxExists(i, 3901) ||
+                !kvidxInsert(i, 4001, 1, 1, data, sizeof(data))) {
+                ERRR("Compacted environment lost entries or writes!");
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+#ifdef KVIDXKIT_HAS_METRICS
+    /* ================================================================
+     * Work Counters
+     * ================================================================ */
+    {
+        kvidxInstance pre = {0};
+        kvidxInstance *i = &pre;
+        i->interface = kvidxInterfaceLmdb;
+
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-lmdb-io-%d", getpid());
+        printf("\nTesting LMDB work counters in: %s\n", dirname);
+
+        kvidxConfig config = kvidxConfigDefault();
+        config.metrics = true;
+        config.metricsIo = true;
+        kvidxOpenWithConfig(i, dirname, &config, NULL);
+
+        uint8_t data[512];
+        memset(data, 'w', sizeof(data));
+        kvidxBegin(i);
+        for (uint64_t k = 1; k <= 100; k++) {
+            kvidxInsert(i, k, 1, 1, data, sizeof(data));
+        }
+        kvidxCommit(i);
+        kvidxBegin(i);
+        kvidxCommit(i); /* Writes nothing, so LMDB skips it */
+        kvidxInsert(i, 101, 1, 1, data, sizeof(data));
+        kvidxBegin(i);
+        kvidxInsert(i, 102, 1, 1, data, sizeof(data));
+        kvidxAbort(i);
+        kvidxFsync(i);
+
+        kvidxMetrics *m = calloc(1, sizeof(*m));
+        if (!m || kvidxGetMetrics(i, m) != KVIDX_OK) {
+            ERRR("Failed to read metrics!");
+        } else {
+            TEST("LMDB counts transactions and the syncs they issue...") {
+                const kvidxIoCounters *commit = &m->ops[KVIDX_OP_COMMIT].io;
+                const kvidxIoCounters *insert = &m->ops[KVIDX_OP_INSERT].io;
+                /* Data and meta page are both synced by default */
+                if (commit->transactions != 1 || commit->fsyncs != 2 ||
+                    insert->transactions != 1 || insert->fsyncs != 2 ||
+                    insert->rowsTouched != 102 ||
+                    m->ops[KVIDX_OP_ABORT].io.transactions != 1 ||
+                    m->ops[KVIDX_OP_FSYNC].io.fsyncs != 1) {
+                    ERR("Unexpected counters: commit %" PRIu64
+                        " txns %" PRIu64 " syncs, insert %" PRIu64
+                        " txns %" PRIu64 " syncs %" PRIu64 " rows",
+                        commit->transactions, commit->fsyncs,
+                        insert->transactions, insert->fsyncs,
+                        insert->rowsTouched);
+                }
+                if (!commit->pagesAllocated || insert->bytesWritten) {
+                    ERR("Expected pages allocated at commit and no byte "
+                        "counts, got %" PRIu64 " pages, %" PRIu64 " bytes",
+                        commit->pagesAllocated, insert->bytesWritten);
+                }
+            }
+        }
+
+        free(m);
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+#endif
+
     /* ================================================================
      * Summary
      * ================================================================ */
@@ -0,0 +1,460 @@
+/**
+ * Test suite for the in-memory adapter
+ *
+ * The generic interface is exercised by kvidxkit-test-primitives and the
+ * fuzzer through the registry; this suite covers memory-specific behavior:
+ * - Snapshot persistence (including TTLs) and ":memory:" instances
+ * - Export and import through the generic stream path
+ * - Transaction abort restoring overwritten and removed keys
+ * - Iterator read pins keeping data valid across writes
+ * - B+tree splits, merges and bulk rebuilds against a reference model
+ */
+
+#include "ctest.h"
+#include "kvidxkit.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool openMemory(kvidxInstance *i, const char *filename) {
+    memset(i, 0, sizeof(*i));
+    i->interface = kvidxInterfaceMemory;
+    return kvidxOpen(i, filename, NULL);
+}
+
+static bool fileExists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+/* Deterministic xorshift so failures reproduce */
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+/* Walk the whole store with GetNext, comparing against the reference */
+static bool matchesReference(kvidxInstance *i, const uint64_t *terms,
+                             uint64_t space) {
+    uint64_t term = 0;
+    if (kvidxGet(i, 0, &term, NULL, NULL, NULL) ? terms[0] != term
+                                                 : terms[0] != 0) {
+        return false;
+    }
+
+    uint64_t expected = 0;
+    for (uint64_t k = 1; k < space; k++) {
+        expected += terms[k] != 0;
+    }
+
+    uint64_t seen = 0;
+    uint64_t key = 0;
+    uint64_t cursor = 0;
+    while (kvidxGetNext(i, cursor, &key, &term, NULL, NULL, NULL)) {
+        if (key >= space || terms[key] != term) {
+            return false;
+        }
+        seen++;
+        cursor = key;
+    }
+
+    if (seen != expected) {
+        return false;
+    }
+
+    /* Range counts come from per-branch subtree counts; check them too */
+    for (uint32_t q = 0; q < 200; q++) {
+        uint64_t lo = rng() % space;
+        uint64_t hi = lo + rng() % (space - lo);
+        uint64_t want = 0;
+        for (uint64_t k = lo; k <= hi; k++) {
+            want += terms[k] != 0;
+        }
+
+        uint64_t got = 0;
+        kvidxCountRange(i, lo, hi, &got);
+        if (got != want) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    uint32_t err = 0;
+
+    printf("=== Memory Adapter Test Suite ===\n\n");
+
+    /* ================================================================
+     * Snapshot Persistence
+     * ================================================================ */
+    {
+        char filename[64] = {0};
+        snprintf(filename, sizeof(filename), "test-memory-snap-%d.kvmem",
+                 getpid());
+        unlink(filename);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Memory snapshot is written on close and reloaded on open...") {
+            if (!openMemory(i, filename)) {
+                ERRR("Failed to open memory instance");
+            }
+
+            for (uint64_t key = 1; key <= 1000; key++) {
+                char data[32];
+                int len = snprintf(data, sizeof(data), "value-%" PRIu64, key);
+                kvidxInsert(i, key, key * 2, key, data, (size_t)len);
+            }
+            kvidxSetExpire(i, 7, 3600 * 1000);
+            kvidxClose(i);
+
+            if (!fileExists(filename)) {
+                ERRR("Snapshot file was not written");
+            }
+
+            if (!openMemory(i, filename)) {
+                ERRR("Failed to reopen memory instance");
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 1000) {
+                ERR("Expected 1000 keys after reload, got %" PRIu64, count);
+            }
+
+            uint64_t term = 0, cmd = 0;
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(i, 500, &term, &cmd, &data, &len) || term != 1000 ||
+                cmd != 500 || len != 9 || memcmp(data, "value-500", 9) != 0) {
+                ERRR("Key 500 did not survive the snapshot");
+            }
+        }
+
+        TEST("Memory snapshot preserves TTLs...") {
+            int64_t ttl = kvidxGetTTL(i, 7);
+            if (ttl <= 0 || ttl > 3600 * 1000) {
+                ERR("Expected key 7 to keep its TTL, got %" PRId64, ttl);
+            }
+
+            if (kvidxGetTTL(i, 8) != KVIDX_TTL_NONE) {
+                ERRR("Key 8 should have no TTL");
+            }
+        }
+
+        TEST("Memory fsync snapshots only committed data...") {
+            kvidxBegin(i);
+            kvidxRemove(i, 1);
+            kvidxFsync(i);
+            kvidxAbort(i);
+            kvidxClose(i);
+
+            openMemory(i, filename);
+            if (!kvidxExists(i, 1)) {
+                ERRR("Aborted remove leaked into the snapshot");
+            }
+            kvidxClose(i);
+        }
+
+        TEST("Memory snapshot is a valid binary export...") {
+            kvidxInstance other;
+            if (!openMemory(&other, ":memory:")) {
+                ERRR("Failed to open :memory: instance");
+            }
+
+            kvidxImportOptions options = kvidxImportOptionsDefault();
+            if (kvidxImport(&other, filename, &options, NULL, NULL) !=
+                KVIDX_OK) {
+                ERRR("Importing the snapshot failed");
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(&other, &count);
+            if (count != 1000) {
+                ERR("Expected 1000 imported keys, got %" PRIu64, count);
+            }
+            kvidxClose(&other);
+        }
+
+        TEST("Memory binary export round-trips through import...") {
+            char exportname[80] = {0};
+            snprintf(exportname, sizeof(exportname), "%s.export", filename);
+
+            openMemory(i, filename);
+            kvidxExportOptions exportOptions = kvidxExportOptionsDefault();
+            exportOptions.startKey = 101;
+            exportOptions.endKey = 200;
+            if (kvidxExport(i, exportname, &exportOptions, NULL, NULL) !=
+                KVIDX_OK) {
+                ERR("Export failed: %s", kvidxGetLastErrorMessage(i));
+            }
+            kvidxClose(i);
+
+            kvidxInstance other;
+            openMemory(&other, ":memory:");
+            if (kvidxImport(&other, exportname, NULL, NULL, NULL) !=
+                KVIDX_OK) {
+                ERR("Import failed: %s", kvidxGetLastErrorMessage(&other));
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(&other, &count);
+            if (count != 100 || !kvidxExists(&other, 101) ||
+                !kvidxExists(&other, 200)) {
+                ERR("Expected keys 101..200, got %" PRIu64 " keys", count);
+            }
+            kvidxClose(&other);
+            unlink(exportname);
+        }
+
+        unlink(filename);
+    }
+
+    /* ================================================================
+     * Ephemeral Instances
+     * ================================================================ */
+    {
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Memory :memory: instances are never persisted...") {
+            if (!openMemory(i, ":memory:")) {
+                ERRR("Failed to open :memory: instance");
+            }
+
+            kvidxInsert(i, 1, 1, 1, "x", 1);
+            kvidxFsync(i);
+            kvidxClose(i);
+
+            if (fileExists(":memory:")) {
+                unlink(":memory:");
+                ERRR("A :memory: instance wrote a file");
+            }
+
+            openMemory(i, ":memory:");
+            if (kvidxExists(i, 1)) {
+                ERRR("A :memory: instance kept data across opens");
+            }
+            kvidxClose(i);
+        }
+    }
+
+    /* ================================================================
+     * Transaction Abort
+     * ================================================================ */
+    {
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openMemory(i, ":memory:");
+
+        for (uint64_t key = 1; key <= 200; key++) {
+            kvidxInsert(i, key, 1, 0, "original", 8);
+        }
+
+        TEST("Memory abort restores overwritten, removed and new keys...") {
+            kvidxBegin(i);
+            for (uint64_t key = 1; key <= 50; key++) {
+                kvidxInsertEx(i, key, 2, 0, "changed", 7, KVIDX_SET_ALWAYS);
+            }
+            kvidxRemoveRange(i, 51, 200, true, true, NULL);
+            for (uint64_t key = 1000; key < 1100; key++) {
+                kvidxInsert(i, key, 3, 0, "new", 3);
+            }
+            kvidxAbort(i);
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 200) {
+                ERR("Expected 200 keys after abort, got %" PRIu64, count);
+            }
+
+            for (uint64_t key = 1; key <= 200; key++) {
+                uint64_t term = 0;
+                const uint8_t *data = NULL;
+                size_t len = 0;
+                if (!kvidxGet(i, key, &term, NULL, &data, &len) || term != 1 ||
+                    len != 8 || memcmp(data, "original", 8) != 0) {
+                    ERR("Key %" PRIu64 " not restored by abort", key);
+                    break;
+                }
+            }
+        }
+
+        kvidxClose(i);
+    }
+
+    /* ================================================================
+     * Iterator Read Pins
+     * ================================================================ */
+    {
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openMemory(i, ":memory:");
+
+        for (uint64_t key = 1; key <= 100; key++) {
+            kvidxInsert(i, key, 1, 0, "pinned-value", 12);
+        }
+
+        TEST("Memory iterator data survives overwrite and removal...") {
+            kvidxIterator *it =
+                kvidxIteratorCreate(i, 1, 100, KVIDX_ITER_FORWARD);
+            if (!it || !kvidxIteratorNext(it)) {
+                ERRR("Failed to start iterator");
+            }
+
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            kvidxIteratorGet(it, NULL, NULL, NULL, &data, &len);
+
+            /* Replace and then remove every key, churning the arena */
+            for (uint64_t key = 1; key <= 100; key++) {
+                kvidxInsertEx(i, key, 2, 0, "xxxxxxxxxxxx", 12,
+                              KVIDX_SET_ALWAYS);
+            }
+            kvidxRemoveRange(i, 1, 100, true, true, NULL);
+
+            if (len != 12 || memcmp(data, "pinned-value", 12) != 0) {
+                ERRR("Pinned data changed under the iterator");
+            }
+
+            kvidxIteratorDestroy(it);
+        }
+
+        kvidxClose(i);
+    }
+
+    /* ================================================================
+     * B+tree Structure
+     * ================================================================ */
+    {
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openMemory(i, ":memory:");
+
+        const uint64_t space = 20000;
+        uint64_t *terms = calloc(space, sizeof(*terms));
+
+        TEST("Memory random inserts/removes match a reference model...") {
+            for (uint32_t round = 0; round < 200000; round++) {
+                uint64_t key = rng() % space;
+                uint64_t op = rng() % 10;
+
+                if (op < 6) {
+                    uint64_t term = round + 1;
+                    kvidxInsertEx(i, key, term, 0, &term, sizeof(term),
+                                  KVIDX_SET_ALWAYS);
+                    terms[key] = term;
+                } else if (op < 9) {
+                    kvidxRemove(i, key);
+                    terms[key] = 0;
+                } else {
+                    /* Small range removal: per-key deletes */
+                    uint64_t end = key + rng() % 40;
+                    kvidxRemoveRange(i, key, end, true, false, NULL);
+                    for (uint64_t k = key; k < end && k < space; k++) {
+                        terms[k] = 0;
+                    }
+                }
+
+                if (round % 20000 == 19999 &&
+                    !matchesReference(i, terms, space)) {
+                    ERR("Tree diverged from the reference model by round "
+                        "%u",
+                        round);
+                    break;
+                }
+            }
+        }
+
+        TEST("Memory bulk range removal rebuilds the tree...") {
+            /* Removes most keys, taking the rebuild path */
+            uint64_t deleted = 0;
+            kvidxRemoveRange(i, 1000, 18999, true, true, &deleted);
+            for (uint64_t k = 1000; k <= 18999; k++) {
+                terms[k] = 0;
+            }
+
+            if (deleted == 0) {
+                ERRR("Expected keys to be removed");
+            }
+
+            if (!matchesReference(i, terms, space)) {
+                ERRR("Tree contents diverged after bulk removal");
+            }
+
+            /* The rebuilt tree must still accept splits and merges */
+            for (uint64_t key = 0; key < space; key++) {
+                uint64_t term = key + 1;
+                kvidxInsertEx(i, key, term, 0, NULL, 0, KVIDX_SET_ALWAYS);
+                terms[key] = term;
+            }
+            for (uint64_t key = 0; key < space; key += 3) {
+                kvidxRemove(i, key);
+                terms[key] = 0;
+            }
+
+            if (!matchesReference(i, terms, space)) {
+                ERRR("Tree contents diverged after refilling");
+            }
+        }
+
+        TEST("Memory head and tail removal leave the right bounds...") {
+            kvidxRemoveBeforeNInclusive(i, 4999);
+            kvidxRemoveAfterNInclusive(i, 15000);
+
+            uint64_t minKey = 0, maxKey = 0, count = 0;
+            kvidxGetMinKey(i, &minKey);
+            kvidxMaxKey(i, &maxKey);
+            kvidxGetKeyCount(i, &count);
+
+            /* Multiples of 3 were removed above */
+            if (minKey != 5000 || maxKey != 14999 || count != 6667) {
+                ERR("Expected [5000, 14999] x 6667, got [%" PRIu64
+                    ", %" PRIu64 "] x %" PRIu64,
+                    minKey, maxKey, count);
+            }
+        }
+
+        TEST("Memory sequential appends pack leaves full...") {
+            kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+            for (uint64_t key = 1; key <= 14000; key++) {
+                kvidxInsert(i, key, 1, 0, NULL, 0);
+            }
+
+            /* 14 keys per leaf: ~1000 leaves plus a few branches */
+            kvidxStats stats = {0};
+            kvidxGetStats(i, &stats);
+            if (stats.pageCount > 1100) {
+                ERR("Expected about 1000 nodes, got %" PRIu64,
+                    stats.pageCount);
+            }
+        }
+
+        free(terms);
+        kvidxClose(i);
+    }
+
+    /* ================================================================
+     * Summary
+     * ================================================================ */
+    printf("\n=== Memory Adapter Test Results ===\n");
+    if (err == 0) {
+        printf("All tests passed!\n");
+    } else {
+        printf("FAILED: %u tests failed\n", err);
+    }
+
+    return err ? 1 : 0;
+}
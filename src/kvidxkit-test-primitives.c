@@ -1,20 +1,22 @@
 /**
  * Comprehensive storage primitives tests for kvidxkit (v0.8.0)
  * Tests: conditional writes, atomic operations, compare-and-swap,
- *        append/prepend, partial value access, and TTL/expiration
+ *        append/prepend, partial value access, TTL/expiration, and the
+ *        change feed
  * Runs against both SQLite3 and LMDB backends.
  */
 
 /* Required for clock_gettime and usleep on various platforms */
 #if defined(__APPLE__)
 #define _DARWIN_C_SOURCE
-#else
-#define _POSIX_C_SOURCE 199309L
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
 #endif
 
 #include "ctest.h"
 #include "kvidxkit.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -917,6 +919,203 @@ static void testEdgeCases(uint32_t *err, const kvidxInterface *iface) {
     cleanupTestFile(filename);
 }
 
+/* ====================================================================
+ * TEST SUITE 9: Change Feed
+ * ==================================================================== */
+#define FEED_THREAD_KEYS 2000
+
+typedef struct feedConsumer {
+    kvidxSubscription *sub;
+    uint64_t seen;
+    uint64_t nextSeq;
+    bool ordered;
+} feedConsumer;
+
+static void *feedConsumerMain(void *arg) {
+    feedConsumer *c = arg;
+    kvidxChange changes[64];
+    while (c->seen < FEED_THREAD_KEYS) {
+        size_t n = kvidxSubscriptionPoll(c->sub, changes, 64);
+        for (size_t k = 0; k < n; k++) {
+            const kvidxChange *ch = &changes[k];
+            if (c->seen == 0) {
+                c->nextSeq = ch->seq;
+            }
+            if (ch->seq != c->nextSeq || ch->key != c->seen ||
+                ch->dataLen != sizeof(uint64_t) ||
+                memcmp(ch->data, &ch->key, sizeof(uint64_t)) != 0) {
+                c->ordered = false;
+            }
+            c->nextSeq++;
+            c->seen++;
+        }
+        if (!n) {
+            usleep(100);
+        }
+    }
+    return NULL;
+}
+
+static void testChangeFeed(uint32_t *err, const kvidxInterface *iface) {
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), "feed");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+
+    if (!openFresh(i, filename, iface)) {
+        ERRR("Failed to open database for change feed tests");
+        return;
+    }
+
+    kvidxSubscription *sub = kvidxSubscribe(i, 0);
+    if (!sub) {
+        ERRR("Subscribe failed");
+        kvidxClose(i);
+        cleanupTestFile(filename);
+        return;
+    }
+
+    kvidxChange changes[16];
+
+    TEST("ChangeFeed: Auto-commit writes arrive in order") {
+        kvidxInsert(i, 1, 1, 1, "one", 3);
+        kvidxInsertEx(i, 1, 2, 2, "uno", 3, KVIDX_SET_ALWAYS);
+        kvidxAppend(i, 1, 2, 2, "!", 1, NULL);
+        kvidxRemove(i, 1);
+        kvidxRemove(i, 1); /* Already gone: not a change */
+
+        const kvidxChangeType expected[] = {
+            KVIDX_CHANGE_INSERT, KVIDX_CHANGE_UPDATE, KVIDX_CHANGE_UPDATE,
+            KVIDX_CHANGE_REMOVE};
+        size_t n = kvidxSubscriptionPoll(sub, changes, 16);
+        if (n != 4) {
+            ERR("Expected 4 changes, got %zu", n);
+        }
+        for (size_t k = 0; k < n && k < 4; k++) {
+            if (changes[k].type != expected[k] || changes[k].key != 1 ||
+                changes[k].seq != k + 1 || changes[k].commit != k + 1 ||
+                !changes[k].lastInCommit) {
+                ERR("Change %zu: type %d key %" PRIu64 " seq %" PRIu64, k,
+                    changes[k].type, changes[k].key, changes[k].seq);
+            }
+        }
+        if (n >= 3 && (changes[2].dataLen != 4 ||
+                       memcmp(changes[2].data, "uno!", 4) != 0 ||
+                       changes[2].term != 2)) {
+            ERRR("Append should report the whole new value");
+        }
+    }
+
+    TEST("ChangeFeed: Range removal reports inclusive bounds") {
+        for (uint64_t k = 10; k < 20; k++) {
+            kvidxInsert(i, k, 1, 1, "r", 1);
+        }
+        kvidxSubscriptionPoll(sub, changes, 16);
+
+        kvidxRemoveRange(i, 10, 15, false, false, NULL);
+        kvidxRemoveRange(i, 100, 200, true, true, NULL); /* Nothing there */
+        size_t n = kvidxSubscriptionPoll(sub, changes, 16);
+        if (n != 1 || changes[0].type != KVIDX_CHANGE_REMOVE_RANGE ||
+            changes[0].key != 11 || changes[0].endKey != 14) {
+            ERR("Expected REMOVE_RANGE [11, 14], got %zu changes", n);
+        }
+    }
+
+    TEST("ChangeFeed: A transaction is one commit") {
+        kvidxBegin(i);
+        kvidxInsert(i, 30, 1, 1, "a", 1);
+        kvidxInsert(i, 31, 1, 1, "b", 1);
+        if (kvidxSubscriptionPoll(sub, changes, 16) != 0) {
+            ERRR("Uncommitted changes must not be visible");
+        }
+        kvidxInsert(i, 32, 1, 1, "c", 1);
+        kvidxCommit(i);
+
+        size_t n = kvidxSubscriptionPoll(sub, changes, 16);
+        if (n != 3 || changes[0].commit != changes[2].commit ||
+            changes[0].lastInCommit || !changes[2].lastInCommit ||
+            changes[1].key != 31) {
+            ERR("Expected one commit of 3 changes, got %zu", n);
+        }
+    }
+
+    TEST("ChangeFeed: Aborted writes are not reported") {
+        kvidxBegin(i);
+        kvidxInsert(i, 40, 1, 1, "x", 1);
+        if (kvidxAbort(i)) {
+            if (kvidxSubscriptionPoll(sub, changes, 16) != 0) {
+                ERRR("Aborted insert was reported");
+            }
+        } else {
+            kvidxCommit(i);
+            kvidxSubscriptionPoll(sub, changes, 16);
+        }
+    }
+
+    TEST("ChangeFeed: ExpireScan reports expired keys") {
+        kvidxInsert(i, 50, 1, 1, "ttl", 3);
+        kvidxSetExpire(i, 50, 1);
+        usleep(10000);
+        kvidxSubscriptionPoll(sub, changes, 16);
+
+        kvidxExpireScan(i, 0, NULL);
+        size_t n = kvidxSubscriptionPoll(sub, changes, 16);
+        if (n != 1 || changes[0].type != KVIDX_CHANGE_EXPIRE ||
+            changes[0].key != 50) {
+            ERR("Expected EXPIRE of key 50, got %zu changes", n);
+        }
+    }
+
+    TEST("ChangeFeed: A commit larger than the free space is dropped whole") {
+        kvidxSubscription *small = kvidxSubscribe(i, 3); /* Rounds to 4 */
+        kvidxBegin(i);
+        for (uint64_t k = 60; k < 65; k++) {
+            kvidxInsert(i, k, 1, 1, "d", 1);
+        }
+        kvidxCommit(i);
+        kvidxInsert(i, 65, 1, 1, "e", 1);
+
+        size_t n = kvidxSubscriptionPoll(small, changes, 16);
+        if (n != 1 || changes[0].key != 65 ||
+            kvidxSubscriptionDropped(small) != 5) {
+            ERR("Expected key 65 after 5 dropped, got %zu changes, %" PRIu64
+                " dropped",
+                n, kvidxSubscriptionDropped(small));
+        }
+
+        /* The larger ring still got everything */
+        n = kvidxSubscriptionPoll(sub, changes, 16);
+        if (n != 6 || changes[5].seq != changes[0].seq + 5) {
+            ERR("Expected 6 changes on the default ring, got %zu", n);
+        }
+        kvidxUnsubscribe(i, small);
+    }
+
+    kvidxUnsubscribe(i, sub);
+
+    TEST("ChangeFeed: Consumer thread sees every commit in order") {
+        kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+        feedConsumer c = {.sub = kvidxSubscribe(i, FEED_THREAD_KEYS),
+                          .ordered = true};
+
+        pthread_t thread;
+        pthread_create(&thread, NULL, feedConsumerMain, &c);
+        for (uint64_t k = 0; k < FEED_THREAD_KEYS; k++) {
+            kvidxInsert(i, k, 1, 1, &k, sizeof(k));
+        }
+        pthread_join(thread, NULL);
+
+        if (!c.ordered || kvidxSubscriptionDropped(c.sub) != 0) {
+            ERRR("Consumer saw changes out of order or dropped");
+        }
+        /* Left attached: kvidxClose() frees it */
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(filename);
+}
+
 /* ====================================================================
  * MAIN - Run all test suites for each backend
  * ==================================================================== */
@@ -935,6 +1134,7 @@ static void runAllTests(uint32_t *err, const kvidxInterface *iface,
     testPartialValueAccess(err, iface);
     testTTLExpiration(err, iface);
     testEdgeCases(err, iface);
+    testChangeFeed(err, iface);
 }
 
 int main(void) {
@@ -952,5 +1152,17 @@ int main(void) {
     runAllTests(&err, &kvidxInterfaceRocksdb, "rocksdb");
 #endif
 
+#ifdef KVIDXKIT_HAS_SEGLOG
+    runAllTests(&err, &kvidxInterfaceSeglog, "seglog");
+#endif
+
+#ifdef KVIDXKIT_HAS_MEMORY
+    runAllTests(&err, &kvidxInterfaceMemory, "memory");
+#endif
+
+#ifdef KVIDXKIT_HAS_TIERED
+    runAllTests(&err, &kvidxInterfaceTiered, "tiered");
+#endif
+
     TEST_FINAL_RESULT;
 }
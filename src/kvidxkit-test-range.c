@@ -3,6 +3,13 @@
  * Tests removeRange, countRange, and existsInRange functionality
  */
 
+/* Required for usleep under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "ctest.h"
 #include "kvidxkit.h"
 
@@ -600,6 +607,273 @@ static void testRangeErrorHandling(uint32_t *err) {
     }
 }
 
+/* ====================================================================
+ * TEST SUITE 7: Incremental Remove
+ * ==================================================================== */
+static void testRemoveIncremental(uint32_t *err) {
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), "incremental");
+
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxOpen(i, filename, NULL);
+    kvidxBegin(i);
+    populateRange(i, 1, 10000);
+    kvidxCommit(i);
+
+    TEST("Incremental Remove: Key budget bounds each call") {
+        kvidxRemoveProgress progress = {0};
+        uint32_t calls = 0;
+        while (!progress.done && calls < 100) {
+            const uint64_t before = progress.removed;
+            kvidxError e =
+                kvidxRemoveRangeIncremental(i, 1, 9000, 1000, 0, &progress);
+            if (e != KVIDX_OK || progress.removed - before > 1000) {
+                ERR("Call %u removed %" PRIu64 " keys (error %d)", calls,
+                    progress.removed - before, e);
+            }
+            calls++;
+        }
+
+        uint64_t count = 0;
+        kvidxGetKeyCount(i, &count);
+        if (calls != 9 || progress.removed != 9000 || count != 1000 ||
+            progress.nextKey != 9001 || kvidxExists(i, 9000) ||
+            !kvidxExists(i, 9001)) {
+            ERR("Expected 9 calls removing 9000 keys, got %u calls, %" PRIu64
+                " keys, %" PRIu64 " left",
+                calls, progress.removed, count);
+        }
+
+        /* A finished cursor does nothing */
+        if (kvidxRemoveRangeIncremental(i, 1, 9000, 1000, 0, &progress) !=
+                KVIDX_OK ||
+            progress.removed != 9000) {
+            ERRR("Finished cursor removed more keys");
+        }
+    }
+
+    TEST("Incremental Remove: Appends interleave with a time budget") {
+        kvidxBegin(i);
+        populateRange(i, 10001, 30000);
+        kvidxCommit(i);
+
+        kvidxRemoveProgress progress = {0};
+        uint64_t next = 30001;
+        while (!progress.done) {
+            /* A 1 us budget runs one chunk per call */
+            const uint64_t chunks = progress.chunks;
+            kvidxRemoveRangeIncremental(i, 0, 25000, 0, 1, &progress);
+            if (progress.chunks != chunks + 1) {
+                ERRR("Expected one chunk per call");
+                break;
+            }
+            kvidxInsert(i, next++, 2, 0, "tail", 4);
+        }
+
+        uint64_t minKey = 0;
+        kvidxGetMinKey(i, &minKey);
+        if (progress.removed != 16000 || minKey != 25001 ||
+            !kvidxExists(i, next - 1)) {
+            ERR("Expected 16000 removed up to 25000, got %" PRIu64
+                " (min key %" PRIu64 ")",
+                progress.removed, minKey);
+        }
+    }
+
+    TEST("Incremental Remove: Sparse keys cost one chunk each") {
+        kvidxRemoveRange(i, 25001, UINT64_MAX / 2, true, true, NULL);
+        static const uint64_t keys[] = {1, 1000000, UINT64_C(1) << 40,
+                                        UINT64_C(1) << 62};
+        for (size_t n = 0; n < sizeof(keys) / sizeof(*keys); n++) {
+            kvidxInsert(i, keys[n], 3, 0, "sparse", 6);
+        }
+
+        kvidxRemoveProgress progress = {0};
+        kvidxError e =
+            kvidxRemoveRangeIncremental(i, 0, UINT64_MAX, 0, 0, &progress);
+        uint64_t count = 1;
+        kvidxGetKeyCount(i, &count);
+        if (e != KVIDX_OK || !progress.done || progress.removed != 4 ||
+            progress.chunks != 4 || count != 0) {
+            ERR("Sparse removal: %" PRIu64 " keys in %" PRIu64
+                " chunks, %" PRIu64 " left",
+                progress.removed, progress.chunks, count);
+        }
+    }
+
+    TEST("Incremental Remove: Range ending at UINT64_MAX") {
+        static const uint64_t keys[] = {5, UINT64_C(1) << 50,
+                                        UINT64_C(1) << 62};
+        for (size_t n = 0; n < sizeof(keys) / sizeof(*keys); n++) {
+            kvidxInsert(i, keys[n], 4, 0, "top", 3);
+        }
+
+        /* One key per call; the cursor must not wrap past the end */
+        kvidxRemoveProgress progress = {0};
+        uint32_t calls = 0;
+        while (!progress.done && calls < 10) {
+            kvidxRemoveRangeIncremental(i, 0, UINT64_MAX, 1, 0, &progress);
+            calls++;
+        }
+
+        uint64_t count = 1;
+        kvidxGetKeyCount(i, &count);
+        if (!progress.done || progress.removed != 3 ||
+            progress.nextKey != UINT64_MAX || count != 0) {
+            ERR("Expected 3 keys removed with the cursor at UINT64_MAX, got "
+                "%" PRIu64 " removed, next key %" PRIu64 " after %u calls",
+                progress.removed, progress.nextKey, calls);
+        }
+    }
+
+    TEST("Incremental Remove: Invalid arguments") {
+        kvidxRemoveProgress progress = {0};
+        if (kvidxRemoveRangeIncremental(i, 10, 5, 0, 0, &progress) !=
+                KVIDX_ERROR_INVALID_ARGUMENT ||
+            kvidxRemoveRangeIncremental(i, 1, 5, 0, 0, NULL) !=
+                KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("Invalid arguments accepted");
+        }
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(filename);
+}
+
+/* ====================================================================
+ * TEST SUITE 8: Space Reclamation
+ * ==================================================================== */
+
+/* Write keys [start, end] with 1 KB values, so removing them frees pages */
+static void populateLarge(kvidxInstance *i, uint64_t start, uint64_t end) {
+    uint8_t data[1024];
+    memset(data, 'r', sizeof(data));
+    kvidxBegin(i);
+    for (uint64_t key = start; key <= end; key++) {
+        kvidxInsert(i, key, 1, 1, data, sizeof(data));
+    }
+    kvidxCommit(i);
+}
+
+static void testReclaimSpace(uint32_t *err) {
+    char filename[128];
+
+    TEST("Reclaim Space: Incremental vacuum frees pages in steps") {
+        makeTestFilename(filename, sizeof(filename), "reclaim");
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceSqlite3;
+        kvidxOpen(i, filename, NULL);
+        populateLarge(i, 1, 4000);
+        kvidxRemoveBeforeNInclusive(i, 3900);
+
+        kvidxStats before = {0};
+        kvidxGetStats(i, &before);
+
+        kvidxReclaimResult r = {0};
+        kvidxError e = kvidxReclaimSpace(i, 64, &r);
+        if (e != KVIDX_OK || r.pagesFreed != 64 ||
+            r.bytesReclaimed != 64 * before.pageSize ||
+            r.freePagesLeft != before.freePages - 64) {
+            ERR("First step freed %" PRIu64 " of %" PRIu64
+                " pages (error %d)",
+                r.pagesFreed, before.freePages, e);
+        }
+
+        uint64_t freed = r.pagesFreed;
+        uint32_t steps = 1;
+        while (r.freePagesLeft && steps < 1000) {
+            kvidxReclaimSpace(i, 0, &r);
+            freed += r.pagesFreed;
+            steps++;
+        }
+
+        kvidxStats after = {0};
+        kvidxGetStats(i, &after);
+        if (freed != before.freePages || after.freePages != 0 ||
+            /* Pointer-map pages past the new end go as well */
+            after.pageCount > before.pageCount - freed ||
+            after.pagesReclaimed != freed ||
+            after.bytesReclaimed != freed * before.pageSize) {
+            ERR("Freed %" PRIu64 " of %" PRIu64 " pages; %" PRIu64
+                " reported, %" PRIu64 " still free",
+                freed, before.freePages, after.pagesReclaimed,
+                after.freePages);
+        }
+        if (after.totalKeys != 100 || !kvidxExists(i, 3901) ||
+            !kvidxExists(i, 4000)) {
+            ERRR("Reclaiming space lost entries");
+        }
+
+        /* Nothing left to do is not an error */
+        if (kvidxReclaimSpace(i, 0, &r) != KVIDX_OK || r.pagesFreed) {
+            ERRR("Empty freelist step failed");
+        }
+
+        kvidxBegin(i);
+        if (kvidxReclaimSpace(i, 0, NULL) != KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("Reclaimed space inside a transaction");
+        }
+        kvidxCommit(i);
+
+        kvidxClose(i);
+        cleanupTestFile(filename);
+    }
+
+    TEST("Reclaim Space: Background vacuum while writes are idle") {
+        makeTestFilename(filename, sizeof(filename), "reclaim-bg");
+        kvidxConfig config = kvidxConfigDefault();
+        config.sqliteBackgroundCheckpoint = true;
+        config.sqliteBackgroundVacuum = true;
+        config.sqliteCheckpointIdleMs = 10;
+        config.reclaimPagesPerStep = 16;
+
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceSqlite3;
+        kvidxOpenWithConfig(i, filename, &config, NULL);
+        populateLarge(i, 1, 2000);
+        kvidxRemoveBeforeNInclusive(i, 1990);
+
+        kvidxStats stats = {0};
+        for (int wait = 0; wait < 200; wait++) {
+            kvidxGetStats(i, &stats);
+            if (stats.freePages == 0 && stats.pagesReclaimed) {
+                break;
+            }
+            usleep(10 * 1000);
+        }
+
+        if (stats.freePages != 0 || stats.pagesReclaimed == 0 ||
+            stats.bytesReclaimed != stats.pagesReclaimed * stats.pageSize) {
+            ERR("Background vacuum left %" PRIu64 " free pages, reclaimed "
+                "%" PRIu64,
+                stats.freePages, stats.pagesReclaimed);
+        }
+        if (stats.totalKeys != 10 || !kvidxExists(i, 2000)) {
+            ERRR("Background vacuum lost entries");
+        }
+
+        kvidxClose(i);
+        cleanupTestFile(filename);
+    }
+
+#ifdef KVIDXKIT_HAS_MEMORY
+    TEST("Reclaim Space: Adapters without files to shrink") {
+        kvidxInstance inst = {0};
+        kvidxInstance *i = &inst;
+        i->interface = kvidxInterfaceMemory;
+        kvidxOpen(i, ":memory:", NULL);
+        if (kvidxReclaimSpace(i, 0, NULL) != KVIDX_ERROR_NOT_SUPPORTED) {
+            ERRR("Memory adapter claimed to reclaim space");
+        }
+        kvidxClose(i);
+    }
+#endif
+}
+
 /* ====================================================================
  * MAIN TEST RUNNER
  * ==================================================================== */
@@ -642,6 +916,16 @@ int main(int argc, char *argv[]) {
     testRangeErrorHandling(&err);
     printf("\n");
 
+    printf("Running Suite 7: Incremental Remove\n");
+    printf("-------------------------------------------------------\n");
+    testRemoveIncremental(&err);
+    printf("\n");
+
+    printf("Running Suite 8: Space Reclamation\n");
+    printf("-------------------------------------------------------\n");
+    testReclaimSpace(&err);
+    printf("\n");
+
     printf("=======================================================\n");
     if (err == 0) {
         printf("ALL RANGE OPERATION TESTS PASSED!\n");
@@ -589,6 +589,90 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        TEST("RocksDB range deletes with tombstones...") {
+            kvidxConfig config = kvidxConfigDefault();
+            config.rocksdbCompactAfterDeleteKeys = 1000;
+            kvidxUpdateConfig(i, &config);
+
+            kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+            kvidxBegin(i);
+            for (uint64_t k = 1; k <= 20000; k++) {
+                kvidxInsert(i, k, 1, 0, "entry", 5);
+            }
+            kvidxCommit(i);
+
+            uint64_t deleted = 0;
+            kvidxError err = kvidxRemoveRange(i, 0, 10000, false, true,
+                                              &deleted);
+            if (err != KVIDX_OK || deleted != 10000) {
+                ERR("Expected 10000 deleted, got %" PRIu64, deleted);
+            }
+
+            /* Raft head and tail truncation */
+            kvidxRemoveBeforeNInclusive(i, 15000);
+            kvidxRemoveAfterNInclusive(i, 19990);
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            uint64_t minKey = 0;
+            uint64_t maxKey = 0;
+            kvidxGetMinKey(i, &minKey);
+            kvidxMaxKey(i, &maxKey);
+            if (count != 4989 || minKey != 15001 || maxKey != 19989) {
+                ERR("Expected 15001-19989, got %" PRIu64 " keys %" PRIu64
+                    "-%" PRIu64,
+                    count, minKey, maxKey);
+            }
+
+            /* TTL entries share the key space but survive */
+            kvidxSetExpire(i, 19000, 3600 * 1000);
+            kvidxRemoveAfterNInclusive(i, 19500);
+            if (kvidxGetTTL(i, 19000) <= 0 || kvidxExists(i, 19500)) {
+                ERRR("Range delete removed a TTL entry!");
+            }
+
+            /* Inside a transaction, deletes stay visible to reads */
+            kvidxBegin(i);
+            kvidxRemoveRange(i, 15001, 15010, true, true, &deleted);
+            if (deleted != 10 || kvidxExists(i, 15005)) {
+                ERRR("Transactional range delete not visible!");
+            }
+            kvidxCommit(i);
+        }
+
+        TEST("RocksDB reclaim compacts truncated ranges...") {
+            kvidxConfig config = kvidxConfigDefault();
+            config.rocksdbCompactAfterDeleteKeys = UINT64_MAX;
+            kvidxUpdateConfig(i, &config);
+
+            kvidxBegin(i);
+            for (uint64_t k = 20001; k <= 30000; k++) {
+                char buf[64];
+                snprintf(buf, sizeof(buf), "reclaimable-%" PRIu64, k * 7919);
+                kvidxInsert(i, k, 1, 0, buf, strlen(buf));
+            }
+            kvidxCommit(i);
+            kvidxFsync(i);
+
+            kvidxRemoveBeforeNInclusive(i, 29000);
+            kvidxReclaimResult r;
+            kvidxError err = kvidxReclaimSpace(i, 0, &r);
+            kvidxStats stats;
+            kvidxGetStats(i, &stats);
+            if (err != KVIDX_OK || r.bytesReclaimed == 0 ||
+                stats.bytesReclaimed != r.bytesReclaimed) {
+                ERR("Expected SST files to shrink, reclaimed %" PRIu64
+                    " bytes (error %d)",
+                    r.bytesReclaimed, err);
+            }
+
+            /* Nothing left to compact until the next removal */
+            err = kvidxReclaimSpace(i, 0, &r);
+            if (err != KVIDX_OK || r.bytesReclaimed != 0 ||
+                !kvidxExists(i, 29001) || kvidxExists(i, 29000)) {
+                ERRR("Second reclaim step was not a no-op!");
+            }
+        }
+
         kvidxClose(i);
         removeDir(dirname);
     }
@@ -806,6 +890,106 @@ int main(int argc, char *argv[]) {
         removeDir(dirname);
     }
 
+    /* ================================================================
+     * Tuning Options Tests
+     * ================================================================ */
+    {
+        kvidxInstance preA = {0};
+        kvidxInstance preB = {0};
+        kvidxInstance *a = &preA;
+        kvidxInstance *b = &preB;
+        a->interface = kvidxInterfaceRocksdb;
+        b->interface = kvidxInterfaceRocksdb;
+
+        char dirA[64] = {0};
+        char dirB[64] = {0};
+        snprintf(dirA, sizeof(dirA), "test-rocksdb-tuneA-%d", getpid());
+        snprintf(dirB, sizeof(dirB), "test-rocksdb-tuneB-%d", getpid());
+
+        printf("\nTesting RocksDB tuning options in: %s, %s\n", dirA, dirB);
+
+        static const kvidxCompression perLevel[] = {
+            KVIDX_COMPRESSION_NONE, KVIDX_COMPRESSION_NONE,
+            KVIDX_COMPRESSION_NONE};
+
+        kvidxBlockCache *cache = kvidxRocksdbBlockCacheCreate(8 << 20);
+        kvidxConfig config = kvidxConfigDefault();
+        config.rocksdbSharedBlockCache = cache;
+        config.rocksdbBloomBitsPerKey = 10;
+        config.rocksdbCompressionPerLevel = perLevel;
+        config.rocksdbCompressionLevelCount = 3;
+        config.rocksdbWriteBufferBytes = 4 << 20;
+        config.rocksdbMaxWriteBufferNumber = 3;
+        config.rocksdbMaxBackgroundJobs = 4;
+        config.rocksdbPipelinedWrite = true;
+
+        TEST("RocksDB instances open with a shared block cache...") {
+            const char *errStr = NULL;
+            if (!kvidxOpenWithConfig(a, dirA, &config, &errStr)) {
+                ERR("Open A failed: %s", errStr ? errStr : "unknown");
+            }
+            if (!kvidxOpenWithConfig(b, dirB, &config, &errStr)) {
+                ERR("Open B failed: %s", errStr ? errStr : "unknown");
+            }
+            /* Instances hold their own reference */
+            kvidxRocksdbBlockCacheRelease(cache);
+        }
+
+        TEST("RocksDB WAL-less bulk load survives fsync and reopen...") {
+            config.rocksdbDisableWAL = true;
+            kvidxUpdateConfig(a, &config);
+
+            kvidxBegin(a);
+            for (uint64_t k = 1; k <= 1000; k++) {
+                kvidxInsert(a, k, k, 1, "bulk", 4);
+            }
+            kvidxCommit(a);
+
+            config.rocksdbDisableWAL = false;
+            kvidxUpdateConfig(a, &config);
+            if (!kvidxFsync(a)) {
+                ERRR("Fsync after bulk load failed!");
+            }
+            kvidxClose(a);
+
+            preA = (kvidxInstance){0};
+            a->interface = kvidxInterfaceRocksdb;
+            kvidxOpenWithConfig(a, dirA, &config, NULL);
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(a, &count);
+            if (count != 1000) {
+                ERR("Expected 1000 keys after reopen, got %" PRIu64, count);
+            }
+            if (kvidxExists(a, 1001)) {
+                ERRR("Bloom-filtered lookup found a missing key!");
+            }
+        }
+
+        TEST("RocksDB rejects pipelined + unordered write...") {
+            kvidxInstance preC = {0};
+            preC.interface = kvidxInterfaceRocksdb;
+            kvidxConfig bad = kvidxConfigDefault();
+            bad.rocksdbPipelinedWrite = true;
+            bad.rocksdbUnorderedWrite = true;
+
+            char dirC[64] = {0};
+            snprintf(dirC, sizeof(dirC), "test-rocksdb-tuneC-%d", getpid());
+
+            const char *errStr = NULL;
+            if (kvidxOpenWithConfig(&preC, dirC, &bad, &errStr)) {
+                ERRR("Conflicting write modes should fail to open!");
+                kvidxClose(&preC);
+            }
+            removeDir(dirC);
+        }
+
+        kvidxClose(a);
+        kvidxClose(b);
+        removeDir(dirA);
+        removeDir(dirB);
+    }
+
     /* ================================================================
      * Summary
      * ================================================================ */
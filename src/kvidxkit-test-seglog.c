@@ -0,0 +1,538 @@
+/**
+ * Test suite for the segmented log (seglog) adapter
+ *
+ * The generic interface is exercised by kvidxkit-test-primitives and the
+ * fuzzer through the registry; this suite covers seglog-specific behavior:
+ * - Segment rollover and reopen
+ * - Tail truncation by rewinding the log
+ * - Head compaction by unlinking whole segments
+ * - Recovery from torn records and uncommitted transactions
+ * - Abort and directory locking
+ * - Export and import through the generic stream path
+ */
+
+#include "ctest.h"
+#include "kvidxkit.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/* Helper to recursively remove a directory */
+static int removeDir(const char *path) {
+    DIR *d = opendir(path);
+    if (!d) {
+        return -1;
+    }
+
+    struct dirent *entry;
+    char filepath[512];
+
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, entry->d_name);
+        unlink(filepath);
+    }
+
+    closedir(d);
+    return rmdir(path);
+}
+
+/* Number of segment files in a seglog directory */
+static int countSegments(const char *path) {
+    DIR *d = opendir(path);
+    if (!d) {
+        return -1;
+    }
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len > 4 && strcmp(entry->d_name + len - 4, ".seg") == 0) {
+            count++;
+        }
+    }
+
+    closedir(d);
+    return count;
+}
+
+/* Open with small segments so a few hundred records span several files */
+static bool openSmall(kvidxInstance *i, const char *dirname) {
+    memset(i, 0, sizeof(*i));
+    i->interface = kvidxInterfaceSeglog;
+
+    kvidxConfig config = kvidxConfigDefault();
+    config.seglogSegmentBytes = 4096;
+    return kvidxOpenWithConfig(i, dirname, &config, NULL);
+}
+
+static void fillKeys(kvidxInstance *i, uint64_t from, uint64_t to) {
+    char data[100];
+    kvidxBegin(i);
+    for (uint64_t key = from; key <= to; key++) {
+        memset(data, 'a' + (int)(key % 26), sizeof(data));
+        kvidxInsert(i, key, key, 0, data, sizeof(data));
+    }
+    kvidxCommit(i);
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    uint32_t err = 0;
+
+    printf("=== Seglog Adapter Test Suite ===\n\n");
+
+    /* ================================================================
+     * Segment Rollover and Reopen
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-roll-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Seglog writes roll over into new segments...") {
+            if (!openSmall(i, dirname)) {
+                ERRR("Failed to open seglog");
+            }
+
+            fillKeys(i, 1, 500);
+            if (countSegments(dirname) < 10) {
+                ERR("Expected many 4 KB segments, got %d",
+                    countSegments(dirname));
+            }
+            kvidxClose(i);
+        }
+
+        TEST("Seglog reopen replays every segment...") {
+            if (!openSmall(i, dirname)) {
+                ERRR("Failed to reopen seglog");
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 500) {
+                ERR("Expected 500 keys after reopen, got %" PRIu64, count);
+            }
+
+            for (uint64_t key = 1; key <= 500; key++) {
+                uint64_t term = 0;
+                const uint8_t *data = NULL;
+                size_t len = 0;
+                if (!kvidxGet(i, key, &term, NULL, &data, &len) ||
+                    term != key || len != 100 ||
+                    data[0] != 'a' + (int)(key % 26)) {
+                    ERR("Key %" PRIu64 " did not survive reopen", key);
+                    break;
+                }
+            }
+        }
+
+        TEST("Seglog record larger than a segment gets its own segment...") {
+            size_t bigLen = 10000;
+            uint8_t *big = malloc(bigLen);
+            memset(big, 'Z', bigLen);
+
+            if (!kvidxInsert(i, 501, 1, 0, big, bigLen)) {
+                ERRR("Failed to insert oversized record");
+            }
+
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(i, 501, NULL, NULL, &data, &len) || len != bigLen ||
+                memcmp(data, big, bigLen) != 0) {
+                ERRR("Oversized record did not read back");
+            }
+            free(big);
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Tail Truncation
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-tail-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+        fillKeys(i, 1, 500);
+
+        TEST("Seglog removeAfterNInclusive unlinks tail segments...") {
+            int before = countSegments(dirname);
+            kvidxRemoveAfterNInclusive(i, 101);
+
+            int after = countSegments(dirname);
+            if (after >= before / 2) {
+                ERR("Expected tail segments unlinked: %d -> %d", before,
+                    after);
+            }
+
+            uint64_t maxKey = 0;
+            if (!kvidxMaxKey(i, &maxKey) || maxKey != 100) {
+                ERR("Expected max key 100, got %" PRIu64, maxKey);
+            }
+        }
+
+        TEST("Seglog truncated keys can be rewritten with new terms...") {
+            char data[16] = "rewritten";
+            for (uint64_t key = 101; key <= 150; key++) {
+                if (!kvidxInsert(i, key, 2, 0, data, sizeof(data))) {
+                    ERR("Reinsert of truncated key %" PRIu64 " failed", key);
+                    break;
+                }
+            }
+            kvidxClose(i);
+
+            openSmall(i, dirname);
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 150) {
+                ERR("Expected 150 keys after reopen, got %" PRIu64, count);
+            }
+            if (!kvidxExistsDual(i, 120, 2) || !kvidxExistsDual(i, 100, 100)) {
+                ERRR("Wrong terms after truncate and rewrite");
+            }
+        }
+
+        TEST("Seglog truncation behind an overwrite still removes keys...") {
+            /* Overwriting key 50 blocks rewinding past it; a tombstone is
+             * needed instead and must survive reopen. */
+            kvidxInsertEx(i, 50, 3, 0, "x", 1, KVIDX_SET_ALWAYS);
+            kvidxRemoveAfterNInclusive(i, 40);
+            kvidxClose(i);
+
+            openSmall(i, dirname);
+            uint64_t maxKey = 0;
+            uint64_t count = 0;
+            kvidxMaxKey(i, &maxKey);
+            kvidxGetKeyCount(i, &count);
+            if (maxKey != 39 || count != 39) {
+                ERR("Expected 39 keys ending at 39, got %" PRIu64
+                    " ending at %" PRIu64,
+                    count, maxKey);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Head Compaction
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-head-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+        fillKeys(i, 1, 500);
+
+        TEST("Seglog removeBeforeNInclusive unlinks head segments...") {
+            int before = countSegments(dirname);
+            kvidxRemoveBeforeNInclusive(i, 400);
+
+            int after = countSegments(dirname);
+            if (after >= before / 2) {
+                ERR("Expected head segments unlinked: %d -> %d", before,
+                    after);
+            }
+
+            char first[128];
+            snprintf(first, sizeof(first), "%s/%016x.seg", dirname, 1);
+            if (access(first, F_OK) == 0) {
+                ERRR("First segment should have been unlinked");
+            }
+        }
+
+        TEST("Seglog head compaction survives reopen...") {
+            kvidxClose(i);
+            openSmall(i, dirname);
+
+            uint64_t minKey = 0;
+            uint64_t count = 0;
+            kvidxGetMinKey(i, &minKey);
+            kvidxGetKeyCount(i, &count);
+            if (minKey != 401 || count != 100) {
+                ERR("Expected 100 keys from 401, got %" PRIu64
+                    " from %" PRIu64,
+                    count, minKey);
+            }
+        }
+
+        TEST("Seglog removing every key resets to one segment...") {
+            kvidxRemoveBeforeNInclusive(i, UINT64_MAX);
+            if (countSegments(dirname) != 1) {
+                ERR("Expected one segment, got %d", countSegments(dirname));
+            }
+
+            fillKeys(i, 1000, 1010);
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 11) {
+                ERR("Expected 11 keys after refill, got %" PRIu64, count);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Sparse Keys
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-sparse-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+
+        TEST("Seglog navigation over sparse and out-of-order keys...") {
+            for (uint64_t key = 100; key >= 10; key -= 10) {
+                kvidxInsert(i, key, 1, 0, "s", 1);
+            }
+            kvidxRemove(i, 50);
+
+            uint64_t found = 0;
+            if (!kvidxGetNext(i, 40, &found, NULL, NULL, NULL, NULL) ||
+                found != 60) {
+                ERR("GetNext(40) expected 60, got %" PRIu64, found);
+            }
+            if (!kvidxGetPrev(i, 60, &found, NULL, NULL, NULL, NULL) ||
+                found != 40) {
+                ERR("GetPrev(60) expected 40, got %" PRIu64, found);
+            }
+            if (kvidxExists(i, 55) || !kvidxExists(i, 90)) {
+                ERRR("Exists wrong on sparse keys");
+            }
+
+            uint64_t count = 0;
+            kvidxCountRange(i, 15, 75, &count);
+            if (count != 5) {
+                ERR("CountRange(15, 75) expected 5, got %" PRIu64, count);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Recovery
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-torn-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+        fillKeys(i, 1, 9);
+        kvidxInsert(i, 10, 1, 0, "TORNRECORD", 10);
+        kvidxClose(i);
+
+        TEST("Seglog drops a torn record at the tail...") {
+            /* Corrupt the last record's data in place */
+            char path[128];
+            snprintf(path, sizeof(path), "%s/%016x.seg", dirname,
+                     countSegments(dirname));
+            FILE *fp = fopen(path, "r+b");
+            char buf[4096];
+            size_t got = fp ? fread(buf, 1, sizeof(buf), fp) : 0;
+            for (size_t n = 0; n + 10 <= got; n++) {
+                if (memcmp(buf + n, "TORNRECORD", 10) == 0) {
+                    fseek(fp, (long)n, SEEK_SET);
+                    fputc('X', fp);
+                    break;
+                }
+            }
+            if (fp) {
+                fclose(fp);
+            }
+
+            openSmall(i, dirname);
+            uint64_t maxKey = 0;
+            kvidxMaxKey(i, &maxKey);
+            if (maxKey != 9 || kvidxExists(i, 10)) {
+                ERR("Torn record should be dropped, max key %" PRIu64,
+                    maxKey);
+            }
+
+            if (!kvidxInsert(i, 10, 2, 0, "fresh", 5)) {
+                ERRR("Insert after torn-tail recovery failed");
+            }
+            kvidxClose(i);
+        }
+
+        TEST("Seglog discards a transaction that never committed...") {
+            pid_t pid = fork();
+            if (pid == 0) {
+                kvidxInstance child;
+                openSmall(&child, dirname);
+                kvidxBegin(&child);
+                kvidxRemoveBeforeNInclusive(&child, 5);
+                fillKeys(&child, 11, 20);
+                kvidxBegin(&child);
+                kvidxInsert(&child, 21, 1, 0, "lost", 4);
+                _exit(0); /* Crash: no commit, no close */
+            }
+            waitpid(pid, NULL, 0);
+
+            /* fillKeys() commits, so only key 21 and its txn are pending */
+            openSmall(i, dirname);
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 15 || kvidxExists(i, 21) || !kvidxExists(i, 20)) {
+                ERR("Expected 15 keys without 21, got %" PRIu64, count);
+            }
+            kvidxClose(i);
+        }
+
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Abort and Locking
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-abort-%d", getpid());
+        removeDir(dirname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+        fillKeys(i, 1, 100);
+
+        TEST("Seglog abort undoes appends, overwrites and removals...") {
+            kvidxBegin(i);
+            for (uint64_t key = 101; key <= 300; key++) {
+                kvidxInsert(i, key, key, 0, "txn", 3);
+            }
+            kvidxInsertEx(i, 5, 9, 0, "new", 3, KVIDX_SET_ALWAYS);
+            kvidxRemoveBeforeNInclusive(i, 50);
+            kvidxRemoveAfterNInclusive(i, 80);
+            kvidxAbort(i);
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 100 || !kvidxExistsDual(i, 5, 5)) {
+                ERR("Abort should restore 100 keys, got %" PRIu64, count);
+            }
+
+            kvidxClose(i);
+            openSmall(i, dirname);
+            kvidxGetKeyCount(i, &count);
+            if (count != 100) {
+                ERR("Expected 100 keys after reopen, got %" PRIu64, count);
+            }
+        }
+
+        TEST("Seglog directory is locked while open...") {
+            kvidxInstance other;
+            if (openSmall(&other, dirname)) {
+                ERRR("Second open of a locked seglog should fail");
+                kvidxClose(&other);
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Export and Import
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        char copyname[64] = {0};
+        char filename[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-seglog-export-%d", getpid());
+        snprintf(copyname, sizeof(copyname), "test-seglog-import-%d",
+                 getpid());
+        snprintf(filename, sizeof(filename), "test-seglog-export-%d.bin",
+                 getpid());
+        removeDir(dirname);
+        removeDir(copyname);
+
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+        openSmall(i, dirname);
+        fillKeys(i, 1, 200);
+
+        TEST("Seglog binary export round-trips through import...") {
+            kvidxExportOptions options = kvidxExportOptionsDefault();
+            options.startKey = 50;
+            options.endKey = 150;
+            if (kvidxExport(i, filename, &options, NULL, NULL) != KVIDX_OK) {
+                ERR("Export failed: %s", kvidxGetLastErrorMessage(i));
+            }
+
+            kvidxInstance copy;
+            openSmall(&copy, copyname);
+            if (kvidxImport(&copy, filename, NULL, NULL, NULL) != KVIDX_OK) {
+                ERR("Import failed: %s", kvidxGetLastErrorMessage(&copy));
+            }
+
+            uint64_t count = 0;
+            uint64_t minKey = 0;
+            kvidxGetKeyCount(&copy, &count);
+            kvidxGetMinKey(&copy, &minKey);
+            if (count != 101 || minKey != 50) {
+                ERR("Expected keys 50..150, got %" PRIu64 " from %" PRIu64,
+                    count, minKey);
+            }
+
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(&copy, 77, NULL, NULL, &data, &len) || len != 100 ||
+                data[0] != 'a' + 77 % 26) {
+                ERRR("Imported key 77 has the wrong data");
+            }
+            kvidxClose(&copy);
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+        removeDir(copyname);
+        unlink(filename);
+    }
+
+    /* ================================================================
+     * Summary
+     * ================================================================ */
+    printf("\n=== Seglog Adapter Test Results ===\n");
+    if (err == 0) {
+        printf("All tests passed!\n");
+    } else {
+        printf("FAILED: %u tests failed\n", err);
+    }
+
+    return err ? 1 : 0;
+}
@@ -6,6 +6,7 @@
 #include "ctest.h"
 #include "kvidxkit.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 /* cppcheck-suppress constParameterPointer */
@@ -379,6 +380,504 @@ static void testStatsErrorHandling(uint32_t *err) {
     cleanupTestFile(filename);
 }
 
+/* ====================================================================
+ * TEST SUITE 6: Operation Latency Metrics
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_METRICS
+static bool fileWrite(const void *buf, size_t len, void *streamData) {
+    return fwrite(buf, 1, len, streamData) == len;
+}
+
+static int64_t fileRead(void *buf, size_t len, void *streamData) {
+    const size_t n = fread(buf, 1, len, streamData);
+    return ferror(streamData) ? -1 : (int64_t)n;
+}
+
+static bool acceptEntry(kvidxInstance *i, uint64_t key) {
+    (void)i;
+    (void)key;
+    return true;
+}
+#endif
+
+static void testOperationMetrics(uint32_t *err) {
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), "metrics");
+    cleanupTestFile(filename);
+
+    kvidxMetrics *m = calloc(1, sizeof(*m));
+    if (!m) {
+        ERRR("Failed to allocate metrics");
+        return;
+    }
+
+    TEST("Metrics: Bucket bounds grow and percentiles pick buckets") {
+        for (size_t b = 1; b < KVIDX_METRICS_BUCKETS; b++) {
+            if (kvidxMetricsBucketNanos(b) <= kvidxMetricsBucketNanos(b - 1)) {
+                ERR("Bucket %zu bound does not grow", b);
+                break;
+            }
+        }
+        if (kvidxMetricsBucketNanos(7) != 7 ||
+            kvidxMetricsBucketNanos(KVIDX_METRICS_BUCKETS - 1) != UINT64_MAX) {
+            ERRR("Unexpected bucket bounds");
+        }
+
+        kvidxOpMetrics op = {.count = 100};
+        op.buckets[20] = 90;
+        op.buckets[40] = 10;
+        if (kvidxMetricsPercentile(&op, 50) != kvidxMetricsBucketNanos(20) ||
+            kvidxMetricsPercentile(&op, 90) != kvidxMetricsBucketNanos(20) ||
+            kvidxMetricsPercentile(&op, 99) != kvidxMetricsBucketNanos(40)) {
+            ERRR("Percentiles picked the wrong buckets");
+        }
+        if (strcmp(kvidxOpName(KVIDX_OP_REMOVE_RANGE), "remove_range") != 0 ||
+            strcmp(kvidxOpName(KVIDX_OP_REPLACE_ALL), "replace_all") != 0 ||
+            strcmp(kvidxOpName(KVIDX_OP_COUNT), "unknown") != 0) {
+            ERRR("Unexpected operation names");
+        }
+        for (int op = 0; op < KVIDX_OP_COUNT; op++) {
+            const char *name = kvidxOpName((kvidxOp)op);
+            if (!name || strcmp(name, "unknown") == 0) {
+                ERR("Operation %d has no name", op);
+            }
+        }
+    }
+
+#ifdef KVIDXKIT_HAS_METRICS
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    kvidxConfig config = kvidxConfigDefault();
+    config.metrics = true;
+    if (!kvidxOpenWithConfig(i, filename, &config, NULL)) {
+        ERRR("Failed to open database for metrics tests");
+        free(m);
+        return;
+    }
+
+    TEST("Metrics: Public operations are timed") {
+        kvidxBegin(i);
+        for (uint64_t key = 1; key <= 100; key++) {
+            kvidxInsert(i, key, 1, 0, "metric", 6);
+        }
+        kvidxCommit(i);
+        for (uint64_t key = 1; key <= 100; key++) {
+            kvidxGet(i, key, NULL, NULL, NULL, NULL);
+        }
+
+        if (kvidxGetMetrics(i, m) != KVIDX_OK) {
+            ERRR("GetMetrics failed");
+        }
+        const kvidxOpMetrics *insert = &m->ops[KVIDX_OP_INSERT];
+        const kvidxOpMetrics *get = &m->ops[KVIDX_OP_GET];
+        if (insert->count != 100 || get->count != 100 ||
+            m->ops[KVIDX_OP_BEGIN].count != 1 ||
+            m->ops[KVIDX_OP_COMMIT].count != 1) {
+            ERR("Expected 100 inserts, 100 gets, 1 begin and 1 commit, got "
+                "%" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64,
+                insert->count, get->count, m->ops[KVIDX_OP_BEGIN].count,
+                m->ops[KVIDX_OP_COMMIT].count);
+        }
+
+        uint64_t bucketed = 0;
+        for (size_t b = 0; b < KVIDX_METRICS_BUCKETS; b++) {
+            bucketed += insert->buckets[b];
+        }
+        if (bucketed != insert->count) {
+            ERR("Insert buckets hold %" PRIu64 " calls, count is %" PRIu64,
+                bucketed, insert->count);
+        }
+        if (!insert->sumNanos || insert->sumNanos > 10000000000ULL) {
+            ERR("Implausible insert time %" PRIu64 " ns", insert->sumNanos);
+        }
+        if (kvidxMetricsPercentile(insert, 50) >
+            kvidxMetricsPercentile(insert, 99)) {
+            ERRR("p50 above p99");
+        }
+        if (m->ops[KVIDX_OP_REMOVE].count) {
+            ERRR("Remove was never called but has calls");
+        }
+    }
+
+    TEST("Metrics: Prometheus text") {
+        const size_t len = kvidxMetricsFormatPrometheus(m, NULL, 0);
+        char *text = malloc(len + 1);
+        if (!text) {
+            ERRR("Failed to allocate text");
+        } else {
+            if (kvidxMetricsFormatPrometheus(m, text, len + 1) != len ||
+                strlen(text) != len) {
+                ERRR("Formatted length changed");
+            }
+            if (!strstr(text, "# TYPE kvidx_op_duration_seconds histogram\n") ||
+                !strstr(text, "kvidx_op_duration_seconds_bucket{op=\"insert\","
+                              "le=\"+Inf\"} 100\n") ||
+                !strstr(text, "kvidx_op_duration_seconds_count{op=\"get\"} "
+                              "100\n") ||
+                !strstr(text, "kvidx_op_duration_seconds_sum{op=\"get\"} ")) {
+                ERR("Missing expected lines in:\n%s", text);
+            }
+            if (strstr(text, "op=\"remove\"")) {
+                ERRR("Uncalled operation was formatted");
+            }
+
+            char small[64];
+            if (kvidxMetricsFormatPrometheus(m, small, sizeof(small)) != len ||
+                strlen(small) != sizeof(small) - 1) {
+                ERRR("Truncated output is wrong");
+            }
+            free(text);
+        }
+    }
+
+    TEST("Metrics: Recording follows the runtime setting") {
+        config.metrics = false;
+        kvidxUpdateConfig(i, &config);
+        kvidxGet(i, 1, NULL, NULL, NULL, NULL);
+        kvidxGetMetrics(i, m);
+        if (m->ops[KVIDX_OP_GET].count != 100) {
+            ERR("Disabled metrics still recorded (%" PRIu64 " gets)",
+                m->ops[KVIDX_OP_GET].count);
+        }
+
+        config.metrics = true;
+        kvidxUpdateConfig(i, &config);
+        kvidxGet(i, 1, NULL, NULL, NULL, NULL);
+        kvidxGetMetrics(i, m);
+        if (m->ops[KVIDX_OP_GET].count != 101) {
+            ERR("Re-enabled metrics should keep counting, got %" PRIu64,
+                m->ops[KVIDX_OP_GET].count);
+        }
+    }
+
+    TEST("Metrics: Work counters per operation") {
+        /* Everything so far ran without metricsIo */
+        if (m->ops[KVIDX_OP_GET].io.rowsTouched) {
+            ERRR("Rows counted before metricsIo was set");
+        }
+
+        config.metricsIo = true;
+        kvidxUpdateConfig(i, &config);
+        kvidxBegin(i);
+        for (uint64_t key = 101; key <= 110; key++) {
+            kvidxInsert(i, key, 1, 0, "metric", 6);
+        }
+        kvidxCommit(i);
+        for (uint64_t key = 101; key <= 110; key++) {
+            kvidxGet(i, key, NULL, NULL, NULL, NULL);
+        }
+        kvidxGet(i, 5000, NULL, NULL, NULL, NULL);
+        kvidxRemoveRange(i, 101, 105, true, true, NULL);
+        kvidxCountRange(i, 1, 10, &(uint64_t){0});
+        kvidxGetMetrics(i, m);
+
+        const kvidxIoCounters *insert = &m->ops[KVIDX_OP_INSERT].io;
+        const kvidxIoCounters *commit = &m->ops[KVIDX_OP_COMMIT].io;
+        const kvidxIoCounters *removeRange = &m->ops[KVIDX_OP_REMOVE_RANGE].io;
+        if (insert->rowsTouched != 10 ||
+            m->ops[KVIDX_OP_GET].io.rowsTouched != 10 ||
+            removeRange->rowsTouched != 5 ||
+            m->ops[KVIDX_OP_COUNT_RANGE].io.rowsTouched != 10) {
+            ERR("Expected 10/10/5/10 rows for insert/get/remove_range/"
+                "count_range, got %" PRIu64 "/%" PRIu64 "/%" PRIu64
+                "/%" PRIu64,
+                insert->rowsTouched, m->ops[KVIDX_OP_GET].io.rowsTouched,
+                removeRange->rowsTouched,
+                m->ops[KVIDX_OP_COUNT_RANGE].io.rowsTouched);
+        }
+        if (commit->transactions != 1 || insert->transactions ||
+            removeRange->transactions != 1) {
+            ERR("Expected 1 transaction for commit and the auto-commit "
+                "remove_range, got %" PRIu64 " and %" PRIu64,
+                commit->transactions, removeRange->transactions);
+        }
+        /* The range statements are prepared per call */
+        if (!commit->bytesWritten || !removeRange->stmtsPrepared) {
+            ERR("Expected bytes written at commit (%" PRIu64 ") and a "
+                "statement prepared by remove_range (%" PRIu64 ")",
+                commit->bytesWritten, removeRange->stmtsPrepared);
+        }
+
+        const size_t len = kvidxMetricsFormatPrometheus(m, NULL, 0);
+        char *text = malloc(len + 1);
+        if (text) {
+            kvidxMetricsFormatPrometheus(m, text, len + 1);
+            if (!strstr(text, "# TYPE kvidx_op_rows_touched_total counter\n") ||
+                !strstr(text,
+                        "kvidx_op_rows_touched_total{op=\"insert\"} 10\n") ||
+                !strstr(text,
+                        "kvidx_op_transactions_total{op=\"commit\"} 1\n")) {
+                ERR("Missing work counters in:\n%s", text);
+            }
+            free(text);
+        }
+    }
+
+    TEST("Metrics: Change feed lookups are not counted") {
+        kvidxSubscription *sub = kvidxSubscribe(i, 0);
+        kvidxInsert(i, 200, 1, 0, "metric", 6);
+        kvidxInsertEx(i, 200, 2, 0, "metric", 6, KVIDX_SET_ALWAYS);
+        kvidxRemove(i, 200);
+        kvidxUnsubscribe(i, sub);
+
+        kvidxGetMetrics(i, m);
+        if (m->ops[KVIDX_OP_EXISTS].count) {
+            ERR("Watched writes recorded %" PRIu64 " exists calls",
+                m->ops[KVIDX_OP_EXISTS].count);
+        }
+    }
+
+    TEST("Metrics: Bulk, replication and state machine calls are timed") {
+        FILE *stream = tmpfile();
+        kvidxExportToStream(i, fileWrite, stream, NULL, NULL, NULL);
+        rewind(stream);
+        kvidxReplaceAll(i, fileRead, stream);
+        rewind(stream);
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+        kvidxImportFromStream(i, fileRead, stream, &options, NULL, NULL);
+        fclose(stream);
+
+        stream = tmpfile();
+        kvidxCopyStorageForReplication(i, fileWrite, stream);
+        rewind(stream);
+        kvidxReceiveStorageForReplication(i, fileRead, stream);
+        fclose(stream);
+
+        char exportFile[128];
+        makeTestFilename(exportFile, sizeof(exportFile), "metrics-inc");
+        kvidxExportIncremental(i, exportFile, NULL, NULL, NULL, NULL, NULL);
+        cleanupTestFile(exportFile);
+
+        i->state.applyToStateMachine = acceptEntry;
+        kvidxApplyToStateMachine(i, 1);
+        uint64_t applied = 0;
+        kvidxReplayStateMachine(i, 1, 10, &applied);
+        kvidxVerifyResult verified;
+        kvidxVerify(i, 1, 10, 1, &verified);
+        kvidxRemoveProgress progress = {0};
+        kvidxRemoveRangeIncremental(i, 1, 5, 0, 0, &progress);
+
+        static const kvidxOp timed[] = {
+            KVIDX_OP_EXPORT_STREAM,          KVIDX_OP_IMPORT_STREAM,
+            KVIDX_OP_EXPORT_INCREMENTAL,     KVIDX_OP_COPY_STORAGE,
+            KVIDX_OP_RECEIVE_STORAGE,        KVIDX_OP_REPLACE_ALL,
+            KVIDX_OP_APPLY_TO_STATE_MACHINE, KVIDX_OP_REPLAY_STATE_MACHINE,
+            KVIDX_OP_VERIFY,                 KVIDX_OP_REMOVE_RANGE_INCREMENTAL};
+        kvidxGetMetrics(i, m);
+        for (size_t n = 0; n < sizeof(timed) / sizeof(*timed); n++) {
+            if (m->ops[timed[n]].count != 1) {
+                ERR("Expected one %s call, got %" PRIu64,
+                    kvidxOpName(timed[n]), m->ops[timed[n]].count);
+            }
+        }
+        /* The removal's rows include those of its nested scans */
+        if (m->ops[KVIDX_OP_REPLAY_STATE_MACHINE].io.rowsTouched != applied ||
+            m->ops[KVIDX_OP_REMOVE_RANGE_INCREMENTAL].io.rowsTouched < 5) {
+            ERR("Expected %" PRIu64 " rows replayed and 5 removed, got %" PRIu64
+                " and %" PRIu64,
+                applied, m->ops[KVIDX_OP_REPLAY_STATE_MACHINE].io.rowsTouched,
+                m->ops[KVIDX_OP_REMOVE_RANGE_INCREMENTAL].io.rowsTouched);
+        }
+
+        const size_t len = kvidxMetricsFormatPrometheus(m, NULL, 0);
+        char *text = malloc(len + 1);
+        if (text) {
+            kvidxMetricsFormatPrometheus(m, text, len + 1);
+            if (!strstr(text, "kvidx_op_duration_seconds_count{op=\"replace_all\"} "
+                              "1\n") ||
+                !strstr(text, "kvidx_op_duration_seconds_count{op="
+                              "\"receive_storage\"} 1\n")) {
+                ERR("Missing replication operations in:\n%s", text);
+            }
+            free(text);
+        }
+    }
+
+    kvidxClose(i);
+    cleanupTestFile(filename);
+
+    TEST("Metrics: Nothing is recorded unless enabled") {
+        if (!openFresh(i, filename)) {
+            ERRR("Failed to reopen database");
+        } else {
+            kvidxGet(i, 1, NULL, NULL, NULL, NULL);
+            if (kvidxGetMetrics(i, m) != KVIDX_OK ||
+                m->ops[KVIDX_OP_GET].count) {
+                ERRR("Metrics recorded while disabled");
+            }
+            kvidxClose(i);
+        }
+    }
+#else
+    TEST("Metrics: Not supported when compiled out") {
+        kvidxInstance inst = {0};
+        if (!openFresh(&inst, filename)) {
+            ERRR("Failed to open database");
+        } else {
+            if (kvidxGetMetrics(&inst, m) != KVIDX_ERROR_NOT_SUPPORTED) {
+                ERRR("GetMetrics should be NOT_SUPPORTED");
+            }
+            kvidxClose(&inst);
+        }
+    }
+#endif
+
+    cleanupTestFile(filename);
+    free(m);
+}
+
+/* ====================================================================
+ * TEST SUITE 7: Operation Tracing
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_METRICS
+typedef struct traceSeen {
+    size_t calls;
+    size_t sampled;
+    size_t slow;
+} traceSeen;
+
+static void countTrace(const kvidxTraceRecord *record, void *userData) {
+    traceSeen *seen = userData;
+    seen->calls++;
+    seen->sampled += record->sampled;
+    seen->slow += record->slow;
+}
+#endif
+
+static void testOperationTracing(uint32_t *err) {
+    char filename[128];
+    makeTestFilename(filename, sizeof(filename), "tracing");
+    cleanupTestFile(filename);
+
+#ifdef KVIDXKIT_HAS_METRICS
+    kvidxInstance inst = {0};
+    kvidxInstance *i = &inst;
+    i->interface = kvidxInterfaceSqlite3;
+    traceSeen seen = {0};
+    kvidxConfig config = kvidxConfigDefault();
+    config.traceSlowNanos = 1; /* Everything is slow */
+    config.traceSlowLogSize = 3; /* Rounded up to 4 */
+    config.traceCallback = countTrace;
+    config.traceUserData = &seen;
+    if (!kvidxOpenWithConfig(i, filename, &config, NULL)) {
+        ERRR("Failed to open database for tracing tests");
+        return;
+    }
+
+    kvidxTraceRecord ops[8];
+    size_t count = 0;
+
+    TEST("Tracing: Slow op log keeps the newest operations") {
+        kvidxBegin(i);
+        for (uint64_t key = 1; key <= 3; key++) {
+            kvidxInsert(i, key, 1, 0, "abc", 3);
+        }
+        kvidxCommit(i);
+        const uint8_t *data = NULL;
+        size_t len = 0;
+        kvidxGet(i, 2, NULL, NULL, &data, &len);
+        kvidxRemoveRange(i, 1, 2, true, true, NULL);
+
+        if (seen.calls != 7 || seen.slow != 7 || seen.sampled) {
+            ERR("Expected 7 slow calls, got %zu calls (%zu slow, %zu "
+                "sampled)",
+                seen.calls, seen.slow, seen.sampled);
+        }
+        if (kvidxGetSlowOps(i, ops, 8, &count) != KVIDX_OK || count != 4) {
+            ERR("Expected the last 4 operations, got %zu", count);
+        } else {
+            if (ops[0].op != KVIDX_OP_INSERT || !ops[0].hasKey ||
+                ops[0].key != 3 || ops[0].bytesIn != 3 ||
+                !ops[0].inTransaction) {
+                ERRR("First entry should be the insert of key 3 in a "
+                     "transaction");
+            }
+            if (ops[1].op != KVIDX_OP_COMMIT || ops[1].hasKey) {
+                ERRR("Second entry should be the commit");
+            }
+            if (ops[2].op != KVIDX_OP_GET || ops[2].key != 2 ||
+                ops[2].endKey != 2 || ops[2].rows != 1 ||
+                ops[2].bytesOut != 3 || ops[2].inTransaction) {
+                ERRR("Third entry should be the get of key 2");
+            }
+            if (ops[3].op != KVIDX_OP_REMOVE_RANGE || ops[3].key != 1 ||
+                ops[3].endKey != 2 || ops[3].rows != 2 || !ops[3].slow ||
+                !ops[3].durationNanos || !ops[3].unixNanos ||
+                strcmp(ops[3].adapter, "SQLite3") != 0) {
+                ERRR("Fourth entry should be the range removal");
+            }
+        }
+
+        if (kvidxGetSlowOps(i, ops, 2, &count) != KVIDX_OK || count != 2 ||
+            ops[0].op != KVIDX_OP_GET || ops[1].op != KVIDX_OP_REMOVE_RANGE) {
+            ERRR("A short buffer should get the newest operations");
+        }
+        if (kvidxGetSlowOps(i, NULL, 1, &count) !=
+            KVIDX_ERROR_INVALID_ARGUMENT) {
+            ERRR("NULL ops should be rejected");
+        }
+    }
+
+    TEST("Tracing: One in N operations is sampled") {
+        config.traceSlowNanos = 0;
+        config.traceSampleEvery = 2;
+        kvidxUpdateConfig(i, &config);
+        seen = (traceSeen){0};
+        for (uint64_t n = 0; n < 10; n++) {
+            kvidxGet(i, 3, NULL, NULL, NULL, NULL);
+        }
+        if (seen.calls != 5 || seen.sampled != 5 || seen.slow) {
+            ERR("Expected 5 sampled calls, got %zu (%zu sampled, %zu slow)",
+                seen.calls, seen.sampled, seen.slow);
+        }
+        if (kvidxGetSlowOps(i, ops, 8, &count) != KVIDX_OK || count != 4 ||
+            ops[3].op != KVIDX_OP_REMOVE_RANGE) {
+            ERRR("Sampled calls should not enter the slow op log");
+        }
+    }
+
+    TEST("Tracing: Records format as logfmt") {
+        char line[256];
+        const size_t len = kvidxTraceFormat(&ops[3], line, sizeof(line));
+        if (len != strlen(line) ||
+            !strstr(line, "op=remove_range adapter=SQLite3 key=1 endKey=2 "
+                          "rows=2 bytesIn=0 bytesOut=0 txn=false nanos=") ||
+            !strstr(line, " slow=true sampled=false unixNanos=")) {
+            ERR("Unexpected trace line: %s", line);
+        }
+        if (kvidxTraceFormat(&ops[1], line, sizeof(line)) != strlen(line) ||
+            strstr(line, "key=")) {
+            ERR("Keyless operation formatted with keys: %s", line);
+        }
+        if (kvidxTraceFormat(&ops[3], NULL, 0) != len) {
+            ERRR("Length without a buffer differs");
+        }
+    }
+
+    kvidxClose(i);
+#else
+    TEST("Tracing: Not supported when compiled out") {
+        kvidxInstance inst = {0};
+        kvidxTraceRecord ops[1];
+        size_t count = 1;
+        if (!openFresh(&inst, filename)) {
+            ERRR("Failed to open database");
+        } else {
+            if (kvidxGetSlowOps(&inst, ops, 1, &count) !=
+                    KVIDX_ERROR_NOT_SUPPORTED ||
+                count) {
+                ERRR("GetSlowOps should be NOT_SUPPORTED");
+            }
+            kvidxClose(&inst);
+        }
+    }
+#endif
+
+    cleanupTestFile(filename);
+}
+
 /* ====================================================================
  * MAIN TEST RUNNER
  * ==================================================================== */
@@ -416,6 +915,16 @@ int main(int argc, char *argv[]) {
     testStatsErrorHandling(&err);
     printf("\n");
 
+    printf("Running Suite 6: Operation Latency Metrics\n");
+    printf("-------------------------------------------------------\n");
+    testOperationMetrics(&err);
+    printf("\n");
+
+    printf("Running Suite 7: Operation Tracing\n");
+    printf("-------------------------------------------------------\n");
+    testOperationTracing(&err);
+    printf("\n");
+
     printf("=======================================================\n");
     if (err == 0) {
         printf("ALL STATISTICS TESTS PASSED!\n");
@@ -0,0 +1,529 @@
+/**
+ * Test suite for the tiered hot/cold adapter
+ *
+ * The generic interface is exercised by kvidxkit-test-primitives and the
+ * fuzzer through the registry; this suite covers tiered-specific behavior
+ * with small hot tier limits so keys move between tiers:
+ * - Reads, ordered walks and counts across the hot floor
+ * - Range removal and transaction abort spanning both tiers
+ * - Background flushing, deferred fsync and reopen
+ * - Randomized operations against a reference model
+ */
+
+/* Required for usleep */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "ctest.h"
+#include "kvidxkit.h"
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Helper to recursively remove a directory */
+static int removeDir(const char *path) {
+    DIR *d = opendir(path);
+    if (!d) {
+        return unlink(path);
+    }
+
+    struct dirent *entry;
+    char filepath[512];
+
+    while ((entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, entry->d_name);
+        removeDir(filepath);
+    }
+
+    closedir(d);
+    return rmdir(path);
+}
+
+static kvidxConfig tieredConfig(void) {
+    kvidxConfig config = kvidxConfigDefault();
+#ifdef KVIDXKIT_HAS_SQLITE3
+    config.tieredColdAdapter = "sqlite3";
+#endif
+    config.tieredHotMaxKeys = 100;
+    config.tieredFlushBatchKeys = 16;
+    config.tieredFlushIntervalMs = 10;
+    return config;
+}
+
+static bool openTiered(kvidxInstance *i, const char *dirname,
+                       const kvidxConfig *config) {
+    memset(i, 0, sizeof(*i));
+    i->interface = kvidxInterfaceTiered;
+    return kvidxOpenWithConfig(i, dirname, config, NULL);
+}
+
+#ifdef KVIDXKIT_HAS_SQLITE3
+/* Keys in the cold tier, read through a separate SQLite3 connection */
+static uint64_t coldKeyCount(const char *dirname) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/cold.sqlite3", dirname);
+
+    kvidxInstance cold = {0};
+    cold.interface = kvidxInterfaceSqlite3;
+    uint64_t count = 0;
+    if (kvidxOpen(&cold, path, NULL)) {
+        kvidxGetKeyCount(&cold, &count);
+        kvidxClose(&cold);
+    }
+    return count;
+}
+#endif
+
+/* Deterministic xorshift so failures reproduce */
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+/* Walk the whole store both ways, comparing against the reference */
+static bool matchesReference(kvidxInstance *i, const uint64_t *terms,
+                             uint64_t space) {
+    uint64_t expected = 0;
+    for (uint64_t k = 0; k < space; k++) {
+        expected += terms[k] != 0;
+    }
+
+    uint64_t count = 0;
+    kvidxGetKeyCount(i, &count);
+    if (count != expected) {
+        return false;
+    }
+
+    uint64_t seen = 0;
+    uint64_t key = 0;
+    uint64_t term = 0;
+    bool found = kvidxGet(i, 0, &term, NULL, NULL, NULL);
+    if (found ? terms[0] != term : terms[0] != 0) {
+        return false;
+    }
+    seen += found;
+
+    uint64_t cursor = 0;
+    while (kvidxGetNext(i, cursor, &key, &term, NULL, NULL, NULL)) {
+        if (key >= space || terms[key] != term) {
+            return false;
+        }
+        seen++;
+        cursor = key;
+    }
+
+    if (seen != expected) {
+        return false;
+    }
+
+    seen = 0;
+    cursor = UINT64_MAX;
+    while (kvidxGetPrev(i, cursor, &key, &term, NULL, NULL, NULL)) {
+        if (key >= space || terms[key] != term) {
+            return false;
+        }
+        seen++;
+        cursor = key;
+        if (key == 0) {
+            break;
+        }
+    }
+
+    if (seen != expected) {
+        return false;
+    }
+
+    for (uint32_t q = 0; q < 50; q++) {
+        uint64_t lo = rng() % space;
+        uint64_t hi = lo + rng() % (space - lo);
+        uint64_t want = 0;
+        for (uint64_t k = lo; k <= hi; k++) {
+            want += terms[k] != 0;
+        }
+
+        uint64_t got = 0;
+        bool exists = false;
+        kvidxCountRange(i, lo, hi, &got);
+        kvidxExistsInRange(i, lo, hi, &exists);
+        if (got != want || exists != (want != 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    uint32_t err = 0;
+
+    printf("=== Tiered Adapter Test Suite ===\n\n");
+
+    /* ================================================================
+     * Routing Across the Hot Floor
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-tiered-route-%d", getpid());
+        removeDir(dirname);
+
+        kvidxConfig config = tieredConfig();
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Tiered keeps old keys readable after eviction...") {
+            if (!openTiered(i, dirname, &config)) {
+                ERRR("Failed to open tiered instance");
+            }
+
+            for (uint64_t key = 1; key <= 1000; key++) {
+                char data[32];
+                int len = snprintf(data, sizeof(data), "value-%" PRIu64, key);
+                if (!kvidxInsert(i, key, key * 2, key, data, (size_t)len)) {
+                    ERR("Insert of key %" PRIu64 " failed", key);
+                    break;
+                }
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 1000) {
+                ERR("Expected 1000 keys, got %" PRIu64, count);
+            }
+
+            uint64_t term = 0, cmd = 0;
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(i, 5, &term, &cmd, &data, &len) || term != 10 ||
+                cmd != 5 || len != 7 || memcmp(data, "value-5", 7) != 0) {
+                ERRR("Key 5 did not survive eviction");
+            }
+
+            if (!kvidxGet(i, 999, &term, NULL, NULL, NULL) || term != 1998) {
+                ERRR("Key 999 missing from the hot tier");
+            }
+
+            uint64_t minKey = 0, maxKey = 0;
+            kvidxGetMinKey(i, &minKey);
+            kvidxMaxKey(i, &maxKey);
+            if (minKey != 1 || maxKey != 1000) {
+                ERR("Expected [1, 1000], got [%" PRIu64 ", %" PRIu64 "]",
+                    minKey, maxKey);
+            }
+        }
+
+        TEST("Tiered walks and counts span both tiers...") {
+            uint64_t seen = 0;
+            uint64_t key = 0;
+            uint64_t cursor = 0;
+            while (kvidxGetNext(i, cursor, &key, NULL, NULL, NULL, NULL)) {
+                if (key != cursor + 1) {
+                    ERR("GetNext after %" PRIu64 " returned %" PRIu64, cursor,
+                        key);
+                    break;
+                }
+                seen++;
+                cursor = key;
+            }
+            if (seen != 1000) {
+                ERR("GetNext walk saw %" PRIu64 " keys", seen);
+            }
+
+            seen = 0;
+            cursor = UINT64_MAX;
+            while (kvidxGetPrev(i, cursor, &key, NULL, NULL, NULL, NULL)) {
+                seen++;
+                cursor = key;
+            }
+            if (seen != 1000 || cursor != 1) {
+                ERR("GetPrev walk saw %" PRIu64 " keys ending at %" PRIu64,
+                    seen, cursor);
+            }
+
+            uint64_t count = 0;
+            kvidxCountRange(i, 400, 950, &count);
+            if (count != 551) {
+                ERR("Expected 551 keys in [400, 950], got %" PRIu64, count);
+            }
+        }
+
+        TEST("Tiered range removal spans both tiers...") {
+            uint64_t deleted = 0;
+            kvidxRemoveRange(i, 500, 1000, true, true, &deleted);
+            if (deleted != 501) {
+                ERR("Expected 501 deleted keys, got %" PRIu64, deleted);
+            }
+
+            uint64_t count = 0, maxKey = 0;
+            kvidxGetKeyCount(i, &count);
+            kvidxMaxKey(i, &maxKey);
+            if (count != 499 || maxKey != 499) {
+                ERR("Expected 499 keys ending at 499, got %" PRIu64
+                    " ending at %" PRIu64,
+                    count, maxKey);
+            }
+
+            if (kvidxExists(i, 999) || kvidxExists(i, 500)) {
+                ERRR("Removed keys still visible");
+            }
+
+            if (!kvidxInsert(i, 700, 1, 0, NULL, 0)) {
+                ERRR("Reinserting a removed key failed");
+            }
+            kvidxRemove(i, 700);
+        }
+
+        TEST("Tiered abort restores both tiers...") {
+            kvidxBegin(i);
+            kvidxRemove(i, 3);
+            kvidxInsert(i, 2000, 1, 0, NULL, 0);
+            kvidxRemoveRange(i, 100, 200, true, true, NULL);
+            kvidxAbort(i);
+
+            if (!kvidxExists(i, 3) || !kvidxExists(i, 150) ||
+                kvidxExists(i, 2000)) {
+                ERRR("Abort did not restore the original keys");
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 499) {
+                ERR("Expected 499 keys after abort, got %" PRIu64, count);
+            }
+        }
+
+        TEST("Tiered data survives close and reopen...") {
+            kvidxClose(i);
+            if (!openTiered(i, dirname, &config)) {
+                ERRR("Failed to reopen tiered instance");
+            }
+
+            uint64_t count = 0;
+            kvidxGetKeyCount(i, &count);
+            if (count != 499) {
+                ERR("Expected 499 keys after reopen, got %" PRIu64, count);
+            }
+
+            const uint8_t *data = NULL;
+            size_t len = 0;
+            if (!kvidxGet(i, 42, NULL, NULL, &data, &len) || len != 8 ||
+                memcmp(data, "value-42", 8) != 0) {
+                ERRR("Key 42 lost across reopen");
+            }
+
+            uint64_t maxKey = 0;
+            kvidxMaxKey(i, &maxKey);
+            if (maxKey != 499) {
+                ERR("Expected max key 499 after reopen, got %" PRIu64,
+                    maxKey);
+            }
+        }
+
+        TEST("Tiered rejects unknown cold adapters...") {
+            kvidxInstance other;
+            kvidxConfig bad = config;
+            bad.tieredColdAdapter = "no-such-adapter";
+            if (openTiered(&other, dirname, &bad)) {
+                kvidxClose(&other);
+                ERRR("Opened with an unknown cold adapter");
+            }
+
+            bad.tieredColdAdapter = "tiered";
+            if (openTiered(&other, dirname, &bad)) {
+                kvidxClose(&other);
+                ERRR("Opened with itself as the cold adapter");
+            }
+        }
+
+        kvidxClose(i);
+        removeDir(dirname);
+    }
+
+#ifdef KVIDXKIT_HAS_SQLITE3
+    /* ================================================================
+     * Flushing and Durability
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-tiered-flush-%d", getpid());
+        removeDir(dirname);
+
+        kvidxConfig config = tieredConfig();
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Tiered flushes to the cold tier in the background...") {
+            if (!openTiered(i, dirname, &config)) {
+                ERRR("Failed to open tiered instance");
+            }
+
+            for (uint64_t key = 1; key <= 50; key++) {
+                kvidxInsert(i, key, 1, 0, "x", 1);
+            }
+
+            uint64_t cold = 0;
+            for (int tries = 0; tries < 200 && cold != 50; tries++) {
+                usleep(10000);
+                cold = coldKeyCount(dirname);
+            }
+            if (cold != 50) {
+                ERR("Expected 50 flushed keys, got %" PRIu64, cold);
+            }
+        }
+
+        TEST("Tiered fsync inside a transaction waits for commit...") {
+            /* Large interval and batch so only fsync flushes */
+            kvidxConfig slow = config;
+            slow.tieredFlushBatchKeys = 1000;
+            slow.tieredFlushIntervalMs = 60 * 1000;
+            kvidxUpdateConfig(i, &slow);
+
+            kvidxBegin(i);
+            kvidxInsert(i, 51, 1, 0, "x", 1);
+            kvidxFsync(i);
+            if (coldKeyCount(dirname) != 50) {
+                ERR("%s", "Uncommitted key reached the cold tier");
+            }
+
+            kvidxCommit(i);
+            if (coldKeyCount(dirname) != 51) {
+                ERR("%s", "Commit did not run the deferred fsync");
+            }
+        }
+
+        TEST("Tiered close flushes every key...") {
+            kvidxInsert(i, 52, 1, 0, "x", 1);
+            kvidxRemove(i, 1);
+            kvidxClose(i);
+            if (coldKeyCount(dirname) != 51) {
+                ERR("%s", "Close did not flush pending writes");
+            }
+        }
+
+        removeDir(dirname);
+    }
+#endif
+
+    /* ================================================================
+     * Randomized Reference Comparison
+     * ================================================================ */
+    {
+        char dirname[64] = {0};
+        snprintf(dirname, sizeof(dirname), "test-tiered-random-%d", getpid());
+        removeDir(dirname);
+
+        kvidxConfig config = tieredConfig();
+        config.tieredHotMaxKeys = 64;
+        config.tieredFlushBatchKeys = 8;
+        config.tieredFlushIntervalMs = 1;
+
+        const uint64_t space = 3000;
+        uint64_t *terms = calloc(space, sizeof(*terms));
+        uint64_t *saved = calloc(space, sizeof(*saved));
+        kvidxInstance inst;
+        kvidxInstance *i = &inst;
+
+        TEST("Tiered random operations match a reference model...") {
+            if (!terms || !saved || !openTiered(i, dirname, &config)) {
+                ERRR("Setup failed");
+            }
+
+            bool inTxn = false;
+            for (uint32_t op = 1; op <= 20000; op++) {
+                const uint64_t key = rng() % space;
+                const uint64_t roll = rng() % 100;
+
+                if (roll < 55) {
+                    kvidxInsertEx(i, key, op, 0, &op, sizeof(op),
+                                  KVIDX_SET_ALWAYS);
+                    terms[key] = op;
+                } else if (roll < 80) {
+                    kvidxRemove(i, key);
+                    terms[key] = 0;
+                } else if (roll < 83) {
+                    uint64_t hi = key + rng() % 200;
+                    hi = hi < space ? hi : space - 1;
+                    kvidxRemoveRange(i, key, hi, true, true, NULL);
+                    memset(terms + key, 0, (hi - key + 1) * sizeof(*terms));
+                } else if (roll < 85 && !inTxn) {
+                    kvidxBegin(i);
+                    memcpy(saved, terms, space * sizeof(*terms));
+                    inTxn = true;
+                } else if (roll < 87 && inTxn) {
+                    if (rng() % 2) {
+                        kvidxAbort(i);
+                        memcpy(terms, saved, space * sizeof(*terms));
+                    } else {
+                        kvidxCommit(i);
+                    }
+                    inTxn = false;
+                } else {
+                    uint64_t term = 0;
+                    bool found = kvidxGet(i, key, &term, NULL, NULL, NULL);
+                    if (found != (terms[key] != 0) ||
+                        (found && term != terms[key])) {
+                        ERR("Key %" PRIu64 " mismatch at op %u", key, op);
+                        break;
+                    }
+                }
+
+                if (op % 2500 == 0) {
+                    if (!matchesReference(i, terms, space)) {
+                        ERR("Store diverged from reference at op %u", op);
+                        break;
+                    }
+                }
+
+                if (op % 7000 == 0 && !inTxn) {
+                    kvidxClose(i);
+                    if (!openTiered(i, dirname, &config)) {
+                        ERR("Reopen failed at op %u", op);
+                        break;
+                    }
+                }
+            }
+
+            if (inTxn) {
+                kvidxCommit(i);
+            }
+
+            if (!matchesReference(i, terms, space)) {
+                ERRR("Store diverged from reference at the end");
+            }
+        }
+
+        kvidxClose(i);
+        free(saved);
+        free(terms);
+        removeDir(dirname);
+    }
+
+    /* ================================================================
+     * Summary
+     * ================================================================ */
+    printf("\n=== Tiered Adapter Test Results ===\n");
+    if (err == 0) {
+        printf("All tests passed!\n");
+    } else {
+        printf("FAILED: %u tests failed\n", err);
+    }
+
+    return err ? 1 : 0;
+}
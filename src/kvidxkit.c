@@ -1,4 +1,5 @@
 #include "kvidxkit.h"
+#include "kvidxkit_internal.h"
 
 /* Conditional adapter includes based on compile-time configuration */
 #ifdef KVIDXKIT_HAS_SQLITE3
@@ -13,6 +14,16 @@
 #include "kvidxkitAdapterRocksdb.h"
 #endif
 
+#ifdef KVIDXKIT_HAS_SEGLOG
+#include "kvidxkitAdapterSeglog.h"
+#endif
+#ifdef KVIDXKIT_HAS_MEMORY
+#include "kvidxkitAdapterMemory.h"
+#endif
+#ifdef KVIDXKIT_HAS_TIERED
+#include "kvidxkitAdapterTiered.h"
+#endif
+
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -60,7 +71,21 @@ const kvidxInterface kvidxInterfaceSqlite3 = {
     .setExpireAt = kvidxSqlite3SetExpireAt,
     .getTTL = kvidxSqlite3GetTTL,
     .persist = kvidxSqlite3Persist,
-    .expireScan = kvidxSqlite3ExpireScan};
+    .expireScan = kvidxSqlite3ExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxSqlite3ApplyConfig,
+    .openReader = kvidxSqlite3OpenReader,
+    .scanRange = kvidxSqlite3ScanRange,
+    .verifyRange = kvidxSqlite3VerifyRange,
+    /* Storage Replication (v0.10.0) */
+    .copyStorageForReplication = kvidxSqlite3CopyStorageForReplication,
+    .copyStorageForReplicationReceive =
+        kvidxSqlite3CopyStorageForReplicationReceive,
+    .replaceAll = kvidxSqlite3ReplaceAll,
+    /* Space Reclamation (v0.10.0) */
+    .reclaimSpace = kvidxSqlite3ReclaimSpace,
+    /* Work Counters (v0.10.0) */
+    .ioCounters = kvidxSqlite3IoCounters};
 #endif
 
 /* ====================================================================
@@ -106,7 +131,21 @@ const kvidxInterface kvidxInterfaceLmdb = {
     .setExpireAt = kvidxLmdbSetExpireAt,
     .getTTL = kvidxLmdbGetTTL,
     .persist = kvidxLmdbPersist,
-    .expireScan = kvidxLmdbExpireScan};
+    .expireScan = kvidxLmdbExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxLmdbApplyConfig,
+    .openReader = kvidxLmdbOpenReader,
+    .scanRange = kvidxLmdbScanRange,
+    .verifyRange = kvidxLmdbVerifyRange,
+    /* Storage Replication (v0.10.0) */
+    .copyStorageForReplication = kvidxLmdbCopyStorageForReplication,
+    .copyStorageForReplicationReceive =
+        kvidxLmdbCopyStorageForReplicationReceive,
+    .replaceAll = kvidxLmdbReplaceAll,
+    /* Space Reclamation (v0.10.0) */
+    .reclaimSpace = kvidxLmdbReclaimSpace,
+    /* Work Counters (v0.10.0) */
+    .ioCounters = kvidxLmdbIoCounters};
 #endif
 
 /* ====================================================================
@@ -152,7 +191,167 @@ const kvidxInterface kvidxInterfaceRocksdb = {
     .setExpireAt = kvidxRocksdbSetExpireAt,
     .getTTL = kvidxRocksdbGetTTL,
     .persist = kvidxRocksdbPersist,
-    .expireScan = kvidxRocksdbExpireScan};
+    .expireScan = kvidxRocksdbExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxRocksdbApplyConfig,
+    .openReader = kvidxRocksdbOpenReader,
+    .scanRange = kvidxRocksdbScanRange,
+    .verifyRange = kvidxRocksdbVerifyRange,
+    /* Storage Replication (v0.10.0) */
+    .copyStorageForReplication = kvidxRocksdbCopyStorageForReplication,
+    .copyStorageForReplicationReceive =
+        kvidxRocksdbCopyStorageForReplicationReceive,
+    .replaceAll = kvidxRocksdbReplaceAll,
+    /* Space Reclamation (v0.10.0) */
+    .reclaimSpace = kvidxRocksdbReclaimSpace,
+    /* Work Counters (v0.10.0) */
+    .ioCounters = kvidxRocksdbIoCounters};
+#endif
+
+/* ====================================================================
+ * Seglog Implementation
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_SEGLOG
+const kvidxInterface kvidxInterfaceSeglog = {
+    .begin = kvidxSeglogBegin,
+    .commit = kvidxSeglogCommit,
+    .get = kvidxSeglogGet,
+    .getPrev = kvidxSeglogGetPrev,
+    .getNext = kvidxSeglogGetNext,
+    .exists = kvidxSeglogExists,
+    .existsDual = kvidxSeglogExistsDual,
+    .maxKey = kvidxSeglogMax,
+    .insert = kvidxSeglogInsert,
+    .remove = kvidxSeglogRemove,
+    .removeAfterNInclusive = kvidxSeglogRemoveAfterNInclusive,
+    .removeBeforeNInclusive = kvidxSeglogRemoveBeforeNInclusive,
+    .fsync = kvidxSeglogFsync,
+    .open = kvidxSeglogOpen,
+    .close = kvidxSeglogClose,
+    .getStats = kvidxSeglogGetStats,
+    .getKeyCount = kvidxSeglogGetKeyCount,
+    .getMinKey = kvidxSeglogGetMinKey,
+    .getDataSize = kvidxSeglogGetDataSize,
+    .removeRange = kvidxSeglogRemoveRange,
+    .countRange = kvidxSeglogCountRange,
+    .existsInRange = kvidxSeglogExistsInRange,
+    /* Storage Primitives (v0.8.0) */
+    .insertEx = kvidxSeglogInsertEx,
+    .abort = kvidxSeglogAbort,
+    .getAndSet = kvidxSeglogGetAndSet,
+    .getAndRemove = kvidxSeglogGetAndRemove,
+    .compareAndSwap = kvidxSeglogCompareAndSwap,
+    .append = kvidxSeglogAppend,
+    .prepend = kvidxSeglogPrepend,
+    .getValueRange = kvidxSeglogGetValueRange,
+    .setValueRange = kvidxSeglogSetValueRange,
+    .setExpire = kvidxSeglogSetExpire,
+    .setExpireAt = kvidxSeglogSetExpireAt,
+    .getTTL = kvidxSeglogGetTTL,
+    .persist = kvidxSeglogPersist,
+    .expireScan = kvidxSeglogExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxSeglogApplyConfig};
+#endif
+
+/* ====================================================================
+ * Memory Implementation
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_MEMORY
+const kvidxInterface kvidxInterfaceMemory = {
+    .begin = kvidxMemoryBegin,
+    .commit = kvidxMemoryCommit,
+    .get = kvidxMemoryGet,
+    .getPrev = kvidxMemoryGetPrev,
+    .getNext = kvidxMemoryGetNext,
+    .exists = kvidxMemoryExists,
+    .existsDual = kvidxMemoryExistsDual,
+    .maxKey = kvidxMemoryMax,
+    .insert = kvidxMemoryInsert,
+    .remove = kvidxMemoryRemove,
+    .removeAfterNInclusive = kvidxMemoryRemoveAfterNInclusive,
+    .removeBeforeNInclusive = kvidxMemoryRemoveBeforeNInclusive,
+    .fsync = kvidxMemoryFsync,
+    .open = kvidxMemoryOpen,
+    .close = kvidxMemoryClose,
+    .getStats = kvidxMemoryGetStats,
+    .getKeyCount = kvidxMemoryGetKeyCount,
+    .getMinKey = kvidxMemoryGetMinKey,
+    .getDataSize = kvidxMemoryGetDataSize,
+    .removeRange = kvidxMemoryRemoveRange,
+    .countRange = kvidxMemoryCountRange,
+    .existsInRange = kvidxMemoryExistsInRange,
+    /* Storage Primitives (v0.8.0) */
+    .insertEx = kvidxMemoryInsertEx,
+    .abort = kvidxMemoryAbort,
+    .getAndSet = kvidxMemoryGetAndSet,
+    .getAndRemove = kvidxMemoryGetAndRemove,
+    .compareAndSwap = kvidxMemoryCompareAndSwap,
+    .append = kvidxMemoryAppend,
+    .prepend = kvidxMemoryPrepend,
+    .getValueRange = kvidxMemoryGetValueRange,
+    .setValueRange = kvidxMemorySetValueRange,
+    .setExpire = kvidxMemorySetExpire,
+    .setExpireAt = kvidxMemorySetExpireAt,
+    .getTTL = kvidxMemoryGetTTL,
+    .persist = kvidxMemoryPersist,
+    .expireScan = kvidxMemoryExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxMemoryApplyConfig,
+    /* Iterator read pins (v0.10.0) */
+    .pinReads = kvidxMemoryPinReads,
+    .unpinReads = kvidxMemoryUnpinReads};
+#endif
+
+/* ====================================================================
+ * Tiered Implementation
+ * ==================================================================== */
+#ifdef KVIDXKIT_HAS_TIERED
+const kvidxInterface kvidxInterfaceTiered = {
+    .begin = kvidxTieredBegin,
+    .commit = kvidxTieredCommit,
+    .get = kvidxTieredGet,
+    .getPrev = kvidxTieredGetPrev,
+    .getNext = kvidxTieredGetNext,
+    .exists = kvidxTieredExists,
+    .existsDual = kvidxTieredExistsDual,
+    .maxKey = kvidxTieredMax,
+    .insert = kvidxTieredInsert,
+    .remove = kvidxTieredRemove,
+    .removeAfterNInclusive = kvidxTieredRemoveAfterNInclusive,
+    .removeBeforeNInclusive = kvidxTieredRemoveBeforeNInclusive,
+    .fsync = kvidxTieredFsync,
+    .open = kvidxTieredOpen,
+    .close = kvidxTieredClose,
+    .getStats = kvidxTieredGetStats,
+    .getKeyCount = kvidxTieredGetKeyCount,
+    .getMinKey = kvidxTieredGetMinKey,
+    .getDataSize = kvidxTieredGetDataSize,
+    .removeRange = kvidxTieredRemoveRange,
+    .countRange = kvidxTieredCountRange,
+    .existsInRange = kvidxTieredExistsInRange,
+    .exportData = kvidxTieredExport,
+    .importData = kvidxTieredImport,
+    /* Storage Primitives (v0.8.0) */
+    .insertEx = kvidxTieredInsertEx,
+    .abort = kvidxTieredAbort,
+    .getAndSet = kvidxTieredGetAndSet,
+    .getAndRemove = kvidxTieredGetAndRemove,
+    .compareAndSwap = kvidxTieredCompareAndSwap,
+    .append = kvidxTieredAppend,
+    .prepend = kvidxTieredPrepend,
+    .getValueRange = kvidxTieredGetValueRange,
+    .setValueRange = kvidxTieredSetValueRange,
+    .setExpire = kvidxTieredSetExpire,
+    .setExpireAt = kvidxTieredSetExpireAt,
+    .getTTL = kvidxTieredGetTTL,
+    .persist = kvidxTieredPersist,
+    .expireScan = kvidxTieredExpireScan,
+    /* Configuration (v0.9.0) */
+    .applyConfig = kvidxTieredApplyConfig,
+    /* Iterator read pins (v0.10.0) */
+    .pinReads = kvidxTieredPinReads,
+    .unpinReads = kvidxTieredUnpinReads};
 #endif
 
 /* ====================================================================
@@ -169,91 +368,229 @@ const kvidxInterface kvidxInterfaceRocksdb = {
 #define VERBOSE_TAG()
 #endif
 
+/* Change feed helpers. While nobody is subscribed the wrappers below cost
+ * one NULL check; see kvidxkitChangeFeed.c. */
+static bool watched(const kvidxInstance *i) {
+    return i->changes && kvidxChangeActive(i);
+}
+
+static void changed(kvidxInstance *i, kvidxChangeType type, uint64_t key,
+                    uint64_t endKey, uint64_t term, uint64_t cmd,
+                    const void *data, size_t dataLen) {
+    kvidxChangeRecord(i, type, key, endKey, term, cmd, data, dataLen);
+    kvidxChangePublish(i);
+}
+
+/* Record key's current value after a write that computed it in place */
+static void changedTo(kvidxInstance *i, bool existed, uint64_t key) {
+    uint64_t term = 0;
+    uint64_t cmd = 0;
+    const uint8_t *data = NULL;
+    size_t len = 0;
+    if (kvidxGet(i, key, &term, &cmd, &data, &len)) {
+        changed(i, existed ? KVIDX_CHANGE_UPDATE : KVIDX_CHANGE_INSERT, key,
+                key, term, cmd, data, len);
+    }
+}
+
 bool kvidxOpen(kvidxInstance *i, const char *filename, const char **err) {
     VERBOSE_TAG();
-    return i->interface.open(i, filename, err);
+    KVIDX_PROBE2(open__start, i, filename);
+    if (!i->interface.open(i, filename, err)) {
+        KVIDX_PROBE2(open__done, i, false);
+        return false;
+    }
+    if (kvidxMetricsEnable(i) != KVIDX_OK) {
+        if (err) {
+            *err = kvidxGetLastErrorMessage(i);
+        }
+        kvidxMetricsFree(i);
+        i->interface.close(i);
+        KVIDX_PROBE2(open__done, i, false);
+        return false;
+    }
+    KVIDX_PROBE2(open__done, i, true);
+    return true;
 }
 
 bool kvidxClose(kvidxInstance *i) {
     VERBOSE_TAG();
-    return i->interface.close(i);
+    KVIDX_PROBE1(close__start, i);
+    const bool closed = i->interface.close(i);
+    kvidxChangeFree(i);
+    kvidxMetricsFree(i);
+    i->transactionActive = false;
+    KVIDX_PROBE2(close__done, i, closed);
+    return closed;
 }
 
 bool kvidxBegin(kvidxInstance *i) {
     VERBOSE_TAG();
-    return i->interface.begin(i);
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_BEGIN);
+    const bool began = i->interface.begin(i);
+    kvidxMetricsRecord(i, &span, 0);
+    if (!began) {
+        return false;
+    }
+    i->transactionActive = true;
+    kvidxChangeBegin(i);
+    return true;
 }
 
 bool kvidxCommit(kvidxInstance *i) {
     VERBOSE_TAG();
-    return i->interface.commit(i);
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_COMMIT);
+    const bool committed = i->interface.commit(i);
+    kvidxMetricsRecord(i, &span, 0);
+
+    /* A failed commit leaves its changes pending for a retry or abort */
+    if (!committed) {
+        return false;
+    }
+    i->transactionActive = false;
+    kvidxChangeCommit(i);
+    return true;
 }
 
 bool kvidxGet(kvidxInstance *i, uint64_t key, uint64_t *term, uint64_t *cmd,
               const uint8_t **data, size_t *len) {
     VERBOSE_TAG();
-    return i->interface.get(i, key, term, cmd, data, len);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_GET, key, key, 0);
+    const bool found = i->interface.get(i, key, term, cmd, data, len);
+    kvidxMetricsRecordBytes(i, &span, found, found && len ? *len : 0);
+    return found;
 }
 
 bool kvidxGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
                   uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
                   size_t *len) {
     VERBOSE_TAG();
-    return i->interface.getPrev(i, nextKey, prevKey, prevTerm, cmd, data, len);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_GET_PREV, nextKey, nextKey, 0);
+    const bool found =
+        i->interface.getPrev(i, nextKey, prevKey, prevTerm, cmd, data, len);
+    kvidxMetricsRecordBytes(i, &span, found, found && len ? *len : 0);
+    return found;
 }
 
 bool kvidxGetNext(kvidxInstance *i, uint64_t previousKey, uint64_t *nextKey,
                   uint64_t *nextTerm, uint64_t *cmd, const uint8_t **data,
                   size_t *len) {
     VERBOSE_TAG();
-    return i->interface.getNext(i, previousKey, nextKey, nextTerm, cmd, data,
-                                len);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_GET_NEXT, previousKey, previousKey,
+                              0);
+    const bool found = i->interface.getNext(i, previousKey, nextKey, nextTerm,
+                                            cmd, data, len);
+    kvidxMetricsRecordBytes(i, &span, found, found && len ? *len : 0);
+    return found;
 }
 
 bool kvidxExists(kvidxInstance *i, uint64_t key) {
     VERBOSE_TAG();
-    return i->interface.exists(i, key);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_EXISTS, key, key, 0);
+    const bool found = i->interface.exists(i, key);
+    kvidxMetricsRecord(i, &span, found);
+    return found;
 }
 
 bool kvidxExistsDual(kvidxInstance *i, uint64_t key, uint64_t term) {
     VERBOSE_TAG();
-    return i->interface.existsDual(i, key, term);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_EXISTS_DUAL, key, key, 0);
+    const bool found = i->interface.existsDual(i, key, term);
+    kvidxMetricsRecord(i, &span, found);
+    return found;
 }
 
 bool kvidxMaxKey(kvidxInstance *i, uint64_t *key) {
     VERBOSE_TAG();
-    return i->interface.maxKey(i, key);
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_MAX_KEY);
+    const bool found = i->interface.maxKey(i, key);
+    kvidxMetricsRecord(i, &span, found);
+    return found;
 }
 
 bool kvidxInsert(kvidxInstance *i, uint64_t key, uint64_t term, uint64_t cmd,
                  const void *data, size_t dataLen) {
     VERBOSE_TAG();
-    return i->interface.insert(i, key, term, cmd, data, dataLen);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_INSERT, key, key, dataLen);
+    const bool inserted = i->interface.insert(i, key, term, cmd, data, dataLen);
+    kvidxMetricsRecord(i, &span, inserted);
+    if (!inserted) {
+        return false;
+    }
+    if (i->changes) {
+        changed(i, KVIDX_CHANGE_INSERT, key, key, term, cmd, data, dataLen);
+    }
+    return true;
 }
 
 bool kvidxRemove(kvidxInstance *i, uint64_t key) {
     VERBOSE_TAG();
-    return i->interface.remove(i, key);
+    /* Removing a missing key succeeds, but is not a change */
+    const bool existed = watched(i) && i->interface.exists(i, key);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_REMOVE, key, key, 0);
+    const bool removed = i->interface.remove(i, key);
+    kvidxMetricsRecord(i, &span, removed);
+    if (!removed) {
+        return false;
+    }
+    if (existed) {
+        changed(i, KVIDX_CHANGE_REMOVE, key, key, 0, 0, NULL, 0);
+    }
+    return true;
 }
 
 bool kvidxRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
     VERBOSE_TAG();
-    return i->interface.removeAfterNInclusive(i, key);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_REMOVE_AFTER, key, UINT64_MAX, 0);
+    const bool removed = i->interface.removeAfterNInclusive(i, key);
+    kvidxMetricsRecord(i, &span, 0);
+    if (!removed) {
+        return false;
+    }
+    if (i->changes) {
+        changed(i, KVIDX_CHANGE_REMOVE_RANGE, key, UINT64_MAX, 0, 0, NULL, 0);
+    }
+    return true;
 }
 
 bool kvidxRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
     VERBOSE_TAG();
-    return i->interface.removeBeforeNInclusive(i, key);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_REMOVE_BEFORE, 0, key, 0);
+    const bool removed = i->interface.removeBeforeNInclusive(i, key);
+    kvidxMetricsRecord(i, &span, 0);
+    if (!removed) {
+        return false;
+    }
+    if (i->changes) {
+        changed(i, KVIDX_CHANGE_REMOVE_RANGE, 0, key, 0, 0, NULL, 0);
+    }
+    return true;
 }
 
 bool kvidxFsync(kvidxInstance *i) {
     VERBOSE_TAG();
-    return i->interface.fsync(i);
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_FSYNC);
+    const bool synced = i->interface.fsync(i);
+    kvidxMetricsRecord(i, &span, 0);
+    return synced;
 }
 
 bool kvidxApplyToStateMachine(kvidxInstance *i, uint64_t key) {
     VERBOSE_TAG();
-    return i->state.applyToStateMachine(i, key);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_APPLY_TO_STATE_MACHINE, key, key, 0);
+    const bool applied = i->state.applyToStateMachine(i, key);
+    kvidxMetricsRecord(i, &span, applied);
+    return applied;
 }
 
 /* ====================================================================
@@ -265,10 +602,11 @@ bool kvidxInsertBatch(kvidxInstance *i, const kvidxEntry *entries, size_t count,
     return kvidxInsertBatchEx(i, entries, count, NULL, NULL, insertedCount);
 }
 
-bool kvidxInsertBatchEx(kvidxInstance *i, const kvidxEntry *entries,
-                        size_t count, kvidxBatchCallback callback,
-                        void *userData, size_t *insertedCount) {
-    if (!i || !entries) {
+static bool insertBatchOnce(kvidxInstance *i, const kvidxEntry *entries,
+                            size_t count, kvidxBatchCallback callback,
+                            void *userData, size_t *insertedCount,
+                            bool *commitFailed) {
+    if (!entries) {
         if (insertedCount) {
             *insertedCount = 0;
         }
@@ -323,6 +661,7 @@ bool kvidxInsertBatchEx(kvidxInstance *i, const kvidxEntry *entries,
         if (insertedCount) {
             *insertedCount = 0;
         }
+        *commitFailed = true;
         return false;
     }
 
@@ -333,6 +672,50 @@ bool kvidxInsertBatchEx(kvidxInstance *i, const kvidxEntry *entries,
     return success;
 }
 
+static bool insertBatch(kvidxInstance *i, const kvidxEntry *entries,
+                        size_t count, kvidxBatchCallback callback,
+                        void *userData, size_t *insertedCount) {
+    /* A batch in its own transaction whose commit ran out of space is
+     * replayed once: adapters that can grow (LMDB's map) do so before the
+     * next Begin(). A caller's transaction is theirs to retry. */
+    const bool ownTxn = !i->transactionActive;
+    bool commitFailed = false;
+    kvidxClearError(i);
+    if (insertBatchOnce(i, entries, count, callback, userData, insertedCount,
+                        &commitFailed)) {
+        return true;
+    }
+    if (!ownTxn || !commitFailed ||
+        kvidxGetLastError(i) != KVIDX_ERROR_DISK_FULL) {
+        return false;
+    }
+
+    commitFailed = false;
+    return insertBatchOnce(i, entries, count, callback, userData,
+                           insertedCount, &commitFailed);
+}
+
+bool kvidxInsertBatchEx(kvidxInstance *i, const kvidxEntry *entries,
+                        size_t count, kvidxBatchCallback callback,
+                        void *userData, size_t *insertedCount) {
+    if (!i) {
+        if (insertedCount) {
+            *insertedCount = 0;
+        }
+        return false;
+    }
+
+    /* Entries need not be sorted; the trace reports the first and last */
+    const uint64_t firstKey = entries && count ? entries[0].key : 0;
+    const uint64_t lastKey = entries && count ? entries[count - 1].key : 0;
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_INSERT_BATCH, firstKey, lastKey, 0);
+    const bool inserted =
+        insertBatch(i, entries, count, callback, userData, insertedCount);
+    kvidxMetricsRecord(i, &span, 0);
+    return inserted;
+}
+
 /* ====================================================================
  * Error Handling Implementation
  * ==================================================================== */
@@ -390,7 +773,14 @@ kvidxError kvidxGetStats(kvidxInstance *i, kvidxStats *stats) {
     if (!i || !stats) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
-    return i->interface.getStats(i, stats);
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_GET_STATS);
+    const kvidxError result = i->interface.getStats(i, stats);
+    kvidxMetricsRecord(i, &span, 0);
+    if (result == KVIDX_OK) {
+        stats->pagesReclaimed += i->pagesReclaimed;
+        stats->bytesReclaimed += i->bytesReclaimed;
+    }
+    return result;
 }
 
 kvidxError kvidxGetKeyCount(kvidxInstance *i, uint64_t *count) {
@@ -427,9 +817,58 @@ kvidxConfig kvidxConfigDefault(void) {
         .enableRecursiveTriggers = true,
         .enableForeignKeys = false,
         .readOnly = false,
-        .busyTimeoutMs = 5000, /* 5 seconds */
-        .mmapSizeBytes = 0,    /* Disabled by default */
-        .pageSize = 0          /* Use SQLite default (4096) */
+        .busyTimeoutMs = 5000,    /* 5 seconds */
+        .mmapSizeBytes = 0,       /* Disabled by default */
+        .pageSize = 0,            /* Use SQLite default (4096) */
+        .lmdbValueFormat = 0,     /* Latest format for new LMDB envs */
+        .lmdbMapSizeBytes = 0,    /* 1 GB initial LMDB map */
+        .lmdbMaxMapSizeBytes = 0, /* Unbounded LMDB map growth */
+        .lmdbMapWarnPercent = 0,  /* Warn at 80% of the ceiling */
+        .lmdbMapWarning = NULL,
+        .lmdbMapWarningUserData = NULL,
+        .lmdbWriteMap = false,    /* malloc'd dirty pages */
+        .lmdbMapAsync = false,    /* Synchronous map flush */
+        .lmdbNoMetaSync = false,  /* Sync meta page every commit */
+        .lmdbNoReadAhead = false, /* OS readahead enabled */
+        .lmdbNoMemInit = false,   /* Zero pages before write */
+        .lmdbMaxReaders = 0,      /* LMDB default (126) */
+        .lmdbCompactCopy = false, /* Page-for-page storage copy */
+        .rocksdbBlockCacheBytes = 0,      /* RocksDB default */
+        .rocksdbSharedBlockCache = NULL,  /* Private cache */
+        .rocksdbBloomBitsPerKey = 10,     /* ~1% false positive rate */
+        .rocksdbCompression = KVIDX_COMPRESSION_DEFAULT,
+        .rocksdbCompressionPerLevel = NULL,
+        .rocksdbCompressionLevelCount = 0,
+        .rocksdbWriteBufferBytes = 0,     /* RocksDB default (64 MB) */
+        .rocksdbMaxWriteBufferNumber = 0, /* RocksDB default (2) */
+        .rocksdbMaxBackgroundJobs = 0,    /* RocksDB default (2) */
+        .rocksdbPipelinedWrite = false,
+        .rocksdbUnorderedWrite = false,
+        .rocksdbDisableWAL = false,
+        .rocksdbCompactAfterDeleteKeys = 0, /* 100000 keys */
+        .sqliteWalAutoCheckpoint = 0,        /* SQLite default (1000) */
+        .sqliteBackgroundCheckpoint = false, /* Inline auto-checkpoint */
+        .sqliteCheckpointIdleMs = 0,         /* 100 ms */
+        .sqliteWalSizeLimitBytes = 0,        /* 64 MB */
+        .sqliteBackgroundVacuum = false,     /* Vacuum on request only */
+        .sqliteBackupPagesPerStep = 0,       /* 1024 pages per step */
+        .reclaimPagesPerStep = 0,            /* 1024 pages per step */
+        .lmdbReclaimFreePercent = 0,         /* Compact at 50% free */
+        .seglogSegmentBytes = 0,             /* 16 MB segments */
+        .tieredColdAdapter = NULL,           /* First persistent adapter */
+        .tieredHotMaxKeys = 0,               /* 65536 keys in memory */
+        .tieredHotMaxBytes = 0,              /* 64 MB in memory */
+        .tieredFlushBatchKeys = 0,           /* 4096 keys per flush */
+        .tieredFlushIntervalMs = 0,          /* 1000 ms */
+        .valueChecksums = false,
+        .verifyChecksums = false,
+        .metrics = false,
+        .metricsIo = false,
+        .traceSampleEvery = 0,
+        .traceSlowNanos = 0,
+        .traceSlowLogSize = 0,
+        .traceCallback = NULL,
+        .traceUserData = NULL
     };
     return config;
 }
@@ -484,13 +923,15 @@ kvidxError kvidxUpdateConfig(kvidxInstance *i, const kvidxConfig *config) {
     i->config = *config;
     i->configInitialized = true;
 
-    /* Apply configuration via SQLite adapter (if available) */
-#ifdef KVIDXKIT_HAS_SQLITE3
-    kvidxError err = kvidxSqlite3ApplyConfig(i, config);
-    if (err != KVIDX_OK) {
-        return err;
+    const kvidxError metricsErr = kvidxMetricsEnable(i);
+    if (metricsErr != KVIDX_OK) {
+        return metricsErr;
+    }
+
+    /* Apply configuration via the instance's own adapter */
+    if (i->interface.applyConfig) {
+        return i->interface.applyConfig(i, config);
     }
-#endif
 
     return KVIDX_OK;
 }
@@ -519,8 +960,26 @@ kvidxError kvidxRemoveRange(kvidxInstance *i, uint64_t startKey,
     if (!i) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
-    return i->interface.removeRange(i, startKey, endKey, startInclusive,
-                                    endInclusive, deletedCount);
+
+    /* Adapters may skip counting when nobody asks */
+    uint64_t deleted = 0;
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_REMOVE_RANGE, startKey, endKey, 0);
+    kvidxError result = i->interface.removeRange(
+        i, startKey, endKey, startInclusive, endInclusive,
+        deletedCount || i->changes || kvidxMetricsCounting(&span) ? &deleted
+                                                                   : NULL);
+    kvidxMetricsRecord(i, &span, deleted);
+    if (deletedCount) {
+        *deletedCount = deleted;
+    }
+
+    /* Report the range as the inclusive keys it covered */
+    if (result == KVIDX_OK && deleted && i->changes) {
+        changed(i, KVIDX_CHANGE_REMOVE_RANGE, startKey + !startInclusive,
+                endKey - !endInclusive, 0, 0, NULL, 0);
+    }
+    return result;
 }
 
 kvidxError kvidxCountRange(kvidxInstance *i, uint64_t startKey, uint64_t endKey,
@@ -528,7 +987,12 @@ kvidxError kvidxCountRange(kvidxInstance *i, uint64_t startKey, uint64_t endKey,
     if (!i || !count) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
-    return i->interface.countRange(i, startKey, endKey, count);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_COUNT_RANGE, startKey, endKey, 0);
+    const kvidxError result =
+        i->interface.countRange(i, startKey, endKey, count);
+    kvidxMetricsRecord(i, &span, result == KVIDX_OK ? *count : 0);
+    return result;
 }
 
 kvidxError kvidxExistsInRange(kvidxInstance *i, uint64_t startKey,
@@ -536,7 +1000,68 @@ kvidxError kvidxExistsInRange(kvidxInstance *i, uint64_t startKey,
     if (!i || !exists) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
-    return i->interface.existsInRange(i, startKey, endKey, exists);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_EXISTS_IN_RANGE, startKey, endKey, 0);
+    const kvidxError result =
+        i->interface.existsInRange(i, startKey, endKey, exists);
+    kvidxMetricsRecord(i, &span, result == KVIDX_OK && *exists);
+    return result;
+}
+
+/* Scan for adapters without interface.scanRange */
+static kvidxError scanRangeByGetNext(kvidxInstance *i, uint64_t startKey,
+                                     uint64_t endKey, kvidxScanVisitor visit,
+                                     void *ctx) {
+    uint64_t key = startKey;
+    uint64_t term = 0;
+    uint64_t cmd = 0;
+    const uint8_t *data = NULL;
+    size_t len = 0;
+    bool found = kvidxGet(i, key, &term, &cmd, &data, &len) ||
+                 (key < UINT64_MAX &&
+                  kvidxGetNext(i, key, &key, &term, &cmd, &data, &len));
+
+    while (found && key <= endKey && visit(ctx, key, term, cmd, data, len)) {
+        found = key < endKey &&
+                kvidxGetNext(i, key, &key, &term, &cmd, &data, &len);
+    }
+    return KVIDX_OK;
+}
+
+/* Visitor counting the rows and value bytes an adapter scan hands out,
+ * for metricsIo and tracing */
+typedef struct countedScan {
+    kvidxScanVisitor visit;
+    void *ctx;
+    uint64_t rows;
+    uint64_t bytes;
+} countedScan;
+
+static bool countedScanVisit(void *ctx, uint64_t key, uint64_t term,
+                             uint64_t cmd, const uint8_t *data, size_t len) {
+    countedScan *scan = ctx;
+    scan->rows++;
+    scan->bytes += len;
+    return scan->visit(scan->ctx, key, term, cmd, data, len);
+}
+
+kvidxError kvidxScanRange(kvidxInstance *i, uint64_t startKey,
+                          uint64_t endKey, kvidxScanVisitor visit, void *ctx) {
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_SCAN_RANGE, startKey, endKey, 0);
+    countedScan scan = {.visit = visit, .ctx = ctx, .rows = 0, .bytes = 0};
+    kvidxError result;
+    if (!i->interface.scanRange) {
+        /* Its kvidxGet()/kvidxGetNext() calls count themselves */
+        result = scanRangeByGetNext(i, startKey, endKey, visit, ctx);
+    } else if (kvidxMetricsCounting(&span)) {
+        result = i->interface.scanRange(i, startKey, endKey, countedScanVisit,
+                                        &scan);
+    } else {
+        result = i->interface.scanRange(i, startKey, endKey, visit, ctx);
+    }
+    kvidxMetricsRecordBytes(i, &span, scan.rows, scan.bytes);
+    return result;
 }
 
 /* ====================================================================
@@ -548,7 +1073,10 @@ kvidxExportOptions kvidxExportOptionsDefault(void) {
                                   .startKey = 0,
                                   .endKey = UINT64_MAX,
                                   .includeMetadata = true,
-                                  .prettyPrint = false};
+                                  .prettyPrint = false,
+                                  .binaryVersion = KVIDX_BINARY_VERSION_STREAM,
+                                  .threads = 0,
+                                  .appendOnly = false};
     return options;
 }
 
@@ -557,10 +1085,36 @@ kvidxImportOptions kvidxImportOptionsDefault(void) {
                                       KVIDX_EXPORT_BINARY, /* Auto-detect */
                                   .validateData = true,
                                   .skipDuplicates = false,
-                                  .clearBeforeImport = false};
+                                  .clearBeforeImport = false,
+                                  .threads = 0,
+                                  .commitBytes = KVIDX_IMPORT_COMMIT_BYTES};
     return options;
 }
 
+static kvidxError exportData(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+
+    /* The block layout is written by worker threads over the public API */
+    if (options->format == KVIDX_EXPORT_BINARY &&
+        options->binaryVersion == KVIDX_BINARY_VERSION_BLOCKS) {
+        return kvidxExportBlocks(i, filename, options, callback, userData);
+    }
+
+    /* JSON and CSV go through the shared (vectorized) stream encoder */
+    if (options->format != KVIDX_EXPORT_BINARY) {
+        return kvidxExportToFile(i, filename, options, callback, userData);
+    }
+
+    /* Delegate to backend implementation, else the shared stream encoder */
+    if (i->interface.exportData) {
+        return i->interface.exportData(i, filename, options, callback,
+                                       userData);
+    }
+
+    return kvidxExportToFile(i, filename, options, callback, userData);
+}
+
 kvidxError kvidxExport(kvidxInstance *i, const char *filename,
                        const kvidxExportOptions *options,
                        kvidxProgressCallback callback, void *userData) {
@@ -575,15 +1129,46 @@ kvidxError kvidxExport(kvidxInstance *i, const char *filename,
         options = &defaultOptions;
     }
 
-    /* Delegate to backend implementation */
-    if (i->interface.exportData) {
-        return i->interface.exportData(i, filename, options, callback,
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_EXPORT, options->startKey,
+                              options->endKey, 0);
+    const kvidxError result =
+        exportData(i, filename, options, callback, userData);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+static kvidxError importData(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    if (options->format == KVIDX_EXPORT_BINARY &&
+        kvidxIsBlockExport(filename)) {
+        return kvidxImportBlocks(i, filename, options, callback, userData);
+    }
+
+    /* Incremental exports overwrite existing keys, which the adapters'
+     * binary import paths reject as duplicates */
+    kvidxExportToken token;
+    if (options->format == KVIDX_EXPORT_BINARY &&
+        kvidxReadExportToken(filename, &token) == KVIDX_OK) {
+        return kvidxImportFromFile(i, filename, options, callback, userData);
+    }
+
+    /* JSON and CSV are parsed here and inserted through the public API */
+    if (options->format != KVIDX_EXPORT_BINARY ||
+        kvidxIsTextExport(filename)) {
+        return kvidxImportText(i, filename, options, callback, userData);
+    }
+
+    /* Delegate to backend implementation. Adapter imports write below the
+     * public API, so with subscribers attached import through it instead;
+     * adapters without one always import through it. */
+    if (i->interface.importData && !watched(i)) {
+        return i->interface.importData(i, filename, options, callback,
                                        userData);
     }
 
-    kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
-                  "Export not supported by this backend");
-    return KVIDX_ERROR_NOT_SUPPORTED;
+    return kvidxImportFromFile(i, filename, options, callback, userData);
 }
 
 kvidxError kvidxImport(kvidxInstance *i, const char *filename,
@@ -600,15 +1185,11 @@ kvidxError kvidxImport(kvidxInstance *i, const char *filename,
         options = &defaultOptions;
     }
 
-    /* Delegate to backend implementation */
-    if (i->interface.importData) {
-        return i->interface.importData(i, filename, options, callback,
-                                       userData);
-    }
-
-    kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
-                  "Import not supported by this backend");
-    return KVIDX_ERROR_NOT_SUPPORTED;
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_IMPORT);
+    const kvidxError result =
+        importData(i, filename, options, callback, userData);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
 }
 
 /* ====================================================================
@@ -623,10 +1204,19 @@ bool kvidxAbort(kvidxInstance *i) {
         return false;
     }
     if (i->interface.abort) {
-        return i->interface.abort(i);
+        const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_ABORT);
+        const bool aborted = i->interface.abort(i);
+        kvidxMetricsRecord(i, &span, 0);
+        if (!aborted) {
+            return false;
+        }
+        i->transactionActive = false;
+        kvidxChangeAbort(i);
+        return true;
     }
     /* Default: abort not supported, but succeed if no transaction active */
     if (!i->transactionActive) {
+        kvidxChangeAbort(i);
         return true;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
@@ -644,8 +1234,19 @@ kvidxError kvidxInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.insertEx) {
-        return i->interface.insertEx(i, key, term, cmd, data, dataLen,
-                                     condition);
+        const bool existed = condition == KVIDX_SET_IF_EXISTS ||
+                             (condition == KVIDX_SET_ALWAYS && watched(i) &&
+                              i->interface.exists(i, key));
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_INSERT_EX, key, key, dataLen);
+        kvidxError result = i->interface.insertEx(i, key, term, cmd, data,
+                                                  dataLen, condition);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        if (result == KVIDX_OK && i->changes) {
+            changed(i, existed ? KVIDX_CHANGE_UPDATE : KVIDX_CHANGE_INSERT,
+                    key, key, term, cmd, data, dataLen);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "InsertEx not supported by this backend");
@@ -674,8 +1275,20 @@ kvidxError kvidxGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.getAndSet) {
-        return i->interface.getAndSet(i, key, term, cmd, data, dataLen, oldTerm,
-                                      oldCmd, oldData, oldDataLen);
+        const bool existed = watched(i) && i->interface.exists(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_GET_AND_SET, key, key, dataLen);
+        kvidxError result = i->interface.getAndSet(
+            i, key, term, cmd, data, dataLen, oldTerm, oldCmd, oldData,
+            oldDataLen);
+        kvidxMetricsRecordBytes(
+            i, &span, result == KVIDX_OK,
+            result == KVIDX_OK && oldDataLen ? *oldDataLen : 0);
+        if (result == KVIDX_OK && i->changes) {
+            changed(i, existed ? KVIDX_CHANGE_UPDATE : KVIDX_CHANGE_INSERT,
+                    key, key, term, cmd, data, dataLen);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "GetAndSet not supported by this backend");
@@ -689,7 +1302,16 @@ kvidxError kvidxGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.getAndRemove) {
-        return i->interface.getAndRemove(i, key, term, cmd, data, dataLen);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_GET_AND_REMOVE, key, key, 0);
+        kvidxError result =
+            i->interface.getAndRemove(i, key, term, cmd, data, dataLen);
+        kvidxMetricsRecordBytes(i, &span, result == KVIDX_OK,
+                                result == KVIDX_OK && dataLen ? *dataLen : 0);
+        if (result == KVIDX_OK && i->changes) {
+            changed(i, KVIDX_CHANGE_REMOVE, key, key, 0, 0, NULL, 0);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "GetAndRemove not supported by this backend");
@@ -708,9 +1330,19 @@ kvidxError kvidxCompareAndSwap(kvidxInstance *i, uint64_t key,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.compareAndSwap) {
-        return i->interface.compareAndSwap(i, key, expectedData, expectedLen,
-                                           newTerm, newCmd, newData, newDataLen,
-                                           swapped);
+        const bool existed = watched(i) && i->interface.exists(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_COMPARE_AND_SWAP, key, key,
+                                  expectedLen + newDataLen);
+        kvidxError result = i->interface.compareAndSwap(
+            i, key, expectedData, expectedLen, newTerm, newCmd, newData,
+            newDataLen, swapped);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        if (result == KVIDX_OK && *swapped && i->changes) {
+            changed(i, existed ? KVIDX_CHANGE_UPDATE : KVIDX_CHANGE_INSERT,
+                    key, key, newTerm, newCmd, newData, newDataLen);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "CompareAndSwap not supported by this backend");
@@ -746,8 +1378,18 @@ kvidxError kvidxCompareTermAndSwap(kvidxInstance *i, uint64_t key,
     }
 
     /* Term matches, use data-based CAS with current data as expected */
-    return i->interface.compareAndSwap(i, key, currentData, currentLen, newTerm,
-                                       newCmd, newData, newDataLen, swapped);
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_COMPARE_AND_SWAP, key, key,
+                              currentLen + newDataLen);
+    kvidxError result =
+        i->interface.compareAndSwap(i, key, currentData, currentLen, newTerm,
+                                    newCmd, newData, newDataLen, swapped);
+    kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+    if (result == KVIDX_OK && *swapped && i->changes) {
+        changed(i, KVIDX_CHANGE_UPDATE, key, key, newTerm, newCmd, newData,
+                newDataLen);
+    }
+    return result;
 }
 
 /* --- Append/Prepend --- */
@@ -760,7 +1402,16 @@ kvidxError kvidxAppend(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.append) {
-        return i->interface.append(i, key, term, cmd, data, dataLen, newLen);
+        const bool existed = watched(i) && i->interface.exists(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_APPEND, key, key, dataLen);
+        kvidxError result =
+            i->interface.append(i, key, term, cmd, data, dataLen, newLen);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        if (result == KVIDX_OK && i->changes) {
+            changedTo(i, existed, key);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "Append not supported by this backend");
@@ -775,7 +1426,16 @@ kvidxError kvidxPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.prepend) {
-        return i->interface.prepend(i, key, term, cmd, data, dataLen, newLen);
+        const bool existed = watched(i) && i->interface.exists(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_PREPEND, key, key, dataLen);
+        kvidxError result =
+            i->interface.prepend(i, key, term, cmd, data, dataLen, newLen);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        if (result == KVIDX_OK && i->changes) {
+            changedTo(i, existed, key);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "Prepend not supported by this backend");
@@ -791,8 +1451,14 @@ kvidxError kvidxGetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.getValueRange) {
-        return i->interface.getValueRange(i, key, offset, length, data,
-                                          actualLen);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_GET_VALUE_RANGE, key, key, 0);
+        const kvidxError result = i->interface.getValueRange(
+            i, key, offset, length, data, actualLen);
+        kvidxMetricsRecordBytes(
+            i, &span, result == KVIDX_OK,
+            result == KVIDX_OK && actualLen ? *actualLen : 0);
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "GetValueRange not supported by this backend");
@@ -807,8 +1473,17 @@ kvidxError kvidxSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.setValueRange) {
-        return i->interface.setValueRange(i, key, offset, data, dataLen,
-                                          newLen);
+        const bool existed = watched(i) && i->interface.exists(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_SET_VALUE_RANGE, key, key,
+                                  dataLen);
+        kvidxError result =
+            i->interface.setValueRange(i, key, offset, data, dataLen, newLen);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        if (result == KVIDX_OK && i->changes) {
+            changedTo(i, existed, key);
+        }
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "SetValueRange not supported by this backend");
@@ -823,7 +1498,11 @@ kvidxError kvidxSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.setExpire) {
-        return i->interface.setExpire(i, key, ttlMs);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_SET_EXPIRE, key, key, 0);
+        const kvidxError result = i->interface.setExpire(i, key, ttlMs);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "SetExpire not supported by this backend");
@@ -837,7 +1516,11 @@ kvidxError kvidxSetExpireAt(kvidxInstance *i, uint64_t key,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.setExpireAt) {
-        return i->interface.setExpireAt(i, key, timestampMs);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_SET_EXPIRE, key, key, 0);
+        const kvidxError result = i->interface.setExpireAt(i, key, timestampMs);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        return result;
     }
     kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                   "SetExpireAt not supported by this backend");
@@ -850,7 +1533,11 @@ int64_t kvidxGetTTL(kvidxInstance *i, uint64_t key) {
         return KVIDX_TTL_NOT_FOUND;
     }
     if (i->interface.getTTL) {
-        return i->interface.getTTL(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_GET_TTL, key, key, 0);
+        const int64_t ttl = i->interface.getTTL(i, key);
+        kvidxMetricsRecord(i, &span, ttl != KVIDX_TTL_NOT_FOUND);
+        return ttl;
     }
     /* TTL not supported - check if key exists and return no expiration */
     if (kvidxExists(i, key)) {
@@ -865,7 +1552,11 @@ kvidxError kvidxPersist(kvidxInstance *i, uint64_t key) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.persist) {
-        return i->interface.persist(i, key);
+        const kvidxMetricsSpan span =
+            kvidxMetricsStartKeys(i, KVIDX_OP_PERSIST, key, key, 0);
+        const kvidxError result = i->interface.persist(i, key);
+        kvidxMetricsRecord(i, &span, result == KVIDX_OK);
+        return result;
     }
     /* Persist not supported - check if key exists, then succeed (no-op) */
     if (!kvidxExists(i, key)) {
@@ -881,7 +1572,18 @@ kvidxError kvidxExpireScan(kvidxInstance *i, uint64_t maxKeys,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
     if (i->interface.expireScan) {
-        return i->interface.expireScan(i, maxKeys, expiredCount);
+        /* The adapter notes each key it removes (kvidxChangeNoteExpired) */
+        uint64_t expired = 0;
+        const kvidxMetricsSpan span =
+            kvidxMetricsStart(i, KVIDX_OP_EXPIRE_SCAN);
+        kvidxError result = i->interface.expireScan(i, maxKeys, &expired);
+        kvidxMetricsRecord(i, &span, expired);
+        KVIDX_PROBE3(expire__batch, i, maxKeys, expired);
+        if (expiredCount) {
+            *expiredCount = expired;
+        }
+        kvidxChangePublish(i);
+        return result;
     }
     /* No TTL system, nothing to expire */
     if (expiredCount) {
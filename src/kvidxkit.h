@@ -5,10 +5,12 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "kvidxkitChangeFeed.h"
 #include "kvidxkitConfig.h"
 #include "kvidxkitErrors.h"
 #include "kvidxkitExport.h"
 #include "kvidxkitIterator.h"
+#include "kvidxkitMetrics.h"
 
 __BEGIN_DECLS
 
@@ -18,6 +20,30 @@ struct kvidxInstance;
 /* Pre-declare stats structure */
 typedef struct kvidxStats kvidxStats;
 
+/* Pre-declare batch entry (defined with the batch operations below) */
+struct kvidxEntry;
+
+/* Visitor for kvidxInterface.scanRange; return false to stop the scan.
+ * data is only valid for the duration of the call. */
+typedef bool (*kvidxScanVisitor)(void *ctx, uint64_t key, uint64_t term,
+                                 uint64_t cmd, const uint8_t *data,
+                                 size_t len);
+
+/* Totals from kvidxVerify() */
+typedef struct kvidxVerifyResult {
+    uint64_t entriesChecked;   /* Entries whose checksum matched */
+    uint64_t entriesUnchecked; /* Entries stored without a checksum */
+    uint64_t corruptEntries;   /* Entries whose checksum did not match */
+    uint64_t firstCorruptKey;  /* Lowest such key (if corruptEntries) */
+} kvidxVerifyResult;
+
+/* Outcome of one kvidxReclaimSpace() step */
+typedef struct kvidxReclaimResult {
+    uint64_t pagesFreed;     /* Free pages given back to the file system */
+    uint64_t bytesReclaimed; /* Drop in on-disk size */
+    uint64_t freePagesLeft;  /* Free pages still held by the file */
+} kvidxReclaimResult;
+
 typedef struct kvidxInterface {
     /* CACHE LINE 1 */
     bool (*begin)(struct kvidxInstance *i);
@@ -48,11 +74,18 @@ typedef struct kvidxInterface {
 
     bool (*fsync)(struct kvidxInstance *i);
 
+    /* Native storage copy (optional, v0.10.0; see kvidxkitReplication.c) */
     bool (*copyStorageForReplication)(struct kvidxInstance *i,
-                                      void (*networkWrite)(void *, void *,
-                                                           size_t),
+                                      kvidxStreamWriteCallback networkWrite,
                                       void *networkState);
-    bool (*copyStorageForReplicationReceive)(struct kvidxInstance *i);
+    bool (*copyStorageForReplicationReceive)(
+        struct kvidxInstance *i, kvidxStreamReadCallback networkRead,
+        void *networkState);
+    /* Staged whole-store replacement (optional, v0.10.0; see
+     * kvidxReplaceAll()). Returns KVIDX_ERROR_NOT_SUPPORTED without reading
+     * anything when the storage cannot be swapped. */
+    kvidxError (*replaceAll)(struct kvidxInstance *i,
+                             kvidxStreamReadCallback read, void *streamData);
 
     bool (*copyStorageForBackup)(struct kvidxInstance *i, void *storageTarget);
     bool (*applyToStateMachine)(struct kvidxInstance *i, uint64_t key);
@@ -77,7 +110,7 @@ typedef struct kvidxInterface {
     kvidxError (*existsInRange)(struct kvidxInstance *i, uint64_t startKey,
                                 uint64_t endKey, bool *exists);
 
-    /* Export/Import (v0.6.0) */
+    /* Export/Import (v0.6.0); NULL uses the generic stream path */
     kvidxError (*exportData)(struct kvidxInstance *i, const char *filename,
                              const kvidxExportOptions *options,
                              kvidxProgressCallback callback, void *userData);
@@ -135,11 +168,60 @@ typedef struct kvidxInterface {
     kvidxError (*persist)(struct kvidxInstance *i, uint64_t key);
     kvidxError (*expireScan)(struct kvidxInstance *i, uint64_t maxKeys,
                              uint64_t *expiredCount);
+
+    /* Configuration (v0.9.0) */
+    kvidxError (*applyConfig)(struct kvidxInstance *i,
+                              const kvidxConfig *config);
+
+    /* Iterator read pins (optional, v0.10.0)
+     * While pinned, data pointers already returned stay valid even if
+     * their keys are overwritten or removed. NULL when not supported. */
+    void (*pinReads)(struct kvidxInstance *i);
+    void (*unpinReads)(struct kvidxInstance *i);
+
+    /* Concurrent readers (optional, v0.10.0)
+     * Initializes reader as a read-only handle on i's storage that another
+     * thread may use while i is idle. Every read sees the snapshot taken
+     * when the reader opened. Fails while i has a write transaction open.
+     * Release it with reader->interface.close() before closing i.
+     * NULL when not supported. */
+    bool (*openReader)(struct kvidxInstance *i, struct kvidxInstance *reader);
+
+    /* Range scan (optional, v0.10.0)
+     * Visits [startKey, endKey] in key order with a single statement or
+     * cursor. NULL falls back to Get()/GetNext(). */
+    kvidxError (*scanRange)(struct kvidxInstance *i, uint64_t startKey,
+                            uint64_t endKey, kvidxScanVisitor visit,
+                            void *ctx);
+
+    /* Value checksums (optional, v0.10.0)
+     * Checks the stored checksum of every value in [startKey, endKey] and
+     * adds the outcome to result. NULL when values carry no checksums. */
+    kvidxError (*verifyRange)(struct kvidxInstance *i, uint64_t startKey,
+                              uint64_t endKey, kvidxVerifyResult *result);
+
+    /* Space reclamation (optional, v0.10.0; see kvidxReclaimSpace()).
+     * result arrives zeroed. */
+    kvidxError (*reclaimSpace)(struct kvidxInstance *i, uint64_t maxPages,
+                               kvidxReclaimResult *result);
+
+    /* Work counters (optional, v0.10.0; see kvidxConfig.metricsIo).
+     * Adds the storage engine's running totals since open to counters.
+     * Called before and after every timed operation, so it must be cheap.
+     * The wrappers count rowsTouched and the pages kvidxReclaimSpace()
+     * frees themselves. */
+    void (*ioCounters)(struct kvidxInstance *i, kvidxIoCounters *counters);
 } kvidxInterface;
 
 typedef struct kvidxInterfaceStateMachine {
     bool (*applyToStateMachine)(struct kvidxInstance *i, uint64_t key);
     bool (*resurrectStateMachineFromStorage)(struct kvidxInstance *i);
+
+    /* Batched apply (optional, v0.10.0; see kvidxReplayStateMachine()).
+     * Receives count consecutive entries in key order; their data is only
+     * valid for the duration of the call. Return false to stop the replay. */
+    bool (*applyBatch)(struct kvidxInstance *i,
+                       const struct kvidxEntry *entries, size_t count);
 } kvidxInterfaceStateMachine;
 
 typedef struct kvidxInstance {
@@ -157,6 +239,17 @@ typedef struct kvidxInstance {
     /* Configuration (added in v0.5.0) */
     kvidxConfig config;
     bool configInitialized;
+
+    /* Change feed, NULL until kvidxSubscribe() (added in v0.10.0) */
+    struct kvidxChangeFeed *changes;
+
+    /* Totals from kvidxReclaimSpace(), kept across reopens (v0.10.0) */
+    uint64_t pagesReclaimed;
+    uint64_t bytesReclaimed;
+
+    /* Latency histograms and work counters, NULL until
+     * kvidxConfig.metrics (v0.10.0) */
+    struct kvidxMetricsState *metrics;
 } kvidxInstance;
 
 /* Export identifier for interfaces distributed inside kvidxkit itself.
@@ -171,8 +264,24 @@ extern const kvidxInterface kvidxInterfaceSqlite3;
 extern const kvidxInterface kvidxInterfaceLmdb;
 #endif
 
+#ifdef KVIDXKIT_HAS_SEGLOG
+extern const kvidxInterface kvidxInterfaceSeglog;
+#endif
+#ifdef KVIDXKIT_HAS_MEMORY
+extern const kvidxInterface kvidxInterfaceMemory;
+#endif
+#ifdef KVIDXKIT_HAS_TIERED
+extern const kvidxInterface kvidxInterfaceTiered;
+#endif
+
 #ifdef KVIDXKIT_HAS_ROCKSDB
 extern const kvidxInterface kvidxInterfaceRocksdb;
+
+/* Shared RocksDB block cache. Set kvidxConfig.rocksdbSharedBlockCache to
+ * the same cache for every instance that should share it. Instances hold
+ * their own reference, so the cache may be released once they are open. */
+kvidxBlockCache *kvidxRocksdbBlockCacheCreate(size_t capacityBytes);
+void kvidxRocksdbBlockCacheRelease(kvidxBlockCache *cache);
 #endif
 
 /* Open / Close / Management */
@@ -180,6 +289,9 @@ bool kvidxOpen(kvidxInstance *i, const char *filename, const char **err);
 bool kvidxClose(kvidxInstance *i);
 bool kvidxFsync(kvidxInstance *i);
 
+/* Hand one entry to i->state.applyToStateMachine (which must be set) */
+bool kvidxApplyToStateMachine(kvidxInstance *i, uint64_t key);
+
 /* Transactional Management */
 bool kvidxBegin(struct kvidxInstance *i);
 bool kvidxCommit(struct kvidxInstance *i);
@@ -212,7 +324,7 @@ bool kvidxRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key);
 /**
  * Entry structure for batch operations
  */
-typedef struct {
+typedef struct kvidxEntry {
     uint64_t key;
     uint64_t term;
     uint64_t cmd;
@@ -268,6 +380,33 @@ bool kvidxInsertBatchEx(kvidxInstance *i, const kvidxEntry *entries,
                         size_t count, kvidxBatchCallback callback,
                         void *userData, size_t *insertedCount);
 
+/* ====================================================================
+ * State Machine Replay (Added in v0.10.0)
+ * ==================================================================== */
+
+/**
+ * Apply the stored entries in [startKey, endKey] to the state machine
+ *
+ * A reader thread streams entries in key order into a bounded ring of
+ * batches while the calling thread applies them through
+ * i->state.applyBatch, so reads overlap with applying. Without applyBatch,
+ * i->state.applyToStateMachine is called for each key instead.
+ *
+ * The reader uses a separate handle where the adapter supports it
+ * (interface.openReader); otherwise it takes turns with the apply hook, so
+ * the hook may use i either way. Typically called from
+ * resurrectStateMachineFromStorage.
+ *
+ * @param i Instance handle
+ * @param startKey First key to apply
+ * @param endKey Last key to apply (UINT64_MAX for all)
+ * @param applied Optional: receives the number of entries applied
+ * @return KVIDX_OK, KVIDX_ERROR_CANCELLED if a hook returned false, or
+ *         KVIDX_ERROR_NOT_SUPPORTED if neither hook is set
+ */
+kvidxError kvidxReplayStateMachine(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, uint64_t *applied);
+
 /* ====================================================================
  * Range Operations (Added in v0.5.0)
  * ==================================================================== */
@@ -287,6 +426,76 @@ kvidxError kvidxRemoveRange(kvidxInstance *i, uint64_t startKey,
                             uint64_t endKey, bool startInclusive,
                             bool endInclusive, uint64_t *deletedCount);
 
+/* Most keys kvidxRemoveRangeIncremental() removes in one transaction */
+#define KVIDX_REMOVE_CHUNK_KEYS 4096
+
+/* Resumable cursor for kvidxRemoveRangeIncremental(); zero it to start */
+typedef struct kvidxRemoveProgress {
+    uint64_t nextKey; /* First key not yet removed (resume point); once
+                         done, endKey + 1 (UINT64_MAX if endKey is) */
+    uint64_t removed; /* Keys removed so far, across calls */
+    uint64_t chunks;  /* Transactions committed so far, across calls */
+    bool done;        /* The whole range has been removed */
+} kvidxRemoveProgress;
+
+/**
+ * Remove [startKey, endKey] in short transactions, within a budget
+ *
+ * Removes chunks of at most KVIDX_REMOVE_CHUNK_KEYS keys, each committed on
+ * its own through kvidxRemoveRange(), so other writers wait for one chunk
+ * at most instead of the whole range. Returns once the range is gone or
+ * after the chunk that used up either budget (at least one chunk runs per
+ * call). Call again with the same range and progress to continue, e.g.
+ * between appends:
+ *
+ *     kvidxRemoveProgress progress = {0};
+ *     while (!progress.done) {
+ *         kvidxRemoveRangeIncremental(i, 1, snapshotIndex, 0, 2000,
+ *                                     &progress);
+ *         appendPendingEntries(i);
+ *     }
+ *
+ * @param i Instance handle (not inside a transaction)
+ * @param startKey Start of range (inclusive)
+ * @param endKey End of range (inclusive)
+ * @param budgetKeys Stop after removing this many keys (0 = no limit)
+ * @param budgetMicros Stop after this much time (0 = no limit)
+ * @param progress Cursor, updated after every chunk
+ * @return KVIDX_OK when the call's budget or the range ran out (see
+ *         progress->done), error code on failure (progress->nextKey is the
+ *         first key of the failed chunk)
+ */
+kvidxError kvidxRemoveRangeIncremental(kvidxInstance *i, uint64_t startKey,
+                                       uint64_t endKey, uint64_t budgetKeys,
+                                       uint64_t budgetMicros,
+                                       kvidxRemoveProgress *progress);
+
+/**
+ * Return space freed by removed keys to the file system, one bounded step
+ *
+ * Removing keys leaves the files their size: SQLite and LMDB keep freed
+ * pages for reuse and RocksDB keeps tombstones until compaction. Each step:
+ * - SQLite: PRAGMA incremental_vacuum of up to maxPages pages, then a
+ *   PASSIVE checkpoint so the file shrinks. Needs a database created with
+ *   incremental auto_vacuum, which new databases are.
+ * - LMDB: once free pages reach kvidxConfig.lmdbReclaimFreePercent of the
+ *   file, a compacting copy replaces data.mdb (maxPages is not used; the
+ *   copy is one step). Readers must be closed first.
+ * - RocksDB: compacts the key ranges removed since the last step that
+ *   were too small to be compacted right away.
+ * Call repeatedly, e.g. from a maintenance timer, until
+ * result->freePagesLeft is 0. Totals appear in kvidxStats.
+ *
+ * @param i Instance handle (not inside a transaction)
+ * @param maxPages Most pages to free in this step (0 =
+ *        kvidxConfig.reclaimPagesPerStep)
+ * @param result Optional: receives what this step reclaimed
+ * @return KVIDX_OK (also when there was nothing to reclaim), or
+ *         KVIDX_ERROR_NOT_SUPPORTED if the adapter cannot shrink its files
+ */
+kvidxError kvidxReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                             kvidxReclaimResult *result);
+
 /**
  * Count keys in specified range
  *
@@ -311,6 +520,24 @@ kvidxError kvidxCountRange(kvidxInstance *i, uint64_t startKey, uint64_t endKey,
 kvidxError kvidxExistsInRange(kvidxInstance *i, uint64_t startKey,
                               uint64_t endKey, bool *exists);
 
+/**
+ * Check stored value checksums in specified range
+ *
+ * Values written with kvidxConfig.valueChecksums carry a CRC32C; this
+ * recomputes it for every value in the range. The range is split across
+ * threads, each reading through its own interface.openReader handle.
+ *
+ * @param i Instance handle
+ * @param startKey Start of range (inclusive)
+ * @param endKey End of range (inclusive)
+ * @param threads Threads to use (0 = one per CPU)
+ * @param result Receives entry counts and the first corrupt key
+ * @return KVIDX_OK if every checksum matched, KVIDX_ERROR_CORRUPT if any
+ *         did not, KVIDX_ERROR_NOT_SUPPORTED if the adapter stores none
+ */
+kvidxError kvidxVerify(kvidxInstance *i, uint64_t startKey, uint64_t endKey,
+                       uint32_t threads, kvidxVerifyResult *result);
+
 /* ====================================================================
  * Error Handling (Added in v0.4.0)
  * ==================================================================== */
@@ -365,6 +592,15 @@ struct kvidxStats {
     uint64_t pageCount;        /**< Total pages */
     uint64_t pageSize;         /**< Page size in bytes */
     uint64_t freePages;        /**< Free pages */
+
+    /* Background WAL checkpointer (SQLite, v0.9.0) */
+    uint64_t checkpointCount;      /**< Checkpoints run */
+    uint64_t lastCheckpointMicros; /**< Duration of the last checkpoint */
+    uint64_t maxCheckpointMicros;  /**< Longest checkpoint */
+
+    /* Space reclamation (v0.10.0) */
+    uint64_t pagesReclaimed; /**< Free pages given back to the file system */
+    uint64_t bytesReclaimed; /**< On-disk bytes given back */
 };
 
 /**
@@ -477,6 +713,194 @@ kvidxError kvidxImport(kvidxInstance *i, const char *filename,
                        const kvidxImportOptions *options,
                        kvidxProgressCallback callback, void *userData);
 
+/* ====================================================================
+ * Streaming Export/Import API (Added in v0.10.0)
+ * ==================================================================== */
+
+/**
+ * Export database to a caller-supplied sink
+ *
+ * Produces the same bytes as kvidxExport() (binary, JSON or CSV), written
+ * in chunks of up to KVIDX_STREAM_BUFFER_BYTES, so a snapshot can go
+ * straight to a pipe or socket without a temporary file. Works with every
+ * adapter: entries are read through kvidxGet()/kvidxGetNext().
+ *
+ * @param i Instance handle
+ * @param write Sink callback
+ * @param streamData Context for the sink
+ * @param options Export options (NULL for defaults)
+ * @param callback Optional progress callback
+ * @param userData User data for progress callback
+ * @return KVIDX_OK on success, KVIDX_ERROR_IO if the sink failed
+ */
+kvidxError kvidxExportToStream(kvidxInstance *i, kvidxStreamWriteCallback write,
+                               void *streamData,
+                               const kvidxExportOptions *options,
+                               kvidxProgressCallback callback, void *userData);
+
+/**
+ * Export database to a file descriptor (file, pipe or socket)
+ *
+ * The descriptor is written from its current position and left open.
+ * Writing to a closed pipe or socket raises SIGPIPE unless it is ignored.
+ *
+ * @see kvidxExportToStream
+ */
+kvidxError kvidxExportToFd(kvidxInstance *i, int fd,
+                           const kvidxExportOptions *options,
+                           kvidxProgressCallback callback, void *userData);
+
+/**
+ * Import a binary export from a caller-supplied source
+ *
+ * Reads in chunks of KVIDX_STREAM_BUFFER_BYTES and inserts inside one
+ * transaction, rolled back on any error. Values are inserted straight from
+ * the read buffer. The source is read ahead, so bytes following the export
+ * may be consumed; give the import a stream of its own.
+ *
+ * JSON and CSV import return KVIDX_ERROR_NOT_SUPPORTED.
+ *
+ * @param i Instance handle
+ * @param read Source callback
+ * @param streamData Context for the source
+ * @param options Import options (NULL for defaults)
+ * @param callback Optional progress callback
+ * @param userData User data for progress callback
+ * @return KVIDX_OK on success, error code on failure
+ */
+kvidxError kvidxImportFromStream(kvidxInstance *i, kvidxStreamReadCallback read,
+                                 void *streamData,
+                                 const kvidxImportOptions *options,
+                                 kvidxProgressCallback callback,
+                                 void *userData);
+
+/**
+ * Import a binary export from a file descriptor (file, pipe or socket)
+ *
+ * The descriptor is read from its current position and left open.
+ *
+ * @see kvidxImportFromStream
+ */
+kvidxError kvidxImportFromFd(kvidxInstance *i, int fd,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+
+/* ====================================================================
+ * Incremental Export API (Added in v0.10.0)
+ * ==================================================================== */
+
+/**
+ * Export only what changed since an earlier export
+ *
+ * With since == NULL, exports every entry in [options->startKey,
+ * options->endKey]. Otherwise continues from an earlier token (see
+ * kvidxExportToken): a cancelled export resumes where it stopped, and a
+ * finished one is followed by a pass writing only new keys and keys
+ * rewritten with a newer term. Removed keys are not tracked.
+ *
+ * Changed entries can be anywhere in the range, so every pass scans from
+ * startKey; set options->appendOnly to skip straight to the new keys.
+ *
+ * The file uses KVIDX_BINARY_VERSION_INCREMENTAL, with the resulting token
+ * in its header. If callback returns false the export stops, the file is
+ * finalized with an incomplete token and KVIDX_ERROR_CANCELLED is returned.
+ * Importing the files in order reproduces the range (kvidxImport()
+ * overwrites keys that already exist).
+ *
+ * @param i Instance handle
+ * @param filename Output filename
+ * @param options Key range and appendOnly (NULL for defaults; binary only)
+ * @param since Token of the previous export (NULL for a full export)
+ * @param token Receives the new token (may be NULL)
+ * @param callback Optional progress callback (current = entries scanned)
+ * @param userData User data for progress callback
+ * @return KVIDX_OK, KVIDX_ERROR_CANCELLED, or an error code on failure
+ */
+kvidxError kvidxExportIncremental(kvidxInstance *i, const char *filename,
+                                  const kvidxExportOptions *options,
+                                  const kvidxExportToken *since,
+                                  kvidxExportToken *token,
+                                  kvidxProgressCallback callback,
+                                  void *userData);
+
+/**
+ * Read the token from the header of an incremental export
+ *
+ * @param filename Export written by kvidxExportIncremental()
+ * @param token Receives the token
+ * @return KVIDX_OK, KVIDX_ERROR_IO if unreadable, or
+ *         KVIDX_ERROR_INVALID_ARGUMENT if not an incremental export
+ */
+kvidxError kvidxReadExportToken(const char *filename, kvidxExportToken *token);
+
+/* ====================================================================
+ * Replication API (Added in v0.10.0)
+ * ==================================================================== */
+
+/**
+ * Stream a consistent copy of the whole storage, e.g. to seed a follower
+ *
+ * SQLite, LMDB and RocksDB send their native files: an online backup
+ * (kvidxConfig.sqliteBackupPagesPerStep pages at a time), an environment
+ * copy (lmdbCompactCopy) or a checkpoint. Writers are not blocked for the
+ * duration. Other adapters send a binary export. Output is written in
+ * chunks of up to KVIDX_STREAM_BUFFER_BYTES.
+ *
+ * @param i Instance handle (not inside a transaction)
+ * @param networkWrite Sink callback
+ * @param networkState Context for the sink
+ * @return KVIDX_OK on success, KVIDX_ERROR_IO if the sink or copy failed
+ */
+kvidxError kvidxCopyStorageForReplication(kvidxInstance *i,
+                                          kvidxStreamWriteCallback networkWrite,
+                                          void *networkState);
+
+/**
+ * Replace the storage of i with a stream from kvidxCopyStorageForReplication()
+ *
+ * Native copies are received into a staging location next to the storage,
+ * verified, then installed with a rename and the instance reopened with
+ * its configuration; on failure the existing storage is left untouched.
+ * The sender must use the same adapter. A binary export (from adapters
+ * without a native copy) is imported into any adapter, replacing all
+ * entries in one transaction.
+ *
+ * @param i Instance handle (not inside a transaction)
+ * @param networkRead Source callback
+ * @param networkState Context for the source
+ * @return KVIDX_OK on success, KVIDX_ERROR_INVALID_ARGUMENT if the stream
+ *         is not a replication stream for this adapter, error code on
+ *         failure
+ */
+kvidxError kvidxReceiveStorageForReplication(kvidxInstance *i,
+                                             kvidxStreamReadCallback networkRead,
+                                             void *networkState);
+
+/**
+ * Replace every entry with the contents of a binary export stream
+ *
+ * Installs a raft snapshot in one step. SQLite, LMDB and RocksDB import the
+ * stream into new storage next to the existing one (a database file, an
+ * environment or a database directory), loaded without a journal and
+ * synced once at the end, then install it with a rename and reopen the
+ * instance with its configuration. The instance never holds part of each
+ * set, and a bad stream leaves the old entries untouched. Other adapters,
+ * and in-memory SQLite, import with clearBeforeImport in a single
+ * transaction instead.
+ *
+ * Subscriptions (kvidxSubscribe()) are not told about a staged replacement.
+ *
+ * @param i Instance handle (not inside a transaction)
+ * @param read Source of a kvidxExportToStream() binary export
+ * @param streamData Context for the source
+ * @return KVIDX_OK on success, error code on failure
+ *
+ * @note Handles from interface.openReader keep the old storage open;
+ *       close them before calling
+ */
+kvidxError kvidxReplaceAll(kvidxInstance *i, kvidxStreamReadCallback read,
+                           void *streamData);
+
 /* ====================================================================
  * Storage Primitives API (Added in v0.8.0)
  * ==================================================================== */
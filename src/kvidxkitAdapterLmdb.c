@@ -22,17 +22,33 @@
  *    data.mdb and lock.mdb files, rather than a single file like SQLite.
  *
  * 4. **Named Databases**: Multiple B-trees can exist within one environment.
- *    We use "_kvidx_data" for the main data and "_kvidx_ttl" for TTL metadata.
+ *    We use "_kvidx_data" for the main data, "_kvidx_ttl" for TTL metadata,
+ *    and "_kvidx_meta" for the environment's value format version.
  *
  * ## Value Format
  *
- * Values are stored in a packed binary format:
+ * Values are stored in a packed binary format. Two versions exist; the
+ * version is recorded once per environment in the "_kvidx_meta" database
+ * and never changes after creation.
+ *
+ * Version 1 (environments created before the format record existed):
  *   - Bytes 0-7:   term (uint64_t, native endian)
  *   - Bytes 8-15:  cmd (uint64_t, native endian)
  *   - Bytes 16+:   data blob
  *
+ * Version 2 (default for new environments):
+ *   - Bytes 0-7:   term (uint64_t, native endian)
+ *   - Bytes 8-15:  cmd (uint64_t, native endian)
+ *   - Byte 16:     flags (VALUE_FLAG_*)
+ *   - Bytes 17-24: expiresAt in ms (only if VALUE_FLAG_HAS_EXPIRY)
+ *   - Next 4:      CRC32C of term, cmd and data (only if
+ *                  VALUE_FLAG_HAS_CHECKSUM)
+ *   - Remaining:   data blob
+ *
  * This allows extracting metadata without parsing, while keeping all record
- * information in a single LMDB value.
+ * information in a single LMDB value. With v2, a key's expiry is known as
+ * soon as its value is fetched, so TTL checks need no "_kvidx_ttl" lookup.
+ * "_kvidx_ttl" is then only an index of expiring keys for ExpireScan().
  *
  * ## Transaction Model
  *
@@ -76,23 +92,66 @@
  * - Space: Copy-on-write means deleted space isn't immediately reclaimed
  */
 
+/* Required for strdup, clock_gettime, pipe and pthread_sigmask under
+ * -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "kvidxkitAdapterLmdb.h"
 #include "../deps/lmdb/libraries/liblmdb/lmdb.h"
+#include "kvidxkit_internal.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 /** Size of term + cmd header prefixed to all values */
 #define VALUE_HEADER_SIZE (sizeof(uint64_t) * 2)
 
+/** Size of the v2 header: term + cmd + flags byte (expiry follows if set) */
+#define VALUE_HEADER_SIZE_V2 (VALUE_HEADER_SIZE + 1)
+
+/** Value format versions, recorded per-environment in "_kvidx_meta" */
+#define LMDB_VALUE_FORMAT_V1 1 /**< term | cmd | data */
+#define LMDB_VALUE_FORMAT_V2                                                   \
+    2 /**< term | cmd | flags | [expiresAt] | [crc] | data */
+
+/** v2 flags byte: an 8-byte expiry timestamp (ms) follows the flags */
+#define VALUE_FLAG_HAS_EXPIRY 0x01
+
+/** v2 flags byte: a 4-byte CRC32C follows the flags (and expiry) */
+#define VALUE_FLAG_HAS_CHECKSUM 0x02
+
+/** Key in "_kvidx_meta" holding the environment's value format version */
+#define META_KEY_VALUE_FORMAT "valueFormat"
+
 /** Default memory map size: 1GB. LMDB pre-allocates address space but not disk.
  */
 #define DEFAULT_MAP_SIZE (1UL << 30)
 
+/** Keep at least 1/MAP_HEADROOM_DIVISOR of the map free before a write txn */
+#define MAP_HEADROOM_DIVISOR 8
+
+/** Default map fill percentage that triggers kvidxConfig.lmdbMapWarning */
+#define DEFAULT_MAP_WARN_PERCENT 80
+
+/** Default free share of data.mdb at which reclaiming compacts it */
+#define DEFAULT_RECLAIM_FREE_PERCENT 50
+
+/** Environment flags LMDB allows toggling on an open environment */
+#define RUNTIME_ENV_FLAGS                                                      \
+    (MDB_NOSYNC | MDB_NOMETASYNC | MDB_MAPASYNC | MDB_NOMEMINIT)
+
 /**
  * Internal state for an LMDB-backed kvidx instance.
  *
@@ -103,10 +162,24 @@ typedef struct lmdbState {
     MDB_env *env;   /**< LMDB environment handle (the database) */
     MDB_dbi dbi;    /**< Database handle for main data ("_kvidx_data") */
     MDB_dbi ttlDbi; /**< Database handle for TTL metadata ("_kvidx_ttl") */
+    MDB_dbi metaDbi; /**< Database handle for format metadata ("_kvidx_meta") */
     bool ttlDbiInitialized; /**< Whether TTL database has been opened */
+    uint32_t valueFormat;   /**< LMDB_VALUE_FORMAT_V1 or LMDB_VALUE_FORMAT_V2 */
     MDB_txn *readTxn;  /**< Persistent read transaction for zero-copy reads */
     MDB_txn *writeTxn; /**< Active write transaction (NULL when not in txn) */
     char *envPath;     /**< Path to environment directory */
+    uint64_t pageSize; /**< Environment page size (for map fill accounting) */
+    uint64_t txnStartPage; /**< me_last_pgno when the write txn began */
+    uint64_t maxTxnPages;  /**< Most pages a committed write txn consumed */
+    bool mapFull;   /**< MDB_MAP_FULL seen; grow before the next write txn */
+    bool mapWarned; /**< Fill warning delivered; re-armed when fill drops */
+    bool sharedEnv; /**< Reader borrowing env and dbis from another state */
+    struct lmdbState *owner; /**< State a reader borrows from (sharedEnv) */
+    uint32_t readers; /**< Open readers; their snapshots pin the map */
+    bool writeChecksums;  /**< kvidxConfig.valueChecksums (v2 only) */
+    bool verifyChecksums; /**< kvidxConfig.verifyChecksums */
+    uint64_t transactions; /**< Write txns committed, or aborted by Abort() */
+    uint64_t fsyncs;       /**< Syncs issued by those commits and Fsync() */
 } lmdbState;
 
 #define STATE(instance) ((lmdbState *)(instance)->kvidxdata)
@@ -116,6 +189,9 @@ typedef struct lmdbState {
  * ====================================================================
  * LMDB stores each record as a single key-value pair. We pack term, cmd,
  * and data into the value with a fixed header for efficient extraction.
+ *
+ * term and cmd live at the same offsets in both value formats, so only the
+ * data offset (and the inline expiry) depend on the environment's format.
  */
 
 /**
@@ -148,6 +224,68 @@ static inline uint64_t extractCmd(const MDB_val *val) {
     return cmd;
 }
 
+/**
+ * Extract the v2 flags byte from a packed LMDB value.
+ *
+ * @param s    LMDB state (determines value format)
+ * @param val  LMDB value containing packed data
+ * @return The flags byte, or 0 for v1 values and malformed values
+ */
+static inline uint8_t extractFlags(const lmdbState *s, const MDB_val *val) {
+    if (s->valueFormat < LMDB_VALUE_FORMAT_V2 ||
+        val->mv_size < VALUE_HEADER_SIZE_V2) {
+        return 0;
+    }
+    return ((const uint8_t *)val->mv_data)[VALUE_HEADER_SIZE];
+}
+
+/**
+ * Compute the header size of a packed LMDB value.
+ *
+ * v1 headers are always term + cmd. v2 headers add the flags byte plus an
+ * 8-byte expiry when VALUE_FLAG_HAS_EXPIRY is set and a 4-byte checksum
+ * when VALUE_FLAG_HAS_CHECKSUM is set.
+ *
+ * @param s    LMDB state (determines value format)
+ * @param val  LMDB value containing packed data
+ * @return Header size in bytes (never larger than the value itself)
+ */
+static inline size_t valueHeaderSize(const lmdbState *s, const MDB_val *val) {
+    size_t hdr = VALUE_HEADER_SIZE;
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        const uint8_t flags = extractFlags(s, val);
+        hdr = VALUE_HEADER_SIZE_V2;
+        if (flags & VALUE_FLAG_HAS_EXPIRY) {
+            hdr += sizeof(uint64_t);
+        }
+        if (flags & VALUE_FLAG_HAS_CHECKSUM) {
+            hdr += sizeof(uint32_t);
+        }
+    }
+    return hdr < val->mv_size ? hdr : val->mv_size;
+}
+
+/**
+ * Extract the inline expiry timestamp from a packed LMDB value.
+ *
+ * Only v2 values carry an inline expiry; v1 environments keep expiries
+ * exclusively in the "_kvidx_ttl" database.
+ *
+ * @param s    LMDB state (determines value format)
+ * @param val  LMDB value containing packed data
+ * @return Expiry timestamp in milliseconds, or 0 if none
+ */
+static inline uint64_t extractExpiry(const lmdbState *s, const MDB_val *val) {
+    if (!(extractFlags(s, val) & VALUE_FLAG_HAS_EXPIRY) ||
+        val->mv_size < VALUE_HEADER_SIZE_V2 + sizeof(uint64_t)) {
+        return 0;
+    }
+    uint64_t expiresAt;
+    memcpy(&expiresAt, (const uint8_t *)val->mv_data + VALUE_HEADER_SIZE_V2,
+           sizeof(expiresAt));
+    return expiresAt;
+}
+
 /**
  * Extract the data portion from a packed LMDB value.
  *
@@ -155,21 +293,138 @@ static inline uint64_t extractCmd(const MDB_val *val) {
  * The pointer remains valid until the transaction is reset or another
  * operation is performed.
  *
+ * @param s    LMDB state (determines value format)
  * @param val  LMDB value containing packed data
  * @param len  OUT: Length of the data portion, or NULL if not needed
  * @return Pointer to data (may be NULL if empty), or NULL if value is empty
  */
-static inline const uint8_t *extractData(const MDB_val *val, size_t *len) {
-    if (val->mv_size <= VALUE_HEADER_SIZE) {
+static inline const uint8_t *extractData(const lmdbState *s,
+                                         const MDB_val *val, size_t *len) {
+    size_t hdr = valueHeaderSize(s, val);
+    if (val->mv_size <= hdr) {
         if (len) {
             *len = 0;
         }
         return NULL;
     }
     if (len) {
-        *len = val->mv_size - VALUE_HEADER_SIZE;
+        *len = val->mv_size - hdr;
+    }
+    return (const uint8_t *)val->mv_data + hdr;
+}
+
+/**
+ * Check a packed LMDB value against its stored checksum.
+ *
+ * @param s    LMDB state (determines value format)
+ * @param val  LMDB value containing packed data
+ * @return true if the value matches its checksum or carries none
+ */
+static bool checksumMatches(const lmdbState *s, const MDB_val *val) {
+    const uint8_t flags = extractFlags(s, val);
+    if (!(flags & VALUE_FLAG_HAS_CHECKSUM)) {
+        return true;
+    }
+
+    const size_t at = VALUE_HEADER_SIZE_V2 +
+                      (flags & VALUE_FLAG_HAS_EXPIRY ? sizeof(uint64_t) : 0);
+    if (val->mv_size < at + sizeof(uint32_t)) {
+        return false;
+    }
+
+    uint32_t stored;
+    memcpy(&stored, (const uint8_t *)val->mv_data + at, sizeof(stored));
+    size_t len;
+    const uint8_t *data = extractData(s, val, &len);
+    return stored ==
+           kvidxValueChecksum(extractTerm(val), extractCmd(val), data, len);
+}
+
+/**
+ * Fail a read whose value doesn't match its checksum.
+ *
+ * Only checks when kvidxConfig.verifyChecksums is set.
+ *
+ * @param i    The kvidx instance
+ * @param mkey LMDB key of the record
+ * @param val  LMDB value containing packed data
+ * @return true if the value may be returned
+ */
+static bool verifyValue(kvidxInstance *i, const MDB_val *mkey,
+                        const MDB_val *val) {
+    const lmdbState *s = STATE(i);
+    if (!s->verifyChecksums || checksumMatches(s, val)) {
+        return true;
+    }
+
+    uint64_t key;
+    memcpy(&key, mkey->mv_data, sizeof(key));
+    kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                  "Value of key %" PRIu64 " fails its checksum", key);
+    return false;
+}
+
+/**
+ * Size of the header packValueInto() writes before the data.
+ *
+ * @param s         LMDB state (determines value format)
+ * @param expiresAt Inline expiry timestamp in milliseconds, or 0 for none
+ * @return Header size in bytes
+ */
+static size_t packedHeaderSize(const lmdbState *s, uint64_t expiresAt) {
+    if (s->valueFormat < LMDB_VALUE_FORMAT_V2) {
+        return VALUE_HEADER_SIZE;
+    }
+
+    size_t hdr = VALUE_HEADER_SIZE_V2;
+    if (expiresAt) {
+        hdr += sizeof(uint64_t);
+    }
+    if (s->writeChecksums) {
+        hdr += sizeof(uint32_t);
+    }
+    return hdr;
+}
+
+/**
+ * Pack term, cmd, and data into buf, which holds
+ * packedHeaderSize(s, expiresAt) + dataLen bytes. Used directly on space
+ * reserved inside LMDB (MDB_RESERVE) to skip an intermediate buffer.
+ *
+ * In v1 environments expiresAt is ignored (TTL lives only in "_kvidx_ttl")
+ * and no checksum is stored.
+ *
+ * @param s         LMDB state (determines value format)
+ * @param buf       Destination
+ * @param term      The term value to pack
+ * @param cmd       The cmd value to pack
+ * @param expiresAt Inline expiry timestamp in milliseconds, or 0 for none
+ * @param data      The data to pack (may be NULL if dataLen is 0)
+ * @param dataLen   Length of the data
+ */
+static void packValueInto(const lmdbState *s, uint8_t *buf, uint64_t term,
+                          uint64_t cmd, uint64_t expiresAt, const void *data,
+                          size_t dataLen) {
+    const size_t hdr = packedHeaderSize(s, expiresAt);
+
+    memcpy(buf, &term, sizeof(term));
+    memcpy(buf + sizeof(uint64_t), &cmd, sizeof(cmd));
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        uint8_t flags = 0;
+        if (expiresAt) {
+            flags |= VALUE_FLAG_HAS_EXPIRY;
+            memcpy(buf + VALUE_HEADER_SIZE_V2, &expiresAt, sizeof(expiresAt));
+        }
+        if (s->writeChecksums) {
+            flags |= VALUE_FLAG_HAS_CHECKSUM;
+            const uint32_t crc = kvidxValueChecksum(term, cmd, data, dataLen);
+            memcpy(buf + hdr - sizeof(crc), &crc, sizeof(crc));
+        }
+        buf[VALUE_HEADER_SIZE] = flags;
+    }
+    if (dataLen > 0 && data) {
+        memcpy(buf + hdr, data, dataLen);
     }
-    return (const uint8_t *)val->mv_data + VALUE_HEADER_SIZE;
 }
 
 /**
@@ -178,30 +433,287 @@ static inline const uint8_t *extractData(const MDB_val *val, size_t *len) {
  * Allocates a new buffer containing the packed representation. The caller
  * is responsible for freeing this buffer after the LMDB put operation.
  *
+ * @param s         LMDB state (determines value format)
  * @param term      The term value to pack
  * @param cmd       The cmd value to pack
+ * @param expiresAt Inline expiry timestamp in milliseconds, or 0 for none
  * @param data      The data to pack (may be NULL if dataLen is 0)
  * @param dataLen   Length of the data
  * @param totalLen  OUT: Total length of the packed buffer
  * @return Allocated buffer containing packed data, or NULL on allocation
  * failure
  */
-static void *packValue(uint64_t term, uint64_t cmd, const void *data,
-                       size_t dataLen, size_t *totalLen) {
-    *totalLen = VALUE_HEADER_SIZE + dataLen;
+static void *packValue(const lmdbState *s, uint64_t term, uint64_t cmd,
+                       uint64_t expiresAt, const void *data, size_t dataLen,
+                       size_t *totalLen) {
+    *totalLen = packedHeaderSize(s, expiresAt) + dataLen;
     void *buf = malloc(*totalLen);
     if (!buf) {
         return NULL;
     }
 
-    memcpy(buf, &term, sizeof(term));
-    memcpy((uint8_t *)buf + sizeof(uint64_t), &cmd, sizeof(cmd));
-    if (dataLen > 0 && data) {
-        memcpy((uint8_t *)buf + VALUE_HEADER_SIZE, data, dataLen);
-    }
+    packValueInto(s, buf, term, cmd, expiresAt, data, dataLen);
     return buf;
 }
 
+/* ====================================================================
+ * Map Size Management
+ * ====================================================================
+ * Once LMDB's memory map is exhausted every write fails with MDB_MAP_FULL,
+ * and the map can only be resized while this process has no live
+ * transaction. We therefore resize only at write transaction boundaries:
+ *
+ * - Proactively in Begin(), when free map space drops below the larger of
+ *   1/MAP_HEADROOM_DIVISOR of the map and twice the biggest transaction
+ *   committed so far.
+ * - Reactively after MDB_MAP_FULL. Operations that own their transaction
+ *   are retried transparently once the map has grown (see the retry
+ *   wrappers at the end of this file; kvidxInsertBatch() replays its own
+ *   transaction the same way). A caller-owned transaction cannot be
+ *   replayed: its commit fails with KVIDX_ERROR_DISK_FULL and the map grows
+ *   before the next Begin(), so retrying the transaction succeeds.
+ *
+ * Growth doubles the map, bounded by kvidxConfig.lmdbMaxMapSizeBytes. The
+ * map is address space, not disk: the data file only grows as pages are
+ * actually used (except with MDB_WRITEMAP, where it is sparse).
+ *
+ * Resizing remaps the environment, so data pointers from earlier Get()
+ * calls must not be held across a write.
+ */
+
+/**
+ * Record MDB_MAP_FULL so the map is grown before the next write txn.
+ *
+ * Wraps every LMDB call that may allocate pages.
+ *
+ * @param s   LMDB state
+ * @param rc  Return code of the wrapped LMDB call
+ * @return rc, unchanged
+ */
+static inline int lmdbRc(lmdbState *s, int rc) {
+    if (rc == MDB_MAP_FULL) {
+        s->mapFull = true;
+    }
+    return rc;
+}
+
+/**
+ * Syncs LMDB issues for one commit under the current environment flags.
+ *
+ * A commit syncs the data pages, then writes the meta page and syncs it
+ * too unless MDB_NOMETASYNC is set. MDB_NOSYNC, and MDB_MAPASYNC with
+ * MDB_WRITEMAP, leave both to the OS.
+ */
+static uint64_t syncsPerCommit(const lmdbState *s) {
+    unsigned int flags = 0;
+    mdb_env_get_flags(s->env, &flags);
+    if ((flags & MDB_NOSYNC) ||
+        ((flags & MDB_WRITEMAP) && (flags & MDB_MAPASYNC))) {
+        return 0;
+    }
+    return (flags & MDB_NOMETASYNC) ? 1 : 2;
+}
+
+/**
+ * Commit a write transaction and count it for kvidxLmdbIoCounters().
+ *
+ * LMDB skips writing (and syncing) a transaction that changed nothing, so
+ * only commits that advanced the last transaction id are counted.
+ *
+ * @param s    LMDB state
+ * @param txn  Write transaction, freed by this call
+ * @return Result of mdb_txn_commit()
+ */
+static int commitTxn(lmdbState *s, MDB_txn *txn) {
+    const mdb_size_t id = mdb_txn_id(txn);
+    KVIDX_PROBE1(lmdb__commit__start, id);
+    const int rc = lmdbRc(s, mdb_txn_commit(txn));
+    KVIDX_PROBE2(lmdb__commit__done, id, rc);
+    MDB_envinfo info;
+    if (rc == MDB_SUCCESS && mdb_env_info(s->env, &info) == MDB_SUCCESS &&
+        info.me_last_txnid >= id) {
+        s->transactions++;
+        s->fsyncs += syncsPerCommit(s);
+    }
+    return rc;
+}
+
+/**
+ * Resize the memory map. No transaction of this process may be live.
+ *
+ * The persistent read transaction is reset first; it is renewed on the
+ * next read against the new mapping.
+ *
+ * @param i     The kvidx instance
+ * @param size  New map size in bytes (0 adopts the size stored on disk)
+ * @return true on success
+ */
+static bool setMapSize(kvidxInstance *i, uint64_t size) {
+    lmdbState *s = STATE(i);
+    if (s->writeTxn) {
+        return false;
+    }
+
+    /* Open readers hold live snapshots into the current mapping */
+    if (__atomic_load_n(&s->readers, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    if (s->readTxn) {
+        mdb_txn_reset(s->readTxn);
+    }
+
+    int rc = mdb_env_set_mapsize(s->env, size);
+    if (rc != MDB_SUCCESS) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to set map size: %s",
+                      mdb_strerror(rc));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Adopt a map size grown by another process (MDB_MAP_RESIZED).
+ *
+ * @param i  The kvidx instance
+ * @return true if the map was remapped and the txn can be retried
+ */
+static bool adoptMapSize(kvidxInstance *i) {
+    return setMapSize(i, 0);
+}
+
+/**
+ * Upper bound for automatic growth; 0 means unbounded.
+ */
+static uint64_t mapSizeLimit(const kvidxInstance *i) {
+    return i->configInitialized ? i->config.lmdbMaxMapSizeBytes : 0;
+}
+
+/**
+ * Grow the map geometrically until it holds at least neededBytes.
+ *
+ * @param i            The kvidx instance
+ * @param neededBytes  Minimum map size wanted (0 = just double)
+ * @return true if the map grew
+ */
+static bool growMap(kvidxInstance *i, uint64_t neededBytes) {
+    lmdbState *s = STATE(i);
+
+    MDB_envinfo info;
+    if (mdb_env_info(s->env, &info) != MDB_SUCCESS) {
+        return false;
+    }
+
+    uint64_t current = info.me_mapsize;
+    uint64_t newSize = current * 2;
+    while (newSize < neededBytes) {
+        newSize *= 2;
+    }
+
+    uint64_t limit = mapSizeLimit(i);
+    if (limit && newSize > limit) {
+        newSize = limit;
+    }
+
+    if (newSize <= current) {
+        return false;
+    }
+
+    return setMapSize(i, newSize);
+}
+
+/**
+ * Warn once when the map is about to hit its ceiling.
+ *
+ * The ceiling is kvidxConfig.lmdbMaxMapSizeBytes when set, otherwise the
+ * current map size (reached only when growth itself failed). The warning
+ * re-arms once usage drops back below the threshold.
+ *
+ * @param i          The kvidx instance
+ * @param usedBytes  Bytes in use (last page + 1)
+ * @param mapBytes   Current map size
+ */
+static void checkMapFill(kvidxInstance *i, uint64_t usedBytes,
+                         uint64_t mapBytes) {
+    lmdbState *s = STATE(i);
+    if (!i->configInitialized || !i->config.lmdbMapWarning) {
+        return;
+    }
+
+    int percent = i->config.lmdbMapWarnPercent;
+    if (percent < 0) {
+        return;
+    }
+    if (percent == 0) {
+        percent = DEFAULT_MAP_WARN_PERCENT;
+    }
+
+    uint64_t ceiling = mapSizeLimit(i) ? mapSizeLimit(i) : mapBytes;
+    bool over = usedBytes >= ceiling / 100 * (uint64_t)percent;
+
+    if (over && !s->mapWarned) {
+        s->mapWarned = true;
+        i->config.lmdbMapWarning(usedBytes, ceiling,
+                                 i->config.lmdbMapWarningUserData);
+    } else if (!over) {
+        s->mapWarned = false;
+    }
+}
+
+/**
+ * Make room for the next write transaction. Called with no write txn live.
+ *
+ * @param i  The kvidx instance
+ */
+static void ensureMapHeadroom(kvidxInstance *i) {
+    lmdbState *s = STATE(i);
+
+    MDB_envinfo info;
+    if (mdb_env_info(s->env, &info) != MDB_SUCCESS) {
+        return;
+    }
+
+    uint64_t used = ((uint64_t)info.me_last_pgno + 1) * s->pageSize;
+    uint64_t headroom = info.me_mapsize / MAP_HEADROOM_DIVISOR;
+    if (headroom < s->maxTxnPages * 2 * s->pageSize) {
+        headroom = s->maxTxnPages * 2 * s->pageSize;
+    }
+
+    if (s->mapFull || used + headroom > info.me_mapsize) {
+        if (growMap(i, used + headroom)) {
+            s->mapFull = false;
+            mdb_env_info(s->env, &info);
+        }
+    }
+
+    checkMapFill(i, used, info.me_mapsize);
+}
+
+/**
+ * After a failed operation that owned its transaction: if it failed because
+ * the map was full, grow the map so the operation can be retried.
+ *
+ * @param i  The kvidx instance
+ * @return true if the caller should retry the operation
+ */
+static bool retryAfterMapFull(kvidxInstance *i) {
+    lmdbState *s = STATE(i);
+    if (!s->mapFull || s->writeTxn) {
+        return false;
+    }
+
+    if (!growMap(i, 0)) {
+        kvidxSetError(i, KVIDX_ERROR_DISK_FULL,
+                      "LMDB map full and cannot grow past %" PRIu64 " bytes",
+                      mapSizeLimit(i));
+        return false;
+    }
+
+    s->mapFull = false;
+    return true;
+}
+
 /* ====================================================================
  * Transaction Management Helpers
  * ====================================================================
@@ -235,6 +747,11 @@ static bool ensureReadTxn(kvidxInstance *i) {
         return true;
     }
 
+    /* Readers keep the snapshot they were opened with */
+    if (s->sharedEnv) {
+        return s->readTxn != NULL;
+    }
+
     /* If read txn exists, renew it for fresh snapshot */
     if (s->readTxn) {
         int rc = mdb_txn_renew(s->readTxn);
@@ -249,6 +766,9 @@ static bool ensureReadTxn(kvidxInstance *i) {
 
     /* Create new read transaction */
     int rc = mdb_txn_begin(s->env, NULL, MDB_RDONLY, &s->readTxn);
+    if (rc == MDB_MAP_RESIZED && adoptMapSize(i)) {
+        rc = mdb_txn_begin(s->env, NULL, MDB_RDONLY, &s->readTxn);
+    }
     return rc == MDB_SUCCESS;
 }
 
@@ -284,7 +804,7 @@ static MDB_txn *getActiveTxn(kvidxInstance *i) {
  */
 static void resetReadTxn(kvidxInstance *i) {
     lmdbState *s = STATE(i);
-    if (s->readTxn && !s->writeTxn) {
+    if (s->readTxn && !s->writeTxn && !s->sharedEnv) {
         mdb_txn_reset(s->readTxn);
     }
 }
@@ -318,13 +838,24 @@ bool kvidxLmdbBegin(kvidxInstance *i) {
         return true;
     }
 
+    /* Only moment the map can be resized: no write txn is live */
+    ensureMapHeadroom(i);
+
     int rc = mdb_txn_begin(s->env, NULL, 0, &s->writeTxn);
+    if (rc == MDB_MAP_RESIZED && adoptMapSize(i)) {
+        rc = mdb_txn_begin(s->env, NULL, 0, &s->writeTxn);
+    }
     if (rc != MDB_SUCCESS) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL, "LMDB txn_begin failed: %s",
                       mdb_strerror(rc));
         return false;
     }
 
+    MDB_envinfo info;
+    if (mdb_env_info(s->env, &info) == MDB_SUCCESS) {
+        s->txnStartPage = info.me_last_pgno;
+    }
+
     return true;
 }
 
@@ -354,15 +885,40 @@ bool kvidxLmdbCommit(kvidxInstance *i) {
         return true;
     }
 
-    int rc = mdb_txn_commit(s->writeTxn);
+    int rc = commitTxn(s, s->writeTxn);
     s->writeTxn = NULL;
 
     if (rc != MDB_SUCCESS) {
+        if (s->mapFull) {
+            /* The txn needed at least the rest of the map; size the next
+             * headroom check from that so one retry is usually enough. */
+            MDB_envinfo info;
+            if (mdb_env_info(s->env, &info) == MDB_SUCCESS &&
+                info.me_mapsize / s->pageSize > s->txnStartPage) {
+                uint64_t pages =
+                    info.me_mapsize / s->pageSize - s->txnStartPage;
+                if (pages > s->maxTxnPages) {
+                    s->maxTxnPages = pages;
+                }
+            }
+            kvidxSetError(i, KVIDX_ERROR_DISK_FULL,
+                          "LMDB map full; transaction discarded, map grows "
+                          "before the next transaction");
+            return false;
+        }
         kvidxSetError(i, KVIDX_ERROR_INTERNAL, "LMDB txn_commit failed: %s",
                       mdb_strerror(rc));
         return false;
     }
 
+    /* Track transaction size so Begin() can keep enough headroom */
+    MDB_envinfo info;
+    if (mdb_env_info(s->env, &info) == MDB_SUCCESS &&
+        info.me_last_pgno > s->txnStartPage &&
+        info.me_last_pgno - s->txnStartPage > s->maxTxnPages) {
+        s->maxTxnPages = info.me_last_pgno - s->txnStartPage;
+    }
+
     return true;
 }
 
@@ -409,7 +965,7 @@ bool kvidxLmdbGet(kvidxInstance *i, uint64_t key, uint64_t *term, uint64_t *cmd,
         resetReadTxn(i);
         return false;
     }
-    if (rc != MDB_SUCCESS) {
+    if (rc != MDB_SUCCESS || !verifyValue(i, &mkey, &mval)) {
         resetReadTxn(i);
         return false;
     }
@@ -421,10 +977,10 @@ bool kvidxLmdbGet(kvidxInstance *i, uint64_t key, uint64_t *term, uint64_t *cmd,
         *cmd = extractCmd(&mval);
     }
     if (data) {
-        *data = extractData(&mval, len);
+        *data = extractData(s, &mval, len);
     } else if (len) {
         size_t dlen;
-        extractData(&mval, &dlen);
+        extractData(s, &mval, &dlen);
         *len = dlen;
     }
 
@@ -496,6 +1052,8 @@ bool kvidxLmdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
         }
     }
 
+    found = found && verifyValue(i, &mkey, &mval);
+
     if (found) {
         uint64_t foundKey;
         memcpy(&foundKey, mkey.mv_data, sizeof(foundKey));
@@ -510,10 +1068,10 @@ bool kvidxLmdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
             *cmd = extractCmd(&mval);
         }
         if (data) {
-            *data = extractData(&mval, len);
+            *data = extractData(s, &mval, len);
         } else if (len) {
             size_t dlen;
-            extractData(&mval, &dlen);
+            extractData(s, &mval, &dlen);
             *len = dlen;
         }
     }
@@ -578,6 +1136,8 @@ bool kvidxLmdbGetNext(kvidxInstance *i, uint64_t previousKey, uint64_t *nextKey,
         found = true;
     }
 
+    found = found && verifyValue(i, &mkey, &mval);
+
     if (found) {
         uint64_t foundKey;
         memcpy(&foundKey, mkey.mv_data, sizeof(foundKey));
@@ -592,10 +1152,10 @@ bool kvidxLmdbGetNext(kvidxInstance *i, uint64_t previousKey, uint64_t *nextKey,
             *cmd = extractCmd(&mval);
         }
         if (data) {
-            *data = extractData(&mval, len);
+            *data = extractData(s, &mval, len);
         } else if (len) {
             size_t dlen;
-            extractData(&mval, &dlen);
+            extractData(s, &mval, &dlen);
             *len = dlen;
         }
     }
@@ -608,25 +1168,142 @@ bool kvidxLmdbGetNext(kvidxInstance *i, uint64_t previousKey, uint64_t *nextKey,
 }
 
 /**
- * Check if a key exists in the database.
+ * Visit every record in [startKey, endKey] in key order.
  *
- * Performs a simple lookup without extracting the value data. Since LMDB
- * operations are already very fast, this is only marginally faster than
- * Get() but uses slightly less code.
+ * Walks one cursor instead of reopening one per GetNext(). Data pointers
+ * passed to visit point into the map and are only valid during that call.
  *
- * @param i    The kvidx instance
- * @param key  The key to check
- * @return true if the key exists, false otherwise
+ * @param i         The kvidx instance
+ * @param startKey  First key of the range (inclusive)
+ * @param endKey    Last key of the range (inclusive)
+ * @param visit     Called per record; return false to stop the scan
+ * @param ctx       Passed through to visit
+ * @return KVIDX_OK when the scan finished or was stopped by visit
  */
-bool kvidxLmdbExists(kvidxInstance *i, uint64_t key) {
+kvidxError kvidxLmdbScanRange(kvidxInstance *i, uint64_t startKey,
+                              uint64_t endKey, kvidxScanVisitor visit,
+                              void *ctx) {
     lmdbState *s = STATE(i);
 
     if (!ensureReadTxn(i)) {
-        return false;
+        return KVIDX_ERROR_INTERNAL;
     }
 
-    MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
-    MDB_val mval;
+    MDB_cursor *cursor;
+    int rc = mdb_cursor_open(getActiveTxn(i), s->dbi, &cursor);
+    if (rc != MDB_SUCCESS) {
+        resetReadTxn(i);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    uint64_t searchKey = startKey;
+    MDB_val mkey = {.mv_size = sizeof(searchKey), .mv_data = &searchKey};
+    MDB_val mval;
+
+    rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_SET_RANGE);
+    while (rc == MDB_SUCCESS) {
+        uint64_t key;
+        memcpy(&key, mkey.mv_data, sizeof(key));
+        if (key > endKey) {
+            break;
+        }
+
+        if (!verifyValue(i, &mkey, &mval)) {
+            mdb_cursor_close(cursor);
+            resetReadTxn(i);
+            return KVIDX_ERROR_CORRUPT;
+        }
+
+        size_t len = 0;
+        const uint8_t *data = extractData(s, &mval, &len);
+        if (!visit(ctx, key, extractTerm(&mval), extractCmd(&mval), data,
+                   len)) {
+            break;
+        }
+        rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT);
+    }
+
+    mdb_cursor_close(cursor);
+    resetReadTxn(i);
+    return rc == MDB_SUCCESS || rc == MDB_NOTFOUND ? KVIDX_OK
+                                                   : KVIDX_ERROR_INTERNAL;
+}
+
+/**
+ * Check the stored checksum of every record in [startKey, endKey].
+ *
+ * Values written without a checksum (v1 environments, or before
+ * kvidxConfig.valueChecksums was set) are counted as unchecked.
+ *
+ * @param i         The kvidx instance
+ * @param startKey  First key of the range (inclusive)
+ * @param endKey    Last key of the range (inclusive)
+ * @param result    Counts are added to this
+ * @return KVIDX_OK when the whole range was read
+ */
+kvidxError kvidxLmdbVerifyRange(kvidxInstance *i, uint64_t startKey,
+                                uint64_t endKey, kvidxVerifyResult *result) {
+    lmdbState *s = STATE(i);
+
+    if (!ensureReadTxn(i)) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    MDB_cursor *cursor;
+    int rc = mdb_cursor_open(getActiveTxn(i), s->dbi, &cursor);
+    if (rc != MDB_SUCCESS) {
+        resetReadTxn(i);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    uint64_t searchKey = startKey;
+    MDB_val mkey = {.mv_size = sizeof(searchKey), .mv_data = &searchKey};
+    MDB_val mval;
+
+    rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_SET_RANGE);
+    while (rc == MDB_SUCCESS) {
+        uint64_t key;
+        memcpy(&key, mkey.mv_data, sizeof(key));
+        if (key > endKey) {
+            break;
+        }
+
+        if (!(extractFlags(s, &mval) & VALUE_FLAG_HAS_CHECKSUM)) {
+            result->entriesUnchecked++;
+        } else if (checksumMatches(s, &mval)) {
+            result->entriesChecked++;
+        } else if (result->corruptEntries++ == 0) {
+            result->firstCorruptKey = key;
+        }
+        rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT);
+    }
+
+    mdb_cursor_close(cursor);
+    resetReadTxn(i);
+    return rc == MDB_SUCCESS || rc == MDB_NOTFOUND ? KVIDX_OK
+                                                   : KVIDX_ERROR_INTERNAL;
+}
+
+/**
+ * Check if a key exists in the database.
+ *
+ * Performs a simple lookup without extracting the value data. Since LMDB
+ * operations are already very fast, this is only marginally faster than
+ * Get() but uses slightly less code.
+ *
+ * @param i    The kvidx instance
+ * @param key  The key to check
+ * @return true if the key exists, false otherwise
+ */
+bool kvidxLmdbExists(kvidxInstance *i, uint64_t key) {
+    lmdbState *s = STATE(i);
+
+    if (!ensureReadTxn(i)) {
+        return false;
+    }
+
+    MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
+    MDB_val mval;
 
     int rc = mdb_get(getActiveTxn(i), s->dbi, &mkey, &mval);
     resetReadTxn(i);
@@ -714,8 +1391,8 @@ bool kvidxLmdbMax(kvidxInstance *i, uint64_t *key) {
  * If no transaction is active, creates an auto-commit transaction for
  * this single operation. Otherwise, uses the existing transaction.
  *
- * The data is copied into LMDB's storage (LMDB does not support zero-copy
- * writes in the same way it supports zero-copy reads).
+ * The value is packed straight into space reserved in LMDB's storage
+ * (MDB_RESERVE), so the data is copied once and nothing is allocated.
  *
  * @param i        The kvidx instance
  * @param key      The uint64_t key for this record
@@ -725,8 +1402,8 @@ bool kvidxLmdbMax(kvidxInstance *i, uint64_t *key) {
  * @param dataLen  Length of the data in bytes
  * @return true on success, false if key exists or other error
  */
-bool kvidxLmdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
-                     uint64_t cmd, const void *data, size_t dataLen) {
+static bool insertOnce(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = false;
 
@@ -737,22 +1414,15 @@ bool kvidxLmdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
         ownTxn = true;
     }
 
-    size_t valLen;
-    void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
-    if (!valBuf) {
-        if (ownTxn) {
-            mdb_txn_abort(s->writeTxn);
-            s->writeTxn = NULL;
-        }
-        return false;
-    }
-
     MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
-    MDB_val mval = {.mv_size = valLen, .mv_data = valBuf};
+    MDB_val mval = {.mv_size = packedHeaderSize(s, 0) + dataLen};
 
     /* Use MDB_NOOVERWRITE to fail on duplicate keys (match SQLite behavior) */
-    int rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, MDB_NOOVERWRITE);
-    free(valBuf);
+    int rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval,
+                               MDB_NOOVERWRITE | MDB_RESERVE));
+    if (rc == MDB_SUCCESS) {
+        packValueInto(s, mval.mv_data, term, cmd, 0, data, dataLen);
+    }
 
     if (rc == MDB_KEYEXIST) {
         /* Duplicate key - return false but don't abort transaction */
@@ -793,7 +1463,7 @@ bool kvidxLmdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
  * @param key  The key to remove
  * @return true on success (including if key didn't exist), false on error
  */
-bool kvidxLmdbRemove(kvidxInstance *i, uint64_t key) {
+static bool removeOnce(kvidxInstance *i, uint64_t key) {
     lmdbState *s = STATE(i);
     bool ownTxn = false;
 
@@ -806,7 +1476,7 @@ bool kvidxLmdbRemove(kvidxInstance *i, uint64_t key) {
 
     MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
 
-    int rc = mdb_del(s->writeTxn, s->dbi, &mkey, NULL);
+    int rc = lmdbRc(s, mdb_del(s->writeTxn, s->dbi, &mkey, NULL));
 
     if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND) {
         if (ownTxn) {
@@ -834,7 +1504,7 @@ bool kvidxLmdbRemove(kvidxInstance *i, uint64_t key) {
  * @param key  The starting key (inclusive) - all keys >= this are deleted
  * @return true on success, false on error
  */
-bool kvidxLmdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+static bool removeAfterNInclusiveOnce(kvidxInstance *i, uint64_t key) {
     lmdbState *s = STATE(i);
     bool ownTxn = false;
 
@@ -862,7 +1532,7 @@ bool kvidxLmdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
     rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_SET_RANGE);
 
     while (rc == MDB_SUCCESS) {
-        rc = mdb_cursor_del(cursor, 0);
+        rc = lmdbRc(s, mdb_cursor_del(cursor, 0));
         if (rc != MDB_SUCCESS) {
             break;
         }
@@ -889,7 +1559,7 @@ bool kvidxLmdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
  * @param key  The ending key (inclusive) - all keys <= this are deleted
  * @return true on success, false on error
  */
-bool kvidxLmdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
+static bool removeBeforeNInclusiveOnce(kvidxInstance *i, uint64_t key) {
     lmdbState *s = STATE(i);
     bool ownTxn = false;
 
@@ -923,7 +1593,7 @@ bool kvidxLmdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
             break;
         }
 
-        rc = mdb_cursor_del(cursor, 0);
+        rc = lmdbRc(s, mdb_cursor_del(cursor, 0));
         if (rc != MDB_SUCCESS) {
             break;
         }
@@ -958,7 +1628,10 @@ bool kvidxLmdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
  */
 bool kvidxLmdbFsync(kvidxInstance *i) {
     lmdbState *s = STATE(i);
+    KVIDX_PROBE(fsync__start);
     int rc = mdb_env_sync(s->env, 1);
+    KVIDX_PROBE1(fsync__done, rc == MDB_SUCCESS);
+    s->fsyncs++;
     return rc == MDB_SUCCESS;
 }
 
@@ -966,6 +1639,114 @@ bool kvidxLmdbFsync(kvidxInstance *i) {
  * Bring-Up / Teardown
  * ==================================================================== */
 
+/**
+ * Determine the value format of the environment being opened.
+ *
+ * The format is stored under META_KEY_VALUE_FORMAT in "_kvidx_meta". When
+ * no record exists, an empty "_kvidx_data" means a brand new environment,
+ * which gets the configured format (v2 unless config->lmdbValueFormat says
+ * otherwise). A populated "_kvidx_data" without a record predates the
+ * format record, so it is pinned to v1 and keeps opening unchanged.
+ *
+ * @param i    The kvidx instance being opened
+ * @param txn  The write transaction used during open
+ * @return MDB_SUCCESS, or an LMDB error code
+ */
+static int initValueFormat(kvidxInstance *i, MDB_txn *txn) {
+    lmdbState *s = STATE(i);
+
+    int rc = mdb_dbi_open(txn, "_kvidx_meta", MDB_CREATE, &s->metaDbi);
+    if (rc != MDB_SUCCESS) {
+        return rc;
+    }
+
+    MDB_val mkey = {.mv_size = sizeof(META_KEY_VALUE_FORMAT) - 1,
+                    .mv_data = META_KEY_VALUE_FORMAT};
+    MDB_val mval;
+    rc = mdb_get(txn, s->metaDbi, &mkey, &mval);
+    if (rc == MDB_SUCCESS) {
+        if (mval.mv_size != sizeof(s->valueFormat)) {
+            return MDB_CORRUPTED;
+        }
+        memcpy(&s->valueFormat, mval.mv_data, sizeof(s->valueFormat));
+        if (s->valueFormat < LMDB_VALUE_FORMAT_V1 ||
+            s->valueFormat > LMDB_VALUE_FORMAT_V2) {
+            return MDB_INCOMPATIBLE;
+        }
+        return MDB_SUCCESS;
+    }
+    if (rc != MDB_NOTFOUND) {
+        return rc;
+    }
+
+    MDB_stat dataStat;
+    rc = mdb_stat(txn, s->dbi, &dataStat);
+    if (rc != MDB_SUCCESS) {
+        return rc;
+    }
+
+    if (dataStat.ms_entries > 0) {
+        s->valueFormat = LMDB_VALUE_FORMAT_V1;
+    } else if (i->configInitialized &&
+               i->config.lmdbValueFormat == LMDB_VALUE_FORMAT_V1) {
+        s->valueFormat = LMDB_VALUE_FORMAT_V1;
+    } else {
+        s->valueFormat = LMDB_VALUE_FORMAT_V2;
+    }
+
+    mval.mv_size = sizeof(s->valueFormat);
+    mval.mv_data = &s->valueFormat;
+    return lmdbRc(s, mdb_put(txn, s->metaDbi, &mkey, &mval, 0));
+}
+
+/**
+ * Translate kvidxConfig into LMDB environment flags.
+ *
+ * Durability relative to the default (data and meta page synced on every
+ * commit):
+ * - MDB_NOSYNC (syncMode OFF): no sync at commit. A system crash may lose
+ *   or corrupt recent commits; an application crash loses nothing.
+ * - MDB_NOMETASYNC: data is synced, the meta page is not. A system crash
+ *   may roll back the last commit(s), but never corrupts the database.
+ * - MDB_MAPASYNC (with MDB_WRITEMAP): the map is flushed asynchronously.
+ *   Same crash window as NOMETASYNC, without blocking the committer.
+ * - MDB_WRITEMAP: commits write through a writable map. Durability is
+ *   unchanged, but stray writes via Get pointers would hit the file.
+ * - MDB_NORDAHEAD, MDB_NOMEMINIT: performance only.
+ *
+ * @param config      Configuration to translate
+ * @param runtimeOnly Return only flags that mdb_env_set_flags() can change
+ * @return MDB_* flag mask
+ */
+static unsigned int envFlagsFromConfig(const kvidxConfig *config,
+                                       bool runtimeOnly) {
+    unsigned int flags = 0;
+
+    if (config->syncMode == KVIDX_SYNC_OFF) {
+        flags |= MDB_NOSYNC;
+    }
+    if (config->lmdbNoMetaSync) {
+        flags |= MDB_NOMETASYNC;
+    }
+    if (config->lmdbMapAsync) {
+        flags |= MDB_MAPASYNC;
+    }
+    if (config->lmdbNoMemInit) {
+        flags |= MDB_NOMEMINIT;
+    }
+
+    if (!runtimeOnly) {
+        if (config->lmdbWriteMap) {
+            flags |= MDB_WRITEMAP;
+        }
+        if (config->lmdbNoReadAhead) {
+            flags |= MDB_NORDAHEAD;
+        }
+    }
+
+    return flags;
+}
+
 /**
  * Open or create an LMDB-backed kvidx database.
  *
@@ -974,11 +1755,15 @@ bool kvidxLmdbFsync(kvidxInstance *i) {
  * 2. Creates and configures the LMDB environment
  * 3. Opens/creates the main data database (_kvidx_data)
  * 4. Opens/creates the TTL metadata database (_kvidx_ttl)
+ * 5. Loads the value format from _kvidx_meta (recording it for new envs)
  *
  * Configuration:
- * - Map size: 1GB (can grow dynamically)
- * - Max databases: 2 (data + TTL)
+ * - Map size: kvidxConfig.lmdbMapSizeBytes or 1GB, grown automatically up to
+ *   kvidxConfig.lmdbMaxMapSizeBytes (see Map Size Management)
+ * - Max databases: 3 (data + TTL + meta)
  * - MDB_NOTLS: Allows transactions to be used across threads
+ * - Optional flags from kvidxConfig (see envFlagsFromConfig())
+ * - Max readers: kvidxConfig.lmdbMaxReaders or LMDB's default (126)
  *
  * The directory will contain:
  * - data.mdb: The actual database file
@@ -1032,15 +1817,28 @@ bool kvidxLmdbOpen(kvidxInstance *i, const char *filename,
         return false;
     }
 
-    /* Set map size - 1GB default, can grow */
-    mdb_env_set_mapsize(s->env, DEFAULT_MAP_SIZE);
+    /* Set initial map size - 1GB default, grows automatically on demand.
+     * If the environment on disk is already larger, LMDB keeps its size. */
+    uint64_t mapSize = DEFAULT_MAP_SIZE;
+    if (i->configInitialized && i->config.lmdbMapSizeBytes) {
+        mapSize = i->config.lmdbMapSizeBytes;
+    }
+    mdb_env_set_mapsize(s->env, mapSize);
+
+    /* Allow up to 3 named databases (main + TTL + meta) */
+    mdb_env_set_maxdbs(s->env, 3);
 
-    /* Allow up to 2 named databases (main + TTL) */
-    mdb_env_set_maxdbs(s->env, 2);
+    /* Reader slots are sized when the lock file is first created */
+    if (i->configInitialized && i->config.lmdbMaxReaders > 0) {
+        mdb_env_set_maxreaders(s->env, (unsigned int)i->config.lmdbMaxReaders);
+    }
 
     /* Open environment - use MDB_NOTLS for flexibility with transaction reuse
      */
     unsigned int flags = MDB_NOTLS;
+    if (i->configInitialized) {
+        flags |= envFlagsFromConfig(&i->config, false);
+    }
     rc = mdb_env_open(s->env, filename, flags, 0644);
     if (rc != MDB_SUCCESS) {
         if (errStr) {
@@ -1053,6 +1851,10 @@ bool kvidxLmdbOpen(kvidxInstance *i, const char *filename,
         return false;
     }
 
+    MDB_stat envStat;
+    mdb_env_stat(s->env, &envStat);
+    s->pageSize = envStat.ms_psize;
+
     /* Open a transaction to create/open the database */
     MDB_txn *txn;
     rc = mdb_txn_begin(s->env, NULL, 0, &txn);
@@ -1098,7 +1900,21 @@ bool kvidxLmdbOpen(kvidxInstance *i, const char *filename,
     }
     s->ttlDbiInitialized = true;
 
-    rc = mdb_txn_commit(txn);
+    /* Record (or load) the value format for this environment */
+    rc = initValueFormat(i, txn);
+    if (rc != MDB_SUCCESS) {
+        if (errStr) {
+            *errStr = mdb_strerror(rc);
+        }
+        mdb_txn_abort(txn);
+        mdb_env_close(s->env);
+        free(s->envPath);
+        free(i->kvidxdata);
+        i->kvidxdata = NULL;
+        return false;
+    }
+
+    rc = commitTxn(s, txn);
     if (rc != MDB_SUCCESS) {
         if (errStr) {
             *errStr = mdb_strerror(rc);
@@ -1138,6 +1954,17 @@ bool kvidxLmdbOpen(kvidxInstance *i, const char *filename,
 bool kvidxLmdbClose(kvidxInstance *i) {
     lmdbState *s = STATE(i);
 
+    /* Readers only own their read transaction */
+    if (s->sharedEnv) {
+        if (s->readTxn) {
+            mdb_txn_abort(s->readTxn);
+        }
+        __atomic_fetch_sub(&s->owner->readers, 1, __ATOMIC_RELEASE);
+        free(i->kvidxdata);
+        i->kvidxdata = NULL;
+        return true;
+    }
+
     if (s->writeTxn) {
         mdb_txn_abort(s->writeTxn);
         s->writeTxn = NULL;
@@ -1152,6 +1979,7 @@ bool kvidxLmdbClose(kvidxInstance *i) {
     if (s->ttlDbiInitialized) {
         mdb_dbi_close(s->env, s->ttlDbi);
     }
+    mdb_dbi_close(s->env, s->metaDbi);
     mdb_env_close(s->env);
 
     free(s->envPath);
@@ -1161,6 +1989,52 @@ bool kvidxLmdbClose(kvidxInstance *i) {
     return true;
 }
 
+/**
+ * Open a reader on i's environment for another thread.
+ *
+ * The reader shares the environment and database handles and keeps its own
+ * read transaction (MDB_NOTLS lets it live on any thread), so readers never
+ * wait on each other or on the writer. That transaction lives until the
+ * reader is closed, so every read sees the snapshot taken here; the map
+ * does not grow while any reader is open. No reader is opened while i has a
+ * write transaction open, since it couldn't see those writes.
+ *
+ * @param i       The kvidx instance to read from
+ * @param reader  OUT: Instance initialized for reading; release it with
+ *                kvidxLmdbClose() before closing i
+ * @return true on success
+ */
+bool kvidxLmdbOpenReader(kvidxInstance *i, kvidxInstance *reader) {
+    if (STATE(i)->writeTxn) {
+        return false;
+    }
+
+    lmdbState *rs = malloc(sizeof(*rs));
+    if (!rs) {
+        return false;
+    }
+
+    *rs = *STATE(i);
+    rs->readTxn = NULL;
+    rs->writeTxn = NULL;
+    rs->envPath = NULL;
+    rs->sharedEnv = true;
+    rs->owner = STATE(i);
+    rs->readers = 0;
+
+    /* The reader sees this one snapshot until it is closed */
+    if (mdb_txn_begin(rs->env, NULL, MDB_RDONLY, &rs->readTxn) !=
+        MDB_SUCCESS) {
+        free(rs);
+        return false;
+    }
+    __atomic_fetch_add(&rs->owner->readers, 1, __ATOMIC_RELEASE);
+
+    reader->kvidxdata = rs;
+    reader->interface = i->interface;
+    return true;
+}
+
 /* ====================================================================
  * Statistics Implementation
  * ==================================================================== */
@@ -1274,9 +2148,9 @@ kvidxError kvidxLmdbGetDataSize(kvidxInstance *i, uint64_t *bytes) {
     rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_FIRST);
     while (rc == MDB_SUCCESS) {
         /* Data size is value size minus header */
-        if (mval.mv_size > VALUE_HEADER_SIZE) {
-            totalSize += mval.mv_size - VALUE_HEADER_SIZE;
-        }
+        size_t dlen;
+        extractData(s, &mval, &dlen);
+        totalSize += dlen;
         rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT);
     }
 
@@ -1287,6 +2161,33 @@ kvidxError kvidxLmdbGetDataSize(kvidxInstance *i, uint64_t *bytes) {
     return KVIDX_OK;
 }
 
+/**
+ * Count the pages on the freelist (LMDB's FREE_DBI, handle 0). Each record
+ * is a page list whose first word is its length, as mdb_stat -f reads it.
+ *
+ * @param txn  Any transaction on the environment
+ * @return Free pages, including those still held for older readers
+ */
+static uint64_t freelistPages(MDB_txn *txn) {
+    MDB_cursor *cursor;
+    if (mdb_cursor_open(txn, 0, &cursor) != MDB_SUCCESS) {
+        return 0;
+    }
+
+    uint64_t pages = 0;
+    MDB_val mkey, mval;
+    while (mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT) == MDB_SUCCESS) {
+        size_t count;
+        if (mval.mv_size >= sizeof(count)) {
+            memcpy(&count, mval.mv_data, sizeof(count));
+            pages += count;
+        }
+    }
+
+    mdb_cursor_close(cursor);
+    return pages;
+}
+
 /**
  * Get comprehensive database statistics in a single call.
  *
@@ -1295,6 +2196,7 @@ kvidxError kvidxLmdbGetDataSize(kvidxInstance *i, uint64_t *bytes) {
  * - Page size and count from mdb_stat()
  * - Map size from mdb_env_info()
  * - Min/max keys and total data size from cursor scan
+ * - Free pages from the freelist
  *
  * @param i      The kvidx instance
  * @param stats  OUT: Structure to fill with statistics
@@ -1332,6 +2234,8 @@ kvidxError kvidxLmdbGetStats(kvidxInstance *i, kvidxStats *stats) {
         stats->databaseFileSize = envInfo.me_mapsize;
     }
 
+    stats->freePages = freelistPages(getActiveTxn(i));
+
     /* Get min/max keys and data size via cursor */
     MDB_cursor *cursor;
     rc = mdb_cursor_open(getActiveTxn(i), s->dbi, &cursor);
@@ -1345,9 +2249,9 @@ kvidxError kvidxLmdbGetStats(kvidxInstance *i, kvidxStats *stats) {
             /* Calculate total data size while we're iterating */
             uint64_t totalData = 0;
             do {
-                if (mval.mv_size > VALUE_HEADER_SIZE) {
-                    totalData += mval.mv_size - VALUE_HEADER_SIZE;
-                }
+                size_t dlen;
+                extractData(s, &mval, &dlen);
+                totalData += dlen;
             } while (mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT) ==
                      MDB_SUCCESS);
 
@@ -1366,13 +2270,35 @@ kvidxError kvidxLmdbGetStats(kvidxInstance *i, kvidxStats *stats) {
     return KVIDX_OK;
 }
 
+/**
+ * Add this environment's work counters (interface.ioCounters).
+ *
+ * Reads go through the memory map, so LMDB cannot tell which of them reach
+ * the disk, and it does not report how many pages a commit writes; both
+ * byte counters stay 0. pagesAllocated follows the last page number in
+ * use, which grows only when the freelist cannot satisfy a write and only
+ * moves when a write transaction commits.
+ *
+ * @param i         The kvidx instance
+ * @param counters  OUT: Running totals are added here
+ */
+void kvidxLmdbIoCounters(kvidxInstance *i, kvidxIoCounters *counters) {
+    const lmdbState *s = STATE(i);
+    MDB_envinfo info;
+    if (mdb_env_info(s->env, &info) == MDB_SUCCESS) {
+        counters->pagesAllocated += info.me_last_pgno;
+    }
+    counters->fsyncs += s->fsyncs;
+    counters->transactions += s->transactions;
+}
+
 /* ====================================================================
  * Range Operations Implementation
  * ==================================================================== */
 
-kvidxError kvidxLmdbRemoveRange(kvidxInstance *i, uint64_t startKey,
-                                uint64_t endKey, bool startInclusive,
-                                bool endInclusive, uint64_t *deletedCount) {
+static kvidxError removeRangeOnce(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount) {
     lmdbState *s = STATE(i);
     if (!s || !s->env) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
@@ -1418,7 +2344,7 @@ kvidxError kvidxLmdbRemoveRange(kvidxInstance *i, uint64_t startKey,
             }
         }
 
-        rc = mdb_cursor_del(cursor, 0);
+        rc = lmdbRc(s, mdb_cursor_del(cursor, 0));
         if (rc != MDB_SUCCESS) {
             break;
         }
@@ -1568,65 +2494,6 @@ static kvidxError writeBinaryEntry(FILE *fp, uint64_t key, uint64_t term,
     return KVIDX_OK;
 }
 
-static void writeJsonEscaped(FILE *fp, const char *str, size_t len) {
-    for (size_t j = 0; j < len; j++) {
-        unsigned char c = str[j];
-        switch (c) {
-        case '"':
-            fprintf(fp, "\\\"");
-            break;
-        case '\\':
-            fprintf(fp, "\\\\");
-            break;
-        case '\b':
-            fprintf(fp, "\\b");
-            break;
-        case '\f':
-            fprintf(fp, "\\f");
-            break;
-        case '\n':
-            fprintf(fp, "\\n");
-            break;
-        case '\r':
-            fprintf(fp, "\\r");
-            break;
-        case '\t':
-            fprintf(fp, "\\t");
-            break;
-        default:
-            if (c < 32 || c == 127) {
-                fprintf(fp, "\\u%04x", c);
-            } else {
-                fputc(c, fp);
-            }
-        }
-    }
-}
-
-static void writeCsvField(FILE *fp, const char *str, size_t len) {
-    bool needsQuotes = false;
-    for (size_t j = 0; j < len; j++) {
-        if (str[j] == ',' || str[j] == '"' || str[j] == '\n' ||
-            str[j] == '\r') {
-            needsQuotes = true;
-            break;
-        }
-    }
-
-    if (needsQuotes) {
-        fputc('"', fp);
-        for (size_t j = 0; j < len; j++) {
-            if (str[j] == '"') {
-                fputc('"', fp);
-            }
-            fputc(str[j], fp);
-        }
-        fputc('"', fp);
-    } else {
-        fwrite(str, 1, len, fp);
-    }
-}
-
 kvidxError kvidxLmdbExport(kvidxInstance *i, const char *filename,
                            const kvidxExportOptions *options,
                            kvidxProgressCallback callback, void *userData) {
@@ -1662,34 +2529,20 @@ kvidxError kvidxLmdbExport(kvidxInstance *i, const char *filename,
     kvidxError result = KVIDX_OK;
     uint64_t count = 0;
 
-    /* Write format-specific header */
-    if (options->format == KVIDX_EXPORT_BINARY) {
-        kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
-                                    .version = KVIDX_BINARY_VERSION,
-                                    .reserved = 0,
-                                    .entryCount = total};
-        if (fwrite(&header, sizeof(header), 1, fp) != 1) {
-            result = KVIDX_ERROR_IO;
-            goto cleanup;
-        }
-    } else if (options->format == KVIDX_EXPORT_JSON) {
-        fprintf(fp, "{\"format\":\"kvidx-json\",\"version\":1,\"entries\":[");
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-    } else if (options->format == KVIDX_EXPORT_CSV) {
-        if (options->includeMetadata) {
-            fprintf(fp, "key,term,cmd,data\n");
-        } else {
-            fprintf(fp, "key,data\n");
-        }
+    /* Write header */
+    kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
+                                .version = KVIDX_BINARY_VERSION,
+                                .reserved = 0,
+                                .entryCount = total};
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        result = KVIDX_ERROR_IO;
+        goto cleanup;
     }
 
     /* Position at start of range */
     MDB_val mkey = {.mv_size = sizeof(options->startKey),
                     .mv_data = (void *)&options->startKey};
     MDB_val mval;
-    bool firstEntry = true;
 
     rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_SET_RANGE);
 
@@ -1704,40 +2557,11 @@ kvidxError kvidxLmdbExport(kvidxInstance *i, const char *filename,
         uint64_t term = extractTerm(&mval);
         uint64_t cmd = extractCmd(&mval);
         size_t dataLen;
-        const uint8_t *data = extractData(&mval, &dataLen);
+        const uint8_t *data = extractData(s, &mval, &dataLen);
 
-        if (options->format == KVIDX_EXPORT_BINARY) {
-            result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
-            if (result != KVIDX_OK) {
-                goto cleanup;
-            }
-        } else if (options->format == KVIDX_EXPORT_JSON) {
-            if (!firstEntry) {
-                fprintf(fp, ",");
-            }
-            if (options->prettyPrint) {
-                fprintf(fp, "\n  ");
-            }
-            fprintf(fp, "{\"key\":%" PRIu64, key);
-            if (options->includeMetadata) {
-                fprintf(fp, ",\"term\":%" PRIu64 ",\"cmd\":%" PRIu64, term,
-                        cmd);
-            }
-            fprintf(fp, ",\"data\":\"");
-            if (data && dataLen > 0) {
-                writeJsonEscaped(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\"}");
-            firstEntry = false;
-        } else if (options->format == KVIDX_EXPORT_CSV) {
-            fprintf(fp, "%" PRIu64 ",", key);
-            if (options->includeMetadata) {
-                fprintf(fp, "%" PRIu64 ",%" PRIu64 ",", term, cmd);
-            }
-            if (data && dataLen > 0) {
-                writeCsvField(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\n");
+        result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
+        if (result != KVIDX_OK) {
+            goto cleanup;
         }
 
         count++;
@@ -1752,14 +2576,6 @@ kvidxError kvidxLmdbExport(kvidxInstance *i, const char *filename,
         rc = mdb_cursor_get(cursor, &mkey, &mval, MDB_NEXT);
     }
 
-    /* Write footer */
-    if (options->format == KVIDX_EXPORT_JSON) {
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-        fprintf(fp, "]}\n");
-    }
-
     if (callback && count > 0) {
         callback(count, total, userData);
     }
@@ -1772,27 +2588,35 @@ cleanup:
     return result;
 }
 
-kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
-                           const kvidxImportOptions *options,
-                           kvidxProgressCallback callback, void *userData) {
+/**
+ * Import a binary export.
+ *
+ * The file is memory-mapped and entries are packed from the mapping
+ * straight into space reserved in LMDB (MDB_RESERVE). Entries are committed
+ * in transactions of about options->commitBytes; a transaction that fills
+ * the map is aborted, the map grown, and that transaction replayed, so
+ * earlier transactions are never repeated.
+ */
+static kvidxError importOnce(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
     lmdbState *s = STATE(i);
     if (!s || !s->env || !filename || !options) {
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file: %s", filename);
-        return KVIDX_ERROR_IO;
+    kvidxMappedFile m;
+    kvidxError result = kvidxMapFile(i, filename, &m);
+    if (result != KVIDX_OK) {
+        return result;
     }
 
-    kvidxError result = KVIDX_OK;
     uint64_t count = 0;
 
     /* Clear if requested */
     if (options->clearBeforeImport) {
         if (!kvidxLmdbBegin(i)) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             return KVIDX_ERROR_INTERNAL;
         }
 
@@ -1802,20 +2626,20 @@ kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
             MDB_val mkey, mval;
             while (mdb_cursor_get(cursor, &mkey, &mval, MDB_FIRST) ==
                    MDB_SUCCESS) {
-                mdb_cursor_del(cursor, 0);
+                lmdbRc(s, mdb_cursor_del(cursor, 0));
             }
             mdb_cursor_close(cursor);
         }
 
         if (!kvidxLmdbCommit(i)) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             return KVIDX_ERROR_INTERNAL;
         }
     }
 
     /* Only binary import supported for now */
     if (options->format != KVIDX_EXPORT_BINARY) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                       "Only binary import is supported");
         return KVIDX_ERROR_NOT_SUPPORTED;
@@ -1823,20 +2647,20 @@ kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
 
     /* Read and validate header */
     kvidxBinaryHeader header;
-    if (fread(&header, sizeof(header), 1, fp) != 1) {
-        fclose(fp);
+    if (!kvidxMappedRead(&m, &header, sizeof(header))) {
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read header");
         return KVIDX_ERROR_IO;
     }
 
     if (header.magic != KVIDX_BINARY_MAGIC) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT, "Invalid binary format");
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
     if (header.version != KVIDX_BINARY_VERSION) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
                       "Unsupported version: %u", header.version);
         return KVIDX_ERROR_INVALID_ARGUMENT;
@@ -1844,62 +2668,91 @@ kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
 
     /* Begin transaction */
     if (!kvidxLmdbBegin(i)) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         return KVIDX_ERROR_INTERNAL;
     }
 
+    const uint64_t commitBytes = kvidxImportCommitBytes(options);
+    uint64_t pendingBytes = 0;
+
+    /* Where the open transaction started, for replay after MDB_MAP_FULL */
+    uint64_t txnIdx = 0;
+    uint64_t txnCount = 0;
+    size_t txnPos = m.pos;
+
     /* Read entries */
     for (uint64_t idx = 0; idx < header.entryCount; idx++) {
-        uint64_t key, term, cmd, dataLen;
-        uint8_t *data = NULL;
+        uint64_t key, term, cmd;
+        const uint8_t *data;
+        size_t dataLen;
 
-        if (fread(&key, sizeof(key), 1, fp) != 1 ||
-            fread(&term, sizeof(term), 1, fp) != 1 ||
-            fread(&cmd, sizeof(cmd), 1, fp) != 1 ||
-            fread(&dataLen, sizeof(dataLen), 1, fp) != 1) {
+        if (!kvidxMappedEntry(&m, &key, &term, &cmd, &data, &dataLen)) {
             result = KVIDX_ERROR_IO;
             break;
         }
 
-        if (dataLen > 0) {
-            data = malloc(dataLen);
-            if (!data) {
-                result = KVIDX_ERROR_INTERNAL;
-                break;
-            }
-            if (fread(data, 1, dataLen, fp) != dataLen) {
-                free(data);
-                result = KVIDX_ERROR_IO;
-                break;
-            }
-        }
-
         /* Pack and insert */
-        size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
-        free(data);
-
-        if (!valBuf) {
-            result = KVIDX_ERROR_INTERNAL;
-            break;
-        }
-
         MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
-        MDB_val mval = {.mv_size = valLen, .mv_data = valBuf};
+        MDB_val mval = {.mv_size = packedHeaderSize(s, 0) + dataLen};
 
-        int flags = options->skipDuplicates ? MDB_NOOVERWRITE : 0;
-        int rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, flags);
-        free(valBuf);
+        int flags =
+            MDB_RESERVE | (options->skipDuplicates ? MDB_NOOVERWRITE : 0);
+        int rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, flags));
+        bool mapFull = rc == MDB_MAP_FULL;
 
-        if (rc != MDB_SUCCESS && rc != MDB_KEYEXIST) {
+        if (!mapFull && rc != MDB_SUCCESS && rc != MDB_KEYEXIST) {
             result = KVIDX_ERROR_INTERNAL;
             break;
         }
 
         if (rc == MDB_SUCCESS) {
+            packValueInto(s, mval.mv_data, term, cmd, 0, data, dataLen);
             count++;
         }
 
+        /* Start a new transaction once this one is big enough */
+        pendingBytes += mval.mv_size;
+        if (!mapFull && pendingBytes >= commitBytes) {
+            if (kvidxLmdbCommit(i)) {
+                txnIdx = idx + 1;
+                txnCount = count;
+                txnPos = m.pos;
+            } else if (s->mapFull) {
+                mapFull = true;
+            } else {
+                result = KVIDX_ERROR_INTERNAL;
+                break;
+            }
+            pendingBytes = 0;
+        }
+
+        if (mapFull) {
+            if (s->writeTxn) {
+                mdb_txn_abort(s->writeTxn);
+                s->writeTxn = NULL;
+            }
+            if (!retryAfterMapFull(i)) {
+                kvidxUnmapFile(&m);
+                return KVIDX_ERROR_DISK_FULL;
+            }
+
+            /* Replay the discarded transaction; the loop increment lands
+             * on txnIdx */
+            idx = txnIdx - 1;
+            count = txnCount;
+            m.pos = txnPos;
+            pendingBytes = 0;
+        }
+
+        if (!s->writeTxn && !kvidxLmdbBegin(i)) {
+            kvidxUnmapFile(&m);
+            return KVIDX_ERROR_INTERNAL;
+        }
+
+        if (mapFull) {
+            continue;
+        }
+
         if (callback && count % 100 == 0) {
             if (!callback(count, header.entryCount, userData)) {
                 result = KVIDX_ERROR_CANCELLED;
@@ -1908,7 +2761,7 @@ kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
         }
     }
 
-    fclose(fp);
+    kvidxUnmapFile(&m);
 
     if (result == KVIDX_OK) {
         if (!kvidxLmdbCommit(i)) {
@@ -1937,23 +2790,35 @@ kvidxError kvidxLmdbApplyConfig(kvidxInstance *i, const kvidxConfig *config) {
     }
 
     /* LMDB configuration is largely set at environment open time.
-     * We can adjust map size dynamically if needed. */
+     * We can adjust map size dynamically if needed. lmdbMapSizeBytes only
+     * ever grows the map; the legacy mmapSizeBytes sets it outright. */
+    uint64_t mapSize = 0;
     if (config->mmapSizeBytes > 0) {
-        int rc = mdb_env_set_mapsize(s->env, config->mmapSizeBytes);
-        if (rc != MDB_SUCCESS) {
-            kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to set map size: %s",
-                          mdb_strerror(rc));
-            return KVIDX_ERROR_INTERNAL;
-        }
+        mapSize = (uint64_t)config->mmapSizeBytes;
     }
 
-    /* Sync mode can be adjusted via flags */
-    if (config->syncMode == KVIDX_SYNC_OFF) {
-        mdb_env_set_flags(s->env, MDB_NOSYNC, 1);
-    } else {
-        mdb_env_set_flags(s->env, MDB_NOSYNC, 0);
+    MDB_envinfo info;
+    if (config->lmdbMapSizeBytes &&
+        mdb_env_info(s->env, &info) == MDB_SUCCESS &&
+        config->lmdbMapSizeBytes > info.me_mapsize) {
+        mapSize = config->lmdbMapSizeBytes;
+    }
+
+    if (mapSize && !setMapSize(i, mapSize)) {
+        return KVIDX_ERROR_INTERNAL;
     }
 
+    /* Sync tiers and NOMEMINIT can be adjusted on a live environment.
+     * WRITEMAP, NORDAHEAD and maxreaders only take effect at open. */
+    unsigned int on = envFlagsFromConfig(config, true);
+    mdb_env_set_flags(s->env, RUNTIME_ENV_FLAGS & ~on, 0);
+    mdb_env_set_flags(s->env, on, 1);
+
+    /* Checksums need the v2 flags byte to mark which values carry one */
+    s->writeChecksums = config->valueChecksums &&
+                        s->valueFormat >= LMDB_VALUE_FORMAT_V2;
+    s->verifyChecksums = config->verifyChecksums;
+
     return KVIDX_OK;
 }
 
@@ -2024,6 +2889,7 @@ bool kvidxLmdbAbort(kvidxInstance *i) {
 
     mdb_txn_abort(s->writeTxn);
     s->writeTxn = NULL;
+    s->transactions++;
     return true;
 }
 
@@ -2048,9 +2914,9 @@ bool kvidxLmdbAbort(kvidxInstance *i) {
  * @return KVIDX_OK on success, KVIDX_ERROR_CONDITION_FAILED if condition not
  * met
  */
-kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
-                             uint64_t cmd, const void *data, size_t dataLen,
-                             kvidxSetCondition condition) {
+static kvidxError insertExOnce(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2064,7 +2930,7 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
     case KVIDX_SET_ALWAYS: {
         /* Normal insert/replace */
         size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+        void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
         if (!valBuf) {
             result = KVIDX_ERROR_NOMEM;
             break;
@@ -2072,7 +2938,7 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
         MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
         MDB_val mval = {.mv_size = valLen, .mv_data = valBuf};
-        int rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+        int rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
         free(valBuf);
 
         if (rc != MDB_SUCCESS) {
@@ -2084,7 +2950,7 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
     case KVIDX_SET_IF_NOT_EXISTS: {
         /* Insert only if key doesn't exist */
         size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+        void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
         if (!valBuf) {
             result = KVIDX_ERROR_NOMEM;
             break;
@@ -2092,7 +2958,8 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
         MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
         MDB_val mval = {.mv_size = valLen, .mv_data = valBuf};
-        int rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, MDB_NOOVERWRITE);
+        int rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval,
+                                   MDB_NOOVERWRITE));
         free(valBuf);
 
         if (rc == MDB_KEYEXIST) {
@@ -2117,7 +2984,7 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
         /* Exists, update */
         size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+        void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
         if (!valBuf) {
             result = KVIDX_ERROR_NOMEM;
             break;
@@ -2125,7 +2992,7 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
         mval.mv_size = valLen;
         mval.mv_data = valBuf;
-        rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+        rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
         free(valBuf);
 
         if (rc != MDB_SUCCESS) {
@@ -2153,10 +3020,10 @@ kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
 /* --- Atomic Operations --- */
 
-kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
-                              uint64_t cmd, const void *data, size_t dataLen,
-                              uint64_t *oldTerm, uint64_t *oldCmd,
-                              void **oldData, size_t *oldDataLen) {
+static kvidxError getAndSetOnce(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2193,7 +3060,7 @@ kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
         }
 
         size_t dlen;
-        const uint8_t *dptr = extractData(&mval, &dlen);
+        const uint8_t *dptr = extractData(s, &mval, &dlen);
         if (oldData && dlen > 0) {
             *oldData = malloc(dlen);
             if (*oldData) {
@@ -2209,7 +3076,7 @@ kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Set new value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
     if (!valBuf) {
         if (ownTxn) {
             kvidxLmdbAbort(i);
@@ -2219,7 +3086,7 @@ kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
 
     mval.mv_size = valLen;
     mval.mv_data = valBuf;
-    rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+    rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
     free(valBuf);
 
     if (rc != MDB_SUCCESS) {
@@ -2236,8 +3103,9 @@ kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
     return KVIDX_OK;
 }
 
-kvidxError kvidxLmdbGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
-                                 uint64_t *cmd, void **data, size_t *dataLen) {
+static kvidxError getAndRemoveOnce(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2280,7 +3148,7 @@ kvidxError kvidxLmdbGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
     }
 
     size_t dlen;
-    const uint8_t *dptr = extractData(&mval, &dlen);
+    const uint8_t *dptr = extractData(s, &mval, &dlen);
     if (data && dlen > 0) {
         *data = malloc(dlen);
         if (*data) {
@@ -2294,7 +3162,7 @@ kvidxError kvidxLmdbGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
     }
 
     /* Delete */
-    rc = mdb_del(s->writeTxn, s->dbi, &mkey, NULL);
+    rc = lmdbRc(s, mdb_del(s->writeTxn, s->dbi, &mkey, NULL));
     if (rc != MDB_SUCCESS) {
         if (data && *data) {
             free(*data);
@@ -2315,11 +3183,11 @@ kvidxError kvidxLmdbGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
 
 /* --- Compare-And-Swap --- */
 
-kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
-                                   const void *expectedData, size_t expectedLen,
-                                   uint64_t newTerm, uint64_t newCmd,
-                                   const void *newData, size_t newDataLen,
-                                   bool *swapped) {
+static kvidxError compareAndSwapOnce(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
     *swapped = false;
@@ -2348,7 +3216,7 @@ kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
 
     /* Compare data */
     size_t currentLen;
-    const uint8_t *currentData = extractData(&mval, &currentLen);
+    const uint8_t *currentData = extractData(s, &mval, &currentLen);
 
     bool matches = false;
     if (expectedData == NULL && currentLen == 0) {
@@ -2371,7 +3239,8 @@ kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
 
     /* Data matches, perform update */
     size_t valLen;
-    void *valBuf = packValue(newTerm, newCmd, newData, newDataLen, &valLen);
+    void *valBuf =
+        packValue(s, newTerm, newCmd, 0, newData, newDataLen, &valLen);
     if (!valBuf) {
         if (ownTxn) {
             kvidxLmdbAbort(i);
@@ -2381,7 +3250,7 @@ kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
 
     mval.mv_size = valLen;
     mval.mv_data = valBuf;
-    rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+    rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
     free(valBuf);
 
     if (rc != MDB_SUCCESS) {
@@ -2402,9 +3271,9 @@ kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
 
 /* --- Append/Prepend --- */
 
-kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
-                           uint64_t cmd, const void *data, size_t dataLen,
-                           size_t *newLen) {
+static kvidxError appendOnce(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2423,13 +3292,13 @@ kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
     if (rc == MDB_NOTFOUND) {
         /* Key doesn't exist, create new */
         size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+        void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
         if (!valBuf) {
             result = KVIDX_ERROR_NOMEM;
         } else {
             mval.mv_size = valLen;
             mval.mv_data = valBuf;
-            rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+            rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
             free(valBuf);
             if (rc != MDB_SUCCESS) {
                 result = KVIDX_ERROR_INTERNAL;
@@ -2441,8 +3310,9 @@ kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
         /* Key exists, append */
         uint64_t existingTerm = extractTerm(&mval);
         uint64_t existingCmd = extractCmd(&mval);
+        uint64_t existingExpiry = extractExpiry(s, &mval);
         size_t existingLen;
-        const uint8_t *existingData = extractData(&mval, &existingLen);
+        const uint8_t *existingData = extractData(s, &mval, &existingLen);
 
         size_t totalLen = existingLen + dataLen;
         void *combinedData = malloc(totalLen);
@@ -2457,8 +3327,9 @@ kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
             }
 
             size_t valLen;
-            void *valBuf = packValue(existingTerm, existingCmd, combinedData,
-                                     totalLen, &valLen);
+            void *valBuf =
+                packValue(s, existingTerm, existingCmd, existingExpiry,
+                          combinedData, totalLen, &valLen);
             free(combinedData);
 
             if (!valBuf) {
@@ -2466,7 +3337,7 @@ kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
             } else {
                 mval.mv_size = valLen;
                 mval.mv_data = valBuf;
-                rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+                rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
                 free(valBuf);
                 if (rc != MDB_SUCCESS) {
                     result = KVIDX_ERROR_INTERNAL;
@@ -2492,9 +3363,9 @@ kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
     return result;
 }
 
-kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
-                            uint64_t cmd, const void *data, size_t dataLen,
-                            size_t *newLen) {
+static kvidxError prependOnce(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2512,13 +3383,13 @@ kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
     if (rc == MDB_NOTFOUND) {
         /* Key doesn't exist, create new */
         size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+        void *valBuf = packValue(s, term, cmd, 0, data, dataLen, &valLen);
         if (!valBuf) {
             result = KVIDX_ERROR_NOMEM;
         } else {
             mval.mv_size = valLen;
             mval.mv_data = valBuf;
-            rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+            rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
             free(valBuf);
             if (rc != MDB_SUCCESS) {
                 result = KVIDX_ERROR_INTERNAL;
@@ -2530,8 +3401,9 @@ kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
         /* Key exists, prepend */
         uint64_t existingTerm = extractTerm(&mval);
         uint64_t existingCmd = extractCmd(&mval);
+        uint64_t existingExpiry = extractExpiry(s, &mval);
         size_t existingLen;
-        const uint8_t *existingData = extractData(&mval, &existingLen);
+        const uint8_t *existingData = extractData(s, &mval, &existingLen);
 
         size_t totalLen = existingLen + dataLen;
         void *combinedData = malloc(totalLen);
@@ -2547,8 +3419,9 @@ kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
             }
 
             size_t valLen;
-            void *valBuf = packValue(existingTerm, existingCmd, combinedData,
-                                     totalLen, &valLen);
+            void *valBuf =
+                packValue(s, existingTerm, existingCmd, existingExpiry,
+                          combinedData, totalLen, &valLen);
             free(combinedData);
 
             if (!valBuf) {
@@ -2556,7 +3429,7 @@ kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
             } else {
                 mval.mv_size = valLen;
                 mval.mv_data = valBuf;
-                rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+                rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
                 free(valBuf);
                 if (rc != MDB_SUCCESS) {
                     result = KVIDX_ERROR_INTERNAL;
@@ -2614,7 +3487,7 @@ kvidxError kvidxLmdbGetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
     }
 
     size_t currentLen;
-    const uint8_t *currentData = extractData(&mval, &currentLen);
+    const uint8_t *currentData = extractData(s, &mval, &currentLen);
 
     /* Check if offset is valid */
     if (offset >= currentLen) {
@@ -2645,9 +3518,9 @@ kvidxError kvidxLmdbGetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
     return KVIDX_OK;
 }
 
-kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
-                                  const void *data, size_t dataLen,
-                                  size_t *newLen) {
+static kvidxError setValueRangeOnce(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen) {
     lmdbState *s = STATE(i);
     bool ownTxn = (s->writeTxn == NULL);
 
@@ -2675,8 +3548,9 @@ kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
 
     uint64_t existingTerm = extractTerm(&mval);
     uint64_t existingCmd = extractCmd(&mval);
+    uint64_t existingExpiry = extractExpiry(s, &mval);
     size_t currentLen;
-    const uint8_t *currentData = extractData(&mval, &currentLen);
+    const uint8_t *currentData = extractData(s, &mval, &currentLen);
 
     /* Calculate new size */
     size_t newSize = offset + dataLen;
@@ -2705,8 +3579,8 @@ kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
 
     /* Pack and store */
     size_t valLen;
-    void *valBuf =
-        packValue(existingTerm, existingCmd, newData, newSize, &valLen);
+    void *valBuf = packValue(s, existingTerm, existingCmd, existingExpiry,
+                             newData, newSize, &valLen);
     free(newData);
 
     if (!valBuf) {
@@ -2718,7 +3592,7 @@ kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
 
     mval.mv_size = valLen;
     mval.mv_data = valBuf;
-    rc = mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0);
+    rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
     free(valBuf);
 
     if (rc != MDB_SUCCESS) {
@@ -2741,8 +3615,98 @@ kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
 
 /* --- TTL/Expiration --- */
 
-kvidxError kvidxLmdbSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs) {
+/**
+ * Rewrite a v2 value with a new inline expiry and keep the TTL index in sync.
+ *
+ * The value header and the "_kvidx_ttl" index entry are updated in the same
+ * write transaction. The index only exists so ExpireScan() can find
+ * expiring keys without walking all data; TTL reads use the inline expiry.
+ *
+ * @param i          The kvidx instance (must use LMDB_VALUE_FORMAT_V2)
+ * @param key        The record key
+ * @param expiresAt  Expiry timestamp in milliseconds, or 0 to remove expiry
+ * @return KVIDX_OK, KVIDX_ERROR_NOT_FOUND, or an error code
+ */
+static kvidxError setInlineExpiry(kvidxInstance *i, uint64_t key,
+                                  uint64_t expiresAt) {
     lmdbState *s = STATE(i);
+    bool ownTxn = (s->writeTxn == NULL);
+
+    if (ownTxn && !kvidxLmdbBegin(i)) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
+    MDB_val mval;
+
+    int rc = mdb_get(s->writeTxn, s->dbi, &mkey, &mval);
+    if (rc != MDB_SUCCESS) {
+        if (ownTxn) {
+            kvidxLmdbAbort(i);
+        }
+        return rc == MDB_NOTFOUND ? KVIDX_ERROR_NOT_FOUND
+                                  : KVIDX_ERROR_INTERNAL;
+    }
+
+    /* Nothing to rewrite when persisting a key that never expired */
+    if (!expiresAt && !extractExpiry(s, &mval)) {
+        if (ownTxn) {
+            kvidxLmdbAbort(i);
+        }
+        return KVIDX_OK;
+    }
+
+    size_t dataLen;
+    const uint8_t *data = extractData(s, &mval, &dataLen);
+    size_t valLen;
+    void *valBuf = packValue(s, extractTerm(&mval), extractCmd(&mval),
+                             expiresAt, data, dataLen, &valLen);
+    if (!valBuf) {
+        if (ownTxn) {
+            kvidxLmdbAbort(i);
+        }
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    mval.mv_size = valLen;
+    mval.mv_data = valBuf;
+    rc = lmdbRc(s, mdb_put(s->writeTxn, s->dbi, &mkey, &mval, 0));
+    free(valBuf);
+
+    if (rc == MDB_SUCCESS) {
+        if (expiresAt) {
+            MDB_val tval = {.mv_size = sizeof(expiresAt),
+                            .mv_data = &expiresAt};
+            rc = lmdbRc(s, mdb_put(s->writeTxn, s->ttlDbi, &mkey, &tval, 0));
+        } else {
+            rc = lmdbRc(s, mdb_del(s->writeTxn, s->ttlDbi, &mkey, NULL));
+            if (rc == MDB_NOTFOUND) {
+                rc = MDB_SUCCESS;
+            }
+        }
+    }
+
+    if (rc != MDB_SUCCESS) {
+        if (ownTxn) {
+            kvidxLmdbAbort(i);
+        }
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    if (ownTxn && !kvidxLmdbCommit(i)) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    return KVIDX_OK;
+}
+
+static kvidxError setExpireOnce(kvidxInstance *i, uint64_t key,
+                                uint64_t ttlMs) {
+    lmdbState *s = STATE(i);
+
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        return setInlineExpiry(i, key, currentTimeMsLmdb() + ttlMs);
+    }
 
     /* Check if key exists */
     if (!kvidxLmdbExists(i, key)) {
@@ -2766,20 +3730,25 @@ kvidxError kvidxLmdbSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs) {
     MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
     MDB_val mval = {.mv_size = sizeof(expiresAt), .mv_data = &expiresAt};
 
-    rc = mdb_put(txn, s->ttlDbi, &mkey, &mval, 0);
+    rc = lmdbRc(s, mdb_put(txn, s->ttlDbi, &mkey, &mval, 0));
     if (rc != MDB_SUCCESS) {
         mdb_txn_abort(txn);
         return KVIDX_ERROR_INTERNAL;
     }
 
-    rc = mdb_txn_commit(txn);
+    rc = commitTxn(s, txn);
     return (rc == MDB_SUCCESS) ? KVIDX_OK : KVIDX_ERROR_INTERNAL;
 }
 
-kvidxError kvidxLmdbSetExpireAt(kvidxInstance *i, uint64_t key,
-                                uint64_t timestampMs) {
+static kvidxError setExpireAtOnce(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs) {
     lmdbState *s = STATE(i);
 
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        /* 0 means "no expiry" inline; epoch 0 and 1ms are equally past */
+        return setInlineExpiry(i, key, timestampMs ? timestampMs : 1);
+    }
+
     if (!kvidxLmdbExists(i, key)) {
         return KVIDX_ERROR_NOT_FOUND;
     }
@@ -2797,19 +3766,42 @@ kvidxError kvidxLmdbSetExpireAt(kvidxInstance *i, uint64_t key,
     MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
     MDB_val mval = {.mv_size = sizeof(timestampMs), .mv_data = &timestampMs};
 
-    rc = mdb_put(txn, s->ttlDbi, &mkey, &mval, 0);
+    rc = lmdbRc(s, mdb_put(txn, s->ttlDbi, &mkey, &mval, 0));
     if (rc != MDB_SUCCESS) {
         mdb_txn_abort(txn);
         return KVIDX_ERROR_INTERNAL;
     }
 
-    rc = mdb_txn_commit(txn);
+    rc = commitTxn(s, txn);
     return (rc == MDB_SUCCESS) ? KVIDX_OK : KVIDX_ERROR_INTERNAL;
 }
 
 int64_t kvidxLmdbGetTTL(kvidxInstance *i, uint64_t key) {
     lmdbState *s = STATE(i);
 
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        /* Single lookup: the expiry rides along in the value header */
+        if (!ensureReadTxn(i)) {
+            return KVIDX_TTL_NONE;
+        }
+
+        MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
+        MDB_val mval;
+        int rc = mdb_get(getActiveTxn(i), s->dbi, &mkey, &mval);
+        uint64_t expiresAt = rc == MDB_SUCCESS ? extractExpiry(s, &mval) : 0;
+        resetReadTxn(i);
+
+        if (rc == MDB_NOTFOUND) {
+            return KVIDX_TTL_NOT_FOUND;
+        }
+        if (rc != MDB_SUCCESS || !expiresAt) {
+            return KVIDX_TTL_NONE;
+        }
+
+        uint64_t now = currentTimeMsLmdb();
+        return expiresAt <= now ? 0 : (int64_t)(expiresAt - now);
+    }
+
     if (!kvidxLmdbExists(i, key)) {
         return KVIDX_TTL_NOT_FOUND;
     }
@@ -2847,9 +3839,13 @@ int64_t kvidxLmdbGetTTL(kvidxInstance *i, uint64_t key) {
     return (int64_t)(expiresAt - now);
 }
 
-kvidxError kvidxLmdbPersist(kvidxInstance *i, uint64_t key) {
+static kvidxError persistOnce(kvidxInstance *i, uint64_t key) {
     lmdbState *s = STATE(i);
 
+    if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+        return setInlineExpiry(i, key, 0);
+    }
+
     if (!kvidxLmdbExists(i, key)) {
         return KVIDX_ERROR_NOT_FOUND;
     }
@@ -2865,19 +3861,19 @@ kvidxError kvidxLmdbPersist(kvidxInstance *i, uint64_t key) {
     }
 
     MDB_val mkey = {.mv_size = sizeof(key), .mv_data = &key};
-    rc = mdb_del(txn, s->ttlDbi, &mkey, NULL);
+    rc = lmdbRc(s, mdb_del(txn, s->ttlDbi, &mkey, NULL));
 
     if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND) {
         mdb_txn_abort(txn);
         return KVIDX_ERROR_INTERNAL;
     }
 
-    rc = mdb_txn_commit(txn);
+    rc = commitTxn(s, txn);
     return (rc == MDB_SUCCESS) ? KVIDX_OK : KVIDX_ERROR_INTERNAL;
 }
 
-kvidxError kvidxLmdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
-                               uint64_t *expiredCount) {
+static kvidxError expireScanOnce(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount) {
     lmdbState *s = STATE(i);
     uint64_t expired = 0;
 
@@ -2958,23 +3954,531 @@ kvidxError kvidxLmdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
     /* Delete expired keys */
     for (size_t idx = 0; idx < keyCount; idx++) {
         uint64_t key = keysToDelete[idx];
+        MDB_val delKey = {.mv_size = sizeof(key), .mv_data = &key};
+
+        /* v2: the inline expiry is authoritative. An index entry whose value
+         * was since removed or overwritten without a TTL is just dropped. */
+        if (s->valueFormat >= LMDB_VALUE_FORMAT_V2) {
+            MDB_val cur;
+            uint64_t inlineExpiry = 0;
+            if (mdb_get(txn, s->dbi, &delKey, &cur) == MDB_SUCCESS) {
+                inlineExpiry = extractExpiry(s, &cur);
+            }
+
+            if (!inlineExpiry) {
+                lmdbRc(s, mdb_del(txn, s->ttlDbi, &delKey, NULL));
+                continue;
+            }
+
+            if (inlineExpiry > now) {
+                continue;
+            }
+        }
 
         /* Delete from main db */
-        MDB_val delKey = {.mv_size = sizeof(key), .mv_data = &key};
-        mdb_del(txn, s->dbi, &delKey, NULL);
+        lmdbRc(s, mdb_del(txn, s->dbi, &delKey, NULL));
 
         /* Delete from TTL db */
-        mdb_del(txn, s->ttlDbi, &delKey, NULL);
+        lmdbRc(s, mdb_del(txn, s->ttlDbi, &delKey, NULL));
 
+        kvidxChangeNoteExpired(i, key);
         expired++;
     }
 
     free(keysToDelete);
 
-    rc = mdb_txn_commit(txn);
+    rc = commitTxn(s, txn);
     if (expiredCount) {
         *expiredCount = expired;
     }
 
     return (rc == MDB_SUCCESS) ? KVIDX_OK : KVIDX_ERROR_INTERNAL;
 }
+
+/* ====================================================================
+ * Map-Full Retry Wrappers
+ * ====================================================================
+ * Public write entry points. Each runs its *Once() implementation and, if
+ * that failed with MDB_MAP_FULL while owning its own transaction, grows the
+ * map and runs it again. Inside a caller's Begin()/Commit() nothing can be
+ * replayed, so the failure is returned as-is (see Map Size Management).
+ */
+
+bool kvidxLmdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                     uint64_t cmd, const void *data, size_t dataLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    bool ok;
+    do {
+        ok = insertOnce(i, key, term, cmd, data, dataLen);
+    } while (!ok && !callerTxn && retryAfterMapFull(i));
+    return ok;
+}
+
+bool kvidxLmdbRemove(kvidxInstance *i, uint64_t key) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    bool ok;
+    do {
+        ok = removeOnce(i, key);
+    } while (!ok && !callerTxn && retryAfterMapFull(i));
+    return ok;
+}
+
+bool kvidxLmdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    bool ok;
+    do {
+        ok = removeAfterNInclusiveOnce(i, key);
+    } while (!ok && !callerTxn && retryAfterMapFull(i));
+    return ok;
+}
+
+bool kvidxLmdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    bool ok;
+    do {
+        ok = removeBeforeNInclusiveOnce(i, key);
+    } while (!ok && !callerTxn && retryAfterMapFull(i));
+    return ok;
+}
+
+kvidxError kvidxLmdbRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                uint64_t endKey, bool startInclusive,
+                                bool endInclusive, uint64_t *deletedCount) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = removeRangeOnce(i, startKey, endKey, startInclusive,
+                                 endInclusive, deletedCount);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbImport(kvidxInstance *i, const char *filename,
+                           const kvidxImportOptions *options,
+                           kvidxProgressCallback callback, void *userData) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = importOnce(i, filename, options, callback, userData);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             kvidxSetCondition condition) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = insertExOnce(i, key, term, cmd, data, dataLen, condition);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              uint64_t *oldTerm, uint64_t *oldCmd,
+                              void **oldData, size_t *oldDataLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = getAndSetOnce(i, key, term, cmd, data, dataLen, oldTerm,
+                               oldCmd, oldData, oldDataLen);
+        if (result != KVIDX_OK && oldData) {
+            free(*oldData);
+            *oldData = NULL;
+        }
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbGetAndRemove(kvidxInstance *i, uint64_t key, uint64_t *term,
+                                 uint64_t *cmd, void **data, size_t *dataLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = getAndRemoveOnce(i, key, term, cmd, data, dataLen);
+        if (result != KVIDX_OK && data) {
+            free(*data);
+            *data = NULL;
+        }
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                   const void *expectedData, size_t expectedLen,
+                                   uint64_t newTerm, uint64_t newCmd,
+                                   const void *newData, size_t newDataLen,
+                                   bool *swapped) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = compareAndSwapOnce(i, key, expectedData, expectedLen, newTerm,
+                                    newCmd, newData, newDataLen, swapped);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                           uint64_t cmd, const void *data, size_t dataLen,
+                           size_t *newLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = appendOnce(i, key, term, cmd, data, dataLen, newLen);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                            uint64_t cmd, const void *data, size_t dataLen,
+                            size_t *newLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = prependOnce(i, key, term, cmd, data, dataLen, newLen);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbSetValueRange(kvidxInstance *i, uint64_t key, size_t offset,
+                                  const void *data, size_t dataLen,
+                                  size_t *newLen) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = setValueRangeOnce(i, key, offset, data, dataLen, newLen);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = setExpireOnce(i, key, ttlMs);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbSetExpireAt(kvidxInstance *i, uint64_t key,
+                                uint64_t timestampMs) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = setExpireAtOnce(i, key, timestampMs);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbPersist(kvidxInstance *i, uint64_t key) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        result = persistOnce(i, key);
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+kvidxError kvidxLmdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                               uint64_t *expiredCount) {
+    bool callerTxn = STATE(i)->writeTxn != NULL;
+    kvidxError result;
+    do {
+        /* Expired keys are noted as they go; a failed attempt rolled back */
+        const size_t mark = kvidxChangeMark(i);
+        result = expireScanOnce(i, maxKeys, expiredCount);
+        if (result != KVIDX_OK) {
+            kvidxChangeRewind(i, mark);
+        }
+    } while (result != KVIDX_OK && !callerTxn && retryAfterMapFull(i));
+    return result;
+}
+
+/* ====================================================================
+ * Storage Replication (v0.10.0)
+ * ==================================================================== */
+
+/**
+ * @section Storage Replication
+ *
+ * mdb_env_copyfd2() writes a consistent copy of the environment from one
+ * read transaction, so writers continue while it runs. A helper thread
+ * copies into a pipe while this thread streams the other end, so the copy
+ * is never written to local disk. With kvidxConfig.lmdbCompactCopy the copy
+ * omits free pages (MDB_CP_COMPACT).
+ *
+ * The receiver stages data.mdb beside the environment, closes, renames it
+ * over the old data.mdb and reopens. Readers from kvidxLmdbOpenReader()
+ * must be closed first.
+ */
+
+/** Name of the data file in a replication stream */
+#define REPLICATION_FILE "data.mdb"
+
+typedef struct lmdbCopy {
+    MDB_env *env;
+    int fd; /* Pipe write end, closed by the copy thread */
+    unsigned int flags;
+    int rc;
+} lmdbCopy;
+
+static void *lmdbCopyMain(void *arg) {
+    lmdbCopy *c = arg;
+
+    /* A closed reader must fail the copy with EPIPE, not kill the process */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    c->rc = mdb_env_copyfd2(c->env, c->fd, c->flags);
+    close(c->fd);
+
+    /* Collect a pending SIGPIPE so it is not delivered elsewhere. A
+     * compacting copy writes (and collects its own) on an LMDB thread. */
+    sigset_t pending;
+    if (c->rc == EPIPE && sigpending(&pending) == 0 &&
+        sigismember(&pending, SIGPIPE)) {
+        int sig;
+        sigwait(&set, &sig);
+    }
+    return NULL;
+}
+
+bool kvidxLmdbCopyStorageForReplication(kvidxInstance *i,
+                                        kvidxStreamWriteCallback networkWrite,
+                                        void *networkState) {
+    const lmdbState *s = STATE(i);
+
+    /* The copy takes the writer lock to snapshot the meta pages */
+    if (s->writeTxn) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                               "Cannot copy storage inside a transaction");
+    }
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_IO, "Failed to create pipe: %s",
+                               strerror(errno));
+    }
+
+    lmdbCopy c = {.env = s->env, .fd = fds[1]};
+    if (i->configInitialized && i->config.lmdbCompactCopy) {
+        c.flags = MDB_CP_COMPACT;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, lmdbCopyMain, &c) != 0) {
+        close(fds[0]);
+        close(fds[1]);
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_INTERNAL,
+                               "Failed to start copy thread");
+    }
+
+    kvidxReplicationSender sender;
+    kvidxReplicationSendBegin(&sender, networkWrite, networkState, "lmdb");
+    kvidxReplicationSendFd(&sender, REPLICATION_FILE, fds[0]);
+
+    /* Closing the read end stops a copy the network can't take */
+    close(fds[0]);
+    pthread_join(thread, NULL);
+
+    const bool sent = kvidxReplicationSendEnd(&sender);
+    if (c.rc != MDB_SUCCESS && c.rc != EPIPE) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_IO,
+                               "Environment copy failed: %s",
+                               mdb_strerror(c.rc));
+    }
+    if (!sent || c.rc != MDB_SUCCESS) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_IO, "Failed to send snapshot");
+    }
+    KVIDX_SET_OK_RETURN(i);
+}
+
+/**
+ * Checks shared by receiving and replacing. Creates the staging directory
+ * and copies the environment path and the path of its data file.
+ */
+static kvidxError beginReplace(kvidxInstance *i, char **dir, char **envPath,
+                               char **path) {
+    const lmdbState *s = STATE(i);
+    if (s->sharedEnv) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot replace storage through a reader");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (s->writeTxn) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot replace storage inside a transaction");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Everything below outlives the environment */
+    *envPath = strdup(s->envPath);
+    *path = *envPath ? malloc(strlen(*envPath) + sizeof("/" REPLICATION_FILE))
+                     : NULL;
+    *dir = *path ? kvidxReplicationTempDir(*envPath) : NULL;
+    if (!*dir) {
+        free(*path);
+        free(*envPath);
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create staging directory");
+        return KVIDX_ERROR_IO;
+    }
+    strcpy(*path, *envPath);
+    strcat(*path, "/" REPLICATION_FILE);
+    return KVIDX_OK;
+}
+
+/**
+ * Close, rename dir/REPLICATION_FILE over the data file at path and reopen
+ * the environment at envPath.
+ */
+static kvidxError installStaged(kvidxInstance *i, const char *dir,
+                                const char *envPath, const char *path) {
+    kvidxLmdbClose(i);
+    char staged[PATH_MAX];
+    snprintf(staged, sizeof(staged), "%s/" REPLICATION_FILE, dir);
+    return kvidxReplicationInstall(i, staged, path, envPath);
+}
+
+static void endReplace(char *dir, char *envPath, char *path) {
+    kvidxReplicationRemoveDir(dir);
+    free(dir);
+    free(path);
+    free(envPath);
+}
+
+bool kvidxLmdbCopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead,
+    void *networkState) {
+    char *dir;
+    char *envPath;
+    char *path;
+    if (beginReplace(i, &dir, &envPath, &path) != KVIDX_OK) {
+        return false;
+    }
+
+    kvidxError result = kvidxReplicationReceiveFiles(
+        i, networkRead, networkState, "lmdb", dir, REPLICATION_FILE);
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, envPath, path);
+    }
+
+    endReplace(dir, envPath, path);
+    return result == KVIDX_OK;
+}
+
+/**
+ * Replace every entry with a binary export stream: load it into a new
+ * environment in the staging directory, then install its data.mdb the
+ * same way a received snapshot is installed.
+ */
+kvidxError kvidxLmdbReplaceAll(kvidxInstance *i, kvidxStreamReadCallback read,
+                               void *streamData) {
+    char *dir;
+    char *envPath;
+    char *path;
+    kvidxError result = beginReplace(i, &dir, &envPath, &path);
+    if (result != KVIDX_OK) {
+        return result;
+    }
+
+    result = kvidxReplicationBuild(i, dir, NULL, read, streamData);
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, envPath, path);
+    }
+
+    endReplace(dir, envPath, path);
+    return result;
+}
+
+/* ====================================================================
+ * Space Reclamation (v0.10.0)
+ * ==================================================================== */
+
+/**
+ * @section Space Reclamation
+ *
+ * LMDB reuses freed pages but never shrinks data.mdb. Once the freelist
+ * holds kvidxConfig.lmdbReclaimFreePercent of the file's pages, a
+ * compacting copy (MDB_CP_COMPACT, which leaves free pages out) is written
+ * to a staging directory and installed the way a received snapshot is.
+ * The copy is a single step however many pages it frees.
+ */
+
+/* Bytes allocated for the file at path, 0 if unknown */
+static uint64_t allocatedBytes(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_blocks * 512 : 0;
+}
+
+/* Pages of data.mdb in use: up to and including the last one written */
+static uint64_t filePages(MDB_env *env) {
+    MDB_envinfo info;
+    if (mdb_env_info(env, &info) != MDB_SUCCESS) {
+        return 0;
+    }
+    return (uint64_t)info.me_last_pgno + 1;
+}
+
+kvidxError kvidxLmdbReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                 kvidxReclaimResult *result) {
+    (void)maxPages;
+    lmdbState *s = STATE(i);
+    if (s->writeTxn) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot reclaim space inside a transaction");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (!ensureReadTxn(i)) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Failed to begin read transaction");
+        return KVIDX_ERROR_INTERNAL;
+    }
+    const uint64_t freePages = freelistPages(getActiveTxn(i));
+    resetReadTxn(i);
+
+    const uint64_t pages = filePages(s->env);
+    uint64_t percent = DEFAULT_RECLAIM_FREE_PERCENT;
+    if (i->configInitialized && i->config.lmdbReclaimFreePercent > 0) {
+        percent = (uint64_t)i->config.lmdbReclaimFreePercent;
+    }
+
+    result->freePagesLeft = freePages;
+    if (!freePages || freePages * 100 < pages * percent) {
+        return KVIDX_OK;
+    }
+
+    char *dir;
+    char *envPath;
+    char *path;
+    kvidxError err = beginReplace(i, &dir, &envPath, &path);
+    if (err != KVIDX_OK) {
+        return err;
+    }
+
+    const uint64_t bytesBefore = allocatedBytes(path);
+    const int rc = mdb_env_copy2(s->env, dir, MDB_CP_COMPACT);
+    if (rc != MDB_SUCCESS) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Compacting copy failed: %s",
+                      mdb_strerror(rc));
+        err = KVIDX_ERROR_IO;
+    } else {
+        err = installStaged(i, dir, envPath, path);
+    }
+
+    if (err == KVIDX_OK) {
+        /* installStaged() reopened i with a new state */
+        const uint64_t pagesAfter = filePages(STATE(i)->env);
+        const uint64_t bytesAfter = allocatedBytes(path);
+        result->pagesFreed = pages > pagesAfter ? pages - pagesAfter : 0;
+        result->bytesReclaimed =
+            bytesBefore > bytesAfter ? bytesBefore - bytesAfter : 0;
+        result->freePagesLeft = 0;
+    }
+
+    endReplace(dir, envPath, path);
+    return err;
+}
@@ -6,6 +6,7 @@ __BEGIN_DECLS
 /* Open / Close / Management */
 bool kvidxLmdbOpen(kvidxInstance *i, const char *filename, const char **err);
 bool kvidxLmdbClose(kvidxInstance *i);
+bool kvidxLmdbOpenReader(kvidxInstance *i, kvidxInstance *reader);
 bool kvidxLmdbFsync(kvidxInstance *i);
 
 /* Transactional Control */
@@ -21,6 +22,11 @@ bool kvidxLmdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
 bool kvidxLmdbGetNext(kvidxInstance *i, uint64_t previousKey, uint64_t *nextKey,
                       uint64_t *nextTerm, uint64_t *cmd, const uint8_t **data,
                       size_t *len);
+kvidxError kvidxLmdbScanRange(kvidxInstance *i, uint64_t startKey,
+                              uint64_t endKey, kvidxScanVisitor visit,
+                              void *ctx);
+kvidxError kvidxLmdbVerifyRange(kvidxInstance *i, uint64_t startKey,
+                                uint64_t endKey, kvidxVerifyResult *result);
 bool kvidxLmdbExists(kvidxInstance *i, uint64_t key);
 bool kvidxLmdbExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
 bool kvidxLmdbMax(kvidxInstance *i, uint64_t *key);
@@ -107,4 +113,20 @@ kvidxError kvidxLmdbPersist(kvidxInstance *i, uint64_t key);
 kvidxError kvidxLmdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
                                uint64_t *expiredCount);
 
+/* Storage Replication */
+bool kvidxLmdbCopyStorageForReplication(kvidxInstance *i,
+                                        kvidxStreamWriteCallback networkWrite,
+                                        void *networkState);
+bool kvidxLmdbCopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead, void *networkState);
+kvidxError kvidxLmdbReplaceAll(kvidxInstance *i, kvidxStreamReadCallback read,
+                               void *streamData);
+
+/* Space Reclamation */
+kvidxError kvidxLmdbReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                 kvidxReclaimResult *result);
+
+/* Work Counters */
+void kvidxLmdbIoCounters(kvidxInstance *i, kvidxIoCounters *counters);
+
 __END_DECLS
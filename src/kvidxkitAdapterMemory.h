@@ -0,0 +1,107 @@
+#pragma once
+
+#include "kvidxkit.h"
+__BEGIN_DECLS
+
+/* Open / Close / Management */
+bool kvidxMemoryOpen(kvidxInstance *i, const char *filename, const char **err);
+bool kvidxMemoryClose(kvidxInstance *i);
+bool kvidxMemoryFsync(kvidxInstance *i);
+
+/* Transactional Control */
+bool kvidxMemoryBegin(kvidxInstance *i);
+bool kvidxMemoryCommit(kvidxInstance *i);
+
+/* Reading */
+bool kvidxMemoryGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                    uint64_t *cmd, const uint8_t **data, size_t *len);
+bool kvidxMemoryGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
+                        uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                        size_t *len);
+bool kvidxMemoryGetNext(kvidxInstance *i, uint64_t previousKey,
+                        uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
+                        const uint8_t **data, size_t *len);
+bool kvidxMemoryExists(kvidxInstance *i, uint64_t key);
+bool kvidxMemoryExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
+bool kvidxMemoryMax(kvidxInstance *i, uint64_t *key);
+bool kvidxMemoryInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen);
+
+/* Deleting */
+bool kvidxMemoryRemove(kvidxInstance *i, uint64_t key);
+bool kvidxMemoryRemoveAfterNInclusive(kvidxInstance *i, uint64_t key);
+bool kvidxMemoryRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key);
+
+/* Statistics */
+kvidxError kvidxMemoryGetStats(kvidxInstance *i, kvidxStats *stats);
+kvidxError kvidxMemoryGetKeyCount(kvidxInstance *i, uint64_t *count);
+kvidxError kvidxMemoryGetMinKey(kvidxInstance *i, uint64_t *key);
+kvidxError kvidxMemoryGetDataSize(kvidxInstance *i, uint64_t *bytes);
+
+/* Configuration */
+kvidxError kvidxMemoryApplyConfig(kvidxInstance *i, const kvidxConfig *config);
+
+/* Range Operations */
+kvidxError kvidxMemoryRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount);
+kvidxError kvidxMemoryCountRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, uint64_t *count);
+kvidxError kvidxMemoryExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool *exists);
+
+/* Storage Primitives */
+/* Conditional writes */
+kvidxError kvidxMemoryInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition);
+
+/* Transaction abort */
+bool kvidxMemoryAbort(kvidxInstance *i);
+
+/* Atomic operations */
+kvidxError kvidxMemoryGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen);
+kvidxError kvidxMemoryGetAndRemove(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen);
+
+/* Compare-and-swap */
+kvidxError kvidxMemoryCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped);
+
+/* Append/Prepend */
+kvidxError kvidxMemoryAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen);
+kvidxError kvidxMemoryPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen);
+
+/* Partial value access */
+kvidxError kvidxMemoryGetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, size_t length, void **data,
+                                    size_t *actualLen);
+kvidxError kvidxMemorySetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen);
+
+/* TTL/Expiration */
+kvidxError kvidxMemorySetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs);
+kvidxError kvidxMemorySetExpireAt(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs);
+int64_t kvidxMemoryGetTTL(kvidxInstance *i, uint64_t key);
+kvidxError kvidxMemoryPersist(kvidxInstance *i, uint64_t key);
+kvidxError kvidxMemoryExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount);
+
+/* Iterator read pins */
+void kvidxMemoryPinReads(kvidxInstance *i);
+void kvidxMemoryUnpinReads(kvidxInstance *i);
+
+__END_DECLS
@@ -1,5 +1,13 @@
+/* Required for fsync and fileno under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "kvidxkitAdapterRocksdb.h"
 #include "../deps/rocksdb/include/rocksdb/c.h"
+#include "kvidxkit_internal.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -7,6 +15,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
 /*
  * RocksDB Adapter for kvidxkit
@@ -14,7 +23,11 @@
  * Value format (packed structure):
  *   bytes 0-7:   term (uint64_t, big-endian for proper ordering)
  *   bytes 8-15:  cmd (uint64_t, native endian)
- *   bytes 16+:   data blob
+ *   bytes 16-19: CRC32C of term, cmd and data (checksummed databases only)
+ *   remaining:   data blob
+ *
+ * Whether values carry a checksum is decided when the database is created
+ * (kvidxConfig.valueChecksums) and recorded in FORMAT_FILE.
  *
  * Keys are stored as big-endian uint64_t for lexicographic ordering.
  * RocksDB uses lexicographic comparison, so we encode keys as big-endian.
@@ -23,22 +36,125 @@
 /* Header size for term + cmd in value */
 #define VALUE_HEADER_SIZE (sizeof(uint64_t) * 2)
 
+/* Header size in checksummed databases: term + cmd + crc */
+#define VALUE_HEADER_SIZE_CRC (VALUE_HEADER_SIZE + sizeof(uint32_t))
+
+/* Records the value format. Kept in the database directory beside
+ * RocksDB's own files so it never shows up as a key. */
+#define FORMAT_FILE "/KVIDX_FORMAT"
+#define VALUE_FORMAT_CHECKSUMMED '2'
+
+/* Range deletes spanning this many keys compact the range afterwards
+ * (kvidxConfig.rocksdbCompactAfterDeleteKeys = 0) */
+#define COMPACT_AFTER_DELETE_KEYS_DEFAULT 100000
+
 typedef struct rocksdbState {
     rocksdb_t *db;
     rocksdb_options_t *options;
     rocksdb_readoptions_t *readOptions;
     rocksdb_writeoptions_t *writeOptions;
     rocksdb_writeoptions_t *syncWriteOptions;
+    rocksdb_cache_t *blockCache; /* Private block cache (NULL if default) */
     rocksdb_writebatch_wi_t
         *writeBatch; /* Active write batch with index (NULL when not in txn) */
     char *dbPath;
     /* Cached data buffer for get operations */
     char *cachedValue;
     size_t cachedValueLen;
+    /* Readers borrow db from another state and read from a snapshot */
+    const rocksdb_snapshot_t *snapshot;
+    bool sharedDb;
+    /* Value checksums */
+    bool checksummed;     /* Values carry a CRC32C (see FORMAT_FILE) */
+    bool verifyChecksums; /* kvidxConfig.verifyChecksums */
+    /* Range deletes */
+    uint64_t compactAfterDeleteKeys; /* Resolved rocksdbCompactAfterDeleteKeys */
+    bool truncated;         /* Removed keys await kvidxRocksdbReclaimSpace() */
+    uint64_t truncatedFirst; /* Keys they span */
+    uint64_t truncatedLast;
+    /* Work counters (see kvidxRocksdbIoCounters()) */
+    bool syncWrites;       /* syncWriteOptions has sync set */
+    uint64_t writes;       /* Writes applied, plus aborted batches */
+    uint64_t bytesWritten; /* Size of the write batches applied */
+    uint64_t syncs;        /* Writes that synced the WAL, and flushes */
 } rocksdbState;
 
 #define STATE(instance) ((rocksdbState *)(instance)->kvidxdata)
 
+/* ====================================================================
+ * Counted Writes
+ * ==================================================================== */
+
+/* Every write goes through these so kvidxRocksdbIoCounters() can report
+ * it. bytes is the write batch RocksDB appends to its WAL, or would with
+ * the WAL disabled; an empty batch is not counted. The writes are also
+ * bracketed by the rocksdb__write__start/done probes. */
+#define SYNCED(s, options)                                                     \
+    ((options) == (s)->syncWriteOptions && (s)->syncWrites)
+
+static void countWrite(rocksdbState *s, const rocksdb_writeoptions_t *options,
+                       size_t bytes, const char *err) {
+    if (err || !bytes) {
+        return;
+    }
+    s->writes++;
+    s->bytesWritten += bytes;
+    if (SYNCED(s, options)) {
+        s->syncs++;
+    }
+}
+
+static void dbPut(rocksdbState *s, const rocksdb_writeoptions_t *options,
+                  const char *key, size_t keyLen, const char *val,
+                  size_t valLen, char **err) {
+    KVIDX_PROBE2(rocksdb__write__start, keyLen + valLen, SYNCED(s, options));
+    rocksdb_put(s->db, options, key, keyLen, val, valLen, err);
+    KVIDX_PROBE1(rocksdb__write__done, !*err);
+    countWrite(s, options, keyLen + valLen, *err);
+}
+
+static void dbDelete(rocksdbState *s, const rocksdb_writeoptions_t *options,
+                     const char *key, size_t keyLen, char **err) {
+    KVIDX_PROBE2(rocksdb__write__start, keyLen, SYNCED(s, options));
+    rocksdb_delete(s->db, options, key, keyLen, err);
+    KVIDX_PROBE1(rocksdb__write__done, !*err);
+    countWrite(s, options, keyLen, *err);
+}
+
+static void dbWrite(rocksdbState *s, const rocksdb_writeoptions_t *options,
+                    rocksdb_writebatch_t *batch, char **err) {
+    size_t bytes = 0;
+    rocksdb_writebatch_data(batch, &bytes);
+    KVIDX_PROBE2(rocksdb__write__start, bytes, SYNCED(s, options));
+    rocksdb_write(s->db, options, batch, err);
+    KVIDX_PROBE1(rocksdb__write__done, !*err);
+    countWrite(s, options, rocksdb_writebatch_count(batch) ? bytes : 0, *err);
+}
+
+static void dbWriteIndexed(rocksdbState *s,
+                           const rocksdb_writeoptions_t *options,
+                           rocksdb_writebatch_wi_t *batch, char **err) {
+    size_t bytes = 0;
+    rocksdb_writebatch_wi_data(batch, &bytes);
+    KVIDX_PROBE2(rocksdb__write__start, bytes, SYNCED(s, options));
+    rocksdb_write_writebatch_wi(s->db, options, batch, err);
+    KVIDX_PROBE1(rocksdb__write__done, !*err);
+    countWrite(s, options, rocksdb_writebatch_wi_count(batch) ? bytes : 0,
+               *err);
+}
+
+static FILE *openFormatFile(const rocksdbState *s, const char *mode) {
+    char *path = malloc(strlen(s->dbPath) + sizeof(FORMAT_FILE));
+    if (!path) {
+        return NULL;
+    }
+    strcpy(path, s->dbPath);
+    strcat(path, FORMAT_FILE);
+    FILE *f = fopen(path, mode);
+    free(path);
+    return f;
+}
+
 /* Big-endian encoding for keys (for proper lexicographic ordering) */
 static inline void encodeKey(uint64_t key, char *buf) {
     buf[0] = (char)(key >> 56);
@@ -82,34 +198,83 @@ static inline uint64_t extractCmd(const char *val, size_t valLen) {
     return cmd;
 }
 
+/* Header size of values in this database */
+static inline size_t valueHeaderSize(const rocksdbState *s) {
+    return s->checksummed ? VALUE_HEADER_SIZE_CRC : VALUE_HEADER_SIZE;
+}
+
 /* Helper to extract data pointer from value */
-static inline const uint8_t *extractData(const char *val, size_t valLen,
+static inline const uint8_t *extractData(const rocksdbState *s,
+                                         const char *val, size_t valLen,
                                          size_t *len) {
-    if (valLen <= VALUE_HEADER_SIZE) {
+    const size_t hdr = valueHeaderSize(s);
+    if (valLen <= hdr) {
         if (len) {
             *len = 0;
         }
         return NULL;
     }
     if (len) {
-        *len = valLen - VALUE_HEADER_SIZE;
+        *len = valLen - hdr;
+    }
+    return (const uint8_t *)(val + hdr);
+}
+
+/* Check a value against its stored checksum (true if it has none) */
+static bool checksumMatches(const rocksdbState *s, const char *val,
+                            size_t valLen) {
+    if (!s->checksummed) {
+        return true;
+    }
+    if (valLen < VALUE_HEADER_SIZE_CRC) {
+        return false;
+    }
+
+    uint32_t stored;
+    memcpy(&stored, val + VALUE_HEADER_SIZE, sizeof(stored));
+    size_t len;
+    const uint8_t *data = extractData(s, val, valLen, &len);
+    return stored == kvidxValueChecksum(extractTerm(val, valLen),
+                                        extractCmd(val, valLen), data, len);
+}
+
+/* Fail a read whose value doesn't match its checksum (verifyChecksums) */
+static bool verifyValue(kvidxInstance *i, uint64_t key, const char *val,
+                        size_t valLen) {
+    const rocksdbState *s = STATE(i);
+    if (!s->verifyChecksums || checksumMatches(s, val, valLen)) {
+        return true;
+    }
+
+    kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                  "Value of key %" PRIu64 " fails its checksum", key);
+    return false;
+}
+
+/* Helper to write the valueHeaderSize(s) bytes preceding data */
+static void packHeader(const rocksdbState *s, uint8_t *buf, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen) {
+    memcpy(buf, &term, sizeof(term));
+    memcpy(buf + sizeof(uint64_t), &cmd, sizeof(cmd));
+    if (s->checksummed) {
+        const uint32_t crc = kvidxValueChecksum(term, cmd, data, dataLen);
+        memcpy(buf + VALUE_HEADER_SIZE, &crc, sizeof(crc));
     }
-    return (const uint8_t *)(val + VALUE_HEADER_SIZE);
 }
 
 /* Helper to pack term, cmd, data into a value buffer */
-static void *packValue(uint64_t term, uint64_t cmd, const void *data,
-                       size_t dataLen, size_t *totalLen) {
-    *totalLen = VALUE_HEADER_SIZE + dataLen;
+static void *packValue(const rocksdbState *s, uint64_t term, uint64_t cmd,
+                       const void *data, size_t dataLen, size_t *totalLen) {
+    const size_t hdr = valueHeaderSize(s);
+    *totalLen = hdr + dataLen;
     void *buf = malloc(*totalLen);
     if (!buf) {
         return NULL;
     }
 
-    memcpy(buf, &term, sizeof(term));
-    memcpy((uint8_t *)buf + sizeof(uint64_t), &cmd, sizeof(cmd));
+    packHeader(s, buf, term, cmd, data, dataLen);
     if (dataLen > 0 && data) {
-        memcpy((uint8_t *)buf + VALUE_HEADER_SIZE, data, dataLen);
+        memcpy((uint8_t *)buf + hdr, data, dataLen);
     }
     return buf;
 }
@@ -178,8 +343,7 @@ bool kvidxRocksdbCommit(kvidxInstance *i) {
     }
 
     char *err = NULL;
-    rocksdb_write_writebatch_wi(s->db, s->syncWriteOptions, s->writeBatch,
-                                &err);
+    dbWriteIndexed(s, s->syncWriteOptions, s->writeBatch, &err);
     rocksdb_writebatch_wi_destroy(s->writeBatch);
     s->writeBatch = NULL;
 
@@ -233,6 +397,10 @@ bool kvidxRocksdbGet(kvidxInstance *i, uint64_t key, uint64_t *term,
     s->cachedValue = value;
     s->cachedValueLen = valueLen;
 
+    if (!verifyValue(i, key, value, valueLen)) {
+        return false;
+    }
+
     if (term) {
         *term = extractTerm(value, valueLen);
     }
@@ -240,10 +408,10 @@ bool kvidxRocksdbGet(kvidxInstance *i, uint64_t key, uint64_t *term,
         *cmd = extractCmd(value, valueLen);
     }
     if (data) {
-        *data = extractData(value, valueLen, len);
+        *data = extractData(s, value, valueLen, len);
     } else if (len) {
         size_t dlen;
-        extractData(value, valueLen, &dlen);
+        extractData(s, value, valueLen, &dlen);
         *len = dlen;
     }
 
@@ -302,7 +470,8 @@ bool kvidxRocksdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
             free(s->cachedValue);
         }
         s->cachedValue = malloc(valueLen);
-        if (s->cachedValue) {
+        if (s->cachedValue &&
+            verifyValue(i, foundKey, value, valueLen)) {
             memcpy(s->cachedValue, value, valueLen);
             s->cachedValueLen = valueLen;
 
@@ -316,10 +485,10 @@ bool kvidxRocksdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
                 *cmd = extractCmd(s->cachedValue, valueLen);
             }
             if (data) {
-                *data = extractData(s->cachedValue, valueLen, len);
+                *data = extractData(s, s->cachedValue, valueLen, len);
             } else if (len) {
                 size_t dlen;
-                extractData(s->cachedValue, valueLen, &dlen);
+                extractData(s, s->cachedValue, valueLen, &dlen);
                 *len = dlen;
             }
         } else {
@@ -367,7 +536,8 @@ bool kvidxRocksdbGetNext(kvidxInstance *i, uint64_t previousKey,
             free(s->cachedValue);
         }
         s->cachedValue = malloc(valueLen);
-        if (s->cachedValue) {
+        if (s->cachedValue &&
+            verifyValue(i, foundKey, value, valueLen)) {
             memcpy(s->cachedValue, value, valueLen);
             s->cachedValueLen = valueLen;
 
@@ -381,10 +551,10 @@ bool kvidxRocksdbGetNext(kvidxInstance *i, uint64_t previousKey,
                 *cmd = extractCmd(s->cachedValue, valueLen);
             }
             if (data) {
-                *data = extractData(s->cachedValue, valueLen, len);
+                *data = extractData(s, s->cachedValue, valueLen, len);
             } else if (len) {
                 size_t dlen;
-                extractData(s->cachedValue, valueLen, &dlen);
+                extractData(s, s->cachedValue, valueLen, &dlen);
                 *len = dlen;
             }
             found = true;
@@ -395,6 +565,108 @@ bool kvidxRocksdbGetNext(kvidxInstance *i, uint64_t previousKey,
     return found;
 }
 
+/* Visit [startKey, endKey] with one iterator; values are only borrowed
+ * for the duration of each visit call. */
+kvidxError kvidxRocksdbScanRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, kvidxScanVisitor visit,
+                                 void *ctx) {
+    rocksdbState *s = STATE(i);
+
+    rocksdb_iterator_t *iter = createTxnAwareIterator(s);
+    if (!iter) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    char keyBuf[8];
+    encodeKey(startKey, keyBuf);
+
+    kvidxError result = KVIDX_OK;
+    for (rocksdb_iter_seek(iter, keyBuf, sizeof(keyBuf));
+         rocksdb_iter_valid(iter); rocksdb_iter_next(iter)) {
+        size_t keyLen;
+        const char *keyData = rocksdb_iter_key(iter, &keyLen);
+        if (keyLen != sizeof(keyBuf)) {
+            continue; /* TTL record */
+        }
+        const uint64_t key = decodeKey(keyData);
+        if (key > endKey) {
+            break;
+        }
+
+        size_t valueLen;
+        const char *value = rocksdb_iter_value(iter, &valueLen);
+        if (!verifyValue(i, key, value, valueLen)) {
+            result = KVIDX_ERROR_CORRUPT;
+            break;
+        }
+
+        size_t len = 0;
+        const uint8_t *data = extractData(s, value, valueLen, &len);
+        if (!visit(ctx, key, extractTerm(value, valueLen),
+                   extractCmd(value, valueLen), data, len)) {
+            break;
+        }
+    }
+
+    char *err = NULL;
+    rocksdb_iter_get_error(iter, &err);
+    rocksdb_iter_destroy(iter);
+    if (err) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Scan failed: %s", err);
+        free(err);
+        return KVIDX_ERROR_IO;
+    }
+    return result;
+}
+
+/* Check the stored checksum of every value in [startKey, endKey]; values
+ * in databases created without checksums are all unchecked. */
+kvidxError kvidxRocksdbVerifyRange(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, kvidxVerifyResult *result) {
+    rocksdbState *s = STATE(i);
+
+    rocksdb_iterator_t *iter = createTxnAwareIterator(s);
+    if (!iter) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    char keyBuf[8];
+    encodeKey(startKey, keyBuf);
+
+    for (rocksdb_iter_seek(iter, keyBuf, sizeof(keyBuf));
+         rocksdb_iter_valid(iter); rocksdb_iter_next(iter)) {
+        size_t keyLen;
+        const char *keyData = rocksdb_iter_key(iter, &keyLen);
+        if (keyLen != sizeof(keyBuf)) {
+            continue;
+        }
+        const uint64_t key = decodeKey(keyData);
+        if (key > endKey) {
+            break;
+        }
+
+        size_t valueLen;
+        const char *value = rocksdb_iter_value(iter, &valueLen);
+        if (!s->checksummed) {
+            result->entriesUnchecked++;
+        } else if (checksumMatches(s, value, valueLen)) {
+            result->entriesChecked++;
+        } else if (result->corruptEntries++ == 0) {
+            result->firstCorruptKey = key;
+        }
+    }
+
+    char *err = NULL;
+    rocksdb_iter_get_error(iter, &err);
+    rocksdb_iter_destroy(iter);
+    if (err) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Verify failed: %s", err);
+        free(err);
+        return KVIDX_ERROR_IO;
+    }
+    return KVIDX_OK;
+}
+
 bool kvidxRocksdbExists(kvidxInstance *i, uint64_t key) {
     rocksdbState *s = STATE(i);
 
@@ -516,7 +788,7 @@ bool kvidxRocksdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Pack the value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, data, dataLen, &valLen);
     if (!valBuf) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Memory allocation failed");
         return false;
@@ -531,8 +803,8 @@ bool kvidxRocksdbInsert(kvidxInstance *i, uint64_t key, uint64_t term,
     }
 
     /* Otherwise, write directly */
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -557,7 +829,7 @@ bool kvidxRocksdbRemove(kvidxInstance *i, uint64_t key) {
     }
 
     char *err = NULL;
-    rocksdb_delete(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), &err);
+    dbDelete(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), &err);
 
     if (err) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL, "RocksDB delete failed: %s",
@@ -569,25 +841,221 @@ bool kvidxRocksdbRemove(kvidxInstance *i, uint64_t key) {
     return true;
 }
 
-bool kvidxRocksdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+/* ====================================================================
+ * Range Deletes
+ * ==================================================================== */
+
+/*
+ * Outside a transaction, removing a range writes one DeleteRange tombstone
+ * instead of a delete per key, so the batch stays small however many keys
+ * the range holds. Transactions keep deleting key by key: their batch is a
+ * WriteBatchWithIndex, whose reads would not see a range tombstone.
+ *
+ * TTL entries (0x00 "TTL" + key, see Storage Primitives) sort among the
+ * regular keys whose first four bytes are the same, TTL_SHADOW_FIRST to
+ * TTL_SHADOW_LAST. A tombstone covering any of those keys would delete TTL
+ * entries as well, so that part of a range is deleted key by key.
+ */
+#define TTL_SHADOW_FIRST UINT64_C(0x0054544C00000000)
+#define TTL_SHADOW_LAST UINT64_C(0x0054544CFFFFFFFF)
+
+typedef struct keySpan {
+    uint64_t first;
+    uint64_t last;
+} keySpan;
+
+/* Exclusive end of a tombstone ending at last: last + 1, or a 9-byte key
+ * after every 8-byte key */
+static size_t encodeEndKey(uint64_t last, char *buf) {
+    if (last == UINT64_MAX) {
+        memset(buf, 0xFF, 8);
+        buf[8] = 0;
+        return 9;
+    }
+    encodeKey(last + 1, buf);
+    return 8;
+}
+
+/* Narrow span (outside the TTL shadow) to the first and last keys stored
+ * in it. Returns false if it holds none. */
+static bool storedSpan(rocksdb_iterator_t *iter, keySpan *span) {
+    char keyBuf[8];
+    size_t keyLen;
+    encodeKey(span->first, keyBuf);
+    rocksdb_iter_seek(iter, keyBuf, sizeof(keyBuf));
+    if (!rocksdb_iter_valid(iter)) {
+        return false;
+    }
+    const uint64_t first = decodeKey(rocksdb_iter_key(iter, &keyLen));
+    if (first > span->last) {
+        return false;
+    }
+
+    if (span->last == UINT64_MAX) {
+        rocksdb_iter_seek_to_last(iter);
+    } else {
+        encodeKey(span->last, keyBuf);
+        rocksdb_iter_seek_for_prev(iter, keyBuf, sizeof(keyBuf));
+    }
+    span->first = first;
+    span->last = decodeKey(rocksdb_iter_key(iter, &keyLen));
+    return true;
+}
+
+/* Number of keys stored in span (outside the TTL shadow) */
+static uint64_t countSpan(rocksdb_iterator_t *iter, const keySpan *span) {
+    char keyBuf[8];
+    encodeKey(span->first, keyBuf);
+    uint64_t count = 0;
+    for (rocksdb_iter_seek(iter, keyBuf, sizeof(keyBuf));
+         rocksdb_iter_valid(iter); rocksdb_iter_next(iter)) {
+        size_t keyLen;
+        if (decodeKey(rocksdb_iter_key(iter, &keyLen)) > span->last) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+/* Delete the regular keys in [first, last] inside the TTL shadow one by
+ * one, returning how many there were */
+static uint64_t deleteShadowKeys(rocksdb_iterator_t *iter,
+                                 rocksdb_writebatch_t *batch, uint64_t first,
+                                 uint64_t last) {
+    char keyBuf[8];
+    encodeKey(first, keyBuf);
+    uint64_t count = 0;
+    for (rocksdb_iter_seek(iter, keyBuf, sizeof(keyBuf));
+         rocksdb_iter_valid(iter); rocksdb_iter_next(iter)) {
+        size_t keyLen;
+        const char *keyData = rocksdb_iter_key(iter, &keyLen);
+        if (decodeKey(keyData) > last) {
+            break;
+        }
+        if (keyLen == sizeof(keyBuf)) {
+            rocksdb_writebatch_delete(batch, keyData, keyLen);
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Remember that [first, last] had keys removed without being compacted */
+static void noteTruncated(rocksdbState *s, uint64_t first, uint64_t last) {
+    if (!s->truncated) {
+        s->truncated = true;
+        s->truncatedFirst = first;
+        s->truncatedLast = last;
+        return;
+    }
+    if (first < s->truncatedFirst) {
+        s->truncatedFirst = first;
+    }
+    if (last > s->truncatedLast) {
+        s->truncatedLast = last;
+    }
+}
+
+/**
+ * Delete every key in [first, last] in one write, outside a transaction.
+ * Counts the deleted keys only if deletedCount is set; the tombstones
+ * themselves don't need the count. Spans of at least
+ * compactAfterDeleteKeys keys are compacted once written, so later seeks
+ * don't step over the deleted entries; smaller ones are left for
+ * kvidxRocksdbReclaimSpace().
+ */
+static kvidxError deleteKeyRange(kvidxInstance *i, uint64_t first,
+                                 uint64_t last, uint64_t *deletedCount) {
     rocksdbState *s = STATE(i);
-    bool ownBatch = false;
+    uint64_t deleted = 0;
 
-    if (!s->writeBatch) {
-        s->writeBatch = rocksdb_writebatch_wi_create(0, 0);
-        if (!s->writeBatch) {
-            return false;
+    rocksdb_iterator_t *iter = rocksdb_create_iterator(s->db, s->readOptions);
+    rocksdb_writebatch_t *batch = rocksdb_writebatch_create();
+    if (!iter || !batch) {
+        if (iter) {
+            rocksdb_iter_destroy(iter);
         }
-        ownBatch = true;
+        if (batch) {
+            rocksdb_writebatch_destroy(batch);
+        }
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Memory allocation failed");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    /* Tombstones below and above the TTL shadow */
+    keySpan spans[2];
+    size_t spanCount = 0;
+    if (first < TTL_SHADOW_FIRST) {
+        spans[spanCount] = (keySpan){
+            first, last < TTL_SHADOW_FIRST ? last : TTL_SHADOW_FIRST - 1};
+        spanCount += storedSpan(iter, &spans[spanCount]);
+    }
+    if (last > TTL_SHADOW_LAST) {
+        spans[spanCount] = (keySpan){
+            first > TTL_SHADOW_LAST ? first : TTL_SHADOW_LAST + 1, last};
+        spanCount += storedSpan(iter, &spans[spanCount]);
+    }
+
+    for (size_t n = 0; n < spanCount; n++) {
+        char startBuf[8];
+        char endBuf[9];
+        encodeKey(spans[n].first, startBuf);
+        const size_t endLen = encodeEndKey(spans[n].last, endBuf);
+        rocksdb_writebatch_delete_range(batch, startBuf, sizeof(startBuf),
+                                        endBuf, endLen);
+        if (deletedCount) {
+            deleted += countSpan(iter, &spans[n]);
+        }
+    }
+
+    if (first <= TTL_SHADOW_LAST && last >= TTL_SHADOW_FIRST) {
+        deleted += deleteShadowKeys(
+            iter, batch, first > TTL_SHADOW_FIRST ? first : TTL_SHADOW_FIRST,
+            last < TTL_SHADOW_LAST ? last : TTL_SHADOW_LAST);
+    }
+    rocksdb_iter_destroy(iter);
+
+    char *err = NULL;
+    if (rocksdb_writebatch_count(batch) > 0) {
+        dbWrite(s, s->syncWriteOptions, batch, &err);
+    }
+    rocksdb_writebatch_destroy(batch);
+    if (err) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "RocksDB write failed: %s",
+                      err);
+        free(err);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    for (size_t n = 0; n < spanCount; n++) {
+        if (spans[n].last - spans[n].first >= s->compactAfterDeleteKeys - 1) {
+            char startBuf[8];
+            char endBuf[9];
+            encodeKey(spans[n].first, startBuf);
+            const size_t endLen = encodeEndKey(spans[n].last, endBuf);
+            rocksdb_compact_range(s->db, startBuf, sizeof(startBuf), endBuf,
+                                  endLen);
+        } else {
+            noteTruncated(s, spans[n].first, spans[n].last);
+        }
+    }
+
+    if (deletedCount) {
+        *deletedCount = deleted;
+    }
+    return KVIDX_OK;
+}
+
+bool kvidxRocksdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+    rocksdbState *s = STATE(i);
+    if (!s->writeBatch) {
+        return deleteKeyRange(i, key, UINT64_MAX, NULL) == KVIDX_OK;
     }
 
     /* Use transaction-aware iterator to see pending writes */
     rocksdb_iterator_t *iter = createTxnAwareIterator(s);
     if (!iter) {
-        if (ownBatch) {
-            rocksdb_writebatch_wi_destroy(s->writeBatch);
-            s->writeBatch = NULL;
-        }
         return false;
     }
 
@@ -612,44 +1080,19 @@ bool kvidxRocksdbRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
     }
 
     rocksdb_iter_destroy(iter);
-
-    if (ownBatch) {
-        char *err = NULL;
-        rocksdb_write_writebatch_wi(s->db, s->syncWriteOptions, s->writeBatch,
-                                    &err);
-        rocksdb_writebatch_wi_destroy(s->writeBatch);
-        s->writeBatch = NULL;
-
-        if (err) {
-            kvidxSetError(i, KVIDX_ERROR_INTERNAL, "RocksDB write failed: %s",
-                          err);
-            free(err);
-            return false;
-        }
-    }
-
+    noteTruncated(s, key, UINT64_MAX);
     return true;
 }
 
 bool kvidxRocksdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
     rocksdbState *s = STATE(i);
-    bool ownBatch = false;
-
     if (!s->writeBatch) {
-        s->writeBatch = rocksdb_writebatch_wi_create(0, 0);
-        if (!s->writeBatch) {
-            return false;
-        }
-        ownBatch = true;
+        return deleteKeyRange(i, 0, key, NULL) == KVIDX_OK;
     }
 
     /* Use transaction-aware iterator to see pending writes */
     rocksdb_iterator_t *iter = createTxnAwareIterator(s);
     if (!iter) {
-        if (ownBatch) {
-            rocksdb_writebatch_wi_destroy(s->writeBatch);
-            s->writeBatch = NULL;
-        }
         return false;
     }
 
@@ -678,22 +1121,7 @@ bool kvidxRocksdbRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
     }
 
     rocksdb_iter_destroy(iter);
-
-    if (ownBatch) {
-        char *err = NULL;
-        rocksdb_write_writebatch_wi(s->db, s->syncWriteOptions, s->writeBatch,
-                                    &err);
-        rocksdb_writebatch_wi_destroy(s->writeBatch);
-        s->writeBatch = NULL;
-
-        if (err) {
-            kvidxSetError(i, KVIDX_ERROR_INTERNAL, "RocksDB write failed: %s",
-                          err);
-            free(err);
-            return false;
-        }
-    }
-
+    noteTruncated(s, 0, key);
     return true;
 }
 
@@ -705,20 +1133,171 @@ bool kvidxRocksdbFsync(kvidxInstance *i) {
     if (!flushOptions) {
         return false;
     }
-    rocksdb_flushoptions_set_wait(flushOptions, 1);
+    rocksdb_flushoptions_set_wait(flushOptions, 1);
+
+    char *err = NULL;
+    KVIDX_PROBE(fsync__start);
+    rocksdb_flush(s->db, flushOptions, &err);
+    KVIDX_PROBE1(fsync__done, !err);
+    rocksdb_flushoptions_destroy(flushOptions);
+
+    if (err) {
+        free(err);
+        return false;
+    }
+
+    s->syncs++;
+    return true;
+}
+
+/* ====================================================================
+ * Tuning Options
+ * ==================================================================== */
+
+/* Upper bound on levels accepted in kvidxConfig.rocksdbCompressionPerLevel */
+#define MAX_COMPRESSION_LEVELS 16
+
+kvidxBlockCache *kvidxRocksdbBlockCacheCreate(size_t capacityBytes) {
+    return (kvidxBlockCache *)rocksdb_cache_create_lru(capacityBytes);
+}
+
+void kvidxRocksdbBlockCacheRelease(kvidxBlockCache *cache) {
+    if (cache) {
+        rocksdb_cache_destroy((rocksdb_cache_t *)cache);
+    }
+}
+
+static int compressionType(kvidxCompression compression) {
+    switch (compression) {
+    case KVIDX_COMPRESSION_NONE:
+        return rocksdb_no_compression;
+    case KVIDX_COMPRESSION_ZLIB:
+        return rocksdb_zlib_compression;
+    case KVIDX_COMPRESSION_LZ4:
+        return rocksdb_lz4_compression;
+    case KVIDX_COMPRESSION_LZ4HC:
+        return rocksdb_lz4hc_compression;
+    case KVIDX_COMPRESSION_ZSTD:
+        return rocksdb_zstd_compression;
+    case KVIDX_COMPRESSION_SNAPPY:
+    case KVIDX_COMPRESSION_DEFAULT:
+    default:
+        return rocksdb_snappy_compression;
+    }
+}
+
+/* Apply open-time tuning from kvidxConfig to s->options.
+ * Returns false with *errStr set if the combination is invalid. */
+static bool applyOpenOptions(rocksdbState *s, const kvidxConfig *config,
+                             const char **errStr) {
+    if (config->rocksdbPipelinedWrite && config->rocksdbUnorderedWrite) {
+        if (errStr) {
+            *errStr = "rocksdbPipelinedWrite and rocksdbUnorderedWrite are "
+                      "mutually exclusive";
+        }
+        return false;
+    }
+
+    if (config->rocksdbCompressionLevelCount > MAX_COMPRESSION_LEVELS ||
+        (config->rocksdbCompressionLevelCount &&
+         !config->rocksdbCompressionPerLevel)) {
+        if (errStr) {
+            *errStr = "Invalid rocksdbCompressionPerLevel";
+        }
+        return false;
+    }
+
+    /* Block-based table: block cache + full-key bloom filter */
+    rocksdb_block_based_table_options_t *table =
+        rocksdb_block_based_options_create();
+    if (!table) {
+        if (errStr) {
+            *errStr = "Failed to create RocksDB table options";
+        }
+        return false;
+    }
+
+    if (config->rocksdbSharedBlockCache) {
+        rocksdb_block_based_options_set_block_cache(
+            table, (rocksdb_cache_t *)config->rocksdbSharedBlockCache);
+    } else if (config->rocksdbBlockCacheBytes) {
+        s->blockCache =
+            rocksdb_cache_create_lru(config->rocksdbBlockCacheBytes);
+        rocksdb_block_based_options_set_block_cache(table, s->blockCache);
+    }
+
+    if (config->rocksdbBloomBitsPerKey > 0) {
+        /* Ownership of the policy passes to the table options */
+        rocksdb_block_based_options_set_filter_policy(
+            table, rocksdb_filterpolicy_create_bloom_full(
+                       (double)config->rocksdbBloomBitsPerKey));
+        rocksdb_block_based_options_set_whole_key_filtering(table, 1);
+    }
+
+    /* The factory copies the table options */
+    rocksdb_options_set_block_based_table_factory(s->options, table);
+    rocksdb_block_based_options_destroy(table);
+
+    /* Compression */
+    if (config->rocksdbCompression != KVIDX_COMPRESSION_DEFAULT) {
+        rocksdb_options_set_compression(
+            s->options, compressionType(config->rocksdbCompression));
+    }
+
+    if (config->rocksdbCompressionLevelCount) {
+        int levels[MAX_COMPRESSION_LEVELS];
+        for (size_t l = 0; l < config->rocksdbCompressionLevelCount; l++) {
+            levels[l] = compressionType(config->rocksdbCompressionPerLevel[l]);
+        }
+        rocksdb_options_set_compression_per_level(
+            s->options, levels, config->rocksdbCompressionLevelCount);
+    }
+
+    /* Memtables and background work */
+    if (config->rocksdbWriteBufferBytes) {
+        rocksdb_options_set_write_buffer_size(s->options,
+                                              config->rocksdbWriteBufferBytes);
+    }
 
-    char *err = NULL;
-    rocksdb_flush(s->db, flushOptions, &err);
-    rocksdb_flushoptions_destroy(flushOptions);
+    if (config->rocksdbMaxWriteBufferNumber > 0) {
+        rocksdb_options_set_max_write_buffer_number(
+            s->options, config->rocksdbMaxWriteBufferNumber);
+    }
 
-    if (err) {
-        free(err);
-        return false;
+    if (config->rocksdbMaxBackgroundJobs > 0) {
+        rocksdb_options_set_max_background_jobs(
+            s->options, config->rocksdbMaxBackgroundJobs);
     }
 
+    /* Write path */
+    rocksdb_options_set_enable_pipelined_write(s->options,
+                                               config->rocksdbPipelinedWrite);
+    rocksdb_options_set_unordered_write(s->options,
+                                        config->rocksdbUnorderedWrite);
+
     return true;
 }
 
+/* Apply runtime write options (sync mode, WAL, range delete compaction)
+ * from kvidxConfig. RocksDB rejects sync writes without a WAL, so disabling
+ * the WAL also turns off per-write sync; kvidxFsync() flushes memtables
+ * instead. */
+static void applyWriteOptions(rocksdbState *s, const kvidxConfig *config) {
+    bool sync =
+        config->syncMode != KVIDX_SYNC_OFF && !config->rocksdbDisableWAL;
+
+    rocksdb_writeoptions_set_sync(s->syncWriteOptions, sync);
+    s->syncWrites = sync;
+    rocksdb_writeoptions_disable_WAL(s->writeOptions,
+                                     config->rocksdbDisableWAL);
+    rocksdb_writeoptions_disable_WAL(s->syncWriteOptions,
+                                     config->rocksdbDisableWAL);
+
+    s->compactAfterDeleteKeys = config->rocksdbCompactAfterDeleteKeys
+                                    ? config->rocksdbCompactAfterDeleteKeys
+                                    : COMPACT_AFTER_DELETE_KEYS_DEFAULT;
+}
+
 /* ====================================================================
  * Bring-Up / Teardown
  * ==================================================================== */
@@ -774,6 +1353,15 @@ bool kvidxRocksdbOpen(kvidxInstance *i, const char *filename,
         goto error;
     }
     rocksdb_writeoptions_set_sync(s->syncWriteOptions, 1);
+    s->compactAfterDeleteKeys = COMPACT_AFTER_DELETE_KEYS_DEFAULT;
+
+    /* Tuning from kvidxOpenWithConfig() */
+    if (i->configInitialized) {
+        if (!applyOpenOptions(s, &i->config, errStr)) {
+            goto error;
+        }
+        applyWriteOptions(s, &i->config);
+    }
 
     /* Open database */
     char *err = NULL;
@@ -786,6 +1374,13 @@ bool kvidxRocksdbOpen(kvidxInstance *i, const char *filename,
         goto error;
     }
 
+    /* Values carry checksums if the database was created with them */
+    FILE *format = openFormatFile(s, "r");
+    if (format) {
+        s->checksummed = fgetc(format) == VALUE_FORMAT_CHECKSUMMED;
+        fclose(format);
+    }
+
     /* Call custom init if provided */
     if (i->customInit) {
         i->customInit(i);
@@ -806,6 +1401,9 @@ error:
     if (s->options) {
         rocksdb_options_destroy(s->options);
     }
+    if (s->blockCache) {
+        rocksdb_cache_destroy(s->blockCache);
+    }
     free(s->dbPath);
     free(i->kvidxdata);
     i->kvidxdata = NULL;
@@ -815,6 +1413,16 @@ error:
 bool kvidxRocksdbClose(kvidxInstance *i) {
     rocksdbState *s = STATE(i);
 
+    /* Readers only own their snapshot, read options and value cache */
+    if (s->sharedDb) {
+        free(s->cachedValue);
+        rocksdb_readoptions_destroy(s->readOptions);
+        rocksdb_release_snapshot(s->db, s->snapshot);
+        free(i->kvidxdata);
+        i->kvidxdata = NULL;
+        return true;
+    }
+
     if (s->writeBatch) {
         rocksdb_writebatch_wi_destroy(s->writeBatch);
         s->writeBatch = NULL;
@@ -842,6 +1450,9 @@ bool kvidxRocksdbClose(kvidxInstance *i) {
     if (s->options) {
         rocksdb_options_destroy(s->options);
     }
+    if (s->blockCache) {
+        rocksdb_cache_destroy(s->blockCache);
+    }
 
     free(s->dbPath);
     free(i->kvidxdata);
@@ -850,6 +1461,49 @@ bool kvidxRocksdbClose(kvidxInstance *i) {
     return true;
 }
 
+/**
+ * Open a reader on i's database for another thread.
+ *
+ * RocksDB handles are thread-safe, so the reader shares the db and reads
+ * from its own snapshot. Bulk scans through a reader skip the block cache.
+ *
+ * @param i       The kvidx instance to read from
+ * @param reader  OUT: Instance initialized for reading; release it with
+ *                kvidxRocksdbClose() before closing i
+ * @return true on success
+ */
+bool kvidxRocksdbOpenReader(kvidxInstance *i, kvidxInstance *reader) {
+    const rocksdbState *s = STATE(i);
+
+    /* A snapshot wouldn't see i's pending write batch */
+    if (s->writeBatch) {
+        return false;
+    }
+
+    rocksdbState *rs = calloc(1, sizeof(*rs));
+    if (!rs) {
+        return false;
+    }
+
+    rs->readOptions = rocksdb_readoptions_create();
+    if (!rs->readOptions) {
+        free(rs);
+        return false;
+    }
+
+    rs->db = s->db;
+    rs->sharedDb = true;
+    rs->checksummed = s->checksummed;
+    rs->verifyChecksums = s->verifyChecksums;
+    rs->snapshot = rocksdb_create_snapshot(s->db);
+    rocksdb_readoptions_set_snapshot(rs->readOptions, rs->snapshot);
+    rocksdb_readoptions_set_fill_cache(rs->readOptions, 0);
+
+    reader->kvidxdata = rs;
+    reader->interface = i->interface;
+    return true;
+}
+
 /* ====================================================================
  * Statistics Implementation
  * ==================================================================== */
@@ -925,8 +1579,8 @@ kvidxError kvidxRocksdbGetDataSize(kvidxInstance *i, uint64_t *bytes) {
     while (rocksdb_iter_valid(iter)) {
         size_t valueLen;
         rocksdb_iter_value(iter, &valueLen);
-        if (valueLen > VALUE_HEADER_SIZE) {
-            totalSize += valueLen - VALUE_HEADER_SIZE;
+        if (valueLen > valueHeaderSize(s)) {
+            totalSize += valueLen - valueHeaderSize(s);
         }
         rocksdb_iter_next(iter);
     }
@@ -965,8 +1619,8 @@ kvidxError kvidxRocksdbGetStats(kvidxInstance *i, kvidxStats *stats) {
 
         size_t valueLen;
         rocksdb_iter_value(iter, &valueLen);
-        if (valueLen > VALUE_HEADER_SIZE) {
-            totalData += valueLen - VALUE_HEADER_SIZE;
+        if (valueLen > valueHeaderSize(s)) {
+            totalData += valueLen - valueHeaderSize(s);
         }
 
         count++;
@@ -997,6 +1651,38 @@ kvidxError kvidxRocksdbGetStats(kvidxInstance *i, kvidxStats *stats) {
     return KVIDX_OK;
 }
 
+/* Perf context of the calling thread, counting since its first use */
+static __thread rocksdb_perfcontext_t *threadPerfContext;
+
+/**
+ * Add this database's work counters (interface.ioCounters).
+ *
+ * Bytes read are the SST blocks RocksDB read from disk on this thread,
+ * from its per-thread perf context (enabled at count level on first use;
+ * it also counts reads of other databases on the thread, which only
+ * matters if another runs inside a kvidx operation). Writes, bytes
+ * written and syncs come from the counted write helpers and Fsync().
+ * Background flushes and compactions are not attributed to operations,
+ * so pagesAllocated stays 0.
+ *
+ * @param i         The kvidx instance
+ * @param counters  OUT: Running totals are added here
+ */
+void kvidxRocksdbIoCounters(kvidxInstance *i, kvidxIoCounters *counters) {
+    const rocksdbState *s = STATE(i);
+    if (!threadPerfContext) {
+        rocksdb_set_perf_level(rocksdb_enable_count);
+        threadPerfContext = rocksdb_perfcontext_create();
+    }
+    if (threadPerfContext) {
+        counters->bytesRead += rocksdb_perfcontext_metric(
+            threadPerfContext, rocksdb_block_read_byte);
+    }
+    counters->bytesWritten += s->bytesWritten;
+    counters->fsyncs += s->syncs;
+    counters->transactions += s->writes;
+}
+
 /* ====================================================================
  * Range Operations Implementation
  * ==================================================================== */
@@ -1009,21 +1695,28 @@ kvidxError kvidxRocksdbRemoveRange(kvidxInstance *i, uint64_t startKey,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
-    bool ownBatch = false;
     if (!s->writeBatch) {
-        s->writeBatch = rocksdb_writebatch_wi_create(0, 0);
-        if (!s->writeBatch) {
-            return KVIDX_ERROR_INTERNAL;
+        /* Exclusive bounds at the ends of the key space leave nothing */
+        if ((!startInclusive && startKey == UINT64_MAX) ||
+            (!endInclusive && endKey == 0)) {
+            if (deletedCount) {
+                *deletedCount = 0;
+            }
+            return KVIDX_OK;
         }
-        ownBatch = true;
+        const uint64_t first = startInclusive ? startKey : startKey + 1;
+        const uint64_t last = endInclusive ? endKey : endKey - 1;
+        if (first > last) {
+            if (deletedCount) {
+                *deletedCount = 0;
+            }
+            return KVIDX_OK;
+        }
+        return deleteKeyRange(i, first, last, deletedCount);
     }
 
     rocksdb_iterator_t *iter = createTxnAwareIterator(s);
     if (!iter) {
-        if (ownBatch) {
-            rocksdb_writebatch_wi_destroy(s->writeBatch);
-            s->writeBatch = NULL;
-        }
         return KVIDX_ERROR_INTERNAL;
     }
 
@@ -1056,24 +1749,14 @@ kvidxError kvidxRocksdbRemoveRange(kvidxInstance *i, uint64_t startKey,
     }
 
     rocksdb_iter_destroy(iter);
+    if (deleted) {
+        noteTruncated(s, searchKey, endKey);
+    }
 
     if (deletedCount) {
         *deletedCount = deleted;
     }
 
-    if (ownBatch) {
-        char *err = NULL;
-        rocksdb_write_writebatch_wi(s->db, s->syncWriteOptions, s->writeBatch,
-                                    &err);
-        rocksdb_writebatch_wi_destroy(s->writeBatch);
-        s->writeBatch = NULL;
-
-        if (err) {
-            free(err);
-            return KVIDX_ERROR_INTERNAL;
-        }
-    }
-
     return KVIDX_OK;
 }
 
@@ -1255,65 +1938,6 @@ static kvidxError writeBinaryEntry(FILE *fp, uint64_t key, uint64_t term,
     return KVIDX_OK;
 }
 
-static void writeJsonEscaped(FILE *fp, const char *str, size_t len) {
-    for (size_t j = 0; j < len; j++) {
-        unsigned char c = str[j];
-        switch (c) {
-        case '"':
-            fprintf(fp, "\\\"");
-            break;
-        case '\\':
-            fprintf(fp, "\\\\");
-            break;
-        case '\b':
-            fprintf(fp, "\\b");
-            break;
-        case '\f':
-            fprintf(fp, "\\f");
-            break;
-        case '\n':
-            fprintf(fp, "\\n");
-            break;
-        case '\r':
-            fprintf(fp, "\\r");
-            break;
-        case '\t':
-            fprintf(fp, "\\t");
-            break;
-        default:
-            if (c < 32 || c == 127) {
-                fprintf(fp, "\\u%04x", c);
-            } else {
-                fputc(c, fp);
-            }
-        }
-    }
-}
-
-static void writeCsvField(FILE *fp, const char *str, size_t len) {
-    bool needsQuotes = false;
-    for (size_t j = 0; j < len; j++) {
-        if (str[j] == ',' || str[j] == '"' || str[j] == '\n' ||
-            str[j] == '\r') {
-            needsQuotes = true;
-            break;
-        }
-    }
-
-    if (needsQuotes) {
-        fputc('"', fp);
-        for (size_t j = 0; j < len; j++) {
-            if (str[j] == '"') {
-                fputc('"', fp);
-            }
-            fputc(str[j], fp);
-        }
-        fputc('"', fp);
-    } else {
-        fwrite(str, 1, len, fp);
-    }
-}
-
 kvidxError kvidxRocksdbExport(kvidxInstance *i, const char *filename,
                               const kvidxExportOptions *options,
                               kvidxProgressCallback callback, void *userData) {
@@ -1345,27 +1969,14 @@ kvidxError kvidxRocksdbExport(kvidxInstance *i, const char *filename,
     kvidxError result = KVIDX_OK;
     uint64_t count = 0;
 
-    /* Write format-specific header */
-    if (options->format == KVIDX_EXPORT_BINARY) {
-        kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
-                                    .version = KVIDX_BINARY_VERSION,
-                                    .reserved = 0,
-                                    .entryCount = total};
-        if (fwrite(&header, sizeof(header), 1, fp) != 1) {
-            result = KVIDX_ERROR_IO;
-            goto cleanup;
-        }
-    } else if (options->format == KVIDX_EXPORT_JSON) {
-        fprintf(fp, "{\"format\":\"kvidx-json\",\"version\":1,\"entries\":[");
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-    } else if (options->format == KVIDX_EXPORT_CSV) {
-        if (options->includeMetadata) {
-            fprintf(fp, "key,term,cmd,data\n");
-        } else {
-            fprintf(fp, "key,data\n");
-        }
+    /* Write header */
+    kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
+                                .version = KVIDX_BINARY_VERSION,
+                                .reserved = 0,
+                                .entryCount = total};
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        result = KVIDX_ERROR_IO;
+        goto cleanup;
     }
 
     /* Position at start of range */
@@ -1373,7 +1984,6 @@ kvidxError kvidxRocksdbExport(kvidxInstance *i, const char *filename,
     encodeKey(options->startKey, startKeyBuf);
     rocksdb_iter_seek(iter, startKeyBuf, sizeof(startKeyBuf));
 
-    bool firstEntry = true;
 
     while (rocksdb_iter_valid(iter)) {
         size_t keyLen;
@@ -1390,40 +2000,11 @@ kvidxError kvidxRocksdbExport(kvidxInstance *i, const char *filename,
         uint64_t term = extractTerm(value, valueLen);
         uint64_t cmd = extractCmd(value, valueLen);
         size_t dataLen;
-        const uint8_t *data = extractData(value, valueLen, &dataLen);
+        const uint8_t *data = extractData(s, value, valueLen, &dataLen);
 
-        if (options->format == KVIDX_EXPORT_BINARY) {
-            result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
-            if (result != KVIDX_OK) {
-                goto cleanup;
-            }
-        } else if (options->format == KVIDX_EXPORT_JSON) {
-            if (!firstEntry) {
-                fprintf(fp, ",");
-            }
-            if (options->prettyPrint) {
-                fprintf(fp, "\n  ");
-            }
-            fprintf(fp, "{\"key\":%" PRIu64, key);
-            if (options->includeMetadata) {
-                fprintf(fp, ",\"term\":%" PRIu64 ",\"cmd\":%" PRIu64, term,
-                        cmd);
-            }
-            fprintf(fp, ",\"data\":\"");
-            if (data && dataLen > 0) {
-                writeJsonEscaped(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\"}");
-            firstEntry = false;
-        } else if (options->format == KVIDX_EXPORT_CSV) {
-            fprintf(fp, "%" PRIu64 ",", key);
-            if (options->includeMetadata) {
-                fprintf(fp, "%" PRIu64 ",%" PRIu64 ",", term, cmd);
-            }
-            if (data && dataLen > 0) {
-                writeCsvField(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\n");
+        result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
+        if (result != KVIDX_OK) {
+            goto cleanup;
         }
 
         count++;
@@ -1438,14 +2019,6 @@ kvidxError kvidxRocksdbExport(kvidxInstance *i, const char *filename,
         rocksdb_iter_next(iter);
     }
 
-    /* Write footer */
-    if (options->format == KVIDX_EXPORT_JSON) {
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-        fprintf(fp, "]}\n");
-    }
-
     if (callback && count > 0) {
         callback(count, total, userData);
     }
@@ -1465,13 +2038,12 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file: %s", filename);
-        return KVIDX_ERROR_IO;
+    kvidxMappedFile m;
+    kvidxError result = kvidxMapFile(i, filename, &m);
+    if (result != KVIDX_OK) {
+        return result;
     }
 
-    kvidxError result = KVIDX_OK;
     uint64_t count = 0;
 
     /* Clear if requested */
@@ -1492,7 +2064,7 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
             }
 
             char *err = NULL;
-            rocksdb_write(s->db, s->syncWriteOptions, batch, &err);
+            dbWrite(s, s->syncWriteOptions, batch, &err);
             rocksdb_writebatch_destroy(batch);
             freeErr(&err);
         }
@@ -1500,7 +2072,7 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
 
     /* Only binary import supported for now */
     if (options->format != KVIDX_EXPORT_BINARY) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                       "Only binary import is supported");
         return KVIDX_ERROR_NOT_SUPPORTED;
@@ -1508,20 +2080,20 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
 
     /* Read and validate header */
     kvidxBinaryHeader header;
-    if (fread(&header, sizeof(header), 1, fp) != 1) {
-        fclose(fp);
+    if (!kvidxMappedRead(&m, &header, sizeof(header))) {
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read header");
         return KVIDX_ERROR_IO;
     }
 
     if (header.magic != KVIDX_BINARY_MAGIC) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT, "Invalid binary format");
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
     if (header.version != KVIDX_BINARY_VERSION) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
                       "Unsupported version: %u", header.version);
         return KVIDX_ERROR_INVALID_ARGUMENT;
@@ -1530,36 +2102,24 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
     /* Create write batch for import */
     rocksdb_writebatch_t *batch = rocksdb_writebatch_create();
     if (!batch) {
-        fclose(fp);
+        kvidxUnmapFile(&m);
         return KVIDX_ERROR_INTERNAL;
     }
 
+    const uint64_t commitBytes = kvidxImportCommitBytes(options);
+    uint64_t pendingBytes = 0;
+
     /* Read entries */
     for (uint64_t idx = 0; idx < header.entryCount; idx++) {
-        uint64_t key, term, cmd, dataLen;
-        uint8_t *data = NULL;
+        uint64_t key, term, cmd;
+        const uint8_t *data;
+        size_t dataLen;
 
-        if (fread(&key, sizeof(key), 1, fp) != 1 ||
-            fread(&term, sizeof(term), 1, fp) != 1 ||
-            fread(&cmd, sizeof(cmd), 1, fp) != 1 ||
-            fread(&dataLen, sizeof(dataLen), 1, fp) != 1) {
+        if (!kvidxMappedEntry(&m, &key, &term, &cmd, &data, &dataLen)) {
             result = KVIDX_ERROR_IO;
             break;
         }
 
-        if (dataLen > 0) {
-            data = malloc(dataLen);
-            if (!data) {
-                result = KVIDX_ERROR_INTERNAL;
-                break;
-            }
-            if (fread(data, 1, dataLen, fp) != dataLen) {
-                free(data);
-                result = KVIDX_ERROR_IO;
-                break;
-            }
-        }
-
         /* Skip duplicates if requested */
         if (options->skipDuplicates) {
             char keyBuf[8];
@@ -1571,28 +2131,40 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
             freeErr(&err);
             if (existing) {
                 free(existing);
-                free(data);
                 continue;
             }
         }
 
-        /* Pack and add to batch */
-        size_t valLen;
-        void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
-        free(data);
-
-        if (!valBuf) {
-            result = KVIDX_ERROR_INTERNAL;
-            break;
-        }
+        /* Add to batch as header + data slices; the batch copies the data
+         * straight from the mapping */
+        uint8_t hdr[VALUE_HEADER_SIZE_CRC];
+        packHeader(s, hdr, term, cmd, data, dataLen);
 
         char keyBuf[8];
         encodeKey(key, keyBuf);
-        rocksdb_writebatch_put(batch, keyBuf, sizeof(keyBuf), valBuf, valLen);
-        free(valBuf);
+        const char *keyList[1] = {keyBuf};
+        const size_t keySizes[1] = {sizeof(keyBuf)};
+        const char *valueList[2] = {(const char *)hdr, (const char *)data};
+        const size_t valueSizes[2] = {valueHeaderSize(s), dataLen};
+        rocksdb_writebatch_putv(batch, 1, keyList, keySizes, dataLen ? 2 : 1,
+                                valueList, valueSizes);
 
         count++;
 
+        /* Write the batch once it is big enough */
+        pendingBytes += sizeof(keyBuf) + valueHeaderSize(s) + dataLen;
+        if (pendingBytes >= commitBytes) {
+            char *err = NULL;
+            dbWrite(s, s->syncWriteOptions, batch, &err);
+            rocksdb_writebatch_clear(batch);
+            if (err) {
+                result = KVIDX_ERROR_INTERNAL;
+                free(err);
+                break;
+            }
+            pendingBytes = 0;
+        }
+
         if (callback && count % 100 == 0) {
             if (!callback(count, header.entryCount, userData)) {
                 result = KVIDX_ERROR_CANCELLED;
@@ -1601,11 +2173,11 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
         }
     }
 
-    fclose(fp);
+    kvidxUnmapFile(&m);
 
     if (result == KVIDX_OK) {
         char *err = NULL;
-        rocksdb_write(s->db, s->syncWriteOptions, batch, &err);
+        dbWrite(s, s->syncWriteOptions, batch, &err);
         if (err) {
             result = KVIDX_ERROR_INTERNAL;
             free(err);
@@ -1625,6 +2197,42 @@ kvidxError kvidxRocksdbImport(kvidxInstance *i, const char *filename,
  * Configuration
  * ==================================================================== */
 
+/* Switch a new, empty database to checksummed values. The format of a
+ * database holding data never changes. */
+static kvidxError chooseChecksummedFormat(kvidxInstance *i) {
+    rocksdbState *s = STATE(i);
+    if (s->writeBatch) {
+        return KVIDX_OK;
+    }
+
+    rocksdb_iterator_t *iter = rocksdb_create_iterator(s->db, s->readOptions);
+    if (!iter) {
+        return KVIDX_ERROR_INTERNAL;
+    }
+    rocksdb_iter_seek_to_first(iter);
+    const bool empty = !rocksdb_iter_valid(iter);
+    rocksdb_iter_destroy(iter);
+    if (!empty) {
+        return KVIDX_OK;
+    }
+
+    /* Durable before any checksummed value can be written */
+    FILE *format = openFormatFile(s, "w");
+    bool written = format && fputc(VALUE_FORMAT_CHECKSUMMED, format) != EOF &&
+                   fflush(format) == 0 && fsync(fileno(format)) == 0;
+    if (format && fclose(format) != 0) {
+        written = false;
+    }
+    if (!written) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to record value format in %s",
+                      s->dbPath);
+        return KVIDX_ERROR_IO;
+    }
+
+    s->checksummed = true;
+    return KVIDX_OK;
+}
+
 kvidxError kvidxRocksdbApplyConfig(kvidxInstance *i,
                                    const kvidxConfig *config) {
     rocksdbState *s = STATE(i);
@@ -1632,14 +2240,13 @@ kvidxError kvidxRocksdbApplyConfig(kvidxInstance *i,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
-    /* RocksDB configuration is largely set at open time.
-     * Some settings can be adjusted dynamically via SetDBOptions. */
+    /* RocksDB configuration is largely set at open time (see
+     * applyOpenOptions()). Sync mode and the WAL are per-write options. */
+    applyWriteOptions(s, config);
 
-    /* Adjust sync mode */
-    if (config->syncMode == KVIDX_SYNC_OFF) {
-        rocksdb_writeoptions_set_sync(s->syncWriteOptions, 0);
-    } else {
-        rocksdb_writeoptions_set_sync(s->syncWriteOptions, 1);
+    s->verifyChecksums = config->verifyChecksums;
+    if (config->valueChecksums && !s->checksummed) {
+        return chooseChecksummedFormat(i);
     }
 
     return KVIDX_OK;
@@ -1775,7 +2382,7 @@ kvidxError kvidxRocksdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Pack the value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, data, dataLen, &valLen);
     if (!valBuf) {
         return KVIDX_ERROR_INTERNAL;
     }
@@ -1788,8 +2395,8 @@ kvidxError kvidxRocksdbInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -1815,6 +2422,7 @@ bool kvidxRocksdbAbort(kvidxInstance *i) {
 
     rocksdb_writebatch_wi_destroy(s->writeBatch);
     s->writeBatch = NULL;
+    s->writes++;
 
     return true;
 }
@@ -1871,7 +2479,7 @@ kvidxError kvidxRocksdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
         }
         if (oldData && oldDataLen) {
             size_t dLen;
-            const uint8_t *dPtr = extractData(existing, existingLen, &dLen);
+            const uint8_t *dPtr = extractData(s, existing, existingLen, &dLen);
             if (dLen > 0) {
                 *oldData = malloc(dLen);
                 if (*oldData) {
@@ -1904,7 +2512,7 @@ kvidxError kvidxRocksdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Pack and write the new value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, data, dataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, data, dataLen, &valLen);
     if (!valBuf) {
         return KVIDX_ERROR_INTERNAL;
     }
@@ -1916,8 +2524,8 @@ kvidxError kvidxRocksdbGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -1977,7 +2585,7 @@ kvidxError kvidxRocksdbGetAndRemove(kvidxInstance *i, uint64_t key,
     }
     if (data && dataLen) {
         size_t dLen;
-        const uint8_t *dPtr = extractData(existing, existingLen, &dLen);
+        const uint8_t *dPtr = extractData(s, existing, existingLen, &dLen);
         if (dLen > 0) {
             *data = malloc(dLen);
             if (*data) {
@@ -2005,7 +2613,7 @@ kvidxError kvidxRocksdbGetAndRemove(kvidxInstance *i, uint64_t key,
         return KVIDX_OK;
     }
 
-    rocksdb_delete(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), &err);
+    dbDelete(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), &err);
     if (err) {
         free(err);
         return KVIDX_ERROR_INTERNAL;
@@ -2014,7 +2622,7 @@ kvidxError kvidxRocksdbGetAndRemove(kvidxInstance *i, uint64_t key,
     /* Also delete TTL entry if present */
     char ttlKeyBuf[TTL_KEY_SIZE];
     encodeTTLKey(key, ttlKeyBuf);
-    rocksdb_delete(s->db, s->writeOptions, ttlKeyBuf, TTL_KEY_SIZE, &err);
+    dbDelete(s, s->writeOptions, ttlKeyBuf, TTL_KEY_SIZE, &err);
     freeErr(&err);
 
     return KVIDX_OK;
@@ -2072,7 +2680,7 @@ kvidxError kvidxRocksdbCompareAndSwap(kvidxInstance *i, uint64_t key,
     } else {
         size_t currentDataLen;
         const uint8_t *currentData =
-            extractData(existing, existingLen, &currentDataLen);
+            extractData(s, existing, existingLen, &currentDataLen);
 
         bool match = (currentDataLen == expectedLen);
         if (match && expectedLen > 0) {
@@ -2087,7 +2695,7 @@ kvidxError kvidxRocksdbCompareAndSwap(kvidxInstance *i, uint64_t key,
 
     /* Data matches - perform the swap */
     size_t valLen;
-    void *valBuf = packValue(newTerm, newCmd, newData, newDataLen, &valLen);
+    void *valBuf = packValue(s, newTerm, newCmd, newData, newDataLen, &valLen);
     if (!valBuf) {
         return KVIDX_ERROR_INTERNAL;
     }
@@ -2100,8 +2708,8 @@ kvidxError kvidxRocksdbCompareAndSwap(kvidxInstance *i, uint64_t key,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -2158,7 +2766,7 @@ kvidxError kvidxRocksdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
     size_t oldDataLen = 0;
     const uint8_t *oldData = NULL;
     if (existing) {
-        oldData = extractData(existing, existingLen, &oldDataLen);
+        oldData = extractData(s, existing, existingLen, &oldDataLen);
     }
 
     size_t totalDataLen = oldDataLen + dataLen;
@@ -2178,7 +2786,7 @@ kvidxError kvidxRocksdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Pack the new value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, combinedData, totalDataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, combinedData, totalDataLen, &valLen);
     free(combinedData);
 
     if (!valBuf) {
@@ -2196,8 +2804,8 @@ kvidxError kvidxRocksdbAppend(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -2252,7 +2860,7 @@ kvidxError kvidxRocksdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
     size_t oldDataLen = 0;
     const uint8_t *oldData = NULL;
     if (existing) {
-        oldData = extractData(existing, existingLen, &oldDataLen);
+        oldData = extractData(s, existing, existingLen, &oldDataLen);
     }
 
     size_t totalDataLen = dataLen + oldDataLen;
@@ -2272,7 +2880,7 @@ kvidxError kvidxRocksdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Pack the new value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, combinedData, totalDataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, combinedData, totalDataLen, &valLen);
     free(combinedData);
 
     if (!valBuf) {
@@ -2290,8 +2898,8 @@ kvidxError kvidxRocksdbPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -2354,7 +2962,7 @@ kvidxError kvidxRocksdbGetValueRange(kvidxInstance *i, uint64_t key,
 
     /* Extract data portion */
     size_t dataLen;
-    const uint8_t *dataPtr = extractData(value, valueLen, &dataLen);
+    const uint8_t *dataPtr = extractData(s, value, valueLen, &dataLen);
 
     /* Validate offset */
     if (offset >= dataLen) {
@@ -2424,7 +3032,7 @@ kvidxError kvidxRocksdbSetValueRange(kvidxInstance *i, uint64_t key,
     uint64_t term = extractTerm(existing, existingLen);
     uint64_t cmd = extractCmd(existing, existingLen);
     size_t oldDataLen;
-    const uint8_t *oldData = extractData(existing, existingLen, &oldDataLen);
+    const uint8_t *oldData = extractData(s, existing, existingLen, &oldDataLen);
 
     /* Calculate new size (may extend the data) */
     size_t newDataLen =
@@ -2450,7 +3058,7 @@ kvidxError kvidxRocksdbSetValueRange(kvidxInstance *i, uint64_t key,
 
     /* Pack the new value */
     size_t valLen;
-    void *valBuf = packValue(term, cmd, newData, newDataLen, &valLen);
+    void *valBuf = packValue(s, term, cmd, newData, newDataLen, &valLen);
     free(newData);
 
     if (!valBuf) {
@@ -2468,8 +3076,8 @@ kvidxError kvidxRocksdbSetValueRange(kvidxInstance *i, uint64_t key,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf,
-                valLen, &err);
+    dbPut(s, s->syncWriteOptions, keyBuf, sizeof(keyBuf), valBuf, valLen,
+          &err);
     free(valBuf);
 
     if (err) {
@@ -2530,8 +3138,8 @@ kvidxError kvidxRocksdbSetExpire(kvidxInstance *i, uint64_t key,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, ttlKeyBuf, TTL_KEY_SIZE,
-                (char *)&expireAt, sizeof(expireAt), &err);
+    dbPut(s, s->syncWriteOptions, ttlKeyBuf, TTL_KEY_SIZE, (char *)&expireAt,
+          sizeof(expireAt), &err);
 
     if (err) {
         free(err);
@@ -2581,8 +3189,8 @@ kvidxError kvidxRocksdbSetExpireAt(kvidxInstance *i, uint64_t key,
         return KVIDX_OK;
     }
 
-    rocksdb_put(s->db, s->syncWriteOptions, ttlKeyBuf, TTL_KEY_SIZE,
-                (char *)&timestampMs, sizeof(timestampMs), &err);
+    dbPut(s, s->syncWriteOptions, ttlKeyBuf, TTL_KEY_SIZE,
+          (char *)&timestampMs, sizeof(timestampMs), &err);
 
     if (err) {
         free(err);
@@ -2693,7 +3301,7 @@ kvidxError kvidxRocksdbPersist(kvidxInstance *i, uint64_t key) {
         return KVIDX_OK;
     }
 
-    rocksdb_delete(s->db, s->writeOptions, ttlKeyBuf, TTL_KEY_SIZE, &err);
+    dbDelete(s, s->writeOptions, ttlKeyBuf, TTL_KEY_SIZE, &err);
     freeErr(&err);
 
     return KVIDX_OK;
@@ -2708,6 +3316,7 @@ kvidxError kvidxRocksdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
 
     uint64_t expired = 0;
     uint64_t now = currentTimeMs();
+    const size_t mark = kvidxChangeMark(i);
 
     bool ownBatch = false;
     if (!s->writeBatch) {
@@ -2760,6 +3369,7 @@ kvidxError kvidxRocksdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
                 encodeKey(dataKey, dataKeyBuf);
                 rocksdb_writebatch_wi_delete(s->writeBatch, dataKeyBuf, 8);
 
+                kvidxChangeNoteExpired(i, dataKey);
                 expired++;
             }
         }
@@ -2771,13 +3381,13 @@ kvidxError kvidxRocksdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
 
     if (ownBatch) {
         char *err = NULL;
-        rocksdb_write_writebatch_wi(s->db, s->syncWriteOptions, s->writeBatch,
-                                    &err);
+        dbWriteIndexed(s, s->syncWriteOptions, s->writeBatch, &err);
         rocksdb_writebatch_wi_destroy(s->writeBatch);
         s->writeBatch = NULL;
 
         if (err) {
             free(err);
+            kvidxChangeRewind(i, mark);
             return KVIDX_ERROR_INTERNAL;
         }
     }
@@ -2788,3 +3398,224 @@ kvidxError kvidxRocksdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
 
     return KVIDX_OK;
 }
+
+/* ====================================================================
+ * Storage Replication (v0.10.0)
+ * ==================================================================== */
+
+/*
+ * The sender creates a checkpoint (hard links to the live SST files plus a
+ * flushed memtable) in a directory beside the database and streams every
+ * file in it, followed by FORMAT_FILE. Writers continue meanwhile, and the
+ * SST data is read once, straight from the shared files.
+ *
+ * The receiver stages the files beside the database, closes, swaps the
+ * directories and reopens. Readers from kvidxRocksdbOpenReader() must be
+ * closed first.
+ */
+
+/* Checkpoint directory inside the sender's scratch directory */
+#define CHECKPOINT_DIR "/checkpoint"
+
+bool kvidxRocksdbCopyStorageForReplication(kvidxInstance *i,
+                                           kvidxStreamWriteCallback networkWrite,
+                                           void *networkState) {
+    rocksdbState *s = STATE(i);
+
+    /* A checkpoint wouldn't hold the pending write batch */
+    if (s->writeBatch) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                               "Cannot copy storage inside a transaction");
+    }
+
+    char *dir = kvidxReplicationTempDir(s->dbPath);
+    char *checkpointDir =
+        dir ? malloc(strlen(dir) + sizeof(CHECKPOINT_DIR)) : NULL;
+    if (!checkpointDir) {
+        if (dir) {
+            kvidxReplicationRemoveDir(dir);
+        }
+        free(dir);
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_IO,
+                               "Failed to create snapshot directory");
+    }
+    strcpy(checkpointDir, dir);
+    strcat(checkpointDir, CHECKPOINT_DIR);
+
+    char *err = NULL;
+    rocksdb_checkpoint_t *checkpoint =
+        rocksdb_checkpoint_object_create(s->db, &err);
+    if (!err) {
+        /* 0: always flush the memtable rather than copying the WAL */
+        rocksdb_checkpoint_create(checkpoint, checkpointDir, 0, &err);
+    }
+    if (checkpoint) {
+        rocksdb_checkpoint_object_destroy(checkpoint);
+    }
+
+    bool sent = false;
+    if (err) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Checkpoint failed: %s", err);
+        free(err);
+    } else {
+        kvidxReplicationSender sender;
+        kvidxReplicationSendBegin(&sender, networkWrite, networkState,
+                                  "rocksdb");
+        kvidxReplicationSendDir(&sender, checkpointDir);
+
+        FILE *format = openFormatFile(s, "r");
+        if (format) {
+            kvidxReplicationSendFd(&sender, FORMAT_FILE + 1, fileno(format));
+            fclose(format);
+        }
+
+        sent = kvidxReplicationSendEnd(&sender);
+        if (!sent) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Failed to send snapshot");
+        }
+    }
+
+    kvidxReplicationRemoveDir(dir);
+    free(checkpointDir);
+    free(dir);
+    return sent;
+}
+
+/**
+ * Checks shared by receiving and replacing. Creates the staging directory
+ * and copies the database path.
+ */
+static kvidxError beginReplace(kvidxInstance *i, char **dir, char **dbPath) {
+    const rocksdbState *s = STATE(i);
+    if (s->sharedDb) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot replace storage through a reader");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (s->writeBatch) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot replace storage inside a transaction");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Everything below outlives the database */
+    *dbPath = strdup(s->dbPath);
+    *dir = *dbPath ? kvidxReplicationTempDir(*dbPath) : NULL;
+    if (!*dir) {
+        free(*dbPath);
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create staging directory");
+        return KVIDX_ERROR_IO;
+    }
+    return KVIDX_OK;
+}
+
+/**
+ * Close, swap the directory dir in for dbPath and reopen.
+ */
+static kvidxError installStaged(kvidxInstance *i, const char *dir,
+                                const char *dbPath) {
+    kvidxRocksdbClose(i);
+    return kvidxReplicationInstall(i, dir, dbPath, dbPath);
+}
+
+bool kvidxRocksdbCopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead,
+    void *networkState) {
+    char *dir;
+    char *dbPath;
+    if (beginReplace(i, &dir, &dbPath) != KVIDX_OK) {
+        return false;
+    }
+
+    kvidxError result = kvidxReplicationReceiveFiles(
+        i, networkRead, networkState, "rocksdb", dir, "CURRENT");
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, dbPath);
+    }
+
+    /* Gone after a successful install */
+    kvidxReplicationRemoveDir(dir);
+    free(dir);
+    free(dbPath);
+    return result == KVIDX_OK;
+}
+
+/**
+ * Replace every entry with a binary export stream: load it into a new
+ * database in the staging directory, written without a WAL and flushed
+ * once, then swap that directory in for the database.
+ */
+kvidxError kvidxRocksdbReplaceAll(kvidxInstance *i,
+                                  kvidxStreamReadCallback read,
+                                  void *streamData) {
+    char *dir;
+    char *dbPath;
+    kvidxError result = beginReplace(i, &dir, &dbPath);
+    if (result != KVIDX_OK) {
+        return result;
+    }
+
+    result = kvidxReplicationBuild(i, dir, NULL, read, streamData);
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, dbPath);
+    }
+
+    /* Gone after a successful install */
+    kvidxReplicationRemoveDir(dir);
+    free(dir);
+    free(dbPath);
+    return result;
+}
+
+/* ====================================================================
+ * Space Reclamation (v0.10.0)
+ * ==================================================================== */
+
+/**
+ * @section Space Reclamation
+ *
+ * Deleted keys stay on disk as tombstones until compaction reaches them.
+ * Range removes too small to be compacted on the spot (see Range Deletes)
+ * record the keys they span; kvidxRocksdbReclaimSpace() compacts that span
+ * in one CompactRange and reports how much the SST files shrank. Pages do
+ * not apply, so maxPages is unused.
+ */
+
+/* Total size of the live SST files */
+static uint64_t sstFileBytes(rocksdbState *s) {
+    uint64_t bytes = 0;
+    char *value =
+        rocksdb_property_value(s->db, "rocksdb.total-sst-files-size");
+    if (value) {
+        bytes = (uint64_t)strtoull(value, NULL, 10);
+        free(value);
+    }
+    return bytes;
+}
+
+kvidxError kvidxRocksdbReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                    kvidxReclaimResult *result) {
+    (void)maxPages;
+    rocksdbState *s = STATE(i);
+    if (s->sharedDb) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot reclaim space through a reader");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (!s->truncated) {
+        return KVIDX_OK;
+    }
+
+    char startBuf[8];
+    char endBuf[9];
+    encodeKey(s->truncatedFirst, startBuf);
+    const size_t endLen = encodeEndKey(s->truncatedLast, endBuf);
+
+    const uint64_t before = sstFileBytes(s);
+    rocksdb_compact_range(s->db, startBuf, sizeof(startBuf), endBuf, endLen);
+    const uint64_t after = sstFileBytes(s);
+
+    s->truncated = false;
+    result->bytesReclaimed = before > after ? before - after : 0;
+    return KVIDX_OK;
+}
@@ -6,6 +6,7 @@ __BEGIN_DECLS
 /* Open / Close / Management */
 bool kvidxRocksdbOpen(kvidxInstance *i, const char *filename, const char **err);
 bool kvidxRocksdbClose(kvidxInstance *i);
+bool kvidxRocksdbOpenReader(kvidxInstance *i, kvidxInstance *reader);
 bool kvidxRocksdbFsync(kvidxInstance *i);
 
 /* Transactional Control */
@@ -21,6 +22,11 @@ bool kvidxRocksdbGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
 bool kvidxRocksdbGetNext(kvidxInstance *i, uint64_t previousKey,
                          uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
                          const uint8_t **data, size_t *len);
+kvidxError kvidxRocksdbScanRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, kvidxScanVisitor visit,
+                                 void *ctx);
+kvidxError kvidxRocksdbVerifyRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, kvidxVerifyResult *result);
 bool kvidxRocksdbExists(kvidxInstance *i, uint64_t key);
 bool kvidxRocksdbExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
 bool kvidxRocksdbMax(kvidxInstance *i, uint64_t *key);
@@ -109,4 +115,21 @@ kvidxError kvidxRocksdbPersist(kvidxInstance *i, uint64_t key);
 kvidxError kvidxRocksdbExpireScan(kvidxInstance *i, uint64_t maxKeys,
                                   uint64_t *expiredCount);
 
+/* Storage Replication */
+bool kvidxRocksdbCopyStorageForReplication(kvidxInstance *i,
+                                           kvidxStreamWriteCallback networkWrite,
+                                           void *networkState);
+bool kvidxRocksdbCopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead, void *networkState);
+kvidxError kvidxRocksdbReplaceAll(kvidxInstance *i,
+                                  kvidxStreamReadCallback read,
+                                  void *streamData);
+
+/* Space Reclamation */
+kvidxError kvidxRocksdbReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                    kvidxReclaimResult *result);
+
+/* Work Counters */
+void kvidxRocksdbIoCounters(kvidxInstance *i, kvidxIoCounters *counters);
+
 __END_DECLS
@@ -0,0 +1,2012 @@
+/**
+ * @file kvidxkitAdapterSeglog.c
+ * @brief Segmented log backend adapter for kvidxkit
+ *
+ * This adapter implements the kvidxInterface on top of an append-only log
+ * split into fixed-size, preallocated, memory-mapped segment files. It is
+ * built for the workload kvidxkit exists for: replicated logs whose keys are
+ * appended in increasing order, truncated at the tail after a leader change
+ * and compacted at the head after a snapshot.
+ *
+ * ## Architecture
+ *
+ * 1. **Segments**: The database is a directory of segment files named by a
+ *    hex sequence number ("0000000000000001.seg", ...). Each segment is
+ *    preallocated to kvidxConfig.seglogSegmentBytes (default 16 MB) and
+ *    mapped MAP_SHARED. Records are copied straight into the map; the last
+ *    segment is the only one written to.
+ *
+ * 2. **Index**: An in-memory array of (key, segment, offset) sorted by key,
+ *    rebuilt by replaying the log on open. While the live keys are dense
+ *    (maxKey - minKey + 1 == count) a key's slot is simply key - minKey, so
+ *    Get() is O(1); sparse keyspaces fall back to binary search.
+ *
+ * 3. **Tail truncation**: Removing the newest keys rewinds the write pointer
+ *    to the first removed record and unlinks any newer segments, leaving no
+ *    tombstone behind.
+ *
+ * 4. **Head compaction**: Removing the oldest keys writes one range
+ *    tombstone; segments at the head of the log whose records are all dead
+ *    are then unlinked whole.
+ *
+ * ## Record Format
+ *
+ * Every record is 8-byte aligned and starts with a 48-byte header:
+ *   - Bytes 0-1:   magic (RECORD_MAGIC)
+ *   - Byte 2:      type (RECORD_*)
+ *   - Byte 3:      reserved
+ *   - Bytes 4-7:   checksum (FNV-1a over the header and data)
+ *   - Bytes 8-15:  key (RECORD_DELETE: first key of the range)
+ *   - Bytes 16-23: term (RECORD_DELETE: last key of the range)
+ *   - Bytes 24-31: cmd
+ *   - Bytes 32-39: expiresAt in ms (0 = no expiry)
+ *   - Bytes 40-47: data length
+ *   - Bytes 48+:   data blob, zero-padded to 8 bytes
+ *
+ * Eight zero bytes always follow the last record. Replay stops at the first
+ * header that is zero, torn, or fails its checksum.
+ *
+ * ## Transaction Model
+ *
+ * Writes outside Begin()/Commit() are single records and atomic on their
+ * own. Inside a transaction the first write logs a BEGIN marker and Commit()
+ * logs a COMMIT marker; replay discards a trailing BEGIN that was never
+ * committed. Reads inside a transaction see its writes. Abort() rewinds the
+ * log to the BEGIN marker and rebuilds the index.
+ *
+ * Durability follows kvidxConfig.syncMode: with KVIDX_SYNC_FULL or
+ * KVIDX_SYNC_EXTRA every commit msync()s the dirty segments, otherwise the
+ * OS writes the map back lazily and kvidxFsync() forces it.
+ *
+ * ## Memory Management
+ *
+ * Data pointers returned from Get operations point directly into the mapped
+ * segment. They stay valid until:
+ * - A removal truncates or compacts the segment holding the record
+ * - The database is closed
+ *
+ * For long-term retention, callers must copy the data.
+ *
+ * ## Performance Characteristics
+ *
+ * - Appends: O(1), one memcpy into the map
+ * - Reads: O(1) for dense keys, O(log n) otherwise, zero-copy from mmap
+ * - Tail truncation: O(removed keys), no tombstone
+ * - Head compaction: O(removed keys) plus one unlink per dead segment
+ * - Space: overwritten and removed records are only reclaimed when their
+ *   segment reaches the head of the log or is truncated away
+ */
+
+/* Required for mmap, flock and posix_fallocate under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkitAdapterSeglog.h"
+#include "kvidxkit_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Segment file header magic: "KVSEGLOG" */
+#define SEGMENT_MAGIC 0x474F4C4745535F4BULL
+#define SEGMENT_VERSION 1
+
+/** Records start here; the segment header is padded to 32 bytes */
+#define SEGMENT_DATA_START 32
+
+/** Default size of newly created segments: 16 MB */
+#define DEFAULT_SEGMENT_BYTES (16ULL * 1024 * 1024)
+
+/** Smallest configurable segment size */
+#define SEGMENT_MIN_BYTES 4096ULL
+
+/** Record offsets are stored as 32 bits in the index */
+#define SEGMENT_MAX_BYTES ((uint64_t)UINT32_MAX + 1 - 4096)
+
+/** Record header magic (low 16 bits of the first word) */
+#define RECORD_MAGIC 0x4C53
+
+/** Record types */
+#define RECORD_PUT 1    /**< key → (term, cmd, expiresAt, data) */
+#define RECORD_DELETE 2 /**< remove keys in [key, term] */
+#define RECORD_BEGIN 3  /**< transaction start marker */
+#define RECORD_COMMIT 4 /**< transaction commit marker */
+
+/** Zero bytes written after the last record */
+#define TERMINATOR_SIZE 8
+
+typedef struct segmentHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t id;
+} segmentHeader;
+
+typedef struct seglogRecord {
+    uint16_t magic;
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t checksum;
+    uint64_t key;
+    uint64_t term;
+    uint64_t cmd;
+    uint64_t expiresAt;
+    uint64_t dataLen;
+} seglogRecord;
+
+/**
+ * One mapped segment file.
+ */
+typedef struct seglogSegment {
+    uint64_t id;   /**< Sequence number (also the file name) */
+    int fd;        /**< Open file descriptor */
+    uint8_t *map;  /**< MAP_SHARED mapping of the whole file */
+    uint64_t size; /**< File and mapping size */
+    uint64_t used; /**< End of the last valid record */
+    uint64_t live; /**< Index entries whose record lives here */
+    bool dirty;    /**< Written since the last msync() */
+} seglogSegment;
+
+/**
+ * Index entry: where the current record for a key lives.
+ *
+ * seg holds the low 32 bits of the segment id; segment ids are contiguous,
+ * so the array slot is (seg - first segment id) in 32-bit arithmetic.
+ */
+typedef struct seglogEntry {
+    uint64_t key;
+    uint32_t seg;
+    uint32_t offset;
+} seglogEntry;
+
+/** A position in the log, ordered by (segment id, offset) */
+typedef struct seglogPos {
+    uint64_t seg;
+    uint64_t offset;
+} seglogPos;
+
+/**
+ * Internal state for a seglog-backed kvidx instance.
+ */
+typedef struct seglogState {
+    char *dirPath; /**< Path to the segment directory */
+    int dirFd;     /**< Directory handle (holds the flock) */
+
+    seglogSegment *segs; /**< Segments, oldest first; last is active */
+    size_t segCount;
+    size_t segCap;
+
+    seglogEntry *index; /**< Sorted entries live at index[indexStart..] */
+    size_t indexStart;
+    size_t indexCount;
+    size_t indexCap;
+
+    uint64_t dataBytes;    /**< Sum of data lengths of live entries */
+    uint64_t expiringKeys; /**< Live entries with an expiry */
+
+    /* Records after rewindFloor are puts of strictly increasing new keys,
+     * so any suffix of the keyspace that starts past it can be dropped by
+     * rewinding the log instead of writing a tombstone. */
+    seglogPos rewindFloor;
+    seglogPos lastCommit; /**< Most recent COMMIT marker */
+
+    bool inTxn;            /**< Between Begin() and Commit()/Abort() */
+    bool txnMarked;        /**< BEGIN marker written for this txn */
+    bool txnRaisedFloor;   /**< Txn wrote a non-append record */
+    seglogPos txnStart;    /**< Position of the BEGIN marker */
+    seglogPos floorBefore; /**< rewindFloor when the txn began */
+
+    uint64_t segmentBytes; /**< Size of newly created segments */
+    bool syncCommits;      /**< msync() on every commit */
+    bool dirDirty;         /**< Segments created/unlinked since last fsync */
+} seglogState;
+
+#define STATE(instance) ((seglogState *)(instance)->kvidxdata)
+#define ENTRIES(s) ((s)->index + (s)->indexStart)
+
+/* ====================================================================
+ * Record Helpers
+ * ==================================================================== */
+
+static inline uint64_t align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+/** Bytes a record with dataLen bytes of data occupies in a segment */
+static inline uint64_t recordSize(uint64_t dataLen) {
+    return align8(sizeof(seglogRecord) + dataLen);
+}
+
+static uint32_t fnv1a(uint32_t h, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    for (size_t n = 0; n < len; n++) {
+        h ^= p[n];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Checksum of a record: everything but the checksum field itself.
+ */
+static uint32_t recordChecksum(const seglogRecord *rec, const void *data) {
+    uint32_t h = 2166136261u;
+    h = fnv1a(h, rec, offsetof(seglogRecord, checksum));
+    h = fnv1a(h, &rec->key, sizeof(*rec) - offsetof(seglogRecord, key));
+    if (rec->dataLen) {
+        h = fnv1a(h, data, rec->dataLen);
+    }
+    return h;
+}
+
+static inline const uint8_t *recordData(const seglogRecord *rec) {
+    return (const uint8_t *)(rec + 1);
+}
+
+/**
+ * Return the record at offset if it is complete and intact, else NULL.
+ */
+static const seglogRecord *validRecordAt(const seglogSegment *seg,
+                                         uint64_t offset) {
+    if (offset + sizeof(seglogRecord) + TERMINATOR_SIZE > seg->size) {
+        return NULL;
+    }
+
+    const seglogRecord *rec = (const seglogRecord *)(seg->map + offset);
+    if (rec->magic != RECORD_MAGIC || rec->type < RECORD_PUT ||
+        rec->type > RECORD_COMMIT) {
+        return NULL;
+    }
+
+    uint64_t room = seg->size - offset - TERMINATOR_SIZE;
+    if (rec->dataLen > room || recordSize(rec->dataLen) > room) {
+        return NULL;
+    }
+
+    if (recordChecksum(rec, recordData(rec)) != rec->checksum) {
+        return NULL;
+    }
+
+    return rec;
+}
+
+static inline int posCompare(seglogPos a, seglogPos b) {
+    if (a.seg != b.seg) {
+        return a.seg < b.seg ? -1 : 1;
+    }
+    if (a.offset != b.offset) {
+        return a.offset < b.offset ? -1 : 1;
+    }
+    return 0;
+}
+
+/* ====================================================================
+ * Segment Management
+ * ==================================================================== */
+
+static inline seglogSegment *activeSegment(seglogState *s) {
+    return &s->segs[s->segCount - 1];
+}
+
+static inline seglogPos tailPos(seglogState *s) {
+    seglogSegment *seg = activeSegment(s);
+    return (seglogPos){.seg = seg->id, .offset = seg->used};
+}
+
+static void segmentPath(const seglogState *s, uint64_t id, char *buf,
+                        size_t bufSize) {
+    snprintf(buf, bufSize, "%s/%016" PRIx64 ".seg", s->dirPath, id);
+}
+
+static seglogSegment *entrySegment(seglogState *s, const seglogEntry *e) {
+    return &s->segs[(uint32_t)(e->seg - (uint32_t)s->segs[0].id)];
+}
+
+static const seglogRecord *entryRecord(seglogState *s, const seglogEntry *e) {
+    return (const seglogRecord *)(entrySegment(s, e)->map + e->offset);
+}
+
+static seglogPos entryPos(seglogState *s, const seglogEntry *e) {
+    return (seglogPos){.seg = entrySegment(s, e)->id, .offset = e->offset};
+}
+
+static bool reserveSegmentSlot(seglogState *s) {
+    if (s->segCount < s->segCap) {
+        return true;
+    }
+
+    size_t cap = s->segCap ? s->segCap * 2 : 8;
+    seglogSegment *segs = realloc(s->segs, cap * sizeof(*segs));
+    if (!segs) {
+        return false;
+    }
+
+    s->segs = segs;
+    s->segCap = cap;
+    return true;
+}
+
+/**
+ * Map an open segment file of the given size.
+ */
+static bool mapSegment(seglogSegment *seg) {
+    void *map = mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     seg->fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    seg->map = map;
+    return true;
+}
+
+/**
+ * Create, preallocate and map the next segment.
+ *
+ * The file is sized with ftruncate() and, where available, backed with
+ * posix_fallocate() so appends never hit ENOSPC through the mapping
+ * (which would arrive as SIGBUS rather than an error).
+ */
+static bool addSegment(kvidxInstance *i, uint64_t size) {
+    seglogState *s = STATE(i);
+
+    if (!reserveSegmentSlot(s)) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Out of memory adding segment");
+        return false;
+    }
+
+    uint64_t id = s->segCount ? activeSegment(s)->id + 1 : 1;
+    char path[4096];
+    segmentPath(s, id, path, sizeof(path));
+
+    seglogSegment seg = {.id = id, .size = size};
+    seg.fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (seg.fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create segment %s: %s",
+                      path, strerror(errno));
+        return false;
+    }
+
+    int rc = ftruncate(seg.fd, (off_t)size);
+#ifdef __linux__
+    if (rc == 0) {
+        rc = posix_fallocate(seg.fd, 0, (off_t)size);
+        if (rc == EOPNOTSUPP || rc == EINVAL) {
+            rc = 0; /* Filesystem can't preallocate; sparse file it is */
+        }
+        errno = rc;
+    }
+#endif
+
+    if (rc != 0 || !mapSegment(&seg)) {
+        kvidxSetError(i, errno == ENOSPC ? KVIDX_ERROR_DISK_FULL
+                                         : KVIDX_ERROR_IO,
+                      "Failed to allocate segment %s: %s", path,
+                      strerror(errno));
+        close(seg.fd);
+        unlink(path);
+        return false;
+    }
+
+    segmentHeader header = {
+        .magic = SEGMENT_MAGIC, .version = SEGMENT_VERSION, .id = id};
+    memcpy(seg.map, &header, sizeof(header));
+    seg.used = SEGMENT_DATA_START;
+    seg.dirty = true;
+
+    s->segs[s->segCount++] = seg;
+    s->dirDirty = true;
+    return true;
+}
+
+/**
+ * Unmap and close the segment at slot idx (first or last), optionally
+ * deleting its file.
+ */
+static void dropSegment(seglogState *s, size_t idx, bool removeFile) {
+    seglogSegment *seg = &s->segs[idx];
+
+    munmap(seg->map, seg->size);
+    close(seg->fd);
+
+    if (removeFile) {
+        char path[4096];
+        segmentPath(s, seg->id, path, sizeof(path));
+        unlink(path);
+        s->dirDirty = true;
+    }
+
+    memmove(&s->segs[idx], &s->segs[idx + 1],
+            (s->segCount - idx - 1) * sizeof(*seg));
+    s->segCount--;
+}
+
+/**
+ * Truncate the log at pos.
+ *
+ * Newer segments are unlinked newest-first, then the terminator is written
+ * at pos, so a crash part-way leaves a prefix of the old log. The caller has
+ * already dropped every index entry at or after pos.
+ */
+static void rewindTo(seglogState *s, seglogPos pos) {
+    while (s->segCount > 1 && activeSegment(s)->id > pos.seg) {
+        dropSegment(s, s->segCount - 1, true);
+    }
+
+    seglogSegment *seg = activeSegment(s);
+    memset(seg->map + pos.offset, 0, TERMINATOR_SIZE);
+    seg->used = pos.offset;
+    seg->dirty = true;
+}
+
+/**
+ * msync() every dirty segment and fsync() the directory if segments were
+ * created or unlinked since the last sync.
+ */
+static bool syncSegments(seglogState *s) {
+    bool ok = true;
+    KVIDX_PROBE(fsync__start);
+
+    for (size_t n = 0; n < s->segCount; n++) {
+        seglogSegment *seg = &s->segs[n];
+        if (!seg->dirty) {
+            continue;
+        }
+
+        if (msync(seg->map, seg->size, MS_SYNC) == 0) {
+            seg->dirty = false;
+        } else {
+            ok = false;
+        }
+    }
+
+    if (s->dirDirty) {
+        if (fsync(s->dirFd) == 0) {
+            s->dirDirty = false;
+        } else {
+            ok = false;
+        }
+    }
+
+    KVIDX_PROBE1(fsync__done, ok);
+    return ok;
+}
+
+/* ====================================================================
+ * Index
+ * ==================================================================== */
+
+/**
+ * Position of the first entry with key >= key.
+ *
+ * Dense keyspaces (the common case for logs) resolve by subtraction.
+ */
+static size_t indexLowerBound(const seglogState *s, uint64_t key) {
+    const seglogEntry *e = ENTRIES(s);
+    size_t count = s->indexCount;
+
+    if (count == 0 || key <= e[0].key) {
+        return 0;
+    }
+    if (key > e[count - 1].key) {
+        return count;
+    }
+
+    uint64_t base = e[0].key;
+    if (e[count - 1].key - base == count - 1) {
+        return (size_t)(key - base);
+    }
+
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (e[mid].key < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/** Position of the first entry with key > key */
+static size_t indexUpperBound(const seglogState *s, uint64_t key) {
+    if (key == UINT64_MAX) {
+        return s->indexCount;
+    }
+    return indexLowerBound(s, key + 1);
+}
+
+static const seglogEntry *indexFind(const seglogState *s, uint64_t key,
+                                    size_t *pos) {
+    size_t at = indexLowerBound(s, key);
+    if (pos) {
+        *pos = at;
+    }
+
+    if (at < s->indexCount && ENTRIES(s)[at].key == key) {
+        return &ENTRIES(s)[at];
+    }
+    return NULL;
+}
+
+/**
+ * Add (delta = 1) or drop (delta = -1) an entry from the live accounting.
+ */
+static void accountEntry(seglogState *s, const seglogEntry *e, int delta) {
+    const seglogRecord *rec = entryRecord(s, e);
+    seglogSegment *seg = entrySegment(s, e);
+
+    if (delta > 0) {
+        seg->live++;
+        s->dataBytes += rec->dataLen;
+        s->expiringKeys += rec->expiresAt != 0;
+    } else {
+        seg->live--;
+        s->dataBytes -= rec->dataLen;
+        s->expiringKeys -= rec->expiresAt != 0;
+    }
+}
+
+static bool indexInsertAt(seglogState *s, size_t pos, seglogEntry entry) {
+    if (s->indexStart + s->indexCount == s->indexCap) {
+        if (s->indexStart > s->indexCap / 2) {
+            /* Mostly trimmed from the head: slide down instead of growing */
+            memmove(s->index, ENTRIES(s),
+                    s->indexCount * sizeof(seglogEntry));
+            s->indexStart = 0;
+        } else {
+            size_t cap = s->indexCap ? s->indexCap * 2 : 1024;
+            seglogEntry *index = realloc(s->index, cap * sizeof(*index));
+            if (!index) {
+                return false;
+            }
+            s->index = index;
+            s->indexCap = cap;
+        }
+    }
+
+    seglogEntry *e = ENTRIES(s);
+    memmove(&e[pos + 1], &e[pos], (s->indexCount - pos) * sizeof(*e));
+    e[pos] = entry;
+    s->indexCount++;
+
+    accountEntry(s, &e[pos], 1);
+    return true;
+}
+
+/**
+ * Drop entries [from, to). Trimming the head only advances indexStart.
+ */
+static void indexRemove(seglogState *s, size_t from, size_t to) {
+    seglogEntry *e = ENTRIES(s);
+    for (size_t n = from; n < to; n++) {
+        accountEntry(s, &e[n], -1);
+    }
+
+    if (from == 0) {
+        s->indexStart += to;
+    } else {
+        memmove(&e[from], &e[to], (s->indexCount - to) * sizeof(*e));
+    }
+    s->indexCount -= to - from;
+
+    if (s->indexCount == 0) {
+        s->indexStart = 0;
+    }
+}
+
+/**
+ * Point key at the record at pos, replacing any existing entry.
+ *
+ * Returns false only on allocation failure. *appended reports whether the
+ * key was new and larger than every live key.
+ */
+static bool indexPut(seglogState *s, uint64_t key, seglogPos pos,
+                     bool *appended) {
+    seglogEntry entry = {.key = key,
+                         .seg = (uint32_t)pos.seg,
+                         .offset = (uint32_t)pos.offset};
+
+    size_t at;
+    seglogEntry *existing = (seglogEntry *)indexFind(s, key, &at);
+    if (existing) {
+        accountEntry(s, existing, -1);
+        *existing = entry;
+        accountEntry(s, existing, 1);
+        *appended = false;
+        return true;
+    }
+
+    *appended = at == s->indexCount;
+    return indexInsertAt(s, at, entry);
+}
+
+static void indexClear(seglogState *s) {
+    s->indexStart = 0;
+    s->indexCount = 0;
+    s->dataBytes = 0;
+    s->expiringKeys = 0;
+    for (size_t n = 0; n < s->segCount; n++) {
+        s->segs[n].live = 0;
+    }
+}
+
+/* ====================================================================
+ * Log Writing
+ * ==================================================================== */
+
+/**
+ * Append one record at the tail, rolling to a new segment if it doesn't
+ * fit. Records larger than the configured segment size get a segment of
+ * their own.
+ */
+static bool appendRecord(kvidxInstance *i, uint8_t type, uint64_t key,
+                         uint64_t term, uint64_t cmd, uint64_t expiresAt,
+                         const void *data, size_t dataLen, seglogPos *at) {
+    seglogState *s = STATE(i);
+    uint64_t recLen = recordSize(dataLen);
+    seglogSegment *seg = activeSegment(s);
+
+    if (recLen > SEGMENT_MAX_BYTES ||
+        seg->used + recLen + TERMINATOR_SIZE > seg->size) {
+        uint64_t need = SEGMENT_DATA_START + recLen + TERMINATOR_SIZE;
+        if (need > SEGMENT_MAX_BYTES) {
+            kvidxSetError(i, KVIDX_ERROR_TOO_BIG,
+                          "Record of %zu bytes exceeds the segment limit",
+                          dataLen);
+            return false;
+        }
+
+        uint64_t size = s->segmentBytes;
+        if (size < need) {
+            size = (need + SEGMENT_MIN_BYTES - 1) & ~(SEGMENT_MIN_BYTES - 1);
+        }
+
+        if (!addSegment(i, size)) {
+            return false;
+        }
+        seg = activeSegment(s);
+    }
+
+    seglogRecord rec = {.magic = RECORD_MAGIC,
+                        .type = type,
+                        .key = key,
+                        .term = term,
+                        .cmd = cmd,
+                        .expiresAt = expiresAt,
+                        .dataLen = dataLen};
+    rec.checksum = recordChecksum(&rec, data);
+
+    uint8_t *dst = seg->map + seg->used;
+    if (dataLen) {
+        memcpy(dst + sizeof(rec), data, dataLen);
+    }
+    memset(dst + sizeof(rec) + dataLen, 0,
+           recLen - sizeof(rec) - dataLen + TERMINATOR_SIZE);
+    memcpy(dst, &rec, sizeof(rec));
+
+    if (at) {
+        at->seg = seg->id;
+        at->offset = seg->used;
+    }
+
+    seg->used += recLen;
+    seg->dirty = true;
+    return true;
+}
+
+/**
+ * Records written from here on can't be rewound over.
+ */
+static void raiseFloor(seglogState *s) {
+    s->rewindFloor = tailPos(s);
+    if (s->inTxn) {
+        s->txnRaisedFloor = true;
+    }
+}
+
+/**
+ * Log the BEGIN marker before the first write of a transaction.
+ *
+ * Deferring it keeps Begin()/Commit() pairs with no writes off the log.
+ * The floor moves past the marker so nothing committed before the
+ * transaction can be rewound (Abort() relies on that).
+ */
+static bool markTxn(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+    if (!s->inTxn || s->txnMarked) {
+        return true;
+    }
+
+    if (!appendRecord(i, RECORD_BEGIN, 0, 0, 0, 0, NULL, 0, &s->txnStart)) {
+        return false;
+    }
+
+    s->txnMarked = true;
+    s->rewindFloor = tailPos(s);
+    return true;
+}
+
+/**
+ * Unlink head segments that hold no live records.
+ *
+ * A head segment's tombstones only affect records in itself or older
+ * segments, all of which are gone, so it can go as soon as it has no live
+ * entries. When the index is empty the whole log is reset to the start of
+ * the first segment. Deferred while a transaction is open so Abort() can
+ * still rewind to the BEGIN marker.
+ */
+static void compactHead(seglogState *s) {
+    if (s->inTxn) {
+        return;
+    }
+
+    if (s->indexCount == 0) {
+        seglogPos start = {.seg = s->segs[0].id, .offset = SEGMENT_DATA_START};
+        if (s->segCount > 1 || s->segs[0].used > SEGMENT_DATA_START) {
+            rewindTo(s, start);
+        }
+        s->rewindFloor = start;
+        s->lastCommit = (seglogPos){0};
+        return;
+    }
+
+    while (s->segCount > 1 && s->segs[0].live == 0) {
+        dropSegment(s, 0, true);
+    }
+}
+
+/**
+ * Finish a write made outside a transaction.
+ */
+static void autoCommit(seglogState *s) {
+    if (!s->inTxn && s->syncCommits) {
+        syncSegments(s);
+    }
+}
+
+/**
+ * Write (insert or replace) a record for key.
+ */
+static kvidxError putRecord(kvidxInstance *i, uint64_t key, uint64_t term,
+                            uint64_t cmd, uint64_t expiresAt, const void *data,
+                            size_t dataLen) {
+    seglogState *s = STATE(i);
+
+    if (!markTxn(i)) {
+        return kvidxGetLastError(i);
+    }
+
+    seglogPos at;
+    if (!appendRecord(i, RECORD_PUT, key, term, cmd, expiresAt, data, dataLen,
+                      &at)) {
+        return kvidxGetLastError(i);
+    }
+
+    bool appended;
+    if (!indexPut(s, key, at, &appended)) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Out of memory growing index");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    if (!appended) {
+        raiseFloor(s);
+    }
+
+    autoCommit(s);
+    return KVIDX_OK;
+}
+
+/**
+ * Remove all keys in [lo, hi].
+ *
+ * If the range covers the newest keys and their records all lie past the
+ * rewind floor, the log is rewound to the first of them. Otherwise a single
+ * RECORD_DELETE tombstone is logged.
+ */
+static kvidxError removeKeys(kvidxInstance *i, uint64_t lo, uint64_t hi,
+                             uint64_t *deletedCount) {
+    seglogState *s = STATE(i);
+
+    if (deletedCount) {
+        *deletedCount = 0;
+    }
+
+    if (lo > hi) {
+        return KVIDX_OK;
+    }
+
+    size_t from = indexLowerBound(s, lo);
+    size_t to = indexUpperBound(s, hi);
+    if (from >= to) {
+        return KVIDX_OK;
+    }
+
+    if (!markTxn(i)) {
+        return kvidxGetLastError(i);
+    }
+
+    seglogPos first = entryPos(s, &ENTRIES(s)[from]);
+    if (to == s->indexCount && posCompare(first, s->rewindFloor) >= 0) {
+        indexRemove(s, from, to);
+        rewindTo(s, first);
+
+        /* A rewind into a committed transaction cut its COMMIT marker */
+        if (!s->inTxn && posCompare(first, s->lastCommit) < 0) {
+            if (!appendRecord(i, RECORD_COMMIT, 0, 0, 0, 0, NULL, 0,
+                              &s->lastCommit)) {
+                return kvidxGetLastError(i);
+            }
+        }
+    } else {
+        if (!appendRecord(i, RECORD_DELETE, lo, hi, 0, 0, NULL, 0, NULL)) {
+            return kvidxGetLastError(i);
+        }
+        indexRemove(s, from, to);
+        raiseFloor(s);
+    }
+
+    if (deletedCount) {
+        *deletedCount = to - from;
+    }
+
+    compactHead(s);
+    autoCommit(s);
+    return KVIDX_OK;
+}
+
+/* ====================================================================
+ * Log Replay
+ * ==================================================================== */
+
+/**
+ * Apply one record to the index during replay.
+ *
+ * Tracks the rewind floor exactly as the live write paths do, so a reopened
+ * log can still be truncated by rewinding.
+ */
+static bool replayRecord(seglogState *s, const seglogRecord *rec,
+                         seglogPos pos) {
+    seglogPos end = {.seg = pos.seg,
+                     .offset = pos.offset + recordSize(rec->dataLen)};
+
+    switch (rec->type) {
+    case RECORD_PUT: {
+        bool appended;
+        if (!indexPut(s, rec->key, pos, &appended)) {
+            return false;
+        }
+        if (!appended) {
+            s->rewindFloor = end;
+        }
+        break;
+    }
+
+    case RECORD_DELETE:
+        indexRemove(s, indexLowerBound(s, rec->key),
+                    indexUpperBound(s, rec->term));
+        s->rewindFloor = end;
+        break;
+
+    case RECORD_COMMIT:
+        s->lastCommit = pos;
+        break;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+/**
+ * Rebuild the index from the segments.
+ *
+ * Pass one finds where each segment's valid records end and whether the log
+ * ends inside a transaction that never committed; if so the log is rewound
+ * to its BEGIN marker. Pass two applies the surviving records in order.
+ */
+static bool replayLog(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+
+    bool pending = false;
+    seglogPos pendingBegin = {0};
+
+    for (size_t n = 0; n < s->segCount; n++) {
+        seglogSegment *seg = &s->segs[n];
+        uint64_t offset = SEGMENT_DATA_START;
+        const seglogRecord *rec;
+
+        while ((rec = validRecordAt(seg, offset))) {
+            if (rec->type == RECORD_BEGIN) {
+                pending = true;
+                pendingBegin = (seglogPos){.seg = seg->id, .offset = offset};
+            } else if (rec->type == RECORD_COMMIT) {
+                pending = false;
+            }
+            offset += recordSize(rec->dataLen);
+        }
+
+        seg->used = offset;
+    }
+
+    /* Whatever follows the last valid record is torn or stale */
+    rewindTo(s, pending ? pendingBegin : tailPos(s));
+
+    indexClear(s);
+    s->rewindFloor = (seglogPos){.seg = s->segs[0].id,
+                                 .offset = SEGMENT_DATA_START};
+    s->lastCommit = (seglogPos){0};
+
+    for (size_t n = 0; n < s->segCount; n++) {
+        seglogSegment *seg = &s->segs[n];
+        uint64_t offset = SEGMENT_DATA_START;
+
+        while (offset < seg->used) {
+            const seglogRecord *rec =
+                (const seglogRecord *)(seg->map + offset);
+            if (!replayRecord(s, rec,
+                              (seglogPos){.seg = seg->id, .offset = offset})) {
+                kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                              "Out of memory rebuilding index");
+                return false;
+            }
+            offset += recordSize(rec->dataLen);
+        }
+    }
+
+    return true;
+}
+
+/* ====================================================================
+ * Transaction Management
+ * ==================================================================== */
+
+/**
+ * Begin a transaction. Nested Begin() calls are no-ops.
+ */
+bool kvidxSeglogBegin(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+    if (s->inTxn) {
+        return true;
+    }
+
+    s->inTxn = true;
+    s->txnMarked = false;
+    s->txnRaisedFloor = false;
+    s->floorBefore = s->rewindFloor;
+    return true;
+}
+
+/**
+ * Commit the current transaction by logging its COMMIT marker.
+ *
+ * A transaction made only of in-order appends leaves the rewind floor where
+ * it was, so its records can later be truncated by rewinding too.
+ */
+bool kvidxSeglogCommit(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+    if (!s->inTxn) {
+        return true;
+    }
+
+    if (s->txnMarked) {
+        if (!appendRecord(i, RECORD_COMMIT, 0, 0, 0, 0, NULL, 0,
+                          &s->lastCommit)) {
+            return false;
+        }
+        if (!s->txnRaisedFloor) {
+            s->rewindFloor = s->floorBefore;
+        }
+    }
+
+    s->inTxn = false;
+    compactHead(s);
+
+    if (s->syncCommits) {
+        return syncSegments(s);
+    }
+    return true;
+}
+
+/**
+ * Abort the current transaction.
+ *
+ * Rewinds the log to the BEGIN marker and rebuilds the index from what
+ * remains. Nothing committed lies past the marker: the rewind floor kept
+ * truncations inside the transaction and head compaction was deferred.
+ */
+bool kvidxSeglogAbort(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+    if (!s->inTxn) {
+        return true;
+    }
+
+    s->inTxn = false;
+    if (!s->txnMarked) {
+        return true;
+    }
+
+    indexClear(s);
+    rewindTo(s, s->txnStart);
+    return replayLog(i);
+}
+
+/* ====================================================================
+ * Data Manipulation
+ * ==================================================================== */
+
+static void readEntry(seglogState *s, const seglogEntry *e, uint64_t *key,
+                      uint64_t *term, uint64_t *cmd, const uint8_t **data,
+                      size_t *len) {
+    const seglogRecord *rec = entryRecord(s, e);
+
+    if (key) {
+        *key = e->key;
+    }
+    if (term) {
+        *term = rec->term;
+    }
+    if (cmd) {
+        *cmd = rec->cmd;
+    }
+    if (data) {
+        *data = recordData(rec);
+    }
+    if (len) {
+        *len = rec->dataLen;
+    }
+}
+
+/**
+ * Retrieve a record by its exact key. Zero-copy: data points into the map.
+ */
+bool kvidxSeglogGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                    uint64_t *cmd, const uint8_t **data, size_t *len) {
+    seglogState *s = STATE(i);
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return false;
+    }
+
+    readEntry(s, e, NULL, term, cmd, data, len);
+    return true;
+}
+
+/**
+ * Find the record with the largest key less than nextKey. As with the
+ * other adapters, nextKey == UINT64_MAX returns the maximum key.
+ */
+bool kvidxSeglogGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
+                        uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                        size_t *len) {
+    seglogState *s = STATE(i);
+    size_t at = nextKey == UINT64_MAX ? s->indexCount
+                                      : indexLowerBound(s, nextKey);
+    if (at == 0) {
+        return false;
+    }
+
+    readEntry(s, &ENTRIES(s)[at - 1], prevKey, prevTerm, cmd, data, len);
+    return true;
+}
+
+/**
+ * Find the record with the smallest key greater than previousKey.
+ */
+bool kvidxSeglogGetNext(kvidxInstance *i, uint64_t previousKey,
+                        uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
+                        const uint8_t **data, size_t *len) {
+    seglogState *s = STATE(i);
+    size_t at = indexUpperBound(s, previousKey);
+    if (at >= s->indexCount) {
+        return false;
+    }
+
+    readEntry(s, &ENTRIES(s)[at], nextKey, nextTerm, cmd, data, len);
+    return true;
+}
+
+bool kvidxSeglogExists(kvidxInstance *i, uint64_t key) {
+    return indexFind(STATE(i), key, NULL) != NULL;
+}
+
+bool kvidxSeglogExistsDual(kvidxInstance *i, uint64_t key, uint64_t term) {
+    seglogState *s = STATE(i);
+    const seglogEntry *e = indexFind(s, key, NULL);
+    return e && entryRecord(s, e)->term == term;
+}
+
+bool kvidxSeglogMax(kvidxInstance *i, uint64_t *key) {
+    seglogState *s = STATE(i);
+    if (s->indexCount == 0) {
+        return false;
+    }
+
+    if (key) {
+        *key = ENTRIES(s)[s->indexCount - 1].key;
+    }
+    return true;
+}
+
+/**
+ * Insert a new record. Fails on duplicate keys, matching the other adapters.
+ */
+bool kvidxSeglogInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen) {
+    if (indexFind(STATE(i), key, NULL)) {
+        kvidxSetError(i, KVIDX_ERROR_DUPLICATE_KEY, "Key already exists");
+        return false;
+    }
+
+    return putRecord(i, key, term, cmd, 0, data, dataLen) == KVIDX_OK;
+}
+
+/**
+ * Delete a record by key. Removing a missing key succeeds.
+ */
+bool kvidxSeglogRemove(kvidxInstance *i, uint64_t key) {
+    return removeKeys(i, key, key, NULL) == KVIDX_OK;
+}
+
+/**
+ * Delete all records with keys >= key. For the newest keys this is a
+ * rewind of the log tail.
+ */
+bool kvidxSeglogRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+    return removeKeys(i, key, UINT64_MAX, NULL) == KVIDX_OK;
+}
+
+/**
+ * Delete all records with keys <= key, unlinking head segments left with
+ * no live records.
+ */
+bool kvidxSeglogRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
+    return removeKeys(i, 0, key, NULL) == KVIDX_OK;
+}
+
+bool kvidxSeglogFsync(kvidxInstance *i) {
+    return syncSegments(STATE(i));
+}
+
+/* ====================================================================
+ * Bring-Up / Teardown
+ * ==================================================================== */
+
+static int compareIds(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Collect the ids of all segment files in the directory, sorted.
+ */
+static bool listSegments(seglogState *s, uint64_t **ids, size_t *count) {
+    DIR *d = opendir(s->dirPath);
+    if (!d) {
+        return false;
+    }
+
+    size_t cap = 16;
+    size_t n = 0;
+    uint64_t *list = malloc(cap * sizeof(*list));
+    if (!list) {
+        closedir(d);
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        const char *name = entry->d_name;
+        if (strlen(name) != 20 || strcmp(name + 16, ".seg") != 0) {
+            continue;
+        }
+
+        char *end;
+        uint64_t id = strtoull(name, &end, 16);
+        if (end != name + 16) {
+            continue;
+        }
+
+        if (n == cap) {
+            cap *= 2;
+            uint64_t *grown = realloc(list, cap * sizeof(*list));
+            if (!grown) {
+                free(list);
+                closedir(d);
+                return false;
+            }
+            list = grown;
+        }
+        list[n++] = id;
+    }
+
+    closedir(d);
+    qsort(list, n, sizeof(*list), compareIds);
+    *ids = list;
+    *count = n;
+    return true;
+}
+
+/**
+ * Open and map every existing segment, oldest first.
+ */
+static bool loadSegments(kvidxInstance *i, const char **errStr) {
+    seglogState *s = STATE(i);
+    uint64_t *ids;
+    size_t count;
+
+    if (!listSegments(s, &ids, &count)) {
+        *errStr = "Failed to list seglog directory";
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t n = 0; n < count && ok; n++) {
+        if (n > 0 && ids[n] != ids[n - 1] + 1) {
+            *errStr = "Seglog segment sequence has a gap";
+            ok = false;
+            break;
+        }
+
+        if (!reserveSegmentSlot(s)) {
+            *errStr = "Memory allocation failed";
+            ok = false;
+            break;
+        }
+
+        char path[4096];
+        segmentPath(s, ids[n], path, sizeof(path));
+
+        seglogSegment seg = {.id = ids[n]};
+        seg.fd = open(path, O_RDWR);
+        struct stat st;
+        if (seg.fd < 0 || fstat(seg.fd, &st) != 0 ||
+            (uint64_t)st.st_size < SEGMENT_MIN_BYTES ||
+            (uint64_t)st.st_size > SEGMENT_MAX_BYTES) {
+            *errStr = "Failed to open seglog segment";
+            if (seg.fd >= 0) {
+                close(seg.fd);
+            }
+            ok = false;
+            break;
+        }
+
+        seg.size = (uint64_t)st.st_size;
+        if (!mapSegment(&seg)) {
+            *errStr = "Failed to map seglog segment";
+            close(seg.fd);
+            ok = false;
+            break;
+        }
+
+        segmentHeader header;
+        memcpy(&header, seg.map, sizeof(header));
+        if (header.magic == 0 && n == count - 1) {
+            /* Crashed between creating the newest segment and stamping it */
+            header = (segmentHeader){.magic = SEGMENT_MAGIC,
+                                     .version = SEGMENT_VERSION,
+                                     .id = seg.id};
+            memcpy(seg.map, &header, sizeof(header));
+            seg.dirty = true;
+        } else if (header.magic != SEGMENT_MAGIC ||
+                   header.version != SEGMENT_VERSION || header.id != seg.id) {
+            *errStr = "Invalid seglog segment header";
+            munmap(seg.map, seg.size);
+            close(seg.fd);
+            ok = false;
+            break;
+        }
+
+        seg.used = SEGMENT_DATA_START;
+        s->segs[s->segCount++] = seg;
+    }
+
+    free(ids);
+    return ok;
+}
+
+static void freeState(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+
+    while (s->segCount) {
+        dropSegment(s, s->segCount - 1, false);
+    }
+
+    if (s->dirFd >= 0) {
+        close(s->dirFd); /* Releases the flock */
+    }
+
+    free(s->segs);
+    free(s->index);
+    free(s->dirPath);
+    free(i->kvidxdata);
+    i->kvidxdata = NULL;
+}
+
+static void applySettings(seglogState *s, const kvidxConfig *config) {
+    s->segmentBytes = DEFAULT_SEGMENT_BYTES;
+    if (config->seglogSegmentBytes) {
+        s->segmentBytes = config->seglogSegmentBytes;
+        if (s->segmentBytes < SEGMENT_MIN_BYTES) {
+            s->segmentBytes = SEGMENT_MIN_BYTES;
+        } else if (s->segmentBytes > SEGMENT_MAX_BYTES) {
+            s->segmentBytes = SEGMENT_MAX_BYTES;
+        }
+    }
+
+    s->syncCommits = config->syncMode == KVIDX_SYNC_FULL ||
+                     config->syncMode == KVIDX_SYNC_EXTRA;
+}
+
+/**
+ * Open or create a seglog-backed kvidx database.
+ *
+ * The path is a directory of segment files, created if missing. The
+ * directory is flock()ed for the lifetime of the instance so a second
+ * process can't append to the same log. Existing segments are mapped and
+ * replayed to rebuild the index; an empty directory gets its first segment.
+ */
+bool kvidxSeglogOpen(kvidxInstance *i, const char *filename,
+                     const char **errStr) {
+    const char *localErr = NULL;
+    if (!errStr) {
+        errStr = &localErr;
+    }
+
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        if (mkdir(filename, 0755) != 0) {
+            *errStr = "Failed to create seglog directory";
+            return false;
+        }
+    } else if (!S_ISDIR(st.st_mode)) {
+        *errStr = "Seglog path exists but is not a directory";
+        return false;
+    }
+
+    i->kvidxdata = calloc(1, sizeof(seglogState));
+    if (!i->kvidxdata) {
+        *errStr = "Memory allocation failed";
+        return false;
+    }
+
+    seglogState *s = STATE(i);
+    s->dirFd = -1;
+    s->dirPath = strdup(filename);
+    if (!s->dirPath) {
+        *errStr = "Memory allocation failed";
+        freeState(i);
+        return false;
+    }
+
+    kvidxConfig defaults = kvidxConfigDefault();
+    applySettings(s, i->configInitialized ? &i->config : &defaults);
+
+    s->dirFd = open(filename, O_RDONLY);
+    if (s->dirFd < 0) {
+        *errStr = "Failed to open seglog directory";
+        freeState(i);
+        return false;
+    }
+
+    if (flock(s->dirFd, LOCK_EX | LOCK_NB) != 0) {
+        *errStr = "Seglog directory is locked by another process";
+        freeState(i);
+        return false;
+    }
+
+    if (!loadSegments(i, errStr)) {
+        freeState(i);
+        return false;
+    }
+
+    if (s->segCount == 0 && !addSegment(i, s->segmentBytes)) {
+        *errStr = "Failed to create first seglog segment";
+        freeState(i);
+        return false;
+    }
+
+    if (!replayLog(i)) {
+        *errStr = "Failed to rebuild seglog index";
+        freeState(i);
+        return false;
+    }
+
+    /* Call custom init if provided */
+    if (i->customInit) {
+        i->customInit(i);
+    }
+
+    return true;
+}
+
+/**
+ * Close a seglog-backed kvidx database. An open transaction is discarded
+ * (its records are dropped again on the next replay).
+ *
+ * IMPORTANT: All data pointers returned from Get() become invalid after close.
+ */
+bool kvidxSeglogClose(kvidxInstance *i) {
+    seglogState *s = STATE(i);
+    if (!s) {
+        return true;
+    }
+
+    if (s->inTxn) {
+        kvidxSeglogAbort(i);
+    }
+
+    freeState(i);
+    return true;
+}
+
+/* ====================================================================
+ * Statistics Implementation
+ * ==================================================================== */
+
+/**
+ * Get the number of records. O(1): the index is the live set.
+ */
+kvidxError kvidxSeglogGetKeyCount(kvidxInstance *i, uint64_t *count) {
+    seglogState *s = STATE(i);
+    if (!s || !count) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    *count = s->indexCount;
+    return KVIDX_OK;
+}
+
+kvidxError kvidxSeglogGetMinKey(kvidxInstance *i, uint64_t *key) {
+    seglogState *s = STATE(i);
+    if (!s || !key) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (s->indexCount == 0) {
+        return KVIDX_ERROR_NOT_FOUND;
+    }
+
+    *key = ENTRIES(s)[0].key;
+    return KVIDX_OK;
+}
+
+/**
+ * Get the total size of all live data blobs. O(1): maintained as records
+ * enter and leave the index.
+ */
+kvidxError kvidxSeglogGetDataSize(kvidxInstance *i, uint64_t *bytes) {
+    seglogState *s = STATE(i);
+    if (!s || !bytes) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    *bytes = s->dataBytes;
+    return KVIDX_OK;
+}
+
+/**
+ * Get database statistics. databaseFileSize is the preallocated size of
+ * all segments; pageCount/pageSize report segments and the configured
+ * segment size.
+ */
+kvidxError kvidxSeglogGetStats(kvidxInstance *i, kvidxStats *stats) {
+    seglogState *s = STATE(i);
+    if (!s || !stats) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+
+    stats->totalKeys = s->indexCount;
+    stats->totalDataBytes = s->dataBytes;
+    if (s->indexCount) {
+        stats->minKey = ENTRIES(s)[0].key;
+        stats->maxKey = ENTRIES(s)[s->indexCount - 1].key;
+    }
+
+    for (size_t n = 0; n < s->segCount; n++) {
+        stats->databaseFileSize += s->segs[n].size;
+    }
+    stats->pageCount = s->segCount;
+    stats->pageSize = s->segmentBytes;
+
+    return KVIDX_OK;
+}
+
+/* ====================================================================
+ * Range Operations Implementation
+ * ==================================================================== */
+
+kvidxError kvidxSeglogRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount) {
+    if (!STATE(i)) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((!startInclusive && startKey == UINT64_MAX) ||
+        (!endInclusive && endKey == 0)) {
+        if (deletedCount) {
+            *deletedCount = 0;
+        }
+        return KVIDX_OK;
+    }
+
+    uint64_t lo = startInclusive ? startKey : startKey + 1;
+    uint64_t hi = endInclusive ? endKey : endKey - 1;
+    return removeKeys(i, lo, hi, deletedCount);
+}
+
+kvidxError kvidxSeglogCountRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, uint64_t *count) {
+    seglogState *s = STATE(i);
+    if (!s || !count) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    *count = 0;
+    if (startKey <= endKey) {
+        *count = indexUpperBound(s, endKey) - indexLowerBound(s, startKey);
+    }
+    return KVIDX_OK;
+}
+
+kvidxError kvidxSeglogExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool *exists) {
+    seglogState *s = STATE(i);
+    if (!s || !exists) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    size_t at = indexLowerBound(s, startKey);
+    *exists = at < s->indexCount && ENTRIES(s)[at].key <= endKey;
+    return KVIDX_OK;
+}
+
+/* ====================================================================
+ * Configuration
+ * ==================================================================== */
+
+/**
+ * Segment size applies to segments created from now on; existing segments
+ * keep their size. syncMode FULL/EXTRA turns on msync() per commit.
+ */
+kvidxError kvidxSeglogApplyConfig(kvidxInstance *i,
+                                  const kvidxConfig *config) {
+    seglogState *s = STATE(i);
+    if (!s || !config) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    applySettings(s, config);
+    return KVIDX_OK;
+}
+
+/* ====================================================================
+ * Storage Primitives
+ * ====================================================================
+ * Every primitive is a read of the index followed by at most one record
+ * append (or removal), so each is atomic without a transaction of its own.
+ * Rewriting a key's data keeps its expiry; setting a value outright
+ * (InsertEx, GetAndSet, CompareAndSwap) clears it, as with LMDB.
+ */
+
+static uint64_t currentTimeMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * Copy a record's data to a malloc'd buffer (NULL for empty data).
+ */
+static kvidxError copyData(const seglogRecord *rec, void **out, size_t *len) {
+    if (out) {
+        *out = NULL;
+        if (rec->dataLen > 0) {
+            *out = malloc(rec->dataLen);
+            if (!*out) {
+                return KVIDX_ERROR_NOMEM;
+            }
+            memcpy(*out, recordData(rec), rec->dataLen);
+        }
+    }
+    if (len) {
+        *len = rec->dataLen;
+    }
+    return KVIDX_OK;
+}
+
+/* --- Conditional Writes --- */
+
+kvidxError kvidxSeglogInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition) {
+    bool exists = indexFind(STATE(i), key, NULL) != NULL;
+
+    switch (condition) {
+    case KVIDX_SET_ALWAYS:
+        break;
+    case KVIDX_SET_IF_NOT_EXISTS:
+        if (exists) {
+            return KVIDX_ERROR_CONDITION_FAILED;
+        }
+        break;
+    case KVIDX_SET_IF_EXISTS:
+        if (!exists) {
+            return KVIDX_ERROR_CONDITION_FAILED;
+        }
+        break;
+    default:
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    return putRecord(i, key, term, cmd, 0, data, dataLen);
+}
+
+/* --- Atomic Operations --- */
+
+kvidxError kvidxSeglogGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen) {
+    seglogState *s = STATE(i);
+
+    /* Initialize all outputs */
+    if (oldTerm) {
+        *oldTerm = 0;
+    }
+    if (oldCmd) {
+        *oldCmd = 0;
+    }
+    if (oldData) {
+        *oldData = NULL;
+    }
+    if (oldDataLen) {
+        *oldDataLen = 0;
+    }
+
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (e) {
+        const seglogRecord *rec = entryRecord(s, e);
+        if (oldTerm) {
+            *oldTerm = rec->term;
+        }
+        if (oldCmd) {
+            *oldCmd = rec->cmd;
+        }
+        if (copyData(rec, oldData, oldDataLen) != KVIDX_OK) {
+            return KVIDX_ERROR_NOMEM;
+        }
+    }
+
+    kvidxError result = putRecord(i, key, term, cmd, 0, data, dataLen);
+    if (result != KVIDX_OK && oldData) {
+        free(*oldData);
+        *oldData = NULL;
+    }
+    return result;
+}
+
+kvidxError kvidxSeglogGetAndRemove(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen) {
+    seglogState *s = STATE(i);
+
+    /* Initialize outputs */
+    if (data) {
+        *data = NULL;
+    }
+    if (dataLen) {
+        *dataLen = 0;
+    }
+
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return KVIDX_ERROR_NOT_FOUND;
+    }
+
+    const seglogRecord *rec = entryRecord(s, e);
+    if (term) {
+        *term = rec->term;
+    }
+    if (cmd) {
+        *cmd = rec->cmd;
+    }
+    if (copyData(rec, data, dataLen) != KVIDX_OK) {
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    kvidxError result = removeKeys(i, key, key, NULL);
+    if (result != KVIDX_OK && data) {
+        free(*data);
+        *data = NULL;
+    }
+    return result;
+}
+
+/* --- Compare-And-Swap --- */
+
+kvidxError kvidxSeglogCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped) {
+    seglogState *s = STATE(i);
+    *swapped = false;
+
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return KVIDX_ERROR_NOT_FOUND;
+    }
+
+    const seglogRecord *rec = entryRecord(s, e);
+    size_t currentLen = rec->dataLen;
+
+    bool matches = false;
+    if (expectedData == NULL && currentLen == 0) {
+        matches = true;
+    } else if (expectedLen == currentLen) {
+        matches = expectedLen == 0 ||
+                  (expectedData &&
+                   memcmp(expectedData, recordData(rec), expectedLen) == 0);
+    }
+
+    if (!matches) {
+        return KVIDX_OK;
+    }
+
+    kvidxError result =
+        putRecord(i, key, newTerm, newCmd, 0, newData, newDataLen);
+    *swapped = result == KVIDX_OK;
+    return result;
+}
+
+/* --- Append/Prepend --- */
+
+/**
+ * Rewrite key with data spliced around or into its current value.
+ *
+ * The new value is: current[0, keepBefore) + data + current[keepFrom, end),
+ * zero-filling any gap when keepBefore exceeds the current length.
+ * SPLICE_END stands for the current length. A
+ * missing key is created with (term, cmd) when create is set.
+ */
+#define SPLICE_END SIZE_MAX
+
+static kvidxError spliceValue(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, size_t keepBefore,
+                              size_t keepFrom, const void *data,
+                              size_t dataLen, bool create, size_t *newLen) {
+    seglogState *s = STATE(i);
+    const seglogEntry *e = indexFind(s, key, NULL);
+
+    if (!e) {
+        if (!create) {
+            return KVIDX_ERROR_NOT_FOUND;
+        }
+
+        kvidxError result = putRecord(i, key, term, cmd, 0, data, dataLen);
+        if (result == KVIDX_OK && newLen) {
+            *newLen = dataLen;
+        }
+        return result;
+    }
+
+    const seglogRecord *rec = entryRecord(s, e);
+    const uint8_t *current = recordData(rec);
+    size_t currentLen = rec->dataLen;
+    if (keepBefore == SPLICE_END) {
+        keepBefore = currentLen;
+    }
+    if (keepFrom == SPLICE_END) {
+        keepFrom = currentLen;
+    }
+
+    size_t tailLen = keepFrom < currentLen ? currentLen - keepFrom : 0;
+    size_t total = keepBefore + dataLen + tailLen;
+
+    uint8_t *combined = calloc(1, total ? total : 1);
+    if (!combined) {
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    memcpy(combined, current, keepBefore < currentLen ? keepBefore
+                                                      : currentLen);
+    if (dataLen > 0 && data) {
+        memcpy(combined + keepBefore, data, dataLen);
+    }
+    if (tailLen) {
+        memcpy(combined + keepBefore + dataLen, current + keepFrom, tailLen);
+    }
+
+    kvidxError result = putRecord(i, key, rec->term, rec->cmd, rec->expiresAt,
+                                  combined, total);
+    free(combined);
+
+    if (result == KVIDX_OK && newLen) {
+        *newLen = total;
+    }
+    return result;
+}
+
+kvidxError kvidxSeglogAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen) {
+    return spliceValue(i, key, term, cmd, SPLICE_END, SPLICE_END, data, dataLen,
+                       true, newLen);
+}
+
+kvidxError kvidxSeglogPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen) {
+    return spliceValue(i, key, term, cmd, 0, 0, data, dataLen, true, newLen);
+}
+
+/* --- Partial Value Access --- */
+
+kvidxError kvidxSeglogGetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, size_t length, void **data,
+                                    size_t *actualLen) {
+    seglogState *s = STATE(i);
+
+    /* Initialize outputs */
+    if (data) {
+        *data = NULL;
+    }
+    if (actualLen) {
+        *actualLen = 0;
+    }
+
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return KVIDX_ERROR_NOT_FOUND;
+    }
+
+    const seglogRecord *rec = entryRecord(s, e);
+    if (offset >= rec->dataLen) {
+        return KVIDX_OK;
+    }
+
+    /* Calculate bytes to return (length=0 means read to end) */
+    size_t available = rec->dataLen - offset;
+    size_t toReturn = (length == 0 || length > available) ? available : length;
+
+    if (data) {
+        *data = malloc(toReturn);
+        if (!*data) {
+            return KVIDX_ERROR_NOMEM;
+        }
+        memcpy(*data, recordData(rec) + offset, toReturn);
+    }
+
+    if (actualLen) {
+        *actualLen = toReturn;
+    }
+    return KVIDX_OK;
+}
+
+kvidxError kvidxSeglogSetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen) {
+    return spliceValue(i, key, 0, 0, offset, offset + dataLen, data, dataLen,
+                       false, newLen);
+}
+
+/* --- TTL/Expiration --- */
+
+/**
+ * Rewrite key's record with a new expiry (0 = none).
+ */
+static kvidxError setExpiry(kvidxInstance *i, uint64_t key,
+                            uint64_t expiresAt) {
+    seglogState *s = STATE(i);
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return KVIDX_ERROR_NOT_FOUND;
+    }
+
+    const seglogRecord *rec = entryRecord(s, e);
+    if (rec->expiresAt == expiresAt) {
+        return KVIDX_OK;
+    }
+
+    return putRecord(i, key, rec->term, rec->cmd, expiresAt, recordData(rec),
+                     rec->dataLen);
+}
+
+kvidxError kvidxSeglogSetExpire(kvidxInstance *i, uint64_t key,
+                                uint64_t ttlMs) {
+    return setExpiry(i, key, currentTimeMs() + ttlMs);
+}
+
+kvidxError kvidxSeglogSetExpireAt(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs) {
+    /* 0 means "no expiry" in the record; epoch 0 and 1ms are equally past */
+    return setExpiry(i, key, timestampMs ? timestampMs : 1);
+}
+
+int64_t kvidxSeglogGetTTL(kvidxInstance *i, uint64_t key) {
+    seglogState *s = STATE(i);
+    const seglogEntry *e = indexFind(s, key, NULL);
+    if (!e) {
+        return KVIDX_TTL_NOT_FOUND;
+    }
+
+    uint64_t expiresAt = entryRecord(s, e)->expiresAt;
+    if (!expiresAt) {
+        return KVIDX_TTL_NONE;
+    }
+
+    uint64_t now = currentTimeMs();
+    return expiresAt <= now ? 0 : (int64_t)(expiresAt - now);
+}
+
+kvidxError kvidxSeglogPersist(kvidxInstance *i, uint64_t key) {
+    return setExpiry(i, key, 0);
+}
+
+/**
+ * Remove expired keys, at most maxKeys of them (0 = no limit).
+ *
+ * Returns immediately when no live key carries an expiry; otherwise walks
+ * the index reading expiries from the record headers.
+ */
+kvidxError kvidxSeglogExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount) {
+    seglogState *s = STATE(i);
+    uint64_t expired = 0;
+
+    if (expiredCount) {
+        *expiredCount = 0;
+    }
+
+    if (s->expiringKeys == 0) {
+        return KVIDX_OK;
+    }
+
+    uint64_t now = currentTimeMs();
+    size_t n = 0;
+    while (n < s->indexCount && (maxKeys == 0 || expired < maxKeys)) {
+        const seglogEntry *e = &ENTRIES(s)[n];
+        uint64_t expiresAt = entryRecord(s, e)->expiresAt;
+
+        if (!expiresAt || expiresAt > now) {
+            n++;
+            continue;
+        }
+
+        /* Removal shifts the following entries down into slot n */
+        const uint64_t key = e->key;
+        kvidxError result = removeKeys(i, key, key, NULL);
+        if (result != KVIDX_OK) {
+            return result;
+        }
+        kvidxChangeNoteExpired(i, key);
+        expired++;
+    }
+
+    if (expiredCount) {
+        *expiredCount = expired;
+    }
+    return KVIDX_OK;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "kvidxkit.h"
+__BEGIN_DECLS
+
+/* Open / Close / Management */
+bool kvidxSeglogOpen(kvidxInstance *i, const char *filename, const char **err);
+bool kvidxSeglogClose(kvidxInstance *i);
+bool kvidxSeglogFsync(kvidxInstance *i);
+
+/* Transactional Control */
+bool kvidxSeglogBegin(kvidxInstance *i);
+bool kvidxSeglogCommit(kvidxInstance *i);
+
+/* Reading */
+bool kvidxSeglogGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                    uint64_t *cmd, const uint8_t **data, size_t *len);
+bool kvidxSeglogGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
+                        uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                        size_t *len);
+bool kvidxSeglogGetNext(kvidxInstance *i, uint64_t previousKey,
+                        uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
+                        const uint8_t **data, size_t *len);
+bool kvidxSeglogExists(kvidxInstance *i, uint64_t key);
+bool kvidxSeglogExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
+bool kvidxSeglogMax(kvidxInstance *i, uint64_t *key);
+bool kvidxSeglogInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen);
+
+/* Deleting */
+bool kvidxSeglogRemove(kvidxInstance *i, uint64_t key);
+bool kvidxSeglogRemoveAfterNInclusive(kvidxInstance *i, uint64_t key);
+bool kvidxSeglogRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key);
+
+/* Statistics */
+kvidxError kvidxSeglogGetStats(kvidxInstance *i, kvidxStats *stats);
+kvidxError kvidxSeglogGetKeyCount(kvidxInstance *i, uint64_t *count);
+kvidxError kvidxSeglogGetMinKey(kvidxInstance *i, uint64_t *key);
+kvidxError kvidxSeglogGetDataSize(kvidxInstance *i, uint64_t *bytes);
+
+/* Configuration */
+kvidxError kvidxSeglogApplyConfig(kvidxInstance *i, const kvidxConfig *config);
+
+/* Range Operations */
+kvidxError kvidxSeglogRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount);
+kvidxError kvidxSeglogCountRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, uint64_t *count);
+kvidxError kvidxSeglogExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool *exists);
+
+/* Storage Primitives */
+/* Conditional writes */
+kvidxError kvidxSeglogInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition);
+
+/* Transaction abort */
+bool kvidxSeglogAbort(kvidxInstance *i);
+
+/* Atomic operations */
+kvidxError kvidxSeglogGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen);
+kvidxError kvidxSeglogGetAndRemove(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen);
+
+/* Compare-and-swap */
+kvidxError kvidxSeglogCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped);
+
+/* Append/Prepend */
+kvidxError kvidxSeglogAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen);
+kvidxError kvidxSeglogPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen);
+
+/* Partial value access */
+kvidxError kvidxSeglogGetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, size_t length, void **data,
+                                    size_t *actualLen);
+kvidxError kvidxSeglogSetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen);
+
+/* TTL/Expiration */
+kvidxError kvidxSeglogSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs);
+kvidxError kvidxSeglogSetExpireAt(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs);
+int64_t kvidxSeglogGetTTL(kvidxInstance *i, uint64_t key);
+kvidxError kvidxSeglogPersist(kvidxInstance *i, uint64_t key);
+kvidxError kvidxSeglogExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount);
+
+__END_DECLS
@@ -37,19 +37,99 @@
  * - The "unix-excl" VFS is used for single-process efficiency
  * - Cache size defaults to 32MB for better read performance
  * - Batch operations in transactions avoid per-write fsync overhead
+ * - Optionally, a background thread checkpoints the WAL so commits never
+ *   pay for an inline auto-checkpoint (see WAL Checkpointing)
+ * - New databases use incremental auto_vacuum, so space freed by removes
+ *   can be returned in steps (see Incremental Vacuum)
  */
 
+/* Required for clock_gettime and pthread_cond_timedwait under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
 #include "kvidxkitAdapterSqlite3.h"
 #include "../deps/sqlite3/src/sqlite3.h"
 #include "kvidxkitSchema.h"
 #include "kvidxkitTableDesc.h"
+#include "kvidxkit_internal.h"
 
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 
+/** Default write-idle time before a PASSIVE background checkpoint */
+#define DEFAULT_CHECKPOINT_IDLE_MS 100
+
+/** Default WAL size that forces a TRUNCATE checkpoint: 64 MB */
+#define DEFAULT_WAL_SIZE_LIMIT (64ULL << 20)
+
+/** How long a TRUNCATE checkpoint waits for readers and writers */
+#define CHECKPOINT_BUSY_TIMEOUT_MS 50
+
+/** SQLite's built-in wal_autocheckpoint threshold, in pages */
+#define DEFAULT_WAL_AUTOCHECKPOINT 1000
+
+/** Pages copied per backup step for replication (sqliteBackupPagesPerStep) */
+#define DEFAULT_BACKUP_PAGES_PER_STEP 1024
+
+/** Wait before retrying a backup step another connection has locked */
+#define BACKUP_BUSY_SLEEP_MS 5
+
+/** Give up on a backup that stays locked this long without progress */
+#define BACKUP_BUSY_TIMEOUT_MS 10000
+
+/** Name of the database file in a replication stream */
+#define REPLICATION_FILE "kvidx.sqlite3"
+
+/** Pages freed per background vacuum step (reclaimPagesPerStep) */
+#define DEFAULT_VACUUM_PAGES_PER_STEP 1024
+
+/** PRAGMA auto_vacuum value of an incrementally vacuumed database */
+#define AUTO_VACUUM_INCREMENTAL 2
+
+/**
+ * Background WAL checkpointer state.
+ *
+ * The checkpointer owns a second connection to the same database file so
+ * checkpoints never contend for the main connection's mutex. Commits on the
+ * main connection report WAL growth through sqlite3_wal_hook(); the thread
+ * sleeps until writes go idle (PASSIVE) or the WAL passes its size cap
+ * (TRUNCATE).
+ */
+typedef struct kas3Checkpointer {
+    sqlite3 *db;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool stop;
+
+    /* Settings (read-only while the thread runs) */
+    uint64_t idleMs;
+    uint64_t walSizeLimit;
+    uint64_t pageSize;
+    uint64_t vacuumPages; /* Pages per idle vacuum step, 0 = no vacuum */
+
+    /* Updated by the main connection's WAL hook */
+    uint64_t commitSeq;
+    uint64_t lastCommitMs;
+    uint64_t walPages;
+
+    /* Updated by the checkpointer thread */
+    uint64_t checkpointedSeq;
+    uint64_t checkpointCount;
+    uint64_t lastCheckpointMicros;
+    uint64_t maxCheckpointMicros;
+    uint64_t pagesVacuumed;
+} kas3Checkpointer;
+
 /**
  * Internal state for SQLite3 adapter instance.
  *
@@ -74,10 +154,47 @@ typedef struct kas3State {
     sqlite3_stmt *maxKey;
     sqlite3_stmt *removeAfterNInclusive;
     sqlite3_stmt *removeBeforeNInclusive;
+
+    /* Open parameters, reused by the checkpointer connection */
+    const char *vfs;
+    char *walPath; /* NULL for in-memory/temporary databases */
+    kas3Checkpointer *checkpointer; /* NULL unless running */
+    uint64_t pagesVacuumed;         /* By checkpointers already stopped */
+
+    bool ttlTableReady; /* _kvidx_ttl exists in this database */
+
+    /* Value checksums */
+    bool crcColumn;       /* log has a crc column (statements include it) */
+    bool writeChecksums;  /* kvidxConfig.valueChecksums */
+    bool verifyChecksums; /* kvidxConfig.verifyChecksums */
+
+    /* Work counters (see kvidxSqlite3IoCounters()) */
+    int64_t pageSize;       /* Of the main database, read at open */
+    uint64_t stmtsPrepared; /* By prepareStatement() */
+    uint64_t transactions;  /* Commits and rollbacks, from the hooks */
 } kas3State;
 
 #define STATE(instance) ((kas3State *)(instance)->kvidxdata)
 
+/* sqlite3_prepare_v2() on the instance's connection, counted for
+ * kvidxIoCounters.stmtsPrepared. The sqlite__prepare probe maps the
+ * statement handle that sqlite__step probes report back to its SQL. */
+static int prepareStatement(kas3State *s, const char *sql, int len,
+                            sqlite3_stmt **stmt) {
+    s->stmtsPrepared++;
+    const int rc = sqlite3_prepare_v2(s->db, sql, len, stmt, NULL);
+    KVIDX_PROBE3(sqlite__prepare, *stmt, sql, rc);
+    return rc;
+}
+
+/* sqlite3_step() between the sqlite__step__start/done probes */
+static int stepStatement(sqlite3_stmt *stmt) {
+    KVIDX_PROBE1(sqlite__step__start, stmt);
+    const int rc = sqlite3_step(stmt);
+    KVIDX_PROBE2(sqlite__step__done, stmt, rc);
+    return rc;
+}
+
 static const char *stmtBegin = "BEGIN;";
 static const char *stmtCommit = "COMMIT;";
 static const char *stmtGet = "SELECT term, cmd, data FROM log WHERE id = ?;";
@@ -94,6 +211,17 @@ static const char *stmtMaxId = "SELECT MAX(id) FROM log;";
 static const char *stmtRemoveAfterNInclusive = "DELETE FROM log WHERE id >= ?";
 static const char *stmtRemoveBeforeNInclusive = "DELETE FROM log WHERE id <= ?";
 
+/* Variants used once log has a crc column. kvidx_crc32c() yields NULL
+ * while kvidxConfig.valueChecksums is off. */
+static const char *stmtGetCrc =
+    "SELECT term, cmd, data, crc FROM log WHERE id = ?;";
+static const char *stmtGetPrevCrc = "SELECT id, term, cmd, data, crc FROM "
+                                    "log WHERE id < ? ORDER BY id DESC LIMIT 1;";
+static const char *stmtGetNextCrc = "SELECT id, term, cmd, data, crc FROM "
+                                    "log WHERE id > ? ORDER BY id ASC LIMIT 1;";
+static const char *stmtInsertCrc =
+    "INSERT INTO log VALUES(?1, ?2, ?3, ?4, ?5, kvidx_crc32c(?3, ?4, ?5));";
+
 /* ====================================================================
  * Data Manipulation
  * ==================================================================== */
@@ -146,6 +274,70 @@ static bool extractBlob(sqlite3_stmt *stmt, uint8_t col, const uint8_t **data,
     return true;
 }
 
+/**
+ * Check a row's stored checksum against its term, cmd and data.
+ *
+ * @param stmt     Statement with a row ready whose columns termCol..+3 are
+ *                 term, cmd, data, crc
+ * @param termCol  Column index of term
+ * @return true if the checksum matches or the row has none
+ */
+static bool rowChecksumMatches(sqlite3_stmt *stmt, int termCol) {
+    if (sqlite3_column_type(stmt, termCol + 3) == SQLITE_NULL) {
+        return true;
+    }
+
+    const void *data = sqlite3_column_blob(stmt, termCol + 2);
+    const size_t len = (size_t)sqlite3_column_bytes(stmt, termCol + 2);
+    const uint32_t crc = kvidxValueChecksum(
+        (uint64_t)sqlite3_column_int64(stmt, termCol),
+        (uint64_t)sqlite3_column_int64(stmt, termCol + 1), data, len);
+    return (uint32_t)sqlite3_column_int64(stmt, termCol + 3) == crc;
+}
+
+/**
+ * Fail a read whose row doesn't match its checksum.
+ *
+ * Only checks when kvidxConfig.verifyChecksums is set and log has a crc
+ * column (in which case the cached read statements select it last).
+ *
+ * @param i        The kvidx instance
+ * @param stmt     Statement with a row ready
+ * @param termCol  Column index of term
+ * @param key      Key of the row, for the error message
+ * @return true if the row may be returned
+ */
+static bool verifyRow(kvidxInstance *i, sqlite3_stmt *stmt, int termCol,
+                      uint64_t key) {
+    const kas3State *s = STATE(i);
+    if (!s->verifyChecksums || !s->crcColumn ||
+        rowChecksumMatches(stmt, termCol)) {
+        return true;
+    }
+
+    sqlite3_reset(stmt);
+    kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                  "Value of key %" PRIu64 " fails its checksum", key);
+    return false;
+}
+
+/**
+ * Reset the cached read statements.
+ *
+ * Get/GetPrev/GetNext leave their statement un-reset so the returned data
+ * pointer stays valid, which also keeps a WAL read snapshot open. A pinned
+ * snapshot stops any checkpoint from backfilling past it, so the WAL could
+ * never be reset. Data pointers are only valid until the next operation, so
+ * write paths release the snapshot here.
+ *
+ * @param s  The internal adapter state
+ */
+static void releaseReadSnapshot(kas3State *s) {
+    sqlite3_reset(s->get);
+    sqlite3_reset(s->getPrev);
+    sqlite3_reset(s->getNext);
+}
+
 /**
  * Begin a new database transaction.
  *
@@ -162,7 +354,8 @@ static bool extractBlob(sqlite3_stmt *stmt, uint8_t col, const uint8_t **data,
  */
 bool kvidxSqlite3Begin(kvidxInstance *i) {
     kas3State *s = STATE(i);
-    const bool result = sqlite3_step(s->begin) == SQLITE_DONE;
+    releaseReadSnapshot(s);
+    const bool result = stepStatement(s->begin) == SQLITE_DONE;
     sqlite3_reset(s->begin);
     return result;
 }
@@ -182,8 +375,9 @@ bool kvidxSqlite3Begin(kvidxInstance *i) {
  */
 bool kvidxSqlite3Commit(kvidxInstance *i) {
     kas3State *s = STATE(i);
-    const bool result = sqlite3_step(s->commit) == SQLITE_DONE;
+    const bool result = stepStatement(s->commit) == SQLITE_DONE;
     sqlite3_reset(s->commit);
+    releaseReadSnapshot(s);
     return result;
 }
 
@@ -211,7 +405,7 @@ bool kvidxSqlite3Get(kvidxInstance *i, uint64_t key, uint64_t *term,
     kas3State *s = STATE(i);
     sqlite3_reset(s->get);
     sqlite3_bind_int64(s->get, 1, key);
-    if (sqlite3_step(s->get) == SQLITE_ROW) {
+    if (stepStatement(s->get) == SQLITE_ROW && verifyRow(i, s->get, 0, key)) {
         if (term) {
             *term = sqlite3_column_int64(s->get, 0);
         }
@@ -236,6 +430,7 @@ bool kvidxSqlite3Get(kvidxInstance *i, uint64_t key, uint64_t *term,
  * unlike Get which only returns 3 columns (term, cmd, data) since the key
  * is already known. This helper avoids code duplication.
  *
+ * @param i         The kvidx instance (for checksum verification)
  * @param stmt      The prepared statement (getPrev or getNext)
  * @param lookupId  The reference key for the < or > comparison
  * @param key       OUT: The found key, or NULL if not needed
@@ -245,12 +440,14 @@ bool kvidxSqlite3Get(kvidxInstance *i, uint64_t key, uint64_t *term,
  * @param len       OUT: Length of blob data, or NULL if not needed
  * @return true if a record was found, false otherwise
  */
-static bool fourColumnExtract(sqlite3_stmt *stmt, uint64_t lookupId,
-                              uint64_t *key, uint64_t *term, uint64_t *cmd,
-                              const uint8_t **data, size_t *len) {
+static bool fourColumnExtract(kvidxInstance *i, sqlite3_stmt *stmt,
+                              uint64_t lookupId, uint64_t *key, uint64_t *term,
+                              uint64_t *cmd, const uint8_t **data,
+                              size_t *len) {
     sqlite3_reset(stmt);
     sqlite3_bind_int64(stmt, 1, lookupId);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW &&
+        verifyRow(i, stmt, 1, (uint64_t)sqlite3_column_int64(stmt, 0))) {
         if (key) {
             *key = sqlite3_column_int64(stmt, 0);
         }
@@ -301,7 +498,7 @@ bool kvidxSqlite3GetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
         /* Get the maximum key instead */
         kas3State *s = STATE(i);
         sqlite3_reset(s->maxKey);
-        if (sqlite3_step(s->maxKey) == SQLITE_ROW) {
+        if (stepStatement(s->maxKey) == SQLITE_ROW) {
             if (sqlite3_column_type(s->maxKey, 0) != SQLITE_NULL) {
                 uint64_t maxId = sqlite3_column_int64(s->maxKey, 0);
                 /* Now get the full record for that key */
@@ -312,7 +509,7 @@ bool kvidxSqlite3GetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
         return false;
     }
     kas3State *s = STATE(i);
-    return fourColumnExtract(s->getPrev, nextKey, prevKey, prevTerm, cmd, data,
+    return fourColumnExtract(i, s->getPrev, nextKey, prevKey, prevTerm, cmd, data,
                              len);
 }
 
@@ -344,10 +541,129 @@ bool kvidxSqlite3GetNext(kvidxInstance *i, uint64_t previousKey,
         return false;
     }
     kas3State *s = STATE(i);
-    return fourColumnExtract(s->getNext, previousKey, nextKey, nextTerm, cmd,
+    return fourColumnExtract(i, s->getNext, previousKey, nextKey, nextTerm, cmd,
                              data, len);
 }
 
+/**
+ * Visit every record in [startKey, endKey] in key order.
+ *
+ * Walks one statement instead of issuing a GetNext() query per record.
+ * Data pointers passed to visit are only valid during that call.
+ *
+ * @param i         The kvidx instance
+ * @param startKey  First key of the range (inclusive)
+ * @param endKey    Last key of the range (inclusive)
+ * @param visit     Called per record; return false to stop the scan
+ * @param ctx       Passed through to visit
+ * @return KVIDX_OK when the scan finished or was stopped by visit
+ */
+kvidxError kvidxSqlite3ScanRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, kvidxScanVisitor visit,
+                                 void *ctx) {
+    kas3State *s = STATE(i);
+
+    /* Handle UINT64_MAX specially since it becomes -1 when cast to int64 */
+    char sql[128];
+    snprintf(sql, sizeof(sql),
+             "SELECT id, term, cmd, data%s FROM log WHERE id >= ?%s "
+             "ORDER BY id",
+             s->crcColumn ? ", crc" : "",
+             endKey == UINT64_MAX ? "" : " AND id <= ?");
+
+    sqlite3_stmt *stmt = NULL;
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Failed to prepare scan query: %s",
+                      sqlite3_errmsg(s->db));
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    sqlite3_bind_int64(stmt, 1, startKey);
+    if (endKey != UINT64_MAX) {
+        sqlite3_bind_int64(stmt, 2, endKey);
+    }
+
+    int rc;
+    while ((rc = stepStatement(stmt)) == SQLITE_ROW) {
+        if (!verifyRow(i, stmt, 1, (uint64_t)sqlite3_column_int64(stmt, 0))) {
+            sqlite3_finalize(stmt);
+            return KVIDX_ERROR_CORRUPT;
+        }
+
+        const uint8_t *data = NULL;
+        size_t len = 0;
+        extractBlob(stmt, 3, &data, &len);
+        if (!visit(ctx, sqlite3_column_int64(stmt, 0),
+                   sqlite3_column_int64(stmt, 1),
+                   sqlite3_column_int64(stmt, 2), data, len)) {
+            rc = SQLITE_DONE;
+            break;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? KVIDX_OK : KVIDX_ERROR_IO;
+}
+
+/**
+ * Check the stored checksum of every record in [startKey, endKey].
+ *
+ * Rows written without a checksum (before kvidxConfig.valueChecksums was
+ * set, or with it off) are counted as unchecked.
+ *
+ * @param i         The kvidx instance
+ * @param startKey  First key of the range (inclusive)
+ * @param endKey    Last key of the range (inclusive)
+ * @param result    Counts are added to this
+ * @return KVIDX_OK when the whole range was read
+ */
+kvidxError kvidxSqlite3VerifyRange(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, kvidxVerifyResult *result) {
+    kas3State *s = STATE(i);
+
+    if (!s->crcColumn) {
+        uint64_t count = 0;
+        kvidxError err =
+            kvidxSqlite3CountRange(i, startKey, endKey, &count);
+        result->entriesUnchecked += count;
+        return err;
+    }
+
+    const char *sql =
+        endKey == UINT64_MAX
+            ? "SELECT id, term, cmd, data, crc FROM log WHERE id >= ?"
+            : "SELECT id, term, cmd, data, crc FROM log WHERE id >= ? AND "
+              "id <= ?";
+
+    sqlite3_stmt *stmt = NULL;
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Failed to prepare verify query: %s",
+                      sqlite3_errmsg(s->db));
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    sqlite3_bind_int64(stmt, 1, startKey);
+    if (endKey != UINT64_MAX) {
+        sqlite3_bind_int64(stmt, 2, endKey);
+    }
+
+    int rc;
+    while ((rc = stepStatement(stmt)) == SQLITE_ROW) {
+        if (sqlite3_column_type(stmt, 4) == SQLITE_NULL) {
+            result->entriesUnchecked++;
+        } else if (rowChecksumMatches(stmt, 1)) {
+            result->entriesChecked++;
+        } else if (result->corruptEntries++ == 0) {
+            result->firstCorruptKey = (uint64_t)sqlite3_column_int64(stmt, 0);
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    return rc == SQLITE_DONE ? KVIDX_OK : KVIDX_ERROR_IO;
+}
+
 /**
  * Check if a key exists in the database.
  *
@@ -363,7 +679,7 @@ bool kvidxSqlite3Exists(kvidxInstance *i, uint64_t key) {
     kas3State *s = STATE(i);
     sqlite3_reset(s->exists);
     sqlite3_bind_int64(s->exists, 1, key);
-    sqlite3_step(s->exists);
+    stepStatement(s->exists);
     const bool exists = sqlite3_column_int(s->exists, 0);
     return exists;
 }
@@ -385,7 +701,7 @@ bool kvidxSqlite3ExistsDual(kvidxInstance *i, uint64_t key, uint64_t term) {
     sqlite3_reset(s->existsDual);
     sqlite3_bind_int64(s->existsDual, 1, key);
     sqlite3_bind_int64(s->existsDual, 2, term);
-    sqlite3_step(s->existsDual);
+    stepStatement(s->existsDual);
     const bool exists = sqlite3_column_int(s->existsDual, 0);
     return exists;
 }
@@ -422,13 +738,14 @@ bool kvidxSqlite3Insert(kvidxInstance *i, uint64_t key, uint64_t term,
      * themselves, we can't have max blob size inside our row because that
      * would blow out the max blob size for the row itself). */
     kas3State *s = STATE(i);
+    releaseReadSnapshot(s);
     sqlite3_reset(s->insert);
     sqlite3_bind_int64(s->insert, 1, key);
     sqlite3_bind_int64(s->insert, 2, 0); /* timestamp */
     sqlite3_bind_int64(s->insert, 3, term);
     sqlite3_bind_int64(s->insert, 4, cmd);
     sqlite3_bind_blob64(s->insert, 5, data, dataLen, NULL);
-    int done = sqlite3_step(s->insert);
+    int done = stepStatement(s->insert);
     /* Investigate: why does sqlite3_step sometimes return
      * SQLITE_OK instead of SQLITE_DONE?
      * It only seems to happen when operating on an existing
@@ -453,7 +770,7 @@ bool kvidxSqlite3Remove(kvidxInstance *i, uint64_t key) {
     kas3State *s = STATE(i);
     sqlite3_reset(s->remove);
     sqlite3_bind_int64(s->remove, 1, key);
-    const bool removed = sqlite3_step(s->remove) == SQLITE_DONE;
+    const bool removed = stepStatement(s->remove) == SQLITE_DONE;
     return removed;
 }
 
@@ -472,7 +789,7 @@ bool kvidxSqlite3RemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
     kas3State *s = STATE(i);
     sqlite3_reset(s->removeAfterNInclusive);
     sqlite3_bind_int64(s->removeAfterNInclusive, 1, key);
-    const bool removed = sqlite3_step(s->removeAfterNInclusive) == SQLITE_DONE;
+    const bool removed = stepStatement(s->removeAfterNInclusive) == SQLITE_DONE;
     return removed;
 }
 
@@ -492,7 +809,8 @@ bool kvidxSqlite3RemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
     kas3State *s = STATE(i);
     sqlite3_reset(s->removeBeforeNInclusive);
     sqlite3_bind_int64(s->removeBeforeNInclusive, 1, key);
-    const bool removed = sqlite3_step(s->removeBeforeNInclusive) == SQLITE_DONE;
+    const bool removed =
+        stepStatement(s->removeBeforeNInclusive) == SQLITE_DONE;
     return removed;
 }
 
@@ -509,7 +827,7 @@ bool kvidxSqlite3RemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
 bool kvidxSqlite3Max(kvidxInstance *i, uint64_t *key) {
     kas3State *s = STATE(i);
     sqlite3_reset(s->maxKey);
-    if (sqlite3_step(s->maxKey) == SQLITE_ROW) {
+    if (stepStatement(s->maxKey) == SQLITE_ROW) {
         if (sqlite3_column_type(s->maxKey, 0) == SQLITE_NULL) {
             /* NULL result means we have no keys! */
             return false;
@@ -551,6 +869,32 @@ bool kvidxSqlite3Fsync(kvidxInstance *i) {
  * Bring-Up
  * ==================================================================== */
 
+/* Single integer result of a PRAGMA, or -1 on failure */
+static int64_t pragmaInt64(sqlite3 *db, const char *sql) {
+    int64_t value = -1;
+    sqlite3_stmt *stmt = NULL;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
+            value = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+/* sqlite3_wal_checkpoint_v2() of the main database between the
+ * checkpoint__start/done probes, which report the WAL frames before and
+ * the frames copied back */
+static int checkpointWal(sqlite3 *db, int mode) {
+    int walFrames = 0;
+    int copied = 0;
+    KVIDX_PROBE2(checkpoint__start, db, mode);
+    const int rc = sqlite3_wal_checkpoint_v2(db, NULL, mode, &walFrames,
+                                             &copied);
+    KVIDX_PROBE4(checkpoint__done, db, rc, walFrames, copied);
+    return rc;
+}
+
 /**
  * Configure SQLite performance and behavior options.
  *
@@ -562,6 +906,7 @@ bool kvidxSqlite3Fsync(kvidxInstance *i) {
  * - WAL mode: Concurrent reads during writes, better crash recovery
  * - 32MB cache: Reduced disk I/O for frequently accessed data
  * - Recursive triggers: Enables trigger cascades (if needed)
+ * - Incremental auto_vacuum for new databases (see Incremental Vacuum)
  *
  * @param s  The internal adapter state
  */
@@ -576,6 +921,14 @@ static void configureDBOptions(kas3State *s) {
      * memory instead of shared memory.
      * See: sqlite3_vfs_register() or last argument to sqlite3_open_v2() */
 
+    /* New databases only, before the switch to WAL: on an existing one
+     * the pragma writes the header, contending with other connections. */
+    if (pragmaInt64(s->db, "PRAGMA page_count") == 0) {
+        static const char *vacuum = "PRAGMA auto_vacuum = INCREMENTAL;";
+        int vacuumErr = sqlite3_exec(s->db, vacuum, NULL, NULL, NULL);
+        assert(vacuumErr == SQLITE_OK);
+    }
+
     /* Create keyspace table */
     static const char *wal = "PRAGMA journal_mode = WAL;";
     int walErr = sqlite3_exec(s->db, wal, NULL, NULL, NULL);
@@ -602,6 +955,119 @@ static void configureDBOptions(kas3State *s) {
     /* Compare against using "PRAGMA mmap_size" as well. */
 }
 
+/**
+ * Prepare the statements whose text depends on the crc column.
+ *
+ * Called again after the column is added, since the old statements no
+ * longer match the table.
+ *
+ * @param s  The internal adapter state
+ */
+static void prepareRowStatements(kas3State *s) {
+    const char *get = s->crcColumn ? stmtGetCrc : stmtGet;
+    const char *getPrev = s->crcColumn ? stmtGetPrevCrc : stmtGetPrev;
+    const char *getNext = s->crcColumn ? stmtGetNextCrc : stmtGetNext;
+    const char *insert = s->crcColumn ? stmtInsertCrc : stmtInsert;
+
+    int errGet = prepareStatement(s, get, -1, &s->get);
+    assert(errGet == SQLITE_OK);
+
+    int errGetPrev = prepareStatement(s, getPrev, -1, &s->getPrev);
+    assert(errGetPrev == SQLITE_OK);
+
+    int errGetNext = prepareStatement(s, getNext, -1, &s->getNext);
+    assert(errGetNext == SQLITE_OK);
+
+    int errInsert = prepareStatement(s, insert, -1, &s->insert);
+    assert(errInsert == SQLITE_OK);
+}
+
+/**
+ * SQL function kvidx_crc32c(term, cmd, data): the value checksum, or NULL
+ * while kvidxConfig.valueChecksums is off.
+ */
+static void sqlValueChecksum(sqlite3_context *ctx, int argc,
+                             sqlite3_value **argv) {
+    const kas3State *s = sqlite3_user_data(ctx);
+    (void)argc;
+
+    if (!s->writeChecksums) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    const void *data = sqlite3_value_blob(argv[2]);
+    const size_t len = (size_t)sqlite3_value_bytes(argv[2]);
+    sqlite3_result_int64(
+        ctx, kvidxValueChecksum((uint64_t)sqlite3_value_int64(argv[0]),
+                                (uint64_t)sqlite3_value_int64(argv[1]), data,
+                                len));
+}
+
+static int countCommit(void *userData) {
+    ((kas3State *)userData)->transactions++;
+    return 0; /* Let the commit proceed */
+}
+
+static void countRollback(void *userData) {
+    ((kas3State *)userData)->transactions++;
+}
+
+/**
+ * Read the page size and count transactions for kvidxSqlite3IoCounters().
+ *
+ * @param s  The internal adapter state
+ */
+static void setupIoCounters(kas3State *s) {
+    s->pageSize = pragmaInt64(s->db, "PRAGMA page_size");
+    sqlite3_commit_hook(s->db, countCommit, s);
+    sqlite3_rollback_hook(s->db, countRollback, s);
+}
+
+/**
+ * Register kvidx_crc32c() and note whether log already has a crc column.
+ *
+ * @param s  The internal adapter state
+ */
+static void setupChecksums(kas3State *s) {
+    sqlite3_create_function(s->db, "kvidx_crc32c", 3, SQLITE_UTF8, s,
+                            sqlValueChecksum, NULL, NULL);
+
+    sqlite3_stmt *probe = NULL;
+    s->crcColumn = prepareStatement(s, "SELECT crc FROM log LIMIT 0", -1,
+                                    &probe) == SQLITE_OK;
+    sqlite3_finalize(probe);
+}
+
+/**
+ * Add the crc column to log and re-prepare the statements that use it.
+ *
+ * Existing rows get a NULL crc and are reported as unchecked.
+ *
+ * @param i  The kvidx instance
+ * @return KVIDX_OK on success
+ */
+static kvidxError addChecksumColumn(kvidxInstance *i) {
+    kas3State *s = STATE(i);
+
+    releaseReadSnapshot(s);
+    if (sqlite3_exec(s->db, "ALTER TABLE log ADD COLUMN crc INTEGER", NULL,
+                     NULL, NULL) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Failed to add checksum column: %s",
+                      sqlite3_errmsg(s->db));
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    sqlite3_finalize(s->get);
+    sqlite3_finalize(s->getPrev);
+    sqlite3_finalize(s->getNext);
+    sqlite3_finalize(s->insert);
+    s->crcColumn = true;
+    prepareRowStatements(s);
+    return KVIDX_OK;
+}
+
 /**
  * Prepare all SQL statements used by the adapter.
  *
@@ -617,54 +1083,39 @@ static void configureDBOptions(kas3State *s) {
  * @param s  The internal adapter state
  */
 static void preparePreparedStatements(kas3State *s) {
-    int errBegin = sqlite3_prepare_v2(s->db, stmtBegin, strlen(stmtBegin),
-                                      &s->begin, NULL);
+    int errBegin = prepareStatement(s, stmtBegin, strlen(stmtBegin), &s->begin);
     assert(errBegin == SQLITE_OK);
 
-    int errCommit = sqlite3_prepare_v2(s->db, stmtCommit, strlen(stmtCommit),
-                                       &s->commit, NULL);
+    int errCommit =
+        prepareStatement(s, stmtCommit, strlen(stmtCommit), &s->commit);
     assert(errCommit == SQLITE_OK);
 
-    int errGet =
-        sqlite3_prepare_v2(s->db, stmtGet, strlen(stmtGet), &s->get, NULL);
-    assert(errGet == SQLITE_OK);
-
-    int errGetPrev = sqlite3_prepare_v2(s->db, stmtGetPrev, strlen(stmtGetPrev),
-                                        &s->getPrev, NULL);
-    assert(errGetPrev == SQLITE_OK);
-
-    int errGetNext = sqlite3_prepare_v2(s->db, stmtGetNext, strlen(stmtGetNext),
-                                        &s->getNext, NULL);
-    assert(errGetNext == SQLITE_OK);
+    prepareRowStatements(s);
 
-    int errExists = sqlite3_prepare_v2(s->db, stmtExists, strlen(stmtExists),
-                                       &s->exists, NULL);
+    int errExists =
+        prepareStatement(s, stmtExists, strlen(stmtExists), &s->exists);
     assert(errExists == SQLITE_OK);
 
-    int errExistsDual = sqlite3_prepare_v2(
-        s->db, stmtExistsDual, strlen(stmtExistsDual), &s->existsDual, NULL);
+    int errExistsDual = prepareStatement(
+        s, stmtExistsDual, strlen(stmtExistsDual), &s->existsDual);
     assert(errExistsDual == SQLITE_OK);
 
-    int errInsert = sqlite3_prepare_v2(s->db, stmtInsert, strlen(stmtInsert),
-                                       &s->insert, NULL);
-    assert(errInsert == SQLITE_OK);
-
-    int errRemove = sqlite3_prepare_v2(s->db, stmtRemove, strlen(stmtRemove),
-                                       &s->remove, NULL);
+    int errRemove =
+        prepareStatement(s, stmtRemove, strlen(stmtRemove), &s->remove);
     assert(errRemove == SQLITE_OK);
 
-    int errMaxId = sqlite3_prepare_v2(s->db, stmtMaxId, strlen(stmtMaxId),
-                                      &s->maxKey, NULL);
+    int errMaxId =
+        prepareStatement(s, stmtMaxId, strlen(stmtMaxId), &s->maxKey);
     assert(errMaxId == SQLITE_OK);
 
-    int errNInc = sqlite3_prepare_v2(s->db, stmtRemoveAfterNInclusive,
-                                     strlen(stmtRemoveAfterNInclusive),
-                                     &s->removeAfterNInclusive, NULL);
+    int errNInc = prepareStatement(s, stmtRemoveAfterNInclusive,
+                                   strlen(stmtRemoveAfterNInclusive),
+                                   &s->removeAfterNInclusive);
     assert(errNInc == SQLITE_OK);
 
-    int errBInc = sqlite3_prepare_v2(s->db, stmtRemoveBeforeNInclusive,
-                                     strlen(stmtRemoveBeforeNInclusive),
-                                     &s->removeBeforeNInclusive, NULL);
+    int errBInc = prepareStatement(s, stmtRemoveBeforeNInclusive,
+                                   strlen(stmtRemoveBeforeNInclusive),
+                                   &s->removeBeforeNInclusive);
     assert(errBInc == SQLITE_OK);
 }
 
@@ -779,6 +1230,19 @@ bool kvidxSqlite3Open(kvidxInstance *i, const char *filename,
         return false;
     }
 
+    /* Open is lazy: read the schema so a file that isn't a database fails
+     * here rather than in the setup below */
+    err = sqlite3_exec(db, "SELECT count(*) FROM sqlite_master", NULL, NULL,
+                       NULL);
+    if (err) {
+        if (errStr) {
+            *errStr = sqlite3_errstr(err);
+        }
+
+        sqlite3_close(db);
+        return false;
+    }
+
     i->kvidxdata = calloc(1, sizeof(kas3State));
     if (!i->kvidxdata) {
         return false;
@@ -786,9 +1250,24 @@ bool kvidxSqlite3Open(kvidxInstance *i, const char *filename,
 
     kas3State *s = STATE(i);
     s->db = db;
+    s->vfs = vfs;
+
+    /* In-memory and temporary databases have no WAL file to checkpoint */
+    const char *dbFile = sqlite3_db_filename(db, "main");
+    if (vfs && dbFile && *dbFile) {
+        size_t dbFileLen = strlen(dbFile);
+        s->walPath = malloc(dbFileLen + sizeof("-wal"));
+        if (s->walPath) {
+            memcpy(s->walPath, dbFile, dbFileLen);
+            memcpy(s->walPath + dbFileLen, "-wal", sizeof("-wal"));
+        }
+    }
+
     configureDBOptions(s);
 
     createLogTable(s->db);
+    setupIoCounters(s);
+    setupChecksums(s);
     preparePreparedStatements(s);
 
     if (i->customInit) {
@@ -816,9 +1295,14 @@ bool kvidxSqlite3Open(kvidxInstance *i, const char *filename,
  * @param i  The kvidx instance to close
  * @return true on success, false if close failed (resources may leak)
  */
+static void stopCheckpointer(kas3State *s);
+
 bool kvidxSqlite3Close(kvidxInstance *i) {
     kas3State *s = STATE(i);
 
+    /* The checkpointer's connection must close before the main one */
+    stopCheckpointer(s);
+
     /* Release the prepared statements */
     sqlite3_finalize(s->begin);
     sqlite3_finalize(s->commit);
@@ -839,6 +1323,7 @@ bool kvidxSqlite3Close(kvidxInstance *i) {
 
     /* Close DB, final sync to storage, and release all DB resources. */
     if (sqlite3_close(s->db) == SQLITE_OK) {
+        free(s->walPath);
         free(i->kvidxdata); /* i->kvidxdata == s */
         i->kvidxdata = NULL;
         return true;
@@ -847,6 +1332,415 @@ bool kvidxSqlite3Close(kvidxInstance *i) {
     return false;
 }
 
+/**
+ * Open a read-only connection to i's database for another thread.
+ *
+ * The reader runs inside its own read transaction, so it sees one snapshot
+ * for its whole life and never blocks (or is blocked by) the writer under
+ * WAL. In-memory and temporary databases cannot be shared this way, and no
+ * reader is opened while i has a transaction open.
+ *
+ * @param i       The kvidx instance to read from
+ * @param reader  OUT: Instance initialized for reading; release it with
+ *                kvidxSqlite3Close()
+ * @return true on success
+ */
+bool kvidxSqlite3OpenReader(kvidxInstance *i, kvidxInstance *reader) {
+    const kas3State *s = STATE(i);
+
+    /* A separate connection wouldn't see i's uncommitted writes */
+    if (!s->walPath || !sqlite3_get_autocommit(s->db)) {
+        return false;
+    }
+
+    sqlite3 *db = NULL;
+    if (sqlite3_open_v2(sqlite3_db_filename(s->db, "main"), &db,
+                        SQLITE_OPEN_READONLY, s->vfs) != SQLITE_OK) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    kas3State *rs = calloc(1, sizeof(*rs));
+    if (!rs) {
+        sqlite3_close(db);
+        return false;
+    }
+
+    rs->db = db;
+    rs->vfs = s->vfs;
+    rs->verifyChecksums = s->verifyChecksums;
+    setupIoCounters(rs);
+    setupChecksums(rs);
+    preparePreparedStatements(rs);
+
+    /* Take the snapshot now rather than at the first read */
+    sqlite3_exec(db, "BEGIN; SELECT 1 FROM log LIMIT 1;", NULL, NULL, NULL);
+
+    reader->kvidxdata = rs;
+    reader->interface = i->interface;
+    return true;
+}
+
+/* ====================================================================
+ * Incremental Vacuum
+ * ==================================================================== */
+
+/**
+ * @section Incremental Vacuum
+ *
+ * Removed rows leave their pages on the database's freelist, and the file
+ * keeps its size. New databases are created with auto_vacuum=INCREMENTAL,
+ * so PRAGMA incremental_vacuum(N) can move up to N free pages to the end of
+ * the file and truncate them, holding the write lock for one short step at
+ * a time. Under WAL the truncation reaches the file at the next checkpoint.
+ *
+ * Steps run from kvidxSqlite3ReclaimSpace(), and, with
+ * kvidxConfig.sqliteBackgroundVacuum, from the background checkpointer
+ * while writes are idle.
+ */
+
+/**
+ * Free up to maxPages pages from the freelist of db.
+ *
+ * @param db        Connection to vacuum through
+ * @param maxPages  Most pages to free
+ * @param freed     OUT: Pages given back to the file system
+ * @param left      OUT: Pages still on the freelist
+ * @return SQLite result code of the vacuum
+ */
+static int vacuumStep(sqlite3 *db, uint64_t maxPages, uint64_t *freed,
+                      uint64_t *left) {
+    /* incremental_vacuum(0) would free every page at once */
+    if (maxPages > INT32_MAX) {
+        maxPages = INT32_MAX;
+    }
+
+    char sql[64];
+    snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%" PRIu64 ");",
+             maxPages);
+    const int64_t before = pragmaInt64(db, "PRAGMA freelist_count");
+    const int rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    const int64_t after = pragmaInt64(db, "PRAGMA freelist_count");
+
+    *freed = before > after && after >= 0 ? (uint64_t)(before - after) : 0;
+    *left = after > 0 ? (uint64_t)after : 0;
+    return rc;
+}
+
+/**
+ * Return up to maxPages free pages to the file system.
+ *
+ * Databases created before incremental auto_vacuum was the default cannot
+ * shrink in steps; they report KVIDX_ERROR_NOT_SUPPORTED while they hold
+ * free pages. A one-time VACUUM converts them.
+ *
+ * @param i         The kvidx instance
+ * @param maxPages  Most pages to free in this step
+ * @param result    OUT: Pages and bytes reclaimed, free pages left
+ * @return KVIDX_OK on success, error code on failure
+ */
+kvidxError kvidxSqlite3ReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                    kvidxReclaimResult *result) {
+    kas3State *s = STATE(i);
+    if (!sqlite3_get_autocommit(s->db)) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot reclaim space inside a transaction");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (pragmaInt64(s->db, "PRAGMA auto_vacuum") != AUTO_VACUUM_INCREMENTAL) {
+        const int64_t freePages = pragmaInt64(s->db, "PRAGMA freelist_count");
+        if (freePages <= 0) {
+            return KVIDX_OK;
+        }
+        result->freePagesLeft = (uint64_t)freePages;
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Database has no incremental auto_vacuum; VACUUM it "
+                      "once to convert");
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    uint64_t freed = 0;
+    uint64_t left = 0;
+    if (vacuumStep(s->db, maxPages, &freed, &left) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Incremental vacuum failed: %s",
+                      sqlite3_errmsg(s->db));
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    const int64_t pageSize = pragmaInt64(s->db, "PRAGMA page_size");
+    result->pagesFreed = freed;
+    result->bytesReclaimed = pageSize > 0 ? freed * (uint64_t)pageSize : 0;
+    result->freePagesLeft = left;
+
+    /* The vacuum sits in the WAL until checkpointed */
+    if (freed && s->walPath) {
+        checkpointWal(s->db, SQLITE_CHECKPOINT_PASSIVE);
+    }
+    return KVIDX_OK;
+}
+
+/* ====================================================================
+ * WAL Checkpointing
+ * ==================================================================== */
+
+/**
+ * @section WAL Checkpointing
+ *
+ * By default SQLite checkpoints inline: the commit that pushes the WAL past
+ * wal_autocheckpoint pages copies the WAL back into the database before
+ * returning, producing a multi-millisecond latency spike on that commit.
+ *
+ * With kvidxConfig.sqliteBackgroundCheckpoint, a WAL hook replaces the
+ * inline auto-checkpoint and a dedicated thread checkpoints instead:
+ * - PASSIVE once no commit has happened for sqliteCheckpointIdleMs. It
+ *   never blocks writers or readers, copying as much as it can.
+ * - TRUNCATE as soon as the WAL exceeds sqliteWalSizeLimitBytes. It waits
+ *   briefly (CHECKPOINT_BUSY_TIMEOUT_MS) for readers, then resets the WAL
+ *   to zero bytes so its size stays bounded under sustained writes.
+ *
+ * Failed TRUNCATE attempts back off for one idle period before retrying.
+ *
+ * With kvidxConfig.sqliteBackgroundVacuum, each idle PASSIVE checkpoint is
+ * followed by incremental vacuum steps until the freelist is empty or the
+ * next commit arrives, and one more PASSIVE checkpoint to shrink the file.
+ */
+
+static uint64_t checkpointClockMicros(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static struct timespec checkpointDeadline(uint64_t atMs) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(atMs / 1000);
+    ts.tv_nsec = (long)(atMs % 1000) * 1000000;
+    return ts;
+}
+
+/**
+ * WAL hook on the main connection: runs after every commit.
+ *
+ * Installing any WAL hook disables SQLite's inline auto-checkpoint, which
+ * is the point; this hook only records WAL growth and wakes the thread.
+ */
+static int checkpointWalHook(void *userData, sqlite3 *db, const char *dbName,
+                             int nPages) {
+    (void)db;
+    (void)dbName;
+    kas3Checkpointer *c = userData;
+
+    pthread_mutex_lock(&c->lock);
+    c->commitSeq++;
+    c->lastCommitMs = checkpointClockMicros() / 1000;
+    c->walPages = nPages > 0 ? (uint64_t)nPages : 0;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+
+    return SQLITE_OK;
+}
+
+/**
+ * Vacuum in steps of c->vacuumPages while no commit arrives after seq.
+ * Runs on the checkpointer thread without c->lock held.
+ *
+ * @return Pages given back to the file system
+ */
+static uint64_t vacuumWhileIdle(kas3Checkpointer *c, uint64_t seq) {
+    uint64_t total = 0;
+    for (;;) {
+        pthread_mutex_lock(&c->lock);
+        const bool idle = !c->stop && c->commitSeq == seq;
+        pthread_mutex_unlock(&c->lock);
+        if (!idle) {
+            break;
+        }
+
+        uint64_t freed = 0;
+        uint64_t left = 0;
+        if (vacuumStep(c->db, c->vacuumPages, &freed, &left) != SQLITE_OK) {
+            break;
+        }
+        total += freed;
+        if (!freed || !left) {
+            break;
+        }
+    }
+
+    if (total) {
+        checkpointWal(c->db, SQLITE_CHECKPOINT_PASSIVE);
+    }
+    return total;
+}
+
+static void *checkpointerMain(void *arg) {
+    kas3Checkpointer *c = arg;
+    uint64_t retryAfterMs = 0;
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->stop) {
+        if (c->commitSeq == c->checkpointedSeq) {
+            pthread_cond_wait(&c->cond, &c->lock);
+            continue;
+        }
+
+        const uint64_t nowMs = checkpointClockMicros() / 1000;
+        const bool overCap = c->walPages * c->pageSize >= c->walSizeLimit;
+        uint64_t runAtMs = overCap ? retryAfterMs : c->lastCommitMs + c->idleMs;
+        if (nowMs < runAtMs) {
+            struct timespec deadline = checkpointDeadline(runAtMs);
+            pthread_cond_timedwait(&c->cond, &c->lock, &deadline);
+            continue;
+        }
+
+        const uint64_t seq = c->commitSeq;
+        pthread_mutex_unlock(&c->lock);
+
+        const int mode =
+            overCap ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE;
+        const uint64_t start = checkpointClockMicros();
+        const int rc = checkpointWal(c->db, mode);
+        const uint64_t took = checkpointClockMicros() - start;
+        const uint64_t vacuumed =
+            !overCap && c->vacuumPages ? vacuumWhileIdle(c, seq) : 0;
+
+        pthread_mutex_lock(&c->lock);
+        c->pagesVacuumed += vacuumed;
+        c->checkpointedSeq = seq;
+        c->checkpointCount++;
+        c->lastCheckpointMicros = took;
+        if (took > c->maxCheckpointMicros) {
+            c->maxCheckpointMicros = took;
+        }
+
+        if (overCap) {
+            if (rc == SQLITE_OK) {
+                c->walPages = 0;
+                retryAfterMs = 0;
+            } else {
+                /* Still over the cap: retry shortly even if no further
+                 * commits arrive. Waiting out idleMs would let sustained
+                 * writes grow the WAL far past the cap. */
+                c->checkpointedSeq = seq - 1;
+                retryAfterMs =
+                    checkpointClockMicros() / 1000 + CHECKPOINT_BUSY_TIMEOUT_MS;
+            }
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+/**
+ * Stop the background checkpointer, if running, and restore SQLite's
+ * inline auto-checkpoint on the main connection.
+ *
+ * @param s  The internal adapter state
+ */
+static void stopCheckpointer(kas3State *s) {
+    kas3Checkpointer *c = s->checkpointer;
+    if (!c) {
+        return;
+    }
+
+    /* Replacing the hook first means no commit touches c after this.
+     * sqlite3_wal_autocheckpoint() reinstalls SQLite's own hook; ApplyConfig
+     * re-applies any configured threshold afterwards. */
+    sqlite3_wal_autocheckpoint(s->db, DEFAULT_WAL_AUTOCHECKPOINT);
+
+    pthread_mutex_lock(&c->lock);
+    c->stop = true;
+    pthread_cond_signal(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->thread, NULL);
+
+    sqlite3_close(c->db);
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+    s->pagesVacuumed += c->pagesVacuumed;
+    free(c);
+    s->checkpointer = NULL;
+}
+
+/**
+ * Start (or restart with new settings) the background checkpointer.
+ *
+ * @param i       The kvidx instance
+ * @param config  Checkpoint settings
+ * @return KVIDX_OK on success, error code on failure
+ */
+static kvidxError startCheckpointer(kvidxInstance *i,
+                                    const kvidxConfig *config) {
+    kas3State *s = STATE(i);
+    stopCheckpointer(s);
+
+    if (!s->walPath) {
+        /* Nothing to checkpoint for in-memory databases */
+        return KVIDX_OK;
+    }
+
+    kas3Checkpointer *c = calloc(1, sizeof(*c));
+    if (!c) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                      "Failed to allocate WAL checkpointer");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    c->idleMs = config->sqliteCheckpointIdleMs > 0
+                    ? (uint64_t)config->sqliteCheckpointIdleMs
+                    : DEFAULT_CHECKPOINT_IDLE_MS;
+    c->walSizeLimit = config->sqliteWalSizeLimitBytes
+                          ? config->sqliteWalSizeLimitBytes
+                          : DEFAULT_WAL_SIZE_LIMIT;
+    if (config->sqliteBackgroundVacuum) {
+        c->vacuumPages = config->reclaimPagesPerStep
+                             ? config->reclaimPagesPerStep
+                             : DEFAULT_VACUUM_PAGES_PER_STEP;
+    }
+
+    sqlite3_stmt *stmt = NULL;
+    if (prepareStatement(s, "PRAGMA page_size", -1, &stmt) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
+            c->pageSize = sqlite3_column_int64(stmt, 0);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (sqlite3_open_v2(sqlite3_db_filename(s->db, "main"), &c->db,
+                        SQLITE_OPEN_READWRITE, s->vfs) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_IO,
+                      "Failed to open checkpointer connection: %s",
+                      sqlite3_errmsg(c->db));
+        sqlite3_close(c->db);
+        free(c);
+        return KVIDX_ERROR_IO;
+    }
+    sqlite3_busy_timeout(c->db, CHECKPOINT_BUSY_TIMEOUT_MS);
+
+    /* A fresh connection only notices WAL mode once it reads the database;
+     * until then every checkpoint is a silent no-op. */
+    sqlite3_exec(c->db, "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+
+    if (pthread_create(&c->thread, NULL, checkpointerMain, c) != 0) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Failed to start checkpointer thread");
+        sqlite3_close(c->db);
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+        free(c);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    s->checkpointer = c;
+    sqlite3_wal_hook(s->db, checkpointWalHook, c);
+    return KVIDX_OK;
+}
+
 /* ====================================================================
  * Statistics Implementation
  * ==================================================================== */
@@ -870,12 +1764,12 @@ kvidxError kvidxSqlite3GetKeyCount(kvidxInstance *i, uint64_t *count) {
     sqlite3_stmt *stmt = NULL;
     const char *sql = "SELECT COUNT(*) FROM log";
 
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     kvidxError result = KVIDX_ERROR_INTERNAL;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         *count = sqlite3_column_int64(stmt, 0);
         result = KVIDX_OK;
     }
@@ -903,12 +1797,12 @@ kvidxError kvidxSqlite3GetMinKey(kvidxInstance *i, uint64_t *key) {
     sqlite3_stmt *stmt = NULL;
     const char *sql = "SELECT MIN(id) FROM log";
 
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     kvidxError result = KVIDX_ERROR_NOT_FOUND;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         if (sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
             *key = sqlite3_column_int64(stmt, 0);
             result = KVIDX_OK;
@@ -941,12 +1835,12 @@ kvidxError kvidxSqlite3GetDataSize(kvidxInstance *i, uint64_t *bytes) {
     sqlite3_stmt *stmt = NULL;
     const char *sql = "SELECT SUM(LENGTH(data)) FROM log";
 
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     kvidxError result = KVIDX_ERROR_INTERNAL;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         if (sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
             *bytes = sqlite3_column_int64(stmt, 0);
         } else {
@@ -974,6 +1868,8 @@ kvidxError kvidxSqlite3GetDataSize(kvidxInstance *i, uint64_t *bytes) {
  * - freePages: Unused pages (available for reuse)
  * - databaseFileSize: Calculated from page count * page size
  * - walFileSize: Size of WAL file (if in WAL mode)
+ * - checkpoint*: Background checkpointer activity (if running)
+ * - pagesReclaimed, bytesReclaimed: Pages freed by background vacuum steps
  *
  * @param i      The kvidx instance
  * @param stats  OUT: Structure to fill with statistics
@@ -993,11 +1889,11 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
     const char *sql =
         "SELECT COUNT(*), MIN(id), MAX(id), SUM(LENGTH(data)) FROM log";
 
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+    if (prepareStatement(s, sql, -1, &stmt) != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         stats->totalKeys = sqlite3_column_int64(stmt, 0);
 
         if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
@@ -1018,8 +1914,8 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
     /* Get page count and page size */
     stmt = NULL;
     sql = "PRAGMA page_count";
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (prepareStatement(s, sql, -1, &stmt) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
             stats->pageCount = sqlite3_column_int64(stmt, 0);
         }
         sqlite3_finalize(stmt);
@@ -1027,8 +1923,8 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
 
     stmt = NULL;
     sql = "PRAGMA page_size";
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (prepareStatement(s, sql, -1, &stmt) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
             stats->pageSize = sqlite3_column_int64(stmt, 0);
         }
         sqlite3_finalize(stmt);
@@ -1037,8 +1933,8 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
     /* Get free pages */
     stmt = NULL;
     sql = "PRAGMA freelist_count";
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (prepareStatement(s, sql, -1, &stmt) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
             stats->freePages = sqlite3_column_int64(stmt, 0);
         }
         sqlite3_finalize(stmt);
@@ -1052,17 +1948,19 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
     /* Get WAL file size if in WAL mode */
     stmt = NULL;
     sql = "PRAGMA journal_mode";
-    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (prepareStatement(s, sql, -1, &stmt) == SQLITE_OK) {
+        if (stepStatement(stmt) == SQLITE_ROW) {
             const char *mode = (const char *)sqlite3_column_text(stmt, 0);
             if (mode && strcmp(mode, "wal") == 0) {
                 /* In WAL mode - try to get WAL file size */
                 sqlite3_finalize(stmt);
                 stmt = NULL;
 
-                /* WAL file size isn't directly available via PRAGMA,
-                 * would need to stat the -wal file on disk */
-                stats->walFileSize = 0; /* TODO: stat the -wal file */
+                /* WAL file size isn't available via PRAGMA */
+                struct stat st;
+                if (s->walPath && stat(s->walPath, &st) == 0) {
+                    stats->walFileSize = (uint64_t)st.st_size;
+                }
             }
         }
         if (stmt) {
@@ -1070,9 +1968,62 @@ kvidxError kvidxSqlite3GetStats(kvidxInstance *i, kvidxStats *stats) {
         }
     }
 
+    stats->pagesReclaimed = s->pagesVacuumed;
+    kas3Checkpointer *c = s->checkpointer;
+    if (c) {
+        pthread_mutex_lock(&c->lock);
+        stats->checkpointCount = c->checkpointCount;
+        stats->lastCheckpointMicros = c->lastCheckpointMicros;
+        stats->maxCheckpointMicros = c->maxCheckpointMicros;
+        stats->pagesReclaimed += c->pagesVacuumed;
+        pthread_mutex_unlock(&c->lock);
+    }
+    stats->bytesReclaimed = stats->pagesReclaimed * stats->pageSize;
+
     return KVIDX_OK;
 }
 
+/**
+ * Add this connection's work counters (interface.ioCounters).
+ *
+ * Bytes come from the page cache: each miss is a page read from the
+ * database or WAL, and each dirty page written out (at commit, or when the
+ * cache spills) is a page written. Prepared statements include automatic
+ * re-prepares of the cached statements after a schema change. SQLite does
+ * not count syncs or file growth per connection, so fsyncs and
+ * pagesAllocated stay 0.
+ *
+ * @param i         The kvidx instance
+ * @param counters  OUT: Running totals are added here
+ */
+void kvidxSqlite3IoCounters(kvidxInstance *i, kvidxIoCounters *counters) {
+    const kas3State *s = STATE(i);
+    int misses = 0;
+    int writes = 0;
+    int highwater = 0;
+    sqlite3_db_status(s->db, SQLITE_DBSTATUS_CACHE_MISS, &misses, &highwater,
+                      0);
+    sqlite3_db_status(s->db, SQLITE_DBSTATUS_CACHE_WRITE, &writes, &highwater,
+                      0);
+    counters->bytesRead += (uint64_t)misses * (uint64_t)s->pageSize;
+    counters->bytesWritten += (uint64_t)writes * (uint64_t)s->pageSize;
+
+    sqlite3_stmt *const cached[] = {
+        s->get, s->getPrev, s->getNext, s->exists,
+        s->existsDual, s->insert, s->remove, s->begin,
+        s->commit, s->maxKey, s->removeAfterNInclusive,
+        s->removeBeforeNInclusive};
+    uint64_t reprepared = 0;
+    for (size_t n = 0; n < sizeof(cached) / sizeof(*cached); n++) {
+        if (cached[n]) {
+            reprepared += (uint64_t)sqlite3_stmt_status(
+                cached[n], SQLITE_STMTSTATUS_REPREPARE, 0);
+        }
+    }
+    counters->stmtsPrepared += s->stmtsPrepared + reprepared;
+    counters->transactions += s->transactions;
+}
+
 /* ====================================================================
  * Configuration Application (v0.5.0)
  * ==================================================================== */
@@ -1138,6 +2089,9 @@ static const char *syncModeToString(kvidxSyncMode mode) {
  * - enableForeignKeys: Enforce foreign key constraints
  * - busyTimeoutMs: How long to wait when database is locked
  * - mmapSizeBytes: Memory-mapped I/O size (0 to disable)
+ * - sqliteWalAutoCheckpoint: Inline checkpoint threshold in WAL pages
+ * - sqliteBackgroundCheckpoint: Checkpoint from a background thread
+ * - sqliteBackgroundVacuum: Vacuum from the same thread while idle
  *
  * Note: Some settings (like journal mode) may require exclusive access
  * and could fail if other connections exist.
@@ -1230,6 +2184,39 @@ kvidxError kvidxSqlite3ApplyConfig(kvidxInstance *i,
         }
     }
 
+    /* Value checksums need the crc column; add it the first time */
+    s->writeChecksums = config->valueChecksums;
+    s->verifyChecksums = config->verifyChecksums;
+    if (config->valueChecksums && !s->crcColumn && !config->readOnly) {
+        kvidxError colErr = addChecksumColumn(i);
+        if (colErr != KVIDX_OK) {
+            return colErr;
+        }
+    }
+
+    /* WAL checkpointing: background thread or inline auto-checkpoint.
+     * PRAGMA wal_autocheckpoint clears any WAL hook, so it must run before
+     * the checkpointer installs its own. */
+    stopCheckpointer(s);
+    if (config->sqliteWalAutoCheckpoint != 0) {
+        snprintf(sql, sizeof(sql), "PRAGMA wal_autocheckpoint = %d",
+                 config->sqliteWalAutoCheckpoint > 0
+                     ? config->sqliteWalAutoCheckpoint
+                     : 0);
+        rc = sqlite3_exec(s->db, sql, NULL, NULL, NULL);
+        if (rc != SQLITE_OK) {
+            kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                          "Failed to set WAL auto-checkpoint: %s",
+                          sqlite3_errmsg(s->db));
+            return KVIDX_ERROR_INTERNAL;
+        }
+    }
+
+    if (config->sqliteBackgroundCheckpoint &&
+        config->journalMode == KVIDX_JOURNAL_WAL) {
+        return startCheckpointer(i, config);
+    }
+
     return KVIDX_OK;
 }
 
@@ -1279,7 +2266,7 @@ kvidxError kvidxSqlite3RemoveRange(kvidxInstance *i, uint64_t startKey,
     }
 
     sqlite3_stmt *stmt = NULL;
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                       "Failed to prepare remove range: %s",
@@ -1292,7 +2279,7 @@ kvidxError kvidxSqlite3RemoveRange(kvidxInstance *i, uint64_t startKey,
         sqlite3_bind_int64(stmt, 2, endKey);
     }
 
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
 
     if (rc != SQLITE_DONE) {
@@ -1339,7 +2326,7 @@ kvidxError kvidxSqlite3CountRange(kvidxInstance *i, uint64_t startKey,
                  "SELECT COUNT(*) FROM log WHERE id >= ? AND id <= ?");
     }
 
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                       "Failed to prepare count range: %s",
@@ -1353,7 +2340,7 @@ kvidxError kvidxSqlite3CountRange(kvidxInstance *i, uint64_t startKey,
     }
 
     kvidxError result = KVIDX_ERROR_INTERNAL;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         *count = sqlite3_column_int64(stmt, 0);
         result = KVIDX_OK;
     } else {
@@ -1399,7 +2386,7 @@ kvidxError kvidxSqlite3ExistsInRange(kvidxInstance *i, uint64_t startKey,
                  "SELECT EXISTS(SELECT 1 FROM log WHERE id >= ? AND id <= ?)");
     }
 
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                       "Failed to prepare exists in range: %s",
@@ -1413,7 +2400,7 @@ kvidxError kvidxSqlite3ExistsInRange(kvidxInstance *i, uint64_t startKey,
     }
 
     kvidxError result = KVIDX_ERROR_INTERNAL;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         *exists = sqlite3_column_int(stmt, 0) != 0;
         result = KVIDX_OK;
     } else {
@@ -1505,106 +2492,16 @@ static kvidxError writeBinaryEntry(FILE *fp, uint64_t key, uint64_t term,
     return KVIDX_OK;
 }
 
-/**
- * Write a string with JSON escape sequences.
- *
- * Escapes special characters according to RFC 8259:
- * - " -> \"
- * - \ -> \\
- * - Control characters -> \uXXXX
- *
- * @param fp   File pointer to write to
- * @param str  String to escape and write
- * @param len  Length of string
- */
-static void writeJsonEscaped(FILE *fp, const char *str, size_t len) {
-    for (size_t i = 0; i < len; i++) {
-        unsigned char c = str[i];
-        switch (c) {
-        case '"':
-            fprintf(fp, "\\\"");
-            break;
-        case '\\':
-            fprintf(fp, "\\\\");
-            break;
-        case '\b':
-            fprintf(fp, "\\b");
-            break;
-        case '\f':
-            fprintf(fp, "\\f");
-            break;
-        case '\n':
-            fprintf(fp, "\\n");
-            break;
-        case '\r':
-            fprintf(fp, "\\r");
-            break;
-        case '\t':
-            fprintf(fp, "\\t");
-            break;
-        default:
-            if (c < 32 || c == 127) {
-                fprintf(fp, "\\u%04x", c);
-            } else {
-                fputc(c, fp);
-            }
-        }
-    }
-}
-
-/**
- * Write a CSV field with proper quoting.
- *
- * Follows RFC 4180 CSV rules:
- * - Fields containing comma, quote, or newline are enclosed in quotes
- * - Quotes within quoted fields are escaped by doubling ("" -> "")
- * - Other fields are written as-is
- *
- * @param fp   File pointer to write to
- * @param str  Field value to write
- * @param len  Length of field value
- */
-static void writeCsvField(FILE *fp, const char *str, size_t len) {
-    bool needsQuotes = false;
-
-    /* Check if field needs quoting */
-    for (size_t i = 0; i < len; i++) {
-        if (str[i] == ',' || str[i] == '"' || str[i] == '\n' ||
-            str[i] == '\r') {
-            needsQuotes = true;
-            break;
-        }
-    }
-
-    if (needsQuotes) {
-        fputc('"', fp);
-        for (size_t i = 0; i < len; i++) {
-            if (str[i] == '"') {
-                fputc('"', fp); /* Escape quote with double quote */
-            }
-            fputc(str[i], fp);
-        }
-        fputc('"', fp);
-    } else {
-        fwrite(str, 1, len, fp);
-    }
-}
-
 /**
  * Export database contents to a file.
  *
- * Writes all records (or a range) to an external file in the specified
- * format. Supports progress callbacks for long-running exports.
- *
- * Export formats:
- * - KVIDX_EXPORT_BINARY: Fast, compact, includes header with count
- * - KVIDX_EXPORT_JSON: Pretty-printable, includes format metadata
- * - KVIDX_EXPORT_CSV: Spreadsheet-compatible, optional header row
+ * Writes all records (or a range) to an external file in the binary
+ * format. Supports progress callbacks for long-running exports. JSON and
+ * CSV exports never reach the adapter: kvidxExport() writes them through
+ * the shared stream encoder.
  *
  * Options:
  * - startKey/endKey: Filter to export only a key range
- * - includeMetadata: Include term/cmd fields (not just key/data)
- * - prettyPrint: Add whitespace for readability (JSON only)
  *
  * @param i         The kvidx instance
  * @param filename  Output file path
@@ -1642,7 +2539,7 @@ kvidxError kvidxSqlite3Export(kvidxInstance *i, const char *filename,
     }
 
     sqlite3_stmt *stmt = NULL;
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         fclose(fp);
         kvidxSetError(i, KVIDX_ERROR_INTERNAL,
@@ -1664,33 +2561,18 @@ kvidxError kvidxSqlite3Export(kvidxInstance *i, const char *filename,
     uint64_t total = 0;
     kvidxCountRange(i, options->startKey, options->endKey, &total);
 
-    /* Write format-specific header */
-    if (options->format == KVIDX_EXPORT_BINARY) {
-        kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
-                                    .version = KVIDX_BINARY_VERSION,
-                                    .reserved = 0,
-                                    .entryCount = total};
-        if (fwrite(&header, sizeof(header), 1, fp) != 1) {
-            result = KVIDX_ERROR_IO;
-            goto cleanup;
-        }
-    } else if (options->format == KVIDX_EXPORT_JSON) {
-        fprintf(fp, "{\"format\":\"kvidx-json\",\"version\":1,\"entries\":[");
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-    } else if (options->format == KVIDX_EXPORT_CSV) {
-        /* CSV header */
-        if (options->includeMetadata) {
-            fprintf(fp, "key,term,cmd,data\n");
-        } else {
-            fprintf(fp, "key,data\n");
-        }
+    /* Write header */
+    kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
+                                .version = KVIDX_BINARY_VERSION,
+                                .reserved = 0,
+                                .entryCount = total};
+    if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+        result = KVIDX_ERROR_IO;
+        goto cleanup;
     }
 
     /* Export entries */
-    bool firstEntry = true;
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    while ((rc = stepStatement(stmt)) == SQLITE_ROW) {
         uint64_t key = sqlite3_column_int64(stmt, 0);
         uint64_t term = sqlite3_column_int64(stmt, 1);
         uint64_t cmd = sqlite3_column_int64(stmt, 2);
@@ -1698,38 +2580,9 @@ kvidxError kvidxSqlite3Export(kvidxInstance *i, const char *filename,
         size_t dataLen = sqlite3_column_bytes(stmt, 3);
 
         /* Write entry in appropriate format */
-        if (options->format == KVIDX_EXPORT_BINARY) {
-            result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
-            if (result != KVIDX_OK) {
-                goto cleanup;
-            }
-        } else if (options->format == KVIDX_EXPORT_JSON) {
-            if (!firstEntry) {
-                fprintf(fp, ",");
-            }
-            if (options->prettyPrint) {
-                fprintf(fp, "\n  ");
-            }
-            fprintf(fp, "{\"key\":%" PRIu64, key);
-            if (options->includeMetadata) {
-                fprintf(fp, ",\"term\":%" PRIu64 ",\"cmd\":%" PRIu64, term,
-                        cmd);
-            }
-            fprintf(fp, ",\"data\":\"");
-            if (data && dataLen > 0) {
-                writeJsonEscaped(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\"}");
-            firstEntry = false;
-        } else if (options->format == KVIDX_EXPORT_CSV) {
-            fprintf(fp, "%" PRIu64 ",", key);
-            if (options->includeMetadata) {
-                fprintf(fp, "%" PRIu64 ",%" PRIu64 ",", term, cmd);
-            }
-            if (data && dataLen > 0) {
-                writeCsvField(fp, (const char *)data, dataLen);
-            }
-            fprintf(fp, "\n");
+        result = writeBinaryEntry(fp, key, term, cmd, data, dataLen);
+        if (result != KVIDX_OK) {
+            goto cleanup;
         }
 
         count++;
@@ -1743,14 +2596,6 @@ kvidxError kvidxSqlite3Export(kvidxInstance *i, const char *filename,
         }
     }
 
-    /* Write format-specific footer */
-    if (options->format == KVIDX_EXPORT_JSON) {
-        if (options->prettyPrint) {
-            fprintf(fp, "\n");
-        }
-        fprintf(fp, "]}\n");
-    }
-
     /* Final progress callback */
     if (callback && count > 0) {
         callback(count, total, userData);
@@ -1777,13 +2622,19 @@ cleanup:
  * Currently only BINARY format is fully implemented; JSON and CSV import
  * return KVIDX_ERROR_NOT_SUPPORTED.
  *
+ * The file is memory-mapped and each entry's data is bound straight from
+ * the mapping (SQLITE_STATIC), so no entry is copied or allocated on the
+ * way in.
+ *
  * Import options:
  * - clearBeforeImport: Delete all existing records first
  * - skipDuplicates: Continue on duplicate key (else fail)
  * - format: Auto-detect by examining file header/content
+ * - commitBytes: Entry bytes written per transaction
  *
- * The import is wrapped in a transaction for atomicity. On error, all
- * changes are rolled back.
+ * Entries are inserted in transactions of about commitBytes each, so a
+ * large import doesn't grow the WAL without bound. Transactions already
+ * committed stay in place if the import fails.
  *
  * @param i         The kvidx instance
  * @param filename  Input file path
@@ -1799,14 +2650,12 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
         return KVIDX_ERROR_INVALID_ARGUMENT;
     }
 
-    FILE *fp = fopen(filename, "rb");
-    if (!fp) {
-        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file for reading: %s",
-                      filename);
-        return KVIDX_ERROR_IO;
+    kvidxMappedFile m;
+    kvidxError result = kvidxMapFile(i, filename, &m);
+    if (result != KVIDX_OK) {
+        return result;
     }
 
-    kvidxError result = KVIDX_OK;
     uint64_t count = 0;
 
     /* Clear database if requested */
@@ -1814,7 +2663,7 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
         kas3State *s = STATE(i);
         int rc = sqlite3_exec(s->db, "DELETE FROM log", NULL, NULL, NULL);
         if (rc != SQLITE_OK) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to clear database");
             return KVIDX_ERROR_INTERNAL;
         }
@@ -1822,26 +2671,13 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
 
     /* Detect format if auto-detect */
     kvidxExportFormat format = options->format;
-    if (format == KVIDX_EXPORT_BINARY) {
+    if (format == KVIDX_EXPORT_BINARY && m.size >= sizeof(uint64_t)) {
         /* Try to detect format by reading magic */
         uint64_t magic;
-        if (fread(&magic, sizeof(magic), 1, fp) == 1) {
-            if (magic == KVIDX_BINARY_MAGIC) {
-                format = KVIDX_EXPORT_BINARY;
-                rewind(fp); /* Reset to beginning */
-            } else {
-                /* Check for JSON or CSV */
-                rewind(fp);
-                char buf[32];
-                if (fgets(buf, sizeof(buf), fp)) {
-                    if (buf[0] == '{') {
-                        format = KVIDX_EXPORT_JSON;
-                    } else {
-                        format = KVIDX_EXPORT_CSV;
-                    }
-                    rewind(fp);
-                }
-            }
+        memcpy(&magic, m.base, sizeof(magic));
+        if (magic != KVIDX_BINARY_MAGIC) {
+            /* Check for JSON or CSV */
+            format = m.base[0] == '{' ? KVIDX_EXPORT_JSON : KVIDX_EXPORT_CSV;
         }
     }
 
@@ -1849,21 +2685,21 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
     if (format == KVIDX_EXPORT_BINARY) {
         /* Read and validate header */
         kvidxBinaryHeader header;
-        if (fread(&header, sizeof(header), 1, fp) != 1) {
-            fclose(fp);
+        if (!kvidxMappedRead(&m, &header, sizeof(header))) {
+            kvidxUnmapFile(&m);
             kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read binary header");
             return KVIDX_ERROR_IO;
         }
 
         if (header.magic != KVIDX_BINARY_MAGIC) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
                           "Invalid binary format magic");
             return KVIDX_ERROR_INVALID_ARGUMENT;
         }
 
         if (header.version != KVIDX_BINARY_VERSION) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
                           "Unsupported binary format version: %u",
                           header.version);
@@ -1872,46 +2708,38 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
 
         /* Begin transaction */
         if (!kvidxBegin(i)) {
-            fclose(fp);
+            kvidxUnmapFile(&m);
             kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                           "Failed to begin transaction");
             return KVIDX_ERROR_INTERNAL;
         }
 
+        const uint64_t commitBytes = kvidxImportCommitBytes(options);
+        uint64_t pendingBytes = 0;
+
         /* Read entries */
         for (uint64_t idx = 0; idx < header.entryCount; idx++) {
-            uint64_t key, term, cmd, dataLen;
-            uint8_t *data = NULL;
-
-            /* Read entry fields */
-            if (fread(&key, sizeof(key), 1, fp) != 1 ||
-                fread(&term, sizeof(term), 1, fp) != 1 ||
-                fread(&cmd, sizeof(cmd), 1, fp) != 1 ||
-                fread(&dataLen, sizeof(dataLen), 1, fp) != 1) {
+            uint64_t key, term, cmd;
+            const uint8_t *data;
+            size_t dataLen;
+
+            if (!kvidxMappedEntry(&m, &key, &term, &cmd, &data, &dataLen)) {
                 result = KVIDX_ERROR_IO;
                 break;
             }
 
-            /* Read data if present */
-            if (dataLen > 0) {
-                data = malloc(dataLen);
-                if (!data) {
+            /* Start a new transaction once this one is big enough */
+            pendingBytes += 4 * sizeof(uint64_t) + dataLen;
+            if (pendingBytes >= commitBytes) {
+                if (!kvidxCommit(i) || !kvidxBegin(i)) {
                     result = KVIDX_ERROR_INTERNAL;
                     break;
                 }
-
-                if (fread(data, 1, dataLen, fp) != dataLen) {
-                    free(data);
-                    result = KVIDX_ERROR_IO;
-                    break;
-                }
+                pendingBytes = 0;
             }
 
             /* Insert entry */
-            bool inserted = kvidxInsert(i, key, term, cmd, data, dataLen);
-            free(data);
-
-            if (!inserted) {
+            if (!kvidxInsert(i, key, term, cmd, data, dataLen)) {
                 if (options->skipDuplicates) {
                     /* Continue on duplicate key */
                     continue;
@@ -1943,13 +2771,13 @@ kvidxError kvidxSqlite3Import(kvidxInstance *i, const char *filename,
         }
     } else {
         /* JSON and CSV import not implemented in this version */
-        fclose(fp);
+        kvidxUnmapFile(&m);
         kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
                       "JSON and CSV import not yet implemented");
         return KVIDX_ERROR_NOT_SUPPORTED;
     }
 
-    fclose(fp);
+    kvidxUnmapFile(&m);
 
     if (result != KVIDX_OK) {
         kvidxSetError(i, result, "Import failed after %" PRIu64 " entries",
@@ -2003,8 +2831,7 @@ static uint64_t currentTimeMs(void) {
  * @return true if table exists/created, false on error
  */
 static bool ensureTTLTable(kas3State *s) {
-    static bool created = false;
-    if (created) {
+    if (s->ttlTableReady) {
         return true;
     }
 
@@ -2017,7 +2844,7 @@ static bool ensureTTLTable(kas3State *s) {
         const char *idx = "CREATE INDEX IF NOT EXISTS _kvidx_ttl_expires ON "
                           "_kvidx_ttl(expires_at)";
         sqlite3_exec(s->db, idx, NULL, NULL, NULL);
-        created = true;
+        s->ttlTableReady = true;
     }
     return rc == SQLITE_OK;
 }
@@ -2038,6 +2865,9 @@ static bool ensureTTLTable(kas3State *s) {
  */
 bool kvidxSqlite3Abort(kvidxInstance *i) {
     kas3State *s = STATE(i);
+
+    /* The rollback may undo the TTL table's creation */
+    s->ttlTableReady = false;
     int rc = sqlite3_exec(s->db, "ROLLBACK;", NULL, NULL, NULL);
     return rc == SQLITE_OK || rc == SQLITE_DONE;
 }
@@ -2076,8 +2906,12 @@ kvidxError kvidxSqlite3InsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
     case KVIDX_SET_ALWAYS: {
         /* Use INSERT OR REPLACE */
         sqlite3_stmt *stmt = NULL;
-        const char *sql = "INSERT OR REPLACE INTO log VALUES(?, ?, ?, ?, ?)";
-        int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+        const char *sql = s->crcColumn
+                              ? "INSERT OR REPLACE INTO log VALUES(?1, ?2, ?3, "
+                                "?4, ?5, kvidx_crc32c(?3, ?4, ?5))"
+                              : "INSERT OR REPLACE INTO log VALUES(?, ?, ?, ?, "
+                                "?)";
+        int rc = prepareStatement(s, sql, -1, &stmt);
         if (rc != SQLITE_OK) {
             kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                           "Failed to prepare InsertEx: %s",
@@ -2089,7 +2923,7 @@ kvidxError kvidxSqlite3InsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
         sqlite3_bind_int64(stmt, 3, term);
         sqlite3_bind_int64(stmt, 4, cmd);
         sqlite3_bind_blob64(stmt, 5, data, dataLen, NULL);
-        rc = sqlite3_step(stmt);
+        rc = stepStatement(stmt);
         sqlite3_finalize(stmt);
         if (rc != SQLITE_DONE && rc != SQLITE_OK) {
             kvidxSetError(i, KVIDX_ERROR_INTERNAL, "InsertEx failed: %s",
@@ -2123,8 +2957,11 @@ kvidxError kvidxSqlite3InsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
         /* Key exists, update it */
         sqlite3_stmt *stmt = NULL;
         const char *sql =
-            "UPDATE log SET term = ?, cmd = ?, data = ? WHERE id = ?";
-        int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+            s->crcColumn
+                ? "UPDATE log SET term = ?1, cmd = ?2, data = ?3, "
+                  "crc = kvidx_crc32c(?1, ?2, ?3) WHERE id = ?4"
+                : "UPDATE log SET term = ?, cmd = ?, data = ? WHERE id = ?";
+        int rc = prepareStatement(s, sql, -1, &stmt);
         if (rc != SQLITE_OK) {
             kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                           "Failed to prepare InsertXX: %s",
@@ -2135,7 +2972,7 @@ kvidxError kvidxSqlite3InsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
         sqlite3_bind_int64(stmt, 2, cmd);
         sqlite3_bind_blob64(stmt, 3, data, dataLen, NULL);
         sqlite3_bind_int64(stmt, 4, key);
-        rc = sqlite3_step(stmt);
+        rc = stepStatement(stmt);
         sqlite3_finalize(stmt);
         if (rc != SQLITE_DONE && rc != SQLITE_OK) {
             return KVIDX_ERROR_INTERNAL;
@@ -2363,8 +3200,12 @@ kvidxError kvidxSqlite3CompareAndSwap(kvidxInstance *i, uint64_t key,
 
     /* Data matches, perform update */
     sqlite3_stmt *stmt = NULL;
-    const char *sql = "UPDATE log SET term = ?, cmd = ?, data = ? WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    const char *sql =
+        s->crcColumn
+            ? "UPDATE log SET term = ?1, cmd = ?2, data = ?3, "
+              "crc = kvidx_crc32c(?1, ?2, ?3) WHERE id = ?4"
+            : "UPDATE log SET term = ?, cmd = ?, data = ? WHERE id = ?";
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         kvidxSetError(i, KVIDX_ERROR_INTERNAL,
                       "Failed to prepare CAS update: %s",
@@ -2377,7 +3218,7 @@ kvidxError kvidxSqlite3CompareAndSwap(kvidxInstance *i, uint64_t key,
     sqlite3_bind_blob64(stmt, 3, newData, newDataLen, NULL);
     sqlite3_bind_int64(stmt, 4, key);
 
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
 
     if (rc != SQLITE_DONE && rc != SQLITE_OK) {
@@ -2451,8 +3292,10 @@ kvidxError kvidxSqlite3Append(kvidxInstance *i, uint64_t key, uint64_t term,
     kvidxSqlite3Get(i, key, &existingTerm, &existingCmd, NULL, NULL);
 
     sqlite3_stmt *stmt = NULL;
-    const char *sql = "UPDATE log SET data = ? WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    const char *sql = s->crcColumn ? "UPDATE log SET data = ?1, crc = "
+                                     "kvidx_crc32c(term, cmd, ?1) WHERE id = ?2"
+                                   : "UPDATE log SET data = ? WHERE id = ?";
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         free(newData);
         return KVIDX_ERROR_INTERNAL;
@@ -2460,7 +3303,7 @@ kvidxError kvidxSqlite3Append(kvidxInstance *i, uint64_t key, uint64_t term,
 
     sqlite3_bind_blob64(stmt, 1, newData, totalLen, NULL);
     sqlite3_bind_int64(stmt, 2, key);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
     free(newData);
 
@@ -2530,8 +3373,10 @@ kvidxError kvidxSqlite3Prepend(kvidxInstance *i, uint64_t key, uint64_t term,
 
     /* Update with concatenated data */
     sqlite3_stmt *stmt = NULL;
-    const char *sql = "UPDATE log SET data = ? WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    const char *sql = s->crcColumn ? "UPDATE log SET data = ?1, crc = "
+                                     "kvidx_crc32c(term, cmd, ?1) WHERE id = ?2"
+                                   : "UPDATE log SET data = ? WHERE id = ?";
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         free(newData);
         return KVIDX_ERROR_INTERNAL;
@@ -2539,7 +3384,7 @@ kvidxError kvidxSqlite3Prepend(kvidxInstance *i, uint64_t key, uint64_t term,
 
     sqlite3_bind_blob64(stmt, 1, newData, totalLen, NULL);
     sqlite3_bind_int64(stmt, 2, key);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
     free(newData);
 
@@ -2678,8 +3523,10 @@ kvidxError kvidxSqlite3SetValueRange(kvidxInstance *i, uint64_t key,
 
     /* Update record */
     sqlite3_stmt *stmt = NULL;
-    const char *sql = "UPDATE log SET data = ? WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    const char *sql = s->crcColumn ? "UPDATE log SET data = ?1, crc = "
+                                     "kvidx_crc32c(term, cmd, ?1) WHERE id = ?2"
+                                   : "UPDATE log SET data = ? WHERE id = ?";
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         free(newData);
         return KVIDX_ERROR_INTERNAL;
@@ -2687,7 +3534,7 @@ kvidxError kvidxSqlite3SetValueRange(kvidxInstance *i, uint64_t key,
 
     sqlite3_bind_blob64(stmt, 1, newData, newSize, NULL);
     sqlite3_bind_int64(stmt, 2, key);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
     free(newData);
 
@@ -2739,14 +3586,14 @@ kvidxError kvidxSqlite3SetExpire(kvidxInstance *i, uint64_t key,
     sqlite3_stmt *stmt = NULL;
     const char *sql =
         "INSERT OR REPLACE INTO _kvidx_ttl (id, expires_at) VALUES (?, ?)";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     sqlite3_bind_int64(stmt, 1, key);
     sqlite3_bind_int64(stmt, 2, expiresAt);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
 
     return (rc == SQLITE_DONE || rc == SQLITE_OK) ? KVIDX_OK
@@ -2783,14 +3630,14 @@ kvidxError kvidxSqlite3SetExpireAt(kvidxInstance *i, uint64_t key,
     sqlite3_stmt *stmt = NULL;
     const char *sql =
         "INSERT OR REPLACE INTO _kvidx_ttl (id, expires_at) VALUES (?, ?)";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     sqlite3_bind_int64(stmt, 1, key);
     sqlite3_bind_int64(stmt, 2, timestampMs);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
 
     return (rc == SQLITE_DONE || rc == SQLITE_OK) ? KVIDX_OK
@@ -2829,7 +3676,7 @@ int64_t kvidxSqlite3GetTTL(kvidxInstance *i, uint64_t key) {
     /* Query TTL */
     sqlite3_stmt *stmt = NULL;
     const char *sql = "SELECT expires_at FROM _kvidx_ttl WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         return KVIDX_TTL_NONE;
     }
@@ -2837,7 +3684,7 @@ int64_t kvidxSqlite3GetTTL(kvidxInstance *i, uint64_t key) {
     sqlite3_bind_int64(stmt, 1, key);
 
     int64_t result = KVIDX_TTL_NONE;
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
+    if (stepStatement(stmt) == SQLITE_ROW) {
         uint64_t expiresAt = sqlite3_column_int64(stmt, 0);
         uint64_t now = currentTimeMs();
         if (expiresAt <= now) {
@@ -2878,13 +3725,13 @@ kvidxError kvidxSqlite3Persist(kvidxInstance *i, uint64_t key) {
     /* Remove TTL entry */
     sqlite3_stmt *stmt = NULL;
     const char *sql = "DELETE FROM _kvidx_ttl WHERE id = ?";
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         return KVIDX_ERROR_INTERNAL;
     }
 
     sqlite3_bind_int64(stmt, 1, key);
-    rc = sqlite3_step(stmt);
+    rc = stepStatement(stmt);
     sqlite3_finalize(stmt);
 
     return (rc == SQLITE_DONE || rc == SQLITE_OK) ? KVIDX_OK
@@ -2939,7 +3786,7 @@ kvidxError kvidxSqlite3ExpireScan(kvidxInstance *i, uint64_t maxKeys,
                  "SELECT id FROM _kvidx_ttl WHERE expires_at <= ?");
     }
 
-    int rc = sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL);
+    int rc = prepareStatement(s, sql, -1, &stmt);
     if (rc != SQLITE_OK) {
         if (expiredCount) {
             *expiredCount = 0;
@@ -2959,7 +3806,7 @@ kvidxError kvidxSqlite3ExpireScan(kvidxInstance *i, uint64_t maxKeys,
         return KVIDX_ERROR_NOMEM;
     }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    while (stepStatement(stmt) == SQLITE_ROW) {
         if (keyCount >= keyCapacity) {
             keyCapacity *= 2;
             uint64_t *newKeys =
@@ -2984,14 +3831,15 @@ kvidxError kvidxSqlite3ExpireScan(kvidxInstance *i, uint64_t maxKeys,
 
         /* Delete from TTL table */
         stmt = NULL;
-        rc = sqlite3_prepare_v2(s->db, "DELETE FROM _kvidx_ttl WHERE id = ?",
-                                -1, &stmt, NULL);
+        rc = prepareStatement(s, "DELETE FROM _kvidx_ttl WHERE id = ?", -1,
+                              &stmt);
         if (rc == SQLITE_OK) {
             sqlite3_bind_int64(stmt, 1, key);
-            sqlite3_step(stmt);
+            stepStatement(stmt);
             sqlite3_finalize(stmt);
         }
 
+        kvidxChangeNoteExpired(i, key);
         expired++;
     }
 
@@ -3002,3 +3850,234 @@ kvidxError kvidxSqlite3ExpireScan(kvidxInstance *i, uint64_t maxKeys,
     }
     return KVIDX_OK;
 }
+
+/* ====================================================================
+ * Storage Replication (v0.10.0)
+ * ==================================================================== */
+
+/**
+ * @section Storage Replication
+ *
+ * The sender runs the online backup API into a scratch file next to the
+ * database, sqliteBackupPagesPerStep pages per step so other connections
+ * can commit in between, then streams the file. The receiver stages the
+ * file beside the database, closes, drops the old WAL (it belongs to the
+ * old file) and renames the copy into place before reopening.
+ *
+ * Readers from kvidxSqlite3OpenReader() should be closed before receiving.
+ */
+
+static kvidxError backupToFile(kvidxInstance *i, const char *path) {
+    kas3State *s = STATE(i);
+
+    sqlite3 *copy = NULL;
+    if (sqlite3_open_v2(path, &copy, SQLITE_OPEN_READWRITE |
+                                         SQLITE_OPEN_CREATE,
+                        NULL) != SQLITE_OK) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create %s: %s", path,
+                      sqlite3_errmsg(copy));
+        sqlite3_close(copy);
+        return KVIDX_ERROR_IO;
+    }
+
+    /* A scratch copy needs no rollback journal or syncs */
+    sqlite3_exec(copy, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF;",
+                 NULL, NULL, NULL);
+
+    sqlite3_backup *backup = sqlite3_backup_init(copy, "main", s->db, "main");
+    if (!backup) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to start backup: %s",
+                      sqlite3_errmsg(copy));
+        sqlite3_close(copy);
+        return KVIDX_ERROR_IO;
+    }
+
+    const int pages =
+        i->configInitialized && i->config.sqliteBackupPagesPerStep > 0
+            ? i->config.sqliteBackupPagesPerStep
+            : DEFAULT_BACKUP_PAGES_PER_STEP;
+    int rc;
+    int busyMs = 0;
+    do {
+        rc = sqlite3_backup_step(backup, pages);
+        if (rc == SQLITE_OK) {
+            busyMs = 0;
+        } else if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+            if (busyMs >= BACKUP_BUSY_TIMEOUT_MS) {
+                break;
+            }
+            sqlite3_sleep(BACKUP_BUSY_SLEEP_MS);
+            busyMs += BACKUP_BUSY_SLEEP_MS;
+        }
+    } while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+    sqlite3_backup_finish(backup);
+    sqlite3_close(copy);
+    if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        kvidxSetError(i, KVIDX_ERROR_LOCKED, "Backup still locked after %d ms",
+                      BACKUP_BUSY_TIMEOUT_MS);
+        return KVIDX_ERROR_LOCKED;
+    }
+    if (rc != SQLITE_DONE) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Backup failed: %s",
+                      sqlite3_errstr(rc));
+        return KVIDX_ERROR_IO;
+    }
+    return KVIDX_OK;
+}
+
+bool kvidxSqlite3CopyStorageForReplication(kvidxInstance *i,
+                                           kvidxStreamWriteCallback networkWrite,
+                                           void *networkState) {
+    const kas3State *s = STATE(i);
+    if (!sqlite3_get_autocommit(s->db)) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                               "Cannot copy storage inside a transaction");
+    }
+
+    /* In-memory databases are copied through $TMPDIR (or /tmp) */
+    const char *dbFile = sqlite3_db_filename(s->db, "main");
+    char scratch[PATH_MAX];
+    if (!dbFile || !*dbFile) {
+        const char *tmp = getenv("TMPDIR");
+        snprintf(scratch, sizeof(scratch), "%s/kvidx",
+                 tmp && *tmp ? tmp : "/tmp");
+        dbFile = scratch;
+    }
+    char *dir = kvidxReplicationTempDir(dbFile);
+    if (!dir) {
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_IO,
+                               "Failed to create snapshot directory");
+    }
+
+    char *path = malloc(strlen(dir) + sizeof("/" REPLICATION_FILE));
+    if (!path) {
+        kvidxReplicationRemoveDir(dir);
+        free(dir);
+        KVIDX_SET_ERROR_RETURN(i, KVIDX_ERROR_NOMEM, NULL);
+    }
+    strcpy(path, dir);
+    strcat(path, "/" REPLICATION_FILE);
+
+    bool sent = false;
+    if (backupToFile(i, path) == KVIDX_OK) {
+        kvidxReplicationSender sender;
+        kvidxReplicationSendBegin(&sender, networkWrite, networkState,
+                                  "sqlite3");
+        kvidxReplicationSendFile(&sender, REPLICATION_FILE, path);
+        sent = kvidxReplicationSendEnd(&sender);
+        if (!sent) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Failed to send snapshot");
+        }
+    }
+
+    kvidxReplicationRemoveDir(dir);
+    free(path);
+    free(dir);
+    return sent;
+}
+
+/**
+ * Checks shared by receiving and replacing. Creates the staging directory
+ * and copies the database path with room for a sidecar suffix.
+ */
+static kvidxError beginReplace(kvidxInstance *i, char **dir, char **path) {
+    const kas3State *s = STATE(i);
+
+    if (!sqlite3_get_autocommit(s->db)) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Cannot replace storage inside a transaction");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const char *dbFile = sqlite3_db_filename(s->db, "main");
+    if (!s->walPath || !dbFile || !*dbFile) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Cannot replace an in-memory database");
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    /* Everything below outlives the connection */
+    const size_t dbFileLen = strlen(dbFile);
+    *path = malloc(dbFileLen + sizeof("-journal"));
+    *dir = *path ? kvidxReplicationTempDir(dbFile) : NULL;
+    if (!*dir) {
+        free(*path);
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create staging directory");
+        return KVIDX_ERROR_IO;
+    }
+    memcpy(*path, dbFile, dbFileLen + 1);
+    return KVIDX_OK;
+}
+
+/**
+ * Close, drop the old WAL (it belongs to the old file) and install
+ * dir/REPLICATION_FILE as the database at path.
+ */
+static kvidxError installStaged(kvidxInstance *i, const char *dir,
+                                char *path) {
+    if (!kvidxSqlite3Close(i)) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to close database");
+        return KVIDX_ERROR_IO;
+    }
+
+    /* A leftover WAL would be replayed into the new file */
+    const size_t dbFileLen = strlen(path);
+    static const char *const sidecars[] = {"-wal", "-shm", "-journal"};
+    for (size_t n = 0; n < sizeof(sidecars) / sizeof(*sidecars); n++) {
+        strcpy(path + dbFileLen, sidecars[n]);
+        remove(path);
+    }
+    path[dbFileLen] = '\0';
+
+    char staged[PATH_MAX];
+    snprintf(staged, sizeof(staged), "%s/" REPLICATION_FILE, dir);
+    return kvidxReplicationInstall(i, staged, path, path);
+}
+
+bool kvidxSqlite3CopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead,
+    void *networkState) {
+    char *dir;
+    char *path;
+    if (beginReplace(i, &dir, &path) != KVIDX_OK) {
+        return false;
+    }
+
+    kvidxError result = kvidxReplicationReceiveFiles(
+        i, networkRead, networkState, "sqlite3", dir, REPLICATION_FILE);
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, path);
+    }
+
+    kvidxReplicationRemoveDir(dir);
+    free(dir);
+    free(path);
+    return result == KVIDX_OK;
+}
+
+/**
+ * Replace every entry with a binary export stream: import it into a new
+ * database file beside this one, then install that file as if it had been
+ * received by replication.
+ */
+kvidxError kvidxSqlite3ReplaceAll(kvidxInstance *i,
+                                  kvidxStreamReadCallback read,
+                                  void *streamData) {
+    char *dir;
+    char *path;
+    kvidxError result = beginReplace(i, &dir, &path);
+    if (result != KVIDX_OK) {
+        return result;
+    }
+
+    result = kvidxReplicationBuild(i, dir, REPLICATION_FILE, read, streamData);
+    if (result == KVIDX_OK) {
+        result = installStaged(i, dir, path);
+    }
+
+    kvidxReplicationRemoveDir(dir);
+    free(dir);
+    free(path);
+    return result;
+}
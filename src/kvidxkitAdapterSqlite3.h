@@ -6,6 +6,7 @@ __BEGIN_DECLS
 /* Open / Close / Management */
 bool kvidxSqlite3Open(kvidxInstance *i, const char *filename, const char **err);
 bool kvidxSqlite3Close(kvidxInstance *i);
+bool kvidxSqlite3OpenReader(kvidxInstance *i, kvidxInstance *reader);
 bool kvidxSqlite3Fsync(kvidxInstance *i);
 
 /* Transactional Control */
@@ -21,6 +22,11 @@ bool kvidxSqlite3GetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
 bool kvidxSqlite3GetNext(kvidxInstance *i, uint64_t previousKey,
                          uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
                          const uint8_t **data, size_t *len);
+kvidxError kvidxSqlite3ScanRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, kvidxScanVisitor visit,
+                                 void *ctx);
+kvidxError kvidxSqlite3VerifyRange(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, kvidxVerifyResult *result);
 bool kvidxSqlite3Exists(kvidxInstance *i, uint64_t key);
 bool kvidxSqlite3ExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
 bool kvidxSqlite3Max(kvidxInstance *i, uint64_t *key);
@@ -109,4 +115,21 @@ kvidxError kvidxSqlite3Persist(kvidxInstance *i, uint64_t key);
 kvidxError kvidxSqlite3ExpireScan(kvidxInstance *i, uint64_t maxKeys,
                                   uint64_t *expiredCount);
 
+/* Storage Replication */
+bool kvidxSqlite3CopyStorageForReplication(kvidxInstance *i,
+                                           kvidxStreamWriteCallback networkWrite,
+                                           void *networkState);
+bool kvidxSqlite3CopyStorageForReplicationReceive(
+    kvidxInstance *i, kvidxStreamReadCallback networkRead, void *networkState);
+kvidxError kvidxSqlite3ReplaceAll(kvidxInstance *i,
+                                  kvidxStreamReadCallback read,
+                                  void *streamData);
+
+/* Space Reclamation */
+kvidxError kvidxSqlite3ReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                                    kvidxReclaimResult *result);
+
+/* Work Counters */
+void kvidxSqlite3IoCounters(kvidxInstance *i, kvidxIoCounters *counters);
+
 __END_DECLS
@@ -0,0 +1,2086 @@
+/**
+ * @file kvidxkitAdapterTiered.c
+ * @brief Tiered hot/cold backend adapter for kvidxkit
+ *
+ * This adapter keeps the newest keys of a log in memory and everything
+ * older in a persistent adapter, so appends and reads near the tail never
+ * wait on storage while the persistent engine only sees large, sorted
+ * write batches.
+ *
+ * ## Architecture
+ *
+ * 1. **Hot tier**: A Memory adapter instance holding every key at or above
+ *    the hot floor, bounded by tieredHotMaxKeys and tieredHotMaxBytes.
+ *    Operations on keys at or above the floor never touch the cold tier.
+ *
+ * 2. **Cold tier**: Any persistent adapter from the registry
+ *    (tieredColdAdapter, the first one built in by default), stored as
+ *    "cold" inside the tiered directory. It is authoritative below the
+ *    floor and also holds flushed copies of hot keys.
+ *
+ * 3. **Dirty set**: A second Memory instance lists the hot keys changed
+ *    since they were last written to the cold tier. A dirty key missing
+ *    from the hot tier is a pending removal.
+ *
+ * 4. **Background flusher**: A thread copies dirty keys to the cold tier,
+ *    smallest first, one cold transaction per batch. It runs once
+ *    tieredFlushBatchKeys keys are dirty or the oldest change has waited
+ *    tieredFlushIntervalMs. Writers only wait for it when the hot tier is
+ *    more than twice over a limit and nothing in it can be evicted.
+ *
+ * 5. **Eviction**: While the hot tier is over a limit its smallest clean
+ *    keys are dropped and the floor moves up past them. Opening the
+ *    adapter loads the newest keys, up to half of each limit, back in.
+ *
+ * ## Routing
+ *
+ * Point operations go to the hot tier at or above the floor and to the
+ * cold tier below it; ordered reads and range operations split at the
+ * floor. Writes below the floor go straight to the cold tier, inside the
+ * caller's transaction if one is open. Range removals over keys that were
+ * already flushed also remove the cold copies synchronously.
+ *
+ * ## Durability
+ *
+ * A write is durable once the flusher has committed it to the cold tier.
+ * kvidxFsync() and kvidxClose() flush every dirty key and sync the cold
+ * tier; a crash loses what was not yet flushed. The flusher never runs
+ * while a transaction is open, so uncommitted writes never reach the cold
+ * tier.
+ *
+ * ## Memory Management
+ *
+ * Data pointers from the hot tier follow the Memory adapter's rules.
+ * Values read from the cold tier are copied into a buffer the instance
+ * owns, valid until the next read of a cold key (or, while an iterator is
+ * open, until the iterator is destroyed), since the flusher reuses the
+ * cold tier in between.
+ *
+ * ## Performance Characteristics
+ *
+ * - At or above the floor: Memory adapter speed plus a mutex and a
+ *   dirty-set update per write
+ * - Below the floor: cold adapter speed plus a copy per read
+ * - kvidxGetDataSize(), kvidxGetStats() and kvidxExport() flush first, then
+ *   ask the cold tier
+ */
+
+/* Required for clock_gettime and mkdir under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkitAdapterTiered.h"
+#include "kvidxkit_internal.h"
+#include "kvidxkitRegistry.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/** Default hot tier limits: 65536 keys, 64 MB of values */
+#define DEFAULT_HOT_MAX_KEYS 65536
+#define DEFAULT_HOT_MAX_BYTES (64ULL << 20)
+
+/** Default flush triggers: 4096 dirty keys or 1 second */
+#define DEFAULT_FLUSH_BATCH_KEYS 4096
+#define DEFAULT_FLUSH_INTERVAL_MS 1000
+
+/** Cold tier name inside the tiered directory */
+#define COLD_TIER_NAME "cold"
+
+/** Path for the in-memory instances */
+#define MEMORY_ONLY_PATH ":memory:"
+
+/**
+ * One dirty key copied out of the hot tier for a flush. A key no longer in
+ * the hot tier (present == false) is removed from the cold tier.
+ */
+typedef struct tierFlushEntry {
+    uint64_t key;
+    uint64_t seq; /**< Dirty sequence when collected */
+    uint64_t term;
+    uint64_t cmd;
+    uint64_t expiresAt; /**< Absolute ms, 0 = no expiry */
+    size_t offset;      /**< Data offset in the batch buffer */
+    size_t len;
+    bool present;
+} tierFlushEntry;
+
+typedef struct tierBatch {
+    tierFlushEntry *entries;
+    size_t count;
+    size_t capacity;
+    uint8_t *data;
+    size_t dataUsed;
+    size_t dataCapacity;
+} tierBatch;
+
+/**
+ * Internal state for a tiered instance.
+ *
+ * lock guards everything except the cold instance and coldHigh, which
+ * coldLock guards. Lock order is lock, then coldLock.
+ */
+typedef struct tierState {
+    kvidxInstance hot;   /**< Every live key >= floor */
+    kvidxInstance dirty; /**< Hot keys not yet flushed; term = sequence */
+    kvidxInstance cold;  /**< Persistent tier */
+    bool hotOpen;
+    bool dirtyOpen;
+    bool coldOpen;
+
+    uint64_t floor;     /**< The hot tier is complete from here up */
+    uint64_t coldBelow; /**< Cold keys below the floor */
+    uint64_t coldHigh;  /**< No cold key is above this (if coldHighSet) */
+    bool coldHighSet;
+    uint64_t seq; /**< Dirty sequence counter */
+
+    /* Limits (runtime changeable) */
+    uint64_t hotMaxKeys;
+    uint64_t hotMaxBytes;
+    uint64_t flushBatchKeys;
+    uint64_t flushIntervalMs;
+
+    /* Transaction state */
+    bool inTxn;
+    bool coldInTxn;   /**< The cold tier joined the caller's transaction */
+    bool syncPending; /**< kvidxFsync() inside the transaction */
+    uint64_t txnColdBelow;
+
+    /* Copies of cold values handed to callers */
+    uint8_t *readBuf;
+    size_t readCapacity;
+    uint32_t pins;
+    uint8_t **pinned;
+    size_t pinnedCount;
+    size_t pinnedCapacity;
+
+    /* Background flusher */
+    pthread_mutex_t lock;
+    pthread_mutex_t coldLock;
+    pthread_cond_t wake;    /**< Wakes the flusher */
+    pthread_cond_t flushed; /**< Wakes writers waiting on the flusher */
+    pthread_t flusher;
+    bool flusherRunning;
+    bool stop;
+    bool flushNow;
+    uint64_t dirtySinceMs; /**< When the dirty set last became non-empty */
+    kvidxError flushError; /**< Result of the last background flush */
+    tierBatch flusherBatch;
+    tierBatch drainBatch;
+} tierState;
+
+#define STATE(instance) ((tierState *)(instance)->kvidxdata)
+
+/* ====================================================================
+ * Helpers
+ * ==================================================================== */
+
+static uint64_t clockMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static struct timespec deadlineAt(uint64_t atMs) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(atMs / 1000);
+    ts.tv_nsec = (long)(atMs % 1000) * 1000000;
+    return ts;
+}
+
+/**
+ * Report a tier's last failure on the tiered instance.
+ */
+static void tierError(kvidxInstance *i, kvidxInstance *tier) {
+    kvidxError err = kvidxGetLastError(tier);
+    kvidxSetError(i, err != KVIDX_OK ? err : KVIDX_ERROR_IO, "%s",
+                  kvidxGetLastErrorMessage(tier));
+}
+
+static void setLimits(tierState *s, const kvidxConfig *config) {
+    s->hotMaxKeys = config->tieredHotMaxKeys ? config->tieredHotMaxKeys
+                                             : DEFAULT_HOT_MAX_KEYS;
+    s->hotMaxBytes = config->tieredHotMaxBytes ? config->tieredHotMaxBytes
+                                               : DEFAULT_HOT_MAX_BYTES;
+    s->flushBatchKeys = config->tieredFlushBatchKeys
+                            ? config->tieredFlushBatchKeys
+                            : DEFAULT_FLUSH_BATCH_KEYS;
+    s->flushIntervalMs = config->tieredFlushIntervalMs > 0
+                             ? (uint64_t)config->tieredFlushIntervalMs
+                             : DEFAULT_FLUSH_INTERVAL_MS;
+}
+
+/* --- Cold tier access --- */
+
+static void coldEnter(tierState *s) {
+    pthread_mutex_lock(&s->coldLock);
+}
+
+static void coldLeave(tierState *s) {
+    pthread_mutex_unlock(&s->coldLock);
+}
+
+/**
+ * Inside a caller's transaction, make the cold tier part of it so Commit()
+ * and Abort() cover both tiers. Called with coldLock held.
+ */
+static bool coldJoinTxn(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    if (!s->inTxn || s->coldInTxn) {
+        return true;
+    }
+
+    if (!kvidxBegin(&s->cold)) {
+        tierError(i, &s->cold);
+        return false;
+    }
+    s->coldInTxn = true;
+    return true;
+}
+
+static bool coldEnterWrite(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    coldEnter(s);
+    if (!coldJoinTxn(i)) {
+        coldLeave(s);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Enter the cold tier for a single-key write below the floor, noting
+ * whether the key exists so coldWriteLeave() can keep coldBelow exact.
+ */
+static kvidxError coldWriteEnter(kvidxInstance *i, uint64_t key,
+                                 bool *existed) {
+    if (!coldEnterWrite(i)) {
+        return kvidxGetLastError(i);
+    }
+    *existed = kvidxExists(&STATE(i)->cold, key);
+    return KVIDX_OK;
+}
+
+static void coldWriteLeave(tierState *s, uint64_t key, bool existed) {
+    const bool exists = kvidxExists(&s->cold, key);
+    if (exists && !existed) {
+        s->coldBelow++;
+    } else if (!exists && existed) {
+        s->coldBelow--;
+    }
+    coldLeave(s);
+}
+
+/**
+ * Replace a data pointer from the cold tier with a copy the instance owns.
+ * Cold pointers die at the flusher's next batch, so they are never handed
+ * out directly.
+ */
+static bool keepColdData(kvidxInstance *i, const uint8_t **data, size_t len) {
+    tierState *s = STATE(i);
+    if (!data || !*data || len == 0) {
+        return true;
+    }
+
+    uint8_t *copy;
+    if (s->pins) {
+        /* An iterator is open: every copy lives until it is destroyed */
+        if (s->pinnedCount == s->pinnedCapacity) {
+            size_t capacity = s->pinnedCapacity ? s->pinnedCapacity * 2 : 16;
+            uint8_t **pinned = realloc(s->pinned, capacity * sizeof(*pinned));
+            if (!pinned) {
+                goto nomem;
+            }
+            s->pinned = pinned;
+            s->pinnedCapacity = capacity;
+        }
+
+        copy = malloc(len);
+        if (!copy) {
+            goto nomem;
+        }
+        s->pinned[s->pinnedCount++] = copy;
+    } else {
+        if (len > s->readCapacity) {
+            uint8_t *buf = realloc(s->readBuf, len);
+            if (!buf) {
+                goto nomem;
+            }
+            s->readBuf = buf;
+            s->readCapacity = len;
+        }
+        copy = s->readBuf;
+    }
+
+    memcpy(copy, *data, len);
+    *data = copy;
+    return true;
+
+nomem:
+    kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to copy cold tier value");
+    return false;
+}
+
+/**
+ * Find the largest cold key below bound (bound <= floor).
+ */
+static bool coldPrev(kvidxInstance *i, uint64_t bound, uint64_t *prevKey,
+                     uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                     size_t *len) {
+    tierState *s = STATE(i);
+    uint64_t key = 0;
+    size_t n = 0;
+    bool found = false;
+
+    if (bound == 0) {
+        return false;
+    }
+
+    coldEnter(s);
+    if (bound < UINT64_MAX) {
+        found = kvidxGetPrev(&s->cold, bound, &key, prevTerm, cmd, data, &n);
+    } else {
+        /* GetPrev(UINT64_MAX) would include UINT64_MAX itself */
+        key = UINT64_MAX - 1;
+        found =
+            kvidxGet(&s->cold, key, prevTerm, cmd, data, &n) ||
+            kvidxGetPrev(&s->cold, key, &key, prevTerm, cmd, data, &n);
+    }
+    found = found && keepColdData(i, data, n);
+    coldLeave(s);
+
+    if (found) {
+        if (prevKey) {
+            *prevKey = key;
+        }
+        if (len) {
+            *len = n;
+        }
+    }
+    return found;
+}
+
+/* ====================================================================
+ * Dirty Tracking and Flushing
+ * ==================================================================== */
+
+/**
+ * Record that a hot key changed since the cold tier last saw it.
+ */
+static bool markDirty(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+    uint64_t dirtyCount = 0;
+    kvidxGetKeyCount(&s->dirty, &dirtyCount);
+
+    kvidxError result = kvidxInsertEx(&s->dirty, key, ++s->seq, 0, NULL, 0,
+                                      KVIDX_SET_ALWAYS);
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Failed to track unflushed key");
+        return false;
+    }
+
+    if (dirtyCount == 0) {
+        /* Start the flush interval clock */
+        s->dirtySinceMs = clockMs();
+        pthread_cond_signal(&s->wake);
+    }
+    return true;
+}
+
+/**
+ * Finish a hot write: mark the key dirty when the write changed it.
+ */
+static kvidxError hotWritten(kvidxInstance *i, uint64_t key,
+                             kvidxError result) {
+    if (result == KVIDX_OK && !markDirty(i, key)) {
+        return KVIDX_ERROR_NOMEM;
+    }
+    return result;
+}
+
+static bool batchReserve(tierBatch *b, size_t dataLen) {
+    if (b->count == b->capacity) {
+        size_t capacity = b->capacity ? b->capacity * 2 : 256;
+        tierFlushEntry *entries =
+            realloc(b->entries, capacity * sizeof(*entries));
+        if (!entries) {
+            return false;
+        }
+        b->entries = entries;
+        b->capacity = capacity;
+    }
+
+    if (b->dataUsed + dataLen > b->dataCapacity) {
+        size_t capacity = b->dataCapacity ? b->dataCapacity : 64 * 1024;
+        while (capacity < b->dataUsed + dataLen) {
+            capacity *= 2;
+        }
+        uint8_t *data = realloc(b->data, capacity);
+        if (!data) {
+            return false;
+        }
+        b->data = data;
+        b->dataCapacity = capacity;
+    }
+    return true;
+}
+
+static void batchFree(tierBatch *b) {
+    free(b->entries);
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+/**
+ * Copy up to limit dirty keys, smallest first, out of the hot tier.
+ * Called with lock held.
+ */
+static kvidxError collectBatch(tierState *s, tierBatch *b, uint64_t limit) {
+    b->count = 0;
+    b->dataUsed = 0;
+
+    uint64_t key = 0;
+    uint64_t seq = 0;
+    bool found = kvidxGetMinKey(&s->dirty, &key) == KVIDX_OK &&
+                 kvidxGet(&s->dirty, key, &seq, NULL, NULL, NULL);
+    const uint64_t now = clockMs();
+
+    while (found && b->count < limit) {
+        uint64_t term = 0;
+        uint64_t cmd = 0;
+        const uint8_t *data = NULL;
+        size_t len = 0;
+        const bool present =
+            kvidxGet(&s->hot, key, &term, &cmd, &data, &len);
+
+        if (!batchReserve(b, len)) {
+            return KVIDX_ERROR_NOMEM;
+        }
+
+        tierFlushEntry *e = &b->entries[b->count++];
+        e->key = key;
+        e->seq = seq;
+        e->term = term;
+        e->cmd = cmd;
+        e->expiresAt = 0;
+        e->offset = b->dataUsed;
+        e->len = len;
+        e->present = present;
+
+        if (present) {
+            if (len) {
+                memcpy(b->data + b->dataUsed, data, len);
+                b->dataUsed += len;
+            }
+
+            int64_t ttl = kvidxGetTTL(&s->hot, key);
+            if (ttl >= 0) {
+                e->expiresAt = now + (uint64_t)ttl;
+            }
+        }
+
+        found = key < UINT64_MAX &&
+                kvidxGetNext(&s->dirty, key, &key, &seq, NULL, NULL, NULL);
+    }
+
+    return KVIDX_OK;
+}
+
+/**
+ * Write a batch to the cold tier, in its own cold transaction unless the
+ * cold tier already joined the caller's. Called with coldLock held.
+ */
+static kvidxError applyBatch(tierState *s, const tierBatch *b) {
+    const bool ownTxn = !s->coldInTxn;
+    if (ownTxn && !kvidxBegin(&s->cold)) {
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxError result = KVIDX_OK;
+    uint64_t high = 0;
+    bool anyPresent = false;
+
+    for (size_t n = 0; n < b->count && result == KVIDX_OK; n++) {
+        const tierFlushEntry *e = &b->entries[n];
+        if (!e->present) {
+            if (!kvidxRemove(&s->cold, e->key)) {
+                result = KVIDX_ERROR_IO;
+            }
+            continue;
+        }
+
+        result = kvidxInsertEx(&s->cold, e->key, e->term, e->cmd,
+                               e->len ? b->data + e->offset : NULL, e->len,
+                               KVIDX_SET_ALWAYS);
+        if (result == KVIDX_OK && e->expiresAt) {
+            result = kvidxSetExpireAt(&s->cold, e->key, e->expiresAt);
+        }
+        high = e->key;
+        anyPresent = true;
+    }
+
+    if (ownTxn) {
+        if (result == KVIDX_OK && !kvidxCommit(&s->cold)) {
+            result = KVIDX_ERROR_IO;
+        }
+        if (result != KVIDX_OK) {
+            kvidxAbort(&s->cold);
+        }
+    }
+
+    /* Batches are sorted, so the last present key is the highest */
+    if (result == KVIDX_OK && anyPresent &&
+        (!s->coldHighSet || high > s->coldHigh)) {
+        s->coldHigh = high;
+        s->coldHighSet = true;
+    }
+    return result;
+}
+
+/**
+ * Forget flushed keys that did not change again while the batch was being
+ * written. Called with lock held.
+ */
+static void clearBatch(tierState *s, const tierBatch *b) {
+    for (size_t n = 0; n < b->count; n++) {
+        const tierFlushEntry *e = &b->entries[n];
+        uint64_t seq = 0;
+        if (kvidxGet(&s->dirty, e->key, &seq, NULL, NULL, NULL) &&
+            seq == e->seq) {
+            kvidxRemove(&s->dirty, e->key);
+        }
+    }
+}
+
+/**
+ * Flush every dirty key on the caller's thread. Inside a transaction the
+ * keys go into the caller's cold transaction. Called with lock held.
+ */
+static bool flushAll(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    uint64_t dirtyCount = 0;
+    kvidxGetKeyCount(&s->dirty, &dirtyCount);
+    if (dirtyCount == 0) {
+        return true;
+    }
+
+    if (!coldEnterWrite(i)) {
+        return false;
+    }
+
+    bool ok = true;
+    while (dirtyCount) {
+        kvidxError result =
+            collectBatch(s, &s->drainBatch, s->flushBatchKeys);
+        if (result == KVIDX_OK) {
+            result = applyBatch(s, &s->drainBatch);
+        }
+
+        if (result != KVIDX_OK) {
+            kvidxSetError(i, result, "Flush to the cold tier failed: %s",
+                          kvidxGetLastErrorMessage(&s->cold));
+            ok = false;
+            break;
+        }
+
+        clearBatch(s, &s->drainBatch);
+        kvidxGetKeyCount(&s->dirty, &dirtyCount);
+    }
+    coldLeave(s);
+
+    pthread_cond_broadcast(&s->flushed);
+    return ok;
+}
+
+static bool syncCold(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    coldEnter(s);
+    bool ok = kvidxFsync(&s->cold);
+    if (!ok) {
+        tierError(i, &s->cold);
+    }
+    coldLeave(s);
+    return ok;
+}
+
+static void *flusherMain(void *arg) {
+    tierState *s = arg;
+    uint64_t retryAtMs = 0;
+
+    pthread_mutex_lock(&s->lock);
+    while (!s->stop) {
+        uint64_t dirtyCount = 0;
+        kvidxGetKeyCount(&s->dirty, &dirtyCount);
+        if (s->inTxn || dirtyCount == 0) {
+            pthread_cond_wait(&s->wake, &s->lock);
+            continue;
+        }
+
+        const uint64_t nowMs = clockMs();
+        uint64_t runAtMs = s->flushNow || dirtyCount >= s->flushBatchKeys
+                               ? 0
+                               : s->dirtySinceMs + s->flushIntervalMs;
+        if (runAtMs < retryAtMs) {
+            runAtMs = retryAtMs;
+        }
+        if (nowMs < runAtMs) {
+            struct timespec deadline = deadlineAt(runAtMs);
+            pthread_cond_timedwait(&s->wake, &s->lock, &deadline);
+            continue;
+        }
+
+        kvidxError result =
+            collectBatch(s, &s->flusherBatch, s->flushBatchKeys);
+        if (result == KVIDX_OK) {
+            /* Take the cold tier before letting writers back in, so no
+             * synchronous cold removal lands between collecting the batch
+             * and writing it. */
+            coldEnter(s);
+            pthread_mutex_unlock(&s->lock);
+            result = applyBatch(s, &s->flusherBatch);
+            coldLeave(s);
+            pthread_mutex_lock(&s->lock);
+        }
+
+        if (result == KVIDX_OK) {
+            clearBatch(s, &s->flusherBatch);
+            s->flushNow = false;
+            s->dirtySinceMs = clockMs();
+            retryAtMs = 0;
+        } else {
+            retryAtMs = clockMs() + s->flushIntervalMs;
+        }
+        s->flushError = result;
+        pthread_cond_broadcast(&s->flushed);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+static void stopFlusher(tierState *s) {
+    if (!s->flusherRunning) {
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = true;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->flusher, NULL);
+    s->flusherRunning = false;
+}
+
+/* ====================================================================
+ * Eviction
+ * ==================================================================== */
+
+/**
+ * Drop clean keys from the bottom of the hot tier until it fits its
+ * limits, raising the floor past them. Stops at the first dirty key or
+ * pending removal, which must reach the cold tier first. The newest key
+ * always stays, so the floor never passes UINT64_MAX.
+ *
+ * @return true if the hot tier is still more than twice over a limit
+ */
+static bool evictClean(tierState *s) {
+    for (;;) {
+        uint64_t keys = 0;
+        uint64_t bytes = 0;
+        kvidxGetKeyCount(&s->hot, &keys);
+        kvidxGetDataSize(&s->hot, &bytes);
+        if (keys <= 1 || (keys <= s->hotMaxKeys && bytes <= s->hotMaxBytes)) {
+            return false;
+        }
+
+        uint64_t hotMin = 0;
+        uint64_t dirtyMin = 0;
+        kvidxGetMinKey(&s->hot, &hotMin);
+        if (kvidxGetMinKey(&s->dirty, &dirtyMin) == KVIDX_OK &&
+            dirtyMin <= hotMin) {
+            s->flushNow = true;
+            pthread_cond_signal(&s->wake);
+            return keys / 2 > s->hotMaxKeys || bytes / 2 > s->hotMaxBytes;
+        }
+
+        if (!kvidxRemove(&s->hot, hotMin)) {
+            return false;
+        }
+        s->floor = hotMin + 1;
+        s->coldBelow++;
+    }
+}
+
+/**
+ * Housekeeping after a write outside a transaction: evict clean keys,
+ * wake the flusher for a full batch, and hold the writer back while the
+ * hot tier cannot shrink. Called with lock held.
+ */
+static void afterWrite(tierState *s) {
+    if (s->inTxn) {
+        return;
+    }
+
+    while (evictClean(s) && s->flusherRunning &&
+           s->flushError == KVIDX_OK) {
+        pthread_cond_wait(&s->flushed, &s->lock);
+    }
+
+    uint64_t dirtyCount = 0;
+    kvidxGetKeyCount(&s->dirty, &dirtyCount);
+    if (dirtyCount >= s->flushBatchKeys) {
+        pthread_cond_signal(&s->wake);
+    }
+}
+
+/**
+ * Load the newest cold keys, up to half of each hot limit, into the empty
+ * hot tier and set the floor below them. Called with lock and coldLock
+ * held, or before the flusher starts.
+ */
+static bool loadTail(tierState *s) {
+    uint64_t coldKeys = 0;
+    if (kvidxGetKeyCount(&s->cold, &coldKeys) != KVIDX_OK) {
+        return false;
+    }
+
+    s->floor = 0;
+    s->coldBelow = coldKeys;
+    s->coldHighSet = false;
+
+    const uint64_t maxKeys = s->hotMaxKeys > 1 ? s->hotMaxKeys / 2 : 1;
+    const uint64_t maxBytes = s->hotMaxBytes / 2;
+    const uint64_t now = clockMs();
+    uint64_t loaded = 0;
+    uint64_t bytes = 0;
+
+    uint64_t key = 0;
+    uint64_t term = 0;
+    uint64_t cmd = 0;
+    const uint8_t *data = NULL;
+    size_t len = 0;
+    bool found = kvidxGetPrev(&s->cold, UINT64_MAX, &key, &term, &cmd, &data,
+                              &len);
+    if (found) {
+        s->coldHigh = key;
+        s->coldHighSet = true;
+    }
+
+    while (found) {
+        if (loaded && (loaded >= maxKeys || bytes + len > maxBytes)) {
+            break;
+        }
+
+        if (!kvidxInsert(&s->hot, key, term, cmd, data, len)) {
+            return false;
+        }
+
+        int64_t ttl = kvidxGetTTL(&s->cold, key);
+        if (ttl >= 0 && kvidxSetExpireAt(&s->hot, key,
+                                         now + (uint64_t)ttl) != KVIDX_OK) {
+            return false;
+        }
+
+        loaded++;
+        bytes += len;
+        s->floor = key;
+        found = key > 0 &&
+                kvidxGetPrev(&s->cold, key, &key, &term, &cmd, &data, &len);
+    }
+
+    if (!found) {
+        /* Everything fit: the hot tier is complete for every key */
+        s->floor = 0;
+    }
+    s->coldBelow = coldKeys - loaded;
+    return true;
+}
+
+/* ====================================================================
+ * Transactional Control
+ * ==================================================================== */
+
+bool kvidxTieredBegin(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    bool ok = true;
+
+    pthread_mutex_lock(&s->lock);
+    if (!s->inTxn) {
+        ok = kvidxBegin(&s->hot) && kvidxBegin(&s->dirty);
+        if (ok) {
+            s->inTxn = true;
+            s->txnColdBelow = s->coldBelow;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+/**
+ * Roll back every tier. Called with lock held.
+ */
+static bool abortLocked(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    bool ok = true;
+
+    if (s->coldInTxn) {
+        coldEnter(s);
+        ok = kvidxAbort(&s->cold);
+        s->coldInTxn = false;
+        coldLeave(s);
+    }
+
+    ok = kvidxAbort(&s->hot) && ok;
+    ok = kvidxAbort(&s->dirty) && ok;
+    s->coldBelow = s->txnColdBelow;
+    s->inTxn = false;
+    s->syncPending = false;
+
+    /* The flusher waits for transactions to end */
+    pthread_cond_signal(&s->wake);
+    return ok;
+}
+
+bool kvidxTieredCommit(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    bool ok = true;
+
+    pthread_mutex_lock(&s->lock);
+    if (!s->inTxn) {
+        pthread_mutex_unlock(&s->lock);
+        return true;
+    }
+
+    if (s->coldInTxn) {
+        coldEnter(s);
+        ok = kvidxCommit(&s->cold);
+        if (ok) {
+            s->coldInTxn = false;
+        } else {
+            tierError(i, &s->cold);
+        }
+        coldLeave(s);
+    }
+
+    if (!ok) {
+        /* Keep the tiers consistent: the hot side goes too */
+        abortLocked(i);
+    } else {
+        kvidxCommit(&s->hot);
+        kvidxCommit(&s->dirty);
+        s->inTxn = false;
+        pthread_cond_signal(&s->wake);
+
+        if (s->syncPending) {
+            s->syncPending = false;
+            ok = flushAll(i) && syncCold(i);
+        }
+        afterWrite(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+bool kvidxTieredAbort(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    bool ok = true;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->inTxn) {
+        ok = abortLocked(i);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+/* ====================================================================
+ * Data Manipulation
+ * ==================================================================== */
+
+bool kvidxTieredGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                    uint64_t *cmd, const uint8_t **data, size_t *len) {
+    tierState *s = STATE(i);
+    bool found;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        found = kvidxGet(&s->hot, key, term, cmd, data, len);
+    } else {
+        size_t n = 0;
+        coldEnter(s);
+        found = kvidxGet(&s->cold, key, term, cmd, data, &n) &&
+                keepColdData(i, data, n);
+        coldLeave(s);
+        if (found && len) {
+            *len = n;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+}
+
+/**
+ * Find the record with the largest key less than nextKey. As with the
+ * other adapters, nextKey == UINT64_MAX returns the maximum key.
+ */
+bool kvidxTieredGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
+                        uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                        size_t *len) {
+    tierState *s = STATE(i);
+    bool found = false;
+
+    pthread_mutex_lock(&s->lock);
+    if (nextKey > s->floor || nextKey == UINT64_MAX) {
+        found = kvidxGetPrev(&s->hot, nextKey, prevKey, prevTerm, cmd, data,
+                             len);
+    }
+    if (!found) {
+        found = coldPrev(i, nextKey < s->floor ? nextKey : s->floor, prevKey,
+                         prevTerm, cmd, data, len);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+}
+
+/**
+ * Find the record with the smallest key greater than previousKey.
+ */
+bool kvidxTieredGetNext(kvidxInstance *i, uint64_t previousKey,
+                        uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
+                        const uint8_t **data, size_t *len) {
+    tierState *s = STATE(i);
+    bool found = false;
+    bool inCold = false;
+
+    pthread_mutex_lock(&s->lock);
+    if (previousKey < UINT64_MAX && previousKey + 1 < s->floor) {
+        uint64_t key = 0;
+        size_t n = 0;
+        coldEnter(s);
+        inCold = kvidxGetNext(&s->cold, previousKey, &key, nextTerm, cmd,
+                              data, &n) &&
+                 key < s->floor;
+        found = inCold && keepColdData(i, data, n);
+        coldLeave(s);
+
+        if (found) {
+            if (nextKey) {
+                *nextKey = key;
+            }
+            if (len) {
+                *len = n;
+            }
+        }
+    }
+
+    if (!inCold) {
+        found = kvidxGetNext(&s->hot, previousKey, nextKey, nextTerm, cmd,
+                             data, len);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+}
+
+bool kvidxTieredExists(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+    bool exists;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        exists = kvidxExists(&s->hot, key);
+    } else {
+        coldEnter(s);
+        exists = kvidxExists(&s->cold, key);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return exists;
+}
+
+bool kvidxTieredExistsDual(kvidxInstance *i, uint64_t key, uint64_t term) {
+    tierState *s = STATE(i);
+    bool exists;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        exists = kvidxExistsDual(&s->hot, key, term);
+    } else {
+        coldEnter(s);
+        exists = kvidxExistsDual(&s->cold, key, term);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return exists;
+}
+
+bool kvidxTieredMax(kvidxInstance *i, uint64_t *key) {
+    tierState *s = STATE(i);
+
+    pthread_mutex_lock(&s->lock);
+    bool found = kvidxMaxKey(&s->hot, key) ||
+                 coldPrev(i, s->floor, key, NULL, NULL, NULL, NULL);
+    pthread_mutex_unlock(&s->lock);
+
+    return found;
+}
+
+/**
+ * Insert a new record. Fails on duplicate keys, matching the other adapters.
+ */
+bool kvidxTieredInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen) {
+    tierState *s = STATE(i);
+    bool ok;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        ok = kvidxInsert(&s->hot, key, term, cmd, data, dataLen);
+        if (!ok) {
+            tierError(i, &s->hot);
+        } else {
+            ok = markDirty(i, key);
+        }
+    } else {
+        ok = coldEnterWrite(i);
+        if (ok) {
+            ok = kvidxInsert(&s->cold, key, term, cmd, data, dataLen);
+            if (ok) {
+                s->coldBelow++;
+            } else {
+                tierError(i, &s->cold);
+            }
+            coldLeave(s);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+/**
+ * Remove keys lo..hi (inclusive) from both tiers. Called with lock held.
+ *
+ * Removing one hot key just marks it dirty; the flusher deletes the cold
+ * copy. Removing a hot range deletes cold copies directly, unless nothing
+ * in the range was ever flushed.
+ */
+static kvidxError removeKeys(kvidxInstance *i, uint64_t lo, uint64_t hi,
+                             uint64_t *deletedCount) {
+    tierState *s = STATE(i);
+    uint64_t total = 0;
+    kvidxError result = KVIDX_OK;
+
+    if (deletedCount) {
+        *deletedCount = 0;
+    }
+    if (lo > hi) {
+        return KVIDX_OK;
+    }
+
+    if (lo < s->floor) {
+        const uint64_t coldHi = hi < s->floor ? hi : s->floor - 1;
+        uint64_t n = 0;
+        if (!coldEnterWrite(i)) {
+            return kvidxGetLastError(i);
+        }
+        result = kvidxRemoveRange(&s->cold, lo, coldHi, true, true, &n);
+        coldLeave(s);
+        if (result != KVIDX_OK) {
+            return result;
+        }
+        s->coldBelow -= n;
+        total += n;
+    }
+
+    if (hi >= s->floor) {
+        const uint64_t hotLo = lo > s->floor ? lo : s->floor;
+        uint64_t n = 0;
+        result = kvidxRemoveRange(&s->hot, hotLo, hi, true, true, &n);
+        if (result != KVIDX_OK) {
+            return result;
+        }
+        total += n;
+
+        if (n && hotLo == hi) {
+            if (!markDirty(i, hotLo)) {
+                return KVIDX_ERROR_NOMEM;
+            }
+        } else if (n) {
+            /* coldHigh is only current once no batch is in flight */
+            coldEnter(s);
+            if (s->coldHighSet && s->coldHigh >= hotLo) {
+                if (coldJoinTxn(i)) {
+                    result = kvidxRemoveRange(&s->cold, hotLo, hi, true,
+                                              true, NULL);
+                } else {
+                    result = kvidxGetLastError(i);
+                }
+            }
+            coldLeave(s);
+
+            /* The cold tier has none of these keys now */
+            if (result == KVIDX_OK) {
+                result =
+                    kvidxRemoveRange(&s->dirty, hotLo, hi, true, true, NULL);
+            }
+        }
+    }
+
+    if (deletedCount) {
+        *deletedCount = total;
+    }
+    return result;
+}
+
+/**
+ * Delete a record by key. Removing a missing key succeeds.
+ */
+bool kvidxTieredRemove(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+
+    pthread_mutex_lock(&s->lock);
+    bool ok = removeKeys(i, key, key, NULL) == KVIDX_OK;
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+bool kvidxTieredRemoveAfterNInclusive(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+
+    pthread_mutex_lock(&s->lock);
+    bool ok = removeKeys(i, key, UINT64_MAX, NULL) == KVIDX_OK;
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+bool kvidxTieredRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+
+    pthread_mutex_lock(&s->lock);
+    bool ok = removeKeys(i, 0, key, NULL) == KVIDX_OK;
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+/**
+ * Flush every dirty key and sync the cold tier. Inside a transaction this
+ * happens at Commit().
+ */
+bool kvidxTieredFsync(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    bool ok = true;
+
+    pthread_mutex_lock(&s->lock);
+    if (s->inTxn) {
+        s->syncPending = true;
+    } else {
+        ok = flushAll(i) && syncCold(i);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ok;
+}
+
+/* ====================================================================
+ * Bring-Up / Teardown
+ * ==================================================================== */
+
+/**
+ * Resolve the cold tier adapter: the configured name, or the first
+ * persistent adapter in the registry.
+ */
+static const kvidxAdapterInfo *coldAdapterFor(const char *name) {
+    if (name) {
+        const kvidxAdapterInfo *info = kvidxGetAdapterByName(name);
+        return info && info->iface != &kvidxInterfaceTiered ? info : NULL;
+    }
+
+    for (size_t n = 0; n < kvidxGetAdapterCount(); n++) {
+        const kvidxAdapterInfo *info = kvidxGetAdapterByIndex(n);
+        if (info->iface != &kvidxInterfaceTiered &&
+            info->iface != &kvidxInterfaceMemory) {
+            return info;
+        }
+    }
+    return NULL;
+}
+
+static void freeState(kvidxInstance *i) {
+    tierState *s = STATE(i);
+
+    if (s->coldOpen) {
+        kvidxClose(&s->cold);
+    }
+    if (s->dirtyOpen) {
+        kvidxClose(&s->dirty);
+    }
+    if (s->hotOpen) {
+        kvidxClose(&s->hot);
+    }
+
+    for (size_t n = 0; n < s->pinnedCount; n++) {
+        free(s->pinned[n]);
+    }
+    free(s->pinned);
+    free(s->readBuf);
+    batchFree(&s->flusherBatch);
+    batchFree(&s->drainBatch);
+
+    pthread_cond_destroy(&s->flushed);
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->coldLock);
+    pthread_mutex_destroy(&s->lock);
+
+    free(i->kvidxdata);
+    i->kvidxdata = NULL;
+}
+
+/**
+ * Open a tiered database in the directory filename (created if missing).
+ *
+ * The cold tier lives in filename/cold plus the cold adapter's path
+ * suffix. The cold adapter is fixed at open; using a different one later
+ * starts from an empty cold tier.
+ */
+bool kvidxTieredOpen(kvidxInstance *i, const char *filename,
+                     const char **errStr) {
+    const char *localErr = NULL;
+    if (!errStr) {
+        errStr = &localErr;
+    }
+
+    const kvidxConfig config =
+        i->configInitialized ? i->config : kvidxConfigDefault();
+    const kvidxAdapterInfo *coldInfo =
+        coldAdapterFor(config.tieredColdAdapter);
+    if (!coldInfo) {
+        *errStr = config.tieredColdAdapter
+                      ? "Unknown or unusable cold tier adapter"
+                      : "No persistent adapter available for the cold tier";
+        return false;
+    }
+
+    if (!filename || !filename[0]) {
+        *errStr = "Tiered adapter requires a directory path";
+        return false;
+    }
+
+    if (mkdir(filename, 0755) != 0 && errno != EEXIST) {
+        *errStr = "Failed to create tiered directory";
+        return false;
+    }
+
+    size_t pathLen = strlen(filename) + sizeof("/" COLD_TIER_NAME) +
+                     strlen(coldInfo->pathSuffix);
+    char *coldPath = malloc(pathLen);
+    if (!coldPath) {
+        *errStr = "Memory allocation failed";
+        return false;
+    }
+    snprintf(coldPath, pathLen, "%s/%s%s", filename, COLD_TIER_NAME,
+             coldInfo->pathSuffix);
+
+    i->kvidxdata = calloc(1, sizeof(tierState));
+    if (!i->kvidxdata) {
+        free(coldPath);
+        *errStr = "Memory allocation failed";
+        return false;
+    }
+
+    tierState *s = STATE(i);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_mutex_init(&s->coldLock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+    pthread_cond_init(&s->flushed, NULL);
+    setLimits(s, &config);
+
+    s->hot.interface = kvidxInterfaceMemory;
+    s->hotOpen = kvidxOpen(&s->hot, MEMORY_ONLY_PATH, errStr);
+
+    s->dirty.interface = kvidxInterfaceMemory;
+    s->dirtyOpen = s->hotOpen && kvidxOpen(&s->dirty, MEMORY_ONLY_PATH, errStr);
+
+    s->cold.interface = *coldInfo->iface;
+    s->cold.config = config;
+    s->cold.config.metrics = false; /* Timed once, on the tiered instance */
+    s->cold.configInitialized = i->configInitialized;
+    s->coldOpen = s->dirtyOpen && kvidxOpen(&s->cold, coldPath, errStr);
+    free(coldPath);
+
+    if (!s->coldOpen) {
+        freeState(i);
+        return false;
+    }
+
+    if (!loadTail(s)) {
+        *errStr = "Failed to load newest keys into memory";
+        freeState(i);
+        return false;
+    }
+
+    if (pthread_create(&s->flusher, NULL, flusherMain, s) != 0) {
+        *errStr = "Failed to start flusher thread";
+        freeState(i);
+        return false;
+    }
+    s->flusherRunning = true;
+
+    /* Call custom init if provided */
+    if (i->customInit) {
+        i->customInit(i);
+    }
+
+    return true;
+}
+
+/**
+ * Close the database: discard any open transaction, flush every dirty key
+ * and sync the cold tier.
+ *
+ * IMPORTANT: All data pointers returned from Get() become invalid after close.
+ */
+bool kvidxTieredClose(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    if (!s) {
+        return true;
+    }
+
+    stopFlusher(s);
+
+    pthread_mutex_lock(&s->lock);
+    if (s->inTxn) {
+        abortLocked(i);
+    }
+    bool ok = flushAll(i) && syncCold(i);
+    pthread_mutex_unlock(&s->lock);
+
+    freeState(i);
+    return ok;
+}
+
+/* ====================================================================
+ * Iterator Read Pins
+ * ==================================================================== */
+
+/**
+ * Keep hot values and cold copies handed out from now on alive until the
+ * matching unpin.
+ */
+void kvidxTieredPinReads(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    if (!s) {
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->pins++;
+    s->hot.interface.pinReads(&s->hot);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void kvidxTieredUnpinReads(kvidxInstance *i) {
+    tierState *s = STATE(i);
+    if (!s || !s->pins) {
+        return;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->hot.interface.unpinReads(&s->hot);
+    if (--s->pins == 0) {
+        for (size_t n = 0; n < s->pinnedCount; n++) {
+            free(s->pinned[n]);
+        }
+        s->pinnedCount = 0;
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* ====================================================================
+ * Statistics Implementation
+ * ==================================================================== */
+
+kvidxError kvidxTieredGetKeyCount(kvidxInstance *i, uint64_t *count) {
+    tierState *s = STATE(i);
+    if (!s || !count) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint64_t hotKeys = 0;
+    pthread_mutex_lock(&s->lock);
+    kvidxGetKeyCount(&s->hot, &hotKeys);
+    *count = hotKeys + s->coldBelow;
+    pthread_mutex_unlock(&s->lock);
+
+    return KVIDX_OK;
+}
+
+kvidxError kvidxTieredGetMinKey(kvidxInstance *i, uint64_t *key) {
+    tierState *s = STATE(i);
+    if (!s || !key) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result;
+    pthread_mutex_lock(&s->lock);
+    if (s->coldBelow) {
+        coldEnter(s);
+        result = kvidxGetMinKey(&s->cold, key);
+        coldLeave(s);
+    } else {
+        result = kvidxGetMinKey(&s->hot, key);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/**
+ * Total value bytes. Flushes first, so the cold tier holds every key.
+ */
+kvidxError kvidxTieredGetDataSize(kvidxInstance *i, uint64_t *bytes) {
+    tierState *s = STATE(i);
+    if (!s || !bytes) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result;
+    pthread_mutex_lock(&s->lock);
+    if (!flushAll(i)) {
+        result = kvidxGetLastError(i);
+    } else {
+        coldEnter(s);
+        result = kvidxGetDataSize(&s->cold, bytes);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/**
+ * Get database statistics: the cold tier's, after a flush, with the key
+ * count taken from both tiers.
+ */
+kvidxError kvidxTieredGetStats(kvidxInstance *i, kvidxStats *stats) {
+    tierState *s = STATE(i);
+    if (!s || !stats) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result;
+    pthread_mutex_lock(&s->lock);
+    if (!flushAll(i)) {
+        result = kvidxGetLastError(i);
+    } else {
+        uint64_t hotKeys = 0;
+        kvidxGetKeyCount(&s->hot, &hotKeys);
+
+        coldEnter(s);
+        result = kvidxGetStats(&s->cold, stats);
+        coldLeave(s);
+
+        if (result == KVIDX_OK) {
+            stats->totalKeys = hotKeys + s->coldBelow;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* ====================================================================
+ * Range Operations Implementation
+ * ==================================================================== */
+
+kvidxError kvidxTieredRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount) {
+    tierState *s = STATE(i);
+    if (!s) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    if ((!startInclusive && startKey == UINT64_MAX) ||
+        (!endInclusive && endKey == 0)) {
+        if (deletedCount) {
+            *deletedCount = 0;
+        }
+        return KVIDX_OK;
+    }
+
+    uint64_t lo = startInclusive ? startKey : startKey + 1;
+    uint64_t hi = endInclusive ? endKey : endKey - 1;
+
+    pthread_mutex_lock(&s->lock);
+    kvidxError result = removeKeys(i, lo, hi, deletedCount);
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredCountRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, uint64_t *count) {
+    tierState *s = STATE(i);
+    if (!s || !count) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result = KVIDX_OK;
+    uint64_t total = 0;
+    uint64_t n = 0;
+
+    pthread_mutex_lock(&s->lock);
+    if (startKey <= endKey && startKey < s->floor) {
+        coldEnter(s);
+        result = kvidxCountRange(&s->cold, startKey,
+                                 endKey < s->floor ? endKey : s->floor - 1,
+                                 &n);
+        coldLeave(s);
+        total += n;
+    }
+
+    if (result == KVIDX_OK && startKey <= endKey && endKey >= s->floor) {
+        result = kvidxCountRange(
+            &s->hot, startKey > s->floor ? startKey : s->floor, endKey, &n);
+        total += n;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    *count = total;
+    return result;
+}
+
+kvidxError kvidxTieredExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool *exists) {
+    tierState *s = STATE(i);
+    if (!s || !exists) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result = KVIDX_OK;
+    *exists = false;
+
+    pthread_mutex_lock(&s->lock);
+    if (startKey <= endKey && endKey >= s->floor) {
+        result = kvidxExistsInRange(
+            &s->hot, startKey > s->floor ? startKey : s->floor, endKey,
+            exists);
+    }
+
+    if (result == KVIDX_OK && !*exists && startKey <= endKey &&
+        startKey < s->floor) {
+        coldEnter(s);
+        result = kvidxExistsInRange(
+            &s->cold, startKey, endKey < s->floor ? endKey : s->floor - 1,
+            exists);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* ====================================================================
+ * Export/Import Implementation
+ * ==================================================================== */
+
+/**
+ * Export through the cold tier after flushing, so every format the cold
+ * adapter supports is available.
+ */
+kvidxError kvidxTieredExport(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    tierState *s = STATE(i);
+    if (!s || !filename || !options) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result;
+    pthread_mutex_lock(&s->lock);
+    if (!flushAll(i)) {
+        result = kvidxGetLastError(i);
+    } else {
+        coldEnter(s);
+        result = kvidxExport(&s->cold, filename, options, callback, userData);
+        if (result != KVIDX_OK) {
+            tierError(i, &s->cold);
+        }
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/**
+ * Import into the cold tier after flushing, then reload the newest keys
+ * into memory.
+ */
+kvidxError kvidxTieredImport(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    tierState *s = STATE(i);
+    if (!s || !filename || !options) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    kvidxError result;
+    pthread_mutex_lock(&s->lock);
+    if (s->inTxn) {
+        kvidxSetError(i, KVIDX_ERROR_TRANSACTION_ACTIVE,
+                      "Tiered import cannot run inside a transaction");
+        result = KVIDX_ERROR_TRANSACTION_ACTIVE;
+    } else if (!flushAll(i)) {
+        result = kvidxGetLastError(i);
+    } else {
+        coldEnter(s);
+        result = kvidxImport(&s->cold, filename, options, callback, userData);
+        if (result != KVIDX_OK) {
+            tierError(i, &s->cold);
+        }
+
+        /* Every hot key is clean after the flush; rebuild from the cold
+         * tier whether or not the import finished. */
+        kvidxRemoveRange(&s->hot, 0, UINT64_MAX, true, true, NULL);
+        kvidxRemoveRange(&s->dirty, 0, UINT64_MAX, true, true, NULL);
+        if (!loadTail(s) && result == KVIDX_OK) {
+            kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                          "Failed to load newest keys into memory");
+            result = KVIDX_ERROR_NOMEM;
+        }
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredApplyConfig(kvidxInstance *i,
+                                  const kvidxConfig *config) {
+    tierState *s = STATE(i);
+    if (!s || !config) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    setLimits(s, config);
+
+    kvidxConfig coldConfig = *config;
+    coldConfig.metrics = false;
+
+    coldEnter(s);
+    kvidxError result = kvidxUpdateConfig(&s->cold, &coldConfig);
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "%s", kvidxGetLastErrorMessage(&s->cold));
+    }
+    coldLeave(s);
+
+    /* New limits and intervals apply right away */
+    pthread_cond_signal(&s->wake);
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* ====================================================================
+ * Storage Primitives
+ * ====================================================================
+ * Each primitive runs on the tier that owns the key. Hot writes mark the
+ * key dirty; cold writes keep coldBelow exact.
+ */
+
+/* --- Conditional Writes --- */
+
+kvidxError kvidxTieredInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(i, key,
+                            kvidxInsertEx(&s->hot, key, term, cmd, data,
+                                          dataLen, condition));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result = kvidxInsertEx(&s->cold, key, term, cmd, data, dataLen,
+                                   condition);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* --- Atomic Operations --- */
+
+kvidxError kvidxTieredGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(i, key,
+                            kvidxGetAndSet(&s->hot, key, term, cmd, data,
+                                           dataLen, oldTerm, oldCmd, oldData,
+                                           oldDataLen));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result = kvidxGetAndSet(&s->cold, key, term, cmd, data, dataLen,
+                                    oldTerm, oldCmd, oldData, oldDataLen);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredGetAndRemove(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(
+            i, key, kvidxGetAndRemove(&s->hot, key, term, cmd, data, dataLen));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result = kvidxGetAndRemove(&s->cold, key, term, cmd, data, dataLen);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* --- Compare-and-Swap --- */
+
+kvidxError kvidxTieredCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped) {
+    tierState *s = STATE(i);
+    kvidxError result;
+    bool didSwap = false;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = kvidxCompareAndSwap(&s->hot, key, expectedData, expectedLen,
+                                     newTerm, newCmd, newData, newDataLen,
+                                     &didSwap);
+        if (didSwap) {
+            result = hotWritten(i, key, result);
+        }
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result = kvidxCompareAndSwap(&s->cold, key, expectedData,
+                                         expectedLen, newTerm, newCmd, newData,
+                                         newDataLen, &didSwap);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    if (swapped) {
+        *swapped = didSwap;
+    }
+    return result;
+}
+
+/* --- Append/Prepend --- */
+
+kvidxError kvidxTieredAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(
+            i, key,
+            kvidxAppend(&s->hot, key, term, cmd, data, dataLen, newLen));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result =
+                kvidxAppend(&s->cold, key, term, cmd, data, dataLen, newLen);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(
+            i, key,
+            kvidxPrepend(&s->hot, key, term, cmd, data, dataLen, newLen));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result =
+                kvidxPrepend(&s->cold, key, term, cmd, data, dataLen, newLen);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* --- Partial Value Access --- */
+
+kvidxError kvidxTieredGetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, size_t length, void **data,
+                                    size_t *actualLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result =
+            kvidxGetValueRange(&s->hot, key, offset, length, data, actualLen);
+    } else {
+        coldEnter(s);
+        result =
+            kvidxGetValueRange(&s->cold, key, offset, length, data, actualLen);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredSetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(
+            i, key,
+            kvidxSetValueRange(&s->hot, key, offset, data, dataLen, newLen));
+    } else {
+        bool existed = false;
+        result = coldWriteEnter(i, key, &existed);
+        if (result == KVIDX_OK) {
+            result = kvidxSetValueRange(&s->cold, key, offset, data, dataLen,
+                                        newLen);
+            coldWriteLeave(s, key, existed);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/* --- TTL/Expiration --- */
+
+kvidxError kvidxTieredSetExpire(kvidxInstance *i, uint64_t key,
+                                uint64_t ttlMs) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(i, key, kvidxSetExpire(&s->hot, key, ttlMs));
+    } else if (coldEnterWrite(i)) {
+        result = kvidxSetExpire(&s->cold, key, ttlMs);
+        coldLeave(s);
+    } else {
+        result = kvidxGetLastError(i);
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+kvidxError kvidxTieredSetExpireAt(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result =
+            hotWritten(i, key, kvidxSetExpireAt(&s->hot, key, timestampMs));
+    } else if (coldEnterWrite(i)) {
+        result = kvidxSetExpireAt(&s->cold, key, timestampMs);
+        coldLeave(s);
+    } else {
+        result = kvidxGetLastError(i);
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+int64_t kvidxTieredGetTTL(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+    int64_t ttl;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        ttl = kvidxGetTTL(&s->hot, key);
+    } else {
+        coldEnter(s);
+        ttl = kvidxGetTTL(&s->cold, key);
+        coldLeave(s);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return ttl;
+}
+
+kvidxError kvidxTieredPersist(kvidxInstance *i, uint64_t key) {
+    tierState *s = STATE(i);
+    kvidxError result;
+
+    pthread_mutex_lock(&s->lock);
+    if (key >= s->floor) {
+        result = hotWritten(i, key, kvidxPersist(&s->hot, key));
+    } else if (coldEnterWrite(i)) {
+        result = kvidxPersist(&s->cold, key);
+        coldLeave(s);
+    } else {
+        result = kvidxGetLastError(i);
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    return result;
+}
+
+/**
+ * Remove expired keys, at most maxKeys of them (0 = no limit).
+ *
+ * Hot keys are checked one by one so each removal is marked dirty and
+ * reaches the cold tier; the cold tier then runs its own scan for the rest.
+ */
+kvidxError kvidxTieredExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount) {
+    tierState *s = STATE(i);
+    kvidxError result = KVIDX_OK;
+    uint64_t expired = 0;
+
+    pthread_mutex_lock(&s->lock);
+    uint64_t key = 0;
+    bool found = kvidxGetMinKey(&s->hot, &key) == KVIDX_OK;
+    while (found && (maxKeys == 0 || expired < maxKeys)) {
+        const uint64_t current = key;
+        found = current < UINT64_MAX &&
+                kvidxGetNext(&s->hot, current, &key, NULL, NULL, NULL, NULL);
+
+        if (kvidxGetTTL(&s->hot, current) == 0) {
+            result = removeKeys(i, current, current, NULL);
+            if (result != KVIDX_OK) {
+                break;
+            }
+            kvidxChangeNoteExpired(i, current);
+            expired++;
+        }
+    }
+
+    if (result == KVIDX_OK && (maxKeys == 0 || expired < maxKeys)) {
+        uint64_t coldExpired = 0;
+        if (!coldEnterWrite(i)) {
+            result = kvidxGetLastError(i);
+        } else {
+            /* The cold scan notes its keys into this instance's batch,
+             * minus the flushed copies of hot keys */
+            const size_t mark = kvidxChangeMark(i);
+            s->cold.changes = i->changes;
+            kvidxChangeHold(i);
+            result = kvidxExpireScan(&s->cold,
+                                     maxKeys ? maxKeys - expired : 0,
+                                     &coldExpired);
+            kvidxChangeRelease(i);
+            s->cold.changes = NULL;
+            kvidxChangeDropExpired(i, mark, s->floor);
+
+            /* The scan also drops flushed copies of expired hot keys, so
+             * recount rather than subtract */
+            uint64_t below = 0;
+            if (s->floor > 0 &&
+                kvidxCountRange(&s->cold, 0, s->floor - 1, &below) ==
+                    KVIDX_OK) {
+                expired += s->coldBelow - below;
+                s->coldBelow = below;
+            }
+            coldLeave(s);
+        }
+    }
+    afterWrite(s);
+    pthread_mutex_unlock(&s->lock);
+
+    if (expiredCount) {
+        *expiredCount = expired;
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "kvidxkit.h"
+__BEGIN_DECLS
+
+/* Open / Close / Management */
+bool kvidxTieredOpen(kvidxInstance *i, const char *filename, const char **err);
+bool kvidxTieredClose(kvidxInstance *i);
+bool kvidxTieredFsync(kvidxInstance *i);
+
+/* Transactional Control */
+bool kvidxTieredBegin(kvidxInstance *i);
+bool kvidxTieredCommit(kvidxInstance *i);
+
+/* Reading */
+bool kvidxTieredGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                    uint64_t *cmd, const uint8_t **data, size_t *len);
+bool kvidxTieredGetPrev(kvidxInstance *i, uint64_t nextKey, uint64_t *prevKey,
+                        uint64_t *prevTerm, uint64_t *cmd, const uint8_t **data,
+                        size_t *len);
+bool kvidxTieredGetNext(kvidxInstance *i, uint64_t previousKey,
+                        uint64_t *nextKey, uint64_t *nextTerm, uint64_t *cmd,
+                        const uint8_t **data, size_t *len);
+bool kvidxTieredExists(kvidxInstance *i, uint64_t key);
+bool kvidxTieredExistsDual(kvidxInstance *i, uint64_t key, uint64_t term);
+bool kvidxTieredMax(kvidxInstance *i, uint64_t *key);
+bool kvidxTieredInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                       uint64_t cmd, const void *data, size_t dataLen);
+
+/* Deleting */
+bool kvidxTieredRemove(kvidxInstance *i, uint64_t key);
+bool kvidxTieredRemoveAfterNInclusive(kvidxInstance *i, uint64_t key);
+bool kvidxTieredRemoveBeforeNInclusive(kvidxInstance *i, uint64_t key);
+
+/* Statistics */
+kvidxError kvidxTieredGetStats(kvidxInstance *i, kvidxStats *stats);
+kvidxError kvidxTieredGetKeyCount(kvidxInstance *i, uint64_t *count);
+kvidxError kvidxTieredGetMinKey(kvidxInstance *i, uint64_t *key);
+kvidxError kvidxTieredGetDataSize(kvidxInstance *i, uint64_t *bytes);
+
+/* Configuration */
+kvidxError kvidxTieredApplyConfig(kvidxInstance *i, const kvidxConfig *config);
+
+/* Range Operations */
+kvidxError kvidxTieredRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                  uint64_t endKey, bool startInclusive,
+                                  bool endInclusive, uint64_t *deletedCount);
+kvidxError kvidxTieredCountRange(kvidxInstance *i, uint64_t startKey,
+                                 uint64_t endKey, uint64_t *count);
+kvidxError kvidxTieredExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool *exists);
+
+/* Export/Import */
+kvidxError kvidxTieredExport(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+kvidxError kvidxTieredImport(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+
+/* Storage Primitives */
+/* Conditional writes */
+kvidxError kvidxTieredInsertEx(kvidxInstance *i, uint64_t key, uint64_t term,
+                               uint64_t cmd, const void *data, size_t dataLen,
+                               kvidxSetCondition condition);
+
+/* Transaction abort */
+bool kvidxTieredAbort(kvidxInstance *i);
+
+/* Atomic operations */
+kvidxError kvidxTieredGetAndSet(kvidxInstance *i, uint64_t key, uint64_t term,
+                                uint64_t cmd, const void *data, size_t dataLen,
+                                uint64_t *oldTerm, uint64_t *oldCmd,
+                                void **oldData, size_t *oldDataLen);
+kvidxError kvidxTieredGetAndRemove(kvidxInstance *i, uint64_t key,
+                                   uint64_t *term, uint64_t *cmd, void **data,
+                                   size_t *dataLen);
+
+/* Compare-and-swap */
+kvidxError kvidxTieredCompareAndSwap(kvidxInstance *i, uint64_t key,
+                                     const void *expectedData,
+                                     size_t expectedLen, uint64_t newTerm,
+                                     uint64_t newCmd, const void *newData,
+                                     size_t newDataLen, bool *swapped);
+
+/* Append/Prepend */
+kvidxError kvidxTieredAppend(kvidxInstance *i, uint64_t key, uint64_t term,
+                             uint64_t cmd, const void *data, size_t dataLen,
+                             size_t *newLen);
+kvidxError kvidxTieredPrepend(kvidxInstance *i, uint64_t key, uint64_t term,
+                              uint64_t cmd, const void *data, size_t dataLen,
+                              size_t *newLen);
+
+/* Partial value access */
+kvidxError kvidxTieredGetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, size_t length, void **data,
+                                    size_t *actualLen);
+kvidxError kvidxTieredSetValueRange(kvidxInstance *i, uint64_t key,
+                                    size_t offset, const void *data,
+                                    size_t dataLen, size_t *newLen);
+
+/* TTL/Expiration */
+kvidxError kvidxTieredSetExpire(kvidxInstance *i, uint64_t key, uint64_t ttlMs);
+kvidxError kvidxTieredSetExpireAt(kvidxInstance *i, uint64_t key,
+                                  uint64_t timestampMs);
+int64_t kvidxTieredGetTTL(kvidxInstance *i, uint64_t key);
+kvidxError kvidxTieredPersist(kvidxInstance *i, uint64_t key);
+kvidxError kvidxTieredExpireScan(kvidxInstance *i, uint64_t maxKeys,
+                                 uint64_t *expiredCount);
+
+/* Iterator read pins */
+void kvidxTieredPinReads(kvidxInstance *i);
+void kvidxTieredUnpinReads(kvidxInstance *i);
+
+__END_DECLS
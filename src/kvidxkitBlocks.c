@@ -0,0 +1,873 @@
+/**
+ * Block-layout binary export/import for kvidxkit
+ *
+ * Layout of KVIDX_BINARY_VERSION_BLOCKS files (native byte order, like
+ * version 1):
+ *
+ *   header    magic, version 2, total entry count
+ *   blocks    blockHeader + payload of version 1 entries, in any order
+ *   index     one blockIndexEntry per block, sorted by first key
+ *   trailer   index offset, block count, index CRC32C, magic
+ *
+ * Blocks cover disjoint key ranges and carry their own bounds, counts and
+ * payload checksum, so they can be written and read independently.
+ *
+ * Export splits the key range into several partitions per thread. Workers
+ * claim partitions, fill blocks of about KVIDX_EXPORT_BLOCK_BYTES, reserve
+ * file space under a lock and pwrite() them. Each worker reads through its
+ * own handle when the adapter provides interface.openReader; otherwise the
+ * workers take turns reading from the instance and only block assembly,
+ * checksums and writes run in parallel.
+ *
+ * Import reads and verifies blocks on worker threads, a few blocks ahead of
+ * the calling thread, which inserts them in key order inside one
+ * transaction (every adapter has a single writer).
+ */
+
+/* Required for pread/pwrite and sysconf under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Binary format magic number: "KVIDX\0\0\0" */
+#define KVIDX_BINARY_MAGIC 0x5844495645564B00ULL
+
+/* Block header magic: "KBLK" */
+#define BLOCK_MAGIC 0x4B4C424BU
+
+/* Upper bound on worker threads (kvidxWorkerCount) */
+#define BLOCK_MAX_THREADS 16
+
+/* Export partitions per thread, so sparse key ranges still balance */
+#define PARTITIONS_PER_THREAD 8
+
+/* Blocks each import thread may read ahead of the inserter */
+#define IMPORT_SLOTS_PER_THREAD 2
+
+/* key, term, cmd, dataLen */
+#define ENTRY_HEADER_BYTES (4 * sizeof(uint64_t))
+
+/* File header (same as version 1) */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entryCount;
+} kvidxBinaryHeader;
+
+/* Precedes each block's payload; repeated in the index */
+typedef struct blockHeader {
+    uint64_t firstKey;
+    uint64_t lastKey;
+    uint64_t entryCount;
+    uint64_t payloadBytes;
+    uint32_t checksum; /* CRC32C of the payload */
+    uint32_t magic;    /* BLOCK_MAGIC */
+} blockHeader;
+
+typedef struct blockIndexEntry {
+    uint64_t offset; /* File offset of the block header */
+    blockHeader header;
+} blockIndexEntry;
+
+/* Last bytes of the file */
+typedef struct blockTrailer {
+    uint64_t indexOffset;
+    uint64_t blockCount;
+    uint32_t indexChecksum; /* CRC32C of the index */
+    uint32_t reserved;
+    uint64_t magic; /* KVIDX_BINARY_MAGIC */
+} blockTrailer;
+
+uint32_t kvidxWorkerCount(uint32_t requested, uint64_t work) {
+    long threads = requested ? (long)requested : sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > BLOCK_MAX_THREADS) {
+        threads = BLOCK_MAX_THREADS;
+    }
+    if (threads < 1 || work < 1) {
+        return 1;
+    }
+    return (uint64_t)threads > work ? (uint32_t)work : (uint32_t)threads;
+}
+
+static bool pwriteAll(int fd, const void *buf, size_t len, uint64_t offset) {
+    const uint8_t *p = buf;
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, (off_t)offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool preadAll(int fd, void *buf, size_t len, uint64_t offset) {
+    uint8_t *p = buf;
+    while (len) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+bool kvidxIsBlockExport(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    kvidxBinaryHeader header;
+    bool blocks = preadAll(fd, &header, sizeof(header), 0) &&
+                  header.magic == KVIDX_BINARY_MAGIC &&
+                  header.version == KVIDX_BINARY_VERSION_BLOCKS;
+    close(fd);
+    return blocks;
+}
+
+/* ====================================================================
+ * Export
+ * ==================================================================== */
+
+typedef struct exportJob {
+    kvidxInstance *i;
+    int fd;
+    uint64_t firstKey; /* Partition p starts at firstKey + p * span */
+    uint64_t lastKey;
+    uint64_t span;
+    uint32_t partitions;
+    bool sharedReads; /* Workers take turns reading from i */
+    kvidxProgressCallback callback;
+    void *userData;
+    uint64_t total; /* Only counted when there is a callback */
+
+    pthread_mutex_t readLock; /* Held while reading from i (sharedReads) */
+
+    pthread_mutex_t lock; /* Guards the fields below */
+    uint32_t nextPartition;
+    uint64_t nextOffset;
+    blockIndexEntry *index;
+    size_t indexCount;
+    size_t indexCapacity;
+    uint64_t exported;
+    kvidxError error;
+} exportJob;
+
+typedef struct exportWorker {
+    exportJob *job;
+    kvidxInstance reader; /* Own handle unless job->sharedReads */
+    pthread_t thread;
+    bool started;
+    bool outOfMemory;
+    uint8_t *buf; /* Room for the block header, then the payload */
+    size_t capacity;
+    size_t used; /* Payload bytes */
+    blockHeader header;
+} exportWorker;
+
+static void exportFail(exportJob *job, kvidxError err) {
+    pthread_mutex_lock(&job->lock);
+    if (job->error == KVIDX_OK) {
+        job->error = err;
+    }
+    pthread_mutex_unlock(&job->lock);
+}
+
+static bool blockAppend(exportWorker *w, uint64_t key, uint64_t term,
+                        uint64_t cmd, const uint8_t *data, size_t dataLen) {
+    const size_t need =
+        sizeof(blockHeader) + w->used + ENTRY_HEADER_BYTES + dataLen;
+    if (need > w->capacity) {
+        size_t capacity = w->capacity * 2 > need ? w->capacity * 2 : need;
+        uint8_t *grown = realloc(w->buf, capacity);
+        if (!grown) {
+            return false;
+        }
+        w->buf = grown;
+        w->capacity = capacity;
+    }
+
+    uint8_t *p = w->buf + sizeof(blockHeader) + w->used;
+    const uint64_t fields[4] = {key, term, cmd, dataLen};
+    memcpy(p, fields, sizeof(fields));
+    if (dataLen) {
+        memcpy(p + sizeof(fields), data, dataLen);
+    }
+    w->used += sizeof(fields) + dataLen;
+
+    if (w->header.entryCount++ == 0) {
+        w->header.firstKey = key;
+    }
+    w->header.lastKey = key;
+    return true;
+}
+
+/**
+ * Write the worker's block (if any) at the next free file offset.
+ *
+ * @return false once the export has failed or been cancelled
+ */
+static bool blockFlush(exportWorker *w) {
+    exportJob *job = w->job;
+    if (!w->header.entryCount) {
+        return true;
+    }
+
+    w->header.payloadBytes = w->used;
+    w->header.checksum = kvidxCrc32c(0, w->buf + sizeof(blockHeader), w->used);
+    w->header.magic = BLOCK_MAGIC;
+    memcpy(w->buf, &w->header, sizeof(w->header));
+    const size_t len = sizeof(blockHeader) + w->used;
+
+    pthread_mutex_lock(&job->lock);
+    const uint64_t offset = job->nextOffset;
+    bool ok = job->error == KVIDX_OK;
+    if (ok && job->indexCount == job->indexCapacity) {
+        size_t capacity = job->indexCapacity ? job->indexCapacity * 2 : 64;
+        blockIndexEntry *grown =
+            realloc(job->index, capacity * sizeof(*job->index));
+        if (grown) {
+            job->index = grown;
+            job->indexCapacity = capacity;
+        } else {
+            job->error = KVIDX_ERROR_NOMEM;
+            ok = false;
+        }
+    }
+
+    if (ok) {
+        job->index[job->indexCount].offset = offset;
+        job->index[job->indexCount].header = w->header;
+        job->indexCount++;
+        job->nextOffset += len;
+        job->exported += w->header.entryCount;
+
+        /* Progress callback (serialized by the lock) */
+        if (job->callback &&
+            !job->callback(job->exported, job->total, job->userData)) {
+            job->error = KVIDX_ERROR_CANCELLED;
+        }
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    memset(&w->header, 0, sizeof(w->header));
+    w->used = 0;
+
+    if (ok && !pwriteAll(job->fd, w->buf, len, offset)) {
+        exportFail(job, KVIDX_ERROR_IO);
+        ok = false;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    ok = ok && job->error == KVIDX_OK;
+    pthread_mutex_unlock(&job->lock);
+    return ok;
+}
+
+/* Scan visitor: append one entry, stopping once the block is full */
+static bool exportVisit(void *ctx, uint64_t key, uint64_t term, uint64_t cmd,
+                        const uint8_t *data, size_t len) {
+    exportWorker *w = ctx;
+    if (!blockAppend(w, key, term, cmd, data, len)) {
+        w->outOfMemory = true;
+        return false;
+    }
+    return w->used < KVIDX_EXPORT_BLOCK_BYTES;
+}
+
+static bool exportPartition(exportWorker *w, kvidxInstance *src,
+                            uint64_t start, uint64_t end) {
+    exportJob *job = w->job;
+
+    for (;;) {
+        if (job->sharedReads) {
+            pthread_mutex_lock(&job->readLock);
+        }
+        kvidxError err = kvidxScanRange(src, start, end, exportVisit, w);
+        if (job->sharedReads) {
+            pthread_mutex_unlock(&job->readLock);
+        }
+
+        if (err != KVIDX_OK || w->outOfMemory) {
+            exportFail(job, err != KVIDX_OK ? err : KVIDX_ERROR_NOMEM);
+            return false;
+        }
+
+        /* Only a full block leaves more of the partition to scan */
+        const bool full = w->used >= KVIDX_EXPORT_BLOCK_BYTES;
+        const uint64_t lastKey = w->header.lastKey;
+        if (!blockFlush(w)) {
+            return false;
+        }
+        if (!full || lastKey >= end) {
+            return true;
+        }
+        start = lastKey + 1;
+    }
+}
+
+static void *exportWorkerMain(void *arg) {
+    exportWorker *w = arg;
+    exportJob *job = w->job;
+    kvidxInstance *src = job->sharedReads ? job->i : &w->reader;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        const uint32_t p = job->nextPartition;
+        const bool done = job->error != KVIDX_OK || p >= job->partitions;
+        if (!done) {
+            job->nextPartition++;
+        }
+        pthread_mutex_unlock(&job->lock);
+
+        if (done) {
+            break;
+        }
+
+        const uint64_t start = job->firstKey + (uint64_t)p * job->span;
+        const uint64_t end = job->lastKey - start < job->span - 1
+                                 ? job->lastKey
+                                 : start + job->span - 1;
+        if (!exportPartition(w, src, start, end)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int compareIndexEntries(const void *a, const void *b) {
+    const blockIndexEntry *x = a;
+    const blockIndexEntry *y = b;
+    return x->header.firstKey < y->header.firstKey   ? -1
+           : x->header.firstKey > y->header.firstKey ? 1
+                                                     : 0;
+}
+
+/**
+ * Sort the index and write it, the trailer and the final header. An empty
+ * range has no index (job->index may be NULL): the trailer follows the
+ * header directly, with the checksum of zero bytes.
+ */
+static bool exportFinish(exportJob *job) {
+    const size_t indexBytes = job->indexCount * sizeof(*job->index);
+    uint32_t indexChecksum = 0;
+    if (job->indexCount) {
+        qsort(job->index, job->indexCount, sizeof(*job->index),
+              compareIndexEntries);
+        indexChecksum = kvidxCrc32c(0, job->index, indexBytes);
+    }
+
+    blockTrailer trailer = {.indexOffset = job->nextOffset,
+                            .blockCount = job->indexCount,
+                            .indexChecksum = indexChecksum,
+                            .reserved = 0,
+                            .magic = KVIDX_BINARY_MAGIC};
+    kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
+                                .version = KVIDX_BINARY_VERSION_BLOCKS,
+                                .reserved = 0,
+                                .entryCount = job->exported};
+
+    return pwriteAll(job->fd, job->index, indexBytes, job->nextOffset) &&
+           pwriteAll(job->fd, &trailer, sizeof(trailer),
+                     job->nextOffset + indexBytes) &&
+           pwriteAll(job->fd, &header, sizeof(header), 0);
+}
+
+kvidxError kvidxExportBlocks(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    if (options->startKey > options->endKey) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Export range start is past its end");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    exportJob job = {.i = i,
+                     .callback = callback,
+                     .userData = userData,
+                     .nextOffset = sizeof(kvidxBinaryHeader),
+                     .error = KVIDX_OK};
+
+    /* Partition only the keys actually present in the range */
+    bool empty = kvidxGetMinKey(i, &job.firstKey) != KVIDX_OK ||
+                 !kvidxMaxKey(i, &job.lastKey);
+    if (!empty) {
+        if (job.firstKey < options->startKey) {
+            job.firstKey = options->startKey;
+        }
+        if (job.lastKey > options->endKey) {
+            job.lastKey = options->endKey;
+        }
+        empty = job.firstKey > job.lastKey;
+    }
+
+    if (callback && !empty) {
+        kvidxError result =
+            kvidxCountRange(i, job.firstKey, job.lastKey, &job.total);
+        if (result != KVIDX_OK) {
+            return result;
+        }
+    }
+
+    const uint64_t keySpan = empty ? 0 : job.lastKey - job.firstKey;
+    const uint32_t threads = kvidxWorkerCount(
+        options->threads, keySpan == UINT64_MAX ? UINT64_MAX : keySpan + 1);
+    if (!empty) {
+        const uint64_t partitions = (uint64_t)threads * PARTITIONS_PER_THREAD;
+        job.span = keySpan / partitions + 1;
+        job.partitions = (uint32_t)(keySpan / job.span + 1);
+    }
+
+    exportWorker *workers = calloc(threads, sizeof(*workers));
+    if (!workers) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate workers");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    job.fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (job.fd < 0) {
+        free(workers);
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file for writing: %s",
+                      filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    /* Adapters refuse readers while i has a write transaction open */
+    job.sharedReads = !i->interface.openReader;
+    for (uint32_t n = 0; n < threads && !job.sharedReads; n++) {
+        if (!i->interface.openReader(i, &workers[n].reader)) {
+            for (uint32_t opened = 0; opened < n; opened++) {
+                workers[opened].reader.interface.close(
+                    &workers[opened].reader);
+            }
+            job.sharedReads = true;
+        }
+    }
+
+    pthread_mutex_init(&job.readLock, NULL);
+    pthread_mutex_init(&job.lock, NULL);
+
+    /* The calling thread is worker 0 */
+    for (uint32_t n = 0; n < threads; n++) {
+        workers[n].job = &job;
+        workers[n].capacity = sizeof(blockHeader) + KVIDX_EXPORT_BLOCK_BYTES;
+        workers[n].buf = malloc(workers[n].capacity);
+        if (!workers[n].buf) {
+            exportFail(&job, KVIDX_ERROR_NOMEM);
+        } else if (n > 0) {
+            workers[n].started = pthread_create(&workers[n].thread, NULL,
+                                                exportWorkerMain,
+                                                &workers[n]) == 0;
+        }
+    }
+    if (workers[0].buf) {
+        exportWorkerMain(&workers[0]);
+    }
+
+    for (uint32_t n = 0; n < threads; n++) {
+        if (workers[n].started) {
+            pthread_join(workers[n].thread, NULL);
+        }
+        if (!job.sharedReads) {
+            workers[n].reader.interface.close(&workers[n].reader);
+        }
+        free(workers[n].buf);
+    }
+    free(workers);
+    pthread_mutex_destroy(&job.readLock);
+    pthread_mutex_destroy(&job.lock);
+
+    kvidxError result = job.error;
+    if (result == KVIDX_OK && !exportFinish(&job)) {
+        result = KVIDX_ERROR_IO;
+    }
+    if (close(job.fd) != 0 && result == KVIDX_OK) {
+        result = KVIDX_ERROR_IO;
+    }
+    free(job.index);
+
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Export failed after %" PRIu64 " entries",
+                      job.exported);
+    }
+    return result;
+}
+
+/* ====================================================================
+ * Import
+ * ==================================================================== */
+
+typedef struct importSlot {
+    uint8_t *buf; /* Block header, then the payload */
+    size_t capacity;
+    uint64_t block; /* Block held once ready */
+    bool ready;
+} importSlot;
+
+typedef struct importJob {
+    int fd;
+    const blockIndexEntry *index;
+    uint64_t blockCount;
+    importSlot *slots; /* Block b is read into slots[b % slotCount] */
+    uint32_t slotCount;
+
+    pthread_mutex_t lock; /* Guards the slots and the fields below */
+    pthread_cond_t cond;
+    uint64_t nextBlock; /* Next block to read */
+    uint64_t inserted;  /* Blocks the inserter is done with */
+    kvidxError error;
+    uint64_t errorBlock;
+} importJob;
+
+/**
+ * Read block b into slot and check it against the index, its checksum
+ * and its own framing, so the inserter can walk it without checks.
+ */
+static kvidxError readBlock(const importJob *job, uint64_t b,
+                            importSlot *slot) {
+    const blockIndexEntry *entry = &job->index[b];
+    const uint64_t payloadBytes = entry->header.payloadBytes;
+    const size_t len = sizeof(blockHeader) + (size_t)payloadBytes;
+
+    if (len > slot->capacity) {
+        uint8_t *grown = realloc(slot->buf, len);
+        if (!grown) {
+            return KVIDX_ERROR_NOMEM;
+        }
+        slot->buf = grown;
+        slot->capacity = len;
+    }
+
+    if (!preadAll(job->fd, slot->buf, len, entry->offset)) {
+        return KVIDX_ERROR_IO;
+    }
+
+    const uint8_t *payload = slot->buf + sizeof(blockHeader);
+    if (memcmp(slot->buf, &entry->header, sizeof(blockHeader)) != 0 ||
+        kvidxCrc32c(0, payload, (size_t)payloadBytes) !=
+            entry->header.checksum) {
+        return KVIDX_ERROR_CORRUPT;
+    }
+
+    uint64_t count = 0;
+    uint64_t prevKey = 0;
+    for (uint64_t pos = 0; pos < payloadBytes; count++) {
+        uint64_t fields[4];
+        if (payloadBytes - pos < sizeof(fields)) {
+            return KVIDX_ERROR_CORRUPT;
+        }
+        memcpy(fields, payload + pos, sizeof(fields));
+        pos += sizeof(fields);
+
+        if (fields[3] > payloadBytes - pos ||
+            fields[0] < entry->header.firstKey ||
+            fields[0] > entry->header.lastKey ||
+            (count && fields[0] <= prevKey)) {
+            return KVIDX_ERROR_CORRUPT;
+        }
+        prevKey = fields[0];
+        pos += fields[3];
+    }
+
+    return count == entry->header.entryCount ? KVIDX_OK : KVIDX_ERROR_CORRUPT;
+}
+
+static void *importWorkerMain(void *arg) {
+    importJob *job = arg;
+
+    pthread_mutex_lock(&job->lock);
+    for (;;) {
+        /* Wait until the block's slot has been inserted and freed */
+        while (job->error == KVIDX_OK && job->nextBlock < job->blockCount &&
+               job->nextBlock >= job->inserted + job->slotCount) {
+            pthread_cond_wait(&job->cond, &job->lock);
+        }
+        if (job->error != KVIDX_OK || job->nextBlock >= job->blockCount) {
+            break;
+        }
+
+        const uint64_t b = job->nextBlock++;
+        importSlot *slot = &job->slots[b % job->slotCount];
+        pthread_mutex_unlock(&job->lock);
+
+        kvidxError err = readBlock(job, b, slot);
+
+        pthread_mutex_lock(&job->lock);
+        if (err != KVIDX_OK) {
+            if (job->error == KVIDX_OK) {
+                job->error = err;
+                job->errorBlock = b;
+            }
+            pthread_cond_broadcast(&job->cond);
+            break;
+        }
+        slot->block = b;
+        slot->ready = true;
+        pthread_cond_broadcast(&job->cond);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    return NULL;
+}
+
+/**
+ * Read and validate the trailer and block index.
+ */
+static kvidxError readBlockIndex(int fd, kvidxBinaryHeader *header,
+                                 blockTrailer *trailer,
+                                 blockIndexEntry **index) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return KVIDX_ERROR_IO;
+    }
+
+    const uint64_t size = (uint64_t)st.st_size;
+    if (size < sizeof(*header) + sizeof(*trailer) ||
+        !preadAll(fd, header, sizeof(*header), 0) ||
+        !preadAll(fd, trailer, sizeof(*trailer), size - sizeof(*trailer))) {
+        return KVIDX_ERROR_CORRUPT;
+    }
+
+    const uint64_t indexSpace = size - sizeof(*header) - sizeof(*trailer);
+    if (header->magic != KVIDX_BINARY_MAGIC ||
+        header->version != KVIDX_BINARY_VERSION_BLOCKS ||
+        trailer->magic != KVIDX_BINARY_MAGIC ||
+        trailer->blockCount > indexSpace / sizeof(**index) ||
+        trailer->indexOffset < sizeof(*header) ||
+        trailer->indexOffset + trailer->blockCount * sizeof(**index) !=
+            size - sizeof(*trailer)) {
+        return KVIDX_ERROR_CORRUPT;
+    }
+
+    const size_t indexBytes = (size_t)trailer->blockCount * sizeof(**index);
+    *index = malloc(indexBytes ? indexBytes : 1);
+    if (!*index) {
+        return KVIDX_ERROR_NOMEM;
+    }
+    if (!preadAll(fd, *index, indexBytes, trailer->indexOffset)) {
+        return KVIDX_ERROR_IO;
+    }
+    if (kvidxCrc32c(0, *index, indexBytes) != trailer->indexChecksum) {
+        return KVIDX_ERROR_CORRUPT;
+    }
+
+    /* Blocks lie between the header and the index, in ascending and
+     * disjoint key ranges, and account for every entry */
+    uint64_t entries = 0;
+    for (uint64_t b = 0; b < trailer->blockCount; b++) {
+        const blockIndexEntry *entry = &(*index)[b];
+        if (entry->offset < sizeof(*header) ||
+            entry->offset > trailer->indexOffset ||
+            trailer->indexOffset - entry->offset < sizeof(blockHeader) ||
+            entry->header.payloadBytes > trailer->indexOffset -
+                                             entry->offset -
+                                             sizeof(blockHeader) ||
+            entry->header.firstKey > entry->header.lastKey ||
+            (b && entry->header.firstKey <= (*index)[b - 1].header.lastKey)) {
+            return KVIDX_ERROR_CORRUPT;
+        }
+        entries += entry->header.entryCount;
+    }
+
+    return entries == header->entryCount ? KVIDX_OK : KVIDX_ERROR_CORRUPT;
+}
+
+static kvidxError insertBlock(kvidxInstance *i, const importSlot *slot,
+                              const kvidxImportOptions *options,
+                              kvidxProgressCallback callback, void *userData,
+                              uint64_t total, uint64_t *count) {
+    blockHeader header;
+    memcpy(&header, slot->buf, sizeof(header));
+    const uint8_t *payload = slot->buf + sizeof(header);
+
+    for (uint64_t pos = 0; pos < header.payloadBytes;) {
+        uint64_t fields[4];
+        memcpy(fields, payload + pos, sizeof(fields));
+        pos += sizeof(fields);
+        const uint8_t *data = payload + pos;
+        pos += fields[3];
+
+        if (!kvidxInsert(i, fields[0], fields[1], fields[2], data,
+                         (size_t)fields[3])) {
+            if (options->skipDuplicates) {
+                /* Continue on duplicate key */
+                continue;
+            }
+            return kvidxGetLastError(i) != KVIDX_OK ? kvidxGetLastError(i)
+                                                    : KVIDX_ERROR_INTERNAL;
+        }
+
+        (*count)++;
+
+        /* Progress callback */
+        if (callback && *count % 100 == 0 &&
+            !callback(*count, total, userData)) {
+            return KVIDX_ERROR_CANCELLED;
+        }
+    }
+
+    return KVIDX_OK;
+}
+
+kvidxError kvidxImportBlocks(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file for reading: %s",
+                      filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxBinaryHeader header;
+    blockTrailer trailer;
+    blockIndexEntry *index = NULL;
+    kvidxError result = readBlockIndex(fd, &header, &trailer, &index);
+    if (result != KVIDX_OK) {
+        free(index);
+        close(fd);
+        kvidxSetError(i, result, "Invalid block index in %s", filename);
+        return result;
+    }
+
+    const uint32_t threads = kvidxWorkerCount(options->threads, trailer.blockCount);
+    importJob job = {.fd = fd,
+                     .index = index,
+                     .blockCount = trailer.blockCount,
+                     .slotCount = threads * IMPORT_SLOTS_PER_THREAD,
+                     .error = KVIDX_OK};
+    job.slots = calloc(job.slotCount, sizeof(*job.slots));
+    pthread_t *workers = calloc(threads, sizeof(*workers));
+    if (!job.slots || !workers) {
+        free(job.slots);
+        free(workers);
+        free(index);
+        close(fd);
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate workers");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    if (!kvidxBegin(i)) {
+        free(job.slots);
+        free(workers);
+        free(index);
+        close(fd);
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to begin transaction");
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    /* Clear inside the transaction so a failed import keeps the old data */
+    if (options->clearBeforeImport) {
+        result = kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+    }
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    uint32_t started = 0;
+    while (result == KVIDX_OK && started < threads &&
+           pthread_create(&workers[started], NULL, importWorkerMain, &job) ==
+               0) {
+        started++;
+    }
+    if (result == KVIDX_OK && !started && job.blockCount) {
+        result = KVIDX_ERROR_INTERNAL;
+    }
+
+    /* Insert blocks in key order as the workers deliver them */
+    uint64_t count = 0;
+    for (uint64_t b = 0; b < job.blockCount && result == KVIDX_OK; b++) {
+        importSlot *slot = &job.slots[b % job.slotCount];
+
+        pthread_mutex_lock(&job.lock);
+        while (job.error == KVIDX_OK && !(slot->ready && slot->block == b)) {
+            pthread_cond_wait(&job.cond, &job.lock);
+        }
+        result = job.error;
+        pthread_mutex_unlock(&job.lock);
+
+        if (result == KVIDX_OK) {
+            result = insertBlock(i, slot, options, callback, userData,
+                                 header.entryCount, &count);
+        }
+
+        pthread_mutex_lock(&job.lock);
+        slot->ready = false;
+        job.inserted = b + 1;
+        pthread_cond_broadcast(&job.cond);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    /* Stop workers still reading ahead */
+    pthread_mutex_lock(&job.lock);
+    const bool readFailed = job.error != KVIDX_OK;
+    if (job.error == KVIDX_OK && result != KVIDX_OK) {
+        job.error = result;
+    }
+    pthread_cond_broadcast(&job.cond);
+    pthread_mutex_unlock(&job.lock);
+
+    for (uint32_t n = 0; n < started; n++) {
+        pthread_join(workers[n], NULL);
+    }
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+    for (uint32_t n = 0; n < job.slotCount; n++) {
+        free(job.slots[n].buf);
+    }
+    free(job.slots);
+    free(workers);
+    close(fd);
+
+    if (result == KVIDX_OK && !kvidxCommit(i)) {
+        result = KVIDX_ERROR_INTERNAL;
+    } else if (result != KVIDX_OK) {
+        kvidxAbort(i);
+    }
+
+    /* Final progress callback */
+    if (result == KVIDX_OK && callback && count > 0) {
+        callback(count, header.entryCount, userData);
+    }
+
+    if (result != KVIDX_OK && readFailed) {
+        const blockHeader *bad = &index[job.errorBlock].header;
+        kvidxSetError(i, result,
+                      "Block %" PRIu64 " (keys %" PRIu64 "-%" PRIu64
+                      ") of %s is unreadable or corrupt",
+                      job.errorBlock, bad->firstKey, bad->lastKey, filename);
+    } else if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Import failed after %" PRIu64 " entries",
+                      count);
+    }
+    free(index);
+    return result;
+}
@@ -0,0 +1,429 @@
+/**
+ * Change feed for kvidxkit
+ *
+ * The public write wrappers in kvidxkit.c record each successful write as
+ * a pending change. Pending changes are published as one batch when the
+ * transaction commits (or right away for auto-commit writes) and are
+ * discarded if it aborts. Publishing copies the batch into every
+ * subscription's ring and makes it visible with a single release store of
+ * the ring head, so a consumer never sees part of a commit.
+ *
+ * Each ring has exactly one producer (the writing thread) and one consumer
+ * (the polling thread). The producer only moves head and the consumer only
+ * moves tail, so neither takes a lock. A slot keeps its data buffer between
+ * uses, so a steady stream of similar values stops allocating.
+ */
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Ring size used when kvidxSubscribe() is given 0 */
+#define CHANGE_RING_DEFAULT 4096
+
+/** Largest ring kvidxSubscribe() accepts */
+#define CHANGE_RING_MAX ((size_t)1 << 30)
+
+/** Cache line size, to keep producer and consumer fields apart */
+#define CHANGE_CACHE_LINE 64
+
+typedef struct changeSlot {
+    kvidxChange change;
+    uint8_t *buf; /* Owned copy of change.data */
+    size_t bufSize;
+} changeSlot;
+
+struct kvidxSubscription {
+    /* Written by the producer */
+    uint64_t head;      /* Slots filled so far */
+    uint64_t tailSeen;  /* Last tail read by the producer */
+    uint64_t dropped;   /* Changes that did not fit */
+    char producerPad[CHANGE_CACHE_LINE - 3 * sizeof(uint64_t)];
+
+    /* Written by the consumer */
+    uint64_t tail;      /* Slots released so far */
+    uint64_t held;      /* Slots returned by the last poll, not yet released */
+    char consumerPad[CHANGE_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+    /* Fixed at creation; next is only touched by the writing thread */
+    changeSlot *slots;
+    size_t mask;
+    kvidxSubscription *next;
+};
+
+typedef struct changeRecord {
+    kvidxChangeType type;
+    uint64_t key;
+    uint64_t endKey;
+    uint64_t term;
+    uint64_t cmd;
+    size_t dataOffset; /* Into kvidxChangeFeed.data */
+    size_t dataLen;
+} changeRecord;
+
+struct kvidxChangeFeed {
+    kvidxSubscription *subs;
+    size_t largestRing; /* A batch longer than this fits nowhere */
+
+    /* The batch being built. total counts every change; once it passes
+     * largestRing, later changes are only counted. */
+    changeRecord *records;
+    size_t count;
+    size_t capacity;
+    size_t total;
+    uint8_t *data;
+    size_t dataLen;
+    size_t dataCapacity;
+
+    bool txnOpen; /* Between kvidxBegin() and kvidxCommit()/kvidxAbort() */
+    int hold;     /* kvidxChangeHold() depth */
+    uint64_t seq;
+    uint64_t commits;
+};
+
+/* ====================================================================
+ * Subscriptions
+ * ==================================================================== */
+
+static void feedResize(kvidxChangeFeed *f) {
+    f->largestRing = 0;
+    for (kvidxSubscription *sub = f->subs; sub; sub = sub->next) {
+        if (sub->mask + 1 > f->largestRing) {
+            f->largestRing = sub->mask + 1;
+        }
+    }
+}
+
+kvidxSubscription *kvidxSubscribe(kvidxInstance *i, size_t capacity) {
+    if (!i || capacity > CHANGE_RING_MAX) {
+        if (i) {
+            kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                          "Subscription capacity %zu exceeds %zu", capacity,
+                          CHANGE_RING_MAX);
+        }
+        return NULL;
+    }
+
+    size_t slots = CHANGE_RING_DEFAULT;
+    if (capacity) {
+        slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+    }
+
+    if (!i->changes) {
+        i->changes = calloc(1, sizeof(*i->changes));
+        if (!i->changes) {
+            kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                          "Failed to allocate change feed");
+            return NULL;
+        }
+    }
+
+    kvidxSubscription *sub = calloc(1, sizeof(*sub));
+    if (sub) {
+        sub->slots = calloc(slots, sizeof(*sub->slots));
+    }
+    if (!sub || !sub->slots) {
+        free(sub);
+        kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                      "Failed to allocate %zu-change subscription", slots);
+        return NULL;
+    }
+    sub->mask = slots - 1;
+
+    sub->next = i->changes->subs;
+    i->changes->subs = sub;
+    feedResize(i->changes);
+    return sub;
+}
+
+static void subscriptionFree(kvidxSubscription *sub) {
+    for (size_t n = 0; n <= sub->mask; n++) {
+        free(sub->slots[n].buf);
+    }
+    free(sub->slots);
+    free(sub);
+}
+
+void kvidxUnsubscribe(kvidxInstance *i, kvidxSubscription *sub) {
+    if (!i || !sub || !i->changes) {
+        return;
+    }
+
+    kvidxSubscription **link = &i->changes->subs;
+    while (*link && *link != sub) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = sub->next;
+        subscriptionFree(sub);
+        feedResize(i->changes);
+    }
+}
+
+size_t kvidxSubscriptionPoll(kvidxSubscription *sub, kvidxChange *out,
+                             size_t max) {
+    if (!sub) {
+        return 0;
+    }
+
+    /* Hand the slots from the last poll back to the producer */
+    uint64_t tail = sub->tail + sub->held;
+    sub->held = 0;
+    __atomic_store_n(&sub->tail, tail, __ATOMIC_RELEASE);
+
+    if (!out) {
+        return 0;
+    }
+
+    const uint64_t head = __atomic_load_n(&sub->head, __ATOMIC_ACQUIRE);
+    size_t n = (size_t)(head - tail);
+    if (n > max) {
+        n = max;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        out[k] = sub->slots[(tail + k) & sub->mask].change;
+    }
+    sub->held = n;
+    return n;
+}
+
+uint64_t kvidxSubscriptionDropped(const kvidxSubscription *sub) {
+    if (!sub) {
+        return 0;
+    }
+    return __atomic_load_n(&sub->dropped, __ATOMIC_RELAXED);
+}
+
+/* ====================================================================
+ * Recording (called from the writing thread)
+ * ==================================================================== */
+
+bool kvidxChangeActive(const kvidxInstance *i) {
+    return i->changes && i->changes->subs;
+}
+
+void kvidxChangeRecord(kvidxInstance *i, kvidxChangeType type, uint64_t key,
+                       uint64_t endKey, uint64_t term, uint64_t cmd,
+                       const void *data, size_t dataLen) {
+    kvidxChangeFeed *f = i->changes;
+    if (!f || !f->subs) {
+        return;
+    }
+
+    /* Past the largest ring the batch will be dropped, so only count */
+    f->total++;
+    if (f->count != f->total - 1 || f->count >= f->largestRing) {
+        return;
+    }
+
+    if (f->count == f->capacity) {
+        size_t capacity = f->capacity ? f->capacity * 2 : 64;
+        changeRecord *records =
+            realloc(f->records, capacity * sizeof(*records));
+        if (!records) {
+            return; /* Counted but not stored: the batch will be dropped */
+        }
+        f->records = records;
+        f->capacity = capacity;
+    }
+
+    if (f->dataLen + dataLen > f->dataCapacity) {
+        size_t capacity = f->dataCapacity ? f->dataCapacity : 4096;
+        while (capacity < f->dataLen + dataLen) {
+            capacity *= 2;
+        }
+        uint8_t *bytes = realloc(f->data, capacity);
+        if (!bytes) {
+            return;
+        }
+        f->data = bytes;
+        f->dataCapacity = capacity;
+    }
+
+    changeRecord *r = &f->records[f->count++];
+    r->type = type;
+    r->key = key;
+    r->endKey = endKey;
+    r->term = term;
+    r->cmd = cmd;
+    r->dataOffset = f->dataLen;
+    r->dataLen = dataLen;
+    if (dataLen) {
+        memcpy(f->data + f->dataLen, data, dataLen);
+        f->dataLen += dataLen;
+    }
+}
+
+void kvidxChangeNoteExpired(kvidxInstance *i, uint64_t key) {
+    kvidxChangeRecord(i, KVIDX_CHANGE_EXPIRE, key, key, 0, 0, NULL, 0);
+}
+
+size_t kvidxChangeMark(const kvidxInstance *i) {
+    return i->changes ? i->changes->total : 0;
+}
+
+void kvidxChangeRewind(kvidxInstance *i, size_t mark) {
+    kvidxChangeFeed *f = i->changes;
+    if (!f || mark >= f->total) {
+        return;
+    }
+
+    f->total = mark;
+    if (f->count > mark) {
+        f->dataLen = f->records[mark].dataOffset;
+        f->count = mark;
+    }
+}
+
+void kvidxChangeDropExpired(kvidxInstance *i, size_t mark, uint64_t minKey) {
+    kvidxChangeFeed *f = i->changes;
+    if (!f || f->count != f->total) {
+        return;
+    }
+
+    size_t kept = mark;
+    for (size_t n = mark; n < f->count; n++) {
+        const changeRecord *r = &f->records[n];
+        if (r->type != KVIDX_CHANGE_EXPIRE || r->key < minKey) {
+            f->records[kept++] = *r;
+        }
+    }
+    f->count = kept;
+    f->total = kept;
+}
+
+static void feedDiscard(kvidxChangeFeed *f) {
+    f->count = 0;
+    f->total = 0;
+    f->dataLen = 0;
+}
+
+/**
+ * Copy the batch into sub, or count it as dropped if it does not fit.
+ */
+static void publishTo(kvidxChangeFeed *f, kvidxSubscription *sub,
+                      uint64_t firstSeq) {
+    const size_t n = f->total;
+    const uint64_t size = sub->mask + 1;
+
+    if (sub->head + n - sub->tailSeen > size) {
+        sub->tailSeen = __atomic_load_n(&sub->tail, __ATOMIC_ACQUIRE);
+    }
+
+    bool fits = f->count == n && sub->head + n - sub->tailSeen <= size;
+    for (size_t k = 0; fits && k < n; k++) {
+        const changeRecord *r = &f->records[k];
+        changeSlot *slot = &sub->slots[(sub->head + k) & sub->mask];
+
+        if (slot->bufSize < r->dataLen) {
+            uint8_t *buf = realloc(slot->buf, r->dataLen);
+            if (!buf) {
+                fits = false;
+                break;
+            }
+            slot->buf = buf;
+            slot->bufSize = r->dataLen;
+        }
+        if (r->dataLen) {
+            memcpy(slot->buf, f->data + r->dataOffset, r->dataLen);
+        }
+
+        slot->change = (kvidxChange){.seq = firstSeq + k,
+                                     .commit = f->commits,
+                                     .type = r->type,
+                                     .lastInCommit = k + 1 == n,
+                                     .key = r->key,
+                                     .endKey = r->endKey,
+                                     .term = r->term,
+                                     .cmd = r->cmd,
+                                     .data = r->dataLen ? slot->buf : NULL,
+                                     .dataLen = r->dataLen};
+    }
+
+    if (fits) {
+        __atomic_store_n(&sub->head, sub->head + n, __ATOMIC_RELEASE);
+    } else {
+        __atomic_fetch_add(&sub->dropped, n, __ATOMIC_RELAXED);
+    }
+}
+
+static void feedPublish(kvidxChangeFeed *f) {
+    if (f->total) {
+        const uint64_t firstSeq = f->seq + 1;
+        f->seq += f->total;
+        f->commits++;
+        for (kvidxSubscription *sub = f->subs; sub; sub = sub->next) {
+            publishTo(f, sub, firstSeq);
+        }
+    }
+    feedDiscard(f);
+}
+
+void kvidxChangePublish(kvidxInstance *i) {
+    kvidxChangeFeed *f = i->changes;
+    if (f && !f->txnOpen && !f->hold) {
+        feedPublish(f);
+    }
+}
+
+void kvidxChangeHold(kvidxInstance *i) {
+    if (i->changes) {
+        i->changes->hold++;
+    }
+}
+
+void kvidxChangeRelease(kvidxInstance *i) {
+    if (i->changes && i->changes->hold > 0) {
+        i->changes->hold--;
+    }
+}
+
+void kvidxChangeBegin(kvidxInstance *i) {
+    kvidxChangeFeed *f = i->changes;
+    if (f) {
+        /* Anything still pending belonged to a transaction that ended
+         * without a successful commit or an abort through this API */
+        feedDiscard(f);
+        f->txnOpen = true;
+    }
+}
+
+void kvidxChangeCommit(kvidxInstance *i) {
+    kvidxChangeFeed *f = i->changes;
+    if (f) {
+        f->txnOpen = false;
+        if (!f->hold) {
+            feedPublish(f);
+        }
+    }
+}
+
+void kvidxChangeAbort(kvidxInstance *i) {
+    kvidxChangeFeed *f = i->changes;
+    if (f) {
+        f->txnOpen = false;
+        feedDiscard(f);
+    }
+}
+
+void kvidxChangeFree(kvidxInstance *i) {
+    kvidxChangeFeed *f = i->changes;
+    if (!f) {
+        return;
+    }
+
+    while (f->subs) {
+        kvidxSubscription *next = f->subs->next;
+        subscriptionFree(f->subs);
+        f->subs = next;
+    }
+    free(f->records);
+    free(f->data);
+    free(f);
+    i->changes = NULL;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+__BEGIN_DECLS
+
+/* Forward declaration */
+struct kvidxInstance;
+typedef struct kvidxSubscription kvidxSubscription;
+
+/**
+ * Kind of committed write reported by a subscription
+ */
+typedef enum {
+    KVIDX_CHANGE_INSERT,       /* Key created; term, cmd and data are set */
+    KVIDX_CHANGE_UPDATE,       /* Existing key replaced; term, cmd, data set */
+    KVIDX_CHANGE_REMOVE,       /* Key removed */
+    KVIDX_CHANGE_REMOVE_RANGE, /* Every key in [key, endKey] removed */
+    KVIDX_CHANGE_EXPIRE,       /* Key removed by kvidxExpireScan() */
+    KVIDX_CHANGE_RESET         /* Storage replaced; every key may differ */
+} kvidxChangeType;
+
+/**
+ * One committed write
+ *
+ * seq numbers every change on the instance and commit numbers every commit,
+ * both starting at 1. A gap in seq means changes were dropped because the
+ * subscription's ring was full (see kvidxSubscriptionDropped()).
+ */
+typedef struct kvidxChange {
+    uint64_t seq;         /* Position in the instance's change order */
+    uint64_t commit;      /* Commit this change belongs to */
+    kvidxChangeType type; /* What happened */
+    bool lastInCommit;    /* Final change of its commit */
+    uint64_t key;         /* Key written (first key for REMOVE_RANGE) */
+    uint64_t endKey;      /* Last key for REMOVE_RANGE/RESET, else key */
+    uint64_t term;        /* New term (INSERT/UPDATE only) */
+    uint64_t cmd;         /* New cmd (INSERT/UPDATE only) */
+    const uint8_t *data;  /* New value (INSERT/UPDATE only) */
+    size_t dataLen;       /* Length of data */
+} kvidxChange;
+
+/**
+ * Subscribe to the writes committed on an instance
+ *
+ * Each subscription owns a single-producer/single-consumer ring of capacity
+ * changes (rounded up to a power of two; 0 selects 4096). The thread that
+ * writes to the instance fills it when a transaction commits, or after each
+ * auto-commit write, and one other thread drains it with
+ * kvidxSubscriptionPoll() without any locking. A commit that does not fit
+ * in the free space of a ring is dropped from that ring whole.
+ *
+ * Writes made through the public API are reported, including imports.
+ * When kvidxReceiveStorageForReplication() or kvidxReplaceAll() swaps in
+ * the adapter's native files instead, the install is reported as a single
+ * RESET change over [0, UINT64_MAX] without the new entries; read them
+ * from the instance.
+ *
+ * @param i Instance handle
+ * @param capacity Ring size in changes (0 = 4096)
+ * @return Subscription handle, or NULL on error
+ *
+ * @note Call from the writing thread, outside of a transaction
+ * @note kvidxClose() releases any subscriptions still attached
+ */
+kvidxSubscription *kvidxSubscribe(struct kvidxInstance *i, size_t capacity);
+
+/**
+ * Detach and free a subscription
+ *
+ * @param i Instance handle
+ * @param sub Subscription from kvidxSubscribe() (NULL is ignored)
+ *
+ * @note Call from the writing thread once the consumer has stopped polling
+ */
+void kvidxUnsubscribe(struct kvidxInstance *i, kvidxSubscription *sub);
+
+/**
+ * Take the next committed changes, oldest first
+ *
+ * Releases the changes returned by the previous call, then fills out with
+ * up to max changes. Their data pointers stay valid until the next call.
+ *
+ * @param sub Subscription handle
+ * @param out Receives changes
+ * @param max Capacity of out
+ * @return Number of changes stored in out (0 if none are waiting)
+ *
+ * @note Only one thread may poll a subscription
+ */
+size_t kvidxSubscriptionPoll(kvidxSubscription *sub, kvidxChange *out,
+                             size_t max);
+
+/**
+ * Number of changes dropped because the ring was full
+ *
+ * @param sub Subscription handle
+ * @return Total changes dropped since kvidxSubscribe()
+ */
+uint64_t kvidxSubscriptionDropped(const kvidxSubscription *sub);
+
+__END_DECLS
@@ -0,0 +1,323 @@
+/**
+ * Checksums for kvidxkit
+ *
+ * CRC32C (Castagnoli polynomial, as used by iSCSI, ext4 and RocksDB). Uses
+ * the SSE4.2 crc32 instruction when the CPU has it (checked once at run
+ * time) or the ARMv8 CRC extension when compiled for it, and slice-by-8
+ * tables otherwise. All paths produce identical results.
+ *
+ * Also implements kvidxVerify(), which checks stored value checksums on
+ * several threads.
+ */
+
+/* Required for sysconf under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32C_HAS_SSE42 1
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32C_HAS_ARMV8 1
+#include <arm_acle.h>
+#endif
+
+/* Reflected Castagnoli polynomial */
+#define CRC32C_POLY 0x82F63B78U
+
+/* crc32cTable[k][n]: CRC of byte n followed by k zero bytes */
+static uint32_t crc32cTable[8][256];
+static pthread_once_t crc32cOnce = PTHREAD_ONCE_INIT;
+
+typedef uint32_t (*crc32cFn)(uint32_t crc, const uint8_t *p, size_t len);
+static crc32cFn crc32cUpdate;
+
+static uint32_t crc32cSoftware(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = crc32cTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        crc = crc32cTable[7][word & 0xFF] ^
+              crc32cTable[6][(word >> 8) & 0xFF] ^
+              crc32cTable[5][(word >> 16) & 0xFF] ^
+              crc32cTable[4][(word >> 24) & 0xFF] ^
+              crc32cTable[3][(word >> 32) & 0xFF] ^
+              crc32cTable[2][(word >> 40) & 0xFF] ^
+              crc32cTable[1][(word >> 48) & 0xFF] ^ crc32cTable[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+#endif
+
+    while (len--) {
+        crc = crc32cTable[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(CRC32C_HAS_SSE42)
+__attribute__((target("sse4.2"))) static uint32_t
+crc32cSse42(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = _mm_crc32_u8(crc, *p++);
+        len--;
+    }
+
+    uint64_t wide = crc;
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t)wide;
+
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#elif defined(CRC32C_HAS_ARMV8)
+static uint32_t crc32cArmv8(uint32_t crc, const uint8_t *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = __crc32cb(crc, *p++);
+        len--;
+    }
+
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+        p += 8;
+        len -= 8;
+    }
+
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+static void crc32cInit(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0U - (crc & 1)));
+        }
+        crc32cTable[0][n] = crc;
+    }
+
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int k = 1; k < 8; k++) {
+            const uint32_t prev = crc32cTable[k - 1][n];
+            crc32cTable[k][n] = crc32cTable[0][prev & 0xFF] ^ (prev >> 8);
+        }
+    }
+
+    crc32cUpdate = crc32cSoftware;
+#if defined(CRC32C_HAS_SSE42)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32cUpdate = crc32cSse42;
+    }
+#elif defined(CRC32C_HAS_ARMV8)
+    crc32cUpdate = crc32cArmv8;
+#endif
+}
+
+uint32_t kvidxCrc32c(uint32_t crc, const void *buf, size_t len) {
+    pthread_once(&crc32cOnce, crc32cInit);
+    return ~crc32cUpdate(~crc, buf, len);
+}
+
+uint32_t kvidxValueChecksum(uint64_t term, uint64_t cmd, const void *data,
+                            size_t len) {
+    const uint64_t header[2] = {term, cmd};
+    const uint32_t crc = kvidxCrc32c(0, header, sizeof(header));
+    return len ? kvidxCrc32c(crc, data, len) : crc;
+}
+
+/* ====================================================================
+ * Verification
+ * ==================================================================== */
+
+/* Partitions per thread, so sparse key ranges still balance */
+#define VERIFY_PARTITIONS_PER_THREAD 8
+
+typedef struct verifyJob {
+    kvidxInstance *i;
+    uint64_t firstKey;
+    uint64_t lastKey;
+    uint64_t span;       /* Keys per partition */
+    uint32_t partitions; /* Partition count */
+    uint32_t nextPartition;
+    kvidxVerifyResult result;
+    kvidxError error;
+    pthread_mutex_t lock;
+} verifyJob;
+
+typedef struct verifyWorker {
+    verifyJob *job;
+    kvidxInstance reader;
+    kvidxInstance *src;
+    pthread_t thread;
+    bool started;
+} verifyWorker;
+
+static void *verifyWorkerMain(void *arg) {
+    verifyWorker *w = arg;
+    verifyJob *job = w->job;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        const uint32_t p = job->error == KVIDX_OK
+                               ? job->nextPartition++
+                               : job->partitions;
+        pthread_mutex_unlock(&job->lock);
+        if (p >= job->partitions) {
+            return NULL;
+        }
+
+        const uint64_t start = job->firstKey + (uint64_t)p * job->span;
+        const uint64_t end =
+            p + 1 == job->partitions ? job->lastKey : start + job->span - 1;
+        kvidxVerifyResult part = {0};
+        kvidxError err =
+            w->src->interface.verifyRange(w->src, start, end, &part);
+
+        pthread_mutex_lock(&job->lock);
+        if (err != KVIDX_OK && job->error == KVIDX_OK) {
+            job->error = err;
+        }
+        job->result.entriesChecked += part.entriesChecked;
+        job->result.entriesUnchecked += part.entriesUnchecked;
+        if (part.corruptEntries &&
+            (!job->result.corruptEntries ||
+             part.firstCorruptKey < job->result.firstCorruptKey)) {
+            job->result.firstCorruptKey = part.firstCorruptKey;
+        }
+        job->result.corruptEntries += part.corruptEntries;
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+static kvidxError verify(kvidxInstance *i, uint64_t startKey,
+                         uint64_t endKey, uint32_t threads,
+                         kvidxVerifyResult *result) {
+    /* Partition only the keys actually present in the range */
+    uint64_t firstKey = 0;
+    uint64_t lastKey = 0;
+    if (kvidxGetMinKey(i, &firstKey) != KVIDX_OK || !kvidxMaxKey(i, &lastKey)) {
+        return KVIDX_OK;
+    }
+    firstKey = firstKey < startKey ? startKey : firstKey;
+    lastKey = lastKey > endKey ? endKey : lastKey;
+    if (firstKey > lastKey) {
+        return KVIDX_OK;
+    }
+
+    const uint64_t keySpan = lastKey - firstKey;
+    threads = kvidxWorkerCount(
+        threads, keySpan == UINT64_MAX ? UINT64_MAX : keySpan + 1);
+
+    verifyWorker *workers = calloc(threads, sizeof(*workers));
+    if (!workers) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate workers");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    /* Each extra thread needs its own reader; without one, i is scanned
+     * on this thread alone */
+    uint32_t readers = 0;
+    while (readers + 1 < threads && i->interface.openReader &&
+           i->interface.openReader(i, &workers[readers + 1].reader)) {
+        readers++;
+    }
+    threads = readers + 1;
+
+    const uint64_t partitions =
+        (uint64_t)threads * VERIFY_PARTITIONS_PER_THREAD;
+    verifyJob job = {.i = i,
+                     .firstKey = firstKey,
+                     .lastKey = lastKey,
+                     .span = keySpan / partitions + 1,
+                     .error = KVIDX_OK};
+    job.partitions = (uint32_t)(keySpan / job.span + 1);
+    pthread_mutex_init(&job.lock, NULL);
+
+    for (uint32_t n = 0; n < threads; n++) {
+        workers[n].job = &job;
+        workers[n].src = n == 0 ? i : &workers[n].reader;
+    }
+    for (uint32_t n = 1; n < threads; n++) {
+        workers[n].started = pthread_create(&workers[n].thread, NULL,
+                                            verifyWorkerMain, &workers[n]) == 0;
+    }
+
+    /* The calling thread verifies too */
+    verifyWorkerMain(&workers[0]);
+
+    for (uint32_t n = 1; n < threads; n++) {
+        if (workers[n].started) {
+            pthread_join(workers[n].thread, NULL);
+        }
+        workers[n].reader.interface.close(&workers[n].reader);
+    }
+    pthread_mutex_destroy(&job.lock);
+    free(workers);
+
+    *result = job.result;
+    if (job.error != KVIDX_OK) {
+        kvidxSetError(i, job.error, "Verify failed after %" PRIu64 " entries",
+                      result->entriesChecked);
+        return job.error;
+    }
+
+    if (result->corruptEntries) {
+        kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                      "%" PRIu64 " entries fail their checksum, first at "
+                      "key %" PRIu64,
+                      result->corruptEntries, result->firstCorruptKey);
+        return KVIDX_ERROR_CORRUPT;
+    }
+
+    return KVIDX_OK;
+}
+
+kvidxError kvidxVerify(kvidxInstance *i, uint64_t startKey, uint64_t endKey,
+                       uint32_t threads, kvidxVerifyResult *result) {
+    if (!i || !result || startKey > endKey) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    memset(result, 0, sizeof(*result));
+    if (!i->interface.verifyRange) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Adapter does not store value checksums");
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_VERIFY, startKey, endKey, 0);
+    const kvidxError err = verify(i, startKey, endKey, threads, result);
+    kvidxMetricsRecord(i, &span, result->entriesChecked);
+    return err;
+}
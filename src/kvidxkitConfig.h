@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 __BEGIN_DECLS
 
@@ -31,6 +32,54 @@ typedef enum {
     KVIDX_SYNC_EXTRA   /**< Extra safety checks (paranoid) */
 } kvidxSyncMode;
 
+/**
+ * Block compression configuration (RocksDB)
+ */
+typedef enum {
+    KVIDX_COMPRESSION_DEFAULT, /**< Keep the backend's default (Snappy) */
+    KVIDX_COMPRESSION_NONE,    /**< No compression */
+    KVIDX_COMPRESSION_SNAPPY,  /**< Snappy (fast, moderate ratio) */
+    KVIDX_COMPRESSION_ZLIB,    /**< zlib */
+    KVIDX_COMPRESSION_LZ4,     /**< LZ4 (fast, good for upper levels) */
+    KVIDX_COMPRESSION_LZ4HC,   /**< LZ4 high compression */
+    KVIDX_COMPRESSION_ZSTD     /**< Zstandard (best ratio, bottom levels) */
+} kvidxCompression;
+
+/**
+ * Block cache shareable between RocksDB instances
+ * (see kvidxRocksdbBlockCacheCreate())
+ */
+typedef struct kvidxBlockCache kvidxBlockCache;
+
+/**
+ * LMDB map fill warning callback
+ *
+ * Invoked (once per crossing) when map usage reaches
+ * kvidxConfig.lmdbMapWarnPercent of the growth ceiling.
+ *
+ * @param usedBytes   Bytes of the map in use
+ * @param limitBytes  lmdbMaxMapSizeBytes, or the current map size if unbounded
+ * @param userData    kvidxConfig.lmdbMapWarningUserData
+ */
+typedef void (*kvidxMapWarningCallback)(uint64_t usedBytes,
+                                        uint64_t limitBytes, void *userData);
+
+/* Defined in kvidxkitMetrics.h */
+struct kvidxTraceRecord;
+
+/**
+ * Traced operation callback
+ *
+ * Invoked for every operation picked by kvidxConfig.traceSampleEvery or
+ * traceSlowNanos, on the thread that made the call, right after it
+ * returns from the adapter. Keep it short: the caller is waiting.
+ *
+ * @param record    The operation (valid only during the call)
+ * @param userData  kvidxConfig.traceUserData
+ */
+typedef void (*kvidxTraceCallback)(const struct kvidxTraceRecord *record,
+                                   void *userData);
+
 /**
  * Configuration structure for opening/managing database
  */
@@ -48,6 +97,177 @@ typedef struct {
     int mmapSizeBytes; /**< Memory-map I/O size, 0 to disable (default: 0) */
     int pageSize; /**< Page size in bytes, must be power of 2 (default: 4096,
                      0=default) */
+    int lmdbValueFormat; /**< LMDB value format for newly created environments:
+                            1 = term|cmd|data, 2 = adds flags byte and inline
+                            expiry (default: 2, 0=default). Existing
+                            environments keep the format they were created
+                            with. */
+    uint64_t lmdbMapSizeBytes;    /**< Initial LMDB map size (default: 1 GB,
+                                     0=default) */
+    uint64_t lmdbMaxMapSizeBytes; /**< Ceiling for automatic LMDB map growth
+                                     on MDB_MAP_FULL (default: 0=unbounded) */
+    int lmdbMapWarnPercent; /**< Map fill % of the ceiling that fires
+                               lmdbMapWarning (default: 80, 0=default,
+                               negative disables) */
+    kvidxMapWarningCallback lmdbMapWarning; /**< Map fill warning (default:
+                                               NULL) */
+    void *lmdbMapWarningUserData; /**< Passed to lmdbMapWarning */
+
+    /* LMDB environment flags. Durability notes are relative to the default
+     * (msync + fsync of data and meta page on every commit). */
+    bool lmdbWriteMap;   /**< MDB_WRITEMAP: write dirty pages straight into a
+                            writable map instead of malloc'd buffers. Faster
+                            large commits; a stray write through a returned
+                            pointer can now corrupt the file (default: false,
+                            open-time only) */
+    bool lmdbMapAsync;   /**< MDB_MAPASYNC: with lmdbWriteMap, flush the map
+                            asynchronously. A system crash may lose recent
+                            commits, but the file stays consistent
+                            (default: false) */
+    bool lmdbNoMetaSync; /**< MDB_NOMETASYNC: skip the meta page fsync. A
+                            system crash may undo the last commit; ACI kept,
+                            D deferred to the next commit or kvidxFsync()
+                            (default: false) */
+    bool lmdbNoReadAhead; /**< MDB_NORDAHEAD: disable OS readahead. Helps
+                             random reads on data sets larger than RAM; no
+                             durability impact (default: false, open-time
+                             only) */
+    bool lmdbNoMemInit;   /**< MDB_NOMEMINIT: don't zero malloc'd pages before
+                             writing. Unused bytes of a page may leak stale
+                             heap memory into the file; no durability impact
+                             (default: false) */
+    int lmdbMaxReaders;   /**< Max concurrent read txns across all processes
+                             (default: 126, 0=default, open-time only and only
+                             when the lock file is created) */
+    bool lmdbCompactCopy; /**< MDB_CP_COMPACT for
+                             kvidxCopyStorageForReplication(): skip free
+                             pages and renumber the rest. Smaller copy,
+                             more CPU (default: false, runtime changeable) */
+
+    /* RocksDB tuning. Read at open time unless noted. */
+    size_t rocksdbBlockCacheBytes; /**< Private LRU block cache size (default:
+                                      0=RocksDB default) */
+    kvidxBlockCache *rocksdbSharedBlockCache; /**< Use this cache instead of a
+                                                 private one (default: NULL)
+                                               */
+    int rocksdbBloomBitsPerKey; /**< Full-key bloom filter bits per key, 0 to
+                                   disable (default: 10) */
+    kvidxCompression rocksdbCompression; /**< Compression for all levels
+                                            (default: DEFAULT) */
+    const kvidxCompression *rocksdbCompressionPerLevel; /**< Per-level
+                                                           compression, L0
+                                                           first (default:
+                                                           NULL) */
+    size_t rocksdbCompressionLevelCount; /**< Entries in
+                                            rocksdbCompressionPerLevel */
+    size_t rocksdbWriteBufferBytes;  /**< Memtable size (default: 0=64 MB) */
+    int rocksdbMaxWriteBufferNumber; /**< Memtables before writes stall
+                                        (default: 0=2) */
+    int rocksdbMaxBackgroundJobs;    /**< Flush + compaction threads (default:
+                                        0=2) */
+    bool rocksdbPipelinedWrite; /**< enable_pipelined_write: overlap WAL and
+                                   memtable writes (default: false) */
+    bool rocksdbUnorderedWrite; /**< unordered_write: higher write throughput,
+                                   snapshots may observe writes out of order.
+                                   Incompatible with rocksdbPipelinedWrite
+                                   (default: false) */
+    bool rocksdbDisableWAL; /**< Skip the write-ahead log. Unflushed writes are
+                               lost on any crash; for bulk loads followed by
+                               kvidxFsync() (default: false, runtime
+                               changeable) */
+    uint64_t rocksdbCompactAfterDeleteKeys; /**< Compact the range after a
+                                               range delete spanning at
+                                               least this many keys, so
+                                               seeks skip its tombstones
+                                               (default: 0=100000,
+                                               UINT64_MAX never, runtime
+                                               changeable) */
+
+    /* SQLite WAL checkpointing */
+    int sqliteWalAutoCheckpoint; /**< Inline checkpoint threshold in WAL pages
+                                    (PRAGMA wal_autocheckpoint). Unused while
+                                    sqliteBackgroundCheckpoint is on (default:
+                                    0=SQLite default 1000, negative disables)
+                                  */
+    bool sqliteBackgroundCheckpoint; /**< Checkpoint the WAL from a background
+                                        thread instead of inline on commit
+                                        (default: false) */
+    int sqliteCheckpointIdleMs; /**< Write-idle time before a PASSIVE
+                                   background checkpoint (default: 0=100 ms) */
+    uint64_t sqliteWalSizeLimitBytes; /**< WAL size that triggers a TRUNCATE
+                                         background checkpoint (default:
+                                         0=64 MB) */
+    bool sqliteBackgroundVacuum; /**< While the background checkpointer is
+                                    idle, also run incremental vacuum steps
+                                    of reclaimPagesPerStep pages (default:
+                                    false) */
+    int sqliteBackupPagesPerStep; /**< Pages copied per backup step by
+                                     kvidxCopyStorageForReplication();
+                                     writers can commit between steps
+                                     (default: 0=1024, runtime changeable) */
+
+    /* Space reclamation (see kvidxReclaimSpace()) */
+    uint64_t reclaimPagesPerStep; /**< Pages freed per step when maxPages is
+                                     0 (default: 0=1024, runtime
+                                     changeable) */
+    int lmdbReclaimFreePercent; /**< Free pages, as a percentage of
+                                   data.mdb, at which a step compacts it
+                                   (default: 0=50, runtime changeable) */
+
+    /* Seglog tuning */
+    uint64_t seglogSegmentBytes; /**< Preallocated size of new segment files,
+                                    4 KB to ~4 GB (default: 0=16 MB,
+                                    runtime changeable) */
+
+    /* Tiered adapter */
+    const char *tieredColdAdapter; /**< Registry name of the persistent tier,
+                                      read at open (default: NULL=first
+                                      persistent adapter built in) */
+    uint64_t tieredHotMaxKeys;  /**< Keys kept in the memory tier (default:
+                                   0=65536, runtime changeable) */
+    uint64_t tieredHotMaxBytes; /**< Value bytes kept in the memory tier
+                                   (default: 0=64 MB, runtime changeable) */
+    uint64_t tieredFlushBatchKeys; /**< Unflushed keys that wake the
+                                      background flusher (default: 0=4096,
+                                      runtime changeable) */
+    int tieredFlushIntervalMs; /**< Longest a write waits for the flusher
+                                  (default: 0=1000 ms, runtime changeable) */
+
+    /* Value checksums (CRC32C of term, cmd and data) */
+    bool valueChecksums;  /**< Store a checksum with every value written.
+                             LMDB needs value format 2; SQLite adds a crc
+                             column; RocksDB records it when the database
+                             is created (default: false, runtime changeable
+                             for LMDB and SQLite) */
+    bool verifyChecksums; /**< Check stored checksums on every read. A
+                             mismatch fails the read with
+                             KVIDX_ERROR_CORRUPT (default: false, runtime
+                             changeable) */
+
+    /* Instrumentation (see kvidxGetMetrics()) */
+    bool metrics; /**< Record a latency histogram for every public
+                     operation. Ignored unless built with
+                     KVIDXKIT_ENABLE_METRICS (default: false, runtime
+                     changeable) */
+    bool metricsIo; /**< Also count the rows, bytes, syncs and
+                       transactions each operation causes. Needs metrics;
+                       reads the adapter's counters twice per operation
+                       (default: false, runtime changeable) */
+
+    /* Tracing (see kvidxGetSlowOps()). Ignored unless built with
+     * KVIDXKIT_ENABLE_METRICS */
+    uint32_t traceSampleEvery; /**< Trace 1 in N operations of each thread
+                                  (default: 0 = off, runtime changeable) */
+    uint64_t traceSlowNanos;   /**< Trace every operation taking at least
+                                  this long and keep it in the slow op log
+                                  (default: 0 = off, runtime changeable) */
+    uint32_t traceSlowLogSize; /**< Slow ops kept, rounded up to a power of
+                                  two up to 1048576 (default: 0 = 256;
+                                  fixed once the log exists) */
+    kvidxTraceCallback traceCallback; /**< Receives each traced operation
+                                         (default: NULL, runtime
+                                         changeable) */
+    void *traceUserData;              /**< Passed to traceCallback */
 } kvidxConfig;
 
 __END_DECLS
@@ -16,6 +16,32 @@ typedef enum {
     KVIDX_EXPORT_CSV     /**< CSV format (spreadsheet-compatible) */
 } kvidxExportFormat;
 
+/**
+ * Binary format layouts (kvidxExportOptions.binaryVersion)
+ *
+ * STREAM is a header followed by every entry in key order. BLOCKS splits
+ * the entries into independent checksummed blocks followed by a block
+ * index, so export and import can both run on several threads.
+ */
+#define KVIDX_BINARY_VERSION_STREAM 1
+#define KVIDX_BINARY_VERSION_BLOCKS 2
+
+/**
+ * Layout written by kvidxExportIncremental(): the STREAM layout with a
+ * kvidxExportToken after the header. Importing it replaces existing keys.
+ */
+#define KVIDX_BINARY_VERSION_INCREMENTAL 3
+
+/**
+ * Target payload size of one block in the BLOCKS layout
+ */
+#define KVIDX_EXPORT_BLOCK_BYTES (4 * 1024 * 1024)
+
+/**
+ * Default transaction size of a file import (kvidxImportOptions.commitBytes)
+ */
+#define KVIDX_IMPORT_COMMIT_BYTES (64 * 1024 * 1024)
+
 /**
  * Export options structure
  */
@@ -25,6 +51,9 @@ typedef struct {
     uint64_t endKey;          /**< End of key range (UINT64_MAX = to end) */
     bool includeMetadata;     /**< Include term/cmd metadata (CSV/JSON only) */
     bool prettyPrint; /**< Pretty-print JSON (ignored for other formats) */
+    uint32_t binaryVersion; /**< Binary layout (0 = STREAM) */
+    uint32_t threads;       /**< Threads for the BLOCKS layout (0 = CPUs) */
+    bool appendOnly; /**< Incremental: old keys never change, scan only new */
 } kvidxExportOptions;
 
 /**
@@ -35,8 +64,36 @@ typedef struct {
     bool validateData;        /**< Validate data during import */
     bool skipDuplicates;      /**< Skip duplicate keys instead of failing */
     bool clearBeforeImport;   /**< Clear database before importing */
+    uint32_t threads; /**< Threads reading BLOCKS layout files (0 = CPUs) */
+    uint64_t commitBytes; /**< Commit after this many bytes of entries
+                               (0 = KVIDX_IMPORT_COMMIT_BYTES, UINT64_MAX =
+                               one transaction) */
 } kvidxImportOptions;
 
+/**
+ * Position of an incremental export (kvidxExportIncremental())
+ *
+ * A pass over [startKey, endKey] exports every entry whose key is at least
+ * sinceKey or whose term is at least sinceTerm: new keys, and keys rewritten
+ * with a newer term. The token is returned to the caller and stored in the
+ * export's header.
+ *
+ * Passing an incomplete token back continues the same pass from nextKey.
+ * Passing a complete one starts the next pass, with sinceKey = newKey and
+ * sinceTerm = newTerm.
+ */
+typedef struct {
+    uint64_t startKey;  /**< Key range of every pass */
+    uint64_t endKey;    /**< ... */
+    uint64_t sinceKey;  /**< This pass exports keys >= sinceKey ... */
+    uint64_t sinceTerm; /**< ... and entries with term >= sinceTerm */
+    uint64_t nextKey;   /**< First key this pass has not scanned yet */
+    uint64_t newKey;    /**< One past the highest key seen (next sinceKey) */
+    uint64_t newTerm;   /**< One past the highest term seen (next sinceTerm) */
+    uint64_t entries;   /**< Entries written to this export */
+    bool complete;      /**< This pass reached endKey */
+} kvidxExportToken;
+
 /**
  * Progress callback for export/import operations
  *
@@ -48,6 +105,35 @@ typedef struct {
 typedef bool (*kvidxProgressCallback)(uint64_t current, uint64_t total,
                                       void *userData);
 
+/**
+ * Buffer size used by the streaming export/import functions. Callbacks see
+ * writes and reads of up to this many bytes (larger only for single values
+ * bigger than the buffer).
+ */
+#define KVIDX_STREAM_BUFFER_BYTES (1024 * 1024)
+
+/**
+ * Sink for kvidxExportToStream()
+ *
+ * @param buf Bytes to write
+ * @param len Number of bytes (never 0)
+ * @param streamData User-provided context
+ * @return true if all len bytes were written, false to fail the export
+ */
+typedef bool (*kvidxStreamWriteCallback)(const void *buf, size_t len,
+                                         void *streamData);
+
+/**
+ * Source for kvidxImportFromStream()
+ *
+ * @param buf Destination for the bytes read
+ * @param len Maximum number of bytes to read
+ * @param streamData User-provided context
+ * @return Bytes read (may be fewer than len), 0 at end of stream, -1 on error
+ */
+typedef int64_t (*kvidxStreamReadCallback)(void *buf, size_t len,
+                                           void *streamData);
+
 /**
  * Get default export options
  *
@@ -50,6 +50,11 @@ kvidxIterator *kvidxIteratorCreate(kvidxInstance *i, uint64_t startKey,
     it->valid = false;
     it->initialized = false;
 
+    /* Keep returned data alive across writes, where supported */
+    if (i->interface.pinReads) {
+        i->interface.pinReads(i);
+    }
+
     return it;
 }
 
@@ -301,6 +306,10 @@ bool kvidxIteratorSeek(kvidxIterator *it, uint64_t key) {
 
 void kvidxIteratorDestroy(kvidxIterator *it) {
     if (it) {
+        kvidxInstance *i = it->instance;
+        if (i && i->interface.unpinReads) {
+            i->interface.unpinReads(i);
+        }
         free(it);
     }
 }
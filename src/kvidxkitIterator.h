@@ -32,7 +32,9 @@ typedef enum {
  * @return Iterator handle, or NULL on error
  *
  * @note Caller must call kvidxIteratorDestroy() when done
- * @note Iterator becomes invalid if database is modified
+ * @note Iterator becomes invalid if database is modified, unless the
+ *       adapter supports read pins (interface.pinReads), in which case
+ *       data pointers stay valid until the iterator is destroyed
  */
 kvidxIterator *kvidxIteratorCreate(struct kvidxInstance *i, uint64_t startKey,
                                    uint64_t endKey,
@@ -0,0 +1,161 @@
+/**
+ * Log maintenance for kvidxkit
+ *
+ * kvidxRemoveRangeIncremental() compacts a log in small steps: every chunk
+ * of the range is a separate kvidxRemoveRange() call, committed on its own,
+ * and the caller's key and time budgets decide how many chunks run before
+ * control returns. Before each chunk, the scan for the next stored key
+ * skips over gaps, so a sparse range costs one transaction per
+ * KVIDX_REMOVE_CHUNK_KEYS keys actually stored, not per key of its width.
+ *
+ * kvidxReclaimSpace() then gives the freed space back to the file system
+ * through the adapter's interface.reclaimSpace, one bounded step per call,
+ * and keeps running totals on the instance for kvidxGetStats().
+ */
+
+/* Required for clock_gettime under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <string.h>
+#include <time.h>
+
+/* Pages freed per kvidxReclaimSpace() step by default */
+#define RECLAIM_PAGES_PER_STEP_DEFAULT 1024
+
+static uint64_t nowMicros(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+typedef struct firstKey {
+    uint64_t key;
+    bool found;
+} firstKey;
+
+static bool firstKeyVisit(void *ctx, uint64_t key, uint64_t term, uint64_t cmd,
+                          const uint8_t *data, size_t len) {
+    (void)term;
+    (void)cmd;
+    (void)data;
+    (void)len;
+    firstKey *first = ctx;
+    first->key = key;
+    first->found = true;
+    return false;
+}
+
+static kvidxError removeIncremental(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, uint64_t budgetKeys,
+                                    uint64_t budgetMicros,
+                                    kvidxRemoveProgress *progress) {
+    const uint64_t started = budgetMicros ? nowMicros() : 0;
+    uint64_t cursor =
+        progress->nextKey > startKey ? progress->nextKey : startKey;
+    uint64_t removed = 0;
+
+    while (cursor <= endKey) {
+        firstKey first = {0};
+        kvidxError result =
+            kvidxScanRange(i, cursor, endKey, firstKeyVisit, &first);
+        if (result != KVIDX_OK) {
+            progress->nextKey = cursor;
+            return result;
+        }
+        if (!first.found) {
+            break;
+        }
+
+        uint64_t chunk = KVIDX_REMOVE_CHUNK_KEYS;
+        if (budgetKeys && budgetKeys - removed < chunk) {
+            chunk = budgetKeys - removed;
+        }
+        const uint64_t last =
+            endKey - first.key < chunk ? endKey : first.key + chunk - 1;
+
+        uint64_t deleted = 0;
+        result = kvidxRemoveRange(i, first.key, last, true, true, &deleted);
+        if (result != KVIDX_OK) {
+            progress->nextKey = first.key;
+            return result;
+        }
+        removed += deleted;
+        progress->removed += deleted;
+        progress->chunks++;
+
+        if (last == endKey) {
+            break;
+        }
+        cursor = last + 1;
+        progress->nextKey = cursor;
+
+        if ((budgetKeys && removed >= budgetKeys) ||
+            (budgetMicros && nowMicros() - started >= budgetMicros)) {
+            return KVIDX_OK;
+        }
+    }
+
+    /* Past the range, or UINT64_MAX when the range ends there */
+    progress->nextKey = endKey == UINT64_MAX ? UINT64_MAX : endKey + 1;
+    progress->done = true;
+    return KVIDX_OK;
+}
+
+kvidxError kvidxRemoveRangeIncremental(kvidxInstance *i, uint64_t startKey,
+                                       uint64_t endKey, uint64_t budgetKeys,
+                                       uint64_t budgetMicros,
+                                       kvidxRemoveProgress *progress) {
+    if (!i || !progress || startKey > endKey) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (progress->done) {
+        return KVIDX_OK;
+    }
+
+    const uint64_t before = progress->removed;
+    const kvidxMetricsSpan span = kvidxMetricsStartKeys(
+        i, KVIDX_OP_REMOVE_RANGE_INCREMENTAL, startKey, endKey, 0);
+    const kvidxError result = removeIncremental(
+        i, startKey, endKey, budgetKeys, budgetMicros, progress);
+    kvidxMetricsRecord(i, &span, progress->removed - before);
+    return result;
+}
+
+kvidxError kvidxReclaimSpace(kvidxInstance *i, uint64_t maxPages,
+                             kvidxReclaimResult *result) {
+    kvidxReclaimResult step = {0};
+    if (result) {
+        memset(result, 0, sizeof(*result));
+    }
+    if (!i) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (!i->interface.reclaimSpace) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Adapter does not reclaim space");
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    if (!maxPages) {
+        maxPages = i->configInitialized && i->config.reclaimPagesPerStep
+                       ? i->config.reclaimPagesPerStep
+                       : RECLAIM_PAGES_PER_STEP_DEFAULT;
+    }
+
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_RECLAIM_SPACE);
+    const kvidxError err = i->interface.reclaimSpace(i, maxPages, &step);
+    i->pagesReclaimed += step.pagesFreed;
+    i->bytesReclaimed += step.bytesReclaimed;
+    kvidxMetricsRecord(i, &span, 0);
+    if (result) {
+        *result = step;
+    }
+    return err;
+}
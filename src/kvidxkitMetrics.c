@@ -0,0 +1,719 @@
+/**
+ * Operation latency metrics for kvidxkit
+ *
+ * The public wrappers in kvidxkit.c time each adapter call with the
+ * inline kvidxMetricsStart()/kvidxMetricsRecord() pair from
+ * kvidxkit_internal.h. Durations are measured with the CPU's cycle
+ * counter (rdtsc on x86, cntvct_el0 on arm64, CLOCK_MONOTONIC elsewhere)
+ * and counted in log-linear buckets of counter ticks. Each thread claims
+ * a shard of the histograms and is its only writer, so recording takes no
+ * lock and, in the common case, no locked instruction either.
+ *
+ * kvidxGetMetrics() merges the shards, works out the counter rate from
+ * the clock readings taken when metrics were enabled and now, and moves
+ * every tick bucket to the nanosecond bucket holding its midpoint. The
+ * counter has to run at a constant rate, which every x86 CPU with an
+ * invariant TSC and every arm64 generic timer does.
+ *
+ * Work counters (kvidxConfig.metricsIo) are running totals: the adapter's
+ * interface.ioCounters, the rows the wrappers report and the pages
+ * kvidxReclaimSpace() freed. Each operation adds the difference between
+ * the totals read before and after it to its shard.
+ *
+ * Tracing (kvidxConfig.traceSampleEvery, traceSlowNanos) looks at the
+ * ticks a call took once it returns. A call picked by the per-thread
+ * sample countdown or taking at least traceSlowNanos becomes a
+ * kvidxTraceRecord for traceCallback, and slow ones are also put in the
+ * instance's slow op log. The log is a ring of seqlocked slots: writers
+ * take a position with one atomic add and copy their record in, readers
+ * copy records out and drop any whose sequence changed meanwhile.
+ */
+
+/* Required for clock_gettime and nanosleep under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkitRegistry.h"
+#include "kvidxkit_internal.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__)
+#define METRICS_TICKS_ARE_NANOS 0
+#else
+#define METRICS_TICKS_ARE_NANOS 1
+#endif
+
+/* Shortest span the counter rate is measured over */
+#define METRICS_CALIBRATE_NANOS 1000000
+
+/* Slow ops kept when kvidxConfig.traceSlowLogSize is 0, and at most */
+#define TRACE_LOG_DEFAULT 256
+#define TRACE_LOG_MAX (1 << 20)
+
+static const char *opNames[KVIDX_OP_COUNT] = {
+    [KVIDX_OP_BEGIN] = "begin",
+    [KVIDX_OP_COMMIT] = "commit",
+    [KVIDX_OP_ABORT] = "abort",
+    [KVIDX_OP_FSYNC] = "fsync",
+    [KVIDX_OP_GET] = "get",
+    [KVIDX_OP_GET_PREV] = "get_prev",
+    [KVIDX_OP_GET_NEXT] = "get_next",
+    [KVIDX_OP_EXISTS] = "exists",
+    [KVIDX_OP_EXISTS_DUAL] = "exists_dual",
+    [KVIDX_OP_MAX_KEY] = "max_key",
+    [KVIDX_OP_INSERT] = "insert",
+    [KVIDX_OP_INSERT_EX] = "insert_ex",
+    [KVIDX_OP_INSERT_BATCH] = "insert_batch",
+    [KVIDX_OP_REMOVE] = "remove",
+    [KVIDX_OP_REMOVE_AFTER] = "remove_after",
+    [KVIDX_OP_REMOVE_BEFORE] = "remove_before",
+    [KVIDX_OP_REMOVE_RANGE] = "remove_range",
+    [KVIDX_OP_COUNT_RANGE] = "count_range",
+    [KVIDX_OP_EXISTS_IN_RANGE] = "exists_in_range",
+    [KVIDX_OP_SCAN_RANGE] = "scan_range",
+    [KVIDX_OP_GET_AND_SET] = "get_and_set",
+    [KVIDX_OP_GET_AND_REMOVE] = "get_and_remove",
+    [KVIDX_OP_COMPARE_AND_SWAP] = "compare_and_swap",
+    [KVIDX_OP_APPEND] = "append",
+    [KVIDX_OP_PREPEND] = "prepend",
+    [KVIDX_OP_GET_VALUE_RANGE] = "get_value_range",
+    [KVIDX_OP_SET_VALUE_RANGE] = "set_value_range",
+    [KVIDX_OP_SET_EXPIRE] = "set_expire",
+    [KVIDX_OP_GET_TTL] = "get_ttl",
+    [KVIDX_OP_PERSIST] = "persist",
+    [KVIDX_OP_EXPIRE_SCAN] = "expire_scan",
+    [KVIDX_OP_EXPORT] = "export",
+    [KVIDX_OP_IMPORT] = "import",
+    [KVIDX_OP_GET_STATS] = "get_stats",
+    [KVIDX_OP_RECLAIM_SPACE] = "reclaim_space",
+    [KVIDX_OP_EXPORT_STREAM] = "export_stream",
+    [KVIDX_OP_IMPORT_STREAM] = "import_stream",
+    [KVIDX_OP_EXPORT_INCREMENTAL] = "export_incremental",
+    [KVIDX_OP_COPY_STORAGE] = "copy_storage",
+    [KVIDX_OP_RECEIVE_STORAGE] = "receive_storage",
+    [KVIDX_OP_REPLACE_ALL] = "replace_all",
+    [KVIDX_OP_APPLY_TO_STATE_MACHINE] = "apply_to_state_machine",
+    [KVIDX_OP_REPLAY_STATE_MACHINE] = "replay_state_machine",
+    [KVIDX_OP_VERIFY] = "verify",
+    [KVIDX_OP_REMOVE_RANGE_INCREMENTAL] = "remove_range_incremental",
+};
+
+/* Work counters with their Prometheus names */
+static const struct {
+    size_t offset;
+    const char *name;
+    const char *help;
+} ioFields[] = {
+    {offsetof(kvidxIoCounters, rowsTouched), "rows_touched",
+     "Entries read, written or removed"},
+    {offsetof(kvidxIoCounters, bytesRead), "read_bytes",
+     "Bytes read from storage"},
+    {offsetof(kvidxIoCounters, bytesWritten), "written_bytes",
+     "Bytes written to storage"},
+    {offsetof(kvidxIoCounters, stmtsPrepared), "statements_prepared",
+     "SQL statements compiled"},
+    {offsetof(kvidxIoCounters, fsyncs), "fsyncs", "Durability syncs issued"},
+    {offsetof(kvidxIoCounters, pagesAllocated), "pages_allocated",
+     "Pages added to the end of the file"},
+    {offsetof(kvidxIoCounters, pagesFreed), "pages_freed",
+     "Pages given back to the file system"},
+    {offsetof(kvidxIoCounters, transactions), "transactions",
+     "Transactions committed or rolled back"},
+};
+
+#define IO_FIELDS (sizeof(ioFields) / sizeof(*ioFields))
+
+/* Shards are read while their owners write them, so load atomically */
+static uint64_t ioValue(const kvidxIoCounters *io, size_t field) {
+    return __atomic_load_n(
+        (const uint64_t *)((const char *)io + ioFields[field].offset),
+        __ATOMIC_RELAXED);
+}
+
+#ifdef KVIDXKIT_HAS_METRICS
+static uint64_t *ioField(kvidxIoCounters *io, size_t field) {
+    return (uint64_t *)((char *)io + ioFields[field].offset);
+}
+#endif
+
+/* Prometheus bucket bounds: 1-2.5-5 steps from 25 ns to 10 s */
+static const struct {
+    uint64_t nanos;
+    const char *le;
+} promBounds[] = {
+    {25, "2.5e-08"},        {50, "5e-08"},          {100, "1e-07"},
+    {250, "2.5e-07"},       {500, "5e-07"},         {1000, "1e-06"},
+    {2500, "2.5e-06"},      {5000, "5e-06"},        {10000, "1e-05"},
+    {25000, "2.5e-05"},     {50000, "5e-05"},       {100000, "0.0001"},
+    {250000, "0.00025"},    {500000, "0.0005"},     {1000000, "0.001"},
+    {2500000, "0.0025"},    {5000000, "0.005"},     {10000000, "0.01"},
+    {25000000, "0.025"},    {50000000, "0.05"},     {100000000, "0.1"},
+    {250000000, "0.25"},    {500000000, "0.5"},     {1000000000, "1"},
+    {2500000000ULL, "2.5"}, {5000000000ULL, "5"},   {10000000000ULL, "10"},
+};
+
+const char *kvidxOpName(kvidxOp op) {
+    if ((unsigned)op >= KVIDX_OP_COUNT) {
+        return "unknown";
+    }
+    return opNames[op];
+}
+
+/* Smallest value bucket holds */
+static uint64_t bucketLow(size_t bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    const unsigned exp = (unsigned)(bucket / 8) + 2;
+    return (uint64_t)(8 + bucket % 8) << (exp - 3);
+}
+
+static uint64_t bucketHigh(size_t bucket) {
+    if (bucket < 8) {
+        return bucket;
+    }
+    const unsigned exp = (unsigned)(bucket / 8) + 2;
+    return bucketLow(bucket) + ((uint64_t)1 << (exp - 3)) - 1;
+}
+
+uint64_t kvidxMetricsBucketNanos(size_t bucket) {
+    if (bucket >= KVIDX_METRICS_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    return bucketHigh(bucket);
+}
+
+uint64_t kvidxMetricsPercentile(const kvidxOpMetrics *op, double percentile) {
+    if (!op || !op->count) {
+        return 0;
+    }
+    if (percentile < 0) {
+        percentile = 0;
+    } else if (percentile > 100) {
+        percentile = 100;
+    }
+
+    uint64_t target = (uint64_t)((double)op->count * percentile / 100.0);
+    if (target < (double)op->count * percentile / 100.0) {
+        target++;
+    }
+    if (!target) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < KVIDX_METRICS_BUCKETS; b++) {
+        seen += op->buckets[b];
+        if (seen >= target) {
+            return kvidxMetricsBucketNanos(b);
+        }
+    }
+    return kvidxMetricsBucketNanos(KVIDX_METRICS_BUCKETS - 1);
+}
+
+/* ====================================================================
+ * Slow Op Log
+ * ==================================================================== */
+
+#ifdef KVIDXKIT_HAS_METRICS
+#define TRACE_WORDS ((sizeof(kvidxTraceRecord) + 7) / 8)
+
+/* A record of the ring. While the record at position pos is written, seq
+ * is 2 * pos + 1, and 2 * pos + 2 once it is complete. */
+typedef struct traceSlot {
+    uint64_t seq;
+    uint64_t words[TRACE_WORDS];
+} traceSlot;
+
+struct kvidxTraceLog {
+    uint64_t head; /* Positions handed out so far, atomic */
+    uint64_t mask; /* Slots - 1 */
+    traceSlot slots[];
+};
+
+static struct kvidxTraceLog *traceLogNew(uint32_t size) {
+    uint64_t slots = TRACE_LOG_DEFAULT;
+    if (size) {
+        slots = 1;
+        while (slots < size && slots < TRACE_LOG_MAX) {
+            slots <<= 1;
+        }
+    }
+
+    struct kvidxTraceLog *log =
+        calloc(1, sizeof(*log) + slots * sizeof(traceSlot));
+    if (log) {
+        log->mask = slots - 1;
+    }
+    return log;
+}
+
+static void traceLogPush(struct kvidxTraceLog *log,
+                         const kvidxTraceRecord *record) {
+    uint64_t words[TRACE_WORDS] = {0};
+    memcpy(words, record, sizeof(*record));
+
+    const uint64_t pos = __atomic_fetch_add(&log->head, 1, __ATOMIC_RELAXED);
+    traceSlot *slot = &log->slots[pos & log->mask];
+
+    /* Skip the slot if a writer lapped by the whole ring is still in it or
+     * a newer one got there first; the record would be overwritten soon */
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) || seq > 2 * pos ||
+        !__atomic_compare_exchange_n(&slot->seq, &seq, 2 * pos + 1, false,
+                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t w = 0; w < TRACE_WORDS; w++) {
+        __atomic_store_n(&slot->words[w], words[w], __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&slot->seq, 2 * pos + 2, __ATOMIC_RELEASE);
+}
+
+/* Copy out the newest max complete records, oldest first */
+static size_t traceLogRead(struct kvidxTraceLog *log, kvidxTraceRecord *ops,
+                           size_t max) {
+    const uint64_t head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+    uint64_t pos = head > log->mask + 1 ? head - (log->mask + 1) : 0;
+    if (head - pos > max) {
+        pos = head - max;
+    }
+
+    size_t n = 0;
+    for (; pos < head; pos++) {
+        const traceSlot *slot = &log->slots[pos & log->mask];
+        const uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != 2 * pos + 2) {
+            continue; /* Being written, skipped or already overwritten */
+        }
+
+        uint64_t words[TRACE_WORDS];
+        for (size_t w = 0; w < TRACE_WORDS; w++) {
+            words[w] = __atomic_load_n(&slot->words[w], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+        memcpy(&ops[n++], words, sizeof(*ops));
+    }
+    return n;
+}
+#endif
+
+/* ====================================================================
+ * Recording
+ * ==================================================================== */
+
+#ifdef KVIDXKIT_HAS_METRICS
+__thread uint64_t kvidxMetricsThreadToken;
+
+uint64_t kvidxMetricsAssignToken(void) {
+    static uint64_t nextToken;
+    kvidxMetricsThreadToken =
+        __atomic_add_fetch(&nextToken, 1, __ATOMIC_RELAXED);
+    return kvidxMetricsThreadToken;
+}
+
+uint64_t kvidxMetricsClockNanos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+void kvidxMetricsIoSnapshot(kvidxInstance *i, kvidxIoCounters *io) {
+    memset(io, 0, sizeof(*io));
+    if (i->interface.ioCounters) {
+        i->interface.ioCounters(i, io);
+    }
+    io->rowsTouched = __atomic_load_n(&i->metrics->rowsTouched,
+                                      __ATOMIC_RELAXED);
+    io->pagesFreed += i->pagesReclaimed;
+}
+
+void kvidxMetricsRecordIo(kvidxInstance *i, kvidxOp op,
+                          const kvidxMetricsSpan *span, uint64_t rows,
+                          kvidxMetricsShard *s, bool owned) {
+    if (rows) {
+        __atomic_fetch_add(&i->metrics->rowsTouched, rows, __ATOMIC_RELAXED);
+    }
+
+    kvidxIoCounters after;
+    kvidxMetricsIoSnapshot(i, &after);
+    for (size_t f = 0; f < IO_FIELDS; f++) {
+        const uint64_t now = ioValue(&after, f);
+        const uint64_t then = ioValue(&span->before, f);
+        /* Totals only grow, unless a reopen reset the adapter's */
+        if (now > then) {
+            kvidxMetricsAdd(ioField(&s->io[op], f), now - then, owned);
+        }
+    }
+}
+
+/* Registry name of the instance's adapter, matched by its open function */
+static const char *adapterName(const kvidxInstance *i) {
+    for (size_t a = 0; a < kvidxGetAdapterCount(); a++) {
+        const kvidxAdapterInfo *info = kvidxGetAdapterByIndex(a);
+        if (info->iface->open == i->interface.open) {
+            return info->name;
+        }
+    }
+    return "custom";
+}
+#endif
+
+kvidxError kvidxMetricsEnable(kvidxInstance *i) {
+#ifdef KVIDXKIT_HAS_METRICS
+    const kvidxConfig *c = &i->config;
+    if (!i->metrics &&
+        (c->metrics || c->traceSampleEvery || c->traceSlowNanos)) {
+        struct kvidxMetricsState *m = calloc(1, sizeof(*m));
+        if (!m) {
+            kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                          "Failed to allocate latency histograms");
+            return KVIDX_ERROR_NOMEM;
+        }
+        m->startNanos = kvidxMetricsClockNanos();
+        m->startTicks = kvidxMetricsTicks();
+        m->adapter = adapterName(i);
+        i->metrics = m;
+    }
+
+    /* Tracing threads may be looking for the log already */
+    if (c->traceSlowNanos && !i->metrics->slowLog) {
+        struct kvidxTraceLog *log = traceLogNew(c->traceSlowLogSize);
+        if (!log) {
+            kvidxSetError(i, KVIDX_ERROR_NOMEM,
+                          "Failed to allocate slow op log");
+            return KVIDX_ERROR_NOMEM;
+        }
+        __atomic_store_n(&i->metrics->slowLog, log, __ATOMIC_RELEASE);
+    }
+#else
+    (void)i;
+#endif
+    return KVIDX_OK;
+}
+
+void kvidxMetricsFree(kvidxInstance *i) {
+    if (i->metrics) {
+        free(i->metrics->slowLog);
+    }
+    free(i->metrics);
+    i->metrics = NULL;
+}
+
+/* ====================================================================
+ * Reading
+ * ==================================================================== */
+
+#ifdef KVIDXKIT_HAS_METRICS
+/* Nanoseconds per counter tick between enabling and the given readings */
+static double measuredNanosPerTick(const struct kvidxMetricsState *m,
+                                   uint64_t nanos, uint64_t ticks) {
+    if (ticks <= m->startTicks) {
+        return 1.0;
+    }
+    return (double)(nanos - m->startNanos) / (double)(ticks - m->startTicks);
+}
+
+/* Nanoseconds per counter tick, measured since metrics were enabled */
+static double nanosPerTick(const struct kvidxMetricsState *m) {
+    if (METRICS_TICKS_ARE_NANOS) {
+        return 1.0;
+    }
+
+    uint64_t nanos = kvidxMetricsClockNanos();
+    if (nanos - m->startNanos < METRICS_CALIBRATE_NANOS) {
+        const uint64_t wait =
+            METRICS_CALIBRATE_NANOS - (nanos - m->startNanos);
+        struct timespec ts = {.tv_sec = 0, .tv_nsec = (long)wait};
+        while (nanosleep(&ts, &ts) != 0) {
+        }
+        nanos = kvidxMetricsClockNanos();
+    }
+    return measuredNanosPerTick(m, nanos, kvidxMetricsTicks());
+}
+#endif
+
+kvidxError kvidxGetMetrics(kvidxInstance *i, kvidxMetrics *metrics) {
+    if (!i || !metrics) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    memset(metrics, 0, sizeof(*metrics));
+
+#ifdef KVIDXKIT_HAS_METRICS
+    const struct kvidxMetricsState *m = i->metrics;
+    if (!m) {
+        return KVIDX_OK;
+    }
+
+    const double scale = nanosPerTick(m);
+    for (size_t op = 0; op < KVIDX_OP_COUNT; op++) {
+        kvidxOpMetrics *out = &metrics->ops[op];
+        uint64_t sumTicks = 0;
+        for (size_t b = 0; b < KVIDX_METRICS_BUCKETS; b++) {
+            uint64_t count = 0;
+            for (size_t s = 0; s <= KVIDX_METRICS_SHARDS; s++) {
+                count += __atomic_load_n(&m->shards[s].buckets[op][b],
+                                         __ATOMIC_RELAXED);
+            }
+            if (!count) {
+                continue;
+            }
+
+            const uint64_t mid =
+                bucketLow(b) + (bucketHigh(b) - bucketLow(b)) / 2;
+            const uint64_t nanos = (uint64_t)((double)mid * scale + 0.5);
+            out->buckets[kvidxMetricsBucket(nanos)] += count;
+            out->count += count;
+        }
+        for (size_t s = 0; s <= KVIDX_METRICS_SHARDS; s++) {
+            sumTicks +=
+                __atomic_load_n(&m->shards[s].sumTicks[op], __ATOMIC_RELAXED);
+        }
+        out->sumNanos = (uint64_t)((double)sumTicks * scale + 0.5);
+
+        for (size_t s = 0; s <= KVIDX_METRICS_SHARDS; s++) {
+            for (size_t f = 0; f < IO_FIELDS; f++) {
+                *ioField(&out->io, f) += ioValue(&m->shards[s].io[op], f);
+            }
+        }
+    }
+    return KVIDX_OK;
+#else
+    kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                  "Built without metrics (KVIDXKIT_ENABLE_METRICS)");
+    return KVIDX_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+/* ====================================================================
+ * Prometheus Text Format
+ * ==================================================================== */
+
+typedef struct promText {
+    char *buf;
+    size_t size;
+    size_t len; /* Full length, even past size */
+} promText;
+
+static void promPrintf(promText *t, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    const size_t room = t->len < t->size ? t->size - t->len : 0;
+    const int n = vsnprintf(room ? t->buf + t->len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) {
+        t->len += (size_t)n;
+    }
+}
+
+size_t kvidxMetricsFormatPrometheus(const kvidxMetrics *metrics, char *buf,
+                                    size_t bufLen) {
+    promText t = {.buf = buf, .size = buf ? bufLen : 0, .len = 0};
+    if (t.size) {
+        buf[0] = '\0';
+    }
+    if (!metrics) {
+        return 0;
+    }
+
+    promPrintf(&t, "# HELP kvidx_op_duration_seconds Time spent in kvidxkit "
+                   "operations.\n"
+                   "# TYPE kvidx_op_duration_seconds histogram\n");
+
+    for (size_t op = 0; op < KVIDX_OP_COUNT; op++) {
+        const kvidxOpMetrics *m = &metrics->ops[op];
+        if (!m->count) {
+            continue;
+        }
+
+        const char *name = opNames[op];
+        size_t b = 0;
+        uint64_t cumulative = 0;
+        for (size_t n = 0; n < sizeof(promBounds) / sizeof(*promBounds);
+             n++) {
+            while (b < KVIDX_METRICS_BUCKETS &&
+                   kvidxMetricsBucketNanos(b) <= promBounds[n].nanos) {
+                cumulative += m->buckets[b++];
+            }
+            promPrintf(&t,
+                       "kvidx_op_duration_seconds_bucket{op=\"%s\","
+                       "le=\"%s\"} %" PRIu64 "\n",
+                       name, promBounds[n].le, cumulative);
+        }
+        promPrintf(&t,
+                   "kvidx_op_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} "
+                   "%" PRIu64 "\n"
+                   "kvidx_op_duration_seconds_sum{op=\"%s\"} %" PRIu64
+                   ".%09" PRIu64 "\n"
+                   "kvidx_op_duration_seconds_count{op=\"%s\"} %" PRIu64 "\n",
+                   name, m->count, name, m->sumNanos / 1000000000,
+                   m->sumNanos % 1000000000, name, m->count);
+    }
+
+    for (size_t f = 0; f < IO_FIELDS; f++) {
+        bool described = false;
+        for (size_t op = 0; op < KVIDX_OP_COUNT; op++) {
+            const uint64_t value = ioValue(&metrics->ops[op].io, f);
+            if (!value) {
+                continue;
+            }
+            if (!described) {
+                promPrintf(&t,
+                           "# HELP kvidx_op_%s_total %s by kvidxkit "
+                           "operations.\n"
+                           "# TYPE kvidx_op_%s_total counter\n",
+                           ioFields[f].name, ioFields[f].help,
+                           ioFields[f].name);
+                described = true;
+            }
+            promPrintf(&t, "kvidx_op_%s_total{op=\"%s\"} %" PRIu64 "\n",
+                       ioFields[f].name, opNames[op], value);
+        }
+    }
+    return t.len;
+}
+
+/* ====================================================================
+ * Tracing
+ * ==================================================================== */
+
+#ifdef KVIDXKIT_HAS_METRICS
+/* Calls left until the calling thread's next sampled one */
+static __thread uint32_t traceCountdown;
+
+/* Like nanosPerTick(), but never sleeps: until the rate can be measured
+ * over METRICS_CALIBRATE_NANOS it is measured over the time so far */
+static double traceNanosPerTick(struct kvidxMetricsState *m) {
+    if (METRICS_TICKS_ARE_NANOS) {
+        return 1.0;
+    }
+
+    uint64_t bits = __atomic_load_n(&m->traceScale, __ATOMIC_RELAXED);
+    double scale;
+    if (bits) {
+        memcpy(&scale, &bits, sizeof(scale));
+        return scale;
+    }
+
+    const uint64_t nanos = kvidxMetricsClockNanos();
+    scale = measuredNanosPerTick(m, nanos, kvidxMetricsTicks());
+    if (nanos - m->startNanos >= METRICS_CALIBRATE_NANOS) {
+        memcpy(&bits, &scale, sizeof(bits));
+        __atomic_store_n(&m->traceScale, bits, __ATOMIC_RELAXED);
+    }
+    return scale;
+}
+
+void kvidxTraceConsider(kvidxInstance *i, const kvidxMetricsSpan *span,
+                        uint64_t ticks, uint64_t rows, uint64_t bytesOut) {
+    const kvidxConfig *c = &i->config;
+    bool sampled = false;
+    if (c->traceSampleEvery) {
+        if (!traceCountdown || traceCountdown > c->traceSampleEvery) {
+            traceCountdown = c->traceSampleEvery;
+        }
+        sampled = --traceCountdown == 0;
+    }
+
+    struct kvidxMetricsState *m = i->metrics;
+    const uint64_t nanos =
+        (uint64_t)((double)ticks * traceNanosPerTick(m) + 0.5);
+    const bool slow = c->traceSlowNanos && nanos >= c->traceSlowNanos;
+    if (!sampled && !slow) {
+        return;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const kvidxTraceRecord record = {
+        .op = span->op,
+        .adapter = m->adapter,
+        .hasKey = span->hasKey,
+        .inTransaction = span->inTransaction,
+        .slow = slow,
+        .sampled = sampled,
+        .key = span->key,
+        .endKey = span->endKey,
+        .bytesIn = span->bytesIn,
+        .bytesOut = bytesOut,
+        .rows = rows,
+        .durationNanos = nanos,
+        .unixNanos = (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec,
+    };
+
+    if (slow) {
+        struct kvidxTraceLog *log =
+            __atomic_load_n(&m->slowLog, __ATOMIC_ACQUIRE);
+        if (log) {
+            traceLogPush(log, &record);
+        }
+    }
+    if (c->traceCallback) {
+        c->traceCallback(&record, c->traceUserData);
+    }
+}
+#endif
+
+kvidxError kvidxGetSlowOps(kvidxInstance *i, kvidxTraceRecord *ops,
+                           size_t max, size_t *count) {
+    if (!i || (!ops && max) || !count) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    *count = 0;
+
+#ifdef KVIDXKIT_HAS_METRICS
+    struct kvidxTraceLog *log =
+        i->metrics ? __atomic_load_n(&i->metrics->slowLog, __ATOMIC_ACQUIRE)
+                   : NULL;
+    if (log && max) {
+        *count = traceLogRead(log, ops, max);
+    }
+    return KVIDX_OK;
+#else
+    kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                  "Built without metrics (KVIDXKIT_ENABLE_METRICS)");
+    return KVIDX_ERROR_NOT_SUPPORTED;
+#endif
+}
+
+size_t kvidxTraceFormat(const kvidxTraceRecord *record, char *buf,
+                        size_t bufLen) {
+    promText t = {.buf = buf, .size = buf ? bufLen : 0, .len = 0};
+    if (t.size) {
+        buf[0] = '\0';
+    }
+    if (!record) {
+        return 0;
+    }
+
+    promPrintf(&t, "op=%s adapter=%s", kvidxOpName(record->op),
+               record->adapter ? record->adapter : "custom");
+    if (record->hasKey) {
+        promPrintf(&t, " key=%" PRIu64 " endKey=%" PRIu64, record->key,
+                   record->endKey);
+    }
+    promPrintf(&t,
+               " rows=%" PRIu64 " bytesIn=%" PRIu64 " bytesOut=%" PRIu64
+               " txn=%s nanos=%" PRIu64 " slow=%s sampled=%s"
+               " unixNanos=%" PRIu64,
+               record->rows, record->bytesIn, record->bytesOut,
+               record->inTransaction ? "true" : "false",
+               record->durationNanos, record->slow ? "true" : "false",
+               record->sampled ? "true" : "false", record->unixNanos);
+    return t.len;
+}
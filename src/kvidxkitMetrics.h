@@ -0,0 +1,252 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "kvidxkitErrors.h"
+
+__BEGIN_DECLS
+
+/* Forward declaration */
+struct kvidxInstance;
+
+/**
+ * Operations timed by the metrics layer
+ *
+ * Variants share their base operation: kvidxInsertNX() and kvidxInsertXX()
+ * count as KVIDX_OP_INSERT_EX, kvidxSetExpireAt() as KVIDX_OP_SET_EXPIRE
+ * and kvidxCompareTermAndSwap() as KVIDX_OP_COMPARE_AND_SWAP.
+ * kvidxExportToFd() and kvidxImportFromFd() count as KVIDX_OP_EXPORT_STREAM
+ * and KVIDX_OP_IMPORT_STREAM. New operations are added at the end, so the
+ * values seen by USDT probes stay stable.
+ */
+typedef enum {
+    KVIDX_OP_BEGIN,
+    KVIDX_OP_COMMIT,
+    KVIDX_OP_ABORT,
+    KVIDX_OP_FSYNC,
+    KVIDX_OP_GET,
+    KVIDX_OP_GET_PREV,
+    KVIDX_OP_GET_NEXT,
+    KVIDX_OP_EXISTS,
+    KVIDX_OP_EXISTS_DUAL,
+    KVIDX_OP_MAX_KEY,
+    KVIDX_OP_INSERT,
+    KVIDX_OP_INSERT_EX,
+    KVIDX_OP_INSERT_BATCH,
+    KVIDX_OP_REMOVE,
+    KVIDX_OP_REMOVE_AFTER,
+    KVIDX_OP_REMOVE_BEFORE,
+    KVIDX_OP_REMOVE_RANGE,
+    KVIDX_OP_COUNT_RANGE,
+    KVIDX_OP_EXISTS_IN_RANGE,
+    KVIDX_OP_SCAN_RANGE,
+    KVIDX_OP_GET_AND_SET,
+    KVIDX_OP_GET_AND_REMOVE,
+    KVIDX_OP_COMPARE_AND_SWAP,
+    KVIDX_OP_APPEND,
+    KVIDX_OP_PREPEND,
+    KVIDX_OP_GET_VALUE_RANGE,
+    KVIDX_OP_SET_VALUE_RANGE,
+    KVIDX_OP_SET_EXPIRE,
+    KVIDX_OP_GET_TTL,
+    KVIDX_OP_PERSIST,
+    KVIDX_OP_EXPIRE_SCAN,
+    KVIDX_OP_EXPORT,
+    KVIDX_OP_IMPORT,
+    KVIDX_OP_GET_STATS,
+    KVIDX_OP_RECLAIM_SPACE,
+    KVIDX_OP_EXPORT_STREAM,
+    KVIDX_OP_IMPORT_STREAM,
+    KVIDX_OP_EXPORT_INCREMENTAL,
+    KVIDX_OP_COPY_STORAGE,
+    KVIDX_OP_RECEIVE_STORAGE,
+    KVIDX_OP_REPLACE_ALL,
+    KVIDX_OP_APPLY_TO_STATE_MACHINE,
+    KVIDX_OP_REPLAY_STATE_MACHINE,
+    KVIDX_OP_VERIFY,
+    KVIDX_OP_REMOVE_RANGE_INCREMENTAL,
+    KVIDX_OP_COUNT /* Number of operations, not an operation */
+} kvidxOp;
+
+/**
+ * Latency buckets per operation
+ *
+ * Buckets are log-linear: 0-7 ns get one bucket each, and every power of
+ * two above that is split into 8 equal buckets, so a bucket is never wider
+ * than 12.5% of its values. The last bucket also holds everything above
+ * ~18 minutes.
+ */
+#define KVIDX_METRICS_BUCKETS 304
+
+/**
+ * Work done by operations, as far as the adapter can see it
+ *
+ * Recorded per operation while kvidxConfig.metricsIo is set. Counters an
+ * adapter cannot observe stay 0 (see the table in API_REFERENCE.md):
+ * rowsTouched and pagesFreed are counted for every adapter, the rest come
+ * from the adapter's storage engine. Work done inside an operation by
+ * nested public calls (kvidxInsertBatch() inserting each entry) counts
+ * for both.
+ */
+typedef struct kvidxIoCounters {
+    uint64_t rowsTouched;    /* Entries read, written or removed */
+    uint64_t bytesRead;      /* Bytes read from storage into the cache */
+    uint64_t bytesWritten;   /* Bytes written to storage or its log */
+    uint64_t stmtsPrepared;  /* SQL statements compiled */
+    uint64_t fsyncs;         /* Durability syncs issued */
+    uint64_t pagesAllocated; /* Pages added to the end of the file */
+    uint64_t pagesFreed;     /* Pages given back to the file system */
+    uint64_t transactions;   /* Transactions committed or rolled back */
+} kvidxIoCounters;
+
+/**
+ * Latency histogram and work counters of one operation
+ */
+typedef struct kvidxOpMetrics {
+    uint64_t count;    /* Calls recorded */
+    uint64_t sumNanos; /* Total time spent in them */
+    uint64_t buckets[KVIDX_METRICS_BUCKETS]; /* Calls per latency bucket */
+    kvidxIoCounters io; /* Work done by them (needs metricsIo) */
+} kvidxOpMetrics;
+
+/**
+ * Metrics of every operation (indexed by kvidxOp)
+ *
+ * About 110 KB, so allocate it rather than putting it on a small stack.
+ */
+typedef struct kvidxMetrics {
+    kvidxOpMetrics ops[KVIDX_OP_COUNT];
+} kvidxMetrics;
+
+/**
+ * Snapshot the latency histograms and work counters of an instance
+ *
+ * Recording is off until kvidxConfig.metrics is set, and needs a build
+ * with KVIDXKIT_ENABLE_METRICS. Each public call listed in kvidxOp is then
+ * timed around its adapter call, so validation and change feed work in
+ * the wrapper are not included. With kvidxConfig.metricsIo also set, the
+ * adapter's work counters are read before and after the same call and the
+ * difference is added to the operation's io counters.
+ *
+ * Calls made from several threads (such as readers sharing an instance)
+ * land in separate buckets that are merged here, so a snapshot taken while
+ * calls are running may miss the newest.
+ *
+ * @param i Instance handle
+ * @param metrics Receives the metrics (all zero if never enabled)
+ * @return KVIDX_OK on success, KVIDX_ERROR_NOT_SUPPORTED if built without
+ *         metrics
+ *
+ * @note The first call within 1 ms of enabling metrics sleeps out the rest
+ *       of that millisecond to calibrate the cycle counter
+ */
+kvidxError kvidxGetMetrics(struct kvidxInstance *i, kvidxMetrics *metrics);
+
+/**
+ * Short lowercase name of an operation ("get", "remove_range", ...)
+ *
+ * @param op Operation
+ * @return Static string ("unknown" if op is out of range)
+ */
+const char *kvidxOpName(kvidxOp op);
+
+/**
+ * Largest latency a bucket holds
+ *
+ * @param bucket Bucket index (below KVIDX_METRICS_BUCKETS)
+ * @return Inclusive upper bound in nanoseconds (UINT64_MAX for the last
+ *         bucket)
+ */
+uint64_t kvidxMetricsBucketNanos(size_t bucket);
+
+/**
+ * Latency at a percentile of an operation's histogram
+ *
+ * @param op Histogram from kvidxGetMetrics()
+ * @param percentile 0 to 100 (e.g. 99.9)
+ * @return Upper bound of the bucket holding that percentile, in
+ *         nanoseconds (0 if nothing was recorded)
+ */
+uint64_t kvidxMetricsPercentile(const kvidxOpMetrics *op, double percentile);
+
+/**
+ * Format metrics in the Prometheus text exposition format
+ *
+ * Writes one kvidx_op_duration_seconds histogram with an op label for
+ * every operation that was called at least once. Bucket bounds run from
+ * 25 ns to 10 s in 1-2.5-5 steps. Work counters follow as
+ * kvidx_op_<counter>_total counters (kvidx_op_read_bytes_total, ...),
+ * listing only operations whose counter is not zero.
+ *
+ * @param metrics Metrics from kvidxGetMetrics()
+ * @param buf Receives the text, NUL terminated (may be NULL if bufLen is 0)
+ * @param bufLen Size of buf
+ * @return Length of the full text excluding the NUL, like snprintf(); if
+ *         it is bufLen or more the text was truncated
+ */
+size_t kvidxMetricsFormatPrometheus(const kvidxMetrics *metrics, char *buf,
+                                    size_t bufLen);
+
+/**
+ * A traced operation
+ *
+ * Handed to kvidxConfig.traceCallback and kept in the slow op log. Keys
+ * are the ones passed in: the key of a point operation (key == endKey),
+ * the bounds of a range, the first and last entry of a batch. Operations
+ * on no key (begin, commit, max_key, ...) have hasKey false.
+ */
+typedef struct kvidxTraceRecord {
+    kvidxOp op;
+    const char *adapter;    /* Registry name ("SQLite3", ...) or "custom" */
+    bool hasKey;            /* key and endKey are set */
+    bool inTransaction;     /* Called between kvidxBegin() and commit/abort */
+    bool slow;              /* Took at least traceSlowNanos */
+    bool sampled;           /* Picked by traceSampleEvery */
+    uint64_t key;           /* First key touched */
+    uint64_t endKey;        /* Last key touched (inclusive) */
+    uint64_t bytesIn;       /* Value bytes passed in */
+    uint64_t bytesOut;      /* Value bytes handed back */
+    uint64_t rows;          /* Entries read, written or removed */
+    uint64_t durationNanos; /* Time spent in the adapter */
+    uint64_t unixNanos;     /* Wall clock when it returned */
+} kvidxTraceRecord;
+
+/**
+ * Copy the slow op log of an instance
+ *
+ * While kvidxConfig.traceSlowNanos is set, every operation taking at least
+ * that long is kept in a per-instance ring of the last traceSlowLogSize
+ * slow operations. Recording takes no lock, so this can be called from any
+ * thread while operations are running; an entry being overwritten as it is
+ * read is left out rather than returned torn. The log outlives turning
+ * traceSlowNanos off, until the instance is closed.
+ *
+ * @param i Instance handle
+ * @param ops Receives up to max operations, oldest first
+ * @param max Size of ops (the newest max operations are returned)
+ * @param count Receives the number of operations written to ops
+ * @return KVIDX_OK on success (count 0 if there is no log),
+ *         KVIDX_ERROR_NOT_SUPPORTED if built without metrics
+ */
+kvidxError kvidxGetSlowOps(struct kvidxInstance *i, kvidxTraceRecord *ops,
+                           size_t max, size_t *count);
+
+/**
+ * Format a traced operation as one logfmt line
+ *
+ * For example "op=remove_range adapter=SQLite3 key=1 endKey=500000
+ * rows=500000 bytesIn=0 bytesOut=0 txn=false nanos=1834211 slow=true
+ * sampled=false unixNanos=...", without a trailing newline. key and
+ * endKey are left out for operations on no key.
+ *
+ * @param record Operation to format
+ * @param buf Receives the text, NUL terminated (may be NULL if bufLen is 0)
+ * @param bufLen Size of buf
+ * @return Length of the full text excluding the NUL, like snprintf()
+ */
+size_t kvidxTraceFormat(const kvidxTraceRecord *record, char *buf,
+                        size_t bufLen);
+
+__END_DECLS
@@ -0,0 +1,39 @@
+#pragma once
+
+/* ====================================================================
+ * USDT Probes
+ * ==================================================================== */
+
+/**
+ * Static tracepoints of provider "kvidxkit" for bpftrace, perf and
+ * SystemTap, e.g.
+ *
+ *     bpftrace -e 'usdt:./libkvidxkit.so:kvidxkit:op__done { ... }'
+ *
+ * Built with KVIDXKIT_HAS_USDT (CMake option KVIDXKIT_ENABLE_USDT, on
+ * when <sys/sdt.h> is found), each probe is a single nop until a tracer
+ * attaches, plus whatever it takes to have its arguments at hand, so keep
+ * arguments cheap and free of side effects. Without it they compile to
+ * nothing and their arguments are not evaluated.
+ *
+ * Probe names use "__" for "-" (op__start is listed as op-start). The
+ * probes and their arguments are listed in docs/ARCHITECTURE.md.
+ */
+#ifdef KVIDXKIT_HAS_USDT
+#include <sys/sdt.h>
+
+#define KVIDX_PROBE(name) DTRACE_PROBE(kvidxkit, name)
+#define KVIDX_PROBE1(name, a) DTRACE_PROBE1(kvidxkit, name, a)
+#define KVIDX_PROBE2(name, a, b) DTRACE_PROBE2(kvidxkit, name, a, b)
+#define KVIDX_PROBE3(name, a, b, c) DTRACE_PROBE3(kvidxkit, name, a, b, c)
+#define KVIDX_PROBE4(name, a, b, c, d)                                         \
+    DTRACE_PROBE4(kvidxkit, name, a, b, c, d)
+#else
+#define KVIDX_PROBE(name)                                                      \
+    do {                                                                       \
+    } while (0)
+#define KVIDX_PROBE1(name, a) KVIDX_PROBE(name)
+#define KVIDX_PROBE2(name, a, b) KVIDX_PROBE(name)
+#define KVIDX_PROBE3(name, a, b, c) KVIDX_PROBE(name)
+#define KVIDX_PROBE4(name, a, b, c, d) KVIDX_PROBE(name)
+#endif
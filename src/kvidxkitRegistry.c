@@ -34,6 +34,24 @@ static const kvidxAdapterInfo g_adapters[] = {
      .pathSuffix = "",
      .isDirectory = true},
 #endif
+#ifdef KVIDXKIT_HAS_SEGLOG
+    {.name = "Seglog",
+     .iface = &kvidxInterfaceSeglog,
+     .pathSuffix = "",
+     .isDirectory = true},
+#endif
+#ifdef KVIDXKIT_HAS_MEMORY
+    {.name = "Memory",
+     .iface = &kvidxInterfaceMemory,
+     .pathSuffix = ".kvmem",
+     .isDirectory = false},
+#endif
+#ifdef KVIDXKIT_HAS_TIERED
+    {.name = "Tiered",
+     .iface = &kvidxInterfaceTiered,
+     .pathSuffix = "",
+     .isDirectory = true},
+#endif
 };
 
 #define ADAPTER_COUNT (sizeof(g_adapters) / sizeof(g_adapters[0]))
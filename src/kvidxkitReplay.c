@@ -0,0 +1,303 @@
+/**
+ * Pipelined state machine replay for kvidxkit
+ *
+ * kvidxReplayStateMachine() runs in two stages. A reader thread scans the
+ * log in key order with kvidxScanRange() (a cursor on adapters that have
+ * one) and copies entries into a small ring of batches. The calling thread
+ * hands each batch to kvidxInterfaceStateMachine.applyBatch, so reading
+ * the next batches overlaps with applying the current one.
+ *
+ * The reader uses its own handle when the adapter provides
+ * interface.openReader. Otherwise both stages share the instance and take
+ * turns under a lock, which still batches the apply calls but no longer
+ * overlaps them with reads.
+ */
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Batches the reader may run ahead of the apply stage */
+#define REPLAY_SLOTS 4
+
+/* A batch ends at this many entries or bytes of data, whichever is first */
+#define REPLAY_BATCH_ENTRIES 1024
+#define REPLAY_BATCH_BYTES (1024 * 1024)
+
+typedef struct replaySlot {
+    kvidxEntry entries[REPLAY_BATCH_ENTRIES];
+    size_t offsets[REPLAY_BATCH_ENTRIES]; /* Data offsets into bytes */
+    size_t count;
+    uint8_t *bytes;
+    size_t used;
+    size_t size;
+} replaySlot;
+
+typedef struct replayJob {
+    kvidxInstance *i;
+    kvidxInstance *source; /* &reader, or i when sharedReads */
+    kvidxInstance reader;
+    bool sharedReads;
+    pthread_mutex_t readLock; /* Taken around reads and applies if shared */
+
+    uint64_t nextKey;
+    uint64_t endKey;
+    bool slotFull; /* The scan stopped because the batch filled up */
+    kvidxError readResult;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    replaySlot *slots;
+    uint64_t filled;  /* Batches handed to the apply stage */
+    uint64_t drained; /* Batches the apply stage has finished with */
+    bool done;        /* Reader finished (see readResult) */
+    bool stop;        /* Apply stage gave up */
+} replayJob;
+
+static bool replayVisit(void *ctx, uint64_t key, uint64_t term, uint64_t cmd,
+                        const uint8_t *data, size_t len) {
+    replayJob *job = ctx;
+    replaySlot *slot = &job->slots[job->filled % REPLAY_SLOTS];
+
+    if (slot->count == REPLAY_BATCH_ENTRIES ||
+        (slot->count && slot->used + len > REPLAY_BATCH_BYTES)) {
+        job->slotFull = true;
+        return false;
+    }
+
+    if (slot->used + len > slot->size) {
+        size_t size = slot->size ? slot->size : 64 * 1024;
+        while (size < slot->used + len) {
+            size *= 2;
+        }
+        uint8_t *bytes = realloc(slot->bytes, size);
+        if (!bytes) {
+            job->readResult = KVIDX_ERROR_NOMEM;
+            return false;
+        }
+        slot->bytes = bytes;
+        slot->size = size;
+    }
+
+    kvidxEntry *e = &slot->entries[slot->count];
+    e->key = key;
+    e->term = term;
+    e->cmd = cmd;
+    e->dataLen = len;
+    slot->offsets[slot->count++] = slot->used;
+    if (len) {
+        memcpy(slot->bytes + slot->used, data, len);
+        slot->used += len;
+    }
+    return true;
+}
+
+/**
+ * Fill the next free slot from nextKey on. Returns false at the end of the
+ * range or on error.
+ */
+static bool replayReadBatch(replayJob *job) {
+    replaySlot *slot = &job->slots[job->filled % REPLAY_SLOTS];
+    slot->count = 0;
+    slot->used = 0;
+    job->slotFull = false;
+
+    if (job->sharedReads) {
+        pthread_mutex_lock(&job->readLock);
+    }
+    kvidxError result = kvidxScanRange(job->source, job->nextKey, job->endKey,
+                                       replayVisit, job);
+    if (job->sharedReads) {
+        pthread_mutex_unlock(&job->readLock);
+    }
+    if (job->readResult == KVIDX_OK) {
+        job->readResult = result;
+    }
+
+    /* The bytes buffer may have moved while filling */
+    for (size_t n = 0; n < slot->count; n++) {
+        slot->entries[n].data = slot->bytes + slot->offsets[n];
+    }
+
+    bool more = job->readResult == KVIDX_OK && job->slotFull;
+    if (slot->count) {
+        const uint64_t last = slot->entries[slot->count - 1].key;
+        more = more && last < job->endKey;
+        job->nextKey = last + 1;
+    }
+    return more;
+}
+
+static void *replayReaderMain(void *arg) {
+    replayJob *job = arg;
+
+    bool more = true;
+    while (more) {
+        pthread_mutex_lock(&job->lock);
+        while (!job->stop && job->filled - job->drained == REPLAY_SLOTS) {
+            pthread_cond_wait(&job->cond, &job->lock);
+        }
+        const bool stop = job->stop;
+        pthread_mutex_unlock(&job->lock);
+        if (stop) {
+            break;
+        }
+
+        more = replayReadBatch(job);
+
+        pthread_mutex_lock(&job->lock);
+        if (job->slots[job->filled % REPLAY_SLOTS].count) {
+            job->filled++;
+        }
+        pthread_cond_broadcast(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->done = true;
+    pthread_cond_broadcast(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/**
+ * Apply one batch; on failure *failedKey is the entry that was refused
+ * (for applyBatch, the first entry of the batch).
+ */
+static size_t replayApply(kvidxInstance *i, const replaySlot *slot,
+                          uint64_t *failedKey) {
+    if (i->state.applyBatch) {
+        if (i->state.applyBatch(i, slot->entries, slot->count)) {
+            return slot->count;
+        }
+        *failedKey = slot->entries[0].key;
+        return 0;
+    }
+
+    for (size_t n = 0; n < slot->count; n++) {
+        if (!i->state.applyToStateMachine(i, slot->entries[n].key)) {
+            *failedKey = slot->entries[n].key;
+            return n;
+        }
+    }
+    return slot->count;
+}
+
+static kvidxError replay(kvidxInstance *i, uint64_t startKey,
+                         uint64_t endKey, uint64_t *applied) {
+    replayJob job = {.i = i, .nextKey = startKey, .endKey = endKey};
+    job.slots = calloc(REPLAY_SLOTS, sizeof(*job.slots));
+    if (!job.slots) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate replay ring");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    /* Adapters refuse readers while i has a write transaction open */
+    job.sharedReads =
+        !i->interface.openReader || !i->interface.openReader(i, &job.reader);
+    job.source = job.sharedReads ? i : &job.reader;
+
+    pthread_mutex_init(&job.readLock, NULL);
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    kvidxError result = KVIDX_OK;
+    uint64_t total = 0;
+    uint64_t failedKey = 0;
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, replayReaderMain, &job) != 0) {
+        result = KVIDX_ERROR_INTERNAL;
+        kvidxSetError(i, result, "Failed to start replay reader");
+    }
+
+    while (result == KVIDX_OK) {
+        pthread_mutex_lock(&job.lock);
+        while (job.filled == job.drained && !job.done) {
+            pthread_cond_wait(&job.cond, &job.lock);
+        }
+        const bool empty = job.filled == job.drained;
+        pthread_mutex_unlock(&job.lock);
+        if (empty) {
+            break;
+        }
+
+        const replaySlot *slot = &job.slots[job.drained % REPLAY_SLOTS];
+        if (job.sharedReads) {
+            pthread_mutex_lock(&job.readLock);
+        }
+        const size_t n = replayApply(i, slot, &failedKey);
+        if (job.sharedReads) {
+            pthread_mutex_unlock(&job.readLock);
+        }
+        total += n;
+
+        pthread_mutex_lock(&job.lock);
+        job.drained++;
+        if (n < slot->count) {
+            job.stop = true;
+            result = KVIDX_ERROR_CANCELLED;
+        }
+        pthread_cond_broadcast(&job.cond);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    if (result != KVIDX_ERROR_INTERNAL) {
+        pthread_join(thread, NULL);
+    }
+
+    if (result == KVIDX_ERROR_CANCELLED) {
+        kvidxSetError(i, result,
+                      "State machine refused entry %" PRIu64
+                      " after %" PRIu64 " entries",
+                      failedKey, total);
+    } else if (result == KVIDX_OK && job.readResult != KVIDX_OK) {
+        result = job.readResult;
+        kvidxSetError(i, result, "Replay read failed after %" PRIu64
+                                 " entries",
+                      total);
+    }
+
+    if (!job.sharedReads) {
+        job.reader.interface.close(&job.reader);
+    }
+    for (size_t n = 0; n < REPLAY_SLOTS; n++) {
+        free(job.slots[n].bytes);
+    }
+    free(job.slots);
+    pthread_mutex_destroy(&job.readLock);
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.cond);
+
+    *applied = total;
+    return result;
+}
+
+kvidxError kvidxReplayStateMachine(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, uint64_t *applied) {
+    if (applied) {
+        *applied = 0;
+    }
+    if (!i || startKey > endKey) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+    if (!i->state.applyBatch && !i->state.applyToStateMachine) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "No state machine apply hook is set");
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    uint64_t total = 0;
+    const kvidxMetricsSpan span = kvidxMetricsStartKeys(
+        i, KVIDX_OP_REPLAY_STATE_MACHINE, startKey, endKey, 0);
+    const kvidxError result = replay(i, startKey, endKey, &total);
+    kvidxMetricsRecord(i, &span, total);
+
+    if (applied) {
+        *applied = total;
+    }
+    return result;
+}
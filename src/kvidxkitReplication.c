@@ -0,0 +1,910 @@
+/**
+ * Storage replication for kvidxkit
+ *
+ * kvidxCopyStorageForReplication() streams a consistent copy of an
+ * instance's storage to a callback, and
+ * kvidxReceiveStorageForReplication() installs such a stream in place of
+ * another instance's storage, e.g. to seed a new raft follower.
+ *
+ * SQLite, LMDB and RocksDB copy their native files (online backup API, env
+ * copy, checkpoint) through the copyStorageForReplication hooks, using the
+ * framing below. Other adapters send a binary export instead, which any
+ * adapter can receive.
+ *
+ * Stream layout:
+ *   header   magic, version, format name ("sqlite3", "lmdb", ...)
+ *   file     uint32 name length, name, then chunks of uint32 length +
+ *            bytes, ended by a zero length and the CRC32C of the file
+ *   ...
+ *   end      uint32 zero name length
+ * The "export" format is the header followed by a STREAM layout export.
+ */
+
+/* Required for mkdtemp and fsync under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Replication stream magic: "KVIDXREP" */
+#define REPLICATION_MAGIC 0x504552584449564BULL
+#define REPLICATION_VERSION 1
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    char format[16]; /* NUL-padded */
+} replicationHeader;
+
+/* Longest file name in a stream */
+#define REPLICATION_NAME_MAX 255
+
+/* ====================================================================
+ * Sending
+ * ==================================================================== */
+
+static void senderPut(kvidxReplicationSender *s, const void *buf,
+                      size_t len) {
+    if (!s->failed && !s->write(buf, len, s->streamData)) {
+        s->failed = true;
+    }
+}
+
+bool kvidxReplicationSendBegin(kvidxReplicationSender *s,
+                               kvidxStreamWriteCallback write,
+                               void *streamData, const char *format) {
+    memset(s, 0, sizeof(*s));
+    s->write = write;
+    s->streamData = streamData;
+
+    /* Chunk length prefix + payload */
+    s->buf = malloc(sizeof(uint32_t) + KVIDX_STREAM_BUFFER_BYTES);
+    if (!s->buf) {
+        s->failed = true;
+        return false;
+    }
+
+    replicationHeader header = {.magic = REPLICATION_MAGIC,
+                                .version = REPLICATION_VERSION};
+    strncpy(header.format, format, sizeof(header.format) - 1);
+    senderPut(s, &header, sizeof(header));
+    return !s->failed;
+}
+
+bool kvidxReplicationSendFd(kvidxReplicationSender *s, const char *name,
+                            int fd) {
+    const uint32_t nameLen = (uint32_t)strlen(name);
+    senderPut(s, &nameLen, sizeof(nameLen));
+    senderPut(s, name, nameLen);
+
+    uint32_t crc = 0;
+    uint8_t *chunk = s->buf + sizeof(uint32_t);
+    while (!s->failed) {
+        /* Fill whole chunks even from pipes, which return 64 KB at most */
+        size_t fill = 0;
+        while (fill < KVIDX_STREAM_BUFFER_BYTES) {
+            ssize_t n = read(fd, chunk + fill, KVIDX_STREAM_BUFFER_BYTES - fill);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                s->failed = true;
+            }
+            if (n <= 0) {
+                break;
+            }
+            fill += (size_t)n;
+        }
+        if (s->failed) {
+            break;
+        }
+
+        /* A zero length ends the file, followed by its checksum */
+        const uint32_t chunkLen = (uint32_t)fill;
+        memcpy(s->buf, &chunkLen, sizeof(chunkLen));
+        if (fill == 0) {
+            memcpy(chunk, &crc, sizeof(crc));
+            senderPut(s, s->buf, sizeof(chunkLen) + sizeof(crc));
+            break;
+        }
+
+        crc = kvidxCrc32c(crc, chunk, chunkLen);
+        senderPut(s, s->buf, sizeof(chunkLen) + chunkLen);
+    }
+    return !s->failed;
+}
+
+bool kvidxReplicationSendFile(kvidxReplicationSender *s, const char *name,
+                              const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        s->failed = true;
+        return false;
+    }
+    kvidxReplicationSendFd(s, name, fd);
+    close(fd);
+    return !s->failed;
+}
+
+bool kvidxReplicationSendDir(kvidxReplicationSender *s, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        s->failed = true;
+        return false;
+    }
+
+    const struct dirent *entry;
+    while (!s->failed && (entry = readdir(d))) {
+        char path[PATH_MAX];
+        struct stat st;
+        if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir,
+                             entry->d_name) >= sizeof(path) ||
+            stat(path, &st) != 0) {
+            s->failed = true;
+        } else if (S_ISREG(st.st_mode)) {
+            kvidxReplicationSendFile(s, entry->d_name, path);
+        }
+    }
+    closedir(d);
+    return !s->failed;
+}
+
+bool kvidxReplicationSendEnd(kvidxReplicationSender *s) {
+    const uint32_t end = 0;
+    senderPut(s, &end, sizeof(end));
+    free(s->buf);
+    s->buf = NULL;
+    return !s->failed;
+}
+
+/* ====================================================================
+ * Receiving
+ * ==================================================================== */
+
+static bool readAll(kvidxStreamReadCallback read, void *streamData,
+                    void *buf, size_t len) {
+    uint8_t *p = buf;
+    while (len) {
+        int64_t n = read(p, len, streamData);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/* A plain file name: no directories, no "." or ".." */
+static bool safeName(const char *name) {
+    return name[0] && strchr(name, '/') == NULL && strcmp(name, ".") != 0 &&
+           strcmp(name, "..") != 0;
+}
+
+/* Receive one file's chunks into dir/name */
+static kvidxError receiveFile(kvidxInstance *i, kvidxStreamReadCallback read,
+                              void *streamData, const char *dir,
+                              const char *name, uint8_t *buf) {
+    char path[PATH_MAX];
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir, name) >=
+        sizeof(path)) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT, "Path too long: %s/%s",
+                      dir, name);
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create %s: %s", path,
+                      strerror(errno));
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxError result = KVIDX_OK;
+    bool truncated = false;
+    uint32_t crc = 0;
+    for (;;) {
+        uint32_t chunkLen;
+        if (!readAll(read, streamData, &chunkLen, sizeof(chunkLen))) {
+            truncated = true;
+            break;
+        }
+
+        if (chunkLen == 0) {
+            uint32_t expected;
+            if (!readAll(read, streamData, &expected, sizeof(expected))) {
+                truncated = true;
+            } else if (expected != crc) {
+                kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                              "Checksum mismatch in received file %s", name);
+                result = KVIDX_ERROR_CORRUPT;
+            }
+            break;
+        }
+
+        if (chunkLen > KVIDX_STREAM_BUFFER_BYTES) {
+            kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                          "Oversized chunk in received file %s", name);
+            result = KVIDX_ERROR_CORRUPT;
+            break;
+        }
+        if (!readAll(read, streamData, buf, chunkLen)) {
+            truncated = true;
+            break;
+        }
+        crc = kvidxCrc32c(crc, buf, chunkLen);
+        if (!writeAll(fd, buf, chunkLen)) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Failed to write %s: %s", path,
+                          strerror(errno));
+            result = KVIDX_ERROR_IO;
+            break;
+        }
+    }
+
+    if (truncated) {
+        kvidxSetError(i, KVIDX_ERROR_IO,
+                      "Replication stream ended inside file %s", name);
+        result = KVIDX_ERROR_IO;
+    } else if (result == KVIDX_OK && fsync(fd) != 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to sync %s: %s", path,
+                      strerror(errno));
+        result = KVIDX_ERROR_IO;
+    }
+    close(fd);
+    return result;
+}
+
+kvidxError kvidxReplicationReceiveFiles(kvidxInstance *i,
+                                        kvidxStreamReadCallback read,
+                                        void *streamData, const char *format,
+                                        const char *dir, const char *required) {
+    replicationHeader header;
+    if (!readAll(read, streamData, &header, sizeof(header))) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read replication header");
+        return KVIDX_ERROR_IO;
+    }
+    if (header.magic != REPLICATION_MAGIC ||
+        header.version != REPLICATION_VERSION ||
+        strncmp(header.format, format, sizeof(header.format)) != 0) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Replication stream is not in %s format", format);
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint8_t *buf = malloc(KVIDX_STREAM_BUFFER_BYTES);
+    if (!buf) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate buffer");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    kvidxError result = KVIDX_OK;
+    for (;;) {
+        uint32_t nameLen;
+        char name[REPLICATION_NAME_MAX + 1];
+        if (!readAll(read, streamData, &nameLen, sizeof(nameLen))) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Replication stream ended early");
+            result = KVIDX_ERROR_IO;
+            break;
+        }
+        if (nameLen == 0) {
+            break;
+        }
+
+        if (nameLen > REPLICATION_NAME_MAX) {
+            kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                          "Invalid file name length in replication stream");
+            result = KVIDX_ERROR_CORRUPT;
+            break;
+        }
+        if (!readAll(read, streamData, name, nameLen)) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Replication stream ended early");
+            result = KVIDX_ERROR_IO;
+            break;
+        }
+        name[nameLen] = '\0';
+        if (strlen(name) != nameLen || !safeName(name)) {
+            kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                          "Invalid file name in replication stream");
+            result = KVIDX_ERROR_CORRUPT;
+            break;
+        }
+
+        result = receiveFile(i, read, streamData, dir, name, buf);
+        if (result != KVIDX_OK) {
+            break;
+        }
+    }
+
+    free(buf);
+
+    if (result == KVIDX_OK) {
+        char path[PATH_MAX];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, required);
+        if (stat(path, &st) != 0) {
+            kvidxSetError(i, KVIDX_ERROR_CORRUPT,
+                          "Replication stream has no %s", required);
+            result = KVIDX_ERROR_CORRUPT;
+        }
+    }
+    return result;
+}
+
+char *kvidxReplicationTempDir(const char *path) {
+    static const char suffix[] = ".kvidx-replication-XXXXXX";
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+
+    /* Beside path, so installing is a rename within one filesystem */
+    char *dir = malloc(len + sizeof(suffix));
+    if (!dir) {
+        return NULL;
+    }
+    memcpy(dir, path, len);
+    memcpy(dir + len, suffix, sizeof(suffix));
+    if (!mkdtemp(dir)) {
+        free(dir);
+        return NULL;
+    }
+    return dir;
+}
+
+void kvidxReplicationRemoveDir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d) {
+        const struct dirent *entry;
+        while ((entry = readdir(d))) {
+            if (strcmp(entry->d_name, ".") == 0 ||
+                strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            char path[PATH_MAX];
+            struct stat st;
+            if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir,
+                                 entry->d_name) >= sizeof(path) ||
+                lstat(path, &st) != 0) {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                kvidxReplicationRemoveDir(path);
+            } else {
+                unlink(path);
+            }
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+bool kvidxReplicationSyncDir(const char *path) {
+    char dir[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else if ((size_t)(slash - path) < sizeof(dir)) {
+        memcpy(dir, path, (size_t)(slash - path));
+        dir[slash - path] = '\0';
+    } else {
+        return false;
+    }
+
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+/* Reopen a closed instance on filename with its saved configuration */
+static kvidxError reopen(kvidxInstance *i, const char *filename) {
+    const char *err = NULL;
+    bool opened;
+    if (i->configInitialized) {
+        const kvidxConfig config = i->config;
+        opened = kvidxOpenWithConfig(i, filename, &config, &err);
+    } else {
+        opened = kvidxOpen(i, filename, &err);
+    }
+
+    if (!opened) {
+        kvidxSetError(i, KVIDX_ERROR_IO,
+                      "Failed to reopen %s after installing a snapshot: %s",
+                      filename, err ? err : "unknown error");
+        return KVIDX_ERROR_IO;
+    }
+    return KVIDX_OK;
+}
+
+/* Every call on an instance whose storage could not be reopened fails */
+static bool closedFail(kvidxInstance *i) {
+    (void)i;
+    return false;
+}
+
+static bool closedKeyFail(kvidxInstance *i, uint64_t key) {
+    (void)i;
+    (void)key;
+    return false;
+}
+
+static bool closedExistsDual(kvidxInstance *i, uint64_t key, uint64_t term) {
+    (void)i;
+    (void)key;
+    (void)term;
+    return false;
+}
+
+static bool closedGet(kvidxInstance *i, uint64_t key, uint64_t *term,
+                      uint64_t *cmd, const uint8_t **data, size_t *len) {
+    (void)i;
+    (void)key;
+    (void)term;
+    (void)cmd;
+    (void)data;
+    (void)len;
+    return false;
+}
+
+static bool closedGetAdjacent(kvidxInstance *i, uint64_t previousKey,
+                              uint64_t *nextKey, uint64_t *nextTerm,
+                              uint64_t *cmd, const uint8_t **data,
+                              size_t *len) {
+    (void)i;
+    (void)previousKey;
+    (void)nextKey;
+    (void)nextTerm;
+    (void)cmd;
+    (void)data;
+    (void)len;
+    return false;
+}
+
+static bool closedMaxKey(kvidxInstance *i, uint64_t *key) {
+    (void)i;
+    (void)key;
+    return false;
+}
+
+static bool closedInsert(kvidxInstance *i, uint64_t key, uint64_t term,
+                         uint64_t cmd, const void *data, size_t dataLen) {
+    (void)i;
+    (void)key;
+    (void)term;
+    (void)cmd;
+    (void)data;
+    (void)dataLen;
+    return false;
+}
+
+static bool closedOpen(kvidxInstance *i, const char *filename,
+                       const char **err) {
+    (void)i;
+    (void)filename;
+    if (err) {
+        *err = "Instance lost its storage; set its interface again";
+    }
+    return false;
+}
+
+static bool closedClose(kvidxInstance *i) {
+    i->kvidxdata = NULL;
+    return true;
+}
+
+static kvidxError closedStats(kvidxInstance *i, kvidxStats *stats) {
+    (void)i;
+    (void)stats;
+    return KVIDX_ERROR_IO;
+}
+
+static kvidxError closedValue(kvidxInstance *i, uint64_t *value) {
+    (void)i;
+    (void)value;
+    return KVIDX_ERROR_IO;
+}
+
+static kvidxError closedRemoveRange(kvidxInstance *i, uint64_t startKey,
+                                    uint64_t endKey, bool startInclusive,
+                                    bool endInclusive,
+                                    uint64_t *deletedCount) {
+    (void)i;
+    (void)startKey;
+    (void)endKey;
+    (void)startInclusive;
+    (void)endInclusive;
+    (void)deletedCount;
+    return KVIDX_ERROR_IO;
+}
+
+static kvidxError closedCountRange(kvidxInstance *i, uint64_t startKey,
+                                   uint64_t endKey, uint64_t *count) {
+    (void)i;
+    (void)startKey;
+    (void)endKey;
+    (void)count;
+    return KVIDX_ERROR_IO;
+}
+
+static kvidxError closedExistsInRange(kvidxInstance *i, uint64_t startKey,
+                                      uint64_t endKey, bool *exists) {
+    (void)i;
+    (void)startKey;
+    (void)endKey;
+    (void)exists;
+    return KVIDX_ERROR_IO;
+}
+
+/* Required hooks fail; optional ones are absent */
+static const kvidxInterface closedInterface = {
+    .begin = closedFail,
+    .commit = closedFail,
+    .get = closedGet,
+    .getPrev = closedGetAdjacent,
+    .getNext = closedGetAdjacent,
+    .exists = closedKeyFail,
+    .existsDual = closedExistsDual,
+    .maxKey = closedMaxKey,
+    .insert = closedInsert,
+    .remove = closedKeyFail,
+    .removeAfterNInclusive = closedKeyFail,
+    .removeBeforeNInclusive = closedKeyFail,
+    .fsync = closedFail,
+    .open = closedOpen,
+    .close = closedClose,
+    .getStats = closedStats,
+    .getKeyCount = closedValue,
+    .getMinKey = closedValue,
+    .getDataSize = closedValue,
+    .removeRange = closedRemoveRange,
+    .countRange = closedCountRange,
+    .existsInRange = closedExistsInRange,
+    .abort = closedFail,
+};
+
+/* Remove the file or directory at path */
+static void removePath(const char *path) {
+    struct stat st;
+    if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+        kvidxReplicationRemoveDir(path);
+    } else {
+        unlink(path);
+    }
+}
+
+kvidxError kvidxReplicationInstall(kvidxInstance *i, const char *staged,
+                                   const char *target, const char *filename) {
+    /* The old storage waits here until the new one has opened */
+    char *aside = kvidxReplicationTempDir(target);
+    char previous[PATH_MAX];
+    char failed[PATH_MAX];
+    bool installed = false;
+    if (!aside ||
+        (size_t)snprintf(previous, sizeof(previous), "%s/previous", aside) >=
+            sizeof(previous) ||
+        (size_t)snprintf(failed, sizeof(failed), "%s/failed", aside) >=
+            sizeof(failed)) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create directory: %s",
+                      strerror(errno));
+    } else if (rename(target, previous) != 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to move %s aside: %s",
+                      target, strerror(errno));
+    } else if (rename(staged, target) != 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to install %s: %s", target,
+                      strerror(errno));
+        rename(previous, target);
+    } else {
+        installed = true;
+    }
+    kvidxReplicationSyncDir(target);
+
+    if (installed && reopen(i, filename) == KVIDX_OK) {
+        kvidxReplicationRemoveDir(aside);
+        free(aside);
+        return KVIDX_OK;
+    }
+
+    /* Keep the first error; the old storage is reopened below */
+    char message[sizeof(i->lastErrorMessage)];
+    memcpy(message, i->lastErrorMessage, sizeof(message));
+
+    bool restored = !installed;
+    if (installed && rename(target, failed) == 0 &&
+        rename(previous, target) == 0) {
+        kvidxReplicationSyncDir(target);
+        restored = true;
+    }
+
+    if (!restored || reopen(i, filename) != KVIDX_OK) {
+        i->interface = closedInterface;
+        i->kvidxdata = NULL;
+        kvidxSetError(i, KVIDX_ERROR_IO,
+                      "%s; the previous storage did not reopen either%s%s",
+                      message, restored ? "" : ", it is kept in ",
+                      restored ? "" : aside);
+        free(aside);
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxSetError(i, KVIDX_ERROR_IO, "%s", message);
+    if (aside) {
+        removePath(failed);
+        kvidxReplicationRemoveDir(aside);
+    }
+    free(aside);
+    return KVIDX_ERROR_IO;
+}
+
+/* fsync every file under dir, then dir itself */
+static bool syncTree(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return false;
+    }
+
+    bool synced = true;
+    const struct dirent *entry;
+    while (synced && (entry = readdir(d))) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char path[PATH_MAX];
+        struct stat st;
+        if ((size_t)snprintf(path, sizeof(path), "%s/%s", dir,
+                             entry->d_name) >= sizeof(path) ||
+            lstat(path, &st) != 0) {
+            synced = false;
+        } else if (S_ISDIR(st.st_mode)) {
+            synced = syncTree(path);
+        } else if (S_ISREG(st.st_mode)) {
+            const int fd = open(path, O_RDONLY);
+            synced = fd >= 0 && fsync(fd) == 0;
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    closedir(d);
+
+    const int fd = open(dir, O_RDONLY);
+    synced = synced && fd >= 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        close(fd);
+    }
+    return synced;
+}
+
+kvidxError kvidxReplicationBuild(kvidxInstance *i, const char *dir,
+                                 const char *name, kvidxStreamReadCallback read,
+                                 void *streamData) {
+    char path[PATH_MAX];
+    if (name && (size_t)snprintf(path, sizeof(path), "%s/%s", dir, name) >=
+                    sizeof(path)) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Staging path too long");
+        return KVIDX_ERROR_IO;
+    }
+
+    /* Nothing can observe the staged copy before syncTree() below, so it
+     * is loaded without a journal or per-commit syncs */
+    kvidxConfig config = i->configInitialized ? i->config
+                                              : kvidxConfigDefault();
+    config.journalMode = KVIDX_JOURNAL_OFF;
+    config.syncMode = KVIDX_SYNC_OFF;
+    config.sqliteBackgroundCheckpoint = false;
+    config.rocksdbDisableWAL = true;
+    config.readOnly = false;
+
+    kvidxInstance staged = {.interface = i->interface};
+    const char *err = NULL;
+    if (!kvidxOpenWithConfig(&staged, name ? path : dir, &config, &err)) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to create staging storage: %s",
+                      err ? err : "unknown error");
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxError result =
+        kvidxImportFromStream(&staged, read, streamData, NULL, NULL, NULL);
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "%s", kvidxGetLastErrorMessage(&staged));
+    } else if (!kvidxFsync(&staged)) {
+        result = KVIDX_ERROR_IO;
+        kvidxSetError(i, result, "Failed to flush staging storage");
+    }
+    kvidxClose(&staged);
+
+    if (result == KVIDX_OK && !syncTree(dir)) {
+        result = KVIDX_ERROR_IO;
+        kvidxSetError(i, result, "Failed to sync staging storage: %s",
+                      strerror(errno));
+    }
+    return result;
+}
+
+/* ====================================================================
+ * Public API
+ * ==================================================================== */
+
+/* Native installs swap the files under the change feed: report a reset */
+static void installed(kvidxInstance *i) {
+    if (i->changes && kvidxChangeActive(i)) {
+        kvidxChangeRecord(i, KVIDX_CHANGE_RESET, 0, UINT64_MAX, 0, 0, NULL,
+                          0);
+        kvidxChangePublish(i);
+    }
+}
+
+/* Replays the already-read header, then reads from the network */
+typedef struct replicationSource {
+    kvidxStreamReadCallback read;
+    void *streamData;
+    replicationHeader header;
+    size_t replayed;
+} replicationSource;
+
+static int64_t sourceRead(void *buf, size_t len, void *streamData) {
+    replicationSource *src = streamData;
+    if (src->replayed < sizeof(src->header)) {
+        size_t n = sizeof(src->header) - src->replayed;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buf, (const uint8_t *)&src->header + src->replayed, n);
+        src->replayed += n;
+        return (int64_t)n;
+    }
+    return src->read(buf, len, src->streamData);
+}
+
+static kvidxError copyStorage(kvidxInstance *i,
+                              kvidxStreamWriteCallback networkWrite,
+                              void *networkState) {
+    if (i->interface.copyStorageForReplication) {
+        kvidxSetError(i, KVIDX_OK, NULL);
+        if (i->interface.copyStorageForReplication(i, networkWrite,
+                                                   networkState)) {
+            return KVIDX_OK;
+        }
+        return i->lastError != KVIDX_OK ? i->lastError : KVIDX_ERROR_IO;
+    }
+
+    /* No native copy: send a binary export, which any adapter can take */
+    const replicationHeader header = {.magic = REPLICATION_MAGIC,
+                                      .version = REPLICATION_VERSION,
+                                      .format = KVIDX_REPLICATION_EXPORT};
+    if (!networkWrite(&header, sizeof(header), networkState)) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to send replication header");
+        return KVIDX_ERROR_IO;
+    }
+    return kvidxExportToStream(i, networkWrite, networkState, NULL, NULL,
+                               NULL);
+}
+
+kvidxError kvidxCopyStorageForReplication(kvidxInstance *i,
+                                          kvidxStreamWriteCallback networkWrite,
+                                          void *networkState) {
+    if (!i || !networkWrite) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_COPY_STORAGE);
+    const kvidxError result = copyStorage(i, networkWrite, networkState);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+static kvidxError receiveStorage(kvidxInstance *i,
+                                 kvidxStreamReadCallback networkRead,
+                                 void *networkState) {
+    replicationSource src = {.read = networkRead, .streamData = networkState};
+    if (!readAll(networkRead, networkState, &src.header,
+                 sizeof(src.header)) ||
+        src.header.magic != REPLICATION_MAGIC) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Not a kvidx replication stream");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* A binary export replaces the contents in one transaction */
+    if (strncmp(src.header.format, KVIDX_REPLICATION_EXPORT,
+                sizeof(src.header.format)) == 0) {
+        kvidxImportOptions options = kvidxImportOptionsDefault();
+        options.clearBeforeImport = true;
+        return kvidxImportFromStream(i, networkRead, networkState, &options,
+                                     NULL, NULL);
+    }
+
+    if (!i->interface.copyStorageForReplicationReceive) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Adapter cannot install %.16s storage",
+                      src.header.format);
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    kvidxSetError(i, KVIDX_OK, NULL);
+    if (i->interface.copyStorageForReplicationReceive(i, sourceRead, &src)) {
+        installed(i);
+        return KVIDX_OK;
+    }
+    return i->lastError != KVIDX_OK ? i->lastError : KVIDX_ERROR_IO;
+}
+
+kvidxError kvidxReceiveStorageForReplication(kvidxInstance *i,
+                                             kvidxStreamReadCallback networkRead,
+                                             void *networkState) {
+    if (!i || !networkRead) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const kvidxMetricsSpan span =
+        kvidxMetricsStart(i, KVIDX_OP_RECEIVE_STORAGE);
+    const kvidxError result = receiveStorage(i, networkRead, networkState);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+static kvidxError replaceAll(kvidxInstance *i, kvidxStreamReadCallback read,
+                             void *streamData) {
+    /* Hooks refuse with NOT_SUPPORTED before reading anything */
+    if (i->interface.replaceAll) {
+        kvidxSetError(i, KVIDX_OK, NULL);
+        const kvidxError result = i->interface.replaceAll(i, read, streamData);
+        if (result == KVIDX_OK) {
+            installed(i);
+        }
+        if (result != KVIDX_ERROR_NOT_SUPPORTED) {
+            return result;
+        }
+    }
+
+    kvidxImportOptions options = kvidxImportOptionsDefault();
+    options.clearBeforeImport = true;
+    return kvidxImportFromStream(i, read, streamData, &options, NULL, NULL);
+}
+
+kvidxError kvidxReplaceAll(kvidxInstance *i, kvidxStreamReadCallback read,
+                           void *streamData) {
+    if (!i || !read) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_REPLACE_ALL);
+    const kvidxError result = replaceAll(i, read, streamData);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
@@ -0,0 +1,1110 @@
+/**
+ * Streaming export/import for kvidxkit
+ *
+ * Export and import through caller-supplied callbacks or file descriptors
+ * instead of named files, so a snapshot can be piped or sent over a socket
+ * without being staged on disk. Bytes are identical to kvidxExport() output.
+ *
+ * Both directions go through one KVIDX_STREAM_BUFFER_BYTES page-aligned
+ * buffer: the exporter fills it and hands it to the sink in one call, the
+ * importer refills it in large reads and inserts values directly from it.
+ * Entries are read and written through the public API, so every adapter
+ * supports streaming without adapter-specific code.
+ *
+ * Also maps export files for the adapters' kvidxImport() paths, which
+ * parse entries in place instead of reading them field by field, and
+ * writes kvidxExport() JSON and CSV files for every adapter.
+ *
+ * Incremental exports use the same encoder, writing only entries added or
+ * rewritten since an earlier export's token.
+ */
+
+/* Required for posix_memalign, madvise and pwrite under -std=c99 */
+#if defined(__APPLE__)
+#define _DARWIN_C_SOURCE
+#elif !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Binary format magic number: "KVIDX\0\0\0" */
+#define KVIDX_BINARY_MAGIC 0x5844495645564B00ULL
+#define KVIDX_BINARY_VERSION 1
+
+/* Binary format header */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entryCount;
+} kvidxBinaryHeader;
+
+/* kvidxExportToken as stored after an incremental export's header */
+typedef struct {
+    uint64_t startKey;
+    uint64_t endKey;
+    uint64_t sinceKey;
+    uint64_t sinceTerm;
+    uint64_t nextKey;
+    uint64_t newKey;
+    uint64_t newTerm;
+    uint64_t entries;
+    uint64_t flags;
+} incrementalToken;
+
+/* incrementalToken.flags */
+#define INCREMENTAL_COMPLETE 0x1
+
+/* key, term, cmd, dataLen */
+#define ENTRY_HEADER_BYTES (4 * sizeof(uint64_t))
+
+/* Alignment of the stream buffer */
+#define STREAM_BUFFER_ALIGN 4096
+
+static uint8_t *streamBufferNew(void) {
+    void *buf = NULL;
+    if (posix_memalign(&buf, STREAM_BUFFER_ALIGN, KVIDX_STREAM_BUFFER_BYTES)) {
+        return NULL;
+    }
+    return buf;
+}
+
+/* ====================================================================
+ * Export
+ * ==================================================================== */
+
+typedef struct streamWriter {
+    uint8_t *buf;
+    size_t used;
+    kvidxStreamWriteCallback write;
+    void *streamData;
+    bool failed;
+} streamWriter;
+
+static void writerFlush(streamWriter *w) {
+    if (w->used && !w->failed && !w->write(w->buf, w->used, w->streamData)) {
+        w->failed = true;
+    }
+    w->used = 0;
+}
+
+static void writerPut(streamWriter *w, const void *data, size_t len) {
+    if (len > KVIDX_STREAM_BUFFER_BYTES - w->used) {
+        writerFlush(w);
+
+        /* Values bigger than the buffer go to the sink directly */
+        if (len >= KVIDX_STREAM_BUFFER_BYTES) {
+            if (!w->failed && !w->write(data, len, w->streamData)) {
+                w->failed = true;
+            }
+            return;
+        }
+    }
+
+    memcpy(w->buf + w->used, data, len);
+    w->used += len;
+}
+
+static void writerString(streamWriter *w, const char *str) {
+    writerPut(w, str, strlen(str));
+}
+
+static void writerUint(streamWriter *w, uint64_t value) {
+    char digits[20];
+    size_t n = sizeof(digits);
+    do {
+        digits[--n] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    writerPut(w, digits + n, sizeof(digits) - n);
+}
+
+/**
+ * Write a string with JSON escape sequences (same rules as kvidxExport():
+ * quote, backslash and control characters escaped). Runs of plain bytes are
+ * found with kvidxTextSpan() and copied in one piece.
+ */
+static void writerJsonEscaped(streamWriter *w, const uint8_t *str,
+                              size_t len) {
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    for (;;) {
+        const size_t plain =
+            kvidxTextSpan(KVIDX_TEXT_JSON_ESCAPE, str + n, len - n);
+        writerPut(w, str + n, plain);
+        n += plain;
+        if (n == len) {
+            return;
+        }
+
+        const uint8_t c = str[n++];
+        char escape[6] = {'\\', (char)c};
+        size_t escapeLen = 2;
+        switch (c) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            escape[1] = 'b';
+            break;
+        case '\f':
+            escape[1] = 'f';
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        default:
+            memcpy(escape + 1, "u00", 3);
+            escape[4] = hex[c >> 4];
+            escape[5] = hex[c & 0xF];
+            escapeLen = 6;
+        }
+        writerPut(w, escape, escapeLen);
+    }
+}
+
+/**
+ * Write a CSV field, quoted (RFC 4180) if it contains a comma, quote or
+ * line break.
+ */
+static void writerCsvField(streamWriter *w, const uint8_t *str, size_t len) {
+    if (kvidxTextSpan(KVIDX_TEXT_CSV_SPECIAL, str, len) == len) {
+        writerPut(w, str, len);
+        return;
+    }
+
+    writerPut(w, "\"", 1);
+    const uint8_t *end = str + len;
+    const uint8_t *quote;
+    while ((quote = memchr(str, '"', (size_t)(end - str)))) {
+        /* Escape quote with double quote */
+        writerPut(w, str, (size_t)(quote + 1 - str));
+        writerPut(w, "\"", 1);
+        str = quote + 1;
+    }
+    writerPut(w, str, (size_t)(end - str));
+    writerPut(w, "\"", 1);
+}
+
+static void writeEntry(streamWriter *w, const kvidxExportOptions *options,
+                       bool first, uint64_t key, uint64_t term, uint64_t cmd,
+                       const uint8_t *data, size_t dataLen) {
+    if (options->format == KVIDX_EXPORT_BINARY) {
+        const uint64_t fields[4] = {key, term, cmd, dataLen};
+        writerPut(w, fields, sizeof(fields));
+        if (dataLen) {
+            writerPut(w, data, dataLen);
+        }
+    } else if (options->format == KVIDX_EXPORT_JSON) {
+        if (!first) {
+            writerPut(w, ",", 1);
+        }
+        if (options->prettyPrint) {
+            writerString(w, "\n  ");
+        }
+        writerString(w, "{\"key\":");
+        writerUint(w, key);
+        if (options->includeMetadata) {
+            writerString(w, ",\"term\":");
+            writerUint(w, term);
+            writerString(w, ",\"cmd\":");
+            writerUint(w, cmd);
+        }
+        writerString(w, ",\"data\":\"");
+        if (dataLen) {
+            writerJsonEscaped(w, data, dataLen);
+        }
+        writerString(w, "\"}");
+    } else {
+        writerUint(w, key);
+        writerPut(w, ",", 1);
+        if (options->includeMetadata) {
+            writerUint(w, term);
+            writerPut(w, ",", 1);
+            writerUint(w, cmd);
+            writerPut(w, ",", 1);
+        }
+        if (dataLen) {
+            writerCsvField(w, data, dataLen);
+        }
+        writerPut(w, "\n", 1);
+    }
+}
+
+typedef struct streamExport {
+    streamWriter *w;
+    const kvidxExportOptions *options;
+    kvidxProgressCallback callback;
+    void *userData;
+    uint64_t total;
+    uint64_t count;
+    bool cancelled;
+} streamExport;
+
+/* Scan visitor: encode one entry, stopping on write failure or cancel */
+static bool streamVisit(void *ctx, uint64_t key, uint64_t term, uint64_t cmd,
+                        const uint8_t *data, size_t len) {
+    streamExport *e = ctx;
+    writeEntry(e->w, e->options, e->count == 0, key, term, cmd, data, len);
+    e->count++;
+
+    /* Progress callback */
+    if (e->callback && e->count % 100 == 0 &&
+        !e->callback(e->count, e->total, e->userData)) {
+        e->cancelled = true;
+        return false;
+    }
+
+    return !e->w->failed;
+}
+
+/* Export from source, which holds one snapshot; errors are reported on i */
+static kvidxError exportSnapshot(kvidxInstance *i, kvidxInstance *source,
+                                 kvidxStreamWriteCallback write,
+                                 void *streamData,
+                                 const kvidxExportOptions *options,
+                                 kvidxProgressCallback callback,
+                                 void *userData) {
+    /* The binary header carries the entry count up front */
+    uint64_t total = 0;
+    kvidxError result =
+        kvidxCountRange(source, options->startKey, options->endKey, &total);
+    if (result != KVIDX_OK) {
+        if (source != i) {
+            kvidxSetError(i, result, "Failed to count entries to export");
+        }
+        return result;
+    }
+
+    streamWriter w = {.buf = streamBufferNew(),
+                      .write = write,
+                      .streamData = streamData};
+    if (!w.buf) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate stream buffer");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    /* Write format-specific header */
+    if (options->format == KVIDX_EXPORT_BINARY) {
+        kvidxBinaryHeader header = {.magic = KVIDX_BINARY_MAGIC,
+                                    .version = KVIDX_BINARY_VERSION,
+                                    .reserved = 0,
+                                    .entryCount = total};
+        writerPut(&w, &header, sizeof(header));
+    } else if (options->format == KVIDX_EXPORT_JSON) {
+        writerString(&w, "{\"format\":\"kvidx-json\",\"version\":1,"
+                         "\"entries\":[");
+        if (options->prettyPrint) {
+            writerPut(&w, "\n", 1);
+        }
+    } else if (options->includeMetadata) {
+        writerString(&w, "key,term,cmd,data\n");
+    } else {
+        writerString(&w, "key,data\n");
+    }
+
+    /* Export entries */
+    streamExport e = {.w = &w,
+                      .options = options,
+                      .callback = callback,
+                      .userData = userData,
+                      .total = total};
+    result = kvidxScanRange(source, options->startKey, options->endKey,
+                            streamVisit, &e);
+    if (result == KVIDX_OK && e.cancelled) {
+        result = KVIDX_ERROR_CANCELLED;
+    }
+    const uint64_t count = e.count;
+
+    /* Write format-specific footer */
+    if (result == KVIDX_OK && options->format == KVIDX_EXPORT_JSON) {
+        writerString(&w, options->prettyPrint ? "\n]}\n" : "]}\n");
+    }
+
+    if (result == KVIDX_OK) {
+        writerFlush(&w);
+    }
+    free(w.buf);
+
+    if (result == KVIDX_OK && w.failed) {
+        result = KVIDX_ERROR_IO;
+    } else if (result == KVIDX_OK && options->format == KVIDX_EXPORT_BINARY &&
+               count != total) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL,
+                      "Exported %" PRIu64 " entries but counted %" PRIu64,
+                      count, total);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    /* Final progress callback */
+    if (result == KVIDX_OK && callback && count > 0) {
+        callback(count, total, userData);
+    }
+
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Export failed after %" PRIu64 " entries",
+                      count);
+    }
+    return result;
+}
+
+kvidxError kvidxExportToStream(kvidxInstance *i, kvidxStreamWriteCallback write,
+                               void *streamData,
+                               const kvidxExportOptions *options,
+                               kvidxProgressCallback callback, void *userData) {
+    if (!i || !write) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Use default options if not provided */
+    kvidxExportOptions defaultOptions;
+    if (!options) {
+        defaultOptions = kvidxExportOptionsDefault();
+        options = &defaultOptions;
+    }
+
+    if (options->startKey > options->endKey) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Export range start is past its end");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const kvidxMetricsSpan span =
+        kvidxMetricsStartKeys(i, KVIDX_OP_EXPORT_STREAM, options->startKey,
+                              options->endKey, 0);
+
+    /* Count and scan one snapshot, so the header matches the entries */
+    kvidxInstance reader = {0};
+    kvidxInstance *source = i;
+    bool snapshotTxn = false;
+    if (i->interface.openReader && i->interface.openReader(i, &reader)) {
+        source = &reader;
+    } else if (!i->transactionActive) {
+        snapshotTxn = i->interface.begin(i);
+    }
+
+    const kvidxError result = exportSnapshot(i, source, write, streamData,
+                                             options, callback, userData);
+
+    if (source == &reader) {
+        reader.interface.close(&reader);
+    } else if (snapshotTxn) {
+        i->interface.abort(i);
+    }
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+/* ====================================================================
+ * Import
+ * ==================================================================== */
+
+typedef struct streamReader {
+    uint8_t *buf;
+    size_t pos; /* Next unread byte */
+    size_t end; /* End of buffered bytes */
+    kvidxStreamReadCallback read;
+    void *streamData;
+    bool failed; /* Source reported an error (not just end of stream) */
+} streamReader;
+
+/**
+ * Make at least want bytes (<= buffer size) available at buf + pos.
+ */
+static bool readerFill(streamReader *r, size_t want) {
+    if (r->end - r->pos >= want) {
+        return true;
+    }
+
+    memmove(r->buf, r->buf + r->pos, r->end - r->pos);
+    r->end -= r->pos;
+    r->pos = 0;
+
+    while (r->end < want) {
+        int64_t n = r->read(r->buf + r->end, KVIDX_STREAM_BUFFER_BYTES - r->end,
+                            r->streamData);
+        if (n <= 0) {
+            r->failed = n < 0;
+            return false;
+        }
+        r->end += (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * Copy len bytes of any size out of the stream.
+ */
+static bool readerTake(streamReader *r, uint8_t *dst, size_t len) {
+    size_t buffered = r->end - r->pos;
+    if (buffered > len) {
+        buffered = len;
+    }
+    memcpy(dst, r->buf + r->pos, buffered);
+    r->pos += buffered;
+
+    for (size_t got = buffered; got < len;) {
+        int64_t n = r->read(dst + got, len - got, r->streamData);
+        if (n <= 0) {
+            r->failed = n < 0;
+            return false;
+        }
+        got += (size_t)n;
+    }
+    return true;
+}
+
+static kvidxError importStream(kvidxInstance *i, kvidxStreamReadCallback read,
+                               void *streamData,
+                               const kvidxImportOptions *options,
+                               kvidxProgressCallback callback,
+                               void *userData) {
+    streamReader r = {
+        .buf = streamBufferNew(), .read = read, .streamData = streamData};
+    if (!r.buf) {
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate stream buffer");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    kvidxError result = KVIDX_OK;
+    kvidxBinaryHeader header;
+    if (!readerFill(&r, sizeof(header))) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read binary header");
+        free(r.buf);
+        return KVIDX_ERROR_IO;
+    }
+    memcpy(&header, r.buf, sizeof(header));
+    r.pos = sizeof(header);
+
+    /* BINARY means auto-detect; anything else is JSON or CSV */
+    if (options->format != KVIDX_EXPORT_BINARY ||
+        header.magic != KVIDX_BINARY_MAGIC) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "JSON and CSV can only be imported from files");
+        free(r.buf);
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    }
+
+    if (header.version == KVIDX_BINARY_VERSION_BLOCKS) {
+        kvidxSetError(i, KVIDX_ERROR_NOT_SUPPORTED,
+                      "Block-layout exports can only be imported from files");
+        free(r.buf);
+        return KVIDX_ERROR_NOT_SUPPORTED;
+    } else if (header.version != KVIDX_BINARY_VERSION &&
+               header.version != KVIDX_BINARY_VERSION_INCREMENTAL) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Unsupported binary format version: %u", header.version);
+        free(r.buf);
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Incremental exports carry changed entries, which replace old ones */
+    const bool replace = header.version == KVIDX_BINARY_VERSION_INCREMENTAL;
+    if (replace) {
+        if (!readerFill(&r, sizeof(incrementalToken))) {
+            kvidxSetError(i, KVIDX_ERROR_IO, "Failed to read export token");
+            free(r.buf);
+            return KVIDX_ERROR_IO;
+        }
+        r.pos += sizeof(incrementalToken);
+    }
+
+    if (!kvidxBegin(i)) {
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to begin transaction");
+        free(r.buf);
+        return KVIDX_ERROR_INTERNAL;
+    }
+
+    /* Clear inside the transaction so a failed import keeps the old data */
+    if (options->clearBeforeImport) {
+        result = kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+    }
+
+    /* Values larger than the stream buffer are assembled here */
+    uint8_t *scratch = NULL;
+    size_t scratchSize = 0;
+    uint64_t count = 0;
+
+    for (uint64_t idx = 0; idx < header.entryCount && result == KVIDX_OK;
+         idx++) {
+        if (!readerFill(&r, ENTRY_HEADER_BYTES)) {
+            result = KVIDX_ERROR_IO;
+            break;
+        }
+
+        uint64_t fields[4];
+        memcpy(fields, r.buf + r.pos, sizeof(fields));
+        r.pos += sizeof(fields);
+        const uint64_t key = fields[0];
+        const uint64_t dataLen = fields[3];
+
+        const uint8_t *data = NULL;
+        if (dataLen > SIZE_MAX) {
+            result = KVIDX_ERROR_CORRUPT;
+            break;
+        } else if (dataLen <= KVIDX_STREAM_BUFFER_BYTES) {
+            if (!readerFill(&r, (size_t)dataLen)) {
+                result = KVIDX_ERROR_IO;
+                break;
+            }
+            data = r.buf + r.pos;
+            r.pos += (size_t)dataLen;
+        } else {
+            if (dataLen > scratchSize) {
+                uint8_t *grown = realloc(scratch, (size_t)dataLen);
+                if (!grown) {
+                    result = KVIDX_ERROR_NOMEM;
+                    break;
+                }
+                scratch = grown;
+                scratchSize = (size_t)dataLen;
+            }
+            if (!readerTake(&r, scratch, (size_t)dataLen)) {
+                result = KVIDX_ERROR_IO;
+                break;
+            }
+            data = scratch;
+        }
+
+        const bool inserted =
+            replace ? kvidxInsertEx(i, key, fields[1], fields[2], data,
+                                    (size_t)dataLen,
+                                    KVIDX_SET_ALWAYS) == KVIDX_OK
+                    : kvidxInsert(i, key, fields[1], fields[2], data,
+                                  (size_t)dataLen);
+        if (!inserted) {
+            if (options->skipDuplicates) {
+                /* Continue on duplicate key */
+                continue;
+            }
+            result = kvidxGetLastError(i) != KVIDX_OK ? kvidxGetLastError(i)
+                                                      : KVIDX_ERROR_INTERNAL;
+            break;
+        }
+
+        count++;
+
+        /* Progress callback */
+        if (callback && count % 100 == 0 &&
+            !callback(count, header.entryCount, userData)) {
+            result = KVIDX_ERROR_CANCELLED;
+        }
+    }
+
+    free(scratch);
+    free(r.buf);
+
+    if (result == KVIDX_OK && !kvidxCommit(i)) {
+        result = KVIDX_ERROR_INTERNAL;
+    } else if (result != KVIDX_OK) {
+        kvidxAbort(i);
+    }
+
+    /* Final progress callback */
+    if (result == KVIDX_OK && callback && count > 0) {
+        callback(count, header.entryCount, userData);
+    }
+
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Import failed after %" PRIu64 " entries%s",
+                      count, r.failed ? " (stream read error)" : "");
+    }
+    return result;
+}
+
+kvidxError kvidxImportFromStream(kvidxInstance *i, kvidxStreamReadCallback read,
+                                 void *streamData,
+                                 const kvidxImportOptions *options,
+                                 kvidxProgressCallback callback,
+                                 void *userData) {
+    if (!i || !read) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Use default options if not provided */
+    kvidxImportOptions defaultOptions;
+    if (!options) {
+        defaultOptions = kvidxImportOptionsDefault();
+        options = &defaultOptions;
+    }
+
+    const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_IMPORT_STREAM);
+    const kvidxError result =
+        importStream(i, read, streamData, options, callback, userData);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+/* ====================================================================
+ * Mapped Files
+ * ==================================================================== */
+
+/* Pages already parsed are dropped from memory in steps this large */
+#define MAPPED_RELEASE_BYTES (64 * 1024 * 1024)
+
+kvidxError kvidxMapFile(kvidxInstance *i, const char *filename,
+                        kvidxMappedFile *m) {
+    memset(m, 0, sizeof(*m));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file: %s", filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to stat file: %s", filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    /* An empty file maps to nothing; reads from it just fail */
+    if (st.st_size > 0) {
+        void *base =
+            mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base == MAP_FAILED) {
+            close(fd);
+            kvidxSetError(i, KVIDX_ERROR_IO, "Failed to map %s: %s", filename,
+                          strerror(errno));
+            return KVIDX_ERROR_IO;
+        }
+        madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+        m->base = base;
+        m->size = (size_t)st.st_size;
+    }
+
+    close(fd);
+    return KVIDX_OK;
+}
+
+bool kvidxMappedRead(kvidxMappedFile *m, void *dst, size_t len) {
+    if (len > m->size - m->pos) {
+        return false;
+    }
+    memcpy(dst, m->base + m->pos, len);
+    m->pos += len;
+    return true;
+}
+
+bool kvidxMappedEntry(kvidxMappedFile *m, uint64_t *key, uint64_t *term,
+                      uint64_t *cmd, const uint8_t **data, size_t *len) {
+    uint64_t fields[4];
+    if (!kvidxMappedRead(m, fields, sizeof(fields)) ||
+        fields[3] > m->size - m->pos) {
+        return false;
+    }
+
+    *key = fields[0];
+    *term = fields[1];
+    *cmd = fields[2];
+    *len = (size_t)fields[3];
+    *data = *len ? m->base + m->pos : NULL;
+    m->pos += *len;
+
+    /* Clean file pages: the kernel rereads them if they're touched again */
+    if (m->pos - m->released >= MAPPED_RELEASE_BYTES) {
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t upTo = (m->pos - ENTRY_HEADER_BYTES - *len) / page * page;
+        if (upTo > m->released) {
+            madvise((void *)(m->base + m->released), upTo - m->released,
+                    MADV_DONTNEED);
+            m->released = upTo;
+        }
+    }
+    return true;
+}
+
+void kvidxUnmapFile(kvidxMappedFile *m) {
+    if (m->base) {
+        munmap((void *)m->base, m->size);
+    }
+    memset(m, 0, sizeof(*m));
+}
+
+/* ====================================================================
+ * File Descriptors
+ * ==================================================================== */
+
+typedef struct fdStream {
+    int fd;
+    int savedErrno;
+} fdStream;
+
+static bool fdWrite(const void *buf, size_t len, void *streamData) {
+    fdStream *s = streamData;
+    const uint8_t *p = buf;
+
+    while (len) {
+        ssize_t n = write(s->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            s->savedErrno = errno;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static int64_t fdRead(void *buf, size_t len, void *streamData) {
+    fdStream *s = streamData;
+
+    for (;;) {
+        ssize_t n = read(s->fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            s->savedErrno = errno;
+        }
+        return n;
+    }
+}
+
+kvidxError kvidxExportToFd(kvidxInstance *i, int fd,
+                           const kvidxExportOptions *options,
+                           kvidxProgressCallback callback, void *userData) {
+    if (!i || fd < 0) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    fdStream s = {.fd = fd};
+    kvidxError result =
+        kvidxExportToStream(i, fdWrite, &s, options, callback, userData);
+    if (s.savedErrno) {
+        kvidxSetError(i, result, "Failed to write to fd %d: %s", fd,
+                      strerror(s.savedErrno));
+    }
+    return result;
+}
+
+kvidxError kvidxExportToFile(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file for writing: %s",
+                      filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxError result = kvidxExportToFd(i, fd, options, callback, userData);
+    if (close(fd) != 0 && result == KVIDX_OK) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to close file: %s", filename);
+        result = KVIDX_ERROR_IO;
+    }
+    return result;
+}
+
+kvidxError kvidxImportFromFd(kvidxInstance *i, int fd,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData) {
+    if (!i || fd < 0) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    fdStream s = {.fd = fd};
+    kvidxError result =
+        kvidxImportFromStream(i, fdRead, &s, options, callback, userData);
+    if (s.savedErrno) {
+        kvidxSetError(i, result, "Failed to read from fd %d: %s", fd,
+                      strerror(s.savedErrno));
+    }
+    return result;
+}
+
+kvidxError kvidxImportFromFile(kvidxInstance *i, const char *filename,
+                               const kvidxImportOptions *options,
+                               kvidxProgressCallback callback, void *userData) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file: %s", filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    kvidxError result = kvidxImportFromFd(i, fd, options, callback, userData);
+    close(fd);
+    return result;
+}
+
+/* ====================================================================
+ * Incremental Export
+ * ==================================================================== */
+
+typedef struct incrementalExport {
+    streamWriter *w;
+    const kvidxExportOptions *options;
+    kvidxExportToken *token;
+    kvidxProgressCallback callback;
+    void *userData;
+    uint64_t scanned;
+    bool cancelled;
+} incrementalExport;
+
+/* Scan visitor: write entries the pass selects, track the high-water marks */
+static bool incrementalVisit(void *ctx, uint64_t key, uint64_t term,
+                             uint64_t cmd, const uint8_t *data, size_t len) {
+    incrementalExport *e = ctx;
+    kvidxExportToken *t = e->token;
+
+    if (key >= t->sinceKey || term >= t->sinceTerm) {
+        writeEntry(e->w, e->options, t->entries == 0, key, term, cmd, data,
+                   len);
+        t->entries++;
+    }
+
+    /* Saturate: a key or term of UINT64_MAX is simply exported again */
+    t->nextKey = key == UINT64_MAX ? key : key + 1;
+    if (t->nextKey > t->newKey) {
+        t->newKey = t->nextKey;
+    }
+    if (term >= t->newTerm) {
+        t->newTerm = term == UINT64_MAX ? term : term + 1;
+    }
+    e->scanned++;
+
+    /* Progress callback */
+    if (e->callback && e->scanned % 100 == 0 &&
+        !e->callback(e->scanned, 0, e->userData)) {
+        e->cancelled = true;
+        return false;
+    }
+
+    return !e->w->failed;
+}
+
+static bool pwriteAll(int fd, const void *buf, size_t len, off_t offset) {
+    const uint8_t *p = buf;
+    while (len) {
+        ssize_t n = pwrite(fd, p, len, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * Write the pass described by pass, scanning from scanFrom, to filename.
+ */
+static kvidxError exportIncremental(kvidxInstance *i, const char *filename,
+                                    const kvidxExportOptions *options,
+                                    const kvidxExportToken *pass,
+                                    uint64_t scanFrom, kvidxExportToken *token,
+                                    kvidxProgressCallback callback,
+                                    void *userData) {
+    kvidxExportToken t = *pass;
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        kvidxSetError(i, KVIDX_ERROR_IO, "Failed to open file for writing: %s",
+                      filename);
+        return KVIDX_ERROR_IO;
+    }
+
+    fdStream s = {.fd = fd};
+    streamWriter w = {
+        .buf = streamBufferNew(), .write = fdWrite, .streamData = &s};
+    if (!w.buf) {
+        close(fd);
+        kvidxSetError(i, KVIDX_ERROR_NOMEM, "Failed to allocate stream buffer");
+        return KVIDX_ERROR_NOMEM;
+    }
+
+    /* Header and token are written once the scan has filled them in; a
+     * zeroed header keeps an unfinished file from importing */
+    const uint8_t placeholder[sizeof(kvidxBinaryHeader) +
+                              sizeof(incrementalToken)] = {0};
+    writerPut(&w, placeholder, sizeof(placeholder));
+
+    incrementalExport e = {.w = &w,
+                           .options = options,
+                           .token = &t,
+                           .callback = callback,
+                           .userData = userData};
+    kvidxError result = KVIDX_OK;
+    t.nextKey = scanFrom;
+    if (scanFrom <= t.endKey) {
+        result = kvidxScanRange(i, scanFrom, t.endKey, incrementalVisit, &e);
+    }
+    t.complete = result == KVIDX_OK && !e.cancelled;
+    writerFlush(&w);
+    free(w.buf);
+
+    if (result == KVIDX_OK && w.failed) {
+        result = KVIDX_ERROR_IO;
+    }
+
+    if (result == KVIDX_OK) {
+        kvidxBinaryHeader header = {
+            .magic = KVIDX_BINARY_MAGIC,
+            .version = KVIDX_BINARY_VERSION_INCREMENTAL,
+            .reserved = 0,
+            .entryCount = t.entries};
+        incrementalToken stored = {.startKey = t.startKey,
+                                   .endKey = t.endKey,
+                                   .sinceKey = t.sinceKey,
+                                   .sinceTerm = t.sinceTerm,
+                                   .nextKey = t.nextKey,
+                                   .newKey = t.newKey,
+                                   .newTerm = t.newTerm,
+                                   .entries = t.entries,
+                                   .flags = t.complete ? INCREMENTAL_COMPLETE
+                                                       : 0};
+        if (!pwriteAll(fd, &header, sizeof(header), 0) ||
+            !pwriteAll(fd, &stored, sizeof(stored), sizeof(header))) {
+            s.savedErrno = errno;
+            result = KVIDX_ERROR_IO;
+        }
+    }
+    if (close(fd) != 0 && result == KVIDX_OK) {
+        s.savedErrno = errno;
+        result = KVIDX_ERROR_IO;
+    }
+
+    if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "Incremental export failed after %" PRIu64
+                                 " entries%s%s",
+                      t.entries, s.savedErrno ? ": " : "",
+                      s.savedErrno ? strerror(s.savedErrno) : "");
+        return result;
+    }
+
+    if (token) {
+        *token = t;
+    }
+
+    /* Final progress callback */
+    if (callback && e.scanned > 0 && !e.cancelled) {
+        callback(e.scanned, e.scanned, userData);
+    }
+
+    if (e.cancelled) {
+        kvidxSetError(i, KVIDX_ERROR_CANCELLED,
+                      "Incremental export cancelled before key %" PRIu64,
+                      t.nextKey);
+        return KVIDX_ERROR_CANCELLED;
+    }
+    return KVIDX_OK;
+}
+
+kvidxError kvidxExportIncremental(kvidxInstance *i, const char *filename,
+                                  const kvidxExportOptions *options,
+                                  const kvidxExportToken *since,
+                                  kvidxExportToken *token,
+                                  kvidxProgressCallback callback,
+                                  void *userData) {
+    if (!i || !filename) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Use default options if not provided */
+    kvidxExportOptions defaultOptions;
+    if (!options) {
+        defaultOptions = kvidxExportOptionsDefault();
+        options = &defaultOptions;
+    }
+
+    if (options->format != KVIDX_EXPORT_BINARY) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Incremental exports are binary only");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    /* Work out this pass and where it starts scanning */
+    kvidxExportToken t = {0};
+    uint64_t scanFrom;
+    if (!since) {
+        t.startKey = options->startKey;
+        t.endKey = options->endKey;
+        t.sinceKey = t.startKey;
+        t.newKey = t.startKey;
+        scanFrom = t.startKey;
+    } else if (!since->complete) {
+        t = *since;
+        scanFrom = since->nextKey;
+    } else {
+        t = *since;
+        t.sinceKey = since->newKey;
+        t.sinceTerm = since->newTerm;
+        scanFrom = options->appendOnly ? t.sinceKey : t.startKey;
+    }
+    t.entries = 0;
+    t.complete = false;
+
+    if (t.startKey > t.endKey) {
+        kvidxSetError(i, KVIDX_ERROR_INVALID_ARGUMENT,
+                      "Export range start is past its end");
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const kvidxMetricsSpan span = kvidxMetricsStartKeys(
+        i, KVIDX_OP_EXPORT_INCREMENTAL, scanFrom, t.endKey, 0);
+    const kvidxError result = exportIncremental(i, filename, options, &t,
+                                                scanFrom, token, callback,
+                                                userData);
+    kvidxMetricsRecord(i, &span, 0);
+    return result;
+}
+
+kvidxError kvidxReadExportToken(const char *filename, kvidxExportToken *token) {
+    if (!filename || !token) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return KVIDX_ERROR_IO;
+    }
+
+    struct {
+        kvidxBinaryHeader header;
+        incrementalToken token;
+    } head;
+    const ssize_t n = pread(fd, &head, sizeof(head), 0);
+    close(fd);
+
+    if (n != (ssize_t)sizeof(head) ||
+        head.header.magic != KVIDX_BINARY_MAGIC ||
+        head.header.version != KVIDX_BINARY_VERSION_INCREMENTAL) {
+        return KVIDX_ERROR_INVALID_ARGUMENT;
+    }
+
+    const incrementalToken *stored = &head.token;
+    *token = (kvidxExportToken){
+        .startKey = stored->startKey,
+        .endKey = stored->endKey,
+        .sinceKey = stored->sinceKey,
+        .sinceTerm = stored->sinceTerm,
+        .nextKey = stored->nextKey,
+        .newKey = stored->newKey,
+        .newTerm = stored->newTerm,
+        .entries = stored->entries,
+        .complete = (stored->flags & INCREMENTAL_COMPLETE) != 0};
+    return KVIDX_OK;
+}
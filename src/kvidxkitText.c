@@ -0,0 +1,1010 @@
+/**
+ * JSON and CSV for kvidxkit
+ *
+ * Scanning for the text formats finds the next byte that needs escaping
+ * (export) or ends a plain run (import) 32 bytes at a time with AVX2 when
+ * the CPU has it (checked once at run time), 16 at a time with SSE2, and
+ * through a byte-class table otherwise. Callers copy the clean runs in one
+ * piece.
+ *
+ * Also implements JSON and CSV import. The file is memory-mapped and
+ * parsed in place: values without escapes are inserted straight from the
+ * mapping, others are unescaped into a reusable buffer. Entries go through
+ * the public API, so every adapter can import text.
+ *
+ * Accepted input:
+ *   JSON  {"entries":[{"key":1,"term":2,"cmd":3,"data":"..."}, ...]} as
+ *         written by kvidxExport(), or a bare array of entry objects.
+ *         Other members are skipped; numbers may also be quoted strings.
+ *   CSV   RFC 4180 records. A header row names the key, term, cmd and data
+ *         columns in any order; without one, 2 columns are key,data and
+ *         4 are key,term,cmd,data.
+ */
+
+#include "kvidxkit.h"
+#include "kvidxkit_internal.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_HAS_SSE2 1
+#include <immintrin.h>
+#endif
+
+/* Binary format magic number: "KVIDX\0\0\0" */
+#define KVIDX_BINARY_MAGIC 0x5844495645564B00ULL
+
+/* ====================================================================
+ * Scanning
+ * ==================================================================== */
+
+/* textClass[c]: bit (1 << kvidxTextClass) set if c ends a plain run */
+static uint8_t textClass[256];
+static pthread_once_t textOnce = PTHREAD_ONCE_INIT;
+
+typedef size_t (*textSpanFn)(const uint8_t *p, size_t len);
+static textSpanFn textSpan[3];
+
+static inline size_t spanTable(const uint8_t *p, size_t len,
+                               kvidxTextClass cls) {
+    const uint8_t bit = (uint8_t)(1 << cls);
+    size_t n = 0;
+    while (n < len && !(textClass[p[n]] & bit)) {
+        n++;
+    }
+    return n;
+}
+
+static size_t jsonEscapeTable(const uint8_t *p, size_t len) {
+    return spanTable(p, len, KVIDX_TEXT_JSON_ESCAPE);
+}
+
+static size_t jsonStringTable(const uint8_t *p, size_t len) {
+    return spanTable(p, len, KVIDX_TEXT_JSON_STRING);
+}
+
+static size_t csvSpecialTable(const uint8_t *p, size_t len) {
+    return spanTable(p, len, KVIDX_TEXT_CSV_SPECIAL);
+}
+
+#if defined(TEXT_HAS_SSE2)
+/* Lanes of x holding a byte that ends a plain run of class cls */
+static inline __m128i specialSse2(__m128i x, kvidxTextClass cls) {
+    __m128i m = _mm_cmpeq_epi8(x, _mm_set1_epi8('"'));
+    switch (cls) {
+    case KVIDX_TEXT_JSON_ESCAPE: {
+        /* x <= 0x1F as unsigned: max(x, 0x1F) == 0x1F */
+        const __m128i ctl = _mm_set1_epi8(0x1F);
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(0x7F)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_max_epu8(x, ctl), ctl));
+        break;
+    }
+    case KVIDX_TEXT_JSON_STRING:
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\\')));
+        break;
+    case KVIDX_TEXT_CSV_SPECIAL:
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8(',')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\n')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(x, _mm_set1_epi8('\r')));
+        break;
+    }
+    return m;
+}
+
+static inline size_t spanSse2(const uint8_t *p, size_t len,
+                              kvidxTextClass cls) {
+    size_t n = 0;
+    for (; n + 16 <= len; n += 16) {
+        const __m128i x = _mm_loadu_si128((const __m128i *)(p + n));
+        const unsigned mask = (unsigned)_mm_movemask_epi8(specialSse2(x, cls));
+        if (mask) {
+            return n + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return n + spanTable(p + n, len - n, cls);
+}
+
+static size_t jsonEscapeSse2(const uint8_t *p, size_t len) {
+    return spanSse2(p, len, KVIDX_TEXT_JSON_ESCAPE);
+}
+
+static size_t jsonStringSse2(const uint8_t *p, size_t len) {
+    return spanSse2(p, len, KVIDX_TEXT_JSON_STRING);
+}
+
+static size_t csvSpecialSse2(const uint8_t *p, size_t len) {
+    return spanSse2(p, len, KVIDX_TEXT_CSV_SPECIAL);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+specialAvx2(__m256i x, kvidxTextClass cls) {
+    __m256i m = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'));
+    switch (cls) {
+    case KVIDX_TEXT_JSON_ESCAPE: {
+        const __m256i ctl = _mm256_set1_epi8(0x1F);
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(0x7F)));
+        m = _mm256_or_si256(m,
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(x, ctl), ctl));
+        break;
+    }
+    case KVIDX_TEXT_JSON_STRING:
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\')));
+        break;
+    case KVIDX_TEXT_CSV_SPECIAL:
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8(',')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\n')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(x, _mm256_set1_epi8('\r')));
+        break;
+    }
+    return m;
+}
+
+__attribute__((target("avx2"))) static inline size_t
+spanAvx2(const uint8_t *p, size_t len, kvidxTextClass cls) {
+    size_t n = 0;
+    for (; n + 32 <= len; n += 32) {
+        const __m256i x = _mm256_loadu_si256((const __m256i *)(p + n));
+        const unsigned mask =
+            (unsigned)_mm256_movemask_epi8(specialAvx2(x, cls));
+        if (mask) {
+            return n + (size_t)__builtin_ctz(mask);
+        }
+    }
+    return n + spanSse2(p + n, len - n, cls);
+}
+
+__attribute__((target("avx2"))) static size_t
+jsonEscapeAvx2(const uint8_t *p, size_t len) {
+    return spanAvx2(p, len, KVIDX_TEXT_JSON_ESCAPE);
+}
+
+__attribute__((target("avx2"))) static size_t
+jsonStringAvx2(const uint8_t *p, size_t len) {
+    return spanAvx2(p, len, KVIDX_TEXT_JSON_STRING);
+}
+
+__attribute__((target("avx2"))) static size_t
+csvSpecialAvx2(const uint8_t *p, size_t len) {
+    return spanAvx2(p, len, KVIDX_TEXT_CSV_SPECIAL);
+}
+#endif
+
+static void textInit(void) {
+    for (int c = 0; c < 256; c++) {
+        uint8_t bits = 0;
+        if (c == '"' || c == '\\' || c < 32 || c == 127) {
+            bits |= 1 << KVIDX_TEXT_JSON_ESCAPE;
+        }
+        if (c == '"' || c == '\\') {
+            bits |= 1 << KVIDX_TEXT_JSON_STRING;
+        }
+        if (c == '"' || c == ',' || c == '\n' || c == '\r') {
+            bits |= 1 << KVIDX_TEXT_CSV_SPECIAL;
+        }
+        textClass[c] = bits;
+    }
+
+    textSpan[KVIDX_TEXT_JSON_ESCAPE] = jsonEscapeTable;
+    textSpan[KVIDX_TEXT_JSON_STRING] = jsonStringTable;
+    textSpan[KVIDX_TEXT_CSV_SPECIAL] = csvSpecialTable;
+#if defined(TEXT_HAS_SSE2)
+    if (__builtin_cpu_supports("avx2")) {
+        textSpan[KVIDX_TEXT_JSON_ESCAPE] = jsonEscapeAvx2;
+        textSpan[KVIDX_TEXT_JSON_STRING] = jsonStringAvx2;
+        textSpan[KVIDX_TEXT_CSV_SPECIAL] = csvSpecialAvx2;
+    } else {
+        textSpan[KVIDX_TEXT_JSON_ESCAPE] = jsonEscapeSse2;
+        textSpan[KVIDX_TEXT_JSON_STRING] = jsonStringSse2;
+        textSpan[KVIDX_TEXT_CSV_SPECIAL] = csvSpecialSse2;
+    }
+#endif
+}
+
+size_t kvidxTextSpan(kvidxTextClass cls, const uint8_t *p, size_t len) {
+    pthread_once(&textOnce, textInit);
+    return textSpan[cls](p, len);
+}
+
+/* ====================================================================
+ * Parsing
+ * ==================================================================== */
+
+/* Nesting allowed in skipped JSON values */
+#define JSON_MAX_DEPTH 64
+
+/* Columns a CSV record may have */
+#define CSV_MAX_COLUMNS 16
+
+/* Growable buffer for unescaped values */
+typedef struct textBuffer {
+    uint8_t *buf;
+    size_t used;
+    size_t size;
+} textBuffer;
+
+static bool bufferAppend(textBuffer *b, const uint8_t *data, size_t len) {
+    /* An empty value leaves b->buf NULL; memcpy must not see it */
+    if (len == 0) {
+        return true;
+    }
+
+    if (len > b->size - b->used) {
+        size_t size = b->size ? b->size : 256;
+        while (size - b->used < len) {
+            size *= 2;
+        }
+        uint8_t *grown = realloc(b->buf, size);
+        if (!grown) {
+            return false;
+        }
+        b->buf = grown;
+        b->size = size;
+    }
+    memcpy(b->buf + b->used, data, len);
+    b->used += len;
+    return true;
+}
+
+/* A field or string value: points into the file or into a textBuffer */
+typedef struct textSlice {
+    const uint8_t *p;
+    size_t len;
+} textSlice;
+
+typedef struct textParser {
+    const uint8_t *base; /* Start of the file, for error offsets */
+    const uint8_t *p;    /* Next byte to parse */
+    const uint8_t *end;
+    const char *error; /* What was expected at p, once parsing fails */
+    bool outOfMemory;
+} textParser;
+
+static bool parseFail(textParser *t, const char *expected) {
+    if (!t->error) {
+        t->error = expected;
+    }
+    return false;
+}
+
+static bool parseDigits(textParser *t, const uint8_t *p, size_t len,
+                        uint64_t *value) {
+    if (len == 0) {
+        return parseFail(t, "an unsigned integer");
+    }
+
+    uint64_t v = 0;
+    for (size_t n = 0; n < len; n++) {
+        const unsigned digit = (unsigned)(p[n] - '0');
+        if (digit > 9 || v > (UINT64_MAX - digit) / 10) {
+            return parseFail(t, "an unsigned 64-bit integer");
+        }
+        v = v * 10 + digit;
+    }
+    *value = v;
+    return true;
+}
+
+/* ====================================================================
+ * JSON
+ * ==================================================================== */
+
+static void jsonSpace(textParser *t) {
+    while (t->p < t->end && (*t->p == ' ' || *t->p == '\n' ||
+                             *t->p == '\r' || *t->p == '\t')) {
+        t->p++;
+    }
+}
+
+static bool jsonExpect(textParser *t, uint8_t c, const char *expected) {
+    jsonSpace(t);
+    if (t->p >= t->end || *t->p != c) {
+        return parseFail(t, expected);
+    }
+    t->p++;
+    return true;
+}
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+static bool jsonHex4(textParser *t, uint32_t *unit) {
+    if (t->end - t->p < 4) {
+        return parseFail(t, "4 hex digits");
+    }
+    uint32_t v = 0;
+    for (int n = 0; n < 4; n++) {
+        const int h = hexValue(t->p[n]);
+        if (h < 0) {
+            return parseFail(t, "4 hex digits");
+        }
+        v = v << 4 | (uint32_t)h;
+    }
+    t->p += 4;
+    *unit = v;
+    return true;
+}
+
+/* Decode \uXXXX (t->p just past the 'u') into UTF-8 */
+static bool jsonUnicode(textParser *t, textBuffer *b) {
+    uint32_t cp;
+    if (!jsonHex4(t, &cp)) {
+        return false;
+    }
+
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+        uint32_t low;
+        if (t->end - t->p < 2 || t->p[0] != '\\' || t->p[1] != 'u') {
+            return parseFail(t, "a low surrogate");
+        }
+        t->p += 2;
+        if (!jsonHex4(t, &low) || low < 0xDC00 || low > 0xDFFF) {
+            return parseFail(t, "a low surrogate");
+        }
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        return parseFail(t, "a high surrogate before a low one");
+    }
+
+    uint8_t utf8[4];
+    size_t len;
+    if (cp < 0x80) {
+        utf8[0] = (uint8_t)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        utf8[0] = (uint8_t)(0xC0 | cp >> 6);
+        utf8[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        utf8[0] = (uint8_t)(0xE0 | cp >> 12);
+        utf8[1] = (uint8_t)(0x80 | (cp >> 6 & 0x3F));
+        utf8[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        utf8[0] = (uint8_t)(0xF0 | cp >> 18);
+        utf8[1] = (uint8_t)(0x80 | (cp >> 12 & 0x3F));
+        utf8[2] = (uint8_t)(0x80 | (cp >> 6 & 0x3F));
+        utf8[3] = (uint8_t)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    return bufferAppend(b, utf8, len) || (t->outOfMemory = true, false);
+}
+
+/**
+ * Parse a string. Without escapes *out points into the file; otherwise the
+ * string is unescaped into b (valid until b is next used).
+ */
+static bool jsonString(textParser *t, textBuffer *b, textSlice *out) {
+    if (!jsonExpect(t, '"', "a string")) {
+        return false;
+    }
+
+    size_t plain = kvidxTextSpan(KVIDX_TEXT_JSON_STRING, t->p,
+                                 (size_t)(t->end - t->p));
+    if (t->p + plain < t->end && t->p[plain] == '"') {
+        out->p = t->p;
+        out->len = plain;
+        t->p += plain + 1;
+        return true;
+    }
+
+    b->used = 0;
+    for (;;) {
+        if (!bufferAppend(b, t->p, plain)) {
+            t->outOfMemory = true;
+            return false;
+        }
+        t->p += plain;
+        if (t->end - t->p < 2) {
+            return parseFail(t, "the end of the string");
+        }
+        if (*t->p == '"') {
+            t->p++;
+            break;
+        }
+
+        /* Backslash */
+        uint8_t c = t->p[1];
+        t->p += 2;
+        switch (c) {
+        case 'b':
+            c = '\b';
+            break;
+        case 'f':
+            c = '\f';
+            break;
+        case 'n':
+            c = '\n';
+            break;
+        case 'r':
+            c = '\r';
+            break;
+        case 't':
+            c = '\t';
+            break;
+        case '"':
+        case '\\':
+        case '/':
+            break;
+        case 'u':
+            if (!jsonUnicode(t, b)) {
+                return false;
+            }
+            c = 0;
+            break;
+        default:
+            t->p--;
+            return parseFail(t, "a valid escape sequence");
+        }
+        if (c && !bufferAppend(b, &c, 1)) {
+            t->outOfMemory = true;
+            return false;
+        }
+
+        plain = kvidxTextSpan(KVIDX_TEXT_JSON_STRING, t->p,
+                              (size_t)(t->end - t->p));
+    }
+
+    out->p = b->buf;
+    out->len = b->used;
+    return true;
+}
+
+/* An unsigned integer, bare or quoted */
+static bool jsonUint(textParser *t, textBuffer *scratch, uint64_t *value) {
+    jsonSpace(t);
+    if (t->p < t->end && *t->p == '"') {
+        textSlice s;
+        return jsonString(t, scratch, &s) && parseDigits(t, s.p, s.len, value);
+    }
+
+    const uint8_t *start = t->p;
+    while (t->p < t->end && *t->p >= '0' && *t->p <= '9') {
+        t->p++;
+    }
+    if (!parseDigits(t, start, (size_t)(t->p - start), value)) {
+        t->p = start;
+        return false;
+    }
+    return true;
+}
+
+static bool jsonLiteral(textParser *t, const char *word) {
+    const size_t len = strlen(word);
+    if ((size_t)(t->end - t->p) < len || memcmp(t->p, word, len) != 0) {
+        return false;
+    }
+    t->p += len;
+    return true;
+}
+
+/* Skip any value (for members kvidx doesn't use) */
+static bool jsonSkip(textParser *t, textBuffer *scratch, int depth) {
+    jsonSpace(t);
+    if (t->p >= t->end) {
+        return parseFail(t, "a value");
+    }
+
+    textSlice s;
+    const uint8_t c = *t->p;
+    if (c == '"') {
+        return jsonString(t, scratch, &s);
+    }
+
+    if (c == '{' || c == '[') {
+        if (depth >= JSON_MAX_DEPTH) {
+            return parseFail(t, "less nesting");
+        }
+        const uint8_t close = c == '{' ? '}' : ']';
+        t->p++;
+        jsonSpace(t);
+        if (t->p < t->end && *t->p == close) {
+            t->p++;
+            return true;
+        }
+        for (;;) {
+            if (c == '{' && (!jsonString(t, scratch, &s) ||
+                             !jsonExpect(t, ':', "':'"))) {
+                return false;
+            }
+            if (!jsonSkip(t, scratch, depth + 1)) {
+                return false;
+            }
+            jsonSpace(t);
+            if (t->p < t->end && *t->p == ',') {
+                t->p++;
+                continue;
+            }
+            return jsonExpect(t, close, c == '{' ? "',' or '}'" : "',' or ']'");
+        }
+    }
+
+    if (jsonLiteral(t, "true") || jsonLiteral(t, "false") ||
+        jsonLiteral(t, "null")) {
+        return true;
+    }
+
+    /* Number */
+    const uint8_t *start = t->p;
+    while (t->p < t->end &&
+           ((*t->p >= '0' && *t->p <= '9') || *t->p == '-' || *t->p == '+' ||
+            *t->p == '.' || *t->p == 'e' || *t->p == 'E')) {
+        t->p++;
+    }
+    return t->p > start || parseFail(t, "a value");
+}
+
+static bool nameIs(const textSlice *name, const char *want) {
+    return name->len == strlen(want) && memcmp(name->p, want, name->len) == 0;
+}
+
+/* ====================================================================
+ * Import
+ * ==================================================================== */
+
+typedef struct textImport {
+    kvidxInstance *i;
+    const kvidxImportOptions *options;
+    kvidxProgressCallback callback;
+    void *userData;
+    textParser parser;
+    const uint8_t *txnStart; /* Input position of the open transaction */
+    uint64_t commitBytes;
+    uint64_t count;
+    kvidxError result;
+} textImport;
+
+/* Insert one parsed entry; false stops the import */
+static bool importEntry(textImport *im, uint64_t key, uint64_t term,
+                        uint64_t cmd, const textSlice *data) {
+    kvidxInstance *i = im->i;
+
+    /* Start a new transaction once this one has covered enough input */
+    if ((uint64_t)(im->parser.p - im->txnStart) >= im->commitBytes) {
+        if (!kvidxCommit(i) || !kvidxBegin(i)) {
+            im->result = KVIDX_ERROR_INTERNAL;
+            return false;
+        }
+        im->txnStart = im->parser.p;
+    }
+
+    if (!kvidxInsert(i, key, term, cmd, data->p, data->len)) {
+        if (im->options->skipDuplicates) {
+            /* Continue on duplicate key */
+            return true;
+        }
+        im->result = kvidxGetLastError(i) != KVIDX_OK ? kvidxGetLastError(i)
+                                                      : KVIDX_ERROR_INTERNAL;
+        return false;
+    }
+
+    im->count++;
+
+    /* Progress callback (the total isn't known up front) */
+    if (im->callback && im->count % 100 == 0 &&
+        !im->callback(im->count, 0, im->userData)) {
+        im->result = KVIDX_ERROR_CANCELLED;
+        return false;
+    }
+    return true;
+}
+
+static bool jsonEntry(textImport *im, textBuffer *name, textBuffer *value) {
+    textParser *t = &im->parser;
+    uint64_t key = 0, term = 0, cmd = 0;
+    textSlice data = {0};
+    bool haveKey = false;
+
+    if (!jsonExpect(t, '{', "an entry object")) {
+        return false;
+    }
+    jsonSpace(t);
+    if (t->p < t->end && *t->p == '}') {
+        return parseFail(t, "an entry with a \"key\"");
+    }
+
+    for (;;) {
+        textSlice member;
+        if (!jsonString(t, name, &member) || !jsonExpect(t, ':', "':'")) {
+            return false;
+        }
+
+        bool ok;
+        if (nameIs(&member, "key")) {
+            ok = jsonUint(t, name, &key);
+            haveKey = true;
+        } else if (nameIs(&member, "term")) {
+            ok = jsonUint(t, name, &term);
+        } else if (nameIs(&member, "cmd")) {
+            ok = jsonUint(t, name, &cmd);
+        } else if (nameIs(&member, "data")) {
+            jsonSpace(t);
+            if (jsonLiteral(t, "null")) {
+                data.len = 0;
+                ok = true;
+            } else {
+                ok = jsonString(t, value, &data);
+            }
+        } else {
+            ok = jsonSkip(t, name, 0);
+        }
+        if (!ok) {
+            return false;
+        }
+
+        jsonSpace(t);
+        if (t->p < t->end && *t->p == ',') {
+            t->p++;
+            continue;
+        }
+        if (!jsonExpect(t, '}', "',' or '}'")) {
+            return false;
+        }
+        break;
+    }
+
+    if (!haveKey) {
+        return parseFail(t, "an entry with a \"key\"");
+    }
+    return importEntry(im, key, term, cmd, &data);
+}
+
+static bool jsonEntries(textImport *im, textBuffer *name, textBuffer *value) {
+    textParser *t = &im->parser;
+    if (!jsonExpect(t, '[', "an entries array")) {
+        return false;
+    }
+
+    jsonSpace(t);
+    if (t->p < t->end && *t->p == ']') {
+        t->p++;
+        return true;
+    }
+
+    for (;;) {
+        if (!jsonEntry(im, name, value)) {
+            return false;
+        }
+        jsonSpace(t);
+        if (t->p < t->end && *t->p == ',') {
+            t->p++;
+            continue;
+        }
+        return jsonExpect(t, ']', "',' or ']'");
+    }
+}
+
+static bool importJson(textImport *im, textBuffer *name, textBuffer *value) {
+    textParser *t = &im->parser;
+    jsonSpace(t);
+
+    /* A bare array of entries */
+    if (t->p < t->end && *t->p == '[') {
+        if (!jsonEntries(im, name, value)) {
+            return false;
+        }
+    } else {
+        bool haveEntries = false;
+        if (!jsonExpect(t, '{', "'{' or '['")) {
+            return false;
+        }
+        jsonSpace(t);
+        while (t->p < t->end && *t->p != '}') {
+            textSlice member;
+            if (!jsonString(t, name, &member) ||
+                !jsonExpect(t, ':', "':'")) {
+                return false;
+            }
+
+            if (nameIs(&member, "entries")) {
+                if (!jsonEntries(im, name, value)) {
+                    return false;
+                }
+                haveEntries = true;
+            } else if (!jsonSkip(t, name, 0)) {
+                return false;
+            }
+
+            jsonSpace(t);
+            if (t->p < t->end && *t->p == ',') {
+                t->p++;
+                jsonSpace(t);
+            } else {
+                break;
+            }
+        }
+        if (!jsonExpect(t, '}', "',' or '}'")) {
+            return false;
+        }
+        if (!haveEntries) {
+            return parseFail(t, "an \"entries\" member");
+        }
+    }
+
+    jsonSpace(t);
+    return t->p == t->end || parseFail(t, "the end of the document");
+}
+
+/* ====================================================================
+ * CSV
+ * ==================================================================== */
+
+enum { CSV_KEY, CSV_TERM, CSV_CMD, CSV_DATA, CSV_FIELDS };
+
+/**
+ * Parse one field. Unquoted fields and quoted fields without doubled
+ * quotes point into the file; others are unescaped into b.
+ */
+static bool csvField(textParser *t, textBuffer *b, textSlice *out) {
+    if (t->p >= t->end || *t->p != '"') {
+        /* Unquoted: runs to a comma or line break; stray quotes are data */
+        const uint8_t *start = t->p;
+        for (;;) {
+            t->p += kvidxTextSpan(KVIDX_TEXT_CSV_SPECIAL, t->p,
+                                  (size_t)(t->end - t->p));
+            if (t->p < t->end && *t->p == '"') {
+                t->p++;
+                continue;
+            }
+            break;
+        }
+        out->p = start;
+        out->len = (size_t)(t->p - start);
+        return true;
+    }
+
+    t->p++;
+    const uint8_t *start = t->p;
+    const uint8_t *quote = memchr(t->p, '"', (size_t)(t->end - t->p));
+    if (quote && (quote + 1 == t->end || quote[1] != '"')) {
+        out->p = start;
+        out->len = (size_t)(quote - start);
+        t->p = quote + 1;
+        return true;
+    }
+
+    b->used = 0;
+    while (quote) {
+        if (!bufferAppend(b, t->p, (size_t)(quote - t->p) + 1)) {
+            t->outOfMemory = true;
+            return false;
+        }
+        t->p = quote + 2;
+        quote = memchr(t->p, '"', (size_t)(t->end - t->p));
+        if (quote && (quote + 1 == t->end || quote[1] != '"')) {
+            if (!bufferAppend(b, t->p, (size_t)(quote - t->p))) {
+                t->outOfMemory = true;
+                return false;
+            }
+            out->p = b->buf;
+            out->len = b->used;
+            t->p = quote + 1;
+            return true;
+        }
+    }
+    return parseFail(t, "a closing quote");
+}
+
+/* Parse a record into fields; false at the end of the file */
+static bool csvRecord(textParser *t, textBuffer *buffers, textSlice *fields,
+                      size_t *count) {
+    /* Skip blank lines */
+    while (t->p < t->end && (*t->p == '\n' || *t->p == '\r')) {
+        t->p++;
+    }
+    if (t->p >= t->end) {
+        return false;
+    }
+
+    size_t n = 0;
+    for (;;) {
+        if (n == CSV_MAX_COLUMNS) {
+            return parseFail(t, "at most 16 columns");
+        }
+        if (!csvField(t, &buffers[n], &fields[n])) {
+            return false;
+        }
+        n++;
+
+        if (t->p < t->end && *t->p == ',') {
+            t->p++;
+            continue;
+        }
+        if (t->p < t->end && *t->p == '\r') {
+            t->p++;
+        }
+        if (t->p < t->end && *t->p != '\n') {
+            return parseFail(t, "',' or the end of the line");
+        }
+        if (t->p < t->end) {
+            t->p++;
+        }
+        break;
+    }
+
+    *count = n;
+    return true;
+}
+
+static bool importCsv(textImport *im, textBuffer *buffers) {
+    textParser *t = &im->parser;
+    textSlice fields[CSV_MAX_COLUMNS];
+    size_t count;
+
+    if (!csvRecord(t, buffers, fields, &count)) {
+        return t->error == NULL && !t->outOfMemory;
+    }
+
+    /* Column of each kvidx field, or -1 */
+    int column[CSV_FIELDS] = {-1, -1, -1, -1};
+    bool header = fields[0].len == 0 || fields[0].p[0] < '0' ||
+                  fields[0].p[0] > '9';
+    if (header) {
+        static const char *names[CSV_FIELDS] = {"key", "term", "cmd", "data"};
+        for (size_t c = 0; c < count; c++) {
+            for (int f = 0; f < CSV_FIELDS; f++) {
+                if (nameIs(&fields[c], names[f])) {
+                    column[f] = (int)c;
+                }
+            }
+        }
+        if (column[CSV_KEY] < 0) {
+            return parseFail(t, "a \"key\" column in the header");
+        }
+    } else if (count == 2) {
+        column[CSV_KEY] = 0;
+        column[CSV_DATA] = 1;
+    } else if (count == 4) {
+        column[CSV_KEY] = 0;
+        column[CSV_TERM] = 1;
+        column[CSV_CMD] = 2;
+        column[CSV_DATA] = 3;
+    } else {
+        return parseFail(t, "a header row, or 2 or 4 columns");
+    }
+
+    const size_t needed = (size_t)column[CSV_KEY] + 1;
+    for (bool have = !header; have || csvRecord(t, buffers, fields, &count);
+         have = false) {
+        if (count < needed) {
+            return parseFail(t, "a key in every record");
+        }
+
+        uint64_t values[3] = {0, 0, 0};
+        for (int f = CSV_KEY; f <= CSV_CMD; f++) {
+            const int c = column[f];
+            if (c >= 0 && (size_t)c < count &&
+                !parseDigits(t, fields[c].p, fields[c].len, &values[f])) {
+                return false;
+            }
+        }
+
+        textSlice data = {0};
+        if (column[CSV_DATA] >= 0 && (size_t)column[CSV_DATA] < count) {
+            data = fields[column[CSV_DATA]];
+        }
+        if (!importEntry(im, values[CSV_KEY], values[CSV_TERM],
+                         values[CSV_CMD], &data)) {
+            return false;
+        }
+    }
+    return t->error == NULL && !t->outOfMemory;
+}
+
+kvidxError kvidxImportText(kvidxInstance *i, const char *filename,
+                           const kvidxImportOptions *options,
+                           kvidxProgressCallback callback, void *userData) {
+    kvidxMappedFile m;
+    kvidxError result = kvidxMapFile(i, filename, &m);
+    if (result != KVIDX_OK) {
+        return result;
+    }
+
+    textImport im = {.i = i,
+                     .options = options,
+                     .callback = callback,
+                     .userData = userData,
+                     .parser = {.base = m.base,
+                                .p = m.base,
+                                .end = m.base + m.size},
+                     .commitBytes = kvidxImportCommitBytes(options),
+                     .result = KVIDX_OK};
+    textParser *t = &im.parser;
+
+    /* Skip a UTF-8 byte order mark */
+    if (m.size >= 3 && memcmp(m.base, "\xEF\xBB\xBF", 3) == 0) {
+        t->p += 3;
+    }
+
+    /* BINARY means auto-detect */
+    kvidxExportFormat format = options->format;
+    if (format == KVIDX_EXPORT_BINARY) {
+        jsonSpace(t);
+        format = t->p < t->end && (*t->p == '{' || *t->p == '[')
+                     ? KVIDX_EXPORT_JSON
+                     : KVIDX_EXPORT_CSV;
+    }
+
+    if (!kvidxBegin(i)) {
+        kvidxUnmapFile(&m);
+        kvidxSetError(i, KVIDX_ERROR_INTERNAL, "Failed to begin transaction");
+        return KVIDX_ERROR_INTERNAL;
+    }
+    im.txnStart = t->p;
+
+    /* Clear inside the transaction so a failure before the first commit
+     * keeps the old data */
+    if (options->clearBeforeImport) {
+        im.result = kvidxRemoveRange(i, 0, UINT64_MAX, true, true, NULL);
+    }
+
+    textBuffer buffers[CSV_MAX_COLUMNS] = {{0}};
+    bool parsed = false;
+    if (im.result == KVIDX_OK) {
+        parsed = format == KVIDX_EXPORT_JSON
+                     ? importJson(&im, &buffers[0], &buffers[1])
+                     : importCsv(&im, buffers);
+    }
+    for (size_t n = 0; n < CSV_MAX_COLUMNS; n++) {
+        free(buffers[n].buf);
+    }
+
+    if (im.result == KVIDX_OK && !parsed) {
+        im.result = t->outOfMemory ? KVIDX_ERROR_NOMEM : KVIDX_ERROR_CORRUPT;
+    }
+    result = im.result;
+
+    if (result == KVIDX_OK && !kvidxCommit(i)) {
+        result = KVIDX_ERROR_INTERNAL;
+    } else if (result != KVIDX_OK) {
+        kvidxAbort(i);
+    }
+
+    /* Final progress callback */
+    if (result == KVIDX_OK && callback && im.count > 0) {
+        callback(im.count, im.count, userData);
+    }
+
+    const size_t offset = (size_t)(t->p - t->base);
+    kvidxUnmapFile(&m);
+
+    const char *formatName = format == KVIDX_EXPORT_JSON ? "JSON" : "CSV";
+    if (result == KVIDX_ERROR_CORRUPT && t->error) {
+        kvidxSetError(i, result,
+                      "Malformed %s at byte %zu: expected %s (after %" PRIu64
+                      " entries)",
+                      formatName, offset, t->error, im.count);
+    } else if (result != KVIDX_OK) {
+        kvidxSetError(i, result, "%s import failed after %" PRIu64 " entries",
+                      formatName, im.count);
+    }
+    return result;
+}
+
+bool kvidxIsTextExport(const char *filename) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return false;
+    }
+
+    /* Binary exports start with the magic, whose first byte is NUL */
+    uint8_t head[sizeof(uint64_t)];
+    const size_t len = fread(head, 1, sizeof(head), fp);
+    fclose(fp);
+
+    uint64_t magic = 0;
+    if (len == sizeof(magic)) {
+        memcpy(&magic, head, sizeof(magic));
+    }
+    return len > 0 && head[0] != 0 && magic != KVIDX_BINARY_MAGIC;
+}
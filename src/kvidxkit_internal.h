@@ -1,6 +1,7 @@
 #pragma once
 
 #include "kvidxkit.h"
+#include "kvidxkitProbes.h"
 
 /**
  * Internal helper function to set error on instance
@@ -30,3 +31,578 @@ void kvidxSetError(kvidxInstance *i, kvidxError err, const char *fmt, ...);
         kvidxSetError((inst), KVIDX_OK, NULL);                                 \
         return true;                                                           \
     } while (0)
+
+/**
+ * Visit [startKey, endKey] in key order through interface.scanRange, or
+ * Get()/GetNext() when the adapter has no scan.
+ */
+kvidxError kvidxScanRange(kvidxInstance *i, uint64_t startKey,
+                          uint64_t endKey, kvidxScanVisitor visit, void *ctx);
+
+/* ====================================================================
+ * Block-Layout Export/Import (kvidxkitBlocks.c)
+ * ==================================================================== */
+
+/**
+ * Export [startKey, endKey] to filename in the BLOCKS binary layout
+ * (KVIDX_BINARY_VERSION_BLOCKS) using options->threads workers.
+ */
+kvidxError kvidxExportBlocks(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+
+/**
+ * Import a BLOCKS layout file, reading and verifying blocks on
+ * options->threads workers while this thread inserts them in key order.
+ */
+kvidxError kvidxImportBlocks(kvidxInstance *i, const char *filename,
+                             const kvidxImportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+
+/**
+ * Check whether filename starts with a BLOCKS layout header.
+ */
+bool kvidxIsBlockExport(const char *filename);
+
+/* ====================================================================
+ * Mapped Import Files (kvidxkitStream.c)
+ * ==================================================================== */
+
+/**
+ * A binary export mapped read-only for import. Entries are parsed in place
+ * and their data handed to the insert path without copying.
+ */
+typedef struct kvidxMappedFile {
+    const uint8_t *base;
+    size_t size;
+    size_t pos;      /* Next byte to parse */
+    size_t released; /* Bytes before this were dropped from memory */
+} kvidxMappedFile;
+
+/**
+ * Map filename for sequential reading.
+ */
+kvidxError kvidxMapFile(kvidxInstance *i, const char *filename,
+                        kvidxMappedFile *m);
+
+/**
+ * Copy the next len bytes to dst; false if the file is too short.
+ */
+bool kvidxMappedRead(kvidxMappedFile *m, void *dst, size_t len);
+
+/**
+ * Parse the next stream-layout entry. *data points into the mapping and
+ * stays valid until kvidxUnmapFile(). False if the entry is truncated.
+ */
+bool kvidxMappedEntry(kvidxMappedFile *m, uint64_t *key, uint64_t *term,
+                      uint64_t *cmd, const uint8_t **data, size_t *len);
+
+void kvidxUnmapFile(kvidxMappedFile *m);
+
+/**
+ * Bytes of entries an import writes per transaction
+ * (options->commitBytes, 0 = KVIDX_IMPORT_COMMIT_BYTES).
+ */
+static inline uint64_t
+kvidxImportCommitBytes(const kvidxImportOptions *options) {
+    return options->commitBytes ? options->commitBytes
+                                : KVIDX_IMPORT_COMMIT_BYTES;
+}
+
+/**
+ * Export to filename (created or truncated) through kvidxExportToFd().
+ */
+kvidxError kvidxExportToFile(kvidxInstance *i, const char *filename,
+                             const kvidxExportOptions *options,
+                             kvidxProgressCallback callback, void *userData);
+
+/**
+ * Import filename through kvidxImportFromFd().
+ */
+kvidxError kvidxImportFromFile(kvidxInstance *i, const char *filename,
+                               const kvidxImportOptions *options,
+                               kvidxProgressCallback callback, void *userData);
+
+/**
+ * Threads to use for work that splits into at most `work` pieces:
+ * requested (0 = one per CPU), capped at 16.
+ */
+uint32_t kvidxWorkerCount(uint32_t requested, uint64_t work);
+
+/* ====================================================================
+ * JSON and CSV (kvidxkitText.c)
+ * ==================================================================== */
+
+/**
+ * Byte classes for kvidxTextSpan()
+ */
+typedef enum kvidxTextClass {
+    KVIDX_TEXT_JSON_ESCAPE, /* Escaped in JSON output: " \ 0x00-0x1F 0x7F */
+    KVIDX_TEXT_JSON_STRING, /* Ends a plain run in a JSON string: " \ */
+    KVIDX_TEXT_CSV_SPECIAL  /* Forces CSV quoting: , " CR LF */
+} kvidxTextClass;
+
+/**
+ * Length of the longest prefix of p[0..len) with no byte of class cls
+ * (len if there is none). Uses SSE2 or AVX2 when available.
+ */
+size_t kvidxTextSpan(kvidxTextClass cls, const uint8_t *p, size_t len);
+
+/**
+ * Import a JSON or CSV file (options->format, or detected from the first
+ * byte when it is BINARY).
+ */
+kvidxError kvidxImportText(kvidxInstance *i, const char *filename,
+                           const kvidxImportOptions *options,
+                           kvidxProgressCallback callback, void *userData);
+
+/**
+ * Check whether filename is non-empty and does not start with the binary
+ * export magic.
+ */
+bool kvidxIsTextExport(const char *filename);
+
+/* ====================================================================
+ * Checksums (kvidxkitChecksum.c)
+ * ==================================================================== */
+
+/**
+ * CRC32C (Castagnoli) of len bytes, continuing from crc.
+ * Pass 0 to start; the result can be passed back to checksum more data.
+ */
+uint32_t kvidxCrc32c(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * Checksum stored with a value: CRC32C of term, cmd (native byte order)
+ * and data.
+ */
+uint32_t kvidxValueChecksum(uint64_t term, uint64_t cmd, const void *data,
+                            size_t len);
+
+/* ====================================================================
+ * Storage Replication (kvidxkitReplication.c)
+ * ==================================================================== */
+
+/* Format name of a replication stream carrying a binary export */
+#define KVIDX_REPLICATION_EXPORT "export"
+
+/**
+ * Writes a replication stream: a header, then files sent in
+ * KVIDX_STREAM_BUFFER_BYTES chunks. Once a write fails, later calls do
+ * nothing and failed stays set.
+ */
+typedef struct kvidxReplicationSender {
+    kvidxStreamWriteCallback write;
+    void *streamData;
+    uint8_t *buf;
+    bool failed;
+} kvidxReplicationSender;
+
+/**
+ * Start a stream of native files in format (e.g. "sqlite3"). End it with
+ * kvidxReplicationSendEnd() even on failure, to release the buffer.
+ */
+bool kvidxReplicationSendBegin(kvidxReplicationSender *s,
+                               kvidxStreamWriteCallback write,
+                               void *streamData, const char *format);
+
+/**
+ * Send everything read from fd until EOF as the file name (no '/').
+ */
+bool kvidxReplicationSendFd(kvidxReplicationSender *s, const char *name,
+                            int fd);
+
+/**
+ * Send the file at path as name.
+ */
+bool kvidxReplicationSendFile(kvidxReplicationSender *s, const char *name,
+                              const char *path);
+
+/**
+ * Send every regular file in dir under its own name.
+ */
+bool kvidxReplicationSendDir(kvidxReplicationSender *s, const char *dir);
+
+/**
+ * Finish the stream and release its buffer.
+ */
+bool kvidxReplicationSendEnd(kvidxReplicationSender *s);
+
+/**
+ * Read a stream in format into files in dir, checking every file's
+ * checksum and syncing it to disk. Fails unless the stream held the file
+ * named required.
+ */
+kvidxError kvidxReplicationReceiveFiles(kvidxInstance *i,
+                                        kvidxStreamReadCallback read,
+                                        void *streamData, const char *format,
+                                        const char *dir, const char *required);
+
+/**
+ * Create an empty directory next to path (malloc'd name, NULL on failure).
+ */
+char *kvidxReplicationTempDir(const char *path);
+
+/**
+ * Remove dir and everything in it.
+ */
+void kvidxReplicationRemoveDir(const char *dir);
+
+/**
+ * fsync the directory containing path, making a rename into it durable.
+ */
+bool kvidxReplicationSyncDir(const char *path);
+
+/**
+ * Replace the closed instance's storage at target (a file or directory)
+ * with staged, then reopen i on filename. If the reopen fails, the old
+ * storage is renamed back and reopened; if that fails too, every later
+ * call on i returns an error. Errors are reported on i.
+ */
+kvidxError kvidxReplicationInstall(kvidxInstance *i, const char *staged,
+                                   const char *target, const char *filename);
+
+/**
+ * Import a binary export stream into new storage for i's adapter at
+ * dir/name (or dir itself if name is NULL), then sync everything under dir.
+ * Errors are reported on i.
+ */
+kvidxError kvidxReplicationBuild(kvidxInstance *i, const char *dir,
+                                 const char *name, kvidxStreamReadCallback read,
+                                 void *streamData);
+
+/* ====================================================================
+ * Change Feed (kvidxkitChangeFeed.c)
+ * ==================================================================== */
+
+/**
+ * Writes are recorded as pending changes by the public wrappers and
+ * published to subscribers when they commit. Everything here runs on the
+ * writing thread and does nothing while i->changes is NULL.
+ */
+typedef struct kvidxChangeFeed kvidxChangeFeed;
+
+/**
+ * True while at least one subscription is attached.
+ */
+bool kvidxChangeActive(const kvidxInstance *i);
+
+/**
+ * Add a change to the pending batch (data is copied).
+ */
+void kvidxChangeRecord(kvidxInstance *i, kvidxChangeType type, uint64_t key,
+                       uint64_t endKey, uint64_t term, uint64_t cmd,
+                       const void *data, size_t dataLen);
+
+/**
+ * Record that an expire scan removed key. Adapters call this once the
+ * removal can no longer be undone by the scan itself.
+ */
+void kvidxChangeNoteExpired(kvidxInstance *i, uint64_t key);
+
+/**
+ * Position in the pending batch, for kvidxChangeRewind().
+ */
+size_t kvidxChangeMark(const kvidxInstance *i);
+
+/**
+ * Forget changes recorded since mark (e.g. an attempt that was rolled back).
+ */
+void kvidxChangeRewind(kvidxInstance *i, size_t mark);
+
+/**
+ * Forget EXPIRE changes recorded since mark for keys at or above minKey.
+ */
+void kvidxChangeDropExpired(kvidxInstance *i, size_t mark, uint64_t minKey);
+
+/**
+ * Publish the pending batch unless a transaction is open or it is held.
+ */
+void kvidxChangePublish(kvidxInstance *i);
+
+/**
+ * Keep kvidxChangePublish() from publishing until the matching release,
+ * so nested calls on an instance sharing the feed join the caller's batch.
+ */
+void kvidxChangeHold(kvidxInstance *i);
+void kvidxChangeRelease(kvidxInstance *i);
+
+/**
+ * Transaction boundaries: Begin starts a new batch, Commit publishes it,
+ * Abort discards it.
+ */
+void kvidxChangeBegin(kvidxInstance *i);
+void kvidxChangeCommit(kvidxInstance *i);
+void kvidxChangeAbort(kvidxInstance *i);
+
+/**
+ * Free the feed and every subscription still attached.
+ */
+void kvidxChangeFree(kvidxInstance *i);
+
+/* ====================================================================
+ * Metrics (kvidxkitMetrics.c)
+ * ==================================================================== */
+
+/**
+ * The public wrappers time their adapter call with
+ *
+ *     const kvidxMetricsSpan span = kvidxMetricsStart(i, KVIDX_OP_...);
+ *     ...
+ *     kvidxMetricsRecord(i, &span, rows);
+ *
+ * where rows is the number of entries the call read, wrote or removed.
+ * The pair also fires the op__start and op__done USDT probes; apart from
+ * those, both compile to nothing without KVIDXKIT_HAS_METRICS. With it, a
+ * call costs two cycle counter reads and two counter increments, and only
+ * a flag test while recording is off. Latencies are kept in counter ticks
+ * and converted to nanoseconds by kvidxGetMetrics().
+ *
+ * Calls on a key or range start with kvidxMetricsStartKeys() instead, and
+ * calls returning values record with kvidxMetricsRecordBytes(), so that a
+ * traced call (kvidxConfig.traceSampleEvery, traceSlowNanos) can report
+ * what it touched. Tracing reuses the span's counter reads; a call that
+ * is neither sampled nor slow costs one out-of-line check.
+ *
+ * With kvidxConfig.metricsIo the span also snapshots the work counters
+ * (kvidxMetricsIoSnapshot()) and the record adds the difference. rows
+ * goes into a running total first, so an operation made of nested public
+ * calls sees their rows in its difference too.
+ *
+ * Each thread hashes to one of KVIDX_METRICS_SHARDS shards and claims it
+ * on first use. The owner is the only writer of its shard, so it updates
+ * it with plain loads and stores; a thread whose shard is taken by another
+ * falls back to atomic adds on the shared last shard.
+ */
+
+/** Owned shards per instance, plus one shared by everyone else */
+#define KVIDX_METRICS_SHARDS 4
+
+typedef struct kvidxMetricsShard {
+    uint64_t owner; /* Thread token of the only writer, 0 if unclaimed */
+    uint64_t sumTicks[KVIDX_OP_COUNT];
+    uint64_t buckets[KVIDX_OP_COUNT][KVIDX_METRICS_BUCKETS];
+    kvidxIoCounters io[KVIDX_OP_COUNT];
+} kvidxMetricsShard;
+
+/** Ring of the latest slow operations (kvidxkitMetrics.c) */
+struct kvidxTraceLog;
+
+struct kvidxMetricsState {
+    uint64_t startTicks; /* Counter and clock when enabled, for calibration */
+    uint64_t startNanos;
+    uint64_t rowsTouched; /* Running total of rows, atomic */
+    uint64_t traceScale;  /* Nanoseconds per tick as double bits once
+                             calibrated, else 0; atomic */
+    const char *adapter;  /* Registry name of i->interface */
+    struct kvidxTraceLog *slowLog; /* Set once traceSlowNanos is; atomic */
+    kvidxMetricsShard shards[KVIDX_METRICS_SHARDS + 1];
+};
+
+/** An operation being timed */
+typedef struct kvidxMetricsSpan {
+    kvidxOp op;
+    uint64_t started;   /* Counter at start, 0 if not recording */
+    bool timing;        /* Goes into the histograms */
+    bool tracing;       /* Goes to kvidxTraceConsider() */
+    bool counting;      /* before holds a work counter snapshot */
+    bool hasKey;        /* key and endKey are set */
+    bool inTransaction; /* Between kvidxBegin() and commit or abort */
+    uint64_t key;
+    uint64_t endKey;
+    uint64_t bytesIn;
+    kvidxIoCounters before;
+} kvidxMetricsSpan;
+
+/**
+ * Allocate i->metrics if kvidxConfig.metrics or tracing asks for it and
+ * it is not there yet, and the slow op log once traceSlowNanos is set.
+ * Does nothing when built without metrics.
+ */
+kvidxError kvidxMetricsEnable(kvidxInstance *i);
+
+/**
+ * Free i->metrics.
+ */
+void kvidxMetricsFree(kvidxInstance *i);
+
+#ifdef KVIDXKIT_HAS_METRICS
+/** Unique token of the calling thread, 0 until first assigned */
+extern __thread uint64_t kvidxMetricsThreadToken;
+uint64_t kvidxMetricsAssignToken(void);
+uint64_t kvidxMetricsClockNanos(void);
+
+/** Running work counters of an instance: the adapter's plus our own */
+void kvidxMetricsIoSnapshot(kvidxInstance *i, kvidxIoCounters *io);
+
+/** Add the work done since span->before to shard s */
+void kvidxMetricsRecordIo(kvidxInstance *i, kvidxOp op,
+                          const kvidxMetricsSpan *span, uint64_t rows,
+                          kvidxMetricsShard *s, bool owned);
+
+/** Report a call that took ticks if it is sampled or slow */
+void kvidxTraceConsider(kvidxInstance *i, const kvidxMetricsSpan *span,
+                        uint64_t ticks, uint64_t rows, uint64_t bytesOut);
+
+static inline uint64_t kvidxMetricsTicks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return kvidxMetricsClockNanos();
+#endif
+}
+
+/** Log-linear bucket of a latency (see KVIDX_METRICS_BUCKETS) */
+static inline size_t kvidxMetricsBucket(uint64_t value) {
+    if (value < 8) {
+        return value;
+    }
+    const unsigned exp = 63 - __builtin_clzll(value);
+    const size_t bucket = (exp - 2) * 8 + ((value >> (exp - 3)) & 7);
+    return bucket < KVIDX_METRICS_BUCKETS ? bucket : KVIDX_METRICS_BUCKETS - 1;
+}
+
+static inline kvidxMetricsSpan
+kvidxMetricsBegin(kvidxInstance *i, kvidxOp op, bool hasKey, uint64_t key,
+                  uint64_t endKey, uint64_t bytesIn) {
+    KVIDX_PROBE2(op__start, i, op);
+    kvidxMetricsSpan span;
+    span.op = op;
+    span.started = 0;
+    span.timing = false;
+    span.tracing = false;
+    span.counting = false;
+    span.hasKey = hasKey;
+    span.inTransaction = i->transactionActive;
+    span.key = key;
+    span.endKey = endKey;
+    span.bytesIn = bytesIn;
+    if (i->metrics) {
+        span.timing = i->config.metrics;
+        span.tracing = i->config.traceSampleEvery || i->config.traceSlowNanos;
+        if (span.timing && i->config.metricsIo) {
+            kvidxMetricsIoSnapshot(i, &span.before);
+            span.counting = true;
+        }
+        if (span.timing || span.tracing) {
+            span.started = kvidxMetricsTicks();
+        }
+    }
+    return span;
+}
+
+static inline kvidxMetricsSpan kvidxMetricsStart(kvidxInstance *i,
+                                                 kvidxOp op) {
+    return kvidxMetricsBegin(i, op, false, 0, 0, 0);
+}
+
+/** Start a call on [key, endKey] that passes in bytesIn bytes of values */
+static inline kvidxMetricsSpan
+kvidxMetricsStartKeys(kvidxInstance *i, kvidxOp op, uint64_t key,
+                      uint64_t endKey, uint64_t bytesIn) {
+    return kvidxMetricsBegin(i, op, true, key, endKey, bytesIn);
+}
+
+/** Whether the span wants rows counted that the wrapper cannot see */
+static inline bool kvidxMetricsCounting(const kvidxMetricsSpan *span) {
+    return span->counting || span->tracing;
+}
+
+static inline void kvidxMetricsAdd(uint64_t *counter, uint64_t n,
+                                   bool owned) {
+    if (owned) {
+        __atomic_store_n(counter,
+                         __atomic_load_n(counter, __ATOMIC_RELAXED) + n,
+                         __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+    }
+}
+
+/** Add a call that took ticks to the calling thread's shard */
+static inline void kvidxMetricsRecordTicks(kvidxInstance *i,
+                                           const kvidxMetricsSpan *span,
+                                           uint64_t ticks, uint64_t rows) {
+    const kvidxOp op = span->op;
+    uint64_t token = kvidxMetricsThreadToken;
+    if (!token) {
+        token = kvidxMetricsAssignToken();
+    }
+
+    kvidxMetricsShard *s = &i->metrics->shards[token % KVIDX_METRICS_SHARDS];
+    uint64_t owner = __atomic_load_n(&s->owner, __ATOMIC_RELAXED);
+    if (!owner && __atomic_compare_exchange_n(&s->owner, &owner, token, false,
+                                              __ATOMIC_RELAXED,
+                                              __ATOMIC_RELAXED)) {
+        owner = token;
+    }
+    const bool owned = owner == token;
+    if (!owned) {
+        s = &i->metrics->shards[KVIDX_METRICS_SHARDS];
+    }
+
+    kvidxMetricsAdd(&s->buckets[op][kvidxMetricsBucket(ticks)], 1, owned);
+    kvidxMetricsAdd(&s->sumTicks[op], ticks, owned);
+    if (span->counting) {
+        kvidxMetricsRecordIo(i, op, span, rows, s, owned);
+    }
+}
+
+/** Record a call that returned bytesOut bytes of values */
+static inline void kvidxMetricsRecordBytes(kvidxInstance *i,
+                                           const kvidxMetricsSpan *span,
+                                           uint64_t rows, uint64_t bytesOut) {
+    KVIDX_PROBE3(op__done, i, span->op, rows);
+    if (!span->started) {
+        return;
+    }
+
+    const uint64_t ticks = kvidxMetricsTicks() - span->started;
+    if (span->timing) {
+        kvidxMetricsRecordTicks(i, span, ticks, rows);
+    }
+    if (span->tracing) {
+        kvidxTraceConsider(i, span, ticks, rows, bytesOut);
+    }
+}
+
+static inline void kvidxMetricsRecord(kvidxInstance *i,
+                                      const kvidxMetricsSpan *span,
+                                      uint64_t rows) {
+    kvidxMetricsRecordBytes(i, span, rows, 0);
+}
+#else
+static inline kvidxMetricsSpan
+kvidxMetricsBegin(kvidxInstance *i, kvidxOp op, bool hasKey, uint64_t key,
+                  uint64_t endKey, uint64_t bytesIn) {
+    (void)i;
+    (void)hasKey;
+    (void)key;
+    (void)endKey;
+    (void)bytesIn;
+    KVIDX_PROBE2(op__start, i, op);
+    return (kvidxMetricsSpan){.op = op};
+}
+
+#define kvidxMetricsStart(i, op) kvidxMetricsBegin(i, op, false, 0, 0, 0)
+#define kvidxMetricsStartKeys(i, op, key, endKey, bytesIn)                     \
+    kvidxMetricsBegin(i, op, true, key, endKey, bytesIn)
+#define kvidxMetricsCounting(span) ((void)(span), false)
+
+static inline void kvidxMetricsRecordBytes(kvidxInstance *i,
+                                           const kvidxMetricsSpan *span,
+                                           uint64_t rows, uint64_t bytesOut) {
+    (void)i;
+    (void)span;
+    (void)rows;
+    (void)bytesOut;
+    KVIDX_PROBE3(op__done, i, span->op, rows);
+}
+
+#define kvidxMetricsRecord(i, span, rows)                                      \
+    kvidxMetricsRecordBytes(i, span, rows, 0)
+#endif